@@ -156,6 +156,8 @@ var TraceClient = function(id, server, socket, packet) {
   this.socket = socket;
   this.contextInfo = packet['context_info'];
   this.commands = packet['commands'];
+  this.liveView = new LiveViewAggregate(
+      packet['live_view'], server.argv_['live-window']);
 
   console.log('[Tracer] New tracer connected: ' + this.contextInfo['title']);
 
@@ -179,6 +181,18 @@ var TraceClient = function(id, server, socket, packet) {
           data['source_id'] = id;
           client.socket.send(JSON.stringify(data));
           break;
+        case 'live_view_update':
+          // Aggregate here so that controllers only need to draw.
+          this.liveView.add(data);
+          var summaryJson = JSON.stringify({
+            'command': 'live_view_summary',
+            'id': id,
+            'summary': this.liveView.summarize()
+          });
+          server.forEachControlClient(function(client) {
+            client.socket.send(summaryJson);
+          });
+          break;
       }
     }
   }).bind(this));
@@ -206,11 +220,133 @@ TraceClient.prototype.serialize = function() {
     'command': 'add_trace_client',
     'id': this.id,
     'context_info': this.contextInfo,
-    'commands': this.commands
+    'commands': this.commands,
+    'live_view': this.liveView.summarize()
   };
 };
 
 
+/**
+ * Rolling aggregate of the live view updates from a tracer.
+ * Tracers only send what changed since their last update, so this keeps the
+ * most recent updates and merges them on demand.
+ * @param {Object} info Live view info from the tracer hello packet, if it
+ *     supports live view.
+ * @param {number} windowSize Number of updates to keep.
+ */
+var LiveViewAggregate = function(info, windowSize) {
+  this.info = info || null;
+  this.windowSize = Math.max(1, Number(windowSize) || 60);
+  this.updates = [];
+};
+
+LiveViewAggregate.prototype.add = function(update) {
+  this.updates.push(update);
+  if (this.updates.length > this.windowSize) {
+    this.updates.shift();
+  }
+};
+
+/**
+ * Merges all updates in the window.
+ * Scopes are [count, total ms, max ms, histogram...] and frames are the
+ * totals of the per-update frame statistics. The history has one
+ * [time, event count, mean frame interval] entry per update for graphing.
+ * @return {Object} Summary, or null if live view is not supported.
+ */
+LiveViewAggregate.prototype.summarize = function() {
+  if (!this.info) {
+    return null;
+  }
+
+  var summary = {
+    'info': this.info,
+    'start_time': 0,
+    'end_time': 0,
+    'counts': {},
+    'scopes': {},
+    'frames': null,
+    'history': [],
+    'partial': false
+  };
+  var frames = {
+    'count': 0,
+    'total': 0,
+    'max': 0,
+    'intervals': 0,
+    'interval_total': 0,
+    'interval_max': 0,
+    'histogram': []
+  };
+
+  this.updates.forEach(function(update, index) {
+    if (!index) {
+      summary['start_time'] = update['time'] - update['duration'];
+    }
+    summary['end_time'] = update['time'];
+    summary['partial'] = summary['partial'] || update['partial'];
+
+    var eventCount = 0;
+    var counts = update['counts'];
+    for (var name in counts) {
+      summary['counts'][name] = (summary['counts'][name] || 0) + counts[name];
+      eventCount += counts[name];
+    }
+
+    var scopes = update['scopes'];
+    for (var name in scopes) {
+      var scope = scopes[name];
+      var target = summary['scopes'][name];
+      if (!target) {
+        target = summary['scopes'][name] = [0, 0, 0];
+      }
+      target[0] += scope[0];
+      target[1] += scope[1];
+      target[2] = Math.max(target[2], scope[2]);
+      for (var n = 3; n < scope.length; n++) {
+        target[n] = (target[n] || 0) + scope[n];
+      }
+    }
+
+    var updateFrames = update['frames'];
+    if (updateFrames) {
+      frames['count'] += updateFrames['count'];
+      frames['total'] += updateFrames['mean'] * updateFrames['count'];
+      frames['max'] = Math.max(frames['max'], updateFrames['max']);
+      frames['intervals'] += updateFrames['intervals'];
+      frames['interval_total'] +=
+          updateFrames['interval_mean'] * updateFrames['intervals'];
+      frames['interval_max'] =
+          Math.max(frames['interval_max'], updateFrames['interval_max']);
+      updateFrames['histogram'].forEach(function(value, n) {
+        frames['histogram'][n] = (frames['histogram'][n] || 0) + value;
+      });
+    }
+
+    summary['history'].push([
+      update['time'],
+      eventCount,
+      updateFrames ? updateFrames['interval_mean'] : null
+    ]);
+  });
+
+  if (frames['count'] || frames['intervals']) {
+    summary['frames'] = {
+      'count': frames['count'],
+      'mean': frames['count'] ? frames['total'] / frames['count'] : 0,
+      'max': frames['max'],
+      'intervals': frames['intervals'],
+      'interval_mean': frames['intervals'] ?
+          frames['interval_total'] / frames['intervals'] : 0,
+      'interval_max': frames['interval_max'],
+      'histogram': frames['histogram']
+    };
+  }
+
+  return summary;
+};
+
+
 function main(argv) {
   var uri = 'ws://' + os.hostname() + ':' + argv['ws-port'];
 
@@ -252,6 +388,12 @@ main(optimist
       default: 8084,
       desc: 'WebSocket listen port.'
     })
+    .options('w', {
+      alias: 'live-window',
+      type: 'string',
+      default: 60,
+      desc: 'Number of live view updates to aggregate per tracer.'
+    })
     .check(function(argv) {
       if (argv['help']) {
         throw '';
@@ -8,15 +8,39 @@
 
 /**
  * @fileoverview Diff tool.
+ * Compares one or more traces against a baseline trace.
+ *
+ * Each trace is summarized in its own worker process, so traces are loaded in
+ * parallel and only one database per worker is ever in memory. Workers reduce
+ * their trace to per-event-type and per-frame duration percentiles which are
+ * then compared in a single pass.
  *
  * @author benvanik@google.com (Ben Vanik)
  */
 
+var childProcess = require('child_process');
+var os = require('os');
+var path = require('path');
+
 var toolRunner = require('./tool-runner');
 var util = toolRunner.util;
 toolRunner.launch(runTool);
 
 
+/**
+ * Percentiles stored in each duration summary, from 0 to 100 inclusive.
+ * @type {number}
+ */
+var QUANTILE_COUNT = 101;
+
+
+/**
+ * Coefficient of the two-sample Kolmogorov-Smirnov test at a 0.05 level.
+ * @type {number}
+ */
+var KS_COEFFICIENT = 1.358;
+
+
 /**
  * Diff tool.
  * @param {!wtf.pal.IPlatform} platform Platform abstraction layer.
@@ -24,165 +48,482 @@ toolRunner.launch(runTool);
  * @param {function(number)} done Call to end the program with a return code.
  */
 function runTool(platform, args, done) {
-  var inputFile1 = args[0];
-  var inputFile2 = args[1];
-  var filterString = args[2];
-  if (!inputFile1 || !inputFile2) {
-    console.log('usage: diff.js file1.wtf-trace file2.wtf-trace [filter]');
+  var jobs = os.cpus().length;
+  var filterString = null;
+  var workerMode = false;
+  while (args.length && args[0].indexOf('--') == 0) {
+    var option = args.shift().substr(2).split('=');
+    switch (option[0]) {
+      case 'jobs':
+        jobs = Number(option[1]);
+        break;
+      case 'filter':
+        filterString = option.slice(1).join('=');
+        break;
+      case 'worker':
+        workerMode = true;
+        break;
+    }
+  }
+
+  if (workerMode) {
+    // The parent disconnects once it has the summary, which lets this process
+    // exit. Send callbacks are not available on older node versions.
+    summarizeFile(args[0], filterString || null, function(summary) {
+      process.send(summary);
+    });
+    return;
+  }
+
+  // For compatibility, a trailing argument that isn't a trace is a filter.
+  var lastArg = args[args.length - 1];
+  if (args.length == 3 && !/\.wtf-(trace|json)$/.test(lastArg)) {
+    filterString = args.pop();
+  }
+
+  if (args.length < 2) {
+    console.log('usage: diff.js [--jobs=N] [--filter=expr] ' +
+        'baseline.wtf-trace file.wtf-trace [file2.wtf-trace ...]');
     done(1);
     return;
   }
-  console.log('Diffing ' + inputFile1 + ' and ' + inputFile2 + '...');
+  console.log('Diffing ' + args.slice(1).join(', ') + ' against ' +
+      args[0] + '...');
   console.log('');
 
-  var filter = null;
+  summarizeFiles(args, filterString, jobs, function(summaries) {
+    for (var n = 0; n < summaries.length; n++) {
+      if (summaries[n].error) {
+        console.log('ERROR: unable to open ' + args[n], summaries[n].error);
+        done(1);
+        return;
+      }
+    }
+    diffSummaries(summaries);
+    done(0);
+  });
+};
+
+
+/**
+ * Summarizes a list of files, running up to the given number of workers at a
+ * time.
+ * @param {!Array.<string>} files Trace files.
+ * @param {string?} filterString Filter expression, if any.
+ * @param {number} jobs Maximum number of workers, or 0 to summarize in this
+ *     process.
+ * @param {function(!Array.<!Object>)} callback Receives the summaries, in the
+ *     order of the files.
+ */
+function summarizeFiles(files, filterString, jobs, callback) {
+  var summaries = new Array(files.length);
+  var nextIndex = 0;
+  var remaining = files.length;
+
+  function summarized(index, summary) {
+    summaries[index] = summary;
+    remaining--;
+    if (!remaining) {
+      callback(summaries);
+    } else {
+      runNext();
+    }
+  };
+
+  function runNext() {
+    if (nextIndex >= files.length) {
+      return;
+    }
+    var index = nextIndex++;
+    if (jobs > 0) {
+      summarizeFileInWorker(files[index], filterString, function(summary) {
+        summarized(index, summary);
+      });
+    } else {
+      summarizeFile(files[index], filterString, function(summary) {
+        summarized(index, summary);
+      });
+    }
+  };
+
+  var initialCount = jobs > 0 ? Math.min(jobs, files.length) : 1;
+  for (var n = 0; n < initialCount; n++) {
+    runNext();
+  }
+};
+
+
+/**
+ * Summarizes a file in a worker process.
+ * @param {string} file Trace file.
+ * @param {string?} filterString Filter expression, if any.
+ * @param {function(!Object)} callback Receives the summary.
+ */
+function summarizeFileInWorker(file, filterString, callback) {
+  var workerArgs = ['--worker'];
+  if (process.argv.indexOf('--debug') != -1) {
+    workerArgs.push('--debug');
+  }
   if (filterString) {
-    filter = new wtf.db.Filter(filterString);
+    workerArgs.push('--filter=' + filterString);
   }
+  workerArgs.push(file);
+
+  var summary = null;
+  var worker = childProcess.fork(
+      path.join(__dirname, 'diff.js'), workerArgs);
+  worker.on('message', function(message) {
+    summary = message;
+    worker.disconnect();
+  });
+  worker.on('exit', function(code) {
+    callback(summary || {
+      file: file,
+      error: 'worker exited with code ' + code
+    });
+  });
+};
 
-  // Create databases for querying.
-  var db1 = null;
-  var db2 = null;
-  wtf.db.load(inputFile1, function(db) {
-    if (db instanceof Error) {
-      console.log('ERROR: unable to open ' + inputFile1, db);
-      done(1);
+
+/**
+ * Loads a file and summarizes its event durations.
+ * Events are read through the file in chunks and the database is disposed
+ * once summarized.
+ * @param {string} file Trace file.
+ * @param {string?} filterString Filter expression, if any.
+ * @param {function(!Object)} callback Receives the summary.
+ */
+function summarizeFile(file, filterString, callback) {
+  var loaded = function(db) {
+    if (!db || db instanceof Error) {
+      callback({
+        file: file,
+        error: db ? db.toString() : 'load failed'
+      });
       return;
     }
+    var filter = filterString ? new wtf.db.Filter(filterString) : null;
+    var summary = summarizeDatabase(db, filter);
+    summary.file = file;
+    db.dispose();
+    callback(summary);
+  };
+  if (/\.wtf-trace$/.test(file)) {
+    wtf.db.loadPaged(file, {}, loaded);
+  } else {
+    wtf.db.load(file, loaded);
+  }
+};
+
+
+/**
+ * Summarizes a database.
+ * @param {!wtf.db.Database} db Database.
+ * @param {wtf.db.Filter} filter Filter, if any.
+ * @return {!Object} Summary.
+ */
+function summarizeDatabase(db, filter) {
+  var eventTypeFilter = filter ? filter.getEventTypeFilter() : null;
+  var argumentFilter = filter ? filter.getArgumentFilter() : null;
 
-    db1 = db;
-    if (db1 && db2) {
-      diffDatabases(db1, db2, filter);
-      done(0);
+  // Durations of each scope type and counts of each instance type, by type
+  // ID. Types are resolved once up front as in wtf.db.EventStatistics.
+  var scopeDurations = {};
+  var instanceCounts = {};
+  var eventTypeList = db.getEventTypeTable().getAll();
+  for (var n = 0; n < eventTypeList.length; n++) {
+    var type = eventTypeList[n];
+    if (type.flags & wtf.data.EventFlag.INTERNAL ||
+        type.flags & wtf.data.EventFlag.BUILTIN) {
+      continue;
     }
-  });
-  wtf.db.load(inputFile2, function(db) {
-    if (db instanceof Error) {
-      console.log('ERROR: unable to open ' + inputFile2, db);
-      done(1);
-      return;
+    if (eventTypeFilter && !eventTypeFilter(type)) {
+      continue;
+    }
+    if (type.eventClass == wtf.data.EventClass.SCOPE) {
+      scopeDurations[type.id] = [];
+    } else {
+      instanceCounts[type.id] = 0;
+    }
+  }
+
+  var summary = {
+    scopes: {},
+    instances: {},
+    frames: {}
+  };
+
+  var zones = db.getZones();
+  for (var n = 0; n < zones.length; n++) {
+    var zone = zones[n];
+    var it = zone.getEventList().begin();
+    for (; !it.done(); it.next()) {
+      var typeId = it.getTypeId();
+      var durations = scopeDurations[typeId];
+      if (durations) {
+        if (!it.getEndTime() || (argumentFilter && !argumentFilter(it))) {
+          continue;
+        }
+        // Matches wtf.db.ScopeEventDataEntry#getMeanTime.
+        if (it.getType().flags & wtf.data.EventFlag.SYSTEM_TIME) {
+          durations.push(it.getTotalDuration());
+        } else {
+          durations.push(it.getUserDuration());
+        }
+      } else if (typeId in instanceCounts) {
+        if (!argumentFilter || argumentFilter(it)) {
+          instanceCounts[typeId]++;
+        }
+      }
+    }
+
+    var frames = zone.getFrameList().getAllFrames();
+    if (frames.length) {
+      var frameDurations = [];
+      for (var m = 0; m < frames.length; m++) {
+        frameDurations.push(frames[m].getDuration());
+      }
+      summary.frames[zone.getName()] = summarizeDurations(frameDurations);
     }
+  }
 
-    db2 = db;
-    if (db1 && db2) {
-      diffDatabases(db1, db2, filter);
-      done(0);
+  for (var n = 0; n < eventTypeList.length; n++) {
+    var type = eventTypeList[n];
+    var durations = scopeDurations[type.id];
+    if (durations && durations.length) {
+      summary.scopes[type.name] = summarizeDurations(durations);
+    } else if (instanceCounts[type.id]) {
+      summary.instances[type.name] = instanceCounts[type.id];
     }
+  }
+  return summary;
+};
+
+
+/**
+ * Summarizes a list of durations.
+ * @param {!Array.<number>} durations Durations, in ms.
+ * @return {!{count: number, total: number, quantiles: !Array.<number>}}
+ *     Count, sum and the 0th to 100th percentiles.
+ */
+function summarizeDurations(durations) {
+  var sorted = new Float64Array(durations);
+  Array.prototype.sort.call(sorted, function(a, b) {
+    return a - b;
   });
+  var total = 0;
+  for (var n = 0; n < sorted.length; n++) {
+    total += sorted[n];
+  }
+  var quantiles = [];
+  for (var n = 0; n < QUANTILE_COUNT; n++) {
+    var rank = n / (QUANTILE_COUNT - 1) * (sorted.length - 1);
+    var lower = Math.floor(rank);
+    var upper = Math.min(lower + 1, sorted.length - 1);
+    var t = rank - lower;
+    quantiles.push(sorted[lower] * (1 - t) + sorted[upper] * t);
+  }
+  return {
+    count: sorted.length,
+    total: total,
+    quantiles: quantiles
+  };
 };
 
 
 /**
- * Diffs two loaded databases.
- * @param {!wtf.db.Database} db1 Database 1.
- * @param {!wtf.db.Database} db2 Database 2.
- * @param {wtf.db.Filter} filter Filter, if any.
+ * Evaluates the cumulative distribution of a summary at a value.
+ * @param {!Array.<number>} quantiles Summary percentiles.
+ * @param {number} value Value.
+ * @return {number} Approximate fraction of samples at or below the value.
+ */
+function cumulativeFraction(quantiles, value) {
+  if (value < quantiles[0]) {
+    return 0;
+  }
+  var n = 0;
+  while (n < quantiles.length - 1 && quantiles[n + 1] <= value) {
+    n++;
+  }
+  return n / (quantiles.length - 1);
+};
+
+
+/**
+ * Tests whether two duration summaries are drawn from different
+ * distributions, with a two-sample Kolmogorov-Smirnov test on the percentiles.
+ * The percentiles limit the resolution of the test to 1% of the samples.
+ * @param {!Object} a Summary.
+ * @param {!Object} b Summary.
+ * @return {boolean} True if the difference is significant at a 0.05 level.
+ */
+function isSignificant(a, b) {
+  var maxDistance = 0;
+  var values = a.quantiles.concat(b.quantiles);
+  for (var n = 0; n < values.length; n++) {
+    maxDistance = Math.max(maxDistance, Math.abs(
+        cumulativeFraction(a.quantiles, values[n]) -
+        cumulativeFraction(b.quantiles, values[n])));
+  }
+  var threshold = KS_COEFFICIENT *
+      Math.sqrt((a.count + b.count) / (a.count * b.count));
+  return maxDistance > Math.max(threshold, 1 / (QUANTILE_COUNT - 1));
+};
+
+
+/**
+ * Formats the relative change from a baseline value.
+ * @param {number} baseline Baseline value.
+ * @param {number} value Value.
+ * @return {string} Change, such as '+12.5%'.
+ */
+function formatChange(baseline, value) {
+  if (!baseline) {
+    return value ? '+inf' : '0%';
+  }
+  var change = (value - baseline) / baseline * 100;
+  return (change >= 0 ? '+' : '') + change.toFixed(1) + '%';
+};
+
+
+/**
+ * Logs the comparison of duration summaries.
+ * @param {string} title Row title.
+ * @param {!Array.<!Object>} summaries Summaries of the baseline and runs.
+ * @param {!Array.<Object|undefined>} entries Entries of the baseline and
+ *     runs, if present.
  */
-function diffDatabases(db1, db2, filter) {
+function logDurationDiff(title, summaries, entries) {
   var ALIGN_RIGHT = -8; // 8 chars wide, right aligned
+  var spacing = [-24, ALIGN_RIGHT, ALIGN_RIGHT, ALIGN_RIGHT, ALIGN_RIGHT,
+      ALIGN_RIGHT, 2];
+
+  // Color by the largest significant median shift.
+  var baseline = entries[0];
+  var color = '';
+  for (var n = 1; n < entries.length; n++) {
+    var entry = entries[n];
+    if (baseline && entry && isSignificant(baseline, entry)) {
+      var shift = entry.quantiles[50] - baseline.quantiles[50];
+      if (shift > 0) {
+        color = '\033[31m';
+      } else if (shift < 0 && !color) {
+        color = '\033[32m';
+      }
+    }
+  }
+  console.log(color + title + '\033[0m');
 
-  // Build event data tables.
-  var table1 = new wtf.db.EventStatistics(db1).getTable().filter(filter);
-  var table2 = new wtf.db.EventStatistics(db2).getTable().filter(filter);
+  for (var n = 0; n < entries.length; n++) {
+    var name = path.basename(summaries[n].file);
+    var entry = entries[n];
+    if (!entry) {
+      console.log(util.spaceValues(spacing, name, '(not present)'));
+      continue;
+    }
+    var q = entry.quantiles;
+    console.log(util.spaceValues(spacing,
+        name,
+        String(entry.count),
+        wtf.util.formatSmallTime(entry.total / entry.count),
+        wtf.util.formatSmallTime(q[50]),
+        wtf.util.formatSmallTime(q[90]),
+        wtf.util.formatSmallTime(q[99])));
+    if (n && baseline) {
+      console.log(util.spaceValues(spacing,
+          '',
+          formatChange(baseline.count, entry.count),
+          formatChange(baseline.total / baseline.count,
+              entry.total / entry.count),
+          formatChange(baseline.quantiles[50], q[50]),
+          formatChange(baseline.quantiles[90], q[90]),
+          formatChange(baseline.quantiles[99], q[99]),
+          isSignificant(baseline, entry) ? '*' : ''));
+    }
+  }
+  console.log('');
+};
 
-  // Grab all event types from each table and divide by type.
-  var allInstanceEntryNames = wtf.db.EventStatistics.getAllEventTypeNames(
-      [table1, table2], wtf.data.EventClass.INSTANCE);
-  var allScopeEntryNames = wtf.db.EventStatistics.getAllEventTypeNames(
-      [table1, table2], wtf.data.EventClass.SCOPE);
 
-  // Dump scope events.
+/**
+ * Diffs trace summaries against the first.
+ * @param {!Array.<!Object>} summaries Summaries of the baseline and runs.
+ */
+function diffSummaries(summaries) {
+  var ALIGN_RIGHT = -8; // 8 chars wide, right aligned
   console.log(util.spaceValues(
-      [ALIGN_RIGHT, ALIGN_RIGHT, ALIGN_RIGHT],
-      'Count', 'Total', 'Average'));
+      [-24, ALIGN_RIGHT, ALIGN_RIGHT, ALIGN_RIGHT, ALIGN_RIGHT, ALIGN_RIGHT],
+      '', 'Count', 'Mean', 'p50', 'p90', 'p99'));
+  console.log('* = distribution differs from the baseline (KS test, p<0.05)');
   console.log('');
-  allScopeEntryNames.sort(function(nameA, nameB) {
-    var entryA1 = table1.getEventTypeEntry(nameA);
-    var entryA2 = table2.getEventTypeEntry(nameA);
-    var diffA = Math.abs((entryA1 ? entryA1.getMeanTime() : 0) -
-                         (entryA2 ? entryA2.getMeanTime() : 0));
-    var entryB1 = table1.getEventTypeEntry(nameB);
-    var entryB2 = table2.getEventTypeEntry(nameB);
-    var diffB = Math.abs((entryB1 ? entryB1.getMeanTime() : 0) -
-                         (entryB2 ? entryB2.getMeanTime() : 0));
-    return diffA - diffB;
-  });
-  for (var n = 0; n < allScopeEntryNames.length; n++) {
-    var eventTypeName = allScopeEntryNames[n];
-    var entry1 = table1.getEventTypeEntry(eventTypeName);
-    var entry2 = table2.getEventTypeEntry(eventTypeName);
-    var hasEntry1 = entry1 && entry1.getCount();
-    var hasEntry2 = entry2 && entry2.getCount();
-    if (!hasEntry1 && !hasEntry2) {
-      continue;
-    }
 
-    var diff =
-        (hasEntry1 ? entry1.getMeanTime() : 0) -
-        (hasEntry2 ? entry2.getMeanTime() : 0);
-    var color = '';
-    if (diff < 0) {
-      color = '\033[31m';
-    } else if (diff > 0) {
-      color = '\033[32m';
-    }
+  // Frames first, as they're the end result of everything else.
+  var zoneNames = getAllKeys(summaries, 'frames');
+  for (var n = 0; n < zoneNames.length; n++) {
+    var entries = summaries.map(function(summary) {
+      return summary.frames[zoneNames[n]];
+    });
+    logDurationDiff('Frames (' + zoneNames[n] + ')', summaries, entries);
+  }
 
-    console.log(color + eventTypeName + '\033[0m');
-    if (hasEntry1) {
-      console.log(util.spaceValues(
-          [ALIGN_RIGHT, ALIGN_RIGHT, ALIGN_RIGHT],
-          String(entry1.getCount()),
-          wtf.util.formatSmallTime(entry1.getUserTime()),
-          wtf.util.formatSmallTime(entry1.getMeanTime())));
-    } else {
-      console.log('(not present in input 1)');
-    }
-    if (hasEntry2) {
-      console.log(util.spaceValues(
-          [ALIGN_RIGHT, ALIGN_RIGHT, ALIGN_RIGHT],
-          String(entry2.getCount()),
-          wtf.util.formatSmallTime(entry2.getUserTime()),
-          wtf.util.formatSmallTime(entry2.getMeanTime())));
-    } else {
-      console.log('(not present in input 2)');
+  // Scopes, sorted so that the largest median shifts are last.
+  var scopeNames = getAllKeys(summaries, 'scopes');
+  function getMaxShift(name) {
+    var baseline = summaries[0].scopes[name];
+    var maxShift = 0;
+    for (var n = 1; n < summaries.length; n++) {
+      var entry = summaries[n].scopes[name];
+      maxShift = Math.max(maxShift, Math.abs(
+          (entry ? entry.quantiles[50] : 0) -
+          (baseline ? baseline.quantiles[50] : 0)));
     }
-    console.log('');
-
-    // drawDistribution(entry1.getDistribution());
-    // drawDistribution(entry2.getDistribution());
+    return maxShift;
+  };
+  var maxShifts = {};
+  for (var n = 0; n < scopeNames.length; n++) {
+    maxShifts[scopeNames[n]] = getMaxShift(scopeNames[n]);
+  }
+  scopeNames.sort(function(nameA, nameB) {
+    return maxShifts[nameA] - maxShifts[nameB];
+  });
+  for (var n = 0; n < scopeNames.length; n++) {
+    var entries = summaries.map(function(summary) {
+      return summary.scopes[scopeNames[n]];
+    });
+    logDurationDiff(scopeNames[n], summaries, entries);
   }
 
-  db1.dispose();
-  db2.dispose();
-  return 0;
+  // Instance counts.
+  var instanceNames = getAllKeys(summaries, 'instances');
+  for (var n = 0; n < instanceNames.length; n++) {
+    var name = instanceNames[n];
+    var baselineCount = summaries[0].instances[name] || 0;
+    var line = [name, String(baselineCount)];
+    for (var m = 1; m < summaries.length; m++) {
+      var count = summaries[m].instances[name] || 0;
+      if (count != baselineCount) {
+        line.push(count + ' (' + formatChange(baselineCount, count) + ')');
+      } else {
+        line.push(String(count));
+      }
+    }
+    console.log(line.join('  '));
+  }
 };
 
 
-function drawDistribution(buckets) {
-  var first = buckets.length;
-  var last = 0;
-  var max = Number.MIN_VALUE;
-  for (var n = 0; n < buckets.length; n++) {
-    var value = buckets[n];
-    if (value) {
-      first = Math.min(first, n);
-      last = Math.max(last, n);
-      max = Math.max(max, value);
-    }
-  }
-  var span = last - first;
-  for (var n = first; n <= last; n++) {
-    var value = buckets[n];
-    var line = util.pad(n, -3) + 'ms - ' +
-        util.pad(value, -4) + ': ';
-    if (value) {
-      var span = [];
-      for (var m = 0; m < value; m++) {
-        span.push('-');
-      }
-      span.push('*');
-      line += span.join('');
+/**
+ * Gets the union of the keys of a field of all summaries.
+ * @param {!Array.<!Object>} summaries Summaries.
+ * @param {string} field Field name.
+ * @return {!Array.<string>} Keys.
+ */
+function getAllKeys(summaries, field) {
+  var keys = {};
+  for (var n = 0; n < summaries.length; n++) {
+    for (var key in summaries[n][field]) {
+      keys[key] = true;
     }
-    console.log(line);
   }
+  return Object.keys(keys);
 };
@@ -15,6 +15,7 @@
  */
 
 var child_process = require('child_process');
+var crypto = require('crypto');
 var fs = require('fs');
 var http = require('http');
 var https = require('https');
@@ -23,16 +24,9 @@ var os = require('os');
 var path = require('path');
 var querystring = require('querystring');
 var url = require('url');
-var hash = require('string-hash');
 
 var falafel = require('falafel');
 
-/**
- * Maps hash-keys to a mapping from source code to transformed code.
- * @type {!Object.<string, !Object.<string, string>}
- */
-var transformMap = {}
-
 
 
 /**
@@ -44,29 +38,18 @@ var transformMap = {}
  * @return {string} Transformed code.
  */
 function transformCode(moduleId, url, sourceCode, argv) {
-  console.log('Instrumenting ' + url + ' (' + sourceCode.length + 'b)...');
-  var startTime = Date.now();
-
   var trackHeap = argv['track-heap'];
-  var key = hash(sourceCode);
-  if (key in transformMap) {
-    var transformBucket = transformMap[key];
-    if (sourceCode in transformBucket) {
-      var endTime = Date.now() - startTime;
-      console.log('  ' + endTime + 'ms (Cached)');
-      return transformBucket[sourceCode];
-    }
-  } else {
-    transformMap[key] = {};
-  }
-
+  var sampling = {
+    budget: Number(argv['budget']) || 0,
+    minTime: (Number(argv['min-time']) || 0) / 1000
+  };
 
   // This code is stringified and then embedded in each output file.
   // It's ok if multiple are present on the page.
   // It cannot capture any state.
   // TODO(benvanik): clean up, make support nodejs too.
   // TODO(benvanik): put in an external file, have a HUD, etc.
-  var sharedInitCode = '(' + (function(global, trackHeap) {
+  var sharedInitCode = '(' + (function(global, trackHeap, sampling) {
     // Add a global tag to let WTF know we are on the page. The extension can
     // then yell at the user for trying to use both at the same time.
     var firstBlock = !global.__wtfInstrumentationPresent;
@@ -127,13 +110,71 @@ function transformCode(moduleId, url, sourceCode, argv) {
     global.__wtfm = global.__wtfm || {};
     global.__wtfd = global.__wtfd || new Int32Array(1 << dataMagnitude);
     global.__wtfi = global.__wtfi || 0;
+    var getHeapUsage = null;
     if (trackHeap) {
-      var getHeapUsage = null;
       try {
         getHeapUsage = new Function('return %GetHeapUsage()');
       } catch (e) {
         window.alert('Launch Chrome with --js-flags=--allow-natives-syntax');
       }
+    }
+    if (sampling.budget || sampling.minTime) {
+      // Sampled mode: calls past the per-function budget are not recorded,
+      // and calls that finish in under minTime without recording any children
+      // are erased. Whether each open call was recorded is kept on a stack so
+      // that enters and exits always balance.
+      var stackSize = 1 << 16;
+      var stackMask = stackSize - 1;
+      var stack = global.__wtfs = global.__wtfs || {
+        depth: 0,
+        recorded: new Uint8Array(stackSize),
+        offsets: new Int32Array(stackSize),
+        times: new Float64Array(stackSize),
+        counts: {}
+      };
+      var budget = sampling.budget;
+      var minTime = sampling.minTime;
+      var enterLength = trackHeap ? 2 : 1;
+      var now = global.performance && global.performance.now ?
+          function() { return global.performance.now(); } : Date.now;
+      global.__wtfEnter = function(id) {
+        var depth = stack.depth++ & stackMask;
+        var count = stack.counts[id] = (stack.counts[id] || 0) + 1;
+        if (budget && count > budget) {
+          stack.recorded[depth] = 0;
+          return;
+        }
+        stack.recorded[depth] = 1;
+        stack.offsets[depth] = __wtfi;
+        __wtfd[__wtfi++ & dataMask] = id;
+        if (trackHeap) {
+          __wtfd[__wtfi++ & dataMask] = getHeapUsage();
+        }
+        if (minTime) {
+          stack.times[depth] = now();
+        }
+      };
+      global.__wtfExit = function(id) {
+        if (!stack.depth) {
+          return;
+        }
+        var depth = --stack.depth & stackMask;
+        if (!stack.recorded[depth]) {
+          return;
+        }
+        if (minTime &&
+            __wtfi == stack.offsets[depth] + enterLength &&
+            now() - stack.times[depth] < minTime) {
+          // Short leaf call - drop the enter record.
+          __wtfi = stack.offsets[depth];
+          return;
+        }
+        __wtfd[__wtfi++ & dataMask] = -id;
+        if (trackHeap) {
+          __wtfd[__wtfi++ & dataMask] = getHeapUsage();
+        }
+      };
+    } else if (trackHeap) {
       global.__wtfEnter = function(id) {
         __wtfd[__wtfi++ & dataMask] = id;
         __wtfd[__wtfi++ & dataMask] = getHeapUsage();
@@ -152,6 +193,9 @@ function transformCode(moduleId, url, sourceCode, argv) {
     }
     global.__resetTrace = function() {
       global.__wtfi = 0;
+      if (global.__wtfs) {
+        global.__wtfs.counts = {};
+      }
     };
     global.__grabTrace = function() {
       var euri = window.location.href;
@@ -251,7 +295,8 @@ function transformCode(moduleId, url, sourceCode, argv) {
           false, false, false, false, 0, null);
       a.dispatchEvent(e);
     };
-  }).toString() + ')(window, ' + trackHeap + ');';
+  }).toString() + ')(window, ' + trackHeap + ', ' +
+      JSON.stringify(sampling) + ');';
 
   // Attempt to guess the names of functions.
   function getFunctionName(node) {
@@ -436,17 +481,370 @@ function transformCode(moduleId, url, sourceCode, argv) {
     }
   });
 
-  var endTime = Date.now() - startTime;
-  var transformedCode = [
+  return [
     sharedInitCode,
     '__wtfm[' + moduleId + '] = {' +
         '"src": "' + url + '",' +
         '"fns": [' + fns.join(',\n') + ']};',
     targetCode.toString()
   ].join('');
-  transformMap[key][sourceCode] = transformedCode;
-  console.log('  ' + endTime + 'ms');
-  return transformedCode;
+};
+
+
+/**
+ * Hash of this tool's source, mixed into cache keys so that cached output is
+ * discarded when the instrumentation changes.
+ * @type {string}
+ */
+var toolHash = crypto.createHash('sha1').update(
+    fs.readFileSync(__filename)).digest('hex');
+
+
+/**
+ * Computes the cache key for a transform.
+ * Everything that affects the output must be included.
+ * @param {number} moduleId Module ID.
+ * @param {string} url URL of the source code.
+ * @param {string} sourceCode Source code.
+ * @param {!Object} argv Parsed arguments.
+ * @return {string} Cache key.
+ */
+function getTransformKey(moduleId, url, sourceCode, argv) {
+  return crypto.createHash('sha1').update(JSON.stringify([
+    toolHash,
+    moduleId,
+    url,
+    argv['track-heap'],
+    argv['ignore'],
+    argv['ignore-pattern'],
+    argv['budget'],
+    argv['min-time']
+  ])).update(sourceCode).digest('hex');
+};
+
+
+
+/**
+ * Cache of transformed code, kept both in memory and on disk.
+ * Disk entries are files named by the transform key so that they survive
+ * restarts of the tool.
+ * @param {?string} cachePath Cache directory, or null to only cache in memory.
+ * @constructor
+ */
+var TransformCache = function(cachePath) {
+  /**
+   * Cache directory, if caching to disk.
+   * @type {?string}
+   */
+  this.cachePath = cachePath;
+
+  /**
+   * Transformed code by transform key.
+   * @type {!Object.<string>}
+   */
+  this.entries = {};
+
+  if (cachePath && !fs.existsSync(cachePath)) {
+    fs.mkdirSync(cachePath);
+  }
+};
+
+
+/**
+ * Gets transformed code from the cache.
+ * @param {string} key Transform key.
+ * @return {?string} Transformed code, if cached.
+ */
+TransformCache.prototype.get = function(key) {
+  if (key in this.entries) {
+    return this.entries[key];
+  }
+  if (!this.cachePath) {
+    return null;
+  }
+  var entryPath = path.join(this.cachePath, key + '.js');
+  if (!fs.existsSync(entryPath)) {
+    return null;
+  }
+  var code = fs.readFileSync(entryPath).toString();
+  this.entries[key] = code;
+  return code;
+};
+
+
+/**
+ * Adds transformed code to the cache.
+ * @param {string} key Transform key.
+ * @param {string} code Transformed code.
+ */
+TransformCache.prototype.put = function(key, code) {
+  this.entries[key] = code;
+  if (!this.cachePath) {
+    return;
+  }
+  // Write to a temporary file and rename so that concurrent readers never see
+  // a partial entry.
+  var entryPath = path.join(this.cachePath, key + '.js');
+  var tempPath = entryPath + '.' + process.pid + '.tmp';
+  try {
+    fs.writeFileSync(tempPath, code);
+    fs.renameSync(tempPath, entryPath);
+  } catch (e) {
+    console.log('Unable to write cache entry ' + entryPath + ': ' + e);
+  }
+};
+
+
+
+/**
+ * A pool of child processes that run transforms in parallel.
+ * Workers are this same script launched with --worker.
+ * @param {!Object} argv Parsed arguments.
+ * @param {number} size Number of worker processes.
+ * @constructor
+ */
+var TransformPool = function(argv, size) {
+  /**
+   * Parsed arguments, forwarded to workers.
+   * @type {!Object}
+   */
+  this.argv = argv;
+
+  /**
+   * Workers not running a transform.
+   * @type {!Array.<!Object>}
+   */
+  this.idleWorkers = [];
+
+  /**
+   * Transforms waiting for a worker.
+   * @type {!Array.<!Object>}
+   */
+  this.queue = [];
+
+  /**
+   * Number of live workers.
+   * @type {number}
+   */
+  this.workerCount = 0;
+
+  for (var n = 0; n < size; n++) {
+    this.idleWorkers.push(this.createWorker_());
+  }
+};
+
+
+/**
+ * Launches a new worker process.
+ * @return {!Object} Worker process.
+ * @private
+ */
+TransformPool.prototype.createWorker_ = function() {
+  var self = this;
+  var worker = child_process.fork(__filename, ['--worker']);
+  worker.pending = null;
+  worker.completedCount = 0;
+  this.workerCount++;
+  worker.on('message', function(message) {
+    var request = worker.pending;
+    worker.pending = null;
+    worker.completedCount++;
+    self.release_(worker);
+    if (message.error) {
+      request.callback(new Error(message.error), null);
+    } else {
+      request.callback(null, message.code);
+    }
+  });
+  worker.on('exit', function(code, signal) {
+    var request = worker.pending;
+    worker.pending = null;
+    self.workerCount--;
+    var index = self.idleWorkers.indexOf(worker);
+    if (index != -1) {
+      self.idleWorkers.splice(index, 1);
+    }
+
+    // Replace workers that crashed after doing useful work so the pool keeps
+    // its size. Workers that never completed a transform would most likely
+    // fail again, so the pool shrinks instead.
+    if ((code || signal) && worker.completedCount) {
+      self.release_(self.createWorker_());
+    } else if (!self.workerCount) {
+      console.log('All transform workers exited; transforming in-process.');
+      self.drainInProcess_();
+    }
+    if (request) {
+      request.callback(new Error('Worker exited during transform.'), null);
+    }
+  });
+  return worker;
+};
+
+
+/**
+ * Whether the pool has any workers left.
+ * @return {boolean} True if transforms can be run on the pool.
+ */
+TransformPool.prototype.isAvailable = function() {
+  return this.workerCount > 0;
+};
+
+
+/**
+ * Runs all queued transforms in this process, once no workers are left.
+ * @private
+ */
+TransformPool.prototype.drainInProcess_ = function() {
+  var queue = this.queue;
+  this.queue = [];
+  for (var n = 0; n < queue.length; n++) {
+    var request = queue[n];
+    var targetCode;
+    try {
+      targetCode = transformCode(
+          request.moduleId, request.url, request.sourceCode, this.argv);
+    } catch (e) {
+      request.callback(e, null);
+      continue;
+    }
+    request.callback(null, targetCode);
+  }
+};
+
+
+/**
+ * Returns a worker to the pool, starting the next queued transform.
+ * @param {!Object} worker Worker process.
+ * @private
+ */
+TransformPool.prototype.release_ = function(worker) {
+  if (this.queue.length) {
+    this.dispatch_(worker, this.queue.shift());
+  } else {
+    this.idleWorkers.push(worker);
+  }
+};
+
+
+/**
+ * Sends a transform to a worker.
+ * @param {!Object} worker Worker process.
+ * @param {!Object} request Transform request.
+ * @private
+ */
+TransformPool.prototype.dispatch_ = function(worker, request) {
+  worker.pending = request;
+  worker.send({
+    moduleId: request.moduleId,
+    url: request.url,
+    sourceCode: request.sourceCode,
+    argv: this.argv
+  });
+};
+
+
+/**
+ * Transforms code on the next available worker.
+ * @param {number} moduleId Module ID, [0-126].
+ * @param {string} url URL of the source code.
+ * @param {string} sourceCode Source code.
+ * @param {function(Error, ?string)} callback Receives the transformed code.
+ */
+TransformPool.prototype.transform = function(
+    moduleId, url, sourceCode, callback) {
+  var request = {
+    moduleId: moduleId,
+    url: url,
+    sourceCode: sourceCode,
+    callback: callback
+  };
+  if (this.idleWorkers.length) {
+    this.dispatch_(this.idleWorkers.pop(), request);
+  } else {
+    this.queue.push(request);
+  }
+};
+
+
+/**
+ * Runs as a pool worker, transforming code sent by the parent process.
+ */
+function runWorker() {
+  process.on('message', function(message) {
+    try {
+      process.send({
+        code: transformCode(
+            message.moduleId, message.url, message.sourceCode, message.argv)
+      });
+    } catch (e) {
+      process.send({
+        error: String(e)
+      });
+    }
+  });
+};
+
+
+/**
+ * Creates the transform cache for the given arguments.
+ * @param {!Object} argv Parsed arguments.
+ * @return {!TransformCache} Transform cache.
+ */
+function createCache(argv) {
+  var cachePath = null;
+  if (argv['cache']) {
+    cachePath = argv['cache-dir'] ||
+        path.join(os.tmpDir(), 'wtf-instrument-cache');
+  }
+  return new TransformCache(cachePath);
+};
+
+
+/**
+ * Instruments code, using the cache if possible.
+ * @param {!TransformCache} cache Transform cache.
+ * @param {TransformPool} pool Worker pool, or null to transform in-process.
+ * @param {number} moduleId Module ID, [0-126].
+ * @param {string} url URL of the source code.
+ * @param {string} sourceCode Source code.
+ * @param {!Object} argv Parsed arguments.
+ * @param {function(Error, ?string)} callback Receives the transformed code.
+ */
+function instrumentCode(cache, pool, moduleId, url, sourceCode, argv,
+    callback) {
+  console.log('Instrumenting ' + url + ' (' + sourceCode.length + 'b)...');
+  var startTime = Date.now();
+
+  var key = getTransformKey(moduleId, url, sourceCode, argv);
+  var cachedCode = cache.get(key);
+  if (cachedCode !== null) {
+    console.log('  ' + (Date.now() - startTime) + 'ms (Cached)');
+    callback(null, cachedCode);
+    return;
+  }
+
+  function complete(err, targetCode) {
+    if (err) {
+      callback(err, null);
+      return;
+    }
+    cache.put(key, targetCode);
+    console.log('  ' + url + ': ' + (Date.now() - startTime) + 'ms');
+    callback(null, targetCode);
+  };
+  if (pool && pool.isAvailable()) {
+    pool.transform(moduleId, url, sourceCode, complete);
+  } else {
+    var targetCode;
+    try {
+      targetCode = transformCode(moduleId, url, sourceCode, argv);
+    } catch (e) {
+      callback(e, null);
+      return;
+    }
+    complete(null, targetCode);
+  }
 };
 
 
@@ -472,11 +870,16 @@ function processFile(argv, inputPath, opt_outputPath) {
   var sourceCode = fs.readFileSync(inputPath).toString();
 
   // TODO(benvanik): support setting the module ID?
-  var targetCode = transformCode(0, inputPath, sourceCode, argv);
-
-  console.log('Writing ' + outputPath + '...');
-  fs.writeFileSync(outputPath, targetCode);
-  fs.chmodSync(outputPath, fs.statSync(inputPath).mode);
+  var cache = createCache(argv);
+  instrumentCode(cache, null, 0, inputPath, sourceCode, argv,
+      function(err, targetCode) {
+        if (err) {
+          throw err;
+        }
+        console.log('Writing ' + outputPath + '...');
+        fs.writeFileSync(outputPath, targetCode);
+        fs.chmodSync(outputPath, fs.statSync(inputPath).mode);
+      });
 };
 
 
@@ -492,28 +895,55 @@ function startServer(argv, httpPort, httpsPort, certs) {
   console.log('   http: ' + httpPort);
   console.log('  https: ' + httpsPort);
 
-  // Injects a node stream by buffering all data, transforming it, and writing
-  // it back out.
-  // Module IDs are assigned on demand and rotate 0-126.
+  var cache = createCache(argv);
+  var jobs = Number(argv['jobs']);
+  var pool = jobs > 1 ? new TransformPool(argv, jobs) : null;
+  console.log('   jobs: ' + (pool ? jobs : 1));
+  if (cache.cachePath) {
+    console.log('  cache: ' + cache.cachePath);
+  }
+
+  // Module IDs are assigned on demand and rotate 0-126. A URL keeps its ID
+  // until the ID is reused so that reloads produce the same output and hit
+  // the cache.
   var nextModuleId = 0;
-  function injectStream(url, source, target) {
+  var moduleIds = {};
+  var moduleUrls = [];
+  function getModuleId(url) {
+    if (url in moduleIds) {
+      return moduleIds[url];
+    }
     var moduleId = nextModuleId++;
     if (nextModuleId >= 127) {
       nextModuleId = 0;
     }
+    if (moduleUrls[moduleId] !== undefined) {
+      delete moduleIds[moduleUrls[moduleId]];
+    }
+    moduleUrls[moduleId] = url;
+    moduleIds[url] = moduleId;
+    return moduleId;
+  };
+
+  // Injects a node stream by buffering all data, transforming it, and writing
+  // it back out.
+  function injectStream(url, source, target) {
+    var moduleId = getModuleId(url);
     var sourceCode = '';
     source.on('data', function(chunk) {
       sourceCode += chunk;
     });
     source.on('end', function() {
-      try {
-        var targetCode = transformCode(moduleId, url, sourceCode, argv);
-        target.end(targetCode);
-      } catch (e) {
-        console.log('Error during transformation, writing through.');
-        console.log(e);
-        target.end(sourceCode);
-      }
+      instrumentCode(cache, pool, moduleId, url, sourceCode, argv,
+          function(err, targetCode) {
+            if (err) {
+              console.log('Error during transformation, writing through.');
+              console.log(err);
+              target.end(sourceCode);
+              return;
+            }
+            target.end(targetCode);
+          });
     });
   };
 
@@ -667,7 +1097,9 @@ function getHttpsCerts(callback) {
 
 
 function main(argv) {
-  if (argv['server']) {
+  if (argv['worker']) {
+    runWorker();
+  } else if (argv['server']) {
     // TODO(benvanik): read ports from args/etc
     getHttpsCerts(function(certs) {
       startServer(argv, argv['http-port'], argv['https-port'], certs);
@@ -714,10 +1146,46 @@ main(optimist
       type: 'string',
       desc: 'Don\'t trace functions with this name.'
     })
+    .options('b', {
+      alias: 'budget',
+      type: 'string',
+      default: 0,
+      desc: 'Record at most this many calls of each function (0 = all).'
+    })
+    .options('t', {
+      alias: 'min-time',
+      type: 'string',
+      default: 0,
+      desc: 'Drop calls that take less than this many microseconds and ' +
+          'record no children.'
+    })
+    .options('j', {
+      alias: 'jobs',
+      type: 'string',
+      default: os.cpus().length,
+      desc: 'Number of processes to transform with in server mode.'
+    })
+    .options('cache', {
+      type: 'boolean',
+      default: true,
+      desc: 'Cache transformed code on disk (use --no-cache to disable).'
+    })
+    .options('cache-dir', {
+      type: 'string',
+      desc: 'Cache directory. Defaults to a directory under the temp path.'
+    })
+    .options('worker', {
+      type: 'boolean',
+      default: false,
+      desc: 'Internal: run as a transform worker.'
+    })
     .check(function(argv) {
       if (argv['help']) {
         throw '';
       }
+      if (argv['worker']) {
+        return true;
+      }
       if (argv['server']) {
         // Assert no files passed too.
         if (argv._.length) {
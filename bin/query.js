@@ -27,8 +27,30 @@ toolRunner.launch(runTool);
  * @param {function(number)} done Call to end the program with a return code.
  */
 function runTool(platform, args, done) {
+  // Window options limit what is loaded, for traces too large to load whole.
+  var loadOptions = null;
+  while (args.length && args[0].indexOf('--') == 0) {
+    var option = args.shift().substr(2).split('=');
+    loadOptions = loadOptions || {};
+    switch (option[0]) {
+      case 'start':
+        loadOptions['startTime'] = Number(option[1]);
+        break;
+      case 'end':
+        loadOptions['endTime'] = Number(option[1]);
+        break;
+      case 'zone':
+        loadOptions['zones'] = loadOptions['zones'] || [];
+        loadOptions['zones'].push(option[1]);
+        break;
+    }
+  }
+
   if (args.length < 1) {
-    console.log('usage: query.js file.wtf-trace "[query string]"');
+    console.log('usage: query.js [--start=ms] [--end=ms] [--zone=name] ' +
+        'file.wtf-trace "[query string]"');
+    console.log('       query "jank [percentile]" to list the scopes in ' +
+        'the slowest frames');
     done(1);
     return;
   }
@@ -41,7 +63,7 @@ function runTool(platform, args, done) {
 
   // Create database for querying.
   var loadStart = wtf.now();
-  wtf.db.load(inputFile, function(db) {
+  var loaded = function(db) {
     if (db instanceof Error) {
       console.log('ERROR: unable to open ' + inputFile, db);
       done(1);
@@ -55,7 +77,12 @@ function runTool(platform, args, done) {
     queryDatabase(db);
 
     done(0);
-  });
+  };
+  if (loadOptions) {
+    wtf.db.loadPaged(inputFile, loadOptions, loaded);
+  } else {
+    wtf.db.load(inputFile, loaded);
+  }
 };
 
 
@@ -97,6 +124,13 @@ function queryDatabase(db) {
   rl.prompt();
 
   function issue(expr) {
+    // 'jank [percentile]' lists what ran in the slowest frames.
+    var jankMatch = /^jank(?:\s+([\d.]+))?$/.exec(expr);
+    if (jankMatch) {
+      logJank(zone, jankMatch[1] ? Number(jankMatch[1]) : 99);
+      return;
+    }
+
     console.log('Expression: ' + expr);
 
     var result;
@@ -146,6 +180,40 @@ function queryDatabase(db) {
 };
 
 
+/**
+ * Logs the scopes that took the most time in the slowest frames of a zone.
+ * @param {!wtf.db.Zone} zone Zone.
+ * @param {number} percentile Frame duration percentile.
+ */
+function logJank(zone, percentile) {
+  var frameList = zone.getFrameList();
+  var statistics = frameList.getStatistics();
+  if (!statistics.getCount()) {
+    console.log('No frames');
+    return;
+  }
+
+  console.log('Frames: ' + statistics.getCount() +
+      ', p50 ' + statistics.getPercentile(50).toFixed(3) + 'ms' +
+      ', p90 ' + statistics.getPercentile(90).toFixed(3) + 'ms' +
+      ', p99 ' + statistics.getPercentile(99).toFixed(3) + 'ms');
+  var slowFrames = frameList.getSlowFrames(percentile);
+  console.log('Frames at or over p' + percentile + ' (>= ' +
+      statistics.getPercentile(percentile).toFixed(3) + 'ms): ' +
+      slowFrames.length);
+  console.log('');
+
+  var hotspots = statistics.getHotspots(percentile, 20);
+  for (var n = 0; n < hotspots.length; n++) {
+    var entry = hotspots[n];
+    console.log(
+        util.pad(entry.getOwnTime().toFixed(3) + 'ms', 12) + ' ' +
+        util.pad(entry.getFrameCount() + ' frames', 12) + ' ' +
+        entry.getEventType().getName());
+  }
+};
+
+
 function logResult(resultValue) {
   if (typeof resultValue == 'boolean' ||
       typeof resultValue == 'number' ||
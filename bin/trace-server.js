@@ -10,6 +10,28 @@
  * @fileoverview Trace storage server.
  * Accepts POSTs of trace files for saving to the local disk.
  *
+ * Streaming clients create a stream and then append data to it:
+ *   POST /session/<session>/stream/<stream>/create
+ *   POST /session/<session>/stream/<stream>/append?offset=N
+ *   POST /session/<session>/stream/<stream>/close
+ * Appended data is piped straight into an append-only file per stream, stored
+ * as '<session>/<stream>.wtf-trace'. For binary streams the chunk headers are
+ * scanned as the data passes through to build a chunk index, stored next to
+ * the trace as '<trace>.index'.
+ *
+ * Each append carries the stream offset the client expects it to start at, so
+ * that retried requests are never written twice. An append whose data is
+ * already committed is acknowledged without being written again, and any
+ * other mismatch is rejected with a 409 whose body is the committed size.
+ * Creating an existing stream clears it.
+ *
+ * Stored and live streams can be read back with:
+ *   GET /sessions
+ *   GET /session/<session>/stream/<stream>[?offset=N][&follow=1]
+ *   GET /session/<session>/stream/<stream>/index
+ * or over a WebSocket on the same port by sending a 'subscribe' command. In
+ * follow mode data is sent to viewers as it is appended.
+ *
  * @author benvanik@google.com (Ben Vanik)
  */
 
@@ -20,61 +42,1111 @@ var optimist = require('optimist');
 var os = require('os');
 var path = require('path');
 var url = require('url');
+var ws = require('ws');
 
 
+/**
+ * Size of the magic header at the start of binary streams, in bytes.
+ * @type {number}
+ */
+var BINARY_HEADER_LENGTH = 12;
 
-function main(argv) {
-  var httpPort = argv['http-port'];
-  var storagePath = argv['path'];
-  console.log('Launching trace server...');
-  console.log('   http: ' + httpPort);
-  console.log('   path: ' + storagePath);
 
-  mkdirp.sync(storagePath);
+/**
+ * Magic value at the start of binary streams.
+ * @type {number}
+ */
+var BINARY_MAGIC = 0xDEADBEEF;
+
+
+/**
+ * Number of chunk header bytes needed to index a chunk: id, type, length,
+ * start time, end time.
+ * @type {number}
+ */
+var CHUNK_HEADER_LENGTH = 20;
+
+
+/**
+ * Size of each entry in index files, in bytes. The layout matches the entries
+ * of the chunk index chunk: id, type, offset, length, start time.
+ * @type {number}
+ */
+var INDEX_ENTRY_LENGTH = 20;
+
+
+/**
+ * Valid session and stream IDs.
+ * @type {!RegExp}
+ */
+var ID_PATTERN = /^[A-Za-z0-9_\-]+$/;
+
+
+
+/**
+ * Builds a chunk index by scanning binary stream data as it is written.
+ * Only the chunk headers are examined and no stream data is retained.
+ * @param {string} indexPath Path of the index file.
+ * @constructor
+ */
+var ChunkIndexer = function(indexPath) {
+  /**
+   * Path of the index file.
+   * @type {string}
+   */
+  this.indexPath = indexPath;
+
+  /**
+   * Indexed chunks.
+   * @type {!Array.<!Object>}
+   */
+  this.entries = [];
+
+  /**
+   * Whether the stream could not be indexed (not binary or corrupt).
+   * @type {boolean}
+   */
+  this.failed = false;
+
+  /**
+   * Stream offset of the next byte to be scanned.
+   * @type {number}
+   * @private
+   */
+  this.offset_ = 0;
+
+  /**
+   * Stream offset of the next chunk header.
+   * @type {number}
+   * @private
+   */
+  this.nextChunkOffset_ = BINARY_HEADER_LENGTH;
 
-  function handleGet(req, res, url) {
-  res.writeHead(200, ['Content-Type', 'text/plain']);
-    res.end('get');
+  /**
+   * Chunk header being assembled, as it may span writes.
+   * @type {!Buffer}
+   * @private
+   */
+  this.header_ = new Buffer(CHUNK_HEADER_LENGTH);
+
+  /**
+   * Number of bytes in {@see #header_}.
+   * @type {number}
+   * @private
+   */
+  this.headerLength_ = 0;
+
+  /**
+   * Index entries not yet written to the index file.
+   * @type {!Array.<!Buffer>}
+   * @private
+   */
+  this.pendingEntries_ = [];
+
+  /**
+   * Scanning state saved by {@see #checkpoint}.
+   * @type {Object}
+   * @private
+   */
+  this.checkpoint_ = null;
+
+  /**
+   * Index file writes waiting for the one in progress, in order. Null entries
+   * truncate the file.
+   * @type {!Array.<Buffer>}
+   * @private
+   */
+  this.writeQueue_ = [];
+
+  /**
+   * Whether an index file write is in progress.
+   * @type {boolean}
+   * @private
+   */
+  this.writing_ = false;
+};
+
+
+/**
+ * Resumes indexing an existing stream from its index file.
+ * @param {number} size Current size of the stream file.
+ */
+ChunkIndexer.prototype.resume = function(size) {
+  this.offset_ = size;
+  if (!size) {
+    return;
+  }
+  var data = fs.existsSync(this.indexPath) ?
+      fs.readFileSync(this.indexPath) : new Buffer(0);
+  var count = Math.floor(data.length / INDEX_ENTRY_LENGTH);
+  for (var n = 0; n < count; n++) {
+    var o = n * INDEX_ENTRY_LENGTH;
+    this.entries.push({
+      'chunkId': data.readUInt32LE(o + 0),
+      'chunkType': data.readUInt32LE(o + 4),
+      'offset': data.readUInt32LE(o + 8),
+      'length': data.readUInt32LE(o + 12),
+      'startTime': data.readUInt32LE(o + 16)
+    });
+  }
+  if (count) {
+    var last = this.entries[count - 1];
+    this.nextChunkOffset_ = last['offset'] + last['length'];
+  }
+  if (this.nextChunkOffset_ != size) {
+    // The stream ended mid-chunk; there is no way to resync.
+    this.failed = true;
+  }
+};
+
+
+/**
+ * Scans data appended to the stream.
+ * @param {!Buffer} data Data, starting at the current end of the stream.
+ */
+ChunkIndexer.prototype.scan = function(data) {
+  if (this.failed) {
+    return;
+  }
+  if (this.offset_ == 0 &&
+      (data.length < 4 || data.readUInt32LE(0) != BINARY_MAGIC)) {
+    this.failed = true;
+    return;
+  }
+
+  var pos = 0;
+  while (pos < data.length) {
+    // Skip chunk bodies.
+    if (this.offset_ + pos < this.nextChunkOffset_) {
+      pos = Math.min(data.length, this.nextChunkOffset_ - this.offset_);
+      continue;
+    }
+
+    // Gather the header.
+    var take = Math.min(
+        CHUNK_HEADER_LENGTH - this.headerLength_, data.length - pos);
+    data.copy(this.header_, this.headerLength_, pos, pos + take);
+    this.headerLength_ += take;
+    pos += take;
+    if (this.headerLength_ < CHUNK_HEADER_LENGTH) {
+      break;
+    }
+    this.headerLength_ = 0;
+
+    var header = this.header_;
+    var length = header.readUInt32LE(8);
+    if (length < CHUNK_HEADER_LENGTH + 4 || length % 4) {
+      console.log('Corrupt chunk at ' + this.nextChunkOffset_ + ', ' +
+          'no longer indexing ' + this.indexPath);
+      this.failed = true;
+      return;
+    }
+    var entry = {
+      'chunkId': header.readUInt32LE(0),
+      'chunkType': header.readUInt32LE(4),
+      'offset': this.nextChunkOffset_,
+      'length': length,
+      'startTime': header.readUInt32LE(12)
+    };
+    this.entries.push(entry);
+
+    var entryData = new Buffer(INDEX_ENTRY_LENGTH);
+    entryData.writeUInt32LE(entry['chunkId'], 0);
+    entryData.writeUInt32LE(entry['chunkType'], 4);
+    entryData.writeUInt32LE(entry['offset'], 8);
+    entryData.writeUInt32LE(entry['length'], 12);
+    entryData.writeUInt32LE(entry['startTime'], 16);
+    this.pendingEntries_.push(entryData);
+
+    this.nextChunkOffset_ += length;
+  }
+  this.offset_ += data.length;
+};
+
+
+/**
+ * Saves the scanning state so that data scanned after this can be discarded
+ * with {@see #rollback}.
+ */
+ChunkIndexer.prototype.checkpoint = function() {
+  this.checkpoint_ = {
+    failed: this.failed,
+    entryCount: this.entries.length,
+    offset: this.offset_,
+    nextChunkOffset: this.nextChunkOffset_,
+    header: new Buffer(this.header_),
+    headerLength: this.headerLength_
   };
+};
+
 
-  function handlePost(req, res, url) {
-    var filename = req.headers['x-filename'] || null;
-    if (filename) {
-      filename = path.basename(filename);
+/**
+ * Discards all data scanned since the last {@see #checkpoint}.
+ * Entries not yet flushed are dropped.
+ */
+ChunkIndexer.prototype.rollback = function() {
+  var checkpoint = this.checkpoint_;
+  if (!checkpoint) {
+    return;
+  }
+  this.failed = checkpoint.failed;
+  this.entries.length = checkpoint.entryCount;
+  this.offset_ = checkpoint.offset;
+  this.nextChunkOffset_ = checkpoint.nextChunkOffset;
+  checkpoint.header.copy(this.header_);
+  this.headerLength_ = checkpoint.headerLength;
+  this.pendingEntries_ = [];
+};
+
+
+/**
+ * Discards all indexed chunks and clears the index file.
+ */
+ChunkIndexer.prototype.reset = function() {
+  this.entries.length = 0;
+  this.failed = false;
+  this.offset_ = 0;
+  this.nextChunkOffset_ = BINARY_HEADER_LENGTH;
+  this.headerLength_ = 0;
+  this.pendingEntries_ = [];
+  this.checkpoint_ = null;
+  this.queueWrite_(null);
+};
+
+
+/**
+ * Writes any new index entries to the index file.
+ */
+ChunkIndexer.prototype.flush = function() {
+  if (!this.pendingEntries_.length) {
+    return;
+  }
+  var data = Buffer.concat(this.pendingEntries_);
+  this.pendingEntries_ = [];
+  this.queueWrite_(data);
+};
+
+
+/**
+ * Queues a write to the index file.
+ * Writes are issued one at a time so that entries land in order.
+ * @param {Buffer} data Data to append, or null to truncate the file.
+ * @private
+ */
+ChunkIndexer.prototype.queueWrite_ = function(data) {
+  this.writeQueue_.push(data);
+  if (this.writing_) {
+    return;
+  }
+  this.writing_ = true;
+  var self = this;
+  function writeNext() {
+    if (!self.writeQueue_.length) {
+      self.writing_ = false;
+      return;
+    }
+    var next = self.writeQueue_.shift();
+    var callback = function(err) {
+      if (err) {
+        console.log('Unable to write index: ' + err);
+      }
+      writeNext();
+    };
+    if (next) {
+      fs.appendFile(self.indexPath, next, callback);
     } else {
-      filename = 'trace.wtf-trace';
+      fs.writeFile(self.indexPath, new Buffer(0), callback);
+    }
+  };
+  writeNext();
+};
+
+
+
+/**
+ * A reader sending stream data to an HTTP response or a WebSocket.
+ * Data is read from the stream file in pieces and the next piece is only read
+ * once the previous one has been sent, so slow viewers do not cause data to
+ * be buffered in memory.
+ * @param {!TraceStream} stream Stream being read.
+ * @param {number} offset Byte offset to start reading at.
+ * @param {boolean} follow Whether to keep sending data as it is appended.
+ * @param {function(!Buffer, function(Error=))} write Sends data and calls back
+ *     when more can be sent, or with an error if the send failed.
+ * @param {function()} end Ends the output.
+ * @constructor
+ */
+var Viewer = function(stream, offset, follow, write, end) {
+  this.stream = stream;
+  this.offset = offset;
+  this.follow = follow;
+  this.write = write;
+  this.end = end;
+
+  /**
+   * Whether a read is in progress.
+   * @type {boolean}
+   */
+  this.reading = false;
+
+  /**
+   * Whether the viewer has been closed.
+   * @type {boolean}
+   */
+  this.closed = false;
+
+  /**
+   * File read stream of the read in progress, if any.
+   * @type {fs.ReadStream}
+   * @private
+   */
+  this.readStream_ = null;
+};
+
+
+/**
+ * Sends any data between the viewer offset and the end of the stream.
+ */
+Viewer.prototype.pump = function() {
+  if (this.reading || this.closed) {
+    return;
+  }
+  var size = this.stream.committedSize;
+  if (this.offset >= size) {
+    if (!this.follow || this.stream.closed) {
+      this.close();
     }
+    return;
+  }
 
-    var filePath = path.join(storagePath, filename);
-    var file = fs.createWriteStream(filePath);
-    console.log('Writing trace to ' + filePath + '...');
+  this.reading = true;
+  var readStream = fs.createReadStream(this.stream.filePath, {
+    start: this.offset,
+    end: size - 1
+  });
+  this.readStream_ = readStream;
+  readStream.on('data', (function(data) {
+    this.offset += data.length;
+    readStream.pause();
+    this.write(data, (function(err) {
+      if (err) {
+        console.log('Send error: ' + err);
+        this.close();
+      } else if (!this.closed) {
+        readStream.resume();
+      }
+    }).bind(this));
+  }).bind(this));
+  readStream.on('error', (function(err) {
+    console.log('Read error: ' + err);
+    this.close();
+  }).bind(this));
+  readStream.on('end', (function() {
+    if (this.readStream_ == readStream) {
+      this.readStream_ = null;
+      this.reading = false;
+      this.pump();
+    }
+  }).bind(this));
+};
+
+
+/**
+ * Closes the viewer and ends its output.
+ */
+Viewer.prototype.close = function() {
+  if (this.closed) {
+    return;
+  }
+  this.closed = true;
+  if (this.readStream_) {
+    this.readStream_.destroy();
+    this.readStream_ = null;
+  }
+  this.reading = false;
+  this.stream.removeViewer(this);
+  this.end();
+};
+
+
+
+/**
+ * A trace stream written by a streaming client.
+ * @param {string} storagePath Storage root path.
+ * @param {string} sessionId Session ID.
+ * @param {string} streamId Stream ID.
+ * @param {number} idleTimeout Milliseconds without appends before the file is
+ *     closed. It is reopened on the next append.
+ * @constructor
+ */
+var TraceStream = function(storagePath, sessionId, streamId, idleTimeout) {
+  this.sessionId = sessionId;
+  this.streamId = streamId;
+  this.filePath = path.join(
+      storagePath, sessionId, streamId + '.wtf-trace');
+  this.idleTimeout = idleTimeout;
+
+  /**
+   * Number of bytes that have been written to the file.
+   * @type {number}
+   */
+  this.committedSize = fs.existsSync(this.filePath) ?
+      fs.statSync(this.filePath).size : 0;
+
+  /**
+   * Whether the client has closed the stream.
+   * @type {boolean}
+   */
+  this.closed = false;
+
+  /**
+   * Chunk indexer.
+   * @type {!ChunkIndexer}
+   */
+  this.indexer = new ChunkIndexer(this.filePath + '.index');
+  this.indexer.resume(this.committedSize);
 
-    req.pipe(file);
+  /**
+   * Connected viewers.
+   * @type {!Array.<!Viewer>}
+   */
+  this.viewers = [];
 
-    req.on('end', function() {
-      console.log('Done!');
+  /**
+   * File write stream, if open.
+   * @type {fs.WriteStream}
+   * @private
+   */
+  this.file_ = null;
 
-      res.writeHead(200, ['Content-Type', 'text/plain']);
-      res.end('Done!');
+  /**
+   * Appends waiting for the current one to finish, as [req, res, offset].
+   * @type {!Array.<!Array>}
+   * @private
+   */
+  this.appendQueue_ = [];
+
+  /**
+   * Whether an append is being written.
+   * @type {boolean}
+   * @private
+   */
+  this.appending_ = false;
+
+  /**
+   * Idle close timer.
+   * @type {?number}
+   * @private
+   */
+  this.idleTimer_ = null;
+};
+
+
+/**
+ * Clears the stream so that it can be written again from the start.
+ * @return {boolean} False if the stream is being appended to.
+ */
+TraceStream.prototype.reset = function() {
+  if (this.appending_ || this.appendQueue_.length) {
+    return false;
+  }
+  this.closeFile_();
+  mkdirp.sync(path.dirname(this.filePath));
+  fs.writeFileSync(this.filePath, new Buffer(0));
+  this.committedSize = 0;
+  this.closed = false;
+  this.indexer.reset();
+
+  // Viewers are past the end of the new data.
+  var viewers = this.viewers.slice();
+  for (var n = 0; n < viewers.length; n++) {
+    viewers[n].close();
+  }
+  return true;
+};
+
+
+/**
+ * Appends the body of a request to the stream.
+ * Appends are written in the order they arrive.
+ * @param {!http.IncomingMessage} req Request.
+ * @param {!http.ServerResponse} res Response.
+ * @param {number} offset Stream offset the client expects the data to start
+ *     at, or -1 if not provided.
+ */
+TraceStream.prototype.append = function(req, res, offset) {
+  if (this.appending_) {
+    req.pause();
+    this.appendQueue_.push([req, res, offset]);
+    return;
+  }
+  if (req.aborted || (req.socket && req.socket.destroyed)) {
+    // Disconnected while queued.
+    this.nextAppend_();
+    return;
+  }
+  if (offset != -1 && offset != this.committedSize) {
+    // A retry of the last append that was committed after all is
+    // acknowledged again. Anything else would leave a gap or an overlap.
+    var length = Number(req.headers['content-length']);
+    var committed = !isNaN(length) && offset + length == this.committedSize;
+    req.resume();
+    sendText(res, committed ? 200 : 409, String(this.committedSize));
+    this.nextAppend_();
+    return;
+  }
+  this.appending_ = true;
+  this.closed = false;
+
+  if (!this.file_) {
+    mkdirp.sync(path.dirname(this.filePath));
+    this.file_ = fs.createWriteStream(this.filePath, {
+      flags: 'a'
     });
+    this.file_.on('error', function(err) {
+      console.log('Write error: ' + err);
+    });
+  }
+  if (this.idleTimer_ !== null) {
+    clearTimeout(this.idleTimer_);
+    this.idleTimer_ = null;
+  }
+
+  var file = this.file_;
+  var indexer = this.indexer;
+  indexer.checkpoint();
+  var length = 0;
+  var ended = false;
+  req.on('data', function(data) {
+    indexer.scan(data);
+    length += data.length;
+  });
+  req.on('end', (function() {
+    ended = true;
+    // An empty write completes after all previous writes, at which point the
+    // data can be read back by viewers.
+    file.write(new Buffer(0), (function() {
+      this.committedSize += length;
+      indexer.flush();
+      this.notifyViewers_();
+      sendText(res, 200, 'OK');
+      this.appending_ = false;
+      this.nextAppend_();
+    }).bind(this));
+  }).bind(this));
+  var abort = (function() {
+    if (ended) {
+      return;
+    }
+    ended = true;
+    req.unpipe(file);
+    this.abortAppend_(file);
+    sendText(res, 400, 'Append aborted');
+  }).bind(this);
+  req.on('aborted', abort);
+  req.on('close', abort);
+  req.on('error', abort);
+  req.pipe(file, {
+    end: false
+  });
+  req.resume();
+};
+
+
+/**
+ * Discards the data of an append that did not complete and starts the next
+ * queued append.
+ * Any partial data is truncated from the file so that it ends at the last
+ * committed append, which keeps the file and index in sync with
+ * {@see #committedSize}.
+ * @param {!fs.WriteStream} file File the append was being written to.
+ * @private
+ */
+TraceStream.prototype.abortAppend_ = function(file) {
+  console.log('Append to ' + this.filePath + ' aborted, rolling back to ' +
+      this.committedSize + 'b');
+  this.indexer.rollback();
+
+  // The file is reopened on the next append.
+  if (this.file_ == file) {
+    this.file_ = null;
+  }
+  var finish = (function() {
+    this.appending_ = false;
+    if (this.closed) {
+      this.notifyViewers_();
+    }
+    this.nextAppend_();
+  }).bind(this);
+  file.once('close', (function() {
+    fs.open(this.filePath, 'r+', (function(err, fd) {
+      if (err) {
+        console.log('Unable to roll back: ' + err);
+        finish();
+        return;
+      }
+      fs.ftruncate(fd, this.committedSize, function(err) {
+        if (err) {
+          console.log('Unable to roll back: ' + err);
+        }
+        fs.close(fd, finish);
+      });
+    }).bind(this));
+  }).bind(this));
+  file.end();
+};
+
+
+/**
+ * Starts the next queued append or schedules the file to be closed.
+ * @private
+ */
+TraceStream.prototype.nextAppend_ = function() {
+  if (this.appendQueue_.length) {
+    var next = this.appendQueue_.shift();
+    this.append(next[0], next[1], next[2]);
+    return;
+  }
+  if (this.idleTimer_ !== null) {
+    clearTimeout(this.idleTimer_);
+  }
+  this.idleTimer_ = setTimeout((function() {
+    this.idleTimer_ = null;
+    this.closeFile_();
+  }).bind(this), this.idleTimeout);
+};
+
+
+/**
+ * Closes the file, if open.
+ * @private
+ */
+TraceStream.prototype.closeFile_ = function() {
+  if (this.file_) {
+    this.file_.end();
+    this.file_ = null;
+  }
+};
+
+
+/**
+ * Marks the stream as closed by the client.
+ * Followers are ended once they have read all data.
+ */
+TraceStream.prototype.close = function() {
+  this.closed = true;
+  if (!this.appending_) {
+    if (this.idleTimer_ !== null) {
+      clearTimeout(this.idleTimer_);
+      this.idleTimer_ = null;
+    }
+    this.closeFile_();
+  }
+  this.notifyViewers_();
+};
+
+
+/**
+ * Adds a viewer and starts sending it data.
+ * @param {!Viewer} viewer Viewer.
+ */
+TraceStream.prototype.addViewer = function(viewer) {
+  this.viewers.push(viewer);
+  viewer.pump();
+};
+
+
+/**
+ * Removes a viewer.
+ * @param {!Viewer} viewer Viewer.
+ */
+TraceStream.prototype.removeViewer = function(viewer) {
+  var index = this.viewers.indexOf(viewer);
+  if (index != -1) {
+    this.viewers.splice(index, 1);
+  }
+};
+
+
+/**
+ * Sends new data to all viewers.
+ * @private
+ */
+TraceStream.prototype.notifyViewers_ = function() {
+  var viewers = this.viewers.slice();
+  for (var n = 0; n < viewers.length; n++) {
+    viewers[n].pump();
+  }
+};
+
+
+/**
+ * Gets a JSON description of the stream.
+ * @return {!Object} Stream info.
+ */
+TraceStream.prototype.serialize = function() {
+  return {
+    'session_id': this.sessionId,
+    'stream_id': this.streamId,
+    'size': this.committedSize,
+    'chunk_count': this.indexer.failed ? -1 : this.indexer.entries.length,
+    'closed': this.closed,
+    'viewer_count': this.viewers.length
   };
+};
+
+
+/**
+ * Sends a plain text response.
+ * @param {!http.ServerResponse} res Response.
+ * @param {number} statusCode HTTP status code.
+ * @param {string} text Response text.
+ */
+function sendText(res, statusCode, text) {
+  res.writeHead(statusCode, {
+    'Content-Type': 'text/plain',
+    'Access-Control-Allow-Origin': '*'
+  });
+  res.end(text);
+};
+
+
+/**
+ * Sends a JSON response.
+ * @param {!http.ServerResponse} res Response.
+ * @param {*} value Value to send.
+ */
+function sendJson(res, value) {
+  res.writeHead(200, {
+    'Content-Type': 'application/json',
+    'Access-Control-Allow-Origin': '*'
+  });
+  res.end(JSON.stringify(value));
+};
+
+
+
+/**
+ * Trace server.
+ * @param {!Object} argv Parsed arguments.
+ * @constructor
+ */
+var Server = function(argv) {
+  this.storagePath_ = argv['path'];
+  this.idleTimeout_ = Number(argv['idle-timeout']) * 1000;
+
+  /**
+   * All known streams, by 'session/stream' key.
+   * @type {!Object.<!TraceStream>}
+   * @private
+   */
+  this.streams_ = {};
 
-  var httpServer = http.createServer(function(req, res) {
-    var parsedUrl = url.parse(req.url, true);
-    switch (req.method) {
-      case 'GET':
-        handleGet(req, res, url);
+  mkdirp.sync(this.storagePath_);
+
+  this.httpServer_ = http.createServer(this.handleRequest_.bind(this));
+  this.httpServer_.listen(Number(argv['http-port']));
+
+  this.wsServer_ = new ws.Server({
+    server: this.httpServer_
+  });
+  this.wsServer_.on('connection', this.handleSocket_.bind(this));
+  this.wsServer_.on('error', function(error) {
+    console.log('[WS] Server Error: ' + error);
+  });
+};
+
+
+/**
+ * Gets a stream, optionally creating it.
+ * Streams previously written to disk are picked up again.
+ * @param {string} sessionId Session ID.
+ * @param {string} streamId Stream ID.
+ * @param {boolean} create Whether to create the stream if it does not exist.
+ * @return {TraceStream} Stream, if found or created.
+ */
+Server.prototype.getStream = function(sessionId, streamId, create) {
+  if (!ID_PATTERN.test(sessionId) || !ID_PATTERN.test(streamId)) {
+    return null;
+  }
+  var key = sessionId + '/' + streamId;
+  var stream = this.streams_[key];
+  if (!stream) {
+    stream = new TraceStream(
+        this.storagePath_, sessionId, streamId, this.idleTimeout_);
+    if (!create && !fs.existsSync(stream.filePath)) {
+      return null;
+    }
+    if (!create) {
+      stream.closed = true;
+    }
+    this.streams_[key] = stream;
+  }
+  return stream;
+};
+
+
+/**
+ * Handles an HTTP request.
+ * @param {!http.IncomingMessage} req Request.
+ * @param {!http.ServerResponse} res Response.
+ * @private
+ */
+Server.prototype.handleRequest_ = function(req, res) {
+  var parsedUrl = url.parse(req.url, true);
+  var parts = parsedUrl.pathname.split('/').slice(1);
+  var isStreamUrl =
+      parts[0] == 'session' && parts[2] == 'stream' && parts.length >= 4;
+
+  switch (req.method) {
+    case 'OPTIONS':
+      res.writeHead(200, {
+        'Access-Control-Allow-Origin': '*',
+        'Access-Control-Allow-Methods': 'GET, POST',
+        'Access-Control-Allow-Headers':
+            'Content-Type, X-Filename, X-Trace-Format'
+      });
+      res.end();
+      break;
+    case 'GET':
+      if (parts[0] == 'sessions') {
+        var streams = [];
+        for (var key in this.streams_) {
+          streams.push(this.streams_[key].serialize());
+        }
+        sendJson(res, streams);
+      } else if (isStreamUrl) {
+        this.handleStreamGet_(req, res, parts, parsedUrl.query);
+      } else {
+        sendText(res, 404, 'Not Found');
+      }
+      break;
+    case 'POST':
+      if (isStreamUrl) {
+        this.handleStreamPost_(req, res, parts, parsedUrl.query);
+      } else {
+        this.handleUpload_(req, res);
+      }
+      break;
+    default:
+      sendText(res, 405, 'Invalid Method');
+      break;
+  }
+};
+
+
+/**
+ * Handles a whole-file upload.
+ * @param {!http.IncomingMessage} req Request.
+ * @param {!http.ServerResponse} res Response.
+ * @private
+ */
+Server.prototype.handleUpload_ = function(req, res) {
+  var filename = req.headers['x-filename'] || null;
+  if (filename) {
+    filename = path.basename(filename);
+  } else {
+    filename = 'trace.wtf-trace';
+  }
+
+  var filePath = path.join(this.storagePath_, filename);
+  var file = fs.createWriteStream(filePath);
+  console.log('Writing trace to ' + filePath + '...');
+
+  req.pipe(file);
+
+  req.on('end', function() {
+    console.log('Done!');
+    sendText(res, 200, 'Done!');
+  });
+};
+
+
+/**
+ * Handles streaming client requests.
+ * @param {!http.IncomingMessage} req Request.
+ * @param {!http.ServerResponse} res Response.
+ * @param {!Array.<string>} parts URL path parts.
+ * @param {!Object} query Parsed query string.
+ * @private
+ */
+Server.prototype.handleStreamPost_ = function(req, res, parts, query) {
+  var command = parts[4];
+  var stream = this.getStream(parts[1], parts[3], command == 'create');
+  if (!stream) {
+    req.resume();
+    sendText(res, 404, 'Unknown stream');
+    return;
+  }
+  switch (command) {
+    case 'create':
+      req.resume();
+      if (!stream.reset()) {
+        sendText(res, 409, 'Stream is being appended to');
         break;
-      case 'POST':
-        handlePost(req, res, url);
+      }
+      console.log('[Stream] Created ' + stream.filePath);
+      sendText(res, 200, 'OK');
+      break;
+    case 'append':
+      var offset = query['offset'] !== undefined ?
+          Number(query['offset']) : -1;
+      if (isNaN(offset) || offset < 0) {
+        offset = -1;
+      }
+      stream.append(req, res, offset);
+      break;
+    case 'close':
+      console.log('[Stream] Closed ' + stream.filePath + ' (' +
+          stream.committedSize + 'b)');
+      req.resume();
+      stream.close();
+      sendText(res, 200, 'OK');
+      break;
+    default:
+      req.resume();
+      sendText(res, 404, 'Unknown command');
+      break;
+  }
+};
+
+
+/**
+ * Handles reads of stream data and indices.
+ * @param {!http.IncomingMessage} req Request.
+ * @param {!http.ServerResponse} res Response.
+ * @param {!Array.<string>} parts URL path parts.
+ * @param {!Object} query Parsed query string.
+ * @private
+ */
+Server.prototype.handleStreamGet_ = function(req, res, parts, query) {
+  var stream = this.getStream(parts[1], parts[3], false);
+  if (!stream) {
+    sendText(res, 404, 'Unknown stream');
+    return;
+  }
+
+  if (parts[4] == 'index') {
+    sendJson(res, {
+      'complete': !stream.indexer.failed,
+      'entries': stream.indexer.entries
+    });
+    return;
+  } else if (parts[4]) {
+    sendText(res, 404, 'Not Found');
+    return;
+  }
+
+  res.writeHead(200, {
+    'Content-Type': 'application/x-extension-wtf-trace',
+    'Access-Control-Allow-Origin': '*'
+  });
+  var viewer = new Viewer(
+      stream, Number(query['offset']) || 0, !!query['follow'],
+      function(data, callback) {
+        if (res.write(data)) {
+          callback();
+        } else {
+          res.once('drain', callback);
+        }
+      },
+      function() {
+        res.end();
+      });
+  res.on('close', function() {
+    viewer.close();
+  });
+  stream.addViewer(viewer);
+};
+
+
+/**
+ * Handles a new WebSocket viewer.
+ * Viewers send JSON commands:
+ *   {'command': 'list'} replies with {'command': 'streams', 'streams': [...]}.
+ *   {'command': 'subscribe', 'session_id', 'stream_id', 'offset', 'follow'}
+ *       replies with {'command': 'stream', ...stream info} followed by binary
+ *       messages containing the stream data from the given offset.
+ * @param {!ws.WebSocket} socket Socket.
+ * @private
+ */
+Server.prototype.handleSocket_ = function(socket) {
+  var viewer = null;
+  socket.on('message', (function(message) {
+    var data;
+    try {
+      data = JSON.parse(message);
+    } catch (e) {
+      data = null;
+    }
+    if (!data) {
+      return;
+    }
+    switch (data['command']) {
+      case 'list':
+        var streams = [];
+        for (var key in this.streams_) {
+          streams.push(this.streams_[key].serialize());
+        }
+        socket.send(JSON.stringify({
+          'command': 'streams',
+          'streams': streams
+        }));
         break;
-      default:
-        res.writeHead(405, ['Content-Type', 'text/plain']);
-        res.end('Invalid Method');
+      case 'subscribe':
+        if (viewer) {
+          viewer.close();
+          viewer = null;
+        }
+        var stream = this.getStream(
+            String(data['session_id']), String(data['stream_id']), false);
+        if (!stream) {
+          socket.send(JSON.stringify({
+            'command': 'error',
+            'message': 'Unknown stream'
+          }));
+          return;
+        }
+        var info = stream.serialize();
+        info['command'] = 'stream';
+        socket.send(JSON.stringify(info));
+        viewer = new Viewer(
+            stream, Number(data['offset']) || 0, data['follow'] !== false,
+            function(data, callback) {
+              socket.send(data, {
+                binary: true
+              }, callback);
+            },
+            function() {
+              socket.send(JSON.stringify({
+                'command': 'end'
+              }));
+            });
+        stream.addViewer(viewer);
         break;
     }
+  }).bind(this));
+  socket.on('close', function() {
+    if (viewer) {
+      viewer.end = function() {};
+      viewer.close();
+      viewer = null;
+    }
+  });
+  socket.on('error', function(error) {
+    console.log('[WS] Socket error: ' + error);
   });
-  httpServer.listen(httpPort);
+};
+
+
+function main(argv) {
+  var httpPort = argv['http-port'];
+  var storagePath = argv['path'];
+  console.log('Launching trace server...');
+  console.log('   http: ' + httpPort);
+  console.log('   path: ' + storagePath);
+
+  var server = new Server(argv);
 
   console.log('Server ready, use ctrl-c to exit...');
   console.log('');
@@ -94,6 +1166,11 @@ main(optimist
       default: '/tmp/wtf/traces/',
       desc: 'File system path to store trace files.'
     })
+    .options('idle-timeout', {
+      type: 'string',
+      default: 60,
+      desc: 'Seconds without appends before a stream file is closed.'
+    })
     .check(function(argv) {
       if (argv['help']) {
         throw '';
@@ -485,6 +485,16 @@ Debugger.TIMELINE_DISPATCH_ = (function() {
 })();
 
 
+/**
+ * Maximum number of records retained while waiting for the page to request
+ * them.
+ * @type {number}
+ * @const
+ * @private
+ */
+Debugger.MAX_RECORDS_ = 200000;
+
+
 /**
  * Handles incoming debugger events.
  * @param {string} method Remote debugger method name.
@@ -527,6 +537,12 @@ Debugger.prototype.processTimelineRecord_ = function(record) {
   var dispatch = Debugger.TIMELINE_DISPATCH_[record.type];
   if (dispatch) {
     this.records_.push(dispatch(record));
+
+    // Records are held until the page requests them, so drop the oldest if
+    // it never does.
+    if (this.records_.length > Debugger.MAX_RECORDS_ * 2) {
+      this.records_.splice(0, this.records_.length - Debugger.MAX_RECORDS_);
+    }
   }
 
   // Recursively check children.
@@ -571,3 +587,86 @@ Debugger.prototype.getRecords = function() {
 Debugger.prototype.clearRecords = function() {
   this.records_.length = 0;
 };
+
+
+/**
+ * Encodes all records as WTF binary event buffer data.
+ * Encoding here keeps the page from having to parse and re-emit each record
+ * while it is being traced. The page provides the wire IDs and argument
+ * counts of the event types, as they are only known in the page.
+ *
+ * @param {!Object} encoding Encoding information from the page:
+ *     {@code timebase}: time subtracted from record times, in ms.
+ *     {@code leave}: wire ID of the scope leave event.
+ *     {@code types}: map of record type to [wire ID, is scope, arg count].
+ * @return {Object} The encoded records as {@code buffer} (base64 event
+ *     data), {@code byteLength} and {@code strings} (the string table), or
+ *     null if there are no records.
+ */
+Debugger.prototype.encodeRecords = function(encoding) {
+  var records = this.records_;
+  var timebase = encoding['timebase'];
+  var leaveWireId = encoding['leave'];
+  var types = encoding['types'];
+
+  // Size the buffer: each event is its wire ID, time and arguments, and scopes
+  // have an additional leave event.
+  var wordCount = 0;
+  for (var n = 0; n < records.length; n++) {
+    var type = types[records[n][0]];
+    if (type) {
+      wordCount += 2 + type[2] + (type[1] ? 2 : 0);
+    }
+  }
+  if (!wordCount) {
+    return null;
+  }
+
+  var words = new Int32Array(wordCount);
+  var strings = [];
+  var stringOrdinals = {};
+  var o = 0;
+  for (var n = 0; n < records.length; n++) {
+    var record = records[n];
+    var type = types[record[0]];
+    if (!type) {
+      continue;
+    }
+    var isScope = type[1];
+    words[o++] = type[0];
+    words[o++] = (record[1] - timebase) * 1000;
+    var argOffset = isScope ? 3 : 2;
+    for (var m = 0; m < type[2]; m++) {
+      var value = record[argOffset + m];
+      if (typeof value == 'string') {
+        if (!value.length) {
+          value = -2;
+        } else if (stringOrdinals.hasOwnProperty(value)) {
+          value = stringOrdinals[value];
+        } else {
+          stringOrdinals[value] = strings.length;
+          strings.push(value);
+          value = strings.length - 1;
+        }
+      }
+      words[o++] = value ? value : 0;
+    }
+    if (isScope) {
+      words[o++] = leaveWireId;
+      words[o++] = (record[2] - timebase) * 1000;
+    }
+  }
+
+  // Ports only carry JSON, so the data is sent as base64.
+  var bytes = new Uint8Array(words.buffer);
+  var binary = '';
+  for (var n = 0; n < bytes.length; n += 0x8000) {
+    binary += String.fromCharCode.apply(
+        null, bytes.subarray(n, n + 0x8000));
+  }
+  return {
+    'buffer': btoa(binary),
+    'byteLength': bytes.length,
+    'strings': strings
+  };
+};
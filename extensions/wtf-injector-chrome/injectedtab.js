@@ -92,26 +92,6 @@ var InjectedTab = function(extension, tab, pageOptions, port) {
 
   this.port_.onMessage.addListener(this.eventHandlers_.onMessage);
   this.port_.onDisconnect.addListener(this.eventHandlers_.onDisconnect);
-
-  /**
-   * Periodic timer to transmit debugger data.
-   * @type {number}
-   * @private
-   */
-  this.debuggerTransmitId_ = -1;
-
-  if (this.debugger_) {
-    this.debuggerTransmitId_ = window.setInterval((function() {
-      var records = this.debugger_.getRecords();
-      if (records.length) {
-        this.port_.postMessage(JSON.stringify({
-          'command': 'debugger_data',
-          'records': records
-        }));
-        this.debugger_.clearRecords();
-      }
-    }).bind(this), 1000);
-  }
 };
 
 
@@ -119,10 +99,6 @@ var InjectedTab = function(extension, tab, pageOptions, port) {
  * Cleans up all attached tab resources.
  */
 InjectedTab.prototype.dispose = function() {
-  if (this.debuggerTransmitId_ != -1) {
-    window.clearInterval(this.debuggerTransmitId_);
-  }
-
   this.port_.onMessage.removeListener(this.eventHandlers_.onMessage);
   this.port_.onDisconnect.removeListener(this.eventHandlers_.onDisconnect);
 
@@ -202,11 +178,15 @@ InjectedTab.prototype.messageReceived_ = function(data, port) {
       break;
     case 'get_debugger_data':
       if (this.debugger_) {
-        var records = this.debugger_.getRecords();
+        // Records are held here until the page asks for them, and are sent
+        // down pre-encoded so the page does not have to process them.
+        var encoded = this.debugger_.encodeRecords(data['encoding']);
         this.port_.postMessage(JSON.stringify({
           'command': 'debugger_data',
           'request_id': data['request_id'],
-          'records': records
+          'buffer': encoded ? encoded['buffer'] : null,
+          'byte_length': encoded ? encoded['byteLength'] : 0,
+          'strings': encoded ? encoded['strings'] : null
         }));
         this.debugger_.clearRecords();
       }
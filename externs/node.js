@@ -104,6 +104,18 @@ function Buffer(length) {}
 Buffer.prototype.length;
 
 
+/**
+ * @type {!ArrayBuffer}
+ */
+Buffer.prototype.buffer;
+
+
+/**
+ * @type {number}
+ */
+Buffer.prototype.byteOffset;
+
+
 /**
  * @param {string} value
  * @return {number}
@@ -245,3 +257,58 @@ NodeFsModule.prototype.fsyncSync = function(fd) {};
  */
 NodeFsModule.prototype.writeSync = function(
     fd, buffer, offset, length, position) {};
+
+
+/**
+ * @param {number} fd
+ * @param {!Buffer} buffer
+ * @param {number} offset
+ * @param {number} length
+ * @param {number|null} position
+ * @return {number}
+ */
+NodeFsModule.prototype.readSync = function(
+    fd, buffer, offset, length, position) {};
+
+
+/**
+ * @param {number} fd
+ * @return {!NodeFsStats}
+ */
+NodeFsModule.prototype.fstatSync = function(fd) {};
+
+
+
+/**
+ * @constructor
+ * @noalias
+ */
+var NodeFsStats;
+
+
+/**
+ * @type {number}
+ */
+NodeFsStats.prototype.size;
+
+
+
+/**
+ * @constructor
+ * @noalias
+ */
+var NodeZlibModule;
+
+
+/**
+ * @param {!ArrayBufferView} buffer
+ * @return {!Buffer}
+ */
+NodeZlibModule.prototype.deflateRawSync = function(buffer) {};
+
+
+/**
+ * @param {!ArrayBufferView} buffer
+ * @return {!Buffer}
+ */
+NodeZlibModule.prototype.inflateRawSync = function(buffer) {};
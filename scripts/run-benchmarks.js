@@ -13,6 +13,7 @@
  */
 
 var fs = require('fs');
+var optimist = require('optimist');
 var vm = require('vm');
 
 var benchmark = require('../src/wtf/testing/benchmark');
@@ -22,6 +23,38 @@ global.benchmark = benchmark;
 global.wtf = require('../build-out/wtf_node_js_compiled');
 
 
+var argv = optimist
+    .usage('Run tracing benchmarks.\nUsage: $0 [benchmark names...]')
+    .options('m', {
+      alias: 'mode',
+      type: 'string',
+      default: benchmark.MODES.join(','),
+      desc: 'Comma-separated session modes to run under.'
+    })
+    .options('providers', {
+      type: 'boolean',
+      default: false,
+      desc: 'Enable the instrumentation providers.'
+    })
+    .options('b', {
+      alias: 'baseline',
+      type: 'string',
+      desc: 'Write machine-readable results to the given file.'
+    })
+    .options('c', {
+      alias: 'compare',
+      type: 'string',
+      desc: 'Compare against a baseline file written with --baseline.'
+    })
+    .check(function(argv) {
+      if (argv['help']) {
+        throw '';
+      }
+      return true;
+    })
+    .argv;
+
+
 // Require all benchmark files.
 for (var n = 0; n < benchmarkList.length; n++) {
   var scriptUrl = './test/benchmarks/' + benchmarkList[n];
@@ -29,6 +62,31 @@ for (var n = 0; n < benchmarkList.length; n++) {
 }
 
 
+/**
+ * Version of the baseline file format.
+ * @type {number}
+ */
+var BASELINE_VERSION = 1;
+
+
+/**
+ * Baseline being compared against, if any.
+ * @type {Object}
+ */
+var compareBaseline = null;
+if (argv['compare']) {
+  compareBaseline = JSON.parse(fs.readFileSync(argv['compare'], 'utf8'));
+  if (compareBaseline['version'] != BASELINE_VERSION) {
+    console.log('Baseline ' + argv['compare'] + ' has an unsupported version.');
+    process.exit(1);
+  }
+  if (compareBaseline['providers'] != argv['providers']) {
+    console.log('Warning: baseline was recorded with providers ' +
+        (compareBaseline['providers'] ? 'enabled' : 'disabled') + '.');
+  }
+}
+
+
 function padLeft(value, width) {
   value = String(value);
   while (value.length < width) {
@@ -50,6 +108,37 @@ function padRight(value, width) {
 var PAD_RIGHT = 14;
 
 
+/**
+ * Gets the key of a result in baseline files.
+ * @param {string} benchmarkName Benchmark name.
+ * @param {string} mode Session mode.
+ * @return {string} Result key.
+ */
+function getResultKey(benchmarkName, mode) {
+  return mode + '/' + benchmarkName;
+};
+
+
+/**
+ * Formats the change from the compared baseline.
+ * Changes within the margin of error of either run are marked with '~'.
+ * @param {string} key Result key.
+ * @param {number} meanNs Mean time, in nanoseconds.
+ * @param {number} rme Relative margin of error, in percent.
+ * @return {string} Formatted change or an empty string.
+ */
+function formatChange(key, meanNs, rme) {
+  var baseline = compareBaseline ? compareBaseline['results'][key] : null;
+  if (!baseline || !baseline['meanNs']) {
+    return '';
+  }
+  var change = (meanNs - baseline['meanNs']) / baseline['meanNs'] * 100;
+  var noise = Math.max(rme, baseline['rme']);
+  return (Math.abs(change) <= noise ? '~' : '') +
+      (change > 0 ? '+' : '') + change.toFixed(1) + '%';
+};
+
+
 /**
  * Logs a benchmark error.
  * @param {string} msg Message.
@@ -65,30 +154,77 @@ global.reportBenchmarkError = function(msg, opt_benchmarkName) {
  * Logs a benchmark result.
  * @param {string} benchmarkName Benchmark name.
  * @param {{
+ *   mode: string,
+ *   providers: boolean,
  *   runCount: number,
  *   totalTime: number,
  *   userTime: number,
- *   meanTime: number
+ *   meanTime: number,
+ *   relativeMarginOfError: number
  * }} data Result data.
  */
 global.reportBenchmarkResult = function(benchmarkName, data) {
+  var meanNs = data.meanTime * 1000 * 1000 * 1000;
+  var key = getResultKey(benchmarkName, data.mode);
   console.log(
       padLeft(benchmarkName, 32) + ' ' +
+      padLeft(data.mode, 14) + ' ' +
       padRight(data.runCount, PAD_RIGHT) + ' ' +
       padRight((data.totalTime * 1000).toFixed(3) + 'ms', PAD_RIGHT) + ' ' +
-      padRight((data.meanTime * 1000).toFixed(5) + 'ms', PAD_RIGHT));
+      padRight(meanNs.toFixed(1) + 'ns', PAD_RIGHT) + ' ' +
+      padRight(formatChange(key, meanNs, data.relativeMarginOfError),
+          PAD_RIGHT));
+};
+
+
+/**
+ * Writes a baseline file with the given results.
+ * @param {string} filename Target filename.
+ * @param {!Array.<!Object>} results Results from the benchmark runner.
+ */
+function writeBaseline(filename, results) {
+  var calibration = wtf.trace.calibration;
+  var baseline = {
+    'version': BASELINE_VERSION,
+    'date': new Date().toISOString(),
+    'platform': process.platform + ' ' + process.arch,
+    'runtime': 'node ' + process.version,
+    'providers': argv['providers'],
+    'calibration': calibration ? calibration.getCosts() : null,
+    'results': {}
+  };
+  for (var n = 0; n < results.length; n++) {
+    var result = results[n];
+    baseline['results'][getResultKey(result.name, result.data.mode)] = {
+      'meanNs': result.data.meanTime * 1000 * 1000 * 1000,
+      'rme': result.data.relativeMarginOfError,
+      'runCount': result.data.runCount
+    };
+  }
+  fs.writeFileSync(filename, JSON.stringify(baseline, null, 2));
+  console.log('Wrote baseline to ' + filename);
 };
 
 
 console.log(
       padLeft('[name]', 32) + ' ' +
+      padLeft('[mode]', 14) + ' ' +
       padRight('[count]', PAD_RIGHT) + ' ' +
       padRight('[total]', PAD_RIGHT) + ' ' +
-      padRight('[mean]', PAD_RIGHT));
+      padRight('[mean]', PAD_RIGHT) + ' ' +
+      padRight(compareBaseline ? '[change]' : '', PAD_RIGHT));
 
 
 // Get the list of tests to run.
-var benchmarkNames = process.argv.slice(2);
+var benchmarkNames = argv._.map(String);
 
 // Launch the run.
-benchmark.run(benchmarkNames);
+benchmark.run(benchmarkNames, {
+  modes: argv['mode'].split(','),
+  providers: argv['providers'],
+  onComplete: function(results) {
+    if (argv['baseline']) {
+      writeBaseline(argv['baseline'], results);
+    }
+  }
+});
@@ -24,4 +24,4 @@ fi
 TRACING=""
 #TRACING="--trace-hydrogen --trace-inlining"
 
-node $TRACING ./scripts/run-benchmarks.js $GREP
+node $TRACING ./scripts/run-benchmarks.js "$@"
@@ -41,7 +41,8 @@ wtf.app.HealthDialog = function(db, healthInfo, parentElement, opt_dom) {
   if (healthInfo.getOverheadPerScopeNs()) {
     dom.setTextContent(
         this.getChildElement(goog.getCssName('overheadPerScope')),
-        (healthInfo.getOverheadPerScopeNs() / 1000) + '\u00B5s');
+        (healthInfo.getOverheadPerScopeNs() / 1000) + '\u00B5s' +
+        (healthInfo.isOverheadCalibrated() ? '' : ' (estimated)'));
     dom.setTextContent(
         this.getChildElement(goog.getCssName('totalOverhead')),
         wtf.util.formatSmallTime(healthInfo.getTotalOverheadMs()) + ' ' +
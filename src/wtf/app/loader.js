@@ -29,6 +29,7 @@ goog.require('wtf.db.DriveDataSourceInfo');
 goog.require('wtf.db.UrlDataSourceInfo');
 goog.require('wtf.db.sources.CallsDataSource');
 goog.require('wtf.db.sources.ChunkedDataSource');
+goog.require('wtf.db.sources.WorkerDataSource');
 goog.require('wtf.doc.Document');
 goog.require('wtf.io');
 goog.require('wtf.io.Blob');
@@ -529,6 +530,22 @@ wtf.app.Loader.Entry_.prototype.start = function(db) {
   this.transportDeferred_.addCallback(function(transport) {
     goog.asserts.assert(!this.source);
 
+    // Prefer decoding on a worker so that the UI stays responsive.
+    // The worker sets up its own transport.
+    if (wtf.db.sources.WorkerDataSource.isSupported(this.sourceInfo)) {
+      goog.dispose(transport);
+      this.source = new wtf.db.sources.WorkerDataSource(
+          db, this.sourceInfo, function(loaded, total, processing) {
+            this.task.setProgress(loaded, total);
+            if (processing) {
+              this.task.setStyle(wtf.ui.ProgressDialog.TaskStyle.SECONDARY);
+            }
+          }, this);
+      db.addSource(this.source);
+      this.source.start().chainDeferred(deferred);
+      return;
+    }
+
     // Here be heuristics based on mime type.
     // TODO(benvanik): sniff contents/don't rely on mime type/etc.
     switch (this.sourceInfo.contentType) {
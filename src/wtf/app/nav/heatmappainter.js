@@ -250,13 +250,12 @@ wtf.app.nav.HeatmapPainter.Bar_.prototype.draw = function(
   }
 
   var bucketTimeLeft = timeLeft - timeLeft % bucketDuration;
-  // var bucketTimeRight = bucketTimeLeft + bucketDuration * bucketCount;
+  var bucketTimeRight = bucketTimeLeft + bucketDuration * bucketCount;
 
   var bucketMax = 0;
   for (var n = 0; n < this.indices_.length; n++) {
     var index = this.indices_[n];
-    // TODO(benvanik): limit to bucketTimeLeft, bucketTimeRight
-    var it = index.begin();
+    var it = index.beginTimeRange(bucketTimeLeft, bucketTimeRight);
     for (; !it.done(); it.next()) {
       var bucketIndex = ((it.getTime() - bucketTimeLeft) / bucketDuration) | 0;
       var bucketValue = buckets[bucketIndex];
@@ -22,7 +22,7 @@ goog.require('wtf.app.TabPanel');
 goog.require('wtf.app.query.QueryTableSource');
 goog.require('wtf.app.query.querypanel');
 goog.require('wtf.db.Database');
-goog.require('wtf.db.EventIterator');
+goog.require('wtf.db.QueryCursor');
 goog.require('wtf.db.QueryDumpFormat');
 goog.require('wtf.events');
 goog.require('wtf.events.EventType');
@@ -86,7 +86,7 @@ wtf.app.query.QueryPanel = function(documentView) {
 
   /**
    * Current query results, if any.
-   * @type {wtf.db.QueryResult}
+   * @type {wtf.db.QueryCursor}
    * @private
    */
   this.currentResults_ = null;
@@ -268,7 +268,8 @@ wtf.app.query.QueryPanel.prototype.updateZoneList_ = function() {
 wtf.app.query.QueryPanel.prototype.clear = function() {
   var dom = this.getDom();
 
-  // Clear results.
+  // Clear results, stopping any query still being evaluated.
+  goog.dispose(this.currentResults_);
   this.currentResults_ = null;
   this.table_.setSource(null);
   dom.setTextContent(this.infoEl_, '');
@@ -325,7 +326,7 @@ wtf.app.query.QueryPanel.prototype.issueQuery_ = function(expression) {
   var query;
   var error = null;
   try {
-    query = zone.query(expression);
+    query = zone.createQueryCursor(expression);
   } catch (e) {
     error = e.toString();
   }
@@ -348,25 +349,19 @@ wtf.app.query.QueryPanel.prototype.issueQuery_ = function(expression) {
     goog.dom.classes.remove(buttonEl, goog.getCssName('kDisabled'));
   }
 
-  var result = query.getValue();
-  var count = 0;
-  if (result instanceof wtf.db.EventIterator) {
-    count = result.getCount();
-  } else if (count !== null) {
-    count = 1;
-  }
-
-  // Update info with query stats.
-  dom.setTextContent(this.infoEl_, count + ' hits in ' +
-      wtf.util.formatSmallTime(query.getDuration()));
-
-  // Update the table.
-  if (result instanceof wtf.db.EventIterator) {
-    // Show using table.
-    var tableSource = new wtf.app.query.QueryTableSource(result);
-    tableSource.setUnits(this.db_.getUnits());
-    this.table_.setSource(tableSource);
-  } else {
-    // Show simple result.
-  }
+  // Show using table. Rows fill in as the query is evaluated.
+  var tableSource = new wtf.app.query.QueryTableSource(query);
+  tableSource.setUnits(this.db_.getUnits());
+  this.table_.setSource(tableSource);
+
+  // Update info with query stats as they come in.
+  query.addListener(wtf.db.QueryCursor.EventType.PROGRESS, function() {
+    var text = query.getCount() + ' hits in ' +
+        wtf.util.formatSmallTime(query.getDuration());
+    if (!query.isComplete()) {
+      text += ' (' + Math.floor(query.getProgress() * 100) + '%)';
+    }
+    dom.setTextContent(this.infoEl_, text);
+  }, this);
+  query.start();
 };
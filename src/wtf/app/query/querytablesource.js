@@ -13,6 +13,7 @@
 
 goog.provide('wtf.app.query.QueryTableSource');
 
+goog.require('wtf.db.QueryCursor');
 goog.require('wtf.db.Unit');
 goog.require('wtf.events');
 goog.require('wtf.ui.VirtualTableSource');
@@ -21,12 +22,14 @@ goog.require('wtf.ui.VirtualTableSource');
 
 /**
  * Virtual table data source wrapping the query results.
+ * Rows are read from the cursor only as they are painted, and the row count
+ * follows the cursor as it evaluates.
  *
- * @param {!wtf.db.EventIterator} result Query result.
+ * @param {!wtf.db.QueryCursor} cursor Query results.
  * @constructor
  * @extends {wtf.ui.VirtualTableSource}
  */
-wtf.app.query.QueryTableSource = function(result) {
+wtf.app.query.QueryTableSource = function(cursor) {
   goog.base(this);
 
   /**
@@ -37,12 +40,17 @@ wtf.app.query.QueryTableSource = function(result) {
   this.units_ = wtf.db.Unit.TIME_MILLISECONDS;
 
   /**
-   * All rows.
-   * @type {!wtf.db.EventIterator}
+   * Query results.
+   * @type {!wtf.db.QueryCursor}
    * @private
    */
-  this.result_ = result;
-  this.setRowCount(result.getCount());
+  this.cursor_ = cursor;
+  this.setRowCount(cursor.getCount());
+
+  cursor.addListener(wtf.db.QueryCursor.EventType.PROGRESS, function() {
+    this.setRowCount(cursor.getCount());
+    this.invalidate();
+  }, this);
 };
 goog.inherits(wtf.app.query.QueryTableSource, wtf.ui.VirtualTableSource);
 
@@ -87,7 +95,7 @@ wtf.app.query.QueryTableSource.prototype.paintRowRange = function(
 
   // Draw row contents.
   y = rowOffset;
-  var it = this.result_;
+  var cursor = this.cursor_;
   for (var n = first; n <= last; n++, y += rowHeight) {
     ctx.fillStyle = n % 2 ? '#fafafa' : '#ffffff';
     ctx.fillRect(gutterWidth, y, bounds.width - gutterWidth, rowHeight);
@@ -99,7 +107,7 @@ wtf.app.query.QueryTableSource.prototype.paintRowRange = function(
 
     ctx.fillStyle = 'black';
 
-    it.seek(n);
+    var it = cursor.getEvent(n);
     if (it.isScope() || it.isInstance()) {
       columnTime = it.getTime();
       columnTitle = it.getLongString(true);
@@ -136,8 +144,7 @@ wtf.app.query.QueryTableSource.prototype.paintRowRange = function(
  */
 wtf.app.query.QueryTableSource.prototype.onClick = function(
     row, x, modifiers, bounds) {
-  var it = this.result_;
-  it.seek(row);
+  var it = this.cursor_.getEvent(row);
 
   var startTime = it.getTime();
   var endTime = 0;
@@ -167,8 +174,7 @@ wtf.app.query.QueryTableSource.prototype.onClick = function(
  */
 wtf.app.query.QueryTableSource.prototype.getInfoString = function(
     row, x, bounds) {
-  var it = this.result_;
-  it.seek(row);
+  var it = this.cursor_.getEvent(row);
   return it.getInfoString(this.units_);
 };
 
@@ -50,7 +50,9 @@ wtf.app.tracks.TimeRangePainter = function TimeRangePainter(
       wtf.ui.color.Palette.D3_10);
 
   this.timeRangeList_.addListener(wtf.events.EventType.INVALIDATED,
-      this.requestRepaint, this);
+      this.invalidateTiles, this);
+
+  this.setTileCaching(true);
 };
 goog.inherits(wtf.app.tracks.TimeRangePainter, wtf.ui.RangePainter);
 
@@ -147,7 +149,7 @@ wtf.app.tracks.TimeRangePainter.prototype.repaintInternal = function(
         // Draw bar.
         this.drawRange(level, screenLeft, screenRight, color, 1);
 
-        if (screenWidth > 15) {
+        if (screenWidth > wtf.ui.RangePainter.MIN_LABEL_WIDTH) {
           var y = level * timeRangeHeight;
           this.drawRangeLabel(
               bounds, left, right, screenLeft, screenRight, y + 1, label);
@@ -157,6 +159,15 @@ wtf.app.tracks.TimeRangePainter.prototype.repaintInternal = function(
   // Now blit the nicely rendered ranges onto the screen.
   var y = 0;
   this.endRenderingRanges(bounds, y, timeRangeHeight);
+};
+
+
+/**
+ * @override
+ */
+wtf.app.tracks.TimeRangePainter.prototype.repaintFixedInternal = function(
+    ctx, bounds, tiles) {
+  goog.base(this, 'repaintFixedInternal', ctx, bounds, tiles);
 
   // Draw label on the left.
   this.drawLabel('time ranges');
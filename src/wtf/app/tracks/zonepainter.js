@@ -47,7 +47,7 @@ wtf.app.tracks.ZonePainter = function ZonePainter(canvas, zone, selection) {
    */
   this.selection_ = selection;
   this.selection_.addListener(
-      wtf.events.EventType.INVALIDATED, this.requestRepaint, this);
+      wtf.events.EventType.INVALIDATED, this.invalidateTiles, this);
 
   /**
    * Color palette used for drawing scopes/instances.
@@ -56,6 +56,12 @@ wtf.app.tracks.ZonePainter = function ZonePainter(canvas, zone, selection) {
    */
   this.palette_ = new wtf.ui.color.Palette(
       wtf.ui.color.Palette.SCOPE_COLORS);
+
+  // Events are only ever appended, but new ones can land in any tile.
+  zone.getDatabase().addListener(
+      wtf.events.EventType.INVALIDATED, this.invalidateTiles, this);
+
+  this.setTileCaching(true);
 };
 goog.inherits(wtf.app.tracks.ZonePainter, wtf.ui.RangePainter);
 
@@ -78,6 +84,16 @@ wtf.app.tracks.ZonePainter.SCOPE_HEIGHT_ = 18;
 wtf.app.tracks.ZonePainter.INSTANCE_TIME_WIDTH_ = 0.001;
 
 
+/**
+ * @override
+ */
+wtf.app.tracks.ZonePainter.prototype.disposeInternal = function() {
+  this.zone_.getDatabase().removeListener(
+      wtf.events.EventType.INVALIDATED, this.invalidateTiles, this);
+  goog.base(this, 'disposeInternal');
+};
+
+
 /**
  * @override
  */
@@ -109,8 +125,20 @@ wtf.app.tracks.ZonePainter.prototype.repaintInternal = function(
   this.beginRenderingRanges(bounds, maxDepth + 1);
 
   // Draw events first.
-  var it = eventList.beginTimeRange(timeLeft, timeRight, true);
-  this.drawEvents_(it, bounds, timeLeft, timeRight);
+  // When zoomed out far enough draw from the summary instead of walking all
+  // of the events. Filtering requires looking at each event, so it always
+  // takes the slow path.
+  var summaryLevel = null;
+  if (!this.selection_.hasFilterSpecified() && bounds.width) {
+    var timePerPixel = (timeRight - timeLeft) * 1000 / bounds.width;
+    summaryLevel = this.zone_.getEventSummary().selectLevel(timePerPixel);
+  }
+  if (summaryLevel) {
+    this.drawSummary_(summaryLevel, bounds, timeLeft, timeRight);
+  } else {
+    var it = eventList.beginTimeRange(timeLeft, timeRight, true);
+    this.drawEvents_(it, bounds, timeLeft, timeRight);
+  }
 
   // Now blit the nicely rendered ranges onto the screen.
   var y = 1;
@@ -122,6 +150,92 @@ wtf.app.tracks.ZonePainter.prototype.repaintInternal = function(
 };
 
 
+/**
+ * Draws summarized events to the range renderers.
+ * Each bucket of the summary level is at most a pixel wide and is drawn with
+ * the color of the event that covers most of it.
+ * @param {!wtf.db.EventSummaryLevel} level Summary level.
+ * @param {!goog.math.Rect} bounds Draw bounds.
+ * @param {number} timeLeft Left-most visible time.
+ * @param {number} timeRight Right-most visible time.
+ * @private
+ */
+wtf.app.tracks.ZonePainter.prototype.drawSummary_ = function(
+    level, bounds, timeLeft, timeRight) {
+  var palette = this.palette_;
+  var summary = this.zone_.getEventSummary();
+  var eventList = this.zone_.getEventList();
+  var it = eventList.begin();
+
+  var selectionStart = this.selection_.getTimeStart();
+  var selectionEnd = this.selection_.getTimeEnd();
+
+  // Find the range of visible buckets.
+  var baseTime = summary.getBaseTime();
+  var bucketWidth = level.bucketWidth;
+  var bucketCount = level.bucketCount;
+  var firstBucket = Math.max(0,
+      Math.floor((timeLeft * 1000 - baseTime) / bucketWidth));
+  var lastBucket = Math.min(bucketCount - 1,
+      Math.floor((timeRight * 1000 - baseTime) / bucketWidth));
+
+  var busyTime = level.busyTime;
+  var startTime = level.startTime;
+  var endTime = level.endTime;
+  var dominantEvent = level.dominantEvent;
+  for (var depth = 0; depth < level.depthCount; depth++) {
+    for (var b = firstBucket, i = depth * bucketCount + firstBucket;
+        b <= lastBucket; b++, i++) {
+      var busy = busyTime[i];
+      if (!busy) {
+        continue;
+      }
+      var enterTime = startTime[i] / 1000;
+      var leaveTime = endTime[i] / 1000;
+
+      // Compute screen size and clip with the screen.
+      var left = wtf.math.remap(enterTime,
+          timeLeft, timeRight,
+          bounds.left, bounds.left + bounds.width);
+      var right = wtf.math.remap(leaveTime,
+          timeLeft, timeRight,
+          bounds.left, bounds.left + bounds.width);
+      var screenLeft = bounds.left;
+      if (screenLeft < left) {
+        screenLeft = left;
+      }
+      var screenRight = (bounds.left + bounds.width) - 0.999;
+      if (screenRight > right) {
+        screenRight = right;
+      }
+      if (screenLeft >= screenRight) {
+        continue;
+      }
+
+      // Sparse buckets are drawn fainter, similar to the proxies drawn for
+      // tiny scopes.
+      var alpha = 1;
+      if (enterTime >= selectionEnd || leaveTime <= selectionStart) {
+        alpha = 0.3;
+      } else if (busy < endTime[i] - startTime[i]) {
+        alpha = Math.max(0.3, busy / (endTime[i] - startTime[i]));
+      }
+
+      // Color by the dominant event, caching it on the event as drawEvents_
+      // does.
+      it.seek(dominantEvent[i]);
+      var color = it.getTag();
+      if (!color) {
+        color = palette.getColorForString(it.getName()).toValue();
+        it.setTag(color);
+      }
+
+      this.drawRange(depth, screenLeft, screenRight, color, alpha);
+    }
+  }
+};
+
+
 /**
  * Draw events to the range renderers.
  * @param {!wtf.db.EventIterator} it Event iterator.
@@ -255,7 +369,7 @@ wtf.app.tracks.ZonePainter.prototype.drawEvents_ = function(
 
     this.drawRange(depth, screenLeft, screenRight, color, alpha);
 
-    if (screenWidth > 15) {
+    if (screenWidth > wtf.ui.RangePainter.MIN_LABEL_WIDTH) {
       name = name || it.getName();
       if (!isScope) {
         name = '[' + name + ']';
@@ -325,6 +439,16 @@ wtf.app.tracks.ZonePainter.prototype.hitTest_ = function(x, y, bounds) {
       timeLeft, timeRight);
 
   var eventList = this.zone_.getEventList();
+  var scopeHeight = wtf.app.tracks.ZonePainter.SCOPE_HEIGHT_;
+  var expectedDepth = Math.floor((y - bounds.top) / scopeHeight);
+
+  // Scopes can be found directly with the index.
+  var scopeIt = eventList.getIntervalIndex().getScopeAtTime(
+      time, expectedDepth);
+  if (scopeIt) {
+    return scopeIt.isHidden() ? null : scopeIt;
+  }
+
   var it = eventList.getEventNearTime(time);
   if (!it || it.done()) {
     return null;
@@ -332,8 +456,6 @@ wtf.app.tracks.ZonePainter.prototype.hitTest_ = function(x, y, bounds) {
 
   // If the event is shallower than we expect, definitely not interested.
   // Otherwise, move up until it matches our depth.
-  var scopeHeight = wtf.app.tracks.ZonePainter.SCOPE_HEIGHT_;
-  var expectedDepth = Math.floor((y - bounds.top) / scopeHeight);
   if (it.getDepth() < expectedDepth) {
     return null;
   }
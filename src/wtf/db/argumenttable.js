@@ -0,0 +1,764 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/**
+ * @fileoverview Columnar event argument storage.
+ * Argument values are stored in per-layout columns, where a layout is the
+ * ordered list of argument names and types of an event type. Numeric
+ * arguments are kept in typed arrays and strings are interned into a string
+ * table, so retaining millions of events does not retain millions of objects.
+ * Argument objects are only materialized on request.
+ *
+ * Values that do not fit their declared layout (such as data from JSON
+ * sources or arguments overridden at runtime) are stored as plain objects.
+ *
+ * @author benvanik@google.com (Ben Vanik)
+ */
+
+goog.provide('wtf.db.ArgumentTable');
+goog.provide('wtf.db.ArgumentTableData');
+
+goog.require('wtf.db.ArgumentData');
+
+
+/**
+ * Exported argument table contents in a form that can be posted across
+ * threads.
+ * @typedef {{
+ *   nextId: number,
+ *   layoutOf: !(Uint16Array|Uint32Array),
+ *   rowOf: !Uint32Array,
+ *   objects: !Array.<wtf.db.ArgumentData>,
+ *   strings: !Array.<string>,
+ *   layouts: !Array.<{
+ *     names: !Array.<string>,
+ *     typeNames: !Array.<string>,
+ *     count: number,
+ *     columns: !Array.<!(Array|ArrayBufferView)>
+ *   }>
+ * }}
+ */
+wtf.db.ArgumentTableData;
+
+
+
+/**
+ * Columnar argument table.
+ * Arguments are referenced by IDs allocated by the table. ID 0 is reserved to
+ * mean no arguments.
+ * @constructor
+ */
+wtf.db.ArgumentTable = function() {
+  /**
+   * Next ID to allocate.
+   * @type {number}
+   * @private
+   */
+  this.nextId_ = 1;
+
+  /**
+   * Layout index of each argument ID.
+   * 0 indicates no data and 1 indicates that the arguments are stored as an
+   * object in {@see #objects_}. This is widened to 32 bits if there are more
+   * layouts than fit in 16.
+   * @type {!(Uint16Array|Uint32Array)}
+   * @private
+   */
+  this.layoutOf_ = new Uint16Array(wtf.db.ArgumentTable.INITIAL_CAPACITY_);
+
+  /**
+   * Row in the layout of each argument ID.
+   * @type {!Uint32Array}
+   * @private
+   */
+  this.rowOf_ = new Uint32Array(wtf.db.ArgumentTable.INITIAL_CAPACITY_);
+
+  /**
+   * Argument objects that could not be stored in columns.
+   * @type {!Array.<wtf.db.ArgumentData>}
+   * @private
+   */
+  this.objects_ = [];
+
+  /**
+   * Number of argument IDs stored in {@see #objects_}.
+   * @type {number}
+   * @private
+   */
+  this.liveObjectCount_ = 0;
+
+  /**
+   * Interned strings. Index 0 is reserved.
+   * @type {!Array.<string>}
+   * @private
+   */
+  this.strings_ = [''];
+
+  /**
+   * Map of string to its index in {@see #strings_}.
+   * @type {!Object.<number>}
+   * @private
+   */
+  this.stringIds_ = Object.create(null);
+
+  /**
+   * All layouts, indexed by layout index. The first two are reserved.
+   * @type {!Array.<wtf.db.ArgumentTable.Layout_>}
+   * @private
+   */
+  this.layouts_ = [null, null];
+
+  /**
+   * Layout indices keyed by layout key.
+   * @type {!Object.<number>}
+   * @private
+   */
+  this.layoutsByKey_ = {};
+
+  /**
+   * Layout indices keyed by event type ID, used to avoid building keys on
+   * each insert.
+   * @type {!Array.<number>}
+   * @private
+   */
+  this.layoutsByTypeId_ = [];
+};
+
+
+/**
+ * Initial ID capacity.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.db.ArgumentTable.INITIAL_CAPACITY_ = 1024;
+
+
+/**
+ * Layout index for arguments stored as objects.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.db.ArgumentTable.OBJECT_LAYOUT_ = 1;
+
+
+/**
+ * Column storage kinds.
+ * @enum {number}
+ * @private
+ */
+wtf.db.ArgumentTable.ColumnKind_ = {
+  NUMBER: 0,
+  BOOL: 1,
+  STRING: 2,
+  OBJECT: 3
+};
+
+
+/**
+ * Typed array constructors for numeric argument types.
+ * @type {!Object.<function(new:ArrayBufferView, number)>}
+ * @private
+ */
+wtf.db.ArgumentTable.NUMBER_COLUMNS_ = {
+  'int8': Int8Array,
+  'uint8': Uint8Array,
+  'int16': Int16Array,
+  'uint16': Uint16Array,
+  'int32': Int32Array,
+  'uint32': Uint32Array,
+  'float32': Float32Array
+};
+
+
+/**
+ * Gets the column kind used to store the given argument type.
+ * @param {string} typeName Argument type name.
+ * @return {wtf.db.ArgumentTable.ColumnKind_} Column kind.
+ * @private
+ */
+wtf.db.ArgumentTable.getColumnKind_ = function(typeName) {
+  if (wtf.db.ArgumentTable.NUMBER_COLUMNS_[typeName]) {
+    return wtf.db.ArgumentTable.ColumnKind_.NUMBER;
+  }
+  switch (typeName) {
+    case 'bool':
+      return wtf.db.ArgumentTable.ColumnKind_.BOOL;
+    case 'ascii':
+    case 'utf8':
+    case 'char':
+    case 'wchar':
+      return wtf.db.ArgumentTable.ColumnKind_.STRING;
+    default:
+      return wtf.db.ArgumentTable.ColumnKind_.OBJECT;
+  }
+};
+
+
+
+/**
+ * Column storage for all arguments sharing a layout.
+ * @param {!Array.<string>} names Argument names.
+ * @param {!Array.<string>} typeNames Argument type names.
+ * @constructor
+ * @private
+ */
+wtf.db.ArgumentTable.Layout_ = function(names, typeNames) {
+  /**
+   * Argument names, in order.
+   * @type {!Array.<string>}
+   */
+  this.names = names;
+
+  /**
+   * Argument type names, in order.
+   * @type {!Array.<string>}
+   */
+  this.typeNames = typeNames;
+
+  /**
+   * Column index keyed by argument name.
+   * @type {!Object.<number>}
+   */
+  this.columnIndices = {};
+
+  /**
+   * Storage kind of each column.
+   * @type {!Array.<wtf.db.ArgumentTable.ColumnKind_>}
+   */
+  this.kinds = [];
+
+  /**
+   * Column values. Strings are stored as string table indices.
+   * @type {!Array.<!(Array|ArrayBufferView)>}
+   */
+  this.columns = [];
+
+  /**
+   * Number of rows in use.
+   * @type {number}
+   */
+  this.count = 0;
+
+  /**
+   * Number of rows allocated.
+   * @type {number}
+   */
+  this.capacity = 0;
+
+  /**
+   * Number of rows still referenced by an argument ID.
+   * When this drops to zero the column storage is released.
+   * @type {number}
+   */
+  this.liveCount = 0;
+
+  for (var n = 0; n < names.length; n++) {
+    this.columnIndices[names[n]] = n;
+    this.kinds.push(wtf.db.ArgumentTable.getColumnKind_(typeNames[n]));
+    this.columns.push(this.allocateColumn_(n, 0));
+  }
+};
+
+
+/**
+ * Allocates storage for a column.
+ * @param {number} index Column index.
+ * @param {number} capacity Row capacity.
+ * @return {!(Array|ArrayBufferView)} Column storage.
+ * @private
+ */
+wtf.db.ArgumentTable.Layout_.prototype.allocateColumn_ = function(
+    index, capacity) {
+  switch (this.kinds[index]) {
+    case wtf.db.ArgumentTable.ColumnKind_.NUMBER:
+      var ctor = wtf.db.ArgumentTable.NUMBER_COLUMNS_[this.typeNames[index]];
+      return new ctor(capacity);
+    case wtf.db.ArgumentTable.ColumnKind_.BOOL:
+      return new Uint8Array(capacity);
+    case wtf.db.ArgumentTable.ColumnKind_.STRING:
+      return new Uint32Array(capacity);
+    default:
+      return [];
+  }
+};
+
+
+/**
+ * Removes all rows and releases the column storage.
+ * @private
+ */
+wtf.db.ArgumentTable.Layout_.prototype.reset_ = function() {
+  for (var n = 0; n < this.columns.length; n++) {
+    this.columns[n] = this.allocateColumn_(n, 0);
+  }
+  this.count = 0;
+  this.capacity = 0;
+};
+
+
+/**
+ * Ensures there is room for another row.
+ * @private
+ */
+wtf.db.ArgumentTable.Layout_.prototype.ensureCapacity_ = function() {
+  if (this.count < this.capacity) {
+    return;
+  }
+  var newCapacity = Math.max(64, this.capacity * 2);
+  for (var n = 0; n < this.columns.length; n++) {
+    var column = this.columns[n];
+    if (this.kinds[n] != wtf.db.ArgumentTable.ColumnKind_.OBJECT) {
+      var newColumn = this.allocateColumn_(n, newCapacity);
+      newColumn.set(column);
+      this.columns[n] = newColumn;
+    }
+  }
+  this.capacity = newCapacity;
+};
+
+
+/**
+ * Allocates an argument ID.
+ * @return {number} New ID.
+ * @private
+ */
+wtf.db.ArgumentTable.prototype.allocateId_ = function() {
+  var id = this.nextId_++;
+  if (id >= this.layoutOf_.length) {
+    this.reallocateLayoutOf_(
+        this.layoutOf_.length * 2, this.layoutOf_ instanceof Uint32Array);
+    var newRowOf = new Uint32Array(this.rowOf_.length * 2);
+    newRowOf.set(this.rowOf_);
+    this.rowOf_ = newRowOf;
+  }
+  return id;
+};
+
+
+/**
+ * Reallocates the layout index of each argument ID.
+ * @param {number} capacity New ID capacity.
+ * @param {boolean} wide Whether layout indices need more than 16 bits.
+ * @private
+ */
+wtf.db.ArgumentTable.prototype.reallocateLayoutOf_ = function(
+    capacity, wide) {
+  var newLayoutOf = wide ?
+      new Uint32Array(capacity) : new Uint16Array(capacity);
+  newLayoutOf.set(this.layoutOf_);
+  this.layoutOf_ = newLayoutOf;
+};
+
+
+/**
+ * Interns a string.
+ * @param {string} value String value.
+ * @return {number} String table index.
+ * @private
+ */
+wtf.db.ArgumentTable.prototype.internString_ = function(value) {
+  var index = this.stringIds_[value];
+  if (index === undefined) {
+    index = this.strings_.length;
+    this.strings_.push(value);
+    this.stringIds_[value] = index;
+  }
+  return index;
+};
+
+
+/**
+ * Gets the layout index for the given argument names and types, creating it
+ * if needed.
+ * @param {!Array.<string>} names Argument names.
+ * @param {!Array.<string>} typeNames Argument type names.
+ * @return {number} Layout index.
+ * @private
+ */
+wtf.db.ArgumentTable.prototype.getLayoutIndex_ = function(names, typeNames) {
+  var key = '';
+  for (var n = 0; n < names.length; n++) {
+    key += typeNames[n] + ' ' + names[n] + ',';
+  }
+  var index = this.layoutsByKey_[key];
+  if (index === undefined) {
+    index = this.layouts_.length;
+    if (index > 0xFFFF && this.layoutOf_ instanceof Uint16Array) {
+      this.reallocateLayoutOf_(this.layoutOf_.length, true);
+    }
+    this.layouts_.push(new wtf.db.ArgumentTable.Layout_(names, typeNames));
+    this.layoutsByKey_[key] = index;
+  }
+  return index;
+};
+
+
+/**
+ * Gets the layout index used for the given event type.
+ * @param {!wtf.db.EventType} eventType Event type.
+ * @return {number} Layout index or 0 if the type has no arguments.
+ * @private
+ */
+wtf.db.ArgumentTable.prototype.getLayoutIndexForType_ = function(eventType) {
+  var index = this.layoutsByTypeId_[eventType.id];
+  if (index === undefined) {
+    var args = eventType.args;
+    if (args.length) {
+      var names = [];
+      var typeNames = [];
+      for (var n = 0; n < args.length; n++) {
+        names.push(args[n].name);
+        typeNames.push(args[n].typeName);
+      }
+      index = this.getLayoutIndex_(names, typeNames);
+    } else {
+      index = 0;
+    }
+    this.layoutsByTypeId_[eventType.id] = index;
+  }
+  return index;
+};
+
+
+/**
+ * Attempts to store values in the columns of a layout.
+ * @param {number} layoutIndex Layout index.
+ * @param {!Object} values Argument values.
+ * @return {number} Row index or -1 if the values do not fit the layout.
+ * @private
+ */
+wtf.db.ArgumentTable.prototype.addRow_ = function(layoutIndex, values) {
+  var layout = this.layouts_[layoutIndex];
+  var names = layout.names;
+
+  // Any additional keys cannot be represented.
+  var keyCount = 0;
+  for (var key in values) {
+    keyCount++;
+  }
+  if (keyCount != names.length) {
+    return -1;
+  }
+
+  layout.ensureCapacity_();
+  var row = layout.count;
+  for (var n = 0; n < names.length; n++) {
+    var value = values[names[n]];
+    var column = layout.columns[n];
+    switch (layout.kinds[n]) {
+      case wtf.db.ArgumentTable.ColumnKind_.NUMBER:
+        // The value must survive a round trip through the typed array.
+        column[row] = value;
+        if (column[row] !== value) {
+          return -1;
+        }
+        break;
+      case wtf.db.ArgumentTable.ColumnKind_.BOOL:
+        if (value !== true && value !== false) {
+          return -1;
+        }
+        column[row] = value ? 1 : 0;
+        break;
+      case wtf.db.ArgumentTable.ColumnKind_.STRING:
+        if (!goog.isString(value)) {
+          return -1;
+        }
+        column[row] = this.internString_(value);
+        break;
+      default:
+        if (value === undefined) {
+          return -1;
+        }
+        column[row] = value;
+        break;
+    }
+  }
+  layout.count++;
+  layout.liveCount++;
+  return row;
+};
+
+
+/**
+ * Stores values as an object.
+ * @param {number} id Argument ID.
+ * @param {wtf.db.ArgumentData} values Argument values.
+ * @private
+ */
+wtf.db.ArgumentTable.prototype.setObject_ = function(id, values) {
+  this.releaseStorage_(id);
+  this.layoutOf_[id] = wtf.db.ArgumentTable.OBJECT_LAYOUT_;
+  this.rowOf_[id] = this.objects_.length;
+  this.objects_.push(values);
+  this.liveObjectCount_++;
+};
+
+
+/**
+ * Releases the row or object used by an argument ID.
+ * Column storage is released with the last row of a layout and the object
+ * list is cleared with the last object.
+ * @param {number} id Argument ID.
+ * @private
+ */
+wtf.db.ArgumentTable.prototype.releaseStorage_ = function(id) {
+  var layoutIndex = this.layoutOf_[id];
+  if (layoutIndex == wtf.db.ArgumentTable.OBJECT_LAYOUT_) {
+    this.objects_[this.rowOf_[id]] = null;
+    if (!--this.liveObjectCount_) {
+      this.objects_.length = 0;
+    }
+  } else if (layoutIndex) {
+    var layout = this.layouts_[layoutIndex];
+    if (!--layout.liveCount) {
+      layout.reset_();
+    }
+  }
+  this.layoutOf_[id] = 0;
+};
+
+
+/**
+ * Adds arguments for an event of the given type.
+ * @param {!wtf.db.EventType} eventType Event type.
+ * @param {!wtf.db.ArgumentData} values Argument values. The object is not
+ *     retained if the values fit the layout of the event type.
+ * @return {number} Argument ID.
+ */
+wtf.db.ArgumentTable.prototype.add = function(eventType, values) {
+  var id = this.allocateId_();
+  var layoutIndex = this.getLayoutIndexForType_(eventType);
+  var row = layoutIndex ? this.addRow_(layoutIndex, values) : -1;
+  if (row >= 0) {
+    this.layoutOf_[id] = layoutIndex;
+    this.rowOf_[id] = row;
+  } else {
+    this.setObject_(id, values);
+  }
+  return id;
+};
+
+
+/**
+ * Copies arguments from another table.
+ * @param {!wtf.db.ArgumentTable} source Source table.
+ * @param {number} sourceId Argument ID in the source table.
+ * @return {number} Argument ID in this table or 0 if the source had no data.
+ */
+wtf.db.ArgumentTable.prototype.copyFrom = function(source, sourceId) {
+  var values = source.get(sourceId);
+  if (!values) {
+    return 0;
+  }
+  var id = this.allocateId_();
+  var sourceLayoutIndex = source.layoutOf_[sourceId];
+  var row = -1;
+  var layoutIndex = 0;
+  if (sourceLayoutIndex != wtf.db.ArgumentTable.OBJECT_LAYOUT_) {
+    var sourceLayout = source.layouts_[sourceLayoutIndex];
+    layoutIndex = this.getLayoutIndex_(
+        sourceLayout.names, sourceLayout.typeNames);
+    row = this.addRow_(layoutIndex, values);
+  }
+  if (row >= 0) {
+    this.layoutOf_[id] = layoutIndex;
+    this.rowOf_[id] = row;
+  } else {
+    this.setObject_(id, values);
+  }
+  return id;
+};
+
+
+/**
+ * Sets the values for an argument ID, replacing any previous values.
+ * @param {number} id Argument ID, or 0 to allocate a new one.
+ * @param {wtf.db.ArgumentData} values New values. The object is retained.
+ * @return {number} Argument ID.
+ */
+wtf.db.ArgumentTable.prototype.set = function(id, values) {
+  if (!id) {
+    id = this.allocateId_();
+  }
+  if (values) {
+    this.setObject_(id, values);
+  } else {
+    this.releaseStorage_(id);
+  }
+  return id;
+};
+
+
+/**
+ * Releases the values of an argument ID.
+ * Rows are not reused, but the column storage of a layout is reclaimed once
+ * all of its rows have been released.
+ * @param {number} id Argument ID.
+ */
+wtf.db.ArgumentTable.prototype.release = function(id) {
+  this.releaseStorage_(id);
+};
+
+
+/**
+ * Gets the values of an argument ID.
+ * Values stored in columns are materialized into a new object on each call.
+ * @param {number} id Argument ID.
+ * @return {wtf.db.ArgumentData} Argument values, if any.
+ */
+wtf.db.ArgumentTable.prototype.get = function(id) {
+  var layoutIndex = id < this.nextId_ ? this.layoutOf_[id] : 0;
+  if (!layoutIndex) {
+    return null;
+  }
+  var row = this.rowOf_[id];
+  if (layoutIndex == wtf.db.ArgumentTable.OBJECT_LAYOUT_) {
+    return this.objects_[row];
+  }
+  var layout = this.layouts_[layoutIndex];
+  var result = {};
+  for (var n = 0; n < layout.names.length; n++) {
+    result[layout.names[n]] = this.getColumnValue_(layout, n, row);
+  }
+  return result;
+};
+
+
+/**
+ * Gets the values of an argument ID as an object that can be modified.
+ * Modifications to the returned object are retained.
+ * @param {number} id Argument ID.
+ * @return {wtf.db.ArgumentData} Argument values, if any.
+ */
+wtf.db.ArgumentTable.prototype.getMutable = function(id) {
+  var values = this.get(id);
+  if (values &&
+      this.layoutOf_[id] != wtf.db.ArgumentTable.OBJECT_LAYOUT_) {
+    this.setObject_(id, values);
+  }
+  return values;
+};
+
+
+/**
+ * Gets a single argument value.
+ * This avoids materializing the argument object.
+ * @param {number} id Argument ID.
+ * @param {string} key Argument name.
+ * @return {*} Argument value or undefined if not present.
+ */
+wtf.db.ArgumentTable.prototype.getValue = function(id, key) {
+  var layoutIndex = id < this.nextId_ ? this.layoutOf_[id] : 0;
+  if (!layoutIndex) {
+    return undefined;
+  }
+  var row = this.rowOf_[id];
+  if (layoutIndex == wtf.db.ArgumentTable.OBJECT_LAYOUT_) {
+    var values = this.objects_[row];
+    return values ? values[key] : undefined;
+  }
+  var layout = this.layouts_[layoutIndex];
+  var column = layout.columnIndices[key];
+  if (column === undefined) {
+    return undefined;
+  }
+  return this.getColumnValue_(layout, column, row);
+};
+
+
+/**
+ * Reads a value from a column.
+ * @param {!wtf.db.ArgumentTable.Layout_} layout Layout.
+ * @param {number} column Column index.
+ * @param {number} row Row index.
+ * @return {*} Value.
+ * @private
+ */
+wtf.db.ArgumentTable.prototype.getColumnValue_ = function(
+    layout, column, row) {
+  var value = layout.columns[column][row];
+  switch (layout.kinds[column]) {
+    case wtf.db.ArgumentTable.ColumnKind_.BOOL:
+      return !!value;
+    case wtf.db.ArgumentTable.ColumnKind_.STRING:
+      return this.strings_[value];
+    default:
+      return value;
+  }
+};
+
+
+/**
+ * Exports the table contents.
+ * The table should not be modified while the exported data is in use.
+ * @return {!wtf.db.ArgumentTableData} Table data.
+ */
+wtf.db.ArgumentTable.prototype.exportData = function() {
+  var layouts = [];
+  for (var n = 2; n < this.layouts_.length; n++) {
+    var layout = this.layouts_[n];
+    layouts.push({
+      names: layout.names,
+      typeNames: layout.typeNames,
+      count: layout.count,
+      columns: layout.columns
+    });
+  }
+  return {
+    nextId: this.nextId_,
+    layoutOf: this.layoutOf_,
+    rowOf: this.rowOf_,
+    objects: this.objects_,
+    strings: this.strings_,
+    layouts: layouts
+  };
+};
+
+
+/**
+ * Replaces the table contents with data from {@see #exportData}.
+ * @param {!wtf.db.ArgumentTableData} data Table data.
+ */
+wtf.db.ArgumentTable.prototype.importData = function(data) {
+  this.nextId_ = data.nextId;
+  this.layoutOf_ = data.layoutOf;
+  this.rowOf_ = data.rowOf;
+  this.objects_ = data.objects;
+  this.liveObjectCount_ = 0;
+  this.strings_ = data.strings;
+  this.stringIds_ = Object.create(null);
+  for (var n = 1; n < this.strings_.length; n++) {
+    this.stringIds_[this.strings_[n]] = n;
+  }
+  this.layouts_ = [null, null];
+  this.layoutsByKey_ = {};
+  this.layoutsByTypeId_ = [];
+  for (var n = 0; n < data.layouts.length; n++) {
+    var layoutData = data.layouts[n];
+    var index = this.getLayoutIndex_(layoutData.names, layoutData.typeNames);
+    var layout = this.layouts_[index];
+    layout.columns = layoutData.columns;
+    layout.count = layoutData.count;
+    layout.capacity = layoutData.count;
+    for (var m = 0; m < layout.columns.length; m++) {
+      if (layout.kinds[m] != wtf.db.ArgumentTable.ColumnKind_.OBJECT) {
+        layout.capacity = layout.columns[m].length;
+        break;
+      }
+    }
+  }
+  for (var n = 1; n < this.nextId_; n++) {
+    var layoutIndex = this.layoutOf_[n];
+    if (layoutIndex == wtf.db.ArgumentTable.OBJECT_LAYOUT_) {
+      this.liveObjectCount_++;
+    } else if (layoutIndex) {
+      this.layouts_[layoutIndex].liveCount++;
+    }
+  }
+};
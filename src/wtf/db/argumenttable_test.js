@@ -0,0 +1,122 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+goog.provide('wtf.db.ArgumentTable_test');
+
+goog.require('wtf.db.ArgumentTable');
+goog.require('wtf.db.EventType');
+
+
+/**
+ * wtf.db.ArgumentTable testing.
+ */
+wtf.db.ArgumentTable_test = suite('wtf.db.ArgumentTable', function() {
+  var eventType = wtf.db.EventType.createInstance(
+      'someEvent(uint32 a, ascii b, bool c, float32 d, any e)');
+  eventType.id = 1;
+
+  test('#ctor', function() {
+    var table = new wtf.db.ArgumentTable();
+    assert.isNull(table.get(0));
+    assert.isNull(table.get(1));
+    assert.isUndefined(table.getValue(1, 'a'));
+  });
+
+  test('columns', function() {
+    var table = new wtf.db.ArgumentTable();
+    var ids = [];
+    for (var n = 0; n < 100; n++) {
+      ids.push(table.add(eventType, {
+        'a': n,
+        'b': 'str' + (n % 3),
+        'c': !!(n % 2),
+        'd': 0.5,
+        'e': [n]
+      }));
+    }
+    assert.deepEqual(table.get(ids[5]), {
+      'a': 5, 'b': 'str2', 'c': true, 'd': 0.5, 'e': [5]
+    });
+    assert.equal(table.getValue(ids[99], 'a'), 99);
+    assert.equal(table.getValue(ids[99], 'b'), 'str0');
+    assert.isFalse(table.getValue(ids[98], 'c'));
+    assert.isUndefined(table.getValue(ids[98], 'x'));
+
+    // Strings are interned.
+    assert.lengthOf(table.exportData().strings, 4);
+  });
+
+  test('mismatchedValues', function() {
+    var table = new wtf.db.ArgumentTable();
+    var values = {'a': -1, 'b': 'x', 'c': true, 'd': 0.1, 'e': null};
+    var id = table.add(eventType, values);
+    assert.equal(table.get(id), values);
+
+    var extra = {'a': 1, 'b': 'x', 'c': true, 'd': 1, 'e': null, 'f': 2};
+    id = table.add(eventType, extra);
+    assert.equal(table.getValue(id, 'f'), 2);
+  });
+
+  test('mutation', function() {
+    var table = new wtf.db.ArgumentTable();
+    var id = table.add(eventType, {
+      'a': 1, 'b': 'x', 'c': true, 'd': 1, 'e': null
+    });
+    var args = table.getMutable(id);
+    args['z'] = 5;
+    assert.equal(table.getValue(id, 'z'), 5);
+    assert.equal(table.getValue(id, 'a'), 1);
+
+    table.release(id);
+    assert.isNull(table.get(id));
+
+    id = table.set(0, {'q': 1});
+    assert.deepEqual(table.get(id), {'q': 1});
+  });
+
+  test('release', function() {
+    var table = new wtf.db.ArgumentTable();
+    var values = {'a': 1, 'b': 'x', 'c': true, 'd': 1, 'e': null};
+    var id1 = table.add(eventType, values);
+    var id2 = table.add(eventType, values);
+    var id3 = table.set(0, {'q': 1});
+    assert.equal(table.exportData().layouts[0].count, 2);
+
+    // Columns are kept until the last row is released.
+    table.release(id1);
+    assert.equal(table.exportData().layouts[0].count, 2);
+    table.getMutable(id2);
+    var layout = table.exportData().layouts[0];
+    assert.equal(layout.count, 0);
+    assert.lengthOf(layout.columns[0], 0);
+    assert.deepEqual(table.get(id2), values);
+
+    table.release(id2);
+    table.release(id3);
+    assert.lengthOf(table.exportData().objects, 0);
+    id1 = table.add(eventType, values);
+    assert.deepEqual(table.get(id1), values);
+  });
+
+  test('exportImport', function() {
+    var source = new wtf.db.ArgumentTable();
+    var id1 = source.add(eventType, {
+      'a': 1, 'b': 'x', 'c': true, 'd': 1, 'e': null
+    });
+    var id2 = source.set(0, {'q': 1});
+
+    var table = new wtf.db.ArgumentTable();
+    table.importData(source.exportData());
+    assert.deepEqual(table.get(id1), source.get(id1));
+    assert.deepEqual(table.get(id2), {'q': 1});
+
+    var target = new wtf.db.ArgumentTable();
+    target.set(0, {'other': true});
+    var copyId = target.copyFrom(source, id1);
+    assert.deepEqual(target.get(copyId), source.get(id1));
+  });
+});
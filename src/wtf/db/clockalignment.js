@@ -0,0 +1,367 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/**
+ * @fileoverview Clock alignment between trace sources.
+ *
+ * @author benvanik@google.com (Ben Vanik)
+ */
+
+goog.provide('wtf.db.ClockAlignment');
+
+
+
+/**
+ * Maps the times of one source onto the clock of the sources already loaded.
+ * Alignment is computed from causally paired events, such as a flow branched
+ * in one source and continued in another. Each pair bounds the offset between
+ * the clocks: an event cannot happen before the event that caused it.
+ *
+ * Source times are expected to already be lined up by wall clock (see
+ * {@see wtf.db.Database#computeTimeDelay}), so the offsets of correctly paired
+ * events are small. Pairs with large offsets are rejected; they are almost
+ * always unrelated events that reused an ID.
+ *
+ * The mapping is linear to account for clock drift. Outlying pairs are dropped
+ * and the drift is a least squares fit of the offsets of the remaining pairs.
+ * The offset is chosen so that nearly all pairs are in causal order, splitting
+ * the difference when there are pairs in both directions.
+ *
+ * All times are in database event time units (microseconds).
+ *
+ * @constructor
+ */
+wtf.db.ClockAlignment = function() {
+  /**
+   * Source times of all pairs.
+   * @type {!Array.<number>}
+   * @private
+   */
+  this.times_ = [];
+
+  /**
+   * Offsets (reference time - source time) of all pairs.
+   * @type {!Array.<number>}
+   * @private
+   */
+  this.offsets_ = [];
+
+  /**
+   * Whether each pair is a receive (the source event was caused by the
+   * reference event) or a send.
+   * @type {!Array.<boolean>}
+   * @private
+   */
+  this.receives_ = [];
+
+  /**
+   * Drift, in time units per time unit.
+   * @type {number}
+   * @private
+   */
+  this.drift_ = 0;
+
+  /**
+   * Source time the drift is relative to.
+   * @type {number}
+   * @private
+   */
+  this.driftBaseTime_ = 0;
+
+  /**
+   * Offset added to source times at the drift base time.
+   * @type {number}
+   * @private
+   */
+  this.offset_ = 0;
+};
+
+
+/**
+ * Minimum time between the first and last pairs for drift to be fit, in
+ * time units. Over shorter spans latency noise swamps any drift.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.db.ClockAlignment.MIN_DRIFT_SPAN_ = 1000000;
+
+
+/**
+ * Maximum drift that will be applied. Larger fits are almost certainly caused
+ * by mismatched pairs and are ignored.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.db.ClockAlignment.MAX_DRIFT_ = 0.001;
+
+
+/**
+ * Maximum offset of a pair from the wall clock alignment, in time units.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.db.ClockAlignment.MAX_OFFSET_ = 250000;
+
+
+/**
+ * Pairs further from the median offset than this many times the median
+ * absolute deviation are dropped as outliers.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.db.ClockAlignment.OUTLIER_DEVIATIONS_ = 5;
+
+
+/**
+ * Minimum distance from the median offset for a pair to be dropped as an
+ * outlier, in time units. Keeps pairs when nearly all offsets are equal.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.db.ClockAlignment.MIN_OUTLIER_DISTANCE_ = 10000;
+
+
+/**
+ * Fraction of the pairs in each direction allowed to be out of causal order.
+ * The bound is this percentile of the offsets rather than the extreme, so that
+ * a few mismatched pairs do not decide the offset.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.db.ClockAlignment.BOUND_PERCENTILE_ = 0.05;
+
+
+/**
+ * Gets the number of pairs added.
+ * @return {number} Pair count.
+ */
+wtf.db.ClockAlignment.prototype.getPairCount = function() {
+  return this.times_.length;
+};
+
+
+/**
+ * Adds a pair where the source event was caused by the reference event.
+ * @param {number} time Source event time.
+ * @param {number} referenceTime Reference event time.
+ * @return {boolean} Whether the pair was added. Pairs too far from the wall
+ *     clock alignment are rejected.
+ */
+wtf.db.ClockAlignment.prototype.addReceive = function(time, referenceTime) {
+  return this.addPair_(time, referenceTime, true);
+};
+
+
+/**
+ * Adds a pair where the reference event was caused by the source event.
+ * @param {number} time Source event time.
+ * @param {number} referenceTime Reference event time.
+ * @return {boolean} Whether the pair was added. Pairs too far from the wall
+ *     clock alignment are rejected.
+ */
+wtf.db.ClockAlignment.prototype.addSend = function(time, referenceTime) {
+  return this.addPair_(time, referenceTime, false);
+};
+
+
+/**
+ * Adds a pair if it is close enough to the wall clock alignment.
+ * @param {number} time Source event time.
+ * @param {number} referenceTime Reference event time.
+ * @param {boolean} receive Whether the pair is a receive.
+ * @return {boolean} Whether the pair was added.
+ * @private
+ */
+wtf.db.ClockAlignment.prototype.addPair_ = function(
+    time, referenceTime, receive) {
+  var offset = referenceTime - time;
+  if (Math.abs(offset) > wtf.db.ClockAlignment.MAX_OFFSET_) {
+    return false;
+  }
+  this.times_.push(time);
+  this.offsets_.push(offset);
+  this.receives_.push(receive);
+  return true;
+};
+
+
+/**
+ * Fits the mapping to the pairs added so far.
+ */
+wtf.db.ClockAlignment.prototype.fit = function() {
+  this.drift_ = 0;
+  this.driftBaseTime_ = 0;
+  this.offset_ = 0;
+  if (!this.times_.length) {
+    return;
+  }
+
+  // Drop outliers, using the median absolute deviation so that the outliers
+  // themselves do not widen the cutoff.
+  var median = wtf.db.ClockAlignment.median_(this.offsets_);
+  var deviations = new Array(this.offsets_.length);
+  for (var n = 0; n < this.offsets_.length; n++) {
+    deviations[n] = Math.abs(this.offsets_[n] - median);
+  }
+  var cutoff = Math.max(wtf.db.ClockAlignment.MIN_OUTLIER_DISTANCE_,
+      wtf.db.ClockAlignment.OUTLIER_DEVIATIONS_ *
+      wtf.db.ClockAlignment.median_(deviations));
+  var pairs = [];
+  for (var n = 0; n < this.offsets_.length; n++) {
+    if (deviations[n] <= cutoff) {
+      pairs.push(n);
+    }
+  }
+
+  // Least squares fit of offset over time, centered on the mean time to keep
+  // the products small.
+  var times = this.times_;
+  var offsets = this.offsets_;
+  var meanTime = 0;
+  var meanOffset = 0;
+  var minTime = Number.MAX_VALUE;
+  var maxTime = -Number.MAX_VALUE;
+  for (var n = 0; n < pairs.length; n++) {
+    var i = pairs[n];
+    meanTime += times[i];
+    meanOffset += offsets[i];
+    minTime = Math.min(minTime, times[i]);
+    maxTime = Math.max(maxTime, times[i]);
+  }
+  meanTime /= pairs.length;
+  meanOffset /= pairs.length;
+  this.driftBaseTime_ = meanTime;
+  if (maxTime - minTime >= wtf.db.ClockAlignment.MIN_DRIFT_SPAN_) {
+    var covariance = 0;
+    var variance = 0;
+    for (var n = 0; n < pairs.length; n++) {
+      var i = pairs[n];
+      var dt = times[i] - meanTime;
+      covariance += dt * (offsets[i] - meanOffset);
+      variance += dt * dt;
+    }
+    var drift = covariance / variance;
+    if (Math.abs(drift) <= wtf.db.ClockAlignment.MAX_DRIFT_) {
+      this.drift_ = drift;
+    }
+  }
+
+  this.offset_ = this.fitOffset_(pairs);
+  if (isNaN(this.offset_) && this.drift_) {
+    // The pairs cannot be ordered with the fit drift; fall back to a constant
+    // offset.
+    this.drift_ = 0;
+    this.offset_ = this.fitOffset_(pairs);
+  }
+  if (isNaN(this.offset_)) {
+    // Still inconsistent, so some pairs were mismatched. Split the difference.
+    this.offset_ = this.fitOffset_(pairs, true);
+  }
+};
+
+
+/**
+ * Finds the offset that puts the given pairs in causal order with the current
+ * drift. Each bound is a percentile of the pair offsets in that direction.
+ * @param {!Array.<number>} pairs Indices of the pairs to use.
+ * @param {boolean=} opt_force Split the difference between the bounds even if
+ *     they are inconsistent.
+ * @return {number} Offset, or NaN if no offset satisfies the bounds.
+ * @private
+ */
+wtf.db.ClockAlignment.prototype.fitOffset_ = function(pairs, opt_force) {
+  // Upper bounds are negated so that both bounds trim their extremes.
+  var lowerBounds = [];
+  var negatedUpperBounds = [];
+  for (var n = 0; n < pairs.length; n++) {
+    var i = pairs[n];
+    var offset = this.offsets_[i] -
+        this.drift_ * (this.times_[i] - this.driftBaseTime_);
+    if (this.receives_[i]) {
+      lowerBounds.push(offset);
+    } else {
+      negatedUpperBounds.push(-offset);
+    }
+  }
+  var fraction = 1 - wtf.db.ClockAlignment.BOUND_PERCENTILE_;
+  var lowerBound = lowerBounds.length ?
+      wtf.db.ClockAlignment.percentile_(lowerBounds, fraction) : NaN;
+  var upperBound = negatedUpperBounds.length ?
+      -wtf.db.ClockAlignment.percentile_(negatedUpperBounds, fraction) : NaN;
+  if (isNaN(upperBound)) {
+    return lowerBound;
+  } else if (isNaN(lowerBound)) {
+    return upperBound;
+  } else if (lowerBound <= upperBound || opt_force) {
+    return (lowerBound + upperBound) / 2;
+  }
+  return NaN;
+};
+
+
+/**
+ * Gets the median of the given values.
+ * @param {!Array.<number>} values Values. Not modified.
+ * @return {number} Median.
+ * @private
+ */
+wtf.db.ClockAlignment.median_ = function(values) {
+  var sorted = values.slice().sort(function(a, b) { return a - b; });
+  var middle = sorted.length >> 1;
+  return sorted.length % 2 ?
+      sorted[middle] : (sorted[middle - 1] + sorted[middle]) / 2;
+};
+
+
+/**
+ * Gets a nearest rank percentile of the given values.
+ * @param {!Array.<number>} values Values. Sorted in place.
+ * @param {number} fraction Fraction of values at or below the result, (0-1].
+ * @return {number} Percentile value.
+ * @private
+ */
+wtf.db.ClockAlignment.percentile_ = function(values, fraction) {
+  values.sort(function(a, b) { return a - b; });
+  var rank = Math.max(1, Math.ceil(fraction * values.length));
+  return values[rank - 1];
+};
+
+
+/**
+ * Gets the fit drift.
+ * @return {number} Drift, in time units per time unit.
+ */
+wtf.db.ClockAlignment.prototype.getDrift = function() {
+  return this.drift_;
+};
+
+
+/**
+ * Whether the fit mapping leaves times unchanged.
+ * @return {boolean} True if the mapping is the identity.
+ */
+wtf.db.ClockAlignment.prototype.isIdentity = function() {
+  return !this.drift_ && !Math.round(this.offset_);
+};
+
+
+/**
+ * Maps a source time onto the reference clock.
+ * The mapping is monotonic, so sorted times remain sorted.
+ * @param {number} time Source time.
+ * @return {number} Aligned time, clamped to 0.
+ */
+wtf.db.ClockAlignment.prototype.align = function(time) {
+  return Math.max(0, Math.round(
+      time + this.offset_ + this.drift_ * (time - this.driftBaseTime_)));
+};
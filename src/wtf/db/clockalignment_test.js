@@ -0,0 +1,190 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+goog.provide('wtf.db.ClockAlignment_test');
+
+goog.require('wtf.db.ClockAlignment');
+goog.require('wtf.db.Database');
+goog.require('wtf.db.EventType');
+goog.require('wtf.testing');
+
+
+/**
+ * wtf.db.ClockAlignment testing.
+ */
+wtf.db.ClockAlignment_test = suite('wtf.db.ClockAlignment', function() {
+  test('#fit', function() {
+    var clockAlignment = new wtf.db.ClockAlignment();
+    clockAlignment.fit();
+    assert.isTrue(clockAlignment.isIdentity());
+
+    // Receives only: the source is moved to the earliest causal time.
+    clockAlignment.addReceive(1000, 1500);
+    clockAlignment.addReceive(2000, 2700);
+    clockAlignment.fit();
+    assert.equal(clockAlignment.getDrift(), 0);
+    assert.equal(clockAlignment.align(1000), 1700);
+    assert.equal(clockAlignment.align(0), 700);
+
+    // Sends bound the other side and the offset splits the difference.
+    clockAlignment.addSend(3000, 4100);
+    clockAlignment.fit();
+    assert.equal(clockAlignment.align(3000), 3900);
+    assert.isFalse(clockAlignment.isIdentity());
+
+    // Inconsistent pairs still produce a mapping.
+    clockAlignment.addSend(4000, 4000);
+    clockAlignment.fit();
+    assert.equal(clockAlignment.align(4000), 4350);
+
+    // Pairs far from the wall clock alignment are rejected.
+    assert.isFalse(clockAlignment.addReceive(5000, 1005000));
+    assert.equal(clockAlignment.getPairCount(), 4);
+  });
+
+  test('#fitOutliers', function() {
+    // Flows with reused IDs pair unrelated events.
+    var clockAlignment = new wtf.db.ClockAlignment();
+    for (var n = 0; n < 20; n++) {
+      var time = n * 1000;
+      clockAlignment.addReceive(time, time + 1000 + n);
+      clockAlignment.addSend(time, time + 1100 - n);
+    }
+    clockAlignment.addReceive(30000, 90000);
+    clockAlignment.addSend(31000, 1000);
+    clockAlignment.fit();
+    assert.equal(clockAlignment.align(0), 1050);
+
+    // A mismatched pair close to the others only trims the bound.
+    clockAlignment = new wtf.db.ClockAlignment();
+    for (var n = 0; n < 20; n++) {
+      clockAlignment.addReceive(n * 1000, n * 1000 + 500);
+    }
+    clockAlignment.addReceive(25000, 25000 + 5000);
+    clockAlignment.fit();
+    assert.equal(clockAlignment.align(0), 500);
+  });
+
+  test('#fitDrift', function() {
+    // The source clock runs 100ppm fast with 40us of latency.
+    var clockAlignment = new wtf.db.ClockAlignment();
+    for (var n = 0; n < 10; n++) {
+      var time = n * 1000000;
+      var referenceTime = 5000 + time * 0.9999;
+      clockAlignment.addReceive(time + 40, referenceTime);
+      clockAlignment.addSend(time + 40, referenceTime + 80);
+    }
+    clockAlignment.fit();
+    assert.closeTo(clockAlignment.getDrift(), -0.0001, 0.000001);
+    for (var n = 0; n < 10; n++) {
+      var time = n * 1000000 + 500000;
+      assert.closeTo(clockAlignment.align(time), 5000 + time * 0.9999, 1);
+    }
+
+    // Implausible drift is ignored.
+    clockAlignment = new wtf.db.ClockAlignment();
+    clockAlignment.addReceive(0, 0);
+    clockAlignment.addReceive(2000000, 2100000);
+    clockAlignment.fit();
+    assert.equal(clockAlignment.getDrift(), 0);
+    assert.equal(clockAlignment.align(0), 100000);
+  });
+
+  test('wtf.db.Database', function() {
+    var db = new wtf.db.Database();
+    var eventTypeTable = db.getEventTypeTable();
+    eventTypeTable.defineType(wtf.db.EventType.createInstance(
+        'wtf.flow#branch(flowId id, flowId parentId, ascii name, any value)'));
+    eventTypeTable.defineType(wtf.db.EventType.createInstance(
+        'wtf.flow#extend(flowId id, ascii name, any value)'));
+    eventTypeTable.defineType(wtf.db.EventType.createInstance(
+        'wtf.flow#terminate(flowId id, any value)'));
+    function insertEvents(source, zoneName, events) {
+      db.beginInsertingEvents(source);
+      var eventList = db.createOrGetZone(zoneName, 'script', '').
+          getEventList();
+      for (var n = 0; n < events.length; n++) {
+        var eventType = eventTypeTable.getByName(events[n][1]);
+        var argData = {};
+        for (var m = 0; m < eventType.args.length; m++) {
+          argData[eventType.args[m].name] = events[n][2 + m];
+        }
+        eventList.insert(eventType, events[n][0], argData);
+      }
+      db.endInsertingEvents();
+      return eventList;
+    };
+    function getTimes(eventList) {
+      var times = [];
+      for (var it = eventList.begin(); !it.done(); it.next()) {
+        times.push(Math.round(it.getTime() * 1000));
+      }
+      return times;
+    };
+
+    // The page branches flows 1 and 2, and the worker spans both and also
+    // branches its own flow 1.
+    var page = {};
+    var pageEvents = insertEvents(page, 'page', [
+      [1000, 'wtf.flow#branch', 1, 0, 'a', null],
+      [5000, 'wtf.flow#branch', 2, 0, 'b', null],
+      [9000, 'wtf.flow#terminate', 3, null]
+    ]);
+    assert.isNull(db.getClockAlignment(page));
+
+    var worker = {};
+    var workerEvents = insertEvents(worker, 'worker', [
+      [500, 'wtf.flow#extend', 2, 'b', null],
+      [600, 'wtf.flow#branch', 1, 0, 'c', null],
+      [700, 'wtf.flow#extend', 1, 'c', null],
+      [800, 'wtf.flow#branch', 3, 0, 'd', null]
+    ]);
+    var clockAlignment = db.getClockAlignment(worker);
+    assert.equal(clockAlignment.getPairCount(), 2);
+
+    // Flow 2 puts the worker at least 4500us later and flow 3 at most 8200us.
+    assert.deepEqual(getTimes(workerEvents), [6850, 6950, 7050, 7150]);
+    assert.deepEqual(getTimes(pageEvents), [1000, 5000, 9000]);
+    assert.equal(db.getFirstEventTime(), 1);
+    assert.equal(db.getLastEventTime(), 9);
+
+    // Later sources align to both.
+    var server = {};
+    insertEvents(server, 'page', [
+      [100, 'wtf.flow#extend', 3, 'e', null]
+    ]);
+    assert.deepEqual(getTimes(pageEvents), [1000, 5000, 7150, 9000]);
+
+    // Sources without pairs are aligned by a later block that has them.
+    var calls = {};
+    insertEvents(calls, 'calls', [
+      [200, 'wtf.flow#branch', 4, 0, 'f', null]
+    ]);
+    assert.isNull(db.getClockAlignment(calls));
+    var callsEvents = insertEvents(calls, 'calls', [
+      [300, 'wtf.flow#extend', 4, 'f', null],
+      [400, 'wtf.flow#extend', 2, 'b', null]
+    ]);
+    assert.equal(db.getClockAlignment(calls).getPairCount(), 1);
+    assert.deepEqual(getTimes(callsEvents), [200, 4900, 5000]);
+
+    // Unaligned sources are fixed once a later source may have used them.
+    var timers = {};
+    insertEvents(timers, 'timers', [
+      [100, 'wtf.flow#branch', 5, 0, 'g', null]
+    ]);
+    var jobs = {};
+    insertEvents(jobs, 'jobs', [
+      [100, 'wtf.flow#extend', 5, 'g', null]
+    ]);
+    var timersEvents = insertEvents(timers, 'timers', [
+      [200, 'wtf.flow#extend', 2, 'b', null]
+    ]);
+    assert.isNull(db.getClockAlignment(timers));
+    assert.deepEqual(getTimes(timersEvents), [100, 200]);
+  });
+});
@@ -15,6 +15,9 @@ goog.provide('wtf.db.Database');
 
 goog.require('goog.asserts');
 goog.require('goog.events');
+goog.require('goog.object');
+goog.require('wtf.db.ClockAlignment');
+goog.require('wtf.db.EventStruct');
 goog.require('wtf.db.EventTypeTable');
 goog.require('wtf.db.Unit');
 goog.require('wtf.db.Zone');
@@ -72,6 +75,49 @@ wtf.db.Database = function() {
    */
   this.commonTimebase_ = -1;
 
+  /**
+   * Clock alignments of sources, indexed by source UID.
+   * A source is aligned to the sources loaded before it by the first insertion
+   * block with events that are paired with theirs. Sources without pairs yet
+   * are not in the map and are retried on each insertion block.
+   * @type {!Object.<number, !wtf.db.ClockAlignment>}
+   * @private
+   */
+  this.clockAlignments_ = {};
+
+  /**
+   * Flow IDs used by the earlier insertion blocks of sources that are not yet
+   * aligned, indexed by source UID. These are the source's own flows and are
+   * not paired with it.
+   * @type {!Object.<number, !Object.<number, boolean>>}
+   * @private
+   */
+  this.unalignedFlowIds_ = {};
+
+  /**
+   * Order in which sources first inserted events, indexed by source UID.
+   * @type {!Object.<number, number>}
+   * @private
+   */
+  this.sourceOrder_ = {};
+
+  /**
+   * Number of sources that have inserted events.
+   * @type {number}
+   * @private
+   */
+  this.sourceCount_ = 0;
+
+  /**
+   * Sources that are never aligned, indexed by source UID. These are the
+   * first source and any source that later sources may have been aligned to.
+   * Moving them would move some of their blocks off of the clock that other
+   * sources were aligned to.
+   * @type {!Object.<number, boolean>}
+   * @private
+   */
+  this.referenceSources_ = {};
+
   /**
    * Time the first event occurred.
    * @type {number}
@@ -130,6 +176,22 @@ wtf.db.Database = function() {
    * @private
    */
   this.beginningZoneCount_ = 0;
+
+  /**
+   * The source adding events in the current insertion block.
+   * @type {wtf.db.DataSource}
+   * @private
+   */
+  this.insertingSource_ = null;
+
+  /**
+   * The event count of each zone when insertion began, in zone list order.
+   * Zones added since then have no entry. Used to find the events added by
+   * the source.
+   * @type {!Array.<number>}
+   * @private
+   */
+  this.beginningEventCounts_ = [];
 };
 goog.inherits(wtf.db.Database, wtf.events.EventEmitter);
 
@@ -417,6 +479,12 @@ wtf.db.Database.prototype.beginInsertingEvents = function(source) {
     // Special handling for the default zone.
     this.beginningZoneCount_ = 0;
   }
+
+  this.insertingSource_ = source;
+  this.beginningEventCounts_.length = this.zoneList_.length;
+  for (var n = 0; n < this.zoneList_.length; n++) {
+    this.beginningEventCounts_[n] = this.zoneList_[n].getEventList().count;
+  }
 };
 
 
@@ -427,6 +495,10 @@ wtf.db.Database.prototype.endInsertingEvents = function() {
   goog.asserts.assert(this.insertingEvents_);
   this.insertingEvents_ = false;
 
+  // Line the new events up with the existing ones before they are sorted in.
+  this.alignInsertedEvents_();
+  this.insertingSource_ = null;
+
   // Reconcile zone changes.
   this.firstEventTime_ = Number.MAX_VALUE;
   this.lastEventTime_ = Number.MIN_VALUE;
@@ -456,6 +528,215 @@ wtf.db.Database.prototype.endInsertingEvents = function() {
 
 
 
+/**
+ * Gets the clock alignment applied to the events of a source.
+ * Only sources whose events are paired with events of sources loaded before
+ * them are aligned.
+ * @param {!wtf.db.DataSource} source Data source.
+ * @return {wtf.db.ClockAlignment} Clock alignment, if any.
+ */
+wtf.db.Database.prototype.getClockAlignment = function(source) {
+  return this.clockAlignments_[goog.getUid(source)] || null;
+};
+
+
+/**
+ * Aligns the events added in the current insertion block to the clock of the
+ * events that were already in the database.
+ * Pairs are flows branched in one source and extended or terminated in the
+ * other. Flow IDs are only unique within a context, so IDs branched in both
+ * the new and the existing events are not used, and pairs far from the wall
+ * clock alignment are rejected by {@see wtf.db.ClockAlignment}.
+ *
+ * Once a source is aligned the mapping is kept for the rest of its events.
+ * Blocks inserted before the source had pairs keep their wall clock times.
+ * The first source is never aligned, and neither is an unaligned source once
+ * a source started after it inserts events, as that source may be aligned to
+ * it.
+ * @private
+ */
+wtf.db.Database.prototype.alignInsertedEvents_ = function() {
+  var uid = goog.getUid(this.insertingSource_);
+  if (!(uid in this.sourceOrder_)) {
+    var hasExistingEvents = false;
+    for (var n = 0; n < this.beginningEventCounts_.length; n++) {
+      hasExistingEvents = hasExistingEvents || !!this.beginningEventCounts_[n];
+    }
+    if (!hasExistingEvents) {
+      this.referenceSources_[uid] = true;
+    }
+    this.sourceOrder_[uid] = this.sourceCount_++;
+  }
+  var order = this.sourceOrder_[uid];
+  for (var otherUid in this.sourceOrder_) {
+    if (this.sourceOrder_[otherUid] < order &&
+        !this.clockAlignments_[otherUid]) {
+      this.referenceSources_[otherUid] = true;
+      delete this.unalignedFlowIds_[otherUid];
+    }
+  }
+  if (this.referenceSources_[uid]) {
+    return;
+  }
+
+  var clockAlignment = this.clockAlignments_[uid];
+  if (!clockAlignment) {
+    var insertedFlows = this.collectFlows_(true);
+    if (goog.object.isEmpty(insertedFlows.branches) &&
+        goog.object.isEmpty(insertedFlows.uses)) {
+      return;
+    }
+    var existingFlows = this.collectFlows_(false);
+    var ownFlowIds = this.unalignedFlowIds_[uid] || {};
+    clockAlignment = new wtf.db.ClockAlignment();
+    for (var id in insertedFlows.uses) {
+      var branchTime = existingFlows.branches[id];
+      if (!(id in insertedFlows.branches) && !ownFlowIds[id] &&
+          goog.isNumber(branchTime)) {
+        clockAlignment.addReceive(insertedFlows.uses[id], branchTime);
+      }
+    }
+    for (var id in insertedFlows.branches) {
+      var branchTime = insertedFlows.branches[id];
+      if (!(id in existingFlows.branches) && !ownFlowIds[id] &&
+          goog.isNumber(branchTime) && id in existingFlows.uses) {
+        clockAlignment.addSend(branchTime, existingFlows.uses[id]);
+      }
+    }
+    if (!clockAlignment.getPairCount()) {
+      // Try again with the next block, remembering these flows as the
+      // source's own. Sources with many flows and no pairs are given up on.
+      for (var id in insertedFlows.branches) {
+        ownFlowIds[id] = true;
+      }
+      for (var id in insertedFlows.uses) {
+        ownFlowIds[id] = true;
+      }
+      if (goog.object.getCount(ownFlowIds) >
+          wtf.db.Database.MAX_UNALIGNED_FLOWS_) {
+        this.referenceSources_[uid] = true;
+        delete this.unalignedFlowIds_[uid];
+      } else {
+        this.unalignedFlowIds_[uid] = ownFlowIds;
+      }
+      return;
+    }
+    clockAlignment.fit();
+    this.clockAlignments_[uid] = clockAlignment;
+    delete this.unalignedFlowIds_[uid];
+  }
+  if (clockAlignment.isIdentity()) {
+    return;
+  }
+
+  for (var n = 0; n < this.zoneList_.length; n++) {
+    var startIndex = n < this.beginningEventCounts_.length ?
+        this.beginningEventCounts_[n] : 0;
+    this.zoneList_[n].getEventList().alignTimes(startIndex, clockAlignment);
+  }
+};
+
+
+/**
+ * Flow events found by {@see #collectFlows_}, indexed by flow ID.
+ * Branch times are null if the flow was branched more than once. Use times
+ * are the earliest extend, terminate or append of the flow.
+ * @typedef {{
+ *   branches: !Object.<number, ?number>,
+ *   uses: !Object.<number, number>
+ * }}
+ * @private
+ */
+wtf.db.Database.Flows_;
+
+
+/**
+ * Maximum number of distinct flow IDs an unaligned source can insert without
+ * pairs before it is no longer retried.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.db.Database.MAX_UNALIGNED_FLOWS_ = 64 * 1024;
+
+
+/**
+ * Collects the flow events either added in the current insertion block or
+ * already in the database before it.
+ * Existing events are found with the type index of each zone, so only flow
+ * events are visited. Inserted events are not indexed yet and are scanned.
+ * @param {boolean} inserted True to collect the events added in the current
+ *     insertion block.
+ * @return {!wtf.db.Database.Flows_} Flows.
+ * @private
+ */
+wtf.db.Database.prototype.collectFlows_ = function(inserted) {
+  var flows = {
+    branches: {},
+    uses: {}
+  };
+  var branchType = this.eventTypeTable_.getByName('wtf.flow#branch');
+  if (!branchType) {
+    return flows;
+  }
+  var flowTypeIds = [branchType.id];
+  var useTypeIds = {};
+  var useTypeNames = [
+    'wtf.flow#extend', 'wtf.flow#terminate', 'wtf.flow#appendData'];
+  for (var n = 0; n < useTypeNames.length; n++) {
+    var useType = this.eventTypeTable_.getByName(useTypeNames[n]);
+    if (useType) {
+      useTypeIds[useType.id] = true;
+      flowTypeIds.push(useType.id);
+    }
+  }
+
+  for (var n = 0; n < this.zoneList_.length; n++) {
+    var eventList = this.zoneList_[n].getEventList();
+    var beginningCount = n < this.beginningEventCounts_.length ?
+        this.beginningEventCounts_[n] : 0;
+    var eventData = eventList.eventData;
+    var addFlow = function(o) {
+      var typeId = eventData[o + wtf.db.EventStruct.TYPE] & 0xFFFF;
+      var isBranch = typeId == branchType.id;
+      if (!isBranch && !useTypeIds[typeId]) {
+        return;
+      }
+      var id = eventList.getArgumentValue(
+          eventData[o + wtf.db.EventStruct.ARGUMENTS], 'id');
+      if (!goog.isNumber(id)) {
+        return;
+      }
+      var time = eventData[o + wtf.db.EventStruct.TIME];
+      if (isBranch) {
+        flows.branches[id] = id in flows.branches ? null : time;
+      } else if (!(id in flows.uses) || time < flows.uses[id]) {
+        flows.uses[id] = time;
+      }
+    };
+
+    var scanStart = beginningCount;
+    var scanEnd = eventList.count;
+    if (!inserted) {
+      var typeIndex = eventList.getTypeIndex();
+      var indexedCount = Math.min(
+          beginningCount, typeIndex.getIndexedCount());
+      typeIndex.queryRange(flowTypeIds, 0, indexedCount).forEach(
+          function(m) {
+            addFlow(m * wtf.db.EventStruct.STRUCT_SIZE);
+          });
+      scanStart = indexedCount;
+      scanEnd = beginningCount;
+    }
+    for (var m = scanStart, o = scanStart * wtf.db.EventStruct.STRUCT_SIZE;
+        m < scanEnd; m++, o += wtf.db.EventStruct.STRUCT_SIZE) {
+      addFlow(o);
+    }
+  }
+  return flows;
+};
+
+
 goog.exportSymbol(
     'wtf.db.Database',
     wtf.db.Database);
@@ -480,6 +761,9 @@ goog.exportProperty(
 goog.exportProperty(
     wtf.db.Database.prototype, 'getFirstFrameList',
     wtf.db.Database.prototype.getFirstFrameList);
+goog.exportProperty(
+    wtf.db.Database.prototype, 'getClockAlignment',
+    wtf.db.Database.prototype.getClockAlignment);
 goog.exportProperty(
     wtf.db.Database.prototype, 'getFirstEventTime',
     wtf.db.Database.prototype.getFirstEventTime);
@@ -16,13 +16,17 @@ goog.provide('wtf.db');
 goog.require('goog.asserts');
 goog.require('goog.async.Deferred');
 goog.require('goog.string');
+goog.require('wtf');
 goog.require('wtf.db.DataSourceInfo');
 goog.require('wtf.db.Database');
 goog.require('wtf.db.sources.ChunkedDataSource');
 goog.require('wtf.io');
 goog.require('wtf.io.cff.BinaryStreamSource');
+goog.require('wtf.io.cff.Chunk');
+goog.require('wtf.io.cff.ChunkType');
 goog.require('wtf.io.cff.JsonStreamSource');
 goog.require('wtf.io.transports.MemoryReadTransport');
+goog.require('wtf.io.transports.SeekableFileReadTransport');
 goog.require('wtf.pal');
 /** @suppress {extraRequire} */
 goog.require('wtf.pal.IPlatform');
@@ -62,8 +66,15 @@ wtf.db.load = function(input, callback, opt_scope) {
     var sourceInfo = new wtf.db.DataSourceInfo(input, '');
 
     // Filename.
-    if (goog.string.endsWith(input, '.wtf-trace')) {
-      // TODO(benvanik): can stream this from disk - create a custom readstream
+    if (goog.string.endsWith(input, '.wtf-trace') && wtf.NODE) {
+      // Read chunks from disk as needed instead of loading the whole file.
+      deferred = wtf.db.loadFileSource_(db, sourceInfo, input);
+      if (!deferred) {
+        goog.dispose(db);
+        callback.call(opt_scope, null);
+        return;
+      }
+    } else if (goog.string.endsWith(input, '.wtf-trace')) {
       var fileData = platform.readBinaryFile(input);
       if (!fileData) {
         goog.dispose(db);
@@ -106,6 +117,97 @@ wtf.db.load = function(input, callback, opt_scope) {
 };
 
 
+/**
+ * Loads part of a binary trace file into a database.
+ * Only events in the given time window and zones are added, and chunks that
+ * are entirely after the window are not read. This allows querying traces
+ * that are too large to load in their entirety.
+ *
+ * Options:
+ * <ul>
+ * <li>startTime: window start time, in ms. Defaults to the start of the trace.
+ * <li>endTime: window end time, in ms. Defaults to the end of the trace.
+ * <li>zones: list of zone names to load. Defaults to all zones.
+ * </ul>
+ *
+ * This is only supported in node.js.
+ *
+ * @param {string} filename Trace filename.
+ * @param {Object} options Load options.
+ * @param {!function(this:T, (wtf.db.Database|Error))} callback
+ *     A callback that will receive an event database, if it could be loaded.
+ *     If an error occurred an Error object will be passed.
+ * @param {T=} opt_scope Callback scope.
+ * @template T
+ */
+wtf.db.loadPaged = function(filename, options, callback, opt_scope) {
+  if (!wtf.NODE) {
+    callback.call(opt_scope, new Error('Paged loading requires node.js.'));
+    return;
+  }
+
+  var db = new wtf.db.Database();
+  var sourceInfo = new wtf.db.DataSourceInfo(filename, '');
+  var deferred = wtf.db.loadFileSource_(db, sourceInfo, filename, options);
+  if (!deferred) {
+    goog.dispose(db);
+    callback.call(opt_scope, new Error('Unable to open ' + filename));
+    return;
+  }
+
+  deferred.addCallbacks(function() {
+    callback.call(opt_scope, db);
+  }, function(e) {
+    callback.call(opt_scope, e);
+  });
+};
+
+
+/**
+ * Adds a binary data source that reads chunks from a file on disk.
+ * @param {!wtf.db.Database} db Database.
+ * @param {!wtf.db.DataSourceInfo} sourceInfo Data source info.
+ * @param {string} filename Trace filename.
+ * @param {Object=} opt_options Load options, as in {@see wtf.db.loadPaged}.
+ * @return {goog.async.Deferred} A deferred fulfilled when the source completes
+ *     loading, or null if the file could not be opened.
+ * @private
+ */
+wtf.db.loadFileSource_ = function(db, sourceInfo, filename, opt_options) {
+  var options = opt_options || {};
+  var startTime = goog.isDef(options['startTime']) ?
+      Number(options['startTime']) : 0;
+  var endTime = goog.isDef(options['endTime']) ?
+      Number(options['endTime']) : Number.MAX_VALUE;
+  var zoneNames = options['zones'] || null;
+
+  // Skip event data that starts after the window. Earlier chunks must still
+  // be read as they may define events or zones used in the window.
+  var rawEndTime = endTime * 1000;
+  var selector = function(entry) {
+    return entry.chunkType != wtf.io.cff.ChunkType.EVENT_DATA ||
+        entry.startTime == wtf.io.cff.Chunk.INVALID_TIME ||
+        entry.startTime <= rawEndTime;
+  };
+
+  var transport;
+  try {
+    transport = new wtf.io.transports.SeekableFileReadTransport(
+        filename, selector);
+  } catch (e) {
+    return null;
+  }
+  var streamSource = new wtf.io.cff.BinaryStreamSource(transport);
+  var dataSource = new wtf.db.sources.ChunkedDataSource(
+      db, sourceInfo, streamSource);
+  if (goog.isDef(options['startTime']) || goog.isDef(options['endTime']) ||
+      zoneNames) {
+    dataSource.setLoadFilter(startTime, endTime, zoneNames);
+  }
+  return dataSource.start();
+};
+
+
 /**
  * Adds a binary data source as an immediately-available stream.
  * @param {!wtf.db.Database} db Database.
@@ -160,3 +262,6 @@ wtf.db.loadJsonSource_ = function(db, sourceInfo, data) {
 goog.exportSymbol(
     'wtf.db.load',
     wtf.db.load);
+goog.exportSymbol(
+    'wtf.db.loadPaged',
+    wtf.db.loadPaged);
@@ -0,0 +1,727 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/**
+ * @fileoverview Compressed bitmap of event IDs.
+ * IDs are split by their high 16 bits into containers, as in roaring
+ * bitmaps. Sparse containers hold a sorted list of the low 16 bits and dense
+ * containers hold a 65536 bit set, so any container is at most 8KB and unions
+ * and intersections work on whole containers at a time.
+ *
+ * @author benvanik@google.com (Ben Vanik)
+ */
+
+goog.provide('wtf.db.EventBitmap');
+
+
+
+/**
+ * Compressed bitmap of event IDs.
+ * IDs are added in any order, but adding in ascending order (as is done when
+ * indexing an event list) is fastest.
+ *
+ * @constructor
+ */
+wtf.db.EventBitmap = function() {
+  /**
+   * High 16 bits of the IDs in each container, in ascending order.
+   * @type {!Array.<number>}
+   * @private
+   */
+  this.keys_ = [];
+
+  /**
+   * Containers, matching {@see #keys_}.
+   * Sparse containers are sorted Uint16Arrays that may have unused capacity
+   * at the end and dense containers are Uint32Array bit sets.
+   * @type {!Array.<!Uint16Array|!Uint32Array>}
+   * @private
+   */
+  this.containers_ = [];
+
+  /**
+   * Number of IDs in each container, matching {@see #keys_}.
+   * @type {!Array.<number>}
+   * @private
+   */
+  this.counts_ = [];
+
+  /**
+   * Total number of IDs.
+   * @type {number}
+   * @private
+   */
+  this.count_ = 0;
+};
+
+
+/**
+ * Maximum number of IDs in a sparse container.
+ * Past this a bit set is smaller.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.db.EventBitmap.MAX_SPARSE_COUNT_ = 4096;
+
+
+/**
+ * Number of 32-bit words in a dense container.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.db.EventBitmap.DENSE_WORD_COUNT_ = 2048;
+
+
+/**
+ * Removes all IDs.
+ */
+wtf.db.EventBitmap.prototype.clear = function() {
+  this.keys_.length = 0;
+  this.containers_.length = 0;
+  this.counts_.length = 0;
+  this.count_ = 0;
+};
+
+
+/**
+ * Gets the number of IDs in the bitmap.
+ * @return {number} ID count.
+ */
+wtf.db.EventBitmap.prototype.getCount = function() {
+  return this.count_;
+};
+
+
+/**
+ * Gets the approximate memory used by the containers.
+ * @return {number} Size, in bytes.
+ */
+wtf.db.EventBitmap.prototype.getMemoryUsage = function() {
+  var size = 0;
+  for (var n = 0; n < this.containers_.length; n++) {
+    size += this.containers_[n].byteLength;
+  }
+  return size;
+};
+
+
+/**
+ * Finds the index of the container with the given key.
+ * @param {number} key High 16 bits of an ID.
+ * @return {number} Container index, or the bitwise complement of the index to
+ *     insert at if it is not found.
+ * @private
+ */
+wtf.db.EventBitmap.prototype.findContainer_ = function(key) {
+  var keys = this.keys_;
+  // Fast path for appends.
+  var last = keys.length - 1;
+  if (last < 0 || keys[last] < key) {
+    return ~keys.length;
+  } else if (keys[last] == key) {
+    return last;
+  }
+  var low = 0;
+  var high = last;
+  while (low <= high) {
+    var mid = (low + high) >> 1;
+    if (keys[mid] < key) {
+      low = mid + 1;
+    } else if (keys[mid] > key) {
+      high = mid - 1;
+    } else {
+      return mid;
+    }
+  }
+  return ~low;
+};
+
+
+/**
+ * Adds an ID.
+ * @param {number} value Event ID.
+ */
+wtf.db.EventBitmap.prototype.add = function(value) {
+  var key = value >>> 16;
+  var low = value & 0xFFFF;
+  var index = this.findContainer_(key);
+  if (index < 0) {
+    index = ~index;
+    this.keys_.splice(index, 0, key);
+    this.containers_.splice(index, 0, new Uint16Array(4));
+    this.counts_.splice(index, 0, 0);
+  }
+
+  var container = this.containers_[index];
+  var count = this.counts_[index];
+  if (container instanceof Uint32Array) {
+    var bit = 1 << (low & 31);
+    if (container[low >> 5] & bit) {
+      return;
+    }
+    container[low >> 5] |= bit;
+  } else {
+    // Find the insertion point, favoring appends.
+    var at = count;
+    if (count && container[count - 1] >= low) {
+      at = wtf.db.EventBitmap.lowerBound_(container, count, low);
+      if (container[at] == low) {
+        return;
+      }
+    }
+    if (count == wtf.db.EventBitmap.MAX_SPARSE_COUNT_) {
+      container = wtf.db.EventBitmap.toDense_(container, count);
+      container[low >> 5] |= 1 << (low & 31);
+    } else {
+      if (count == container.length) {
+        var newContainer = new Uint16Array(Math.min(
+            count * 2, wtf.db.EventBitmap.MAX_SPARSE_COUNT_));
+        newContainer.set(container);
+        container = newContainer;
+      }
+      if (at < count) {
+        container.set(container.subarray(at, count), at + 1);
+      }
+      container[at] = low;
+    }
+    this.containers_[index] = container;
+  }
+  this.counts_[index] = count + 1;
+  this.count_++;
+};
+
+
+/**
+ * Checks whether the bitmap contains an ID.
+ * @param {number} value Event ID.
+ * @return {boolean} True if the ID has been added.
+ */
+wtf.db.EventBitmap.prototype.contains = function(value) {
+  var index = this.findContainer_(value >>> 16);
+  if (index < 0) {
+    return false;
+  }
+  var low = value & 0xFFFF;
+  var container = this.containers_[index];
+  if (container instanceof Uint32Array) {
+    return !!(container[low >> 5] & (1 << (low & 31)));
+  } else {
+    var count = this.counts_[index];
+    var at = wtf.db.EventBitmap.lowerBound_(container, count, low);
+    return at < count && container[at] == low;
+  }
+};
+
+
+/**
+ * Finds the smallest ID that is not less than the given one.
+ * @param {number} value Event ID.
+ * @return {number} ID, or -1 if all IDs are less.
+ */
+wtf.db.EventBitmap.prototype.nextValue = function(value) {
+  value = Math.max(value, 0);
+  var index = this.findContainer_(value >>> 16);
+  var low = value & 0xFFFF;
+  if (index < 0) {
+    index = ~index;
+    low = 0;
+  }
+  for (; index < this.keys_.length; index++, low = 0) {
+    var base = this.keys_[index] * 0x10000;
+    var container = this.containers_[index];
+    if (container instanceof Uint32Array) {
+      var mask = ~0 << (low & 31);
+      for (var m = low >> 5; m < container.length; m++, mask = ~0) {
+        var word = container[m] & mask;
+        if (word) {
+          var bit = 0;
+          while (!(word & (1 << bit))) {
+            bit++;
+          }
+          return base + (m << 5) + bit;
+        }
+      }
+    } else {
+      var count = this.counts_[index];
+      var at = wtf.db.EventBitmap.lowerBound_(container, count, low);
+      if (at < count) {
+        return base + container[at];
+      }
+    }
+  }
+  return -1;
+};
+
+
+/**
+ * Finds the largest ID that is not greater than the given one.
+ * @param {number} value Event ID.
+ * @return {number} ID, or -1 if all IDs are greater.
+ */
+wtf.db.EventBitmap.prototype.previousValue = function(value) {
+  if (value < 0) {
+    return -1;
+  }
+  var index = this.findContainer_(value >>> 16);
+  var low = value & 0xFFFF;
+  if (index < 0) {
+    index = ~index - 1;
+    low = 0xFFFF;
+  }
+  for (; index >= 0; index--, low = 0xFFFF) {
+    var base = this.keys_[index] * 0x10000;
+    var container = this.containers_[index];
+    if (container instanceof Uint32Array) {
+      var mask = (low & 31) == 31 ? ~0 : ~(~0 << ((low & 31) + 1));
+      for (var m = low >> 5; m >= 0; m--, mask = ~0) {
+        var word = container[m] & mask;
+        if (word) {
+          var bit = 31;
+          while (!(word & (1 << bit))) {
+            bit--;
+          }
+          return base + (m << 5) + bit;
+        }
+      }
+    } else {
+      var count = this.counts_[index];
+      var at = wtf.db.EventBitmap.lowerBound_(container, count, low + 1);
+      if (at) {
+        return base + container[at - 1];
+      }
+    }
+  }
+  return -1;
+};
+
+
+/**
+ * Calls a function for each ID, in ascending order.
+ * @param {function(this:T, number)} callback Function called with each ID.
+ * @param {T=} opt_scope Scope for the callback.
+ * @template T
+ */
+wtf.db.EventBitmap.prototype.forEach = function(callback, opt_scope) {
+  for (var n = 0; n < this.keys_.length; n++) {
+    var base = this.keys_[n] * 0x10000;
+    var container = this.containers_[n];
+    if (container instanceof Uint32Array) {
+      for (var m = 0; m < container.length; m++) {
+        var word = container[m];
+        for (var bit = 0; word; bit++, word >>>= 1) {
+          if (word & 1) {
+            callback.call(opt_scope, base + (m << 5) + bit);
+          }
+        }
+      }
+    } else {
+      var count = this.counts_[n];
+      for (var m = 0; m < count; m++) {
+        callback.call(opt_scope, base + container[m]);
+      }
+    }
+  }
+};
+
+
+/**
+ * Gets all IDs as a sorted list.
+ * @param {Array.<number>=} opt_target List to append the IDs to.
+ * @return {!Array.<number>} IDs.
+ */
+wtf.db.EventBitmap.prototype.toArray = function(opt_target) {
+  var result = opt_target || [];
+  this.forEach(function(value) {
+    result.push(value);
+  });
+  return result;
+};
+
+
+/**
+ * Gets the IDs in a range.
+ * @param {number} start First ID, inclusive.
+ * @param {number} end Last ID, exclusive.
+ * @return {!wtf.db.EventBitmap} New bitmap.
+ */
+wtf.db.EventBitmap.prototype.slice = function(start, end) {
+  var result = new wtf.db.EventBitmap();
+  if (start >= end) {
+    return result;
+  }
+  var startKey = start >>> 16;
+  var endKey = (end - 1) >>> 16;
+  var first = this.findContainer_(startKey);
+  for (var n = first < 0 ? ~first : first; n < this.keys_.length; n++) {
+    var key = this.keys_[n];
+    if (key > endKey) {
+      break;
+    }
+    var container = this.containers_[n];
+    var count = this.counts_[n];
+    if (key > startKey && key < endKey) {
+      // Wholly within the range.
+      result.push_(key, container, count);
+      continue;
+    }
+
+    var base = key * 0x10000;
+    var lowStart = Math.max(start - base, 0);
+    var lowEnd = Math.min(end - base, 0x10000);
+    if (container instanceof Uint32Array) {
+      var dense = new Uint32Array(container);
+      for (var m = 0; m < dense.length; m++) {
+        var wordStart = m << 5;
+        if (wordStart + 32 <= lowStart || wordStart >= lowEnd) {
+          dense[m] = 0;
+        } else {
+          if (wordStart < lowStart) {
+            dense[m] &= ~0 << (lowStart - wordStart);
+          }
+          if (wordStart + 32 > lowEnd) {
+            dense[m] &= ~(~0 << (lowEnd - wordStart));
+          }
+        }
+      }
+      result.pushDense_(key, dense);
+    } else {
+      var first = wtf.db.EventBitmap.lowerBound_(container, count, lowStart);
+      var last = wtf.db.EventBitmap.lowerBound_(container, count, lowEnd);
+      result.push_(key, container.subarray(first), last - first);
+    }
+  }
+  return result;
+};
+
+
+/**
+ * Computes the union of this bitmap with another.
+ * @param {!wtf.db.EventBitmap} other Other bitmap.
+ * @return {!wtf.db.EventBitmap} New bitmap.
+ */
+wtf.db.EventBitmap.prototype.union = function(other) {
+  var result = new wtf.db.EventBitmap();
+  var n = 0;
+  var m = 0;
+  while (n < this.keys_.length || m < other.keys_.length) {
+    var keyA = n < this.keys_.length ? this.keys_[n] : Infinity;
+    var keyB = m < other.keys_.length ? other.keys_[m] : Infinity;
+    if (keyA < keyB) {
+      result.push_(keyA, this.containers_[n], this.counts_[n]);
+      n++;
+    } else if (keyB < keyA) {
+      result.push_(keyB, other.containers_[m], other.counts_[m]);
+      m++;
+    } else {
+      var a = this.containers_[n];
+      var b = other.containers_[m];
+      var countA = this.counts_[n];
+      var countB = other.counts_[m];
+      if (a instanceof Uint16Array && b instanceof Uint16Array &&
+          countA + countB <= wtf.db.EventBitmap.MAX_SPARSE_COUNT_) {
+        var merged = new Uint16Array(countA + countB);
+        var count = wtf.db.EventBitmap.mergeSparse_(
+            a, countA, b, countB, merged);
+        result.pushSparse_(keyA, merged, count);
+      } else {
+        var dense = a instanceof Uint32Array ?
+            new Uint32Array(a) : wtf.db.EventBitmap.toDense_(a, countA);
+        if (b instanceof Uint32Array) {
+          for (var i = 0; i < dense.length; i++) {
+            dense[i] |= b[i];
+          }
+        } else {
+          for (var i = 0; i < countB; i++) {
+            dense[b[i] >> 5] |= 1 << (b[i] & 31);
+          }
+        }
+        result.pushDense_(keyA, dense);
+      }
+      n++;
+      m++;
+    }
+  }
+  return result;
+};
+
+
+/**
+ * Computes the intersection of this bitmap with another.
+ * @param {!wtf.db.EventBitmap} other Other bitmap.
+ * @return {!wtf.db.EventBitmap} New bitmap.
+ */
+wtf.db.EventBitmap.prototype.intersect = function(other) {
+  var result = new wtf.db.EventBitmap();
+  var n = 0;
+  var m = 0;
+  while (n < this.keys_.length && m < other.keys_.length) {
+    var keyA = this.keys_[n];
+    var keyB = other.keys_[m];
+    if (keyA < keyB) {
+      n++;
+      continue;
+    } else if (keyB < keyA) {
+      m++;
+      continue;
+    }
+    var a = this.containers_[n];
+    var b = other.containers_[m];
+    var countA = this.counts_[n];
+    var countB = other.counts_[m];
+    if (a instanceof Uint32Array && b instanceof Uint32Array) {
+      var dense = new Uint32Array(a);
+      for (var i = 0; i < dense.length; i++) {
+        dense[i] &= b[i];
+      }
+      result.pushDense_(keyA, dense);
+    } else {
+      // Filter the sparse side by the other.
+      var sparse = a instanceof Uint16Array ? a : b;
+      var sparseCount = a instanceof Uint16Array ? countA : countB;
+      var filter = sparse === a ? b : a;
+      var filterCount = sparse === a ? countB : countA;
+      var values = new Uint16Array(sparseCount);
+      var count = 0;
+      if (filter instanceof Uint32Array) {
+        for (var i = 0; i < sparseCount; i++) {
+          var low = sparse[i];
+          if (filter[low >> 5] & (1 << (low & 31))) {
+            values[count++] = low;
+          }
+        }
+      } else {
+        for (var i = 0, j = 0; i < sparseCount && j < filterCount;) {
+          if (sparse[i] < filter[j]) {
+            i++;
+          } else if (sparse[i] > filter[j]) {
+            j++;
+          } else {
+            values[count++] = sparse[i];
+            i++;
+            j++;
+          }
+        }
+      }
+      result.pushSparse_(keyA, values, count);
+    }
+    n++;
+    m++;
+  }
+  return result;
+};
+
+
+/**
+ * Computes the union of a list of bitmaps.
+ * @param {!Array.<!wtf.db.EventBitmap>} bitmaps Bitmaps.
+ * @return {!wtf.db.EventBitmap} New bitmap.
+ */
+wtf.db.EventBitmap.unionAll = function(bitmaps) {
+  var result = new wtf.db.EventBitmap();
+  for (var n = 0; n < bitmaps.length; n++) {
+    result = result.union(bitmaps[n]);
+  }
+  return result;
+};
+
+
+/**
+ * Appends a copy of a container after all existing ones.
+ * @param {number} key Container key.
+ * @param {!Uint16Array|!Uint32Array} container Container.
+ * @param {number} count Number of IDs in the container.
+ * @private
+ */
+wtf.db.EventBitmap.prototype.push_ = function(key, container, count) {
+  if (!count) {
+    return;
+  }
+  // Copy so later adds to either bitmap don't affect the other.
+  if (container instanceof Uint32Array) {
+    container = new Uint32Array(container);
+  } else {
+    container = new Uint16Array(container.subarray(0, count));
+  }
+  this.keys_.push(key);
+  this.containers_.push(container);
+  this.counts_.push(count);
+  this.count_ += count;
+};
+
+
+/**
+ * Appends a sparse container after all existing ones.
+ * @param {number} key Container key.
+ * @param {!Uint16Array} container Sparse container. Ownership is transferred.
+ * @param {number} count Number of IDs in the container.
+ * @private
+ */
+wtf.db.EventBitmap.prototype.pushSparse_ = function(key, container, count) {
+  if (!count) {
+    return;
+  }
+  this.keys_.push(key);
+  this.containers_.push(container);
+  this.counts_.push(count);
+  this.count_ += count;
+};
+
+
+/**
+ * Appends a dense container, converting it to a sparse one if it is small.
+ * @param {number} key Container key.
+ * @param {!Uint32Array} dense Dense container. Ownership is transferred.
+ * @private
+ */
+wtf.db.EventBitmap.prototype.pushDense_ = function(key, dense) {
+  var count = 0;
+  for (var n = 0; n < dense.length; n++) {
+    count += wtf.db.EventBitmap.bitCount_(dense[n]);
+  }
+  if (!count) {
+    return;
+  }
+  var container = dense;
+  if (count <= wtf.db.EventBitmap.MAX_SPARSE_COUNT_) {
+    container = new Uint16Array(count);
+    var i = 0;
+    for (var n = 0; n < dense.length; n++) {
+      var word = dense[n];
+      for (var bit = 0; word; bit++, word >>>= 1) {
+        if (word & 1) {
+          container[i++] = (n << 5) + bit;
+        }
+      }
+    }
+  }
+  this.keys_.push(key);
+  this.containers_.push(container);
+  this.counts_.push(count);
+  this.count_ += count;
+};
+
+
+/**
+ * Finds the first index in a sparse container with a value not less than the
+ * given one.
+ * @param {!Uint16Array} container Sparse container.
+ * @param {number} count Number of values in the container.
+ * @param {number} value Value to search for.
+ * @return {number} Index, or count if all values are less.
+ * @private
+ */
+wtf.db.EventBitmap.lowerBound_ = function(container, count, value) {
+  var low = 0;
+  var high = count;
+  while (low < high) {
+    var mid = (low + high) >> 1;
+    if (container[mid] < value) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+};
+
+
+/**
+ * Merges two sparse containers.
+ * @param {!Uint16Array} a First container.
+ * @param {number} countA Number of values in the first container.
+ * @param {!Uint16Array} b Second container.
+ * @param {number} countB Number of values in the second container.
+ * @param {!Uint16Array} target Target container, large enough for both.
+ * @return {number} Number of values written to the target.
+ * @private
+ */
+wtf.db.EventBitmap.mergeSparse_ = function(a, countA, b, countB, target) {
+  var count = 0;
+  var n = 0;
+  var m = 0;
+  while (n < countA && m < countB) {
+    if (a[n] < b[m]) {
+      target[count++] = a[n++];
+    } else if (a[n] > b[m]) {
+      target[count++] = b[m++];
+    } else {
+      target[count++] = a[n++];
+      m++;
+    }
+  }
+  while (n < countA) {
+    target[count++] = a[n++];
+  }
+  while (m < countB) {
+    target[count++] = b[m++];
+  }
+  return count;
+};
+
+
+/**
+ * Converts a sparse container to a dense one.
+ * @param {!Uint16Array} container Sparse container.
+ * @param {number} count Number of values in the container.
+ * @return {!Uint32Array} Dense container.
+ * @private
+ */
+wtf.db.EventBitmap.toDense_ = function(container, count) {
+  var dense = new Uint32Array(wtf.db.EventBitmap.DENSE_WORD_COUNT_);
+  for (var n = 0; n < count; n++) {
+    var low = container[n];
+    dense[low >> 5] |= 1 << (low & 31);
+  }
+  return dense;
+};
+
+
+/**
+ * Counts the set bits in a word.
+ * @param {number} value 32-bit value.
+ * @return {number} Number of set bits.
+ * @private
+ */
+wtf.db.EventBitmap.bitCount_ = function(value) {
+  value = value - ((value >>> 1) & 0x55555555);
+  value = (value & 0x33333333) + ((value >>> 2) & 0x33333333);
+  return (((value + (value >>> 4)) & 0x0F0F0F0F) * 0x01010101) >>> 24;
+};
+
+
+goog.exportSymbol(
+    'wtf.db.EventBitmap',
+    wtf.db.EventBitmap);
+goog.exportProperty(
+    wtf.db.EventBitmap.prototype, 'getCount',
+    wtf.db.EventBitmap.prototype.getCount);
+goog.exportProperty(
+    wtf.db.EventBitmap.prototype, 'contains',
+    wtf.db.EventBitmap.prototype.contains);
+goog.exportProperty(
+    wtf.db.EventBitmap.prototype, 'nextValue',
+    wtf.db.EventBitmap.prototype.nextValue);
+goog.exportProperty(
+    wtf.db.EventBitmap.prototype, 'previousValue',
+    wtf.db.EventBitmap.prototype.previousValue);
+goog.exportProperty(
+    wtf.db.EventBitmap.prototype, 'forEach',
+    wtf.db.EventBitmap.prototype.forEach);
+goog.exportProperty(
+    wtf.db.EventBitmap.prototype, 'toArray',
+    wtf.db.EventBitmap.prototype.toArray);
+goog.exportProperty(
+    wtf.db.EventBitmap.prototype, 'slice',
+    wtf.db.EventBitmap.prototype.slice);
+goog.exportProperty(
+    wtf.db.EventBitmap.prototype, 'union',
+    wtf.db.EventBitmap.prototype.union);
+goog.exportProperty(
+    wtf.db.EventBitmap.prototype, 'intersect',
+    wtf.db.EventBitmap.prototype.intersect);
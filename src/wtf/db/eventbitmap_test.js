@@ -0,0 +1,169 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+goog.provide('wtf.db.EventBitmap_test');
+
+goog.require('wtf.db.EventBitmap');
+goog.require('wtf.testing');
+
+
+/**
+ * wtf.db.EventBitmap testing.
+ */
+wtf.db.EventBitmap_test = suite('wtf.db.EventBitmap', function() {
+  /**
+   * Creates a bitmap with the given IDs.
+   * @param {!Array.<number>} values IDs.
+   * @return {!wtf.db.EventBitmap} Bitmap.
+   */
+  function createBitmap(values) {
+    var bitmap = new wtf.db.EventBitmap();
+    for (var n = 0; n < values.length; n++) {
+      bitmap.add(values[n]);
+    }
+    return bitmap;
+  };
+
+  /**
+   * Gets a list of every step-th ID in a range.
+   * @param {number} start First ID.
+   * @param {number} end Last ID, exclusive.
+   * @param {number} step Step.
+   * @return {!Array.<number>} IDs.
+   */
+  function range(start, end, step) {
+    var values = [];
+    for (var n = start; n < end; n += step) {
+      values.push(n);
+    }
+    return values;
+  };
+
+  test('#add', function() {
+    var bitmap = createBitmap([5, 1, 70000, 3, 1]);
+    assert.equal(bitmap.getCount(), 4);
+    assert.deepEqual(bitmap.toArray(), [1, 3, 5, 70000]);
+    assert.isTrue(bitmap.contains(70000));
+    assert.isFalse(bitmap.contains(2));
+    assert.isFalse(bitmap.contains(65539));
+
+    // Dense containers.
+    var values = range(0, 200000, 3);
+    bitmap = createBitmap(values);
+    assert.equal(bitmap.getCount(), values.length);
+    assert.deepEqual(bitmap.toArray(), values);
+    assert.isTrue(bitmap.contains(199998));
+    assert.isFalse(bitmap.contains(199999));
+  });
+
+  test('#nextValue', function() {
+    var sparse = createBitmap([3, 10, 70000]);
+    assert.equal(sparse.nextValue(0), 3);
+    assert.equal(sparse.nextValue(10), 10);
+    assert.equal(sparse.nextValue(11), 70000);
+    assert.equal(sparse.nextValue(70001), -1);
+    assert.equal(sparse.previousValue(2), -1);
+    assert.equal(sparse.previousValue(10), 10);
+    assert.equal(sparse.previousValue(69999), 10);
+    assert.equal(sparse.previousValue(1000000), 70000);
+
+    var dense = createBitmap(range(0, 140000, 3).concat([200031]));
+    assert.equal(dense.nextValue(65534), 65535);
+    assert.equal(dense.nextValue(65536), 65538);
+    assert.equal(dense.nextValue(139999), 200031);
+    assert.equal(dense.previousValue(65537), 65535);
+    assert.equal(dense.previousValue(200000), 139998);
+    assert.equal(dense.previousValue(200031), 200031);
+    assert.equal(new wtf.db.EventBitmap().nextValue(0), -1);
+    assert.equal(new wtf.db.EventBitmap().previousValue(0), -1);
+  });
+
+  test('#slice', function() {
+    var sparse = createBitmap(range(0, 200000, 1000));
+    assert.deepEqual(sparse.slice(1500, 4000).toArray(), [2000, 3000]);
+    assert.equal(sparse.slice(0, 200000).getCount(), 200);
+    assert.equal(sparse.slice(5, 5).getCount(), 0);
+
+    var dense = createBitmap(range(0, 200000, 2));
+    assert.deepEqual(
+        dense.slice(65531, 65541).toArray(),
+        [65532, 65534, 65536, 65538, 65540]);
+    assert.deepEqual(
+        dense.slice(1, 140001).toArray(), range(2, 140001, 2));
+  });
+
+  test('#union', function() {
+    var a = createBitmap(range(0, 100000, 2));
+    var b = createBitmap(range(0, 100000, 3));
+    var c = createBitmap([1, 300000]);
+    var result = wtf.db.EventBitmap.unionAll([a, b, c]);
+    var expected = [];
+    for (var n = 0; n < 100000; n++) {
+      if (n % 2 == 0 || n % 3 == 0 || n == 1) {
+        expected.push(n);
+      }
+    }
+    expected.push(300000);
+    assert.deepEqual(result.toArray(), expected);
+
+    // Sources are not modified.
+    result.add(7);
+    assert.isFalse(a.contains(7));
+    assert.equal(c.getCount(), 2);
+  });
+
+  test('#intersect', function() {
+    var a = createBitmap(range(0, 100000, 2));
+    var b = createBitmap(range(0, 100000, 3));
+    var c = createBitmap(range(0, 100000, 5001));
+    assert.deepEqual(a.intersect(b).toArray(), range(0, 100000, 6));
+    assert.deepEqual(c.intersect(a).toArray(), range(0, 100000, 10002));
+    assert.deepEqual(c.intersect(createBitmap(range(0, 100000, 10002)))
+        .toArray(), range(0, 100000, 10002));
+    assert.equal(c.intersect(new wtf.db.EventBitmap()).getCount(), 0);
+  });
+
+  test('TypeIndex', function() {
+    var eventList = wtf.testing.createEventList({
+      instanceEventTypes: [
+        'a#x()',
+        'b#y()',
+        'c#z()'
+      ],
+      events: [
+        [10, 'a#x'],
+        [20, 'b#y'],
+        [30, 'a#x'],
+        [40, 'c#z'],
+        [50, 'b#y']
+      ]
+    });
+    var typeIndex = eventList.getTypeIndex();
+    var eventTypeTable = eventList.eventTypeTable;
+    var a = eventTypeTable.getByName('a#x');
+    var b = eventTypeTable.getByName('b#y');
+    assert.equal(typeIndex.getCount(a.id), 2);
+    assert.deepEqual(typeIndex.query([a, b]).toArray(), [0, 1, 2, 4]);
+    assert.deepEqual(typeIndex.query([a, b], 20, 50).toArray(), [1, 2]);
+    assert.deepEqual(typeIndex.query([null]).toArray(), []);
+    assert.deepEqual(typeIndex.queryRange([a, b], 2, 5).toArray(), [2, 4]);
+    assert.deepEqual(typeIndex.queryRange([a], 1, 9).toArray(), [2]);
+    assert.deepEqual(typeIndex.queryRange([a, b], 3, 3).toArray(), []);
+
+    // Iterators seek through the index.
+    var it = eventList.begin();
+    it.nextOfType(b);
+    assert.equal(it.getIndex(), 1);
+    it.nextOfType(b.id);
+    assert.equal(it.getIndex(), 4);
+    it.nextOfType(b);
+    assert.isTrue(it.done());
+    it = eventList.beginTimeRange(0, 1);
+    it.nextOfType(a);
+    assert.isTrue(it.done());
+  });
+});
@@ -7,12 +7,16 @@
 
 /**
  * @fileoverview Custom event index.
+ * The index is a view of the zone's per-type bitmaps and does not scan the
+ * event list itself.
  *
  * @author benvanik@google.com (Ben Vanik)
  */
 
 goog.provide('wtf.db.EventIndex');
 
+goog.require('goog.array');
+goog.require('wtf.db.EventBitmap');
 goog.require('wtf.db.EventIterator');
 goog.require('wtf.db.IAncillaryList');
 goog.require('wtf.events.EventEmitter');
@@ -53,6 +57,27 @@ wtf.db.EventIndex = function(zone, eventNames) {
    */
   this.events_ = [];
 
+  /**
+   * Event types matching the event names, as of the last rebuild.
+   * @type {!Array.<wtf.db.EventType>}
+   * @private
+   */
+  this.eventTypes_ = [];
+
+  /**
+   * Whether the current rebuild is only adding appended events.
+   * @type {boolean}
+   * @private
+   */
+  this.appending_ = false;
+
+  /**
+   * Bitmap of the indexed events, built on demand.
+   * @type {wtf.db.EventBitmap}
+   * @private
+   */
+  this.bitmap_ = null;
+
   var eventList = this.zone_.getEventList();
   eventList.registerAncillaryList(this);
 };
@@ -107,12 +132,80 @@ wtf.db.EventIndex.prototype.begin = function() {
 };
 
 
+/**
+ * Begins iterating the events in the given time range.
+ * @param {number} startTime Start time, inclusive.
+ * @param {number} endTime End time, exclusive.
+ * @return {!wtf.db.EventIterator} Iterator.
+ */
+wtf.db.EventIndex.prototype.beginTimeRange = function(startTime, endTime) {
+  var eventList = this.zone_.getEventList();
+  var typeIndex = eventList.getTypeIndex();
+  var first = this.getFirstIndexOfId_(
+      typeIndex.getFirstIndexAtTime(startTime));
+  var last = this.getFirstIndexOfId_(
+      typeIndex.getFirstIndexAtTime(endTime)) - 1;
+  return new wtf.db.EventIterator(
+      eventList, first, last, first, this.events_);
+};
+
+
+/**
+ * Gets the position in the index of the first event with an ID not less than
+ * the given one.
+ * @param {number} id Event ID.
+ * @return {number} Position in the index.
+ * @private
+ */
+wtf.db.EventIndex.prototype.getFirstIndexOfId_ = function(id) {
+  var index = goog.array.binarySearch(this.events_, id);
+  return index < 0 ? -index - 1 : index;
+};
+
+
+/**
+ * Gets a bitmap of the events in the index.
+ * The bitmap can be combined with others from {@see wtf.db.TypeIndex}.
+ * @return {!wtf.db.EventBitmap} Bitmap. Do not modify.
+ */
+wtf.db.EventIndex.prototype.getBitmap = function() {
+  if (!this.bitmap_) {
+    var typeIndex = this.zone_.getEventList().getTypeIndex();
+    this.bitmap_ = typeIndex.query(this.eventTypes_);
+  }
+  return this.bitmap_;
+};
+
+
 /**
  * @override
  */
 wtf.db.EventIndex.prototype.beginRebuild = function(eventTypeTable) {
   this.events_.length = 0;
+  this.eventTypes_ = this.getEventTypes_(eventTypeTable);
+  this.appending_ = false;
+  // No events are requested as they come from the type index at the end.
+  return [];
+};
 
+
+/**
+ * @override
+ */
+wtf.db.EventIndex.prototype.beginAppend = function(eventTypeTable) {
+  this.eventTypes_ = this.getEventTypes_(eventTypeTable);
+  this.appending_ = true;
+  return [];
+};
+
+
+/**
+ * Gets the event types matching the event names of this index.
+ * @param {!wtf.db.EventTypeTable} eventTypeTable Event type table.
+ * @return {!Array.<wtf.db.EventType>} Event types, if defined.
+ * @private
+ */
+wtf.db.EventIndex.prototype.getEventTypes_ = function(eventTypeTable) {
   var eventTypes = [];
   for (var n = 0; n < this.eventNames_.length; n++) {
     eventTypes.push(eventTypeTable.getByName(this.eventNames_[n]));
@@ -124,16 +217,33 @@ wtf.db.EventIndex.prototype.beginRebuild = function(eventTypeTable) {
 /**
  * @override
  */
-wtf.db.EventIndex.prototype.handleEvent = function(
-    eventTypeIndex, eventType, it) {
-  this.events_.push(it.getId());
-};
+wtf.db.EventIndex.prototype.handleEvent = goog.nullFunction;
 
 
 /**
  * @override
  */
 wtf.db.EventIndex.prototype.endRebuild = function() {
+  var eventList = this.zone_.getEventList();
+  var typeIndex = eventList.getTypeIndex();
+  if (this.appending_ && this.events_.length) {
+    // New events are always after the existing ones, so just keep adding.
+    var lastId = this.events_[this.events_.length - 1];
+    var added = typeIndex.queryRange(
+        this.eventTypes_, lastId + 1, eventList.count);
+    var events = this.events_;
+    var bitmap = this.bitmap_;
+    added.forEach(function(id) {
+      events.push(id);
+      if (bitmap) {
+        bitmap.add(id);
+      }
+    });
+  } else {
+    this.bitmap_ = typeIndex.query(this.eventTypes_);
+    this.events_.length = 0;
+    this.bitmap_.toArray(this.events_);
+  }
   this.emitEvent(wtf.events.EventType.INVALIDATED);
 };
 
@@ -150,3 +260,9 @@ goog.exportProperty(
 goog.exportProperty(
     wtf.db.EventIndex.prototype, 'begin',
     wtf.db.EventIndex.prototype.begin);
+goog.exportProperty(
+    wtf.db.EventIndex.prototype, 'beginTimeRange',
+    wtf.db.EventIndex.prototype.beginTimeRange);
+goog.exportProperty(
+    wtf.db.EventIndex.prototype, 'getBitmap',
+    wtf.db.EventIndex.prototype.getBitmap);
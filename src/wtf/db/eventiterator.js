@@ -176,6 +176,37 @@ wtf.db.EventIterator.prototype.nextInstance = function() {
 };
 
 
+/**
+ * Moves to the next event of the given type.
+ * When the iterator walks the event list directly this is a lookup in the
+ * type index ({@see wtf.db.EventList#getTypeIndex}) rather than a scan.
+ * @param {wtf.db.EventType|number} eventType Event type or type ID.
+ */
+wtf.db.EventIterator.prototype.nextOfType = function(eventType) {
+  var typeId = goog.isNumber(eventType) ? eventType : eventType.id;
+  if (!this.indirectionTable_) {
+    var typeIndex = this.eventList_.getTypeIndex();
+    var indexedCount = typeIndex.getIndexedCount();
+    if (this.index_ + 1 < indexedCount) {
+      var bitmap = typeIndex.getBitmap(typeId);
+      var nextIndex = bitmap ? bitmap.nextValue(this.index_ + 1) : -1;
+      if (nextIndex >= 0) {
+        this.seek(nextIndex);
+        return;
+      }
+      // Scan any events after the indexed ones.
+      this.seek(indexedCount - 1);
+    }
+  }
+
+  // Indirected or not yet indexed, so scan.
+  this.next();
+  while (this.index_ <= this.lastIndex_ && this.getTypeId() != typeId) {
+    this.next();
+  }
+};
+
+
 /**
  * Moves the iterator to the next sibling event, skipping all descendants.
  */
@@ -465,9 +496,9 @@ wtf.db.EventIterator.prototype.resetArguments = function() {
  * @return {*} Argument value or undefined if not found.
  */
 wtf.db.EventIterator.prototype.getArgument = function(key) {
-  // TODO(benvanik): cache until move
-  var args = this.getArguments();
-  return args ? args[key] : undefined;
+  // Read directly from the argument table to avoid building the object.
+  var argsId = this.eventData_[this.offset_ + wtf.db.EventStruct.ARGUMENTS];
+  return argsId ? this.eventList_.getArgumentValue(argsId, key) : undefined;
 };
 
 
@@ -749,6 +780,9 @@ goog.exportProperty(
 goog.exportProperty(
     wtf.db.EventIterator.prototype, 'nextInstance',
     wtf.db.EventIterator.prototype.nextInstance);
+goog.exportProperty(
+    wtf.db.EventIterator.prototype, 'nextOfType',
+    wtf.db.EventIterator.prototype.nextOfType);
 goog.exportProperty(
     wtf.db.EventIterator.prototype, 'nextSibling',
     wtf.db.EventIterator.prototype.nextSibling);
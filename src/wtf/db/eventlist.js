@@ -12,15 +12,22 @@
  */
 
 goog.provide('wtf.db.EventList');
+goog.provide('wtf.db.EventListData');
 goog.provide('wtf.db.EventListStatistics');
 goog.provide('wtf.db.IAncillaryList');
 
 goog.require('goog.array');
 goog.require('wtf.data.EventClass');
 goog.require('wtf.data.EventFlag');
+goog.require('wtf.db.ArgumentTable');
+goog.require('wtf.db.ClockAlignment');
 goog.require('wtf.db.EventIterator');
 goog.require('wtf.db.EventStruct');
 goog.require('wtf.db.EventType');
+goog.require('wtf.db.IntervalIndex');
+goog.require('wtf.db.StatisticsIndex');
+goog.require('wtf.db.TypeIndex');
+goog.require('wtf.db.eventsort');
 goog.require('wtf.util');
 
 
@@ -52,7 +59,21 @@ wtf.db.IAncillaryList.prototype.handleEvent = goog.nullFunction;
 
 
 /**
- * Ends the current rebuild operation.
+ * Begins an incremental append operation.
+ * This is called instead of {@see #beginRebuild} when events have only been
+ * appended to the end of the list since the last rebuild. Only the new events
+ * will be dispatched to {@see #handleEvent}, followed by {@see #endRebuild}.
+ * Lists that cannot update incrementally should return null to receive a full
+ * rebuild instead.
+ * @param {!wtf.db.EventTypeTable} eventTypeTable Event type table.
+ * @return {Array.<!wtf.db.EventType>} Event types to handle or null to request
+ *     a full rebuild.
+ */
+wtf.db.IAncillaryList.prototype.beginAppend = goog.nullFunction;
+
+
+/**
+ * Ends the current rebuild or append operation.
  */
 wtf.db.IAncillaryList.prototype.endRebuild = goog.nullFunction;
 
@@ -69,6 +90,23 @@ wtf.db.IAncillaryList.prototype.endRebuild = goog.nullFunction;
 wtf.db.EventListStatistics;
 
 
+/**
+ * Fully rebuilt event list contents in a form that can be posted across
+ * threads. The event data buffer is designed to be transferred.
+ * @typedef {{
+ *   count: number,
+ *   eventData: !Uint32Array,
+ *   argumentTable: !wtf.db.ArgumentTableData,
+ *   statistics: !wtf.db.EventListStatistics,
+ *   firstEventTime: number,
+ *   lastEventTime: number,
+ *   hiddenCount: number,
+ *   maximumScopeDepth: number
+ * }}
+ */
+wtf.db.EventListData;
+
+
 
 /**
  * Event data list.
@@ -124,12 +162,12 @@ wtf.db.EventList = function(eventTypeTable) {
   this.eventData = new Uint32Array(0);
 
   /**
-   * Argument data hash.
-   * Index 0 is reserved.
-   * @type {!Array.<wtf.db.ArgumentData>}
+   * Argument data, stored by column.
+   * The ARGUMENTS field of each event is an ID in this table.
+   * @type {!wtf.db.ArgumentTable}
    * @private
    */
-  this.argumentData_ = [null];
+  this.argumentTable_ = new wtf.db.ArgumentTable();
 
   /**
    * Original argument data hash.
@@ -141,13 +179,6 @@ wtf.db.EventList = function(eventTypeTable) {
    */
   this.originalArgumentData_ = {};
 
-  /**
-   * The next ID to assign to inserted argument data.
-   * @type {number}
-   * @private
-   */
-  this.nextArgumentDataId_ = 1;
-
   /**
    * First event time, if any.
    * @type {number}
@@ -190,6 +221,143 @@ wtf.db.EventList = function(eventTypeTable) {
    * @private
    */
   this.resortNeeded_ = false;
+
+  /**
+   * Whether the event data was imported already sorted and scoped via
+   * {@see #importData} and the next rebuild only needs to update the
+   * ancillary lists.
+   * @type {boolean}
+   * @private
+   */
+  this.importedRebuilt_ = false;
+
+  /**
+   * The number of events that have been scoped by {@see #rescopeEvents_}.
+   * If new events are appended without requiring a resort only the events
+   * after this are scoped on the next rebuild.
+   * @type {number}
+   * @private
+   */
+  this.rescopedCount_ = 0;
+
+  /**
+   * Scope stack state at the end of the last scoping pass.
+   * Retained so that scoping can resume with any still-open scopes when new
+   * events are appended.
+   * @type {!wtf.db.EventList.ScopeState_}
+   * @private
+   */
+  this.scopeState_ = new wtf.db.EventList.ScopeState_();
+
+  /**
+   * Interval index of all scopes, maintained while scoping.
+   * @type {!wtf.db.IntervalIndex}
+   * @private
+   */
+  this.intervalIndex_ = new wtf.db.IntervalIndex(this);
+
+  /**
+   * Cached per-block event statistics.
+   * @type {!wtf.db.StatisticsIndex}
+   * @private
+   */
+  this.statisticsIndex_ = new wtf.db.StatisticsIndex(this);
+
+  /**
+   * Bitmaps of the events of each type, maintained while rebuilding.
+   * @type {!wtf.db.TypeIndex}
+   * @private
+   */
+  this.typeIndex_ = new wtf.db.TypeIndex(this);
+};
+
+
+/**
+ * Maximum scope depth supported by the scoping pass.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.db.EventList.MAX_CALLSTACK_SIZE_ = 1024;
+
+
+
+/**
+ * Scope stack state used while scoping events.
+ * @constructor
+ * @private
+ */
+wtf.db.EventList.ScopeState_ = function() {
+  var size = wtf.db.EventList.MAX_CALLSTACK_SIZE_;
+
+  /**
+   * Event IDs of the open scopes.
+   * @type {!Uint32Array}
+   */
+  this.stack = new Uint32Array(size);
+
+  /**
+   * Event types of the open scopes.
+   * @type {!Array.<wtf.db.EventType>}
+   */
+  this.typeStack = new Array(size);
+
+  /**
+   * Maximum descendant depth of each open scope.
+   * @type {!Uint32Array}
+   */
+  this.maxDepthStack = new Uint32Array(size);
+
+  /**
+   * Accumulated child time of each open scope.
+   * @type {!Uint32Array}
+   */
+  this.childTimeStack = new Uint32Array(size);
+
+  /**
+   * Accumulated system time of each open scope.
+   * @type {!Uint32Array}
+   */
+  this.systemTimeStack = new Uint32Array(size);
+
+  /**
+   * Current top of the stack. 0 is the root.
+   * @type {number}
+   */
+  this.stackTop = 0;
+
+  /**
+   * Maximum stack depth seen.
+   * @type {number}
+   */
+  this.stackMax = 0;
+
+  /**
+   * Number of hidden events seen.
+   * @type {number}
+   */
+  this.hiddenCount = 0;
+
+  this.reset();
+};
+
+
+/**
+ * Resets the state to an empty stack.
+ */
+wtf.db.EventList.ScopeState_.prototype.reset = function() {
+  // Accumulators are only cleared when scopes close, so left-over values from
+  // scopes that never closed must be cleared here.
+  for (var n = 0; n < this.stack.length; n++) {
+    this.maxDepthStack[n] = 0;
+    this.childTimeStack[n] = 0;
+    this.systemTimeStack[n] = 0;
+  }
+  this.stack[0] = -1;
+  this.typeStack[0] = null;
+  this.stackTop = 0;
+  this.stackMax = 0;
+  this.hiddenCount = 0;
 };
 
 
@@ -326,9 +494,7 @@ wtf.db.EventList.prototype.insert = function(eventType, time, opt_argData) {
 
   // If we were provided argument data, set here.
   if (opt_argData) {
-    var args = opt_argData;
-    var argsId = this.nextArgumentDataId_++;
-    this.argumentData_[argsId] = args;
+    var argsId = this.argumentTable_.add(eventType, opt_argData);
     eventData[o + wtf.db.EventStruct.ARGUMENTS] = argsId;
   }
 
@@ -344,12 +510,32 @@ wtf.db.EventList.prototype.insert = function(eventType, time, opt_argData) {
 
 /**
  * Rebuilds the internal event list data after a batch insertion.
+ * If the events inserted since the last rebuild were all appended in time
+ * order only the new events (and any scopes still open) are processed.
  */
 wtf.db.EventList.prototype.rebuild = function() {
+  // Imported data has already been sorted and scoped elsewhere.
+  if (this.importedRebuilt_) {
+    this.importedRebuilt_ = false;
+    this.statisticsIndex_.reset();
+    this.typeIndex_.reset();
+    this.rebuildAncillaryLists_(this.ancillaryLists_);
+    return;
+  }
+
   // Sort all events by time|id.
+  // Sorting invalidates all scoping and ancillary data.
   if (this.resortNeeded_) {
     this.resortEvents_();
     this.resortNeeded_ = false;
+    this.rescopedCount_ = 0;
+  }
+
+  if (this.rescopedCount_) {
+    if (this.rescopedCount_ < this.count) {
+      this.rebuildAppended_();
+    }
+    return;
   }
 
   // Reset stats.
@@ -371,7 +557,9 @@ wtf.db.EventList.prototype.rebuild = function() {
   // Setup all scopes.
   // This builds parenting relationships and computes times.
   // It must occur after renumbering so that references are valid.
-  this.rescopeEvents_();
+  this.rescopeEvents_(0);
+  this.statisticsIndex_.reset();
+  this.typeIndex_.reset();
 
   // Rebuild all ancillary lists.
   this.rebuildAncillaryLists_(this.ancillaryLists_);
@@ -379,60 +567,45 @@ wtf.db.EventList.prototype.rebuild = function() {
 
 
 /**
- * Resorts all event data in the backing buffer to be in time|id order.
+ * Incrementally rebuilds the events appended since the last rebuild.
  * @private
  */
-wtf.db.EventList.prototype.resortEvents_ = function() {
-  var eventData = this.eventData;
+wtf.db.EventList.prototype.rebuildAppended_ = function() {
+  var startIndex = this.rescopedCount_;
 
-  // Build the sort index, used for sorting.
-  // This allows us to run the sort and just shift around indices instead of
-  // shifting around the real event data.
-  var sortIndex = new Array(this.count);
-  for (var n = 0; n < sortIndex.length; n++) {
-    sortIndex[n] = n;
-  }
-
-  // Sort.
-  sortIndex.sort(function(ai, bi) {
-    var ao = ai * wtf.db.EventStruct.STRUCT_SIZE;
-    var bo = bi * wtf.db.EventStruct.STRUCT_SIZE;
-    var atime = eventData[ao + wtf.db.EventStruct.TIME];
-    var btime = eventData[bo + wtf.db.EventStruct.TIME];
-    if (atime == btime) {
-      return eventData[ao + wtf.db.EventStruct.ID] -
-          eventData[bo + wtf.db.EventStruct.ID];
-    }
-    return atime - btime;
-  });
-
-  // Rearrange the event data by the new sort index.
-  // TODO(benvanik): do this in-place without the duplication.
-  var newData = new Uint32Array(eventData.length);
-  for (var n = 0; n < sortIndex.length; n++) {
-    var oldOffset = sortIndex[n] * wtf.db.EventStruct.STRUCT_SIZE;
-    var newOffset = n * wtf.db.EventStruct.STRUCT_SIZE;
-    for (var si = oldOffset, di = newOffset;
-        si < oldOffset + wtf.db.EventStruct.STRUCT_SIZE; si++, di++) {
-      newData[di] = eventData[si];
-    }
-  }
+  this.statistics_.totalCount = this.count;
 
-  // Renumber all events to match their current order.
-  for (var n = 0, o = 0; n < this.count; n++) {
-    newData[o + wtf.db.EventStruct.ID] = n;
-    o += wtf.db.EventStruct.STRUCT_SIZE;
-  }
+  // Scope the new tail, resuming with the open scopes.
+  // Blocks holding scopes that were open are never cached, so only the blocks
+  // holding the new events need to be recomputed.
+  this.rescopeEvents_(startIndex);
+  this.statisticsIndex_.invalidateFrom(startIndex);
 
-  this.eventData = newData;
+  var it = new wtf.db.EventIterator(this, 0, this.count - 1, this.count - 1);
+  this.lastEventTime_ = it.isScope() ? it.getEndTime() : it.getTime();
+
+  // Update ancillary lists with only the new events.
+  this.rebuildAncillaryLists_(this.ancillaryLists_, startIndex);
+};
+
+
+/**
+ * Resorts all event data in the backing buffer to be in time|id order.
+ * @private
+ */
+wtf.db.EventList.prototype.resortEvents_ = function() {
+  // Sorted in place, so no need to reallocate the event data.
+  wtf.db.eventsort.sort(this.eventData, this.count);
 };
 
 
 /**
  * Rebuilds the scoping data of events.
+ * @param {number} startIndex Index of the first event to scope. If non-zero
+ *     scoping resumes with the scope state left by the previous pass.
  * @private
  */
-wtf.db.EventList.prototype.rescopeEvents_ = function() {
+wtf.db.EventList.prototype.rescopeEvents_ = function(startIndex) {
   // All events used are already declared.
   var scopeEnter = this.eventTypeTable.getByName('wtf.scope#enter');
   var scopeEnterId = scopeEnter ? scopeEnter.id : -1;
@@ -444,25 +617,45 @@ wtf.db.EventList.prototype.rescopeEvents_ = function() {
   var timeStampId = timeStamp ? timeStamp.id : -1;
 
   // This stack is used to track the currently active scopes while scanning
-  // forward.
-  var MAX_CALLSTACK_SIZE = 1024;
-  var stack = new Uint32Array(MAX_CALLSTACK_SIZE);
-  var typeStack = new Array(MAX_CALLSTACK_SIZE);
-  var maxDepthStack = new Uint32Array(MAX_CALLSTACK_SIZE);
-  var childTimeStack = new Uint32Array(MAX_CALLSTACK_SIZE);
-  var systemTimeStack = new Uint32Array(MAX_CALLSTACK_SIZE);
-  var stackTop = 0;
-  var stackMax = 0;
-  stack[0] = -1;
-  typeStack[0] = null;
-
-  var hiddenCount = 0;
+  // forward. It is retained across passes.
+  var MAX_CALLSTACK_SIZE = wtf.db.EventList.MAX_CALLSTACK_SIZE_;
+  var state = this.scopeState_;
+  var intervalIndex = this.intervalIndex_;
+  if (!startIndex) {
+    state.reset();
+    intervalIndex.reset();
+  }
+  var stack = state.stack;
+  var typeStack = state.typeStack;
+  var maxDepthStack = state.maxDepthStack;
+  var childTimeStack = state.childTimeStack;
+  var systemTimeStack = state.systemTimeStack;
+  var stackTop = state.stackTop;
+  var stackMax = state.stackMax;
+
+  var hiddenCount = state.hiddenCount;
+
+  // The previous last event had no next sibling; link it to the new tail.
+  var eventData = this.eventData;
+  if (startIndex) {
+    var lastOffset = (startIndex - 1) * wtf.db.EventStruct.STRUCT_SIZE;
+    var lastTypeId = eventData[lastOffset + wtf.db.EventStruct.TYPE] & 0xFFFF;
+    if (lastTypeId == scopeLeaveId) {
+      // The scope the leave closed is the one that needs the sibling.
+      var leftScopeId = eventData[lastOffset + wtf.db.EventStruct.PARENT];
+      if (leftScopeId != 0xFFFFFFFF) {
+        eventData[leftScopeId * wtf.db.EventStruct.STRUCT_SIZE +
+            wtf.db.EventStruct.NEXT_SIBLING] = startIndex;
+      }
+    } else {
+      eventData[lastOffset + wtf.db.EventStruct.NEXT_SIBLING] = startIndex;
+    }
+  }
 
   // Directly poke into the event data array for speed.
   var statistics = this.statistics_;
-  var eventData = this.eventData;
-  for (var n = 0, o = 0; n < this.count;
-      n++, o += wtf.db.EventStruct.STRUCT_SIZE) {
+  for (var n = startIndex, o = startIndex * wtf.db.EventStruct.STRUCT_SIZE;
+      n < this.count; n++, o += wtf.db.EventStruct.STRUCT_SIZE) {
     var parentId = stack[stackTop];
     eventData[o + wtf.db.EventStruct.PARENT] = parentId;
     eventData[o + wtf.db.EventStruct.DEPTH] = stackTop | (stackTop << 16);
@@ -481,9 +674,9 @@ wtf.db.EventList.prototype.rescopeEvents_ = function() {
     if (typeId == scopeEnterId) {
       // Generic scope enter.
       // We replace this with an on-demand event type.
-      var args =
-          this.argumentData_[eventData[o + wtf.db.EventStruct.ARGUMENTS]];
-      var name = /** @type {string} */ (args['name']) || 'unnamed.scope';
+      var name = /** @type {string} */ (this.argumentTable_.getValue(
+          eventData[o + wtf.db.EventStruct.ARGUMENTS], 'name')) ||
+          'unnamed.scope';
       var newEventType = this.eventTypeTable.getByName(name);
       if (!newEventType) {
         newEventType = this.eventTypeTable.defineType(
@@ -492,6 +685,7 @@ wtf.db.EventList.prototype.rescopeEvents_ = function() {
       typeId = newEventType.id;
       eventData[o + wtf.db.EventStruct.TYPE] =
           newEventType.id | (newEventType.flags << 16);
+      intervalIndex.addScope(stackTop, n);
       stack[++stackTop] = eventData[o + wtf.db.EventStruct.ID];
       typeStack[stackTop] = newEventType;
       maxDepthStack[stackTop] = stackTop - 1;
@@ -549,9 +743,9 @@ wtf.db.EventList.prototype.rescopeEvents_ = function() {
     } else if (typeId == timeStampId) {
       // Generic timestamp.
       // Replace with an on-demand event type.
-      var args =
-          this.argumentData_[eventData[o + wtf.db.EventStruct.ARGUMENTS]];
-      var name = /** @type {string} */ (args['name']) || 'unnamed.instance';
+      var name = /** @type {string} */ (this.argumentTable_.getValue(
+          eventData[o + wtf.db.EventStruct.ARGUMENTS], 'name')) ||
+          'unnamed.instance';
       var newEventType = this.eventTypeTable.getByName(name);
       if (!newEventType) {
         newEventType = this.eventTypeTable.defineType(
@@ -567,6 +761,7 @@ wtf.db.EventList.prototype.rescopeEvents_ = function() {
       var type = this.eventTypeTable.getById(typeId);
       if (type.eventClass == wtf.data.EventClass.SCOPE) {
         // Scope enter.
+        intervalIndex.addScope(stackTop, n);
         stack[++stackTop] = eventData[o + wtf.db.EventStruct.ID];
         typeStack[stackTop] = type;
         maxDepthStack[stackTop] = stackTop - 1;
@@ -592,7 +787,7 @@ wtf.db.EventList.prototype.rescopeEvents_ = function() {
 
     if (deleteArgs) {
       var argsId = eventData[o + wtf.db.EventStruct.ARGUMENTS];
-      this.argumentData_[argsId] = null;
+      this.argumentTable_.release(argsId);
       eventData[o + wtf.db.EventStruct.ARGUMENTS] = 0;
     }
 
@@ -602,6 +797,11 @@ wtf.db.EventList.prototype.rescopeEvents_ = function() {
     }
   }
 
+  state.stackTop = stackTop;
+  state.stackMax = stackMax;
+  state.hiddenCount = hiddenCount;
+  this.rescopedCount_ = this.count;
+
   this.hiddenCount_ = hiddenCount;
   this.maximumScopeDepth_ = stackMax;
 };
@@ -630,17 +830,16 @@ wtf.db.EventList.prototype.appendScopeData_ = function(
   var scopeArgsId = eventData[o + wtf.db.EventStruct.ARGUMENTS];
   var scopeArgs = null;
   if (scopeArgsId) {
-    // Grab args.
-    scopeArgs = this.argumentData_[scopeArgsId];
+    // Grab args. They are moved out of column storage to be modified.
+    scopeArgs = this.argumentTable_.getMutable(scopeArgsId);
   } else {
     // Scope had no args, so create.
     scopeArgs = {};
-    scopeArgsId = this.nextArgumentDataId_++;
-    this.argumentData_[scopeArgsId] = scopeArgs;
+    scopeArgsId = this.argumentTable_.set(0, scopeArgs);
     eventData[o + wtf.db.EventStruct.ARGUMENTS] = scopeArgsId;
   }
 
-  var srcArgs = this.argumentData_[argsId];
+  var srcArgs = this.argumentTable_.get(argsId);
   if (!srcArgs) {
     // Not normally possible, but a user could do it.
     return;
@@ -662,20 +861,38 @@ wtf.db.EventList.prototype.appendScopeData_ = function(
 /**
  * Rebuilds dependent ancillary lists.
  * @param {!Array.<!wtf.db.IAncillaryList>} lists Lists.
+ * @param {number=} opt_startIndex Index of the first appended event. If
+ *     provided lists are updated incrementally (if they support it) with only
+ *     the events from this index on.
  * @private
  */
-wtf.db.EventList.prototype.rebuildAncillaryLists_ = function(lists) {
+wtf.db.EventList.prototype.rebuildAncillaryLists_ = function(
+    lists, opt_startIndex) {
+  // Index the types of any new events. The lists are then fed from the
+  // bitmaps of the types they want instead of by scanning all events.
+  this.typeIndex_.update();
   if (!lists.length) {
     return;
   }
+  var startIndex = opt_startIndex || 0;
 
   // Map of type ids -> list of ancillary lists and the types they registered.
   var typeMap = {};
+  var typeIds = [];
+
+  // Lists that could not be updated incrementally.
+  var fullRebuildLists = [];
 
   // Begin rebuild on all lists to gather types that we need.
   for (var n = 0; n < lists.length; n++) {
     var list = lists[n];
-    var desiredTypes = list.beginRebuild(this.eventTypeTable);
+    var desiredTypes = startIndex ?
+        list.beginAppend(this.eventTypeTable) :
+        list.beginRebuild(this.eventTypeTable);
+    if (!desiredTypes) {
+      fullRebuildLists.push(list);
+      continue;
+    }
     for (var m = 0; m < desiredTypes.length; m++) {
       var desiredType = desiredTypes[m];
       if (!desiredType) {
@@ -684,6 +901,7 @@ wtf.db.EventList.prototype.rebuildAncillaryLists_ = function(lists) {
       var handlers = typeMap[desiredType.id];
       if (!handlers) {
         typeMap[desiredType.id] = handlers = [];
+        typeIds.push(desiredType.id);
       }
       handlers.push({
         list: list,
@@ -693,27 +911,35 @@ wtf.db.EventList.prototype.rebuildAncillaryLists_ = function(lists) {
     }
   }
 
-  // Run through all events and dispatch to their handlers.
-  var eventData = this.eventData;
-  var it = new wtf.db.EventIterator(this, 0, this.count - 1, 0);
-  for (var n = 0, o = 0; n < this.count; n++) {
-    var typeId = eventData[o + wtf.db.EventStruct.TYPE] & 0xFFFF;
-    var handlers = typeMap[typeId];
-    if (handlers) {
+  // Run through all matching events in order and dispatch to their handlers.
+  if (typeIds.length) {
+    var eventData = this.eventData;
+    var it = new wtf.db.EventIterator(this, 0, this.count - 1, startIndex);
+    var bitmap = this.typeIndex_.queryRange(typeIds, startIndex, this.count);
+    bitmap.forEach(function(n) {
+      var typeId = eventData[
+          n * wtf.db.EventStruct.STRUCT_SIZE + wtf.db.EventStruct.TYPE] &
+          0xFFFF;
+      var handlers = typeMap[typeId];
       for (var m = 0; m < handlers.length; m++) {
         // Reset the iterator each handler in case the handler messes with it.
         it.seek(n);
         var handler = handlers[m];
         handler.list.handleEvent(handler.eventTypeIndex, handler.eventType, it);
       }
-    }
-    o += wtf.db.EventStruct.STRUCT_SIZE;
+    });
   }
 
   // Call end rebuild so the lists can clean up.
   for (var n = 0; n < lists.length; n++) {
     var list = lists[n];
-    list.endRebuild();
+    if (!goog.array.contains(fullRebuildLists, list)) {
+      list.endRebuild();
+    }
+  }
+
+  if (fullRebuildLists.length) {
+    this.rebuildAncillaryLists_(fullRebuildLists);
   }
 };
 
@@ -724,7 +950,27 @@ wtf.db.EventList.prototype.rebuildAncillaryLists_ = function(lists) {
  * @return {wtf.db.ArgumentData} Argument data, if any.
  */
 wtf.db.EventList.prototype.getArgumentData = function(argsId) {
-  return this.argumentData_[argsId] || null;
+  return this.argumentTable_.get(argsId);
+};
+
+
+/**
+ * Gets a single argument value without materializing the argument data.
+ * @param {number} argsId Key into the argument data table.
+ * @param {string} key Argument name.
+ * @return {*} Argument value or undefined if not found.
+ */
+wtf.db.EventList.prototype.getArgumentValue = function(argsId, key) {
+  return this.argumentTable_.getValue(argsId, key);
+};
+
+
+/**
+ * Gets the argument table backing the list.
+ * @return {!wtf.db.ArgumentTable} Argument table.
+ */
+wtf.db.EventList.prototype.getArgumentTable = function() {
+  return this.argumentTable_;
 };
 
 
@@ -737,21 +983,19 @@ wtf.db.EventList.prototype.getArgumentData = function(argsId) {
  * @return {number} Arguments ID passed in or a new value if the param was 0.
  */
 wtf.db.EventList.prototype.setArgumentData = function(argsId, values) {
-  if (!argsId) {
-    // Allocate new argument data.
-    argsId = this.nextArgumentDataId_++;
-  }
-
   // Stash off the existing data we are overriding.
   // We want to support many sets, so only stash as original if this is
   // the first time.
-  if (this.originalArgumentData_[argsId] === undefined) {
-    this.originalArgumentData_[argsId] = this.argumentData_[argsId] || null;
+  if (argsId && this.originalArgumentData_[argsId] === undefined) {
+    this.originalArgumentData_[argsId] = this.argumentTable_.get(argsId);
   }
 
-  // Set.
-  this.argumentData_[argsId] = values;
-  return argsId;
+  // Set, allocating new argument data if needed.
+  var newArgsId = this.argumentTable_.set(argsId, values);
+  if (!argsId) {
+    this.originalArgumentData_[newArgsId] = null;
+  }
+  return newArgsId;
 };
 
 
@@ -763,12 +1007,199 @@ wtf.db.EventList.prototype.setArgumentData = function(argsId, values) {
 wtf.db.EventList.prototype.resetArgumentData = function(argsId) {
   var originalArgs = this.originalArgumentData_[argsId];
   if (originalArgs !== undefined) {
-    this.argumentData_[argsId] = originalArgs;
+    this.argumentTable_.set(argsId, originalArgs);
     delete this.originalArgumentData_[argsId];
   }
 };
 
 
+/**
+ * Exports the rebuilt contents of the event list.
+ * The returned event data is sized to the event count so that its buffer can
+ * be transferred to another thread. The list should be discarded after
+ * exporting if the buffer is transferred.
+ * @return {!wtf.db.EventListData} Event list data.
+ */
+wtf.db.EventList.prototype.exportData = function() {
+  var eventData = this.eventData;
+  var length = this.count * wtf.db.EventStruct.STRUCT_SIZE;
+  if (eventData.length != length) {
+    eventData = new Uint32Array(eventData.subarray(0, length));
+  }
+  return {
+    count: this.count,
+    eventData: eventData,
+    argumentTable: this.argumentTable_.exportData(),
+    statistics: this.statistics_,
+    firstEventTime: this.firstEventTime_,
+    lastEventTime: this.lastEventTime_,
+    hiddenCount: this.hiddenCount_,
+    maximumScopeDepth: this.maximumScopeDepth_
+  };
+};
+
+
+/**
+ * Imports event list data exported by {@see #exportData}, usually from a list
+ * rebuilt on another thread.
+ * If this list is empty the data is adopted directly and the next
+ * {@see #rebuild} only updates ancillary lists. Otherwise the events are
+ * appended. If they all follow the existing events only the new events are
+ * scoped on the next rebuild, otherwise the two sorted runs are merged and
+ * everything is rescoped.
+ *
+ * This must be called within an insertion block.
+ *
+ * @param {!wtf.db.EventListData} data Event list data. The event data array
+ *     is modified in place and may be retained.
+ * @param {!Array.<number>} typeIdMap A mapping of event type IDs in the data
+ *     to event type IDs in this list's event type table.
+ * @param {number} timeShift Time to add to all event times.
+ */
+wtf.db.EventList.prototype.importData = function(data, typeIdMap, timeShift) {
+  var count = data.count;
+  var eventData = data.eventData;
+  if (!count) {
+    return;
+  }
+
+  // Remap type IDs and shift times into our timebase.
+  // Type flags are preserved even if the IDs change.
+  var identityMap = true;
+  for (var n = 1; n < typeIdMap.length; n++) {
+    if (typeIdMap[n] !== undefined && typeIdMap[n] != n) {
+      identityMap = false;
+      break;
+    }
+  }
+  if (!identityMap || timeShift) {
+    for (var n = 0, o = 0; n < count;
+        n++, o += wtf.db.EventStruct.STRUCT_SIZE) {
+      if (!identityMap) {
+        var typeValue = eventData[o + wtf.db.EventStruct.TYPE];
+        eventData[o + wtf.db.EventStruct.TYPE] =
+            (typeValue & 0xFFFF0000) | typeIdMap[typeValue & 0xFFFF];
+      }
+      if (timeShift) {
+        eventData[o + wtf.db.EventStruct.TIME] = Math.max(0,
+            eventData[o + wtf.db.EventStruct.TIME] + timeShift);
+        if (eventData[o + wtf.db.EventStruct.END_TIME]) {
+          eventData[o + wtf.db.EventStruct.END_TIME] = Math.max(0,
+              eventData[o + wtf.db.EventStruct.END_TIME] + timeShift);
+        }
+      }
+    }
+  }
+
+  var lastTime = eventData[
+      (count - 1) * wtf.db.EventStruct.STRUCT_SIZE + wtf.db.EventStruct.TIME];
+
+  if (!this.count) {
+    // Adopt the data as-is.
+    this.eventData = eventData;
+    this.count = count;
+    this.capacity_ = count;
+    this.argumentTable_.importData(data.argumentTable);
+    this.statistics_ = data.statistics;
+    this.firstEventTime_ = data.firstEventTime ?
+        Math.max(0, data.firstEventTime + timeShift) : 0;
+    this.lastEventTime_ = data.lastEventTime ?
+        Math.max(0, data.lastEventTime + timeShift) : 0;
+    this.hiddenCount_ = data.hiddenCount;
+    this.maximumScopeDepth_ = data.maximumScopeDepth;
+    this.lastInsertTime_ = lastTime;
+    this.importedRebuilt_ = true;
+    this.rescopedCount_ = 0;
+    this.intervalIndex_.rebuild();
+    return;
+  }
+
+  // Append to the existing data and let the next rebuild merge it in.
+  // Events are renumbered and their arguments copied over, but their parent
+  // and sibling fields still hold imported IDs until they are rescoped. If
+  // all of them come after the existing events, the next rebuild only
+  // rescopes the new tail. Otherwise the unsorted tail is flagged for
+  // resortEvents_ and the whole list is rescoped.
+  this.expandCapacity(this.count + count);
+  var targetData = this.eventData;
+  var argumentTable = new wtf.db.ArgumentTable();
+  argumentTable.importData(data.argumentTable);
+  var di = this.count * wtf.db.EventStruct.STRUCT_SIZE;
+  var previousTime = this.lastInsertTime_;
+  for (var n = 0, o = 0; n < count;
+      n++, o += wtf.db.EventStruct.STRUCT_SIZE,
+      di += wtf.db.EventStruct.STRUCT_SIZE) {
+    for (var m = 0; m < wtf.db.EventStruct.STRUCT_SIZE; m++) {
+      targetData[di + m] = eventData[o + m];
+    }
+    var time = eventData[o + wtf.db.EventStruct.TIME];
+    if (time < previousTime) {
+      this.resortNeeded_ = true;
+    }
+    previousTime = time;
+    targetData[di + wtf.db.EventStruct.ID] = this.count + n;
+    var argsId = eventData[o + wtf.db.EventStruct.ARGUMENTS];
+    if (argsId) {
+      targetData[di + wtf.db.EventStruct.ARGUMENTS] =
+          this.argumentTable_.copyFrom(argumentTable, argsId);
+    }
+  }
+  this.count += count;
+  if (this.importedRebuilt_) {
+    // The adopted data was never scoped here, so everything is rescoped.
+    this.importedRebuilt_ = false;
+    this.rescopedCount_ = 0;
+  }
+  this.lastInsertTime_ = Math.max(this.lastInsertTime_, lastTime);
+};
+
+
+/**
+ * Maps the times of all events after the given index onto another clock.
+ * This must be called within an insertion block before the events are
+ * rebuilt.
+ * @param {number} startIndex First event to align.
+ * @param {!wtf.db.ClockAlignment} clockAlignment Clock alignment.
+ */
+wtf.db.EventList.prototype.alignTimes = function(startIndex, clockAlignment) {
+  if (startIndex >= this.count) {
+    return;
+  }
+
+  // The mapping is monotonic, so the events only need to be sorted if they
+  // now overlap the preceding ones.
+  var eventData = this.eventData;
+  for (var n = startIndex, o = startIndex * wtf.db.EventStruct.STRUCT_SIZE;
+      n < this.count; n++, o += wtf.db.EventStruct.STRUCT_SIZE) {
+    eventData[o + wtf.db.EventStruct.TIME] =
+        clockAlignment.align(eventData[o + wtf.db.EventStruct.TIME]);
+    if (eventData[o + wtf.db.EventStruct.END_TIME]) {
+      eventData[o + wtf.db.EventStruct.END_TIME] =
+          clockAlignment.align(eventData[o + wtf.db.EventStruct.END_TIME]);
+    }
+  }
+  if (startIndex) {
+    var o = startIndex * wtf.db.EventStruct.STRUCT_SIZE;
+    if (eventData[o + wtf.db.EventStruct.TIME] <
+        eventData[o - wtf.db.EventStruct.STRUCT_SIZE +
+            wtf.db.EventStruct.TIME]) {
+      this.resortNeeded_ = true;
+    }
+  }
+  // The last insert may have come from another source, so this is taken from
+  // the aligned events rather than mapped.
+  this.lastInsertTime_ = eventData[
+      (this.count - 1) * wtf.db.EventStruct.STRUCT_SIZE +
+      wtf.db.EventStruct.TIME];
+
+  if (this.importedRebuilt_) {
+    // Times derived from the imported data are stale.
+    this.importedRebuilt_ = false;
+    this.rescopedCount_ = 0;
+  }
+};
+
+
 /**
  * Dumps the event list to the console for debugging.
  */
@@ -788,6 +1219,36 @@ wtf.db.EventList.prototype.dump = function() {
 };
 
 
+/**
+ * Gets the interval index of the scopes in the list.
+ * It is only valid after the list has been rebuilt.
+ * @return {!wtf.db.IntervalIndex} Interval index.
+ */
+wtf.db.EventList.prototype.getIntervalIndex = function() {
+  return this.intervalIndex_;
+};
+
+
+/**
+ * Gets the statistics index of the list.
+ * It is only valid after the list has been rebuilt.
+ * @return {!wtf.db.StatisticsIndex} Statistics index.
+ */
+wtf.db.EventList.prototype.getStatisticsIndex = function() {
+  return this.statisticsIndex_;
+};
+
+
+/**
+ * Gets the per-type bitmap index of the list.
+ * It is only valid after the list has been rebuilt.
+ * @return {!wtf.db.TypeIndex} Type index.
+ */
+wtf.db.EventList.prototype.getTypeIndex = function() {
+  return this.typeIndex_;
+};
+
+
 /**
  * Begins iterating the entire event list.
  * @return {!wtf.db.EventIterator} Iterator.
@@ -823,6 +1284,19 @@ wtf.db.EventList.prototype.beginTimeRange = function(
 };
 
 
+/**
+ * Begins iterating all scopes that overlap the given time range.
+ * Unlike {@see #beginTimeRange} this includes scopes that started before the
+ * range and are still running in it.
+ * @param {number} startTime Start time.
+ * @param {number} endTime End time.
+ * @return {!wtf.db.EventIterator} Iterator over the scopes, in event order.
+ */
+wtf.db.EventList.prototype.beginIntersecting = function(startTime, endTime) {
+  return this.intervalIndex_.beginIntersecting(startTime, endTime);
+};
+
+
 /**
  * Begins iterating the given event index-based subset of the event list.
  * @param {number} startIndex Start index.
@@ -884,37 +1358,14 @@ wtf.db.EventList.prototype.getIndexOfRootScopeIncludingTime = function(time) {
   if (!nearId) {
     return 0;
   }
-  time *= 1000;
-
-  var eventData = this.eventData;
-  var i = nearId;
-  while (i >= 0) {
-    // Move to the root scope.
-    var o = i * wtf.db.EventStruct.STRUCT_SIZE;
-    var depth = eventData[o + wtf.db.EventStruct.DEPTH] & 0xFFFF;
-    while (depth-- > 0) {
-      o = i * wtf.db.EventStruct.STRUCT_SIZE;
-      i = eventData[o + wtf.db.EventStruct.PARENT];
-    }
-    o = i * wtf.db.EventStruct.STRUCT_SIZE;
-
-    // If it's a scope, probably found!
-    if (!!eventData[o + wtf.db.EventStruct.END_TIME]) {
-      // Found a root scope.
-      var endTime = eventData[o + wtf.db.EventStruct.END_TIME];
-      if (endTime < time) {
-        // Root scope ends before the requested time - just return near ID.
-        return nearId;
-      } else {
-        // Root scope includes the time.
-        return i;
-      }
-    }
 
-    i--;
+  // Find the root scope including the time with the index. Scopes starting
+  // exactly at the time come after the near event and are ignored.
+  var rootId = this.intervalIndex_.getScopeIdAtTime(time, 0);
+  if (rootId == -1 || rootId > nearId) {
+    return nearId;
   }
-
-  return nearId;
+  return rootId;
 };
 
 
@@ -961,12 +1412,21 @@ goog.exportProperty(
 goog.exportProperty(
     wtf.db.EventList.prototype, 'dump',
     wtf.db.EventList.prototype.dump);
+goog.exportProperty(
+    wtf.db.EventList.prototype, 'getIntervalIndex',
+    wtf.db.EventList.prototype.getIntervalIndex);
+goog.exportProperty(
+    wtf.db.EventList.prototype, 'getTypeIndex',
+    wtf.db.EventList.prototype.getTypeIndex);
 goog.exportProperty(
     wtf.db.EventList.prototype, 'begin',
     wtf.db.EventList.prototype.begin);
 goog.exportProperty(
     wtf.db.EventList.prototype, 'beginTimeRange',
     wtf.db.EventList.prototype.beginTimeRange);
+goog.exportProperty(
+    wtf.db.EventList.prototype, 'beginIntersecting',
+    wtf.db.EventList.prototype.beginIntersecting);
 goog.exportProperty(
     wtf.db.EventList.prototype, 'beginEventRange',
     wtf.db.EventList.prototype.beginEventRange);
@@ -0,0 +1,244 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/**
+ * @fileoverview Event struct sorting utilities.
+ * Sorts {@see wtf.db.EventStruct} records in time|id order using only typed
+ * arrays. Event IDs are always the insertion position of an event, so sorting
+ * by TIME stably is identical to sorting by TIME|ID.
+ *
+ * @author benvanik@google.com (Ben Vanik)
+ */
+
+goog.provide('wtf.db.eventsort');
+
+goog.require('wtf.db.EventStruct');
+
+
+/**
+ * The maximum number of sorted runs that will be merged instead of using a
+ * radix sort. Data inserted from a handful of chunks or sources is usually
+ * made up of a few long sorted runs.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.db.eventsort.MAX_MERGE_RUNS_ = 64;
+
+
+/**
+ * Radix digit size, in bits.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.db.eventsort.RADIX_BITS_ = 11;
+
+
+/**
+ * Sorts the given event data in place by time|id and renumbers all event IDs
+ * to match their new positions.
+ * @param {!Uint32Array} eventData Event data.
+ * @param {number} count Number of events in the data.
+ */
+wtf.db.eventsort.sort = function(eventData, count) {
+  if (count < 2) {
+    return;
+  }
+
+  // Gather the sort keys and find all ascending runs.
+  var keys = new Uint32Array(count);
+  var runStarts = [0];
+  var maxKey = 0;
+  var previousKey = 0;
+  for (var n = 0, o = 0; n < count; n++, o += wtf.db.EventStruct.STRUCT_SIZE) {
+    var key = eventData[o + wtf.db.EventStruct.TIME];
+    keys[n] = key;
+    if (key > maxKey) {
+      maxKey = key;
+    }
+    if (n && key < previousKey &&
+        runStarts.length <= wtf.db.eventsort.MAX_MERGE_RUNS_) {
+      runStarts.push(n);
+    }
+    previousKey = key;
+  }
+  if (runStarts.length == 1) {
+    // Already sorted.
+    return;
+  }
+
+  // Compute the permutation, where order[new index] = old index.
+  var order;
+  if (runStarts.length <= wtf.db.eventsort.MAX_MERGE_RUNS_) {
+    order = wtf.db.eventsort.mergeRuns_(keys, runStarts);
+  } else {
+    order = wtf.db.eventsort.radixSort_(keys, maxKey);
+  }
+
+  wtf.db.eventsort.permute_(eventData, order);
+
+  // Renumber all events to match their current order.
+  for (var n = 0, o = 0; n < count; n++, o += wtf.db.EventStruct.STRUCT_SIZE) {
+    eventData[o + wtf.db.EventStruct.ID] = n;
+  }
+};
+
+
+/**
+ * Merges sorted runs of keys with a stable bottom-up merge.
+ * @param {!Uint32Array} keys Sort keys.
+ * @param {!Array.<number>} runStarts Start index of each sorted run.
+ * @return {!Uint32Array} Sorted order, mapping new index to old index.
+ * @private
+ */
+wtf.db.eventsort.mergeRuns_ = function(keys, runStarts) {
+  var count = keys.length;
+  var order = new Uint32Array(count);
+  for (var n = 0; n < count; n++) {
+    order[n] = n;
+  }
+  var scratch = new Uint32Array(count);
+
+  var runs = runStarts.slice();
+  runs.push(count);
+  while (runs.length > 2) {
+    // Merge pairs of adjacent runs into the scratch buffer.
+    var newRuns = [0];
+    for (var r = 0; r + 1 < runs.length; r += 2) {
+      var start = runs[r];
+      var mid = runs[r + 1];
+      var end = r + 2 < runs.length ? runs[r + 2] : mid;
+      var i = start;
+      var j = mid;
+      var d = start;
+      while (i < mid && j < end) {
+        // Take from the left on ties to remain stable.
+        if (keys[order[j]] < keys[order[i]]) {
+          scratch[d++] = order[j++];
+        } else {
+          scratch[d++] = order[i++];
+        }
+      }
+      while (i < mid) {
+        scratch[d++] = order[i++];
+      }
+      while (j < end) {
+        scratch[d++] = order[j++];
+      }
+      newRuns.push(end);
+    }
+    if (newRuns[newRuns.length - 1] != count) {
+      newRuns.push(count);
+    }
+    var swap = order;
+    order = scratch;
+    scratch = swap;
+    runs = newRuns;
+  }
+  return order;
+};
+
+
+/**
+ * Sorts keys with a stable least-significant-digit radix sort.
+ * Only as many digits as are required to represent the maximum key are sorted.
+ * @param {!Uint32Array} keys Sort keys. Contents are destroyed.
+ * @param {number} maxKey Maximum key value.
+ * @return {!Uint32Array} Sorted order, mapping new index to old index.
+ * @private
+ */
+wtf.db.eventsort.radixSort_ = function(keys, maxKey) {
+  var count = keys.length;
+  var bits = wtf.db.eventsort.RADIX_BITS_;
+  var bucketCount = 1 << bits;
+  var mask = bucketCount - 1;
+
+  var order = new Uint32Array(count);
+  for (var n = 0; n < count; n++) {
+    order[n] = n;
+  }
+  var scratchKeys = new Uint32Array(count);
+  var scratchOrder = new Uint32Array(count);
+  var buckets = new Uint32Array(bucketCount);
+
+  for (var shift = 0; shift < 32 && (maxKey >>> shift); shift += bits) {
+    for (var n = 0; n < bucketCount; n++) {
+      buckets[n] = 0;
+    }
+    for (var n = 0; n < count; n++) {
+      buckets[(keys[n] >>> shift) & mask]++;
+    }
+    for (var n = 0, sum = 0; n < bucketCount; n++) {
+      var value = buckets[n];
+      buckets[n] = sum;
+      sum += value;
+    }
+    for (var n = 0; n < count; n++) {
+      var key = keys[n];
+      var d = buckets[(key >>> shift) & mask]++;
+      scratchKeys[d] = key;
+      scratchOrder[d] = order[n];
+    }
+    var swapKeys = keys;
+    keys = scratchKeys;
+    scratchKeys = swapKeys;
+    var swapOrder = order;
+    order = scratchOrder;
+    scratchOrder = swapOrder;
+  }
+  return order;
+};
+
+
+/**
+ * Rearranges event structs in place following the given order.
+ * Each cycle of the permutation is rotated through a single temporary struct.
+ * @param {!Uint32Array} eventData Event data.
+ * @param {!Uint32Array} order Mapping of new index to old index. Contents are
+ *     destroyed.
+ * @private
+ */
+wtf.db.eventsort.permute_ = function(eventData, order) {
+  var structSize = wtf.db.EventStruct.STRUCT_SIZE;
+  var temp = new Uint32Array(structSize);
+  for (var n = 0; n < order.length; n++) {
+    if (order[n] == n) {
+      continue;
+    }
+
+    // Stash the struct at the start of the cycle.
+    var o = n * structSize;
+    for (var m = 0; m < structSize; m++) {
+      temp[m] = eventData[o + m];
+    }
+
+    // Walk the cycle, pulling each struct into place.
+    var i = n;
+    while (true) {
+      var source = order[i];
+      order[i] = i;
+      var di = i * structSize;
+      if (source == n) {
+        for (var m = 0; m < structSize; m++) {
+          eventData[di + m] = temp[m];
+        }
+        break;
+      }
+      var si = source * structSize;
+      for (var m = 0; m < structSize; m++) {
+        eventData[di + m] = eventData[si + m];
+      }
+      i = source;
+    }
+  }
+};
+
+
+goog.exportSymbol(
+    'wtf.db.eventsort.sort',
+    wtf.db.eventsort.sort);
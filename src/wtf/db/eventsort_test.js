@@ -0,0 +1,85 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+goog.provide('wtf.db.eventsort_test');
+
+goog.require('wtf.db.EventStruct');
+goog.require('wtf.db.eventsort');
+goog.require('wtf.testing');
+
+
+/**
+ * wtf.db.eventsort testing.
+ */
+wtf.db.eventsort_test = suite('wtf.db.eventsort', function() {
+  /**
+   * Builds event data with the given times. The TAG field is set to the
+   * original index for checking the permutation.
+   * @param {!Array.<number>} times Event times.
+   * @return {!Uint32Array} Event data.
+   */
+  function buildEventData(times) {
+    var eventData = new Uint32Array(
+        times.length * wtf.db.EventStruct.STRUCT_SIZE);
+    for (var n = 0; n < times.length; n++) {
+      var o = n * wtf.db.EventStruct.STRUCT_SIZE;
+      eventData[o + wtf.db.EventStruct.ID] = n;
+      eventData[o + wtf.db.EventStruct.TIME] = times[n];
+      eventData[o + wtf.db.EventStruct.TAG] = n;
+    }
+    return eventData;
+  };
+
+  /**
+   * Verifies that sorting the given times matches a simple stable sort.
+   * @param {!Array.<number>} times Event times.
+   */
+  function assertSorts(times) {
+    var expected = [];
+    for (var n = 0; n < times.length; n++) {
+      expected.push(n);
+    }
+    expected.sort(function(a, b) {
+      return (times[a] - times[b]) || (a - b);
+    });
+
+    var eventData = buildEventData(times);
+    wtf.db.eventsort.sort(eventData, times.length);
+    for (var n = 0; n < times.length; n++) {
+      var o = n * wtf.db.EventStruct.STRUCT_SIZE;
+      assert.equal(eventData[o + wtf.db.EventStruct.ID], n);
+      assert.equal(eventData[o + wtf.db.EventStruct.TAG], expected[n]);
+      assert.equal(eventData[o + wtf.db.EventStruct.TIME],
+          times[expected[n]]);
+    }
+  };
+
+  test('#sortEmpty', function() {
+    assertSorts([]);
+    assertSorts([5]);
+  });
+
+  test('#sortSorted', function() {
+    assertSorts([1, 2, 2, 3, 4, 10, 11]);
+  });
+
+  test('#sortRuns', function() {
+    // Two interleaved sources.
+    assertSorts([0, 10, 20, 30, 5, 15, 25, 35]);
+    // Many ties across runs must remain stable.
+    assertSorts([1, 1, 2, 1, 1, 2, 0, 1, 2]);
+  });
+
+  test('#sortRandom', function() {
+    // Enough runs to force the radix path, with large 32-bit times.
+    var times = [];
+    for (var n = 0; n < 2000; n++) {
+      times.push((Math.random() * 0xFFFFFFFF) >>> 0);
+    }
+    assertSorts(times);
+  });
+});
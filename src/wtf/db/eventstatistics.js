@@ -21,6 +21,7 @@ goog.require('goog.Disposable');
 goog.require('goog.object');
 goog.require('wtf.data.EventClass');
 goog.require('wtf.data.EventFlag');
+goog.require('wtf.db.StatisticsIndex');
 goog.require('wtf.events.EventType');
 
 
@@ -274,18 +275,89 @@ wtf.db.EventStatistics.Table.prototype.rebuild = function(opt_filter) {
   }
 
   // Find all events that match.
+  // The ranges match those of {@see wtf.db.EventList#beginTimeRange}.
   var zones = this.db_.getZones();
+  var startIndices = [];
+  var endIndices = [];
   for (var n = 0; n < zones.length; n++) {
     var eventList = zones[n].getEventList();
-    var it = eventList.beginTimeRange(this.startTime_, this.endTime_);
-    for (; !it.done(); it.next()) {
-      var typeId = it.getTypeId();
-      var entry = tableById[typeId];
-      if (entry) {
-        if (!argumentFilter || argumentFilter(it)) {
-          entry.appendEvent(it);
+    var startIndex = eventList.getIndexOfEventNearTime(this.startTime_);
+    startIndices.push(startIndex);
+    endIndices.push(Math.max(startIndex,
+        eventList.getIndexOfEventNearTime(this.endTime_)));
+  }
+  if (argumentFilter) {
+    // Argument filters need each event, so visit all events of the types in
+    // the table using the type index.
+    var typeIds = [];
+    for (var n = 0; n < list.length; n++) {
+      typeIds.push(list[n].eventType.id);
+    }
+    for (var n = 0; n < zones.length; n++) {
+      var eventList = zones[n].getEventList();
+      if (!eventList.getCount()) {
+        continue;
+      }
+      var startIndex = startIndices[n];
+      var endIndex = endIndices[n];
+      var it = eventList.begin();
+      var appendMatch = function(index) {
+        it.seek(index);
+        if (argumentFilter(it)) {
+          tableById[it.getTypeId()].appendEvent(it);
           this.eventCount_++;
         }
+      };
+      var indexedEnd = Math.min(
+          endIndex + 1, eventList.getTypeIndex().getIndexedCount());
+      if (startIndex < indexedEnd) {
+        eventList.getTypeIndex().queryRange(
+            typeIds, startIndex, indexedEnd).forEach(appendMatch, this);
+      }
+      for (var m = Math.max(startIndex, indexedEnd); m <= endIndex; m++) {
+        it.seek(m);
+        if (tableById[it.getTypeId()]) {
+          appendMatch.call(this, m);
+        }
+      }
+    }
+  } else {
+    // Merge the cached per-block statistics of each zone.
+    var records = [];
+    for (var n = 0; n < list.length; n++) {
+      var type = list[n].eventType;
+      records[type.id] = new wtf.db.StatisticsIndex.Record(
+          type.id, type.eventClass == wtf.data.EventClass.SCOPE);
+    }
+    for (var n = 0; n < zones.length; n++) {
+      var eventList = zones[n].getEventList();
+      if (!eventList.getCount()) {
+        continue;
+      }
+      eventList.getStatisticsIndex().accumulate(
+          startIndices[n], endIndices[n], records);
+    }
+    for (var n = 0; n < list.length; n++) {
+      var entry = list[n];
+      var record = records[entry.eventType.id];
+      entry.appendRecord(record);
+      this.eventCount_ += record.eventCount;
+    }
+  }
+
+  // Scopes that began before the range but run into it, such as frame or
+  // idle scopes, are found with the interval index.
+  for (var n = 0; n < zones.length; n++) {
+    var startIndex = startIndices[n];
+    if (!startIndex) {
+      continue;
+    }
+    var it = zones[n].beginIntersecting(this.startTime_, this.endTime_);
+    for (; !it.done() && it.getId() < startIndex; it.next()) {
+      var entry = tableById[it.getTypeId()];
+      if (entry && (!argumentFilter || argumentFilter(it))) {
+        entry.appendEvent(it);
+        this.eventCount_++;
       }
     }
   }
@@ -530,6 +602,13 @@ wtf.db.EventDataEntry = function(eventType) {
 wtf.db.EventDataEntry.prototype.appendEvent = goog.abstractMethod;
 
 
+/**
+ * Appends the aggregated statistics of many events to the entry.
+ * @param {!wtf.db.StatisticsIndex.Record} record Statistics record.
+ */
+wtf.db.EventDataEntry.prototype.appendRecord = goog.abstractMethod;
+
+
 /**
  * Gets the event type this entry describes.
  * @return {!wtf.db.EventType} Event type.
@@ -637,6 +716,24 @@ wtf.db.ScopeEventDataEntry.prototype.appendEvent = function(it) {
 };
 
 
+/**
+ * @override
+ */
+wtf.db.ScopeEventDataEntry.prototype.appendRecord = function(record) {
+  this.count += record.count;
+  this.totalTime_ += record.totalTime / 1000;
+  this.ownTime_ += record.ownTime / 1000;
+  this.userTime_ += record.userTime / 1000;
+
+  var buckets = record.buckets;
+  if (buckets) {
+    for (var n = 0; n < buckets.length; n++) {
+      this.buckets_[n] += buckets[n];
+    }
+  }
+};
+
+
 /**
  * Gets the total time spent within all scopes of this type, including
  * system time.
@@ -735,6 +832,14 @@ wtf.db.InstanceEventDataEntry.prototype.appendEvent = function(it) {
 };
 
 
+/**
+ * @override
+ */
+wtf.db.InstanceEventDataEntry.prototype.appendRecord = function(record) {
+  this.count += record.count;
+};
+
+
 goog.exportSymbol(
     'wtf.db.InstanceEventDataEntry',
     wtf.db.InstanceEventDataEntry);
@@ -0,0 +1,617 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/**
+ * @fileoverview Multi-resolution event summary.
+ * Summarizes the events of an event list into a pyramid of time buckets per
+ * scope depth. Each bucket tracks how much of its time is covered by events,
+ * the span of time that is covered, and the event that covers the most of it.
+ * Renderers can draw from the level whose buckets are about a pixel wide to
+ * keep their cost bounded by the screen size instead of the event count.
+ *
+ * @author benvanik@google.com (Ben Vanik)
+ */
+
+goog.provide('wtf.db.EventSummary');
+goog.provide('wtf.db.EventSummaryLevel');
+
+goog.require('goog.Disposable');
+goog.require('wtf.data.EventClass');
+goog.require('wtf.data.EventFlag');
+goog.require('wtf.db.EventStruct');
+goog.require('wtf.db.IAncillaryList');
+
+
+
+/**
+ * A single resolution level of a summary.
+ * Bucket data is stored depth-major: the bucket for a given depth is at
+ * {@code depth * bucketCount + bucket}. All times are in the raw event data
+ * units (microseconds).
+ * @param {number} bucketWidth Width of each bucket.
+ * @param {number} bucketCount Number of buckets per depth.
+ * @param {number} depthCount Number of depths.
+ * @constructor
+ */
+wtf.db.EventSummaryLevel = function(bucketWidth, bucketCount, depthCount) {
+  var size = bucketCount * depthCount;
+
+  /**
+   * Width of each bucket.
+   * @type {number}
+   */
+  this.bucketWidth = bucketWidth;
+
+  /**
+   * Number of buckets per depth.
+   * @type {number}
+   */
+  this.bucketCount = bucketCount;
+
+  /**
+   * Number of depths.
+   * @type {number}
+   */
+  this.depthCount = depthCount;
+
+  /**
+   * Total time covered by events in each bucket.
+   * @type {!Float32Array}
+   */
+  this.busyTime = new Float32Array(size);
+
+  /**
+   * Earliest time covered by an event in each bucket.
+   * @type {!Uint32Array}
+   */
+  this.startTime = new Uint32Array(size);
+
+  /**
+   * Latest time covered by an event in each bucket.
+   * @type {!Uint32Array}
+   */
+  this.endTime = new Uint32Array(size);
+
+  /**
+   * ID of the event covering the most time in each bucket.
+   * @type {!Uint32Array}
+   */
+  this.dominantEvent = new Uint32Array(size);
+
+  /**
+   * Time covered by the dominant event in each bucket.
+   * @type {!Float32Array}
+   */
+  this.dominantTime = new Float32Array(size);
+};
+
+
+
+/**
+ * Event summary pyramid.
+ * The summary is built lazily the first time a level is requested after the
+ * event list changes. Appended events are added to the existing summary
+ * instead of rebuilding it.
+ *
+ * @param {!wtf.db.EventList} eventList Event list.
+ * @constructor
+ * @extends {goog.Disposable}
+ * @implements {wtf.db.IAncillaryList}
+ */
+wtf.db.EventSummary = function(eventList) {
+  goog.base(this);
+
+  /**
+   * Event list that this summary is built from.
+   * @type {!wtf.db.EventList}
+   * @private
+   */
+  this.eventList_ = eventList;
+
+  /**
+   * Time of the start of the first bucket.
+   * @type {number}
+   * @private
+   */
+  this.baseTime_ = 0;
+
+  /**
+   * Levels, with the finest first. Each level has buckets twice as wide as
+   * the previous one.
+   * @type {!Array.<!wtf.db.EventSummaryLevel>}
+   * @private
+   */
+  this.levels_ = [];
+
+  /**
+   * Whether the summary needs to be rebuilt from scratch before use.
+   * @type {boolean}
+   * @private
+   */
+  this.dirty_ = true;
+
+  /**
+   * Number of events from the start of the list that are summarized.
+   * Events after this were appended since the summary was last used.
+   * @type {number}
+   * @private
+   */
+  this.summarizedCount_ = 0;
+
+  /**
+   * IDs of summarized scopes that had not ended when they were summarized.
+   * They are counted as instance events until appended events end them.
+   * @type {!Array.<number>}
+   * @private
+   */
+  this.openScopes_ = [];
+
+  this.eventList_.registerAncillaryList(this);
+};
+goog.inherits(wtf.db.EventSummary, goog.Disposable);
+
+
+/**
+ * Minimum number of buckets the finest level may grow to.
+ * Larger lists get up to one bucket per event, within
+ * {@see #MAX_BASE_CELLS_}.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.db.EventSummary.MIN_BASE_BUCKETS_ = 8192;
+
+
+/**
+ * Maximum number of buckets across all depths of the finest level.
+ * Bounds the memory used by the summary to around 40 bytes per bucket per
+ * depth, including the coarser levels.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.db.EventSummary.MAX_BASE_CELLS_ = 1 << 20;
+
+
+/**
+ * Minimum width of a bucket, in microseconds.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.db.EventSummary.MIN_BUCKET_WIDTH_ = 16;
+
+
+/**
+ * Fake amount of time given to instance events, in microseconds.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.db.EventSummary.INSTANCE_TIME_WIDTH_ = 1;
+
+
+/**
+ * @override
+ */
+wtf.db.EventSummary.prototype.disposeInternal = function() {
+  this.eventList_.unregisterAncillaryList(this);
+  goog.base(this, 'disposeInternal');
+};
+
+
+/**
+ * Gets the time of the start of the first bucket of all levels.
+ * @return {number} Time, in microseconds.
+ */
+wtf.db.EventSummary.prototype.getBaseTime = function() {
+  this.ensureBuilt_();
+  return this.baseTime_;
+};
+
+
+/**
+ * Gets the number of levels in the summary.
+ * @return {number} Level count.
+ */
+wtf.db.EventSummary.prototype.getLevelCount = function() {
+  this.ensureBuilt_();
+  return this.levels_.length;
+};
+
+
+/**
+ * Gets the given summary level.
+ * @param {number} index Level index, with 0 being the finest.
+ * @return {!wtf.db.EventSummaryLevel} Level.
+ */
+wtf.db.EventSummary.prototype.getLevel = function(index) {
+  this.ensureBuilt_();
+  return this.levels_[index];
+};
+
+
+/**
+ * Selects the coarsest level with buckets no wider than the given width.
+ * @param {number} maxBucketWidth Maximum bucket width, in microseconds.
+ *     This is usually the amount of time covered by a pixel.
+ * @return {wtf.db.EventSummaryLevel} Level, or null if even the finest level
+ *     is too coarse and events should be used directly.
+ */
+wtf.db.EventSummary.prototype.selectLevel = function(maxBucketWidth) {
+  this.ensureBuilt_();
+  var result = null;
+  for (var n = 0; n < this.levels_.length; n++) {
+    var level = this.levels_[n];
+    if (level.bucketWidth > maxBucketWidth) {
+      break;
+    }
+    result = level;
+  }
+  return result;
+};
+
+
+/**
+ * @override
+ */
+wtf.db.EventSummary.prototype.beginRebuild = function(eventTypeTable) {
+  // Summarization walks the raw event data itself and only when needed.
+  this.dirty_ = true;
+  this.levels_.length = 0;
+  return [];
+};
+
+
+/**
+ * @override
+ */
+wtf.db.EventSummary.prototype.beginAppend = function(eventTypeTable) {
+  // Appended events are summarized the next time the summary is used.
+  return [];
+};
+
+
+/**
+ * @override
+ */
+wtf.db.EventSummary.prototype.handleEvent = goog.nullFunction;
+
+
+/**
+ * @override
+ */
+wtf.db.EventSummary.prototype.endRebuild = goog.nullFunction;
+
+
+/**
+ * Gets the maximum number of buckets per depth of the finest level.
+ * @param {number} depthCount Number of depths.
+ * @return {number} Bucket count, a power of two.
+ * @private
+ */
+wtf.db.EventSummary.prototype.getBucketBudget_ = function(depthCount) {
+  var budget = wtf.db.EventSummary.MIN_BASE_BUCKETS_;
+  var maxBuckets = Math.max(budget, Math.min(this.eventList_.count,
+      wtf.db.EventSummary.MAX_BASE_CELLS_ / depthCount));
+  while (budget * 2 <= maxBuckets) {
+    budget *= 2;
+  }
+  return budget;
+};
+
+
+/**
+ * Summarizes any events added since the summary was last used.
+ * @private
+ */
+wtf.db.EventSummary.prototype.ensureBuilt_ = function() {
+  if (this.dirty_) {
+    this.dirty_ = false;
+    this.levels_.length = 0;
+    this.summarizedCount_ = 0;
+    this.openScopes_.length = 0;
+  }
+
+  var eventList = this.eventList_;
+  var count = eventList.count;
+  if (!count) {
+    this.baseTime_ = 0;
+    return;
+  } else if (this.summarizedCount_ == count) {
+    return;
+  }
+
+  var eventData = eventList.eventData;
+  var lastTime = Math.ceil(eventList.getLastEventTime() * 1000) +
+      wtf.db.EventSummary.INSTANCE_TIME_WIDTH_;
+  var depthCount = eventList.getMaximumScopeDepth() + 1;
+  var budget = this.getBucketBudget_(depthCount);
+  var base = this.levels_.length ? this.levels_[0] : null;
+  var resized = !base;
+  if (!base) {
+    // Pick a power-of-two bucket width that keeps the finest level in budget.
+    var baseTime = eventData[wtf.db.EventStruct.TIME];
+    this.baseTime_ = baseTime;
+    var duration = Math.max(1, lastTime - baseTime);
+    var bucketWidth = wtf.db.EventSummary.MIN_BUCKET_WIDTH_;
+    while (duration / bucketWidth > budget) {
+      bucketWidth *= 2;
+    }
+    var bucketCount = 1;
+    while (bucketCount * bucketWidth < duration) {
+      bucketCount *= 2;
+    }
+    base = new wtf.db.EventSummaryLevel(bucketWidth, bucketCount, depthCount);
+  }
+
+  // Grow the finest level to fit the appended events. Buckets are added until
+  // the budget is reached and then merged to double their width.
+  if (base.depthCount < depthCount) {
+    base = this.resizeLevel_(base, base.bucketCount, depthCount);
+    resized = true;
+  }
+  while (this.baseTime_ + base.bucketCount * base.bucketWidth < lastTime) {
+    if (base.bucketCount * 2 <= budget) {
+      base = this.resizeLevel_(base, base.bucketCount * 2, base.depthCount);
+    } else {
+      base = this.mergeLevel_(base, new wtf.db.EventSummaryLevel(
+          base.bucketWidth * 2, base.bucketCount, base.depthCount));
+    }
+    resized = true;
+  }
+
+  // Add coverage for the appended events and the time that they closed
+  // previously open scopes.
+  var firstTime = eventData[
+      this.summarizedCount_ * wtf.db.EventStruct.STRUCT_SIZE +
+      wtf.db.EventStruct.TIME];
+  firstTime = Math.min(firstTime, this.extendOpenScopes_(base));
+  this.summarizeEvents_(base, this.summarizedCount_, count);
+  this.summarizedCount_ = count;
+
+  if (resized) {
+    // Merge pairs of buckets until a single bucket covers everything.
+    this.levels_.length = 0;
+    this.levels_.push(base);
+    var level = base;
+    while (level.bucketCount > 1) {
+      level = this.mergeLevel_(level);
+      this.levels_.push(level);
+    }
+  } else {
+    // Only buckets at or after the first changed one need to be merged again.
+    var firstBucket = Math.max(0,
+        ((firstTime - this.baseTime_) / base.bucketWidth) | 0);
+    for (var n = 1; n < this.levels_.length; n++) {
+      firstBucket >>= 1;
+      this.mergeLevel_(this.levels_[n - 1], this.levels_[n], firstBucket);
+    }
+  }
+};
+
+
+/**
+ * Adds the coverage of previously open scopes that have since ended.
+ * @param {!wtf.db.EventSummaryLevel} level Finest level.
+ * @return {number} Earliest time that coverage was added at, or
+ *     {@code Number.MAX_VALUE} if none was.
+ * @private
+ */
+wtf.db.EventSummary.prototype.extendOpenScopes_ = function(level) {
+  var instanceTimeWidth = wtf.db.EventSummary.INSTANCE_TIME_WIDTH_;
+  var eventData = this.eventList_.eventData;
+  var openScopes = this.openScopes_;
+  var firstTime = Number.MAX_VALUE;
+  var stillOpen = 0;
+  for (var n = 0; n < openScopes.length; n++) {
+    var id = openScopes[n];
+    var o = id * wtf.db.EventStruct.STRUCT_SIZE;
+    var end = eventData[o + wtf.db.EventStruct.END_TIME];
+    if (!end) {
+      openScopes[stillOpen++] = id;
+      continue;
+    }
+    var time = eventData[o + wtf.db.EventStruct.TIME];
+    var depth = eventData[o + wtf.db.EventStruct.DEPTH] & 0xFFFF;
+    if (end > time + instanceTimeWidth) {
+      this.addCoverage_(level, id, depth, time, end, time + instanceTimeWidth);
+      firstTime = Math.min(firstTime, time);
+    }
+  }
+  openScopes.length = stillOpen;
+  return firstTime;
+};
+
+
+/**
+ * Summarizes a range of events into the given finest level.
+ * @param {!wtf.db.EventSummaryLevel} level Level to populate.
+ * @param {number} startIndex First event ID, inclusive.
+ * @param {number} endIndex Last event ID, exclusive.
+ * @private
+ */
+wtf.db.EventSummary.prototype.summarizeEvents_ = function(
+    level, startIndex, endIndex) {
+  var hiddenFlags =
+      wtf.data.EventFlag.INTERNAL |
+      wtf.data.EventFlag.APPEND_SCOPE_DATA |
+      wtf.data.EventFlag.APPEND_FLOW_DATA;
+  var instanceTimeWidth = wtf.db.EventSummary.INSTANCE_TIME_WIDTH_;
+  var depthCount = level.depthCount;
+
+  var eventList = this.eventList_;
+  var eventTypeTable = eventList.eventTypeTable;
+  var eventData = eventList.eventData;
+  for (var n = startIndex, o = n * wtf.db.EventStruct.STRUCT_SIZE;
+      n < endIndex; n++, o += wtf.db.EventStruct.STRUCT_SIZE) {
+    var type = eventData[o + wtf.db.EventStruct.TYPE];
+    if ((type >>> 16) & hiddenFlags) {
+      continue;
+    }
+    var depth = eventData[o + wtf.db.EventStruct.DEPTH] & 0xFFFF;
+    if (depth >= depthCount) {
+      continue;
+    }
+    var time = eventData[o + wtf.db.EventStruct.TIME];
+    var end = eventData[o + wtf.db.EventStruct.END_TIME];
+    if (!end) {
+      // Instance events and scopes that have not ended yet. The scopes are
+      // extended if later appended events end them.
+      end = time + instanceTimeWidth;
+      var eventType = eventTypeTable.getById(type & 0xFFFF);
+      if (eventType && eventType.eventClass == wtf.data.EventClass.SCOPE) {
+        this.openScopes_.push(n);
+      }
+    }
+    this.addCoverage_(level, n, depth, time, end, time);
+  }
+};
+
+
+/**
+ * Adds the time covered by an event to the buckets of the given level.
+ * @param {!wtf.db.EventSummaryLevel} level Level to populate.
+ * @param {number} id Event ID.
+ * @param {number} depth Event depth.
+ * @param {number} time Event start time.
+ * @param {number} end Event end time.
+ * @param {number} busyStart Time to start counting busy time from. Time before
+ *     this has already been added and only counts towards the dominant event.
+ * @private
+ */
+wtf.db.EventSummary.prototype.addCoverage_ = function(
+    level, id, depth, time, end, busyStart) {
+  var baseTime = this.baseTime_;
+  var bucketWidth = level.bucketWidth;
+  var bucketCount = level.bucketCount;
+  var busyTime = level.busyTime;
+  var startTime = level.startTime;
+  var endTime = level.endTime;
+  var dominantEvent = level.dominantEvent;
+  var dominantTime = level.dominantTime;
+
+  var firstBucket = ((busyStart - baseTime) / bucketWidth) | 0;
+  var lastBucket = Math.min(
+      bucketCount - 1, ((end - 1 - baseTime) / bucketWidth) | 0);
+  var bucketStart = baseTime + firstBucket * bucketWidth;
+  var i = depth * bucketCount + firstBucket;
+  for (var b = firstBucket; b <= lastBucket;
+      b++, i++, bucketStart += bucketWidth) {
+    var bucketEnd = bucketStart + bucketWidth;
+    var right = end < bucketEnd ? end : bucketEnd;
+    var left = busyStart > bucketStart ? busyStart : bucketStart;
+    if (!busyTime[i]) {
+      startTime[i] = left;
+    }
+    busyTime[i] += right - left;
+    if (right > endTime[i]) {
+      endTime[i] = right;
+    }
+    var covered = right - (time > bucketStart ? time : bucketStart);
+    if (covered > dominantTime[i]) {
+      dominantEvent[i] = id;
+      dominantTime[i] = covered;
+    }
+  }
+};
+
+
+/**
+ * Copies a level into a new one with more buckets or depths.
+ * @param {!wtf.db.EventSummaryLevel} source Source level.
+ * @param {number} bucketCount New number of buckets per depth.
+ * @param {number} depthCount New number of depths.
+ * @return {!wtf.db.EventSummaryLevel} Resized level.
+ * @private
+ */
+wtf.db.EventSummary.prototype.resizeLevel_ = function(
+    source, bucketCount, depthCount) {
+  var level = new wtf.db.EventSummaryLevel(
+      source.bucketWidth, bucketCount, depthCount);
+  var sourceCount = source.bucketCount;
+  for (var depth = 0; depth < source.depthCount; depth++) {
+    var s = depth * sourceCount;
+    var d = depth * bucketCount;
+    level.busyTime.set(source.busyTime.subarray(s, s + sourceCount), d);
+    level.startTime.set(source.startTime.subarray(s, s + sourceCount), d);
+    level.endTime.set(source.endTime.subarray(s, s + sourceCount), d);
+    level.dominantEvent.set(
+        source.dominantEvent.subarray(s, s + sourceCount), d);
+    level.dominantTime.set(
+        source.dominantTime.subarray(s, s + sourceCount), d);
+  }
+  return level;
+};
+
+
+/**
+ * Builds a coarser level by merging pairs of buckets.
+ * @param {!wtf.db.EventSummaryLevel} source Source level.
+ * @param {wtf.db.EventSummaryLevel=} opt_target Level to merge into, with
+ *     buckets twice as wide as the source. A new level is created if omitted.
+ * @param {number=} opt_firstBucket First bucket of the target to merge.
+ *     Earlier buckets are left unchanged.
+ * @return {!wtf.db.EventSummaryLevel} Merged level.
+ * @private
+ */
+wtf.db.EventSummary.prototype.mergeLevel_ = function(
+    source, opt_target, opt_firstBucket) {
+  var sourceCount = source.bucketCount;
+  var depthCount = source.depthCount;
+  var level = opt_target || new wtf.db.EventSummaryLevel(
+      source.bucketWidth * 2, Math.ceil(sourceCount / 2), depthCount);
+  var bucketCount = level.bucketCount;
+  var firstBucket = opt_firstBucket || 0;
+  for (var depth = 0; depth < depthCount; depth++) {
+    var s = depth * sourceCount;
+    var d = depth * bucketCount + firstBucket;
+    for (var b = firstBucket * 2; b < sourceCount; b += 2, d++) {
+      var a = s + b;
+      var c = b + 1 < sourceCount ? a + 1 : -1;
+      var busyA = source.busyTime[a];
+      var busyC = c >= 0 ? source.busyTime[c] : 0;
+      level.busyTime[d] = busyA + busyC;
+      if (!busyA && !busyC) {
+        continue;
+      }
+      level.startTime[d] = busyA ? source.startTime[a] : source.startTime[c];
+      level.endTime[d] = busyC ? source.endTime[c] : source.endTime[a];
+
+      // An event spanning both halves counts for both.
+      var eventA = source.dominantEvent[a];
+      var timeA = busyA ? source.dominantTime[a] : 0;
+      var eventC = busyC ? source.dominantEvent[c] : 0;
+      var timeC = busyC ? source.dominantTime[c] : 0;
+      if (busyA && busyC && eventA == eventC) {
+        level.dominantEvent[d] = eventA;
+        level.dominantTime[d] = timeA + timeC;
+      } else if (timeA >= timeC) {
+        level.dominantEvent[d] = eventA;
+        level.dominantTime[d] = timeA;
+      } else {
+        level.dominantEvent[d] = eventC;
+        level.dominantTime[d] = timeC;
+      }
+    }
+  }
+  return level;
+};
+
+
+goog.exportProperty(
+    wtf.db.EventSummary.prototype, 'getBaseTime',
+    wtf.db.EventSummary.prototype.getBaseTime);
+goog.exportProperty(
+    wtf.db.EventSummary.prototype, 'getLevelCount',
+    wtf.db.EventSummary.prototype.getLevelCount);
+goog.exportProperty(
+    wtf.db.EventSummary.prototype, 'getLevel',
+    wtf.db.EventSummary.prototype.getLevel);
+goog.exportProperty(
+    wtf.db.EventSummary.prototype, 'selectLevel',
+    wtf.db.EventSummary.prototype.selectLevel);
@@ -0,0 +1,140 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+goog.provide('wtf.db.EventSummary_test');
+
+goog.require('wtf.db.EventList');
+goog.require('wtf.db.EventSummary');
+goog.require('wtf.db.EventTypeTable');
+goog.require('wtf.testing');
+
+
+/**
+ * wtf.db.EventSummary testing.
+ */
+wtf.db.EventSummary_test = suite('wtf.db.EventSummary', function() {
+  test('#ctor', function() {
+    var eventTypeTable = new wtf.db.EventTypeTable();
+    var eventList = new wtf.db.EventList(eventTypeTable);
+
+    // Creation succeeds.
+    var summary = new wtf.db.EventSummary(eventList);
+    assert.equal(summary.getLevelCount(), 0);
+    assert.isNull(summary.selectLevel(1000));
+
+    // Should unregister itself when disposed.
+    goog.dispose(summary);
+    assert.lengthOf(eventList.ancillaryLists_, 0);
+  });
+
+  test('levels', function() {
+    var eventTypeTable = new wtf.db.EventTypeTable();
+    var eventList = new wtf.db.EventList(eventTypeTable);
+    var summary = new wtf.db.EventSummary(eventList);
+
+    wtf.testing.insertEvents(eventList, {
+      instanceEventTypes: [
+        'a()',
+        'b()'
+      ],
+      events: [
+        [0, 'a'],
+        [0.002, 'a'],
+        [0.040, 'b'],
+        [0.100, 'a']
+      ]
+    });
+
+    // 101us of events in 16us buckets, merged down to one bucket.
+    assert.equal(summary.getBaseTime(), 0);
+    assert.equal(summary.getLevelCount(), 4);
+    var level = summary.getLevel(0);
+    assert.equal(level.bucketWidth, 16);
+    assert.equal(level.bucketCount, 8);
+    assert.equal(level.depthCount, 1);
+    assert.equal(level.busyTime[0], 2);
+    assert.equal(level.startTime[0], 0);
+    assert.equal(level.endTime[0], 3);
+    assert.equal(level.dominantEvent[0], 0);
+    assert.equal(level.busyTime[1], 0);
+    assert.equal(level.busyTime[2], 1);
+    assert.equal(level.dominantEvent[2], 2);
+    assert.equal(level.busyTime[6], 1);
+
+    var top = summary.getLevel(3);
+    assert.equal(top.bucketWidth, 128);
+    assert.equal(top.bucketCount, 1);
+    assert.equal(top.busyTime[0], 4);
+    assert.equal(top.startTime[0], 0);
+    assert.equal(top.endTime[0], 101);
+
+    // Selection picks the coarsest level that fits.
+    assert.isNull(summary.selectLevel(8));
+    assert.equal(summary.selectLevel(16), level);
+    assert.equal(summary.selectLevel(100), summary.getLevel(2));
+    assert.equal(summary.selectLevel(100000), top);
+
+    // Appended events are added on next use, growing the finest level.
+    wtf.testing.insertEvents(eventList, {
+      events: [
+        [1, 'b']
+      ]
+    });
+    level = summary.getLevel(0);
+    assert.equal(level.bucketWidth, 16);
+    assert.equal(level.bucketCount, 64);
+    assert.equal(level.busyTime[0], 2);
+    assert.equal(level.busyTime[62], 1);
+    assert.equal(level.dominantEvent[62], 4);
+    top = summary.getLevel(summary.getLevelCount() - 1);
+    assert.equal(top.busyTime[0], 5);
+    assert.equal(top.endTime[0], 1001);
+  });
+
+  test('appending', function() {
+    var eventTypeTable = new wtf.db.EventTypeTable();
+    var eventList = new wtf.db.EventList(eventTypeTable);
+    var summary = new wtf.db.EventSummary(eventList);
+
+    wtf.testing.insertEvents(eventList, {
+      scopeEventTypes: [
+        'a'
+      ],
+      instanceEventTypes: [
+        'b()',
+        'wtf.scope#leave()'
+      ],
+      events: [
+        [0, 'a'],
+        [0.010, 'b']
+      ]
+    });
+    var level = summary.getLevel(0);
+    assert.equal(level.depthCount, 2);
+    assert.equal(level.busyTime[0], 1);
+
+    // Leaving the open scope extends it across the buckets it covers.
+    wtf.testing.insertEvents(eventList, {
+      events: [
+        [0.040, 'wtf.scope#leave'],
+        [0.050, 'b']
+      ]
+    });
+    level = summary.getLevel(0);
+    assert.equal(level.busyTime[0], 16);
+    assert.equal(level.busyTime[1], 16);
+    assert.equal(level.busyTime[2], 8);
+    assert.equal(level.dominantEvent[2], 0);
+    assert.equal(level.busyTime[3], 1);
+    assert.equal(level.dominantEvent[3], 3);
+    assert.equal(level.busyTime[level.bucketCount], 1);
+    var top = summary.getLevel(summary.getLevelCount() - 1);
+    assert.equal(top.busyTime[0], 41);
+    assert.equal(top.dominantEvent[0], 0);
+    assert.equal(top.dominantTime[0], 40);
+  });
+});
@@ -32,6 +32,8 @@ goog.require('wtf.db.DataSource');
 /** @suppress {extraRequire} */
 goog.require('wtf.db.Database');
 /** @suppress {extraRequire} */
+goog.require('wtf.db.EventBitmap');
+/** @suppress {extraRequire} */
 goog.require('wtf.db.EventDataEntry');
 /** @suppress {extraRequire} */
 goog.require('wtf.db.EventIndex');
@@ -52,6 +54,8 @@ goog.require('wtf.db.Frame');
 /** @suppress {extraRequire} */
 goog.require('wtf.db.FrameList');
 /** @suppress {extraRequire} */
+goog.require('wtf.db.FrameStatistics');
+/** @suppress {extraRequire} */
 goog.require('wtf.db.HealthInfo');
 /** @suppress {extraRequire} */
 goog.require('wtf.db.InstanceEventDataEntry');
@@ -70,6 +74,8 @@ goog.require('wtf.db.TimeRange');
 /** @suppress {extraRequire} */
 goog.require('wtf.db.TimeRangeList');
 /** @suppress {extraRequire} */
+goog.require('wtf.db.TypeIndex');
+/** @suppress {extraRequire} */
 goog.require('wtf.db.Zone');
 /** @suppress {extraRequire} */
 goog.require('wtf.util');
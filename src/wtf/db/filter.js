@@ -16,7 +16,9 @@ goog.provide('wtf.db.FilterResult');
 
 goog.require('goog.string');
 goog.require('wtf.data.EventFlag');
+goog.require('wtf.db.EventBitmap');
 goog.require('wtf.db.EventIterator');
+goog.require('wtf.db.EventStruct');
 goog.require('wtf.db.FilterParser');
 goog.require('wtf.util.FunctionBuilder');
 
@@ -91,6 +93,14 @@ wtf.db.Filter = function(opt_value) {
    */
   this.argumentFilter_ = null;
 
+  /**
+   * Compiled kernel that scans event data for matching events.
+   * This is null if the filter has not been set from a string.
+   * @type {wtf.db.Filter.KernelFunction?}
+   * @private
+   */
+  this.kernel_ = null;
+
   if (opt_value) {
     this.setFromString(opt_value);
   }
@@ -111,6 +121,75 @@ wtf.db.Filter.EventTypeFilterFunction;
 wtf.db.Filter.ArgumentFilterFunction;
 
 
+/**
+ * A compiled function that scans event data and appends the IDs of all
+ * matching events to the given list.
+ * Events from the start index up to (but not including) the end index are
+ * scanned. The type bitset has a bit set for each event type ID that passes
+ * the event type filter and the argument function is used to read argument
+ * values.
+ * @typedef {function(!Uint32Array, number, number, !Uint32Array,
+ *     function(number, string):*, !Array.<number>)}
+ */
+wtf.db.Filter.KernelFunction;
+
+
+/**
+ * A function that appends the IDs of all matching events in the range from the
+ * start index up to (but not including) the end index to the given list.
+ * @typedef {function(number, number, !Array.<number>)}
+ */
+wtf.db.Filter.ScanFunction;
+
+
+/**
+ * Compiled filter state, cached by expression string.
+ * @typedef {{
+ *   expressionTree: !Object,
+ *   eventTypeFilter: wtf.db.Filter.EventTypeFilterFunction?,
+ *   argumentFilter: wtf.db.Filter.ArgumentFilterFunction?,
+ *   kernel: wtf.db.Filter.KernelFunction
+ * }}
+ * @private
+ */
+wtf.db.Filter.CompiledFilter_;
+
+
+/**
+ * Maximum number of compiled filters kept in the cache.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.db.Filter.MAX_CACHED_FILTERS_ = 128;
+
+
+/**
+ * Compiled filters, keyed by trimmed expression string.
+ * Filters are frequently recreated with the same strings (such as when
+ * querying from the UI) and this prevents reparsing and recompiling them.
+ * @type {!Object.<!wtf.db.Filter.CompiledFilter_>}
+ * @private
+ */
+wtf.db.Filter.compiledCache_ = {};
+
+
+/**
+ * Number of entries in {@see #compiledCache_}.
+ * @type {number}
+ * @private
+ */
+wtf.db.Filter.compiledCacheCount_ = 0;
+
+
+/**
+ * Kernel used when no expression has been set, lazily generated.
+ * @type {wtf.db.Filter.KernelFunction?}
+ * @private
+ */
+wtf.db.Filter.defaultKernel_ = null;
+
+
 /**
  * Gets a function that tests if an event type passes the filter.
  * @return {wtf.db.Filter.EventTypeFilterFunction?} Filter function, or null if
@@ -153,6 +232,7 @@ wtf.db.Filter.prototype.clear = function() {
   this.parseError_ = null;
   this.eventTypeFilter_ = null;
   this.argumentFilter_ = null;
+  this.kernel_ = null;
   return wtf.db.FilterResult.UPDATED;
 };
 
@@ -181,22 +261,42 @@ wtf.db.Filter.prototype.setFromString = function(value) {
     return wtf.db.FilterResult.UPDATED;
   }
 
-  var expr = null;
-  try {
-    expr = wtf.db.FilterParser.parse(value, undefined);
-  } catch (e) {
-    this.parseError_ = e;
-  }
-  if (!expr) {
-    // Could not parse expression - keep current value.
-    return wtf.db.FilterResult.FAILED;
+  var compiled = wtf.db.Filter.compiledCache_[value];
+  if (!compiled) {
+    var expr = null;
+    try {
+      expr = wtf.db.FilterParser.parse(value, undefined);
+    } catch (e) {
+      this.parseError_ = e;
+    }
+    if (!expr) {
+      // Could not parse expression - keep current value.
+      return wtf.db.FilterResult.FAILED;
+    }
+
+    compiled = {
+      expressionTree: expr,
+      eventTypeFilter: this.generateEventTypeFilter_(expr),
+      argumentFilter: this.generateArgumentFilter_(expr),
+      kernel: wtf.db.Filter.generateKernel_(expr)
+    };
+
+    // Drop everything when full - expressions are cheap to recompile and
+    // this keeps one-off strings from accumulating.
+    if (wtf.db.Filter.compiledCacheCount_ >=
+        wtf.db.Filter.MAX_CACHED_FILTERS_) {
+      wtf.db.Filter.compiledCache_ = {};
+      wtf.db.Filter.compiledCacheCount_ = 0;
+    }
+    wtf.db.Filter.compiledCache_[value] = compiled;
+    wtf.db.Filter.compiledCacheCount_++;
   }
 
   this.sourceString_ = value;
-  this.expressionTree_ = expr;
-
-  this.eventTypeFilter_ = this.generateEventTypeFilter_(expr);
-  this.argumentFilter_ = this.generateArgumentFilter_(expr);
+  this.expressionTree_ = compiled.expressionTree;
+  this.eventTypeFilter_ = compiled.eventTypeFilter;
+  this.argumentFilter_ = compiled.argumentFilter;
+  this.kernel_ = compiled.kernel;
 
   return wtf.db.FilterResult.UPDATED;
 };
@@ -229,6 +329,20 @@ wtf.db.Filter.prototype.getDebugString = function() {
 };
 
 
+/**
+ * Creates a regular expression that is shared by all tests of a filter.
+ * The global and sticky flags are dropped, as they make {@code test} resume
+ * from the end of the previous match.
+ * @param {string} value Expression source.
+ * @param {string=} opt_flags Flags.
+ * @return {!RegExp} Regular expression.
+ * @private
+ */
+wtf.db.Filter.createRegExp_ = function(value, opt_flags) {
+  return new RegExp(value, (opt_flags || '').replace(/[gy]/g, ''));
+};
+
+
 /**
  * Generates an event type filter function from the given expression tree.
  * @param {!Object} expr Expression tree.
@@ -248,7 +362,8 @@ wtf.db.Filter.prototype.generateEventTypeFilter_ = function(expr) {
       regex = new RegExp('.*' + escapedValue + '.*', 'i');
       break;
     case 'regex':
-      regex = new RegExp(expr.type_query.value, expr.type_query.flags);
+      regex = wtf.db.Filter.createRegExp_(
+          expr.type_query.value, expr.type_query.flags);
       break;
     default:
       throw new Error('Invalid event type filter query.');
@@ -276,11 +391,130 @@ wtf.db.Filter.prototype.generateArgumentFilter_ = function(expr) {
   builder.begin();
   builder.addArgument('it');
 
+  var expression = wtf.db.Filter.buildArgumentExpression_(
+      builder, expr.arg_query, wtf.db.Filter.ITERATOR_ACCESSORS_);
+  builder.append('return ' + expression + ';');
+
+  return builder.end('argumentFilter');
+};
+
+
+/**
+ * Generates a filter kernel from the given expression tree.
+ * @param {!Object} expr Expression tree.
+ * @return {wtf.db.Filter.KernelFunction} Kernel function.
+ * @private
+ */
+wtf.db.Filter.generateKernel_ = function(expr) {
+  var builder = new wtf.util.FunctionBuilder();
+  builder.begin();
+  builder.addArgument('eventData');
+  builder.addArgument('start');
+  builder.addArgument('end');
+  builder.addArgument('typeBits');
+  builder.addArgument('getArgument');
+  builder.addArgument('matches');
+
+  builder.append(
+      'for (var n = start, o = start * ' + wtf.db.EventStruct.STRUCT_SIZE +
+          '; n < end; n++, o += ' + wtf.db.EventStruct.STRUCT_SIZE + ') {',
+      '  var typeId = eventData[o + ' + wtf.db.EventStruct.TYPE + '] & 0xFFFF;',
+      '  if (!(typeBits[typeId >> 5] & (1 << (typeId & 31)))) continue;');
+  if (expr && expr.arg_query) {
+    var expression = wtf.db.Filter.buildArgumentExpression_(
+        builder, expr.arg_query, wtf.db.Filter.EVENT_DATA_ACCESSORS_);
+    builder.append('  if (!(' + expression + ')) continue;');
+  }
+  builder.append(
+      '  matches.push(n);',
+      '}');
+
+  return /** @type {wtf.db.Filter.KernelFunction} */ (
+      builder.end('filterKernel'));
+};
+
+
+/**
+ * Source code generators for accessing event attributes from generated
+ * filter code.
+ * @typedef {{
+ *   time: string,
+ *   duration: string,
+ *   userDuration: string,
+ *   ownDuration: string,
+ *   isScope: string,
+ *   argument: function(string):string
+ * }}
+ * @private
+ */
+wtf.db.Filter.Accessors_;
+
+
+/**
+ * Accessors used by argument filters, which are passed an iterator.
+ * @type {!wtf.db.Filter.Accessors_}
+ * @private
+ */
+wtf.db.Filter.ITERATOR_ACCESSORS_ = {
+  time: 'it.getTime()',
+  duration: 'it.getTotalDuration()',
+  userDuration: 'it.getUserDuration()',
+  ownDuration: 'it.getOwnDuration()',
+  isScope: 'it.isScope()',
+  argument: function(name) {
+    // Arguments are read individually so that argument objects are not
+    // materialized for each event.
+    return 'it.getArgument("' + name + '")';
+  }
+};
+
+
+/**
+ * Accessors used by kernels, which read the event data directly.
+ * @type {!wtf.db.Filter.Accessors_}
+ * @private
+ */
+wtf.db.Filter.EVENT_DATA_ACCESSORS_ = (function() {
+  function field(offset) {
+    return 'eventData[o + ' + offset + ']';
+  };
+  var time = field(wtf.db.EventStruct.TIME);
+  var endTime = field(wtf.db.EventStruct.END_TIME);
+  var total = '(' + endTime + ' - ' + time + ')';
+  return {
+    time: '(' + time + ' / 1000)',
+    duration: '(' + total + ' / 1000)',
+    userDuration: '((' + total + ' - ' +
+        field(wtf.db.EventStruct.SYSTEM_TIME) + ') / 1000)',
+    ownDuration: '((' + total + ' - ' +
+        field(wtf.db.EventStruct.CHILD_TIME) + ') / 1000)',
+    isScope: '!!' + endTime,
+    argument: function(name) {
+      return 'getArgument(' + field(wtf.db.EventStruct.ARGUMENTS) + ', "' +
+          name + '")';
+    }
+  };
+})();
+
+
+/**
+ * Builds a JavaScript expression that evaluates a list of argument query
+ * expressions.
+ * Regular expressions are added to the builder as scope variables so that
+ * they are only created once.
+ * @param {!wtf.util.FunctionBuilder} builder Function builder.
+ * @param {!Array.<!Object>} argQuery Argument query expression list.
+ * @param {!wtf.db.Filter.Accessors_} accessors Event attribute accessors.
+ * @return {string} Expression source.
+ * @private
+ */
+wtf.db.Filter.buildArgumentExpression_ = function(
+    builder, argQuery, accessors) {
   // Generate a list of expressions that must be true to pass the filter.
   var expressions = [];
-  var needsArguments = false;
-  for (var n = 0; n < expr.arg_query.length; n++) {
-    var binaryExpression = expr.arg_query[n];
+  var regexCount = 0;
+  for (var n = 0; n < argQuery.length; n++) {
+    var binaryExpression = argQuery[n];
 
     // If either side references an argument, ensure the argument exists.
     var argumentInfos = [
@@ -293,11 +527,11 @@ wtf.db.Filter.prototype.generateArgumentFilter_ = function(expr) {
         continue;
       }
       if (argumentInfo.name) {
-        expressions.push('args["' + argumentInfo.name + '"] !== undefined');
-        needsArguments = true;
+        expressions.push(
+            accessors.argument(argumentInfo.name) + ' !== undefined');
       }
       if (argumentInfo.requiresScope) {
-        expressions.push('it.isScope()');
+        expressions.push(accessors.isScope);
       }
     }
 
@@ -325,19 +559,7 @@ wtf.db.Filter.prototype.generateArgumentFilter_ = function(expr) {
     }
   }
 
-  // Only add arguments object if any expressions use it.
-  if (needsArguments) {
-    builder.append('var args = it.getArguments();');
-    builder.append('if (!args) return false;');
-  }
-
-  if (expressions.length) {
-    builder.append('return ' + expressions.join(' && ') + ';');
-  } else {
-    builder.append('return true;');
-  }
-
-  return builder.end('argumentFilter');
+  return expressions.length ? expressions.join(' && ') : 'true';
 
   function getExpressionArgumentInfo(exprValue) {
     if (exprValue.type != 'reference') {
@@ -385,12 +607,13 @@ wtf.db.Filter.prototype.generateArgumentFilter_ = function(expr) {
       case 'object':
         return goog.global.JSON.stringify(exprValue.value);
       case 'regex':
-        var regExpr = '(new RegExp("' + String(exprValue.value) + '"';
-        if (exprValue.value.flags) {
-          regExpr += ', "' + String(exprValue.flags) + '"';
-        }
-        regExpr += '))';
-        return regExpr;
+        // Regex literals may be nested inside of a value.
+        var regex = goog.isString(exprValue.value) ?
+            exprValue : exprValue.value;
+        var regexName = 'regex' + regexCount++;
+        builder.addScopeVariable(regexName, wtf.db.Filter.createRegExp_(
+            String(regex.value), regex.flags));
+        return regexName;
       case 'reference':
         return stringifyReferenceAccess(exprValue.value);
       default:
@@ -402,18 +625,18 @@ wtf.db.Filter.prototype.generateArgumentFilter_ = function(expr) {
       if (access[0] == '@') {
         switch (access.toLowerCase()) {
           case '@time':
-            return 'it.getTime()';
+            return accessors.time;
           case '@duration':
-            return 'it.getTotalDuration()';
+            return accessors.duration;
           case '@userduration':
-            return 'it.getUserDuration()';
+            return accessors.userDuration;
           case '@ownduration':
-            return 'it.getOwnDuration()';
+            return accessors.ownDuration;
           default:
             throw new Error('Unknown event attribute: ' + access);
         }
       } else {
-        return 'args["' + access + '"]';
+        return accessors.argument(access);
       }
     } else {
       var name = goog.isString(access.name) ?
@@ -454,26 +677,120 @@ wtf.db.Filter.prototype.getMatchedEventTypes = function(eventTypeTable) {
 
 
 /**
- * Filters an event list and returns an iterator with only those events
- * selected.
+ * Creates a function that scans ranges of an event list for matching events.
+ * The matched event types are resolved once, so ranges can be scanned
+ * incrementally without repeating the setup for each range. Event types
+ * defined after the scanner is created are not matched.
  * @param {!wtf.db.EventList} eventList Event list.
- * @return {!wtf.db.EventIterator} Filtered iterator.
+ * @return {wtf.db.Filter.ScanFunction} Scan function.
  */
-wtf.db.Filter.prototype.applyToEventList = function(eventList) {
+wtf.db.Filter.prototype.createScanner = function(eventList) {
   var matchedEventTypes = this.getMatchedEventTypes(eventList.eventTypeTable);
-  var argumentFilter = this.argumentFilter_;
 
-  // Build a list of all event IDs that match.
-  var matches = [];
-  var it = eventList.begin();
-  for (; !it.done(); it.next()) {
-    if (matchedEventTypes[it.getTypeId()]) {
-      if (argumentFilter ? argumentFilter(it) : true) {
-        matches.push(it.getId());
+  // Without an argument filter the matches are the union of the type bitmaps,
+  // so only events of the matched types are visited. Ranges that have not
+  // been indexed yet fall back to scanning.
+  var typeIndex = eventList.getTypeIndex();
+  var matchedTypeIds = [];
+  for (var typeId in matchedEventTypes) {
+    if (matchedEventTypes[typeId]) {
+      matchedTypeIds.push(Number(typeId));
+    }
+  }
+  var scanData = this.createDataScanner_(eventList, matchedEventTypes);
+  if (this.argumentFilter_) {
+    return scanData;
+  }
+  return function(start, end, matches) {
+    if (end > typeIndex.getIndexedCount()) {
+      scanData(start, end, matches);
+      return;
+    }
+    var bitmaps = [];
+    for (var n = 0; n < matchedTypeIds.length; n++) {
+      var bitmap = typeIndex.getBitmap(matchedTypeIds[n]);
+      if (bitmap) {
+        bitmaps.push(bitmap.slice(start, end));
+      }
+    }
+    if (bitmaps.length == 1) {
+      bitmaps[0].toArray(matches);
+    } else if (bitmaps.length) {
+      wtf.db.EventBitmap.unionAll(bitmaps).toArray(matches);
+    }
+  };
+};
+
+
+/**
+ * Creates a scan function that reads the event data of each event.
+ * @param {!wtf.db.EventList} eventList Event list.
+ * @param {!Object.<number, boolean>} matchedEventTypes Type ID map from
+ *     {@see #getMatchedEventTypes}.
+ * @return {wtf.db.Filter.ScanFunction} Scan function.
+ * @private
+ */
+wtf.db.Filter.prototype.createDataScanner_ = function(
+    eventList, matchedEventTypes) {
+  var kernel = this.kernel_;
+  if (!kernel && wtf.util.FunctionBuilder.isSupported()) {
+    kernel = wtf.db.Filter.defaultKernel_;
+    if (!kernel) {
+      kernel = wtf.db.Filter.defaultKernel_ = wtf.db.Filter.generateKernel_(
+          null);
+    }
+  }
+  if (kernel) {
+    // Scan the event data directly with a bitset of the matched types.
+    var typeBits = new Uint32Array((eventList.eventTypeTable.getAll().length +
+        32) >> 5);
+    for (var typeId in matchedEventTypes) {
+      if (matchedEventTypes[typeId]) {
+        var id = Number(typeId);
+        if ((id >> 5) >= typeBits.length) {
+          var newTypeBits = new Uint32Array((id >> 5) + 1);
+          newTypeBits.set(typeBits);
+          typeBits = newTypeBits;
+        }
+        typeBits[id >> 5] |= 1 << (id & 31);
       }
     }
+    var argumentTable = eventList.getArgumentTable();
+    var getArgument = goog.bind(argumentTable.getValue, argumentTable);
+    return function(start, end, matches) {
+      // Event data may be reallocated as events are added, so fetch it each
+      // time.
+      kernel(eventList.eventData, start, end, typeBits, getArgument, matches);
+    };
+  } else {
+    var argumentFilter = this.argumentFilter_;
+    return function(start, end, matches) {
+      if (start >= end) {
+        return;
+      }
+      var it = eventList.begin();
+      it.seek(start);
+      for (; !it.done() && it.getId() < end; it.next()) {
+        if (matchedEventTypes[it.getTypeId()]) {
+          if (argumentFilter ? argumentFilter(it) : true) {
+            matches.push(it.getId());
+          }
+        }
+      }
+    };
   }
+};
+
 
+/**
+ * Filters an event list and returns an iterator with only those events
+ * selected.
+ * @param {!wtf.db.EventList} eventList Event list.
+ * @return {!wtf.db.EventIterator} Filtered iterator.
+ */
+wtf.db.Filter.prototype.applyToEventList = function(eventList) {
+  var matches = [];
+  this.createScanner(eventList)(0, eventList.count, matches);
   return new wtf.db.EventIterator(
       eventList, 0, matches.length - 1, 0, matches);
 };
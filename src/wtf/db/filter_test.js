@@ -0,0 +1,88 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+goog.provide('wtf.db.Filter_test');
+
+goog.require('wtf.db.Filter');
+goog.require('wtf.testing');
+
+
+/**
+ * wtf.db.Filter testing.
+ */
+wtf.db.Filter_test = suite('wtf.db.Filter', function() {
+  function getIds(it) {
+    var ids = [];
+    for (; !it.done(); it.next()) {
+      ids.push(it.getId());
+    }
+    return ids;
+  };
+
+  test('applyToEventList', function() {
+    var eventList = wtf.testing.createEventList({
+      instanceEventTypes: [
+        'wtf.scope#leave()',
+        'a(uint32 x, ascii s)',
+        'b()'
+      ],
+      scopeEventTypes: [
+        'c()'
+      ],
+      events: [
+        [0, 'a', 1, 'foo'],
+        [1, 'b'],
+        [2, 'c'],
+        [2.5, 'a', 5, 'Bar'],
+        [4, 'wtf.scope#leave'],
+        [5, 'a', 9, 'baz']
+      ]
+    });
+
+    var filter = new wtf.db.Filter();
+    assert.lengthOf(getIds(filter.applyToEventList(eventList)), 6);
+
+    filter.setFromString('b');
+    assert.deepEqual(getIds(filter.applyToEventList(eventList)), [1]);
+
+    filter.setFromString('a(x > 1)');
+    assert.deepEqual(getIds(filter.applyToEventList(eventList)), [3, 5]);
+
+    filter.setFromString('a(s =~ /^b/i)');
+    assert.deepEqual(getIds(filter.applyToEventList(eventList)), [3, 5]);
+
+    // Global regexes are shared by all events and must not keep state.
+    filter.setFromString('a(s =~ /^b/gi)');
+    assert.deepEqual(getIds(filter.applyToEventList(eventList)), [3, 5]);
+
+    filter.setFromString('a(@time < 3)');
+    assert.deepEqual(getIds(filter.applyToEventList(eventList)), [0, 3]);
+
+    filter.setFromString('c(@duration == 2)');
+    assert.deepEqual(getIds(filter.applyToEventList(eventList)), [2]);
+
+    // Kernels must match the iterator argument filters.
+    filter.setFromString('a(x < 9)');
+    var argumentFilter = filter.getArgumentFilter();
+    var expected = [];
+    for (var it = eventList.begin(); !it.done(); it.next()) {
+      if (it.getName() == 'a' && argumentFilter(it)) {
+        expected.push(it.getId());
+      }
+    }
+    assert.deepEqual(getIds(filter.applyToEventList(eventList)), expected);
+  });
+
+  test('compiledCache', function() {
+    var filterA = new wtf.db.Filter('a(x == 1)');
+    var filterB = new wtf.db.Filter('  a(x == 1) ');
+    assert.strictEqual(
+        filterA.getArgumentFilter(), filterB.getArgumentFilter());
+    assert.strictEqual(
+        filterA.getEventTypeFilter(), filterB.getEventTypeFilter());
+  });
+});
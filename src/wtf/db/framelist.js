@@ -16,6 +16,7 @@ goog.provide('wtf.db.FrameList');
 goog.require('goog.array');
 goog.require('goog.math');
 goog.require('wtf.db.Frame');
+goog.require('wtf.db.FrameStatistics');
 goog.require('wtf.db.IAncillaryList');
 goog.require('wtf.events.EventEmitter');
 goog.require('wtf.events.EventType');
@@ -55,6 +56,30 @@ wtf.db.FrameList = function(eventList) {
    */
   this.frameList_ = [];
 
+  /**
+   * Frames that have started but not yet ended as of the last rebuild.
+   * These are not exposed but are retained so that appended events can
+   * complete them.
+   * @type {!Array.<!wtf.db.Frame>}
+   * @private
+   */
+  this.pendingFrames_ = [];
+
+  /**
+   * Index into the frame list of the first frame touched by the current
+   * rebuild.
+   * @type {number}
+   * @private
+   */
+  this.rebuildStart_ = 0;
+
+  /**
+   * Jank statistics of the frames, updated as frames are added.
+   * @type {!wtf.db.FrameStatistics}
+   * @private
+   */
+  this.statistics_ = new wtf.db.FrameStatistics(eventList);
+
   this.eventList_.registerAncillaryList(this);
 };
 goog.inherits(wtf.db.FrameList, wtf.events.EventEmitter);
@@ -99,6 +124,36 @@ wtf.db.FrameList.prototype.getFrame = function(value) {
 };
 
 
+/**
+ * Gets the jank statistics of the frames.
+ * @return {!wtf.db.FrameStatistics} Frame statistics.
+ */
+wtf.db.FrameList.prototype.getStatistics = function() {
+  return this.statistics_;
+};
+
+
+/**
+ * Gets the frames at or over the given percentile of duration.
+ * @param {number} percentile Percentile, from 0 to 100.
+ * @return {!Array.<!wtf.db.Frame>} Frames, in time order.
+ */
+wtf.db.FrameList.prototype.getSlowFrames = function(percentile) {
+  var result = [];
+  if (!this.frameList_.length) {
+    return result;
+  }
+  var threshold = this.statistics_.getPercentile(percentile);
+  for (var n = 0; n < this.frameList_.length; n++) {
+    var frame = this.frameList_[n];
+    if (frame.getDuration() >= threshold) {
+      result.push(frame);
+    }
+  }
+  return result;
+};
+
+
 /**
  * Gets the frame preceeding the given frame.
  * @param {!wtf.db.Frame} frame Base frame.
@@ -223,6 +278,32 @@ wtf.db.FrameList.prototype.forEachIntersecting = function(
  * @override
  */
 wtf.db.FrameList.prototype.beginRebuild = function(eventTypeTable) {
+  // Partial frames will be found again.
+  this.pendingFrames_.length = 0;
+  this.rebuildStart_ = 0;
+  this.statistics_.reset();
+  return [
+    eventTypeTable.getByName('wtf.timing#frameStart'),
+    eventTypeTable.getByName('wtf.timing#frameEnd')
+  ];
+};
+
+
+/**
+ * @override
+ */
+wtf.db.FrameList.prototype.beginAppend = function(eventTypeTable) {
+  // Restore frames that have started so that they can be ended.
+  // Frames missing their start can never be completed by new events.
+  this.rebuildStart_ = this.frameList_.length;
+  for (var n = 0; n < this.pendingFrames_.length; n++) {
+    var frame = this.pendingFrames_[n];
+    if (frame.getTime()) {
+      this.frames_[frame.getNumber()] = frame;
+      this.frameList_.push(frame);
+    }
+  }
+  this.pendingFrames_.length = 0;
   return [
     eventTypeTable.getByName('wtf.timing#frameStart'),
     eventTypeTable.getByName('wtf.timing#frameEnd')
@@ -258,18 +339,24 @@ wtf.db.FrameList.prototype.handleEvent = function(
  */
 wtf.db.FrameList.prototype.endRebuild = function() {
   // Scan frames and remove any that are partial.
-  // They aren't worth the extra work to render like that.
-  var validFrames = [];
-  for (var n = 0; n < this.frameList_.length; n++) {
-    var frame = this.frameList_[n];
+  // They aren't worth the extra work to render like that, but are kept around
+  // in case new events complete them.
+  var frameList = this.frameList_;
+  var validCount = this.rebuildStart_;
+  for (var n = this.rebuildStart_; n < frameList.length; n++) {
+    var frame = frameList[n];
     if (frame.getTime() && frame.getEndTime()) {
-      frame.setOrdinal(validFrames.length);
-      validFrames.push(frame);
+      frame.setOrdinal(validCount);
+      frameList[validCount++] = frame;
     } else {
       delete this.frames_[frame.getNumber()];
+      this.pendingFrames_.push(frame);
     }
   }
-  this.frameList_ = validFrames;
+  frameList.length = validCount;
+
+  // Only frames touched by this rebuild need their statistics computed.
+  this.statistics_.update(frameList, this.rebuildStart_);
 
   this.emitEvent(wtf.events.EventType.INVALIDATED);
 };
@@ -284,6 +371,12 @@ goog.exportProperty(
 goog.exportProperty(
     wtf.db.FrameList.prototype, 'getFrame',
     wtf.db.FrameList.prototype.getFrame);
+goog.exportProperty(
+    wtf.db.FrameList.prototype, 'getStatistics',
+    wtf.db.FrameList.prototype.getStatistics);
+goog.exportProperty(
+    wtf.db.FrameList.prototype, 'getSlowFrames',
+    wtf.db.FrameList.prototype.getSlowFrames);
 goog.exportProperty(
     wtf.db.FrameList.prototype, 'getPreviousFrame',
     wtf.db.FrameList.prototype.getPreviousFrame);
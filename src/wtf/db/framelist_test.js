@@ -143,6 +143,45 @@ wtf.db.FrameList_test = suite('wtf.db.FrameList', function() {
     assert.lengthOf(frameList.getAllFrames(), 2);
   });
 
+  test('rebuildAppendedPartial', function() {
+    var eventTypeTable = new wtf.db.EventTypeTable();
+    var eventList = new wtf.db.EventList(eventTypeTable);
+    var frameList = new wtf.db.FrameList(eventList);
+
+    wtf.testing.insertEvents(eventList, {
+      instanceEventTypes: [
+        'wtf.timing#frameStart(uint32 number)',
+        'wtf.timing#frameEnd(uint32 number)'
+      ],
+      events: [
+        [10, 'wtf.timing#frameStart', 100],
+        [30, 'wtf.timing#frameEnd', 100],
+        [50, 'wtf.timing#frameStart', 200]
+      ]
+    });
+
+    // The partial frame is hidden until it ends.
+    assert.equal(frameList.getCount(), 1);
+    assert.isNull(frameList.getFrame(200));
+
+    wtf.testing.insertEvents(eventList, {
+      events: [
+        [70, 'wtf.timing#frameEnd', 200],
+        [90, 'wtf.timing#frameStart', 300]
+      ]
+    });
+
+    assert.equal(frameList.getCount(), 2);
+    var frame200 = frameList.getFrame(200);
+    assert.isNotNull(frame200);
+    assert.equal(frame200.getTime(), 50);
+    assert.equal(frame200.getEndTime(), 70);
+    assert.equal(frameList.getAllFrames()[1], frame200);
+    assert.equal(
+        frameList.getNextFrame(frameList.getFrame(100)), frame200);
+    assert.isNull(frameList.getFrame(300));
+  });
+
   test('frames', function() {
     var eventTypeTable = new wtf.db.EventTypeTable();
     var eventList = new wtf.db.EventList(eventTypeTable);
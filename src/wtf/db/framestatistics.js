@@ -0,0 +1,417 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/**
+ * @fileoverview Per-frame jank statistics.
+ * Frame durations and the scopes that took the most time in each frame are
+ * computed with a single pass over the events of new frames as the frame list
+ * rebuilds. Queries for the slowest frames and what ran in them are then
+ * answered without walking any events.
+ *
+ * @author benvanik@google.com (Ben Vanik)
+ */
+
+goog.provide('wtf.db.FrameStatistics');
+goog.provide('wtf.db.FrameStatistics.Entry');
+
+goog.require('goog.array');
+goog.require('wtf.data.EventClass');
+goog.require('wtf.data.EventFlag');
+goog.require('wtf.db.EventStruct');
+
+
+
+/**
+ * Jank statistics of a frame list.
+ * This is maintained by the frame list as it rebuilds.
+ *
+ * @param {!wtf.db.EventList} eventList Event list.
+ * @constructor
+ */
+wtf.db.FrameStatistics = function(eventList) {
+  /**
+   * Event list the frames are in.
+   * @type {!wtf.db.EventList}
+   * @private
+   */
+  this.eventList_ = eventList;
+
+  /**
+   * Number of frames with statistics.
+   * @type {number}
+   * @private
+   */
+  this.frameCount_ = 0;
+
+  /**
+   * Frame durations, in ms, by frame ordinal.
+   * @type {!Float64Array}
+   * @private
+   */
+  this.durations_ = new Float64Array(0);
+
+  /**
+   * Type IDs of the top scopes of each frame, {@see #TOP_COUNT} per frame in
+   * descending own time order. Unused slots are 0.
+   * @type {!Uint16Array}
+   * @private
+   */
+  this.topTypeIds_ = new Uint16Array(0);
+
+  /**
+   * Own times, in ms, matching {@see #topTypeIds_}.
+   * @type {!Float32Array}
+   * @private
+   */
+  this.topOwnTimes_ = new Float32Array(0);
+
+  /**
+   * Frame durations in ascending order, computed on demand.
+   * @type {Float64Array}
+   * @private
+   */
+  this.sortedDurations_ = null;
+
+  /**
+   * Cache of type ID -> whether the type is a visible scope.
+   * @type {!Array.<boolean>}
+   * @private
+   */
+  this.isScopeType_ = [];
+};
+
+
+/**
+ * Number of top scopes kept for each frame.
+ * @const
+ * @type {number}
+ */
+wtf.db.FrameStatistics.TOP_COUNT = 5;
+
+
+/**
+ * Removes all statistics.
+ */
+wtf.db.FrameStatistics.prototype.reset = function() {
+  this.frameCount_ = 0;
+  this.sortedDurations_ = null;
+  this.isScopeType_.length = 0;
+};
+
+
+/**
+ * Computes statistics for frames that have been added or changed.
+ * Scopes are attributed to the frame they start in and only scopes that
+ * start between the frame start and end events are counted.
+ * @param {!Array.<!wtf.db.Frame>} frames All frames, by ordinal.
+ * @param {number} startOrdinal Ordinal of the first changed frame.
+ */
+wtf.db.FrameStatistics.prototype.update = function(frames, startOrdinal) {
+  var topCount = wtf.db.FrameStatistics.TOP_COUNT;
+  this.ensureCapacity_(frames.length);
+  this.frameCount_ = frames.length;
+  this.sortedDurations_ = null;
+
+  var eventList = this.eventList_;
+  var eventTypeTable = eventList.eventTypeTable;
+  var eventData = eventList.eventData;
+  var typeIndex = eventList.getTypeIndex();
+  var count = typeIndex.getIndexedCount();
+  var isScopeType = this.isScopeType_;
+  var hiddenFlags =
+      wtf.data.EventFlag.INTERNAL |
+      wtf.data.EventFlag.APPEND_SCOPE_DATA |
+      wtf.data.EventFlag.APPEND_FLOW_DATA;
+
+  var durations = this.durations_;
+  var topTypeIds = this.topTypeIds_;
+  var topOwnTimes = this.topOwnTimes_;
+
+  // Own time by type ID of the current frame, and the types set in it.
+  var ownTimes = [];
+  var frameTypeIds = [];
+
+  for (var n = startOrdinal; n < frames.length; n++) {
+    var frame = frames[n];
+    durations[n] = frame.getDuration();
+
+    // Accumulate own time of the scopes in the frame.
+    var endTime = frame.getEndTime() * 1000;
+    var i = typeIndex.getFirstIndexAtTime(frame.getTime());
+    for (var o = i * wtf.db.EventStruct.STRUCT_SIZE; i < count;
+        i++, o += wtf.db.EventStruct.STRUCT_SIZE) {
+      var time = eventData[o + wtf.db.EventStruct.TIME];
+      if (time > endTime) {
+        break;
+      }
+      var typeId = eventData[o + wtf.db.EventStruct.TYPE] & 0xFFFF;
+      var isScope = isScopeType[typeId];
+      if (isScope === undefined) {
+        var type = eventTypeTable.getById(typeId);
+        isScope = isScopeType[typeId] =
+            !!type && type.eventClass == wtf.data.EventClass.SCOPE &&
+            !(type.flags & hiddenFlags);
+      }
+      var scopeEndTime = eventData[o + wtf.db.EventStruct.END_TIME];
+      if (!isScope || !scopeEndTime) {
+        continue;
+      }
+      var ownTime = scopeEndTime - time -
+          eventData[o + wtf.db.EventStruct.CHILD_TIME];
+      if (ownTimes[typeId] === undefined) {
+        ownTimes[typeId] = ownTime;
+        frameTypeIds.push(typeId);
+      } else {
+        ownTimes[typeId] += ownTime;
+      }
+    }
+
+    // Keep the top types in descending order with an insertion sort, as only
+    // a handful are kept.
+    var base = n * topCount;
+    for (var m = 0; m < topCount; m++) {
+      topTypeIds[base + m] = 0;
+      topOwnTimes[base + m] = 0;
+    }
+    var used = 0;
+    for (var m = 0; m < frameTypeIds.length; m++) {
+      var typeId = frameTypeIds[m];
+      var ownTime = ownTimes[typeId] / 1000;
+      ownTimes[typeId] = undefined;
+      if (used == topCount && ownTime <= topOwnTimes[base + topCount - 1]) {
+        continue;
+      }
+      var slot = used < topCount ? used++ : topCount - 1;
+      while (slot > 0 && topOwnTimes[base + slot - 1] < ownTime) {
+        topTypeIds[base + slot] = topTypeIds[base + slot - 1];
+        topOwnTimes[base + slot] = topOwnTimes[base + slot - 1];
+        slot--;
+      }
+      topTypeIds[base + slot] = typeId;
+      topOwnTimes[base + slot] = ownTime;
+    }
+    frameTypeIds.length = 0;
+  }
+};
+
+
+/**
+ * Grows the frame arrays to hold at least the given number of frames.
+ * @param {number} frameCount Frame count.
+ * @private
+ */
+wtf.db.FrameStatistics.prototype.ensureCapacity_ = function(frameCount) {
+  if (this.durations_.length >= frameCount) {
+    return;
+  }
+  var capacity = Math.max(frameCount, this.durations_.length * 2, 64);
+  var topCount = wtf.db.FrameStatistics.TOP_COUNT;
+
+  var durations = new Float64Array(capacity);
+  durations.set(this.durations_);
+  this.durations_ = durations;
+
+  var topTypeIds = new Uint16Array(capacity * topCount);
+  topTypeIds.set(this.topTypeIds_);
+  this.topTypeIds_ = topTypeIds;
+
+  var topOwnTimes = new Float32Array(capacity * topCount);
+  topOwnTimes.set(this.topOwnTimes_);
+  this.topOwnTimes_ = topOwnTimes;
+};
+
+
+/**
+ * Gets the number of frames with statistics.
+ * @return {number} Frame count.
+ */
+wtf.db.FrameStatistics.prototype.getCount = function() {
+  return this.frameCount_;
+};
+
+
+/**
+ * Gets the frame duration at the given percentile.
+ * @param {number} percentile Percentile, from 0 to 100.
+ * @return {number} Duration, in ms, or 0 if there are no frames.
+ */
+wtf.db.FrameStatistics.prototype.getPercentile = function(percentile) {
+  var count = this.frameCount_;
+  if (!count) {
+    return 0;
+  }
+  var sortedDurations = this.sortedDurations_;
+  if (!sortedDurations) {
+    sortedDurations = this.sortedDurations_ = new Float64Array(count);
+    sortedDurations.set(this.durations_.subarray(0, count));
+    goog.array.sort(sortedDurations);
+  }
+
+  // Nearest rank.
+  var rank = Math.ceil(percentile / 100 * count);
+  rank = Math.min(Math.max(rank, 1), count);
+  return sortedDurations[rank - 1];
+};
+
+
+/**
+ * Gets the top scopes of a frame.
+ * @param {!wtf.db.Frame} frame Frame.
+ * @return {!Array.<!wtf.db.FrameStatistics.Entry>} Scopes in descending own
+ *     time order. There are at most {@see #TOP_COUNT}.
+ */
+wtf.db.FrameStatistics.prototype.getTopScopes = function(frame) {
+  var result = [];
+  var ordinal = frame.getOrdinal();
+  if (ordinal >= this.frameCount_) {
+    return result;
+  }
+  var eventTypeTable = this.eventList_.eventTypeTable;
+  var topCount = wtf.db.FrameStatistics.TOP_COUNT;
+  for (var n = ordinal * topCount; n < (ordinal + 1) * topCount; n++) {
+    var eventType = eventTypeTable.getById(this.topTypeIds_[n]);
+    if (!eventType || !this.topOwnTimes_[n]) {
+      break;
+    }
+    result.push(new wtf.db.FrameStatistics.Entry(
+        eventType, this.topOwnTimes_[n], 1));
+  }
+  return result;
+};
+
+
+/**
+ * Gets the scopes that took the most time in the frames at or over the given
+ * percentile of duration.
+ * Only the top scopes of each frame are considered.
+ * @param {number} percentile Percentile, from 0 to 100.
+ * @param {number=} opt_count Maximum number of entries to return.
+ * @return {!Array.<!wtf.db.FrameStatistics.Entry>} Scopes in descending total
+ *     own time order.
+ */
+wtf.db.FrameStatistics.prototype.getHotspots = function(
+    percentile, opt_count) {
+  var entries = [];
+  if (!this.frameCount_) {
+    return entries;
+  }
+  var threshold = this.getPercentile(percentile);
+  var eventTypeTable = this.eventList_.eventTypeTable;
+  var topCount = wtf.db.FrameStatistics.TOP_COUNT;
+  var entriesByType = {};
+  for (var n = 0; n < this.frameCount_; n++) {
+    if (this.durations_[n] < threshold) {
+      continue;
+    }
+    for (var m = n * topCount; m < (n + 1) * topCount; m++) {
+      var ownTime = this.topOwnTimes_[m];
+      if (!ownTime) {
+        break;
+      }
+      var typeId = this.topTypeIds_[m];
+      var entry = entriesByType[typeId];
+      if (entry) {
+        entry.ownTime += ownTime;
+        entry.frameCount++;
+      } else {
+        var eventType = eventTypeTable.getById(typeId);
+        if (eventType) {
+          entry = entriesByType[typeId] =
+              new wtf.db.FrameStatistics.Entry(eventType, ownTime, 1);
+          entries.push(entry);
+        }
+      }
+    }
+  }
+
+  entries.sort(function(a, b) {
+    return b.ownTime - a.ownTime;
+  });
+  if (opt_count !== undefined && entries.length > opt_count) {
+    entries.length = opt_count;
+  }
+  return entries;
+};
+
+
+
+/**
+ * Own time of a scope type over one or more frames.
+ * @param {!wtf.db.EventType} eventType Scope event type.
+ * @param {number} ownTime Own time, in ms.
+ * @param {number} frameCount Number of frames the time was spent in.
+ * @constructor
+ */
+wtf.db.FrameStatistics.Entry = function(eventType, ownTime, frameCount) {
+  /**
+   * Scope event type.
+   * @type {!wtf.db.EventType}
+   */
+  this.eventType = eventType;
+
+  /**
+   * Own time, excluding children, in ms.
+   * @type {number}
+   */
+  this.ownTime = ownTime;
+
+  /**
+   * Number of frames the time was spent in.
+   * @type {number}
+   */
+  this.frameCount = frameCount;
+};
+
+
+/**
+ * Gets the scope event type.
+ * @return {!wtf.db.EventType} Event type.
+ */
+wtf.db.FrameStatistics.Entry.prototype.getEventType = function() {
+  return this.eventType;
+};
+
+
+/**
+ * Gets the own time of the scope across the frames.
+ * @return {number} Own time, in ms.
+ */
+wtf.db.FrameStatistics.Entry.prototype.getOwnTime = function() {
+  return this.ownTime;
+};
+
+
+/**
+ * Gets the number of frames the time was spent in.
+ * @return {number} Frame count.
+ */
+wtf.db.FrameStatistics.Entry.prototype.getFrameCount = function() {
+  return this.frameCount;
+};
+
+
+goog.exportProperty(
+    wtf.db.FrameStatistics.prototype, 'getCount',
+    wtf.db.FrameStatistics.prototype.getCount);
+goog.exportProperty(
+    wtf.db.FrameStatistics.prototype, 'getPercentile',
+    wtf.db.FrameStatistics.prototype.getPercentile);
+goog.exportProperty(
+    wtf.db.FrameStatistics.prototype, 'getTopScopes',
+    wtf.db.FrameStatistics.prototype.getTopScopes);
+goog.exportProperty(
+    wtf.db.FrameStatistics.prototype, 'getHotspots',
+    wtf.db.FrameStatistics.prototype.getHotspots);
+goog.exportProperty(
+    wtf.db.FrameStatistics.Entry.prototype, 'getEventType',
+    wtf.db.FrameStatistics.Entry.prototype.getEventType);
+goog.exportProperty(
+    wtf.db.FrameStatistics.Entry.prototype, 'getOwnTime',
+    wtf.db.FrameStatistics.Entry.prototype.getOwnTime);
+goog.exportProperty(
+    wtf.db.FrameStatistics.Entry.prototype, 'getFrameCount',
+    wtf.db.FrameStatistics.Entry.prototype.getFrameCount);
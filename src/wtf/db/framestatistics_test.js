@@ -0,0 +1,141 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+goog.provide('wtf.db.FrameStatistics_test');
+
+goog.require('wtf.db.EventList');
+goog.require('wtf.db.EventTypeTable');
+goog.require('wtf.db.FrameList');
+goog.require('wtf.db.FrameStatistics');
+goog.require('wtf.testing');
+
+
+/**
+ * wtf.db.FrameStatistics testing.
+ */
+wtf.db.FrameStatistics_test = suite('wtf.db.FrameStatistics', function() {
+  /**
+   * Gets the names and own times of statistic entries.
+   * @param {!Array.<!wtf.db.FrameStatistics.Entry>} entries Entries.
+   * @return {!Array.<!Array>} [name, own time] pairs.
+   */
+  function describe(entries) {
+    var result = [];
+    for (var n = 0; n < entries.length; n++) {
+      result.push([entries[n].getEventType().getName(), entries[n].ownTime]);
+    }
+    return result;
+  };
+
+  test('statistics', function() {
+    var eventTypeTable = new wtf.db.EventTypeTable();
+    var eventList = new wtf.db.EventList(eventTypeTable);
+    var frameList = new wtf.db.FrameList(eventList);
+    var statistics = frameList.getStatistics();
+    assert.equal(statistics.getCount(), 0);
+    assert.equal(statistics.getPercentile(50), 0);
+    assert.lengthOf(statistics.getHotspots(99), 0);
+
+    wtf.testing.insertEvents(eventList, {
+      instanceEventTypes: [
+        'wtf.timing#frameStart(uint32 number)',
+        'wtf.timing#frameEnd(uint32 number)',
+        'wtf.scope#leave()'
+      ],
+      scopeEventTypes: [
+        'update()',
+        'layout()',
+        'paint()'
+      ],
+      events: [
+        [0.5, 'wtf.timing#frameStart', 1],
+        [1, 'update'],
+        [2, 'layout'],
+        [5, 'wtf.scope#leave'],
+        [6, 'wtf.scope#leave'],
+        [10, 'wtf.timing#frameEnd', 1],
+        [20, 'wtf.timing#frameStart', 2],
+        [21, 'update'],
+        [31, 'wtf.scope#leave'],
+        [32, 'paint'],
+        [52, 'wtf.scope#leave'],
+        [60, 'wtf.timing#frameEnd', 2],
+        // Outside of any frame.
+        [70, 'paint'],
+        [90, 'wtf.scope#leave'],
+        [100, 'wtf.timing#frameStart', 3],
+        [101, 'layout'],
+        [104, 'wtf.scope#leave'],
+        [105, 'wtf.timing#frameEnd', 3]
+      ]
+    });
+
+    assert.equal(statistics.getCount(), 3);
+    assert.equal(statistics.getPercentile(0), 5);
+    assert.equal(statistics.getPercentile(50), 9.5);
+    assert.equal(statistics.getPercentile(99), 40);
+    assert.equal(statistics.getPercentile(100), 40);
+
+    // Own time excludes children.
+    var frame1 = frameList.getFrame(1);
+    assert.deepEqual(
+        describe(statistics.getTopScopes(frame1)),
+        [['layout', 3], ['update', 2]]);
+    var frame2 = frameList.getFrame(2);
+    assert.deepEqual(
+        describe(statistics.getTopScopes(frame2)),
+        [['paint', 20], ['update', 10]]);
+
+    assert.deepEqual(frameList.getSlowFrames(90), [frame2]);
+    assert.deepEqual(
+        describe(statistics.getHotspots(90)),
+        [['paint', 20], ['update', 10]]);
+    var hotspots = statistics.getHotspots(0, 2);
+    assert.deepEqual(describe(hotspots), [['paint', 20], ['update', 12]]);
+    assert.equal(hotspots[1].getFrameCount(), 2);
+  });
+
+  test('appended', function() {
+    var eventTypeTable = new wtf.db.EventTypeTable();
+    var eventList = new wtf.db.EventList(eventTypeTable);
+    var frameList = new wtf.db.FrameList(eventList);
+    var statistics = frameList.getStatistics();
+
+    wtf.testing.insertEvents(eventList, {
+      instanceEventTypes: [
+        'wtf.timing#frameStart(uint32 number)',
+        'wtf.timing#frameEnd(uint32 number)',
+        'wtf.scope#leave()'
+      ],
+      scopeEventTypes: [
+        'update()'
+      ],
+      events: [
+        [0.5, 'wtf.timing#frameStart', 1],
+        [1, 'update'],
+        [3, 'wtf.scope#leave'],
+        [10, 'wtf.timing#frameEnd', 1],
+        [20, 'wtf.timing#frameStart', 2],
+        [21, 'update'],
+        [29, 'wtf.scope#leave']
+      ]
+    });
+    assert.equal(statistics.getCount(), 1);
+
+    // The pending frame is completed by appended events.
+    wtf.testing.insertEvents(eventList, {
+      events: [
+        [50, 'wtf.timing#frameEnd', 2]
+      ]
+    });
+    assert.equal(statistics.getCount(), 2);
+    assert.equal(statistics.getPercentile(100), 30);
+    assert.deepEqual(
+        describe(statistics.getTopScopes(frameList.getFrame(2))),
+        [['update', 8]]);
+  });
+});
@@ -58,6 +58,14 @@ wtf.db.HealthInfo = function(db, opt_table) {
    */
   this.totalOverheadPercent_ = 0;
 
+  /**
+   * Whether the overhead estimates use event costs measured when the trace
+   * was recorded, rather than a guess based on the time source.
+   * @type {boolean}
+   * @private
+   */
+  this.isOverheadCalibrated_ = false;
+
   /**
    * Generated warnings.
    * @type {!Array.<!wtf.db.HealthWarning>}
@@ -65,8 +73,23 @@ wtf.db.HealthInfo = function(db, opt_table) {
    */
   this.warnings_ = [];
 
+  /**
+   * Number of discontinuities in the trace.
+   * @type {number}
+   * @private
+   */
+  this.discontinuityCount_ = 0;
+
+  /**
+   * Number of events the recording session reported as dropped.
+   * @type {number}
+   * @private
+   */
+  this.droppedEventCount_ = 0;
+
   if (opt_table) {
     this.analyzeStatistics_(db, opt_table);
+    this.analyzeDataLoss_(db);
   }
 };
 
@@ -91,6 +114,16 @@ wtf.db.HealthInfo.prototype.getOverheadPerScopeNs = function() {
 };
 
 
+/**
+ * Whether the overhead estimates are based on event costs measured on the
+ * machine that recorded the trace.
+ * @return {boolean} True if the estimates are calibrated.
+ */
+wtf.db.HealthInfo.prototype.isOverheadCalibrated = function() {
+  return this.isOverheadCalibrated_;
+};
+
+
 /**
  * Total time of the trace that is overhead.
  * @return {number} Overhead as a number of milliseconds.
@@ -109,6 +142,26 @@ wtf.db.HealthInfo.prototype.getTotalOverheadPercent = function() {
 };
 
 
+/**
+ * Gets the number of discontinuities (periods of lost data) in the trace.
+ * @return {number} Discontinuity count.
+ */
+wtf.db.HealthInfo.prototype.getDiscontinuityCount = function() {
+  return this.discontinuityCount_;
+};
+
+
+/**
+ * Gets the number of events the recording session reported as dropped.
+ * Older sessions only recorded discontinuities, so this may be 0 even when
+ * {@see #getDiscontinuityCount} is not.
+ * @return {number} Dropped event count.
+ */
+wtf.db.HealthInfo.prototype.getDroppedEventCount = function() {
+  return this.droppedEventCount_;
+};
+
+
 /**
  * Gets a list of generated warnings.
  * @return {!Array.<!wtf.db.HealthWarning>}
@@ -138,6 +191,7 @@ wtf.db.HealthInfo.prototype.analyzeStatistics_ = function(db, table) {
 
     anyArguments: 0,
     stringArguments: 0,
+    argumentOverheadNs: 0,
 
     avg2us: 0,
     avg5us: 0,
@@ -160,6 +214,12 @@ wtf.db.HealthInfo.prototype.analyzeStatistics_ = function(db, table) {
     counts.frameCount += frameList.getCount();
   }
 
+  // Event costs measured when the trace was recorded, if present.
+  var sources = db.getSources();
+  var metadata = sources.length ? sources[0].getMetadata() : {};
+  var costs = metadata['overheadNs'] || null;
+  var argumentCosts = (costs && costs['arguments']) || {};
+
   // Generate counts.
   var entries = table.getEntries();
   for (var n = 0; n < entries.length; n++) {
@@ -179,6 +239,8 @@ wtf.db.HealthInfo.prototype.analyzeStatistics_ = function(db, table) {
     var args = eventType.getArguments();
     for (var m = 0; m < args.length; m++) {
       var typeName = args[m].typeName;
+      counts.argumentOverheadNs +=
+          entry.getCount() * (argumentCosts[typeName] || 0);
       if (typeName == 'any') {
         counts.anyArguments += entry.getCount();
       } else if (typeName == 'ascii' || typeName == 'utf8') {
@@ -203,19 +265,25 @@ wtf.db.HealthInfo.prototype.analyzeStatistics_ = function(db, table) {
   this.overheadPerScopeNs_ = 0;
   this.totalOverheadMs_ = 0;
   this.totalOverheadPercent_ = 0;
-  var sources = db.getSources();
-  var overheadPerNow = 0;
-  if (sources.length) {
-    var metadata = sources[0].getMetadata();
-    overheadPerNow = metadata['nowTimeNs'] || 0;
-  }
-  if (overheadPerNow) {
-    // Value was present - use it to compute the timings.
+  this.isOverheadCalibrated_ = false;
+  var overheadPerNow = metadata['nowTimeNs'] || 0;
+  if (costs && costs['scope']) {
+    // Calibrated costs were recorded - use them directly.
+    this.isOverheadCalibrated_ = true;
+    this.overheadPerScopeNs_ = costs['scope'];
+    this.totalOverheadMs_ =
+        counts.scopeCount * costs['scope'] +
+        counts.instanceCount * costs['instance'] +
+        counts.argumentOverheadNs;
+  } else if (overheadPerNow) {
+    // Older traces only have the now() time.
     // This is a rough guess that seems to track pretty well across systems.
     this.overheadPerScopeNs_ = overheadPerNow * 2 + overheadPerNow;
     this.totalOverheadMs_ =
         counts.scopeCount * this.overheadPerScopeNs_ +
         counts.instanceCount * (overheadPerNow + overheadPerNow);
+  }
+  if (this.totalOverheadMs_) {
     this.totalOverheadMs_ /= 1000 * 1000; // ns->us->ms
     var totalTraceMs = db.getLastEventTime() - db.getFirstEventTime();
     this.totalOverheadPercent_ = this.totalOverheadMs_ / totalTraceMs;
@@ -318,12 +386,74 @@ wtf.db.HealthInfo.prototype.analyzeStatistics_ = function(db, table) {
 };
 
 
+/**
+ * Scans the database for markers left by the recording session when it had to
+ * drop events.
+ * @param {!wtf.db.Database} db Database.
+ * @private
+ */
+wtf.db.HealthInfo.prototype.analyzeDataLoss_ = function(db) {
+  var zones = db.getZones();
+  for (var n = 0; n < zones.length; n++) {
+    var eventList = zones[n].getEventList();
+    var discontinuityTypeId =
+        eventList.getEventTypeId('wtf.trace#discontinuity');
+    var droppedTypeId = eventList.getEventTypeId('wtf.trace#dropped');
+    if (discontinuityTypeId == -1 && droppedTypeId == -1) {
+      continue;
+    }
+
+    // The markers are rare, so only they are visited through the type index.
+    var typeIndex = eventList.getTypeIndex();
+    var it = eventList.begin();
+    if (discontinuityTypeId != -1) {
+      this.discontinuityCount_ += typeIndex.getCount(discontinuityTypeId);
+    }
+    var droppedBitmap =
+        droppedTypeId != -1 ? typeIndex.getBitmap(droppedTypeId) : null;
+    if (droppedBitmap) {
+      droppedBitmap.forEach(function(index) {
+        it.seek(index);
+        this.droppedEventCount_ += it.getArgument('count') || 0;
+      }, this);
+    }
+
+    // Events added since the index was last updated are scanned.
+    for (it.seek(typeIndex.getIndexedCount()); !it.done(); it.next()) {
+      var typeId = it.getTypeId();
+      if (typeId == discontinuityTypeId) {
+        this.discontinuityCount_++;
+      } else if (typeId == droppedTypeId) {
+        this.droppedEventCount_ += it.getArgument('count') || 0;
+      }
+    }
+  }
+
+  if (this.discontinuityCount_ || this.droppedEventCount_) {
+    this.warnings_.push(new wtf.db.HealthWarning(
+        'Events were dropped while recording.',
+        'The recording buffers filled faster than they were written. ' +
+            'Increase wtf.trace.session.maximumMemoryUsage or record fewer ' +
+            'events.',
+        (this.droppedEventCount_ ?
+            this.droppedEventCount_ + ' events dropped' :
+            'unknown number of events dropped') +
+            ' in ' + this.discontinuityCount_ + ' gaps',
+        'warn_dropped_events'));
+    this.isBad_ = true;
+  }
+};
+
+
 goog.exportSymbol(
     'wtf.db.HealthInfo',
     wtf.db.HealthInfo);
 goog.exportProperty(
     wtf.db.HealthInfo.prototype, 'isBad',
     wtf.db.HealthInfo.prototype.isBad);
+goog.exportProperty(
+    wtf.db.HealthInfo.prototype, 'isOverheadCalibrated',
+    wtf.db.HealthInfo.prototype.isOverheadCalibrated);
 goog.exportProperty(
     wtf.db.HealthInfo.prototype, 'getOverheadPerScopeNs',
     wtf.db.HealthInfo.prototype.getOverheadPerScopeNs);
@@ -333,6 +463,12 @@ goog.exportProperty(
 goog.exportProperty(
     wtf.db.HealthInfo.prototype, 'getTotalOverheadPercent',
     wtf.db.HealthInfo.prototype.getTotalOverheadPercent);
+goog.exportProperty(
+    wtf.db.HealthInfo.prototype, 'getDiscontinuityCount',
+    wtf.db.HealthInfo.prototype.getDiscontinuityCount);
+goog.exportProperty(
+    wtf.db.HealthInfo.prototype, 'getDroppedEventCount',
+    wtf.db.HealthInfo.prototype.getDroppedEventCount);
 goog.exportProperty(
     wtf.db.HealthInfo.prototype, 'getWarnings',
     wtf.db.HealthInfo.prototype.getWarnings);
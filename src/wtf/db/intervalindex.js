@@ -0,0 +1,310 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/**
+ * @fileoverview Scope interval index.
+ * Scopes in an event list are properly nested, so the scopes at any one depth
+ * never overlap and are sorted both by their start and end times. The index
+ * keeps a list of scope IDs per depth so that overlap and containment queries
+ * are a binary search per depth instead of a walk over the events.
+ *
+ * @author benvanik@google.com (Ben Vanik)
+ */
+
+goog.provide('wtf.db.IntervalIndex');
+
+goog.require('wtf.data.EventClass');
+goog.require('wtf.db.EventIterator');
+goog.require('wtf.db.EventStruct');
+
+
+
+/**
+ * Interval index of the scopes in an event list.
+ * This is maintained by the event list as it scopes events.
+ *
+ * @param {!wtf.db.EventList} eventList Event list.
+ * @constructor
+ */
+wtf.db.IntervalIndex = function(eventList) {
+  /**
+   * Event list that is indexed.
+   * @type {!wtf.db.EventList}
+   * @private
+   */
+  this.eventList_ = eventList;
+
+  /**
+   * Scope event IDs in time order, indexed by depth.
+   * Each list has capacity beyond its count as given in {@see #counts_}.
+   * @type {!Array.<!Uint32Array>}
+   * @private
+   */
+  this.scopes_ = [];
+
+  /**
+   * Number of valid scope IDs in each list in {@see #scopes_}.
+   * @type {!Array.<number>}
+   * @private
+   */
+  this.counts_ = [];
+};
+
+
+/**
+ * Initial capacity of each depth list.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.db.IntervalIndex.INITIAL_CAPACITY_ = 256;
+
+
+/**
+ * Removes all scopes from the index.
+ * Allocated storage is retained.
+ */
+wtf.db.IntervalIndex.prototype.reset = function() {
+  for (var n = 0; n < this.counts_.length; n++) {
+    this.counts_[n] = 0;
+  }
+};
+
+
+/**
+ * Adds a scope to the index.
+ * Scopes must be added in time order.
+ * @param {number} depth Scope depth.
+ * @param {number} eventId Scope enter event ID.
+ */
+wtf.db.IntervalIndex.prototype.addScope = function(depth, eventId) {
+  while (this.scopes_.length <= depth) {
+    this.scopes_.push(
+        new Uint32Array(wtf.db.IntervalIndex.INITIAL_CAPACITY_));
+    this.counts_.push(0);
+  }
+  var list = this.scopes_[depth];
+  var count = this.counts_[depth];
+  if (count == list.length) {
+    var newList = new Uint32Array(list.length * 2);
+    newList.set(list);
+    this.scopes_[depth] = list = newList;
+  }
+  list[count] = eventId;
+  this.counts_[depth] = count + 1;
+};
+
+
+/**
+ * Rebuilds the index from already scoped event data.
+ * This is used when scoping was performed elsewhere, such as on imported data.
+ */
+wtf.db.IntervalIndex.prototype.rebuild = function() {
+  this.reset();
+
+  var eventList = this.eventList_;
+  var eventTypeTable = eventList.eventTypeTable;
+  var eventData = eventList.eventData;
+
+  // Cache of type ID -> whether the type is a scope.
+  var isScopeType = [];
+  for (var n = 0, o = 0; n < eventList.count;
+      n++, o += wtf.db.EventStruct.STRUCT_SIZE) {
+    var typeId = eventData[o + wtf.db.EventStruct.TYPE] & 0xFFFF;
+    var isScope = isScopeType[typeId];
+    if (isScope === undefined) {
+      var type = eventTypeTable.getById(typeId);
+      isScope = isScopeType[typeId] =
+          !!type && type.eventClass == wtf.data.EventClass.SCOPE;
+    }
+    if (isScope) {
+      this.addScope(eventData[o + wtf.db.EventStruct.DEPTH] & 0xFFFF, n);
+    }
+  }
+};
+
+
+/**
+ * Gets the number of scopes indexed at the given depth.
+ * @param {number} depth Scope depth.
+ * @return {number} Scope count.
+ */
+wtf.db.IntervalIndex.prototype.getScopeCount = function(depth) {
+  return depth < this.counts_.length ? this.counts_[depth] : 0;
+};
+
+
+/**
+ * Finds the position of the last scope at the given depth that starts at or
+ * before the given time.
+ * @param {number} depth Scope depth.
+ * @param {number} time Time, in raw event data units.
+ * @return {number} Position in the depth list or -1 if none.
+ * @private
+ */
+wtf.db.IntervalIndex.prototype.findScope_ = function(depth, time) {
+  var list = this.scopes_[depth];
+  var eventData = this.eventList_.eventData;
+  var low = 0;
+  var high = this.counts_[depth];
+  while (low < high) {
+    var mid = (low + high) >>> 1;
+    var o = list[mid] * wtf.db.EventStruct.STRUCT_SIZE;
+    if (eventData[o + wtf.db.EventStruct.TIME] <= time) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low - 1;
+};
+
+
+/**
+ * Gets the ID of the scope at the given depth including the given time.
+ * Scopes that have not yet ended are treated as including all later times.
+ * @param {number} depth Scope depth.
+ * @param {number} time Time, in raw event data units.
+ * @return {number} Event ID or -1 if none.
+ * @private
+ */
+wtf.db.IntervalIndex.prototype.getScopeIdAtDepth_ = function(depth, time) {
+  if (depth >= this.counts_.length) {
+    return -1;
+  }
+  var i = this.findScope_(depth, time);
+  if (i < 0) {
+    return -1;
+  }
+  var id = this.scopes_[depth][i];
+  var endTime = this.eventList_.eventData[
+      id * wtf.db.EventStruct.STRUCT_SIZE + wtf.db.EventStruct.END_TIME];
+  return (!endTime || endTime >= time) ? id : -1;
+};
+
+
+/**
+ * Gets the ID of the scope including the given time.
+ * @param {number} time Time.
+ * @param {number=} opt_depth Depth of the scope to look for. If omitted the
+ *     deepest scope including the time is returned.
+ * @return {number} Event ID or -1 if no scope includes the time.
+ */
+wtf.db.IntervalIndex.prototype.getScopeIdAtTime = function(time, opt_depth) {
+  time *= 1000;
+  if (goog.isDef(opt_depth)) {
+    return this.getScopeIdAtDepth_(opt_depth, time);
+  }
+
+  // Scopes nest, so stop at the first depth without a match.
+  var result = -1;
+  for (var depth = 0; depth < this.counts_.length; depth++) {
+    var id = this.getScopeIdAtDepth_(depth, time);
+    if (id == -1) {
+      break;
+    }
+    result = id;
+  }
+  return result;
+};
+
+
+/**
+ * Gets an iterator on the scope including the given time.
+ * @param {number} time Time.
+ * @param {number=} opt_depth Depth of the scope to look for. If omitted the
+ *     deepest scope including the time is returned.
+ * @return {wtf.db.EventIterator} Iterator on the scope, if any.
+ */
+wtf.db.IntervalIndex.prototype.getScopeAtTime = function(time, opt_depth) {
+  var id = this.getScopeIdAtTime(time, opt_depth);
+  return id >= 0 ? this.eventList_.getEvent(id) : null;
+};
+
+
+/**
+ * Gets the IDs of all scopes that overlap the given time range.
+ * @param {number} startTime Start time.
+ * @param {number} endTime End time.
+ * @return {!Array.<number>} Event IDs, in event order.
+ */
+wtf.db.IntervalIndex.prototype.getScopeIdsIntersecting = function(
+    startTime, endTime) {
+  startTime *= 1000;
+  endTime *= 1000;
+  var eventData = this.eventList_.eventData;
+  var result = [];
+  for (var depth = 0; depth < this.counts_.length; depth++) {
+    var list = this.scopes_[depth];
+    var count = this.counts_[depth];
+
+    // Start at the scope before the range if it extends into it.
+    var i = this.findScope_(depth, startTime);
+    if (i < 0) {
+      i = 0;
+    } else {
+      var endValue = eventData[
+          list[i] * wtf.db.EventStruct.STRUCT_SIZE +
+          wtf.db.EventStruct.END_TIME];
+      if (endValue && endValue < startTime) {
+        i++;
+      }
+    }
+
+    var found = false;
+    for (; i < count; i++) {
+      var id = list[i];
+      if (eventData[id * wtf.db.EventStruct.STRUCT_SIZE +
+          wtf.db.EventStruct.TIME] > endTime) {
+        break;
+      }
+      result.push(id);
+      found = true;
+    }
+
+    // Scopes nest, so if nothing matched at this depth nothing will deeper.
+    if (!found) {
+      break;
+    }
+  }
+
+  result.sort(function(a, b) {
+    return a - b;
+  });
+  return result;
+};
+
+
+/**
+ * Begins iterating all scopes that overlap the given time range.
+ * @param {number} startTime Start time.
+ * @param {number} endTime End time.
+ * @return {!wtf.db.EventIterator} Iterator over the scopes, in event order.
+ */
+wtf.db.IntervalIndex.prototype.beginIntersecting = function(
+    startTime, endTime) {
+  var ids = this.getScopeIdsIntersecting(startTime, endTime);
+  return new wtf.db.EventIterator(
+      this.eventList_, 0, ids.length - 1, 0, ids);
+};
+
+
+goog.exportProperty(
+    wtf.db.IntervalIndex.prototype, 'getScopeCount',
+    wtf.db.IntervalIndex.prototype.getScopeCount);
+goog.exportProperty(
+    wtf.db.IntervalIndex.prototype, 'getScopeIdAtTime',
+    wtf.db.IntervalIndex.prototype.getScopeIdAtTime);
+goog.exportProperty(
+    wtf.db.IntervalIndex.prototype, 'getScopeAtTime',
+    wtf.db.IntervalIndex.prototype.getScopeAtTime);
+goog.exportProperty(
+    wtf.db.IntervalIndex.prototype, 'getScopeIdsIntersecting',
+    wtf.db.IntervalIndex.prototype.getScopeIdsIntersecting);
+goog.exportProperty(
+    wtf.db.IntervalIndex.prototype, 'beginIntersecting',
+    wtf.db.IntervalIndex.prototype.beginIntersecting);
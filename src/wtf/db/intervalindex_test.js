@@ -0,0 +1,88 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+goog.provide('wtf.db.IntervalIndex_test');
+
+goog.require('wtf.db.EventList');
+goog.require('wtf.db.EventTypeTable');
+goog.require('wtf.db.IntervalIndex');
+goog.require('wtf.testing');
+
+
+/**
+ * wtf.db.IntervalIndex testing.
+ */
+wtf.db.IntervalIndex_test = suite('wtf.db.IntervalIndex', function() {
+  test('#ctor', function() {
+    var eventList = new wtf.db.EventList(new wtf.db.EventTypeTable());
+    var index = eventList.getIntervalIndex();
+    assert.equal(index.getScopeCount(0), 0);
+    assert.equal(index.getScopeIdAtTime(0), -1);
+    assert.isNull(index.getScopeAtTime(0));
+    assert.lengthOf(index.getScopeIdsIntersecting(0, 100), 0);
+  });
+
+  test('queries', function() {
+    var eventList = wtf.testing.createEventList({
+      instanceEventTypes: [
+        'wtf.scope#leave()',
+        'someInstanceEvent()'
+      ],
+      scopeEventTypes: [
+        'outer()',
+        'inner()'
+      ],
+      events: [
+        [0, 'outer'],             // 0
+        [10, 'inner'],            // 1
+        [20, 'someInstanceEvent'],
+        [30, 'wtf.scope#leave'],
+        [40, 'inner'],            // 4
+        [50, 'wtf.scope#leave'],
+        [100, 'wtf.scope#leave'],
+        [200, 'outer'],           // 7
+        [300, 'wtf.scope#leave'],
+        [400, 'someInstanceEvent']
+      ]
+    });
+    var index = eventList.getIntervalIndex();
+    assert.equal(index.getScopeCount(0), 2);
+    assert.equal(index.getScopeCount(1), 2);
+    assert.equal(index.getScopeCount(2), 0);
+
+    // Deepest scope at a time.
+    assert.equal(index.getScopeIdAtTime(5), 0);
+    assert.equal(index.getScopeIdAtTime(15), 1);
+    assert.equal(index.getScopeIdAtTime(35), 0);
+    assert.equal(index.getScopeIdAtTime(45), 4);
+    assert.equal(index.getScopeIdAtTime(150), -1);
+    assert.equal(index.getScopeIdAtTime(250), 7);
+    assert.equal(index.getScopeIdAtTime(500), -1);
+
+    // Scope at a specific depth.
+    assert.equal(index.getScopeIdAtTime(15, 0), 0);
+    assert.equal(index.getScopeIdAtTime(35, 1), -1);
+    assert.equal(index.getScopeIdAtTime(250, 1), -1);
+    assert.equal(index.getScopeAtTime(45, 1).getName(), 'inner');
+
+    // Overlapping scopes.
+    assert.deepEqual(index.getScopeIdsIntersecting(0, 500), [0, 1, 4, 7]);
+    assert.deepEqual(index.getScopeIdsIntersecting(25, 35), [0, 1]);
+    assert.deepEqual(index.getScopeIdsIntersecting(60, 90), [0]);
+    assert.deepEqual(index.getScopeIdsIntersecting(120, 150), []);
+    assert.deepEqual(index.getScopeIdsIntersecting(90, 250), [0, 7]);
+    var it = index.beginIntersecting(25, 45);
+    assert.equal(it.getCount(), 3);
+    assert.equal(it.getId(), 0);
+    it.next();
+    assert.equal(it.getId(), 1);
+
+    // Root scope lookups use the index.
+    assert.equal(eventList.getIndexOfRootScopeIncludingTime(45), 0);
+    assert.equal(eventList.getIndexOfRootScopeIncludingTime(150), 6);
+  });
+});
@@ -47,6 +47,14 @@ wtf.db.MarkList = function(eventList) {
    */
   this.markList_ = [];
 
+  /**
+   * Index of the first mark that needs its end time fixed up at the end of
+   * the current rebuild.
+   * @type {number}
+   * @private
+   */
+  this.rebuildStart_ = 0;
+
   this.eventList_.registerAncillaryList(this);
 };
 goog.inherits(wtf.db.MarkList, wtf.events.EventEmitter);
@@ -149,6 +157,19 @@ wtf.db.MarkList.prototype.forEachIntersecting = function(
  */
 wtf.db.MarkList.prototype.beginRebuild = function(eventTypeTable) {
   this.markList_.length = 0;
+  this.rebuildStart_ = 0;
+  return [
+    eventTypeTable.getByName('wtf.trace#mark')
+  ];
+};
+
+
+/**
+ * @override
+ */
+wtf.db.MarkList.prototype.beginAppend = function(eventTypeTable) {
+  // The last existing mark will have its end time fixed up.
+  this.rebuildStart_ = Math.max(0, this.markList_.length - 1);
   return [
     eventTypeTable.getByName('wtf.trace#mark')
   ];
@@ -176,7 +197,7 @@ wtf.db.MarkList.prototype.handleEvent = function(
  */
 wtf.db.MarkList.prototype.endRebuild = function() {
   // Fixup end times.
-  for (var n = 1; n < this.markList_.length; n++) {
+  for (var n = this.rebuildStart_ + 1; n < this.markList_.length; n++) {
     var previous = this.markList_[n - 1];
     var mark = this.markList_[n];
     previous.setEndTime(mark.getTime());
@@ -0,0 +1,605 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/**
+ * @fileoverview Incrementally evaluated query results.
+ *
+ * @author benvanik@google.com (Ben Vanik)
+ */
+
+goog.provide('wtf.db.QueryCursor');
+
+goog.require('goog.array');
+goog.require('goog.asserts');
+goog.require('goog.events');
+goog.require('wtf');
+goog.require('wtf.db.EventIterator');
+goog.require('wtf.db.IAncillaryList');
+goog.require('wtf.db.QueryResult');
+goog.require('wtf.events.EventEmitter');
+goog.require('wtf.timing');
+
+
+
+/**
+ * Query results that are evaluated incrementally and read a page at a time.
+ *
+ * Evaluation runs in short time slices so that broad queries over large
+ * traces do not block the UI, and the match count is reported as it grows.
+ * Only the event ID of the first match of each page is kept. Rows are
+ * resolved by rescanning their page when they are requested, and a few
+ * recently used pages are cached.
+ *
+ * Evaluation covers the events in the list when the cursor is created and any
+ * appended after. If the list is rebuilt (such as when events are inserted out
+ * of order) event IDs change, so the results are dropped and evaluation starts
+ * over. Event types defined after the cursor is created are matched as well.
+ *
+ * @param {string} expr Expression string.
+ * @param {!wtf.db.Filter} filter Filter parsed from the expression.
+ * @param {!wtf.db.EventList} eventList Event list being queried.
+ * @constructor
+ * @extends {wtf.events.EventEmitter}
+ * @implements {wtf.db.IAncillaryList}
+ */
+wtf.db.QueryCursor = function(expr, filter, eventList) {
+  goog.base(this);
+
+  /**
+   * Original expression string.
+   * @type {string}
+   * @private
+   */
+  this.expr_ = expr;
+
+  /**
+   * Compiled expression.
+   * @type {!wtf.db.CompiledQueryExpression}
+   * @private
+   */
+  this.compiledExpr_ = filter.getDebugString();
+
+  /**
+   * Filter the scanner is created from.
+   * @type {!wtf.db.Filter}
+   * @private
+   */
+  this.filter_ = filter;
+
+  /**
+   * Event list being queried.
+   * @type {!wtf.db.EventList}
+   * @private
+   */
+  this.eventList_ = eventList;
+
+  /**
+   * Filter scan function.
+   * @type {wtf.db.Filter.ScanFunction}
+   * @private
+   */
+  this.scanner_ = filter.createScanner(eventList);
+
+  /**
+   * Number of event types defined when the scanner was created. The scanner
+   * only matches types defined before it.
+   * @type {number}
+   * @private
+   */
+  this.scannerTypeCount_ = eventList.eventTypeTable.getAll().length;
+
+  /**
+   * Index of the event after the last one evaluated.
+   * @type {number}
+   * @private
+   */
+  this.endIndex_ = eventList.count;
+
+  /**
+   * Index of the next event to evaluate.
+   * @type {number}
+   * @private
+   */
+  this.scanIndex_ = 0;
+
+  /**
+   * Number of matches found so far.
+   * @type {number}
+   * @private
+   */
+  this.count_ = 0;
+
+  /**
+   * Event ID of the first match in each page.
+   * @type {!Array.<number>}
+   * @private
+   */
+  this.pageStarts_ = [];
+
+  /**
+   * Cached pages of matching event IDs, keyed by page index.
+   * @type {!Object.<number, !Array.<number>>}
+   * @private
+   */
+  this.pages_ = {};
+
+  /**
+   * Indices of the cached pages, least recently used first.
+   * @type {!Array.<number>}
+   * @private
+   */
+  this.pageOrder_ = [];
+
+  /**
+   * Time spent evaluating, in ms.
+   * @type {number}
+   * @private
+   */
+  this.duration_ = 0;
+
+  /**
+   * Whether a time slice has been scheduled.
+   * @type {boolean}
+   * @private
+   */
+  this.slicePending_ = false;
+
+  /**
+   * Whether evaluation has been started and not cancelled.
+   * @type {boolean}
+   * @private
+   */
+  this.running_ = false;
+
+  /**
+   * Whether {@see wtf.db.QueryCursor.EventType#COMPLETE} has been emitted for
+   * the current results.
+   * @type {boolean}
+   * @private
+   */
+  this.completeEmitted_ = false;
+
+  /**
+   * Iterator returned from {@see #getEvent}.
+   * @type {!wtf.db.EventIterator}
+   * @private
+   */
+  this.iterator_ = eventList.begin();
+
+  this.eventList_.registerAncillaryList(this);
+};
+goog.inherits(wtf.db.QueryCursor, wtf.events.EventEmitter);
+
+
+/**
+ * Event types for the cursor.
+ * @enum {string}
+ */
+wtf.db.QueryCursor.EventType = {
+  /**
+   * More events have been evaluated or the results were reset, and the count
+   * may have changed.
+   */
+  PROGRESS: goog.events.getUniqueId('progress'),
+
+  /**
+   * All events have been evaluated.
+   */
+  COMPLETE: goog.events.getUniqueId('complete')
+};
+
+
+/**
+ * Number of matches in each page.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.db.QueryCursor.PAGE_SIZE_ = 1024;
+
+
+/**
+ * Maximum number of pages kept in the cache.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.db.QueryCursor.MAX_CACHED_PAGES_ = 8;
+
+
+/**
+ * Number of events evaluated between checks of the time slice budget.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.db.QueryCursor.BLOCK_SIZE_ = 16 * 1024;
+
+
+/**
+ * Time budget of each time slice, in ms.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.db.QueryCursor.SLICE_DURATION_ = 10;
+
+
+/**
+ * @override
+ */
+wtf.db.QueryCursor.prototype.disposeInternal = function() {
+  this.cancel();
+  this.eventList_.unregisterAncillaryList(this);
+  goog.base(this, 'disposeInternal');
+};
+
+
+/**
+ * Gets the original expression used to create the query.
+ * @return {string} Expression string.
+ */
+wtf.db.QueryCursor.prototype.getExpression = function() {
+  return this.expr_;
+};
+
+
+/**
+ * Gets the parsed expression object.
+ * @return {!wtf.db.CompiledQueryExpression} Expression object.
+ */
+wtf.db.QueryCursor.prototype.getCompiledExpression = function() {
+  return this.compiledExpr_;
+};
+
+
+/**
+ * Gets the time spent evaluating the query so far, in milliseconds.
+ * @return {number} Duration, in ms.
+ */
+wtf.db.QueryCursor.prototype.getDuration = function() {
+  return this.duration_;
+};
+
+
+/**
+ * Gets the number of matches found so far.
+ * @return {number} Match count.
+ */
+wtf.db.QueryCursor.prototype.getCount = function() {
+  return this.count_;
+};
+
+
+/**
+ * Gets the fraction of events that have been evaluated.
+ * @return {number} Progress, from 0 to 1.
+ */
+wtf.db.QueryCursor.prototype.getProgress = function() {
+  return this.endIndex_ ? this.scanIndex_ / this.endIndex_ : 1;
+};
+
+
+/**
+ * Whether all events have been evaluated.
+ * @return {boolean} True if the count is final.
+ */
+wtf.db.QueryCursor.prototype.isComplete = function() {
+  return this.scanIndex_ >= this.endIndex_;
+};
+
+
+/**
+ * Starts evaluating the query in time slices.
+ * Progress events are emitted after each slice, and at least once even if
+ * there are no events to evaluate.
+ */
+wtf.db.QueryCursor.prototype.start = function() {
+  this.running_ = true;
+  this.scheduleSlice_();
+};
+
+
+/**
+ * Stops evaluating the query.
+ * Results found so far remain available and evaluation can be resumed with
+ * {@see #start} or {@see #runToCompletion}.
+ */
+wtf.db.QueryCursor.prototype.cancel = function() {
+  this.running_ = false;
+};
+
+
+/**
+ * Evaluates the rest of the query immediately.
+ */
+wtf.db.QueryCursor.prototype.runToCompletion = function() {
+  if (this.completeEmitted_) {
+    return;
+  }
+  var startTime = wtf.now();
+  while (!this.isComplete()) {
+    this.scanBlock_();
+  }
+  this.duration_ += wtf.now() - startTime;
+  this.emitProgress_();
+};
+
+
+/**
+ * Schedules the next time slice, if needed.
+ * @private
+ */
+wtf.db.QueryCursor.prototype.scheduleSlice_ = function() {
+  if (this.slicePending_ || this.completeEmitted_) {
+    return;
+  }
+  this.slicePending_ = true;
+  wtf.timing.setImmediate(this.runSlice_, this);
+};
+
+
+/**
+ * Evaluates events until the time slice budget runs out.
+ * @private
+ */
+wtf.db.QueryCursor.prototype.runSlice_ = function() {
+  this.slicePending_ = false;
+  if (!this.running_ || this.isDisposed() || this.completeEmitted_) {
+    return;
+  }
+
+  var startTime = wtf.now();
+  while (!this.isComplete() &&
+      wtf.now() - startTime < wtf.db.QueryCursor.SLICE_DURATION_) {
+    this.scanBlock_();
+  }
+  this.duration_ += wtf.now() - startTime;
+
+  this.emitProgress_();
+  this.scheduleSlice_();
+};
+
+
+/**
+ * Emits a progress event, followed by a complete event the first time all
+ * events have been evaluated.
+ * @private
+ */
+wtf.db.QueryCursor.prototype.emitProgress_ = function() {
+  this.emitEvent(wtf.db.QueryCursor.EventType.PROGRESS);
+  if (this.isComplete() && !this.completeEmitted_) {
+    this.completeEmitted_ = true;
+    this.emitEvent(wtf.db.QueryCursor.EventType.COMPLETE);
+  }
+};
+
+
+/**
+ * Evaluates the next block of events.
+ * @private
+ */
+wtf.db.QueryCursor.prototype.scanBlock_ = function() {
+  var pageSize = wtf.db.QueryCursor.PAGE_SIZE_;
+  var start = this.scanIndex_;
+  var end = Math.min(
+      start + wtf.db.QueryCursor.BLOCK_SIZE_, this.endIndex_);
+  var matches = [];
+  this.scanner_(start, end, matches);
+  this.scanIndex_ = end;
+
+  // Only the page starts are kept.
+  var count = this.count_;
+  var n = (pageSize - count % pageSize) % pageSize;
+  for (; n < matches.length; n += pageSize) {
+    this.pageStarts_.push(matches[n]);
+  }
+  this.count_ = count + matches.length;
+};
+
+
+/**
+ * Gets a page of matching event IDs, scanning for it if it is not cached.
+ * @param {number} pageIndex Page index.
+ * @return {!Array.<number>} Event IDs in the page.
+ * @private
+ */
+wtf.db.QueryCursor.prototype.getPage_ = function(pageIndex) {
+  var page = this.pages_[pageIndex];
+  if (page) {
+    // Move to the end of the LRU list.
+    var orderIndex = this.pageOrder_.indexOf(pageIndex);
+    this.pageOrder_.splice(orderIndex, 1);
+    this.pageOrder_.push(pageIndex);
+    return page;
+  }
+
+  goog.asserts.assert(pageIndex < this.pageStarts_.length);
+  var start = this.pageStarts_[pageIndex];
+  var end = pageIndex + 1 < this.pageStarts_.length ?
+      this.pageStarts_[pageIndex + 1] : this.scanIndex_;
+  page = [];
+  this.scanner_(start, end, page);
+
+  // The last page may still grow, so only cache it once it's final.
+  if (page.length == wtf.db.QueryCursor.PAGE_SIZE_ || this.isComplete()) {
+    this.pages_[pageIndex] = page;
+    this.pageOrder_.push(pageIndex);
+    if (this.pageOrder_.length > wtf.db.QueryCursor.MAX_CACHED_PAGES_) {
+      delete this.pages_[this.pageOrder_.shift()];
+    }
+  }
+  return page;
+};
+
+
+/**
+ * Gets the event ID of a match.
+ * @param {number} row Match index, less than {@see #getCount}.
+ * @return {number} Event ID.
+ */
+wtf.db.QueryCursor.prototype.getEventId = function(row) {
+  goog.asserts.assert(row < this.count_);
+  var pageSize = wtf.db.QueryCursor.PAGE_SIZE_;
+  var page = this.getPage_(Math.floor(row / pageSize));
+  return page[row % pageSize];
+};
+
+
+/**
+ * Gets an iterator positioned at a match.
+ * The same iterator is returned from each call, so it is only valid until
+ * the next call.
+ * @param {number} row Match index, less than {@see #getCount}.
+ * @return {!wtf.db.EventIterator} Iterator.
+ */
+wtf.db.QueryCursor.prototype.getEvent = function(row) {
+  this.iterator_.seek(this.getEventId(row));
+  return this.iterator_;
+};
+
+
+/**
+ * @override
+ */
+wtf.db.QueryCursor.prototype.beginRebuild = function(eventTypeTable) {
+  // Event IDs may have changed, so all results are dropped.
+  this.endIndex_ = this.eventList_.count;
+  this.scanIndex_ = 0;
+  this.count_ = 0;
+  this.pageStarts_.length = 0;
+  this.pages_ = {};
+  this.pageOrder_.length = 0;
+  this.duration_ = 0;
+  this.updateScanner_(true);
+  this.resume_();
+  return [];
+};
+
+
+/**
+ * @override
+ */
+wtf.db.QueryCursor.prototype.beginAppend = function(eventTypeTable) {
+  // The last page may grow, so it can't stay cached.
+  var lastPageIndex = this.pageStarts_.length - 1;
+  if (this.pages_[lastPageIndex]) {
+    delete this.pages_[lastPageIndex];
+    goog.array.remove(this.pageOrder_, lastPageIndex);
+  }
+  this.endIndex_ = this.eventList_.count;
+  this.updateScanner_(false);
+  this.resume_();
+  return [];
+};
+
+
+/**
+ * @override
+ */
+wtf.db.QueryCursor.prototype.handleEvent = goog.nullFunction;
+
+
+/**
+ * @override
+ */
+wtf.db.QueryCursor.prototype.endRebuild = goog.nullFunction;
+
+
+/**
+ * Recreates the scanner so that it matches newly defined event types.
+ * Events of new types can only have been appended since the scanner was
+ * created, so results that were already found stay valid.
+ * @param {boolean} force Whether to recreate the scanner even if no types
+ *     have been defined.
+ * @private
+ */
+wtf.db.QueryCursor.prototype.updateScanner_ = function(force) {
+  var typeCount = this.eventList_.eventTypeTable.getAll().length;
+  if (force || typeCount != this.scannerTypeCount_) {
+    this.scanner_ = this.filter_.createScanner(this.eventList_);
+    this.scannerTypeCount_ = typeCount;
+  }
+};
+
+
+/**
+ * Resumes evaluation after the event list has changed.
+ * @private
+ */
+wtf.db.QueryCursor.prototype.resume_ = function() {
+  // The list may have grown past the bounds of the iterator.
+  this.iterator_ = this.eventList_.begin();
+  this.completeEmitted_ = false;
+  this.emitEvent(wtf.db.QueryCursor.EventType.PROGRESS);
+  if (this.running_) {
+    this.scheduleSlice_();
+  }
+};
+
+
+/**
+ * Dumps the results into a blob.
+ * All events are evaluated first, if needed.
+ * @param {wtf.db.QueryDumpFormat} format Target format.
+ * @return {string?} Results.
+ */
+wtf.db.QueryCursor.prototype.dump = function(format) {
+  this.runToCompletion();
+
+  // Exports include every match, so gather them all up.
+  var matches = [];
+  this.scanner_(0, this.endIndex_, matches);
+  var it = new wtf.db.EventIterator(
+      this.eventList_, 0, matches.length - 1, 0, matches);
+  var result = new wtf.db.QueryResult(
+      this.expr_, this.compiledExpr_, this.duration_, it);
+  var dump = result.dump(format);
+  goog.dispose(result);
+  return dump;
+};
+
+
+goog.exportSymbol(
+    'wtf.db.QueryCursor',
+    wtf.db.QueryCursor);
+goog.exportProperty(
+    wtf.db.QueryCursor.prototype, 'getExpression',
+    wtf.db.QueryCursor.prototype.getExpression);
+goog.exportProperty(
+    wtf.db.QueryCursor.prototype, 'getCompiledExpression',
+    wtf.db.QueryCursor.prototype.getCompiledExpression);
+goog.exportProperty(
+    wtf.db.QueryCursor.prototype, 'getDuration',
+    wtf.db.QueryCursor.prototype.getDuration);
+goog.exportProperty(
+    wtf.db.QueryCursor.prototype, 'getCount',
+    wtf.db.QueryCursor.prototype.getCount);
+goog.exportProperty(
+    wtf.db.QueryCursor.prototype, 'getProgress',
+    wtf.db.QueryCursor.prototype.getProgress);
+goog.exportProperty(
+    wtf.db.QueryCursor.prototype, 'isComplete',
+    wtf.db.QueryCursor.prototype.isComplete);
+goog.exportProperty(
+    wtf.db.QueryCursor.prototype, 'start',
+    wtf.db.QueryCursor.prototype.start);
+goog.exportProperty(
+    wtf.db.QueryCursor.prototype, 'cancel',
+    wtf.db.QueryCursor.prototype.cancel);
+goog.exportProperty(
+    wtf.db.QueryCursor.prototype, 'runToCompletion',
+    wtf.db.QueryCursor.prototype.runToCompletion);
+goog.exportProperty(
+    wtf.db.QueryCursor.prototype, 'getEventId',
+    wtf.db.QueryCursor.prototype.getEventId);
+goog.exportProperty(
+    wtf.db.QueryCursor.prototype, 'getEvent',
+    wtf.db.QueryCursor.prototype.getEvent);
+goog.exportProperty(
+    wtf.db.QueryCursor.prototype, 'dump',
+    wtf.db.QueryCursor.prototype.dump);
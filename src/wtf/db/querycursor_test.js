@@ -0,0 +1,138 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+goog.provide('wtf.db.QueryCursor_test');
+
+goog.require('wtf.db.EventType');
+goog.require('wtf.db.Filter');
+goog.require('wtf.db.QueryCursor');
+goog.require('wtf.testing');
+
+
+/**
+ * wtf.db.QueryCursor testing.
+ */
+wtf.db.QueryCursor_test = suite('wtf.db.QueryCursor', function() {
+  /**
+   * Creates an event list with interleaved events of two types.
+   * @param {number} count Number of a#x events.
+   * @return {!wtf.db.EventList} Event list.
+   */
+  function createEventList(count) {
+    var events = [];
+    var time = 1;
+    for (var n = 0; n < count; n++) {
+      events.push([time++, 'a#x', n]);
+      if (n % 3 == 0) {
+        events.push([time++, 'b#y', n]);
+      }
+    }
+    return wtf.testing.createEventList({
+      instanceEventTypes: [
+        'a#x(uint32 value)',
+        'b#y(uint32 value)'
+      ],
+      events: events
+    });
+  };
+
+  /**
+   * Creates a cursor for the given expression.
+   * @param {!wtf.db.EventList} eventList Event list.
+   * @param {string} expr Query expression.
+   * @return {!wtf.db.QueryCursor} Cursor.
+   */
+  function createCursor(eventList, expr) {
+    return new wtf.db.QueryCursor(expr, new wtf.db.Filter(expr), eventList);
+  };
+
+  test('#runToCompletion', function() {
+    var eventList = createEventList(5000);
+    var cursor = createCursor(eventList, 'a#x');
+    var progressCount = 0;
+    cursor.addListener(wtf.db.QueryCursor.EventType.PROGRESS, function() {
+      progressCount++;
+    });
+    assert.isFalse(cursor.isComplete());
+    assert.equal(cursor.getCount(), 0);
+
+    cursor.runToCompletion();
+    assert.isTrue(cursor.isComplete());
+    assert.equal(cursor.getProgress(), 1);
+    assert.equal(cursor.getCount(), 5000);
+    assert.equal(progressCount, 1);
+  });
+
+  test('#getEvent', function() {
+    var eventList = createEventList(5000);
+    var cursor = createCursor(eventList, 'a#x(value > 999)');
+    cursor.runToCompletion();
+    assert.equal(cursor.getCount(), 4000);
+
+    // Rows across several pages, in any order.
+    assert.equal(cursor.getEvent(3999).getArgument('value'), 4999);
+    assert.equal(cursor.getEvent(0).getArgument('value'), 1000);
+    for (var n = 0; n < 4000; n += 97) {
+      assert.equal(cursor.getEvent(n).getArgument('value'), 1000 + n);
+    }
+  });
+
+  test('eventListChanges', function() {
+    // Empty lists still report their results.
+    var eventList = createEventList(0);
+    var cursor = createCursor(eventList, 'a#x');
+    var progressCount = 0;
+    var completeCount = 0;
+    cursor.addListener(wtf.db.QueryCursor.EventType.PROGRESS, function() {
+      progressCount++;
+    });
+    cursor.addListener(wtf.db.QueryCursor.EventType.COMPLETE, function() {
+      completeCount++;
+    });
+    cursor.runToCompletion();
+    assert.equal(progressCount, 1);
+    assert.equal(completeCount, 1);
+    assert.equal(cursor.getCount(), 0);
+
+    // Appended events are evaluated.
+    var eventType = eventList.eventTypeTable.getByName('a#x');
+    eventList.insert(eventType, 10000, {'value': 1});
+    eventList.insert(eventType, 10001, {'value': 2});
+    eventList.rebuild();
+    assert.isFalse(cursor.isComplete());
+    cursor.runToCompletion();
+    assert.equal(completeCount, 2);
+    assert.equal(cursor.getCount(), 2);
+    assert.equal(cursor.getEvent(1).getArgument('value'), 2);
+
+    // Out of order events renumber the list and restart evaluation.
+    eventList.insert(eventType, 5000, {'value': 0});
+    eventList.rebuild();
+    assert.equal(cursor.getCount(), 0);
+    cursor.runToCompletion();
+    assert.equal(cursor.getCount(), 3);
+    assert.equal(cursor.getEvent(0).getArgument('value'), 0);
+
+    // Types defined after the cursor was created are matched.
+    var typeCursor = createCursor(eventList, '/#x/');
+    typeCursor.runToCompletion();
+    assert.equal(typeCursor.getCount(), 3);
+    var newType = eventList.eventTypeTable.defineType(
+        wtf.db.EventType.createInstance('c#x()'));
+    eventList.insert(newType, 15000);
+    eventList.rebuild();
+    typeCursor.runToCompletion();
+    assert.equal(typeCursor.getCount(), 4);
+    goog.dispose(typeCursor);
+
+    // Disposed cursors are no longer updated.
+    goog.dispose(cursor);
+    eventList.insert(eventType, 20000, {'value': 3});
+    eventList.rebuild();
+    assert.equal(cursor.getCount(), 3);
+  });
+});
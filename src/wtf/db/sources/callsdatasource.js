@@ -13,6 +13,7 @@
 
 goog.provide('wtf.db.sources.CallsDataSource');
 
+goog.require('goog.asserts');
 goog.require('wtf.data.EventFlag');
 goog.require('wtf.data.ScriptContextInfo');
 goog.require('wtf.data.formats.BinaryCalls');
@@ -21,7 +22,6 @@ goog.require('wtf.db.DataSource');
 goog.require('wtf.db.EventType');
 goog.require('wtf.db.PresentationHint');
 goog.require('wtf.db.Unit');
-goog.require('wtf.io.Blob');
 goog.require('wtf.io.DataFormat');
 goog.require('wtf.io.ReadTransport');
 goog.require('wtf.util');
@@ -51,8 +51,6 @@ wtf.db.sources.CallsDataSource = function(db, sourceInfo, transport) {
   this.transport_ = transport;
   this.registerDisposable(this.transport_);
 
-  // TODO(benvanik): stash modules/function mappings/etc
-
   /**
    * The currently set zone, if any.
    * @type {!wtf.db.Zone}
@@ -61,16 +59,66 @@ wtf.db.sources.CallsDataSource = function(db, sourceInfo, transport) {
   this.zone_ = db.getDefaultZone();
 
   /**
-   * All received blob parts.
-   * They'll be stitched up at the end.
-   * @type {!Array.<!wtf.io.Blob>}
+   * Bytes received but not yet processed.
+   * This is either a partial header or a partial call entry.
+   * @type {Uint8Array}
+   * @private
+   */
+  this.pendingBytes_ = null;
+
+  /**
+   * Whether the header has been read and the source initialized.
+   * @type {boolean}
+   * @private
+   */
+  this.hasReadHeader_ = false;
+
+  /**
+   * Number of padding bytes following the header that have yet to be skipped.
+   * @type {number}
    * @private
    */
-  this.blobParts_ = [];
+  this.paddingRemaining_ = 0;
 
-  // We gather all the blobs and process at the end, because this format can't
-  // handle incremental loading.
-  this.transport_.setPreferredFormat(wtf.io.DataFormat.BLOB);
+  /**
+   * Event types by function ID, as defined by the header modules.
+   * @type {!Object.<number, !wtf.db.EventType>}
+   * @private
+   */
+  this.eventTypes_ = {};
+
+  /**
+   * Builtin scope leave event type.
+   * Defined when the header is read.
+   * @type {wtf.db.EventType}
+   * @private
+   */
+  this.leaveEventType_ = null;
+
+  /**
+   * Number of 32-bit ints in each call entry.
+   * @type {number}
+   * @private
+   */
+  this.intsPerEntry_ = 1;
+
+  /**
+   * Current time, carried across received data.
+   * @type {number}
+   * @private
+   */
+  this.time_ = 0;
+
+  /**
+   * Previous attribute sample, or -1 if none has been read.
+   * @type {number}
+   * @private
+   */
+  this.prevSample_ = -1;
+
+  // Entries are processed as they arrive, so only the unprocessed tail of the
+  // stream is ever held in memory.
+  this.transport_.setPreferredFormat(wtf.io.DataFormat.ARRAY_BUFFER);
 
   this.transport_.addListener(
       wtf.io.ReadTransport.EventType.RECEIVE_DATA,
@@ -99,11 +147,53 @@ wtf.db.sources.CallsDataSource.prototype.start = function() {
 
 /**
  * Handles stream data received events.
- * @param {!wtf.io.BlobData} data Blob data.
+ * @param {!wtf.io.BlobData} data Array buffer or array buffer view.
  * @private
  */
 wtf.db.sources.CallsDataSource.prototype.dataReceived_ = function(data) {
-  this.blobParts_.push(data);
+  if (this.hasErrored) {
+    return;
+  }
+
+  var bytes;
+  if (data instanceof ArrayBuffer) {
+    bytes = new Uint8Array(data);
+  } else {
+    goog.asserts.assert(data && data.buffer instanceof ArrayBuffer);
+    bytes = new Uint8Array(data.buffer, data.byteOffset, data.byteLength);
+  }
+
+  // Prepend anything left over from the previous data.
+  if (this.pendingBytes_) {
+    var joined = new Uint8Array(this.pendingBytes_.length + bytes.length);
+    joined.set(this.pendingBytes_);
+    joined.set(bytes, this.pendingBytes_.length);
+    bytes = joined;
+    this.pendingBytes_ = null;
+  }
+
+  var o = 0;
+  if (!this.hasReadHeader_) {
+    o = this.processHeader_(bytes);
+    if (this.hasErrored) {
+      return;
+    } else if (!o) {
+      // Header incomplete - wait for more data.
+      this.pendingBytes_ = bytes;
+      return;
+    }
+  }
+
+  // Skip padding between the header and the call data.
+  var padding = Math.min(this.paddingRemaining_, bytes.length - o);
+  this.paddingRemaining_ -= padding;
+  o += padding;
+
+  o = this.processEntries_(bytes, o);
+
+  if (o < bytes.length) {
+    this.pendingBytes_ = bytes.subarray(o);
+  }
 };
 
 
@@ -124,30 +214,18 @@ wtf.db.sources.CallsDataSource.prototype.transportErrored_ = function(e) {
  * @private
  */
 wtf.db.sources.CallsDataSource.prototype.transportEnded_ = function() {
-  // Stitch together all the input parts.
-  var blob = wtf.io.Blob.create(this.blobParts_);
-
-  // Grab an ArrayBuffer that we can work with.
-  blob.readAsArrayBuffer(this.process_, this);
-};
-
-
-/**
- * Processes a single large array buffer.
- * @param {ArrayBuffer} buffer Input array buffer.
- * @private
- */
-wtf.db.sources.CallsDataSource.prototype.process_ = function(buffer) {
-  if (!buffer) {
-    // Failed!
+  if (this.hasErrored) {
+    return;
+  }
+  if (!this.hasReadHeader_) {
     this.error(
-        'Error reading data',
-        'Array buffer could not be allocated.');
+        'File header invalid',
+        'The file ended before the header was fully read.');
     return;
   }
 
-  // Process everything.
-  this.processData_(new Uint8Array(buffer));
+  // Any trailing partial entry is dropped.
+  this.pendingBytes_ = null;
 
   // Done!
   this.end();
@@ -155,20 +233,27 @@ wtf.db.sources.CallsDataSource.prototype.process_ = function(buffer) {
 
 
 /**
- * Processes the full buffer.
- * @param {!Uint8Array} buffer Data buffer.
+ * Processes the header, if it has been fully received.
+ * On success the data source is initialized and all event types are defined.
+ * @param {!Uint8Array} bytes Data from the start of the stream.
+ * @return {number} Offset of the byte following the header, or 0 if the
+ *     header is incomplete or invalid.
  * @private
  */
-wtf.db.sources.CallsDataSource.prototype.processData_ = function(buffer) {
+wtf.db.sources.CallsDataSource.prototype.processHeader_ = function(bytes) {
   var db = this.getDatabase();
   var eventTypeTable = db.getEventTypeTable();
 
-  var i = 0;
-  var headerLength = buffer[i + 0] | (buffer[i + 1] << 8) |
-      (buffer[i + 2] << 16) | (buffer[i + 3] << 24);
+  if (bytes.length < 4) {
+    return 0;
+  }
+  var headerLength = bytes[0] | (bytes[1] << 8) |
+      (bytes[2] << 16) | (bytes[3] << 24);
+  if (bytes.length < 4 + headerLength) {
+    return 0;
+  }
   var headerJson = wtf.util.convertUint8ArrayToAsciiString(
-      new Uint8Array(buffer.buffer, 4, headerLength));
-  i += 4 + headerLength;
+      bytes.subarray(4, 4 + headerLength));
   var header;
   try {
     header = goog.global.JSON.parse(headerJson);
@@ -176,7 +261,7 @@ wtf.db.sources.CallsDataSource.prototype.processData_ = function(buffer) {
     this.error(
         'File header invalid',
         'An error occurred trying to parse the file header.\n' + e);
-    return;
+    return 0;
   }
 
   // Read version information to ensure we support the format.
@@ -185,7 +270,7 @@ wtf.db.sources.CallsDataSource.prototype.processData_ = function(buffer) {
     this.error(
         'File version not supported or too old',
         'Sorry, the parser for this file version is not available :(');
-    return;
+    return 0;
   }
 
   // Read context information.
@@ -193,7 +278,7 @@ wtf.db.sources.CallsDataSource.prototype.processData_ = function(buffer) {
     // Bad context info or unknown context.
     this.error(
         'Invalid context information');
-    return;
+    return 0;
   }
   var contextInfo = new wtf.data.ScriptContextInfo();
   contextInfo.parse(header['context']);
@@ -235,16 +320,15 @@ wtf.db.sources.CallsDataSource.prototype.processData_ = function(buffer) {
     this.error(
         'Unable to initialize data source',
         'File corrupt or invalid.');
-    return;
+    return 0;
   }
 
   // Setup some builtin event types.
-  var leaveEventType = eventTypeTable.defineType(
+  this.leaveEventType_ = eventTypeTable.defineType(
       wtf.db.EventType.createInstance('wtf.scope#leave()',
           wtf.data.EventFlag.BUILTIN | wtf.data.EventFlag.INTERNAL));
 
   // Parse all module data.
-  var eventTypes = {};
   var headerModules = header['modules'];
   for (var moduleId in headerModules) {
     var headerModule = headerModules[moduleId];
@@ -262,29 +346,60 @@ wtf.db.sources.CallsDataSource.prototype.processData_ = function(buffer) {
 
       // TODO(rsturgell): Add any additional non-time attributes to the
       // eventtype (and write them in the loop below).
-      eventTypes[fnId] = eventTypeTable.defineType(
+      this.eventTypes_[fnId] = eventTypeTable.defineType(
           wtf.db.EventType.createScope(fnName));
 
       // TODO(benvanik): stash range/etc
     }
   }
 
-  // Pad i until the next 4b.
-  if (i % 4) {
-    i += 4 - (i % 4);
+  this.intsPerEntry_ = 1 + attributes.length;
+  this.hasReadHeader_ = true;
+
+  // Call data is padded to the next 4b.
+  var o = 4 + headerLength;
+  if (o % 4) {
+    this.paddingRemaining_ = 4 - (o % 4);
   }
+  return o;
+};
+
 
-  var intsPerEntry = 1 + attributes.length;
+/**
+ * Inserts all whole call entries in the given data.
+ * @param {!Uint8Array} bytes Data buffer.
+ * @param {number} o Offset of the first entry in the data.
+ * @return {number} Offset of the first byte that was not processed.
+ * @private
+ */
+wtf.db.sources.CallsDataSource.prototype.processEntries_ = function(
+    bytes, o) {
+  var intsPerEntry = this.intsPerEntry_;
   var bytesPerEntry = 4 * intsPerEntry;
+  var entryCount = Math.floor((bytes.length - o) / bytesPerEntry);
+  if (!entryCount) {
+    return o;
+  }
+  var byteLength = entryCount * bytesPerEntry;
+
+  // Int32Array views must be aligned - copy if the data is not.
+  var callBuffer;
+  if ((bytes.byteOffset + o) % 4) {
+    callBuffer = new Int32Array(byteLength / 4);
+    new Uint8Array(callBuffer.buffer).set(bytes.subarray(o, o + byteLength));
+  } else {
+    callBuffer = new Int32Array(
+        bytes.buffer, bytes.byteOffset + o, byteLength / 4);
+  }
 
-  // Reallocate the event list to prevent resizes during addition.
+  var db = this.getDatabase();
   var eventList = this.zone_.getEventList();
-  eventList.expandCapacity((buffer.length - i) / bytesPerEntry);
-
-  var t = 0;
-  var callBuffer = new Int32Array(buffer.buffer, i);
-  var prevSample = -1;
-  var implicitTime = attributes.length == 0;
+  var eventTypes = this.eventTypes_;
+  var leaveEventType = this.leaveEventType_;
+  goog.asserts.assert(leaveEventType);
+  var t = this.time_;
+  var prevSample = this.prevSample_;
+  var implicitTime = intsPerEntry == 1;
 
   // Insert event data.
   db.beginInsertingEvents(this);
@@ -306,4 +421,8 @@ wtf.db.sources.CallsDataSource.prototype.processData_ = function(buffer) {
     }
   }
   db.endInsertingEvents();
+
+  this.time_ = t;
+  this.prevSample_ = prevSample;
+  return o + byteLength;
 };
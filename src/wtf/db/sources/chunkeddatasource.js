@@ -14,6 +14,7 @@
 goog.provide('wtf.db.sources.ChunkedDataSource');
 
 goog.require('goog.asserts');
+goog.require('goog.string');
 goog.require('wtf.data.EventFlag');
 goog.require('wtf.data.Variable');
 goog.require('wtf.db.DataSource');
@@ -84,6 +85,34 @@ wtf.db.sources.ChunkedDataSource = function(db, sourceInfo, streamSource) {
    */
   this.timeRangeRenames_ = {};
 
+  /**
+   * Whether a load filter has been set with {@see #setLoadFilter}.
+   * @type {boolean}
+   * @private
+   */
+  this.hasLoadFilter_ = false;
+
+  /**
+   * Start of the time window to load events in, in raw event time units.
+   * @type {number}
+   * @private
+   */
+  this.loadStartTime_ = 0;
+
+  /**
+   * End of the time window to load events in, in raw event time units.
+   * @type {number}
+   * @private
+   */
+  this.loadEndTime_ = Number.MAX_VALUE;
+
+  /**
+   * Names of the zones to load events in, or null to load all zones.
+   * @type {Object.<boolean>}
+   * @private
+   */
+  this.loadZoneNames_ = null;
+
   /**
    * A fast dispatch table for BUILTIN events, keyed on event name.
    * Each function handles an event of the given type.
@@ -93,6 +122,24 @@ wtf.db.sources.ChunkedDataSource = function(db, sourceInfo, streamSource) {
   this.binaryDispatch_ = {};
   this.setupBinaryDispatchTable_();
 
+  /**
+   * Embedded resources, indexed by resource ID - 1.
+   * IDs are assigned in the order resources appear in the stream.
+   * @type {!Array.<wtf.io.BlobData>}
+   * @private
+   */
+  this.resources_ = [];
+
+  /**
+   * Resource arguments of each event type, keyed on event name.
+   * Each entry is a list of pairs of the resource argument name and the name
+   * of the argument it provides the value of, or null if the event has no
+   * resource arguments.
+   * @type {!Object.<Array.<!Array.<string>>>}
+   * @private
+   */
+  this.resourceArguments_ = {};
+
   this.streamSource_.addListener(
       wtf.io.cff.StreamSource.EventType.CHUNK_RECEIVED,
       this.chunkReceived_, this);
@@ -106,6 +153,50 @@ wtf.db.sources.ChunkedDataSource = function(db, sourceInfo, streamSource) {
 goog.inherits(wtf.db.sources.ChunkedDataSource, wtf.db.DataSource);
 
 
+/**
+ * Restricts the events that are added to the database.
+ * Events outside of the time window or in other zones are dropped as they are
+ * parsed, so only the data that is needed is kept in memory. Event definitions
+ * and zone changes are always processed.
+ * Scopes that cross the window edges will appear unbalanced, as they do in
+ * snapshots.
+ * This must be called before the source is started.
+ * @param {number} startTime Window start time, in ms.
+ * @param {number} endTime Window end time, in ms.
+ * @param {Array.<string>=} opt_zoneNames Names of zones to load. All zones
+ *     are loaded if omitted.
+ */
+wtf.db.sources.ChunkedDataSource.prototype.setLoadFilter = function(
+    startTime, endTime, opt_zoneNames) {
+  this.hasLoadFilter_ = true;
+  this.loadStartTime_ = startTime * 1000;
+  this.loadEndTime_ = endTime * 1000;
+  this.loadZoneNames_ = null;
+  if (opt_zoneNames) {
+    this.loadZoneNames_ = {};
+    for (var n = 0; n < opt_zoneNames.length; n++) {
+      this.loadZoneNames_[opt_zoneNames[n]] = true;
+    }
+  }
+};
+
+
+/**
+ * Checks whether an event passes the load filter.
+ * @param {number} time Event time, in raw event time units.
+ * @return {boolean} True if the event should be inserted.
+ * @private
+ */
+wtf.db.sources.ChunkedDataSource.prototype.passesLoadFilter_ = function(
+    time) {
+  if (time < this.loadStartTime_ || time > this.loadEndTime_) {
+    return false;
+  }
+  return !this.loadZoneNames_ ||
+      !!this.loadZoneNames_[this.currentZone_.getName()];
+};
+
+
 /**
  * @override
  */
@@ -164,6 +255,14 @@ wtf.db.sources.ChunkedDataSource.prototype.chunkReceived_ = function(chunk) {
     case wtf.io.cff.ChunkType.EVENT_DATA:
       var eventDataChunk =
           /** @type {!wtf.io.cff.chunks.EventDataChunk} */ (chunk);
+
+      // Resources come before the events in the chunk, as they may reference
+      // them.
+      var resourceCount = eventDataChunk.getResourceCount();
+      for (var n = 1; n <= resourceCount; n++) {
+        this.resources_.push(eventDataChunk.getResource(n));
+      }
+
       var part = eventDataChunk.getEventData();
       goog.asserts.assert(part);
       switch (part.getType()) {
@@ -294,8 +393,6 @@ wtf.db.sources.ChunkedDataSource.prototype.setupBinaryDispatchTable_ =
  */
 wtf.db.sources.ChunkedDataSource.prototype.processBinaryEventBuffer_ =
     function(part) {
-  // TODO(benvanik): get resources.
-
   // Grab the event data buffer.
   var bufferView = part.getValue();
   goog.asserts.assert(bufferView);
@@ -328,6 +425,7 @@ wtf.db.sources.ChunkedDataSource.prototype.processBinaryEventBuffer_ =
       wtf.io.BufferView.setOffset(bufferView, offset << 2);
       args = eventType.parseBinaryArguments(bufferView);
       offset = wtf.io.BufferView.getOffset(bufferView) >> 2;
+      this.resolveResources_(eventType, args);
     }
 
     // Handle built-in events.
@@ -340,11 +438,56 @@ wtf.db.sources.ChunkedDataSource.prototype.processBinaryEventBuffer_ =
     }
 
     if (insertEvent) {
-      var eventList = this.currentZone_.getEventList();
-      eventList.insert(
-          eventType,
-          Math.max(0, time + this.getTimeDelay()),
-          args);
+      var eventTime = Math.max(0, time + this.getTimeDelay());
+      if (!this.hasLoadFilter_ || this.passesLoadFilter_(eventTime)) {
+        var eventList = this.currentZone_.getEventList();
+        eventList.insert(eventType, eventTime, args);
+      }
+    }
+  }
+};
+
+
+/**
+ * Substitutes resource data into event arguments.
+ * An argument named {@code fooResource} is the ID of a resource holding the
+ * value of argument {@code foo}, or 0 if the value was recorded inline. Events
+ * that share a resource share the same value, which must not be modified.
+ * @param {!wtf.db.EventType} eventType Event type.
+ * @param {!wtf.db.ArgumentData} args Event arguments.
+ * @private
+ */
+wtf.db.sources.ChunkedDataSource.prototype.resolveResources_ = function(
+    eventType, args) {
+  var resourceArgs = this.resourceArguments_[eventType.name];
+  if (resourceArgs === undefined) {
+    resourceArgs = null;
+    var typeArgs = eventType.getArguments();
+    for (var n = 0; n < typeArgs.length; n++) {
+      var name = typeArgs[n].name;
+      if (name.length > 8 && goog.string.endsWith(name, 'Resource')) {
+        resourceArgs = resourceArgs || [];
+        resourceArgs.push([name, name.substr(0, name.length - 8)]);
+      }
+    }
+    this.resourceArguments_[eventType.name] = resourceArgs;
+  }
+  if (!resourceArgs) {
+    return;
+  }
+
+  for (var n = 0; n < resourceArgs.length; n++) {
+    var resourceId = args[resourceArgs[n][0]];
+    if (resourceId) {
+      var value = this.resources_[resourceId - 1];
+      if (value === undefined) {
+        this.error(
+            'Undefined resource',
+            'The file tried to reference a resource it didn\'t contain. ' +
+            'Perhaps it\'s corrupted?');
+        return;
+      }
+      args[resourceArgs[n][1]] = value;
     }
   }
 };
@@ -404,11 +547,11 @@ wtf.db.sources.ChunkedDataSource.prototype.processLegacyEventBuffer_ =
     }
 
     if (insertEvent) {
-      var eventList = this.currentZone_.getEventList();
-      eventList.insert(
-          eventType,
-          Math.max(0, time + this.getTimeDelay()),
-          args);
+      var eventTime = Math.max(0, time + this.getTimeDelay());
+      if (!this.hasLoadFilter_ || this.passesLoadFilter_(eventTime)) {
+        var eventList = this.currentZone_.getEventList();
+        eventList.insert(eventType, eventTime, args);
+      }
     }
   }
 };
@@ -0,0 +1,514 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/**
+ * @fileoverview Data source that loads traces on a web worker.
+ *
+ * @author benvanik@google.com (Ben Vanik)
+ */
+
+goog.provide('wtf.db.sources.WorkerDataSource');
+
+goog.require('goog.asserts');
+goog.require('goog.dom');
+goog.require('goog.dom.TagName');
+goog.require('goog.fs');
+goog.require('goog.string');
+goog.require('wtf.data.ContextInfo');
+goog.require('wtf.data.Variable');
+goog.require('wtf.db.BlobDataSourceInfo');
+goog.require('wtf.db.DataSource');
+goog.require('wtf.db.Database');
+goog.require('wtf.db.EventStruct');
+goog.require('wtf.db.EventType');
+goog.require('wtf.db.TimeRange');
+goog.require('wtf.db.UrlDataSourceInfo');
+goog.require('wtf.db.sources.ChunkedDataSource');
+goog.require('wtf.io.Blob');
+goog.require('wtf.io.ReadTransport');
+goog.require('wtf.io.cff.BinaryStreamSource');
+goog.require('wtf.io.cff.JsonStreamSource');
+goog.require('wtf.io.transports.BlobReadTransport');
+goog.require('wtf.io.transports.XhrReadTransport');
+
+
+
+/**
+ * Data source that parses chunked trace files on a web worker.
+ * The worker decodes all chunks into its own database, rebuilds the event
+ * lists, and transfers the resulting event data back. The calling thread only
+ * has to attach the finished zones to the target database.
+ *
+ * Use {@see #isSupported} to check whether a source info can be loaded this
+ * way before constructing.
+ *
+ * @param {!wtf.db.Database} db Target database.
+ * @param {!wtf.db.DataSourceInfo} sourceInfo Data source info.
+ * @param {function(this:T, number, number, boolean)=} opt_progressCallback
+ *     Called with (loaded, total, processing) as the worker reports progress.
+ * @param {T=} opt_scope Scope for the progress callback.
+ * @constructor
+ * @extends {wtf.db.DataSource}
+ * @template T
+ */
+wtf.db.sources.WorkerDataSource = function(db, sourceInfo,
+    opt_progressCallback, opt_scope) {
+  goog.base(this, db, sourceInfo);
+
+  /**
+   * Progress callback, if any.
+   * @type {Function}
+   * @private
+   */
+  this.progressCallback_ = opt_progressCallback || null;
+
+  /**
+   * Progress callback scope.
+   * @type {*}
+   * @private
+   */
+  this.progressScope_ = opt_scope;
+
+  /**
+   * Worker, once started.
+   * @type {Worker}
+   * @private
+   */
+  this.worker_ = null;
+
+  /**
+   * Object URL of the worker shim script.
+   * @type {?string}
+   * @private
+   */
+  this.shimUrl_ = null;
+};
+goog.inherits(wtf.db.sources.WorkerDataSource, wtf.db.DataSource);
+
+
+/**
+ * @override
+ */
+wtf.db.sources.WorkerDataSource.prototype.disposeInternal = function() {
+  this.terminate_();
+  goog.base(this, 'disposeInternal');
+};
+
+
+/**
+ * Gets the URL of the compiled UI script that will be imported into the
+ * worker.
+ * Uncompiled builds load many scripts and cannot be imported into workers.
+ * @return {?string} Script URL, if found.
+ * @private
+ */
+wtf.db.sources.WorkerDataSource.getScriptUrl_ = function() {
+  if (goog.global['WTF_UI_SCRIPT_URL']) {
+    return goog.global['WTF_UI_SCRIPT_URL'];
+  }
+  if (!goog.global.document) {
+    return null;
+  }
+  var scriptEls = goog.dom.getElementsByTagNameAndClass(
+      goog.dom.TagName.SCRIPT);
+  for (var n = 0; n < scriptEls.length; n++) {
+    var scriptEl = scriptEls[n];
+    if (goog.string.contains(scriptEl.src, 'wtf_ui_js_compiled.js')) {
+      return scriptEl.src;
+    }
+  }
+  return null;
+};
+
+
+/**
+ * Whether the given source can be loaded with a worker.
+ * @param {!wtf.db.DataSourceInfo} sourceInfo Data source info.
+ * @return {boolean} True if the source can be loaded with a worker.
+ */
+wtf.db.sources.WorkerDataSource.isSupported = function(sourceInfo) {
+  if (typeof goog.global['Worker'] != 'function' ||
+      !wtf.db.sources.WorkerDataSource.getScriptUrl_()) {
+    return false;
+  }
+  switch (sourceInfo.contentType) {
+    case 'application/x-extension-wtf-trace':
+    case 'application/x-extension-wtf-json':
+      break;
+    default:
+      return false;
+  }
+  return sourceInfo instanceof wtf.db.BlobDataSourceInfo ||
+      sourceInfo instanceof wtf.db.UrlDataSourceInfo;
+};
+
+
+/**
+ * Worker message commands.
+ * @enum {string}
+ * @private
+ */
+wtf.db.sources.WorkerDataSource.Command_ = {
+  LOAD: 'load',
+  PROGRESS: 'progress',
+  PROCESSING: 'processing',
+  ERROR: 'error',
+  LOADED: 'loaded'
+};
+
+
+/**
+ * @override
+ */
+wtf.db.sources.WorkerDataSource.prototype.start = function() {
+  var deferred = goog.base(this, 'start');
+
+  var scriptUrl = wtf.db.sources.WorkerDataSource.getScriptUrl_();
+  goog.asserts.assert(scriptUrl);
+
+  // The UI is compiled wrapped with window, so fake it in the worker.
+  var shimScriptLines = [
+    'this.window = this;',
+    'importScripts("' + scriptUrl + '");',
+    'wtf.db.sources.WorkerDataSource.workerMain();'
+  ];
+  var shimBlob = new Blob([shimScriptLines.join('\n')], {
+    'type': 'text/javascript'
+  });
+  this.shimUrl_ = goog.fs.createObjectUrl(shimBlob);
+
+  var worker = this.worker_ = new Worker(this.shimUrl_);
+  var self = this;
+  worker.onmessage = function(e) {
+    self.messageReceived_(e.data);
+  };
+  worker.onerror = function(e) {
+    self.error('Error loading trace data', String(e.message));
+    self.terminate_();
+  };
+
+  var sourceInfo = this.getInfo();
+  var message = {
+    'command': wtf.db.sources.WorkerDataSource.Command_.LOAD,
+    'filename': sourceInfo.filename,
+    'contentType': sourceInfo.contentType,
+    'timebase': this.getDatabase().getTimebase()
+  };
+  if (sourceInfo instanceof wtf.db.BlobDataSourceInfo) {
+    message['blob'] = wtf.io.Blob.toNative(sourceInfo.blob);
+  } else if (sourceInfo instanceof wtf.db.UrlDataSourceInfo) {
+    message['url'] = sourceInfo.url;
+  }
+  worker.postMessage(message);
+
+  return deferred;
+};
+
+
+/**
+ * Terminates the worker, if it is running.
+ * @private
+ */
+wtf.db.sources.WorkerDataSource.prototype.terminate_ = function() {
+  if (this.worker_) {
+    this.worker_.terminate();
+    this.worker_ = null;
+  }
+  if (this.shimUrl_) {
+    goog.fs.revokeObjectUrl(this.shimUrl_);
+    this.shimUrl_ = null;
+  }
+};
+
+
+/**
+ * Handles messages from the worker.
+ * @param {!Object} data Message data.
+ * @private
+ */
+wtf.db.sources.WorkerDataSource.prototype.messageReceived_ = function(data) {
+  switch (data['command']) {
+    case wtf.db.sources.WorkerDataSource.Command_.PROGRESS:
+      if (this.progressCallback_) {
+        this.progressCallback_.call(this.progressScope_,
+            data['loaded'], data['total'], false);
+      }
+      break;
+    case wtf.db.sources.WorkerDataSource.Command_.PROCESSING:
+      if (this.progressCallback_) {
+        this.progressCallback_.call(this.progressScope_,
+            data['loaded'], data['total'], true);
+      }
+      break;
+    case wtf.db.sources.WorkerDataSource.Command_.ERROR:
+      this.terminate_();
+      this.error(data['message'], data['detail']);
+      break;
+    case wtf.db.sources.WorkerDataSource.Command_.LOADED:
+      this.terminate_();
+      this.attachResults_(data);
+      break;
+  }
+};
+
+
+/**
+ * Attaches the zones produced by the worker to the database.
+ * @param {!Object} data Loaded message data.
+ * @private
+ */
+wtf.db.sources.WorkerDataSource.prototype.attachResults_ = function(data) {
+  var db = this.getDatabase();
+
+  // Initialize the source with the header info the worker parsed.
+  var header = data['header'];
+  var contextInfo = wtf.data.ContextInfo.parse(header['contextInfo']);
+  var timebase = header['timebase'];
+  var timeDelay = db.computeTimeDelay(timebase);
+  if (!contextInfo || !this.initialize(
+      contextInfo,
+      header['flags'],
+      header['presentationHints'],
+      header['units'],
+      header['metadata'],
+      timebase,
+      timeDelay)) {
+    this.error(
+        'Unable to initialize data source',
+        'File corrupt or invalid.');
+    return;
+  }
+
+  // The worker applied its own time delay, which will differ if another source
+  // set the common timebase while it was running.
+  var timeShift = timeDelay - header['timeDelay'];
+
+  // Map all event types into our table.
+  // The worker table is in ID order, with 0 reserved.
+  var eventTypeTable = db.getEventTypeTable();
+  var eventTypes = data['eventTypes'];
+  var typeIdMap = [0];
+  var timeRangeTypeIds = {};
+  for (var n = 0; n < eventTypes.length; n++) {
+    var json = eventTypes[n];
+    var args = [];
+    var jsonArgs = json['args'];
+    for (var m = 0; m < jsonArgs.length; m++) {
+      args.push(new wtf.data.Variable(
+          jsonArgs[m]['name'], jsonArgs[m]['typeName'],
+          jsonArgs[m]['flags']));
+    }
+    var eventType = eventTypeTable.defineType(new wtf.db.EventType(
+        json['name'], json['eventClass'], json['flags'], args));
+    if (json['mayHaveAppendedArgs']) {
+      eventType.mayHaveAppendedArgs = true;
+    }
+    typeIdMap[json['id']] = eventType.id;
+    if (eventType.name == 'wtf.timeRange#begin' ||
+        eventType.name == 'wtf.timeRange#end') {
+      timeRangeTypeIds[eventType.id] = true;
+    }
+  }
+
+  // Attach all zones. Only ancillary lists are rebuilt here.
+  // Time range IDs were allocated in the worker namespace, so the imported
+  // events are moved into ours before the lists see them.
+  var timeRangeIds = {};
+  var zones = data['zones'];
+  db.beginInsertingEvents(this);
+  for (var n = 0; n < zones.length; n++) {
+    var zoneData = zones[n];
+    var zone = db.createOrGetZone(
+        zoneData['name'], zoneData['type'], zoneData['location']);
+    var eventList = zone.getEventList();
+    var firstIndex = eventList.count;
+    eventList.importData(zoneData['data'], typeIdMap, timeShift);
+
+    var argumentTable = eventList.getArgumentTable();
+    var eventData = eventList.eventData;
+    for (var m = firstIndex, o = firstIndex * wtf.db.EventStruct.STRUCT_SIZE;
+        m < eventList.count; m++, o += wtf.db.EventStruct.STRUCT_SIZE) {
+      var typeId = eventData[o + wtf.db.EventStruct.TYPE] & 0xFFFF;
+      if (timeRangeTypeIds[typeId]) {
+        var args = argumentTable.getMutable(
+            eventData[o + wtf.db.EventStruct.ARGUMENTS]);
+        if (args) {
+          var id = timeRangeIds[args['id']];
+          if (id === undefined) {
+            id = timeRangeIds[args['id']] = wtf.db.TimeRange.allocateId();
+          }
+          args['id'] = id;
+        }
+      }
+    }
+  }
+  db.endInsertingEvents();
+
+  this.end();
+};
+
+
+/**
+ * Worker entry point.
+ * Called from the worker shim script once the UI script has been imported.
+ */
+wtf.db.sources.WorkerDataSource.workerMain = function() {
+  var Command = wtf.db.sources.WorkerDataSource.Command_;
+  goog.global.onmessage = function(e) {
+    var data = e.data;
+    if (data['command'] != Command.LOAD) {
+      return;
+    }
+    wtf.db.sources.WorkerDataSource.workerLoad_(data, function(message,
+        opt_transfer) {
+      goog.global.postMessage(message, opt_transfer);
+    });
+  };
+};
+
+
+/**
+ * Loads a trace inside of a worker.
+ * @param {!Object} data Load command data.
+ * @param {function(!Object, Array=)} postMessage Posts a message back to the
+ *     owning thread.
+ * @private
+ */
+wtf.db.sources.WorkerDataSource.workerLoad_ = function(data, postMessage) {
+  var Command = wtf.db.sources.WorkerDataSource.Command_;
+  var contentType = data['contentType'];
+
+  // Setup the transport.
+  var transport;
+  var sourceInfo;
+  if (data['blob']) {
+    var blob = wtf.io.Blob.fromNative(data['blob']);
+    transport = new wtf.io.transports.BlobReadTransport(blob);
+    sourceInfo = new wtf.db.BlobDataSourceInfo(
+        data['filename'], contentType, blob);
+  } else {
+    transport = new wtf.io.transports.XhrReadTransport(data['url']);
+    sourceInfo = new wtf.db.UrlDataSourceInfo(
+        data['filename'], contentType, data['url']);
+  }
+  var loaded = 0;
+  var total = 0;
+  transport.addListener(wtf.io.ReadTransport.EventType.PROGRESS,
+      function(newLoaded, newTotal) {
+        loaded = newLoaded;
+        total = newTotal;
+        postMessage({
+          'command': Command.PROGRESS,
+          'loaded': loaded,
+          'total': total
+        });
+      });
+  transport.addListener(wtf.io.ReadTransport.EventType.END, function() {
+    postMessage({
+      'command': Command.PROCESSING,
+      'loaded': loaded,
+      'total': total
+    });
+  });
+
+  // Share the timebase, if it has been set, so that times come back in the
+  // right space.
+  var db = new wtf.db.Database();
+  if (data['timebase'] != -1) {
+    db.computeTimeDelay(data['timebase']);
+  }
+  var errored = false;
+  db.addListener(wtf.db.Database.EventType.SOURCE_ERROR,
+      function(source, message, opt_detail) {
+        errored = true;
+        postMessage({
+          'command': Command.ERROR,
+          'message': message,
+          'detail': opt_detail || null
+        });
+      });
+
+  var streamSource;
+  if (contentType == 'application/x-extension-wtf-json') {
+    streamSource = new wtf.io.cff.JsonStreamSource(transport);
+  } else {
+    streamSource = new wtf.io.cff.BinaryStreamSource(transport);
+  }
+  var source = new wtf.db.sources.ChunkedDataSource(
+      db, sourceInfo, streamSource);
+  db.addSource(source);
+
+  source.start().addCallback(function() {
+    if (errored) {
+      return;
+    }
+
+    // Header info.
+    var header = {
+      'contextInfo': source.getContextInfo().serialize(),
+      'flags': source.getFlags(),
+      'presentationHints': source.getPresentationHints(),
+      'units': source.getUnits(),
+      'metadata': source.getMetadata(),
+      'timebase': source.getTimebase(),
+      'timeDelay': source.getTimeDelay()
+    };
+
+    // Event types, including any defined during rebuild.
+    var eventTypes = db.getEventTypeTable().getAll();
+    var eventTypesJson = [];
+    for (var n = 0; n < eventTypes.length; n++) {
+      var eventType = eventTypes[n];
+      var argsJson = [];
+      for (var m = 0; m < eventType.args.length; m++) {
+        var arg = eventType.args[m];
+        argsJson.push({
+          'name': arg.name,
+          'typeName': arg.typeName,
+          'flags': arg.flags
+        });
+      }
+      eventTypesJson.push({
+        'id': eventType.id,
+        'name': eventType.name,
+        'eventClass': eventType.eventClass,
+        'flags': eventType.flags,
+        'mayHaveAppendedArgs': eventType.mayHaveAppendedArgs,
+        'args': argsJson
+      });
+    }
+
+    // Zone data, with event data buffers transferred.
+    var zones = db.getZones();
+    var zonesJson = [];
+    var transfer = [];
+    for (var n = 0; n < zones.length; n++) {
+      var zone = zones[n];
+      var eventListData = zone.getEventList().exportData();
+      zonesJson.push({
+        'name': zone.getName(),
+        'type': zone.getType(),
+        'location': zone.getLocation(),
+        'data': eventListData
+      });
+      transfer.push(eventListData.eventData.buffer);
+    }
+
+    postMessage({
+      'command': Command.LOADED,
+      'header': header,
+      'eventTypes': eventTypesJson,
+      'zones': zonesJson
+    }, transfer);
+    goog.dispose(db);
+  });
+};
+
+
+goog.exportSymbol(
+    'wtf.db.sources.WorkerDataSource.workerMain',
+    wtf.db.sources.WorkerDataSource.workerMain);
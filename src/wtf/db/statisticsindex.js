@@ -0,0 +1,361 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/**
+ * @fileoverview Per-block event statistics index.
+ * The events in an event list are split into fixed-size blocks and the
+ * per-type counts, times, and duration histograms of each block are cached.
+ * A statistics query over an event range then only has to merge the cached
+ * blocks it covers and scan the partial blocks at either end.
+ *
+ * @author benvanik@google.com (Ben Vanik)
+ */
+
+goog.provide('wtf.db.StatisticsIndex');
+goog.provide('wtf.db.StatisticsIndex.Record');
+
+goog.require('wtf.data.EventClass');
+goog.require('wtf.db.EventStruct');
+
+
+
+/**
+ * Statistics index of an event list.
+ * Blocks are computed on demand and kept until the event list changes.
+ * This is maintained by the event list as it rebuilds.
+ *
+ * @param {!wtf.db.EventList} eventList Event list.
+ * @constructor
+ */
+wtf.db.StatisticsIndex = function(eventList) {
+  /**
+   * Event list that is indexed.
+   * @type {!wtf.db.EventList}
+   * @private
+   */
+  this.eventList_ = eventList;
+
+  /**
+   * Cached block records, indexed by block.
+   * Each entry is a list of records for the types that appear in the block,
+   * or null if the block has not been computed.
+   * @type {!Array.<Array.<!wtf.db.StatisticsIndex.Record>>}
+   * @private
+   */
+  this.blocks_ = [];
+
+  /**
+   * Cache of type ID -> whether the type is a scope.
+   * @type {!Array.<boolean>}
+   * @private
+   */
+  this.isScopeType_ = [];
+};
+
+
+/**
+ * Number of events in each block.
+ * @const
+ * @type {number}
+ */
+wtf.db.StatisticsIndex.BLOCK_SIZE = 4096;
+
+
+/**
+ * Number of 1ms buckets in duration histograms.
+ * Durations past the end are placed in the last bucket.
+ * @const
+ * @type {number}
+ */
+wtf.db.StatisticsIndex.BUCKET_COUNT = 1000;
+
+
+/**
+ * Removes all cached blocks.
+ */
+wtf.db.StatisticsIndex.prototype.reset = function() {
+  this.blocks_.length = 0;
+  this.isScopeType_.length = 0;
+};
+
+
+/**
+ * Removes cached blocks that contain or follow the given event.
+ * This is used when events have been appended to the list.
+ * @param {number} index Index of the first changed event.
+ */
+wtf.db.StatisticsIndex.prototype.invalidateFrom = function(index) {
+  var block = Math.floor(index / wtf.db.StatisticsIndex.BLOCK_SIZE);
+  if (this.blocks_.length > block) {
+    this.blocks_.length = block;
+  }
+};
+
+
+/**
+ * Accumulates statistics for an event range.
+ * Only types that have a record in the given list are accumulated.
+ * @param {number} startIndex First event index.
+ * @param {number} endIndex Last event index, inclusive.
+ * @param {!Array.<wtf.db.StatisticsIndex.Record>} records Records to add to,
+ *     indexed by type ID.
+ */
+wtf.db.StatisticsIndex.prototype.accumulate = function(
+    startIndex, endIndex, records) {
+  var blockSize = wtf.db.StatisticsIndex.BLOCK_SIZE;
+  endIndex = Math.min(endIndex, this.eventList_.count - 1);
+  if (endIndex < startIndex) {
+    return;
+  }
+
+  // Leading partial block.
+  var firstBlock = Math.ceil(startIndex / blockSize);
+  var lastBlock = Math.floor((endIndex + 1) / blockSize);
+  if (firstBlock >= lastBlock) {
+    // No complete blocks in the range.
+    this.scan_(startIndex, endIndex, records, false);
+    return;
+  }
+  if (startIndex < firstBlock * blockSize) {
+    this.scan_(startIndex, firstBlock * blockSize - 1, records, false);
+  }
+
+  // Complete blocks.
+  for (var n = firstBlock; n < lastBlock; n++) {
+    var blockRecords = this.getBlock_(n);
+    for (var m = 0; m < blockRecords.length; m++) {
+      var blockRecord = blockRecords[m];
+      var record = records[blockRecord.typeId];
+      if (record) {
+        record.add(blockRecord);
+      }
+    }
+  }
+
+  // Trailing partial block.
+  if (lastBlock * blockSize <= endIndex) {
+    this.scan_(lastBlock * blockSize, endIndex, records, false);
+  }
+};
+
+
+/**
+ * Gets the records of a complete block, computing them if needed.
+ * @param {number} block Block index.
+ * @return {!Array.<!wtf.db.StatisticsIndex.Record>} Block records.
+ * @private
+ */
+wtf.db.StatisticsIndex.prototype.getBlock_ = function(block) {
+  var blockRecords = this.blocks_[block];
+  if (blockRecords) {
+    return blockRecords;
+  }
+
+  var blockSize = wtf.db.StatisticsIndex.BLOCK_SIZE;
+  var records = [];
+  var complete = this.scan_(
+      block * blockSize, (block + 1) * blockSize - 1, records, true);
+  blockRecords = [];
+  for (var n = 0; n < records.length; n++) {
+    var record = records[n];
+    if (record) {
+      record.compact();
+      blockRecords.push(record);
+    }
+  }
+
+  // Blocks with open scopes change as the list is appended to, so only cache
+  // blocks where all scopes have ended.
+  if (complete) {
+    while (this.blocks_.length < block) {
+      this.blocks_.push(null);
+    }
+    this.blocks_[block] = blockRecords;
+  }
+  return blockRecords;
+};
+
+
+/**
+ * Scans an event range and accumulates statistics.
+ * @param {number} startIndex First event index.
+ * @param {number} endIndex Last event index, inclusive.
+ * @param {!Array.<wtf.db.StatisticsIndex.Record>} records Records to add to,
+ *     indexed by type ID.
+ * @param {boolean} createRecords Whether to create records for types that do
+ *     not have one. If false those types are skipped.
+ * @return {boolean} False if any scope in the range has not yet ended.
+ * @private
+ */
+wtf.db.StatisticsIndex.prototype.scan_ = function(
+    startIndex, endIndex, records, createRecords) {
+  var eventTypeTable = this.eventList_.eventTypeTable;
+  var eventData = this.eventList_.eventData;
+  var isScopeType = this.isScopeType_;
+  var bucketCount = wtf.db.StatisticsIndex.BUCKET_COUNT;
+  var complete = true;
+  var o = startIndex * wtf.db.EventStruct.STRUCT_SIZE;
+  for (var n = startIndex; n <= endIndex;
+      n++, o += wtf.db.EventStruct.STRUCT_SIZE) {
+    var typeId = eventData[o + wtf.db.EventStruct.TYPE] & 0xFFFF;
+    var isScope = isScopeType[typeId];
+    if (isScope === undefined) {
+      var type = eventTypeTable.getById(typeId);
+      isScope = isScopeType[typeId] =
+          !!type && type.eventClass == wtf.data.EventClass.SCOPE;
+    }
+
+    var record = records[typeId];
+    if (!record) {
+      if (!createRecords) {
+        continue;
+      }
+      record = records[typeId] =
+          new wtf.db.StatisticsIndex.Record(typeId, isScope);
+    }
+    record.eventCount++;
+
+    if (!isScope) {
+      record.count++;
+      continue;
+    }
+    var endTime = eventData[o + wtf.db.EventStruct.END_TIME];
+    if (!endTime) {
+      complete = false;
+      continue;
+    }
+    record.count++;
+    var totalTime = endTime - eventData[o + wtf.db.EventStruct.TIME];
+    var userTime = totalTime - eventData[o + wtf.db.EventStruct.SYSTEM_TIME];
+    record.totalTime += totalTime;
+    record.ownTime += totalTime - eventData[o + wtf.db.EventStruct.CHILD_TIME];
+    record.userTime += userTime;
+    var bucketIndex = Math.round(userTime / 1000) | 0;
+    if (bucketIndex >= bucketCount) {
+      bucketIndex = bucketCount - 1;
+    }
+    record.buckets[bucketIndex]++;
+  }
+  return complete;
+};
+
+
+
+/**
+ * Statistics for a single event type over some range of events.
+ * Times are in the raw event units (microseconds).
+ * @param {number} typeId Event type ID.
+ * @param {boolean} isScope Whether the type is a scope type.
+ * @constructor
+ */
+wtf.db.StatisticsIndex.Record = function(typeId, isScope) {
+  /**
+   * Event type ID.
+   * @type {number}
+   */
+  this.typeId = typeId;
+
+  /**
+   * Number of events of the type, including scopes that have not ended.
+   * @type {number}
+   */
+  this.eventCount = 0;
+
+  /**
+   * Number of instance events or ended scopes.
+   * @type {number}
+   */
+  this.count = 0;
+
+  /**
+   * Total time of all ended scopes.
+   * @type {number}
+   */
+  this.totalTime = 0;
+
+  /**
+   * Total time of all ended scopes, excluding children.
+   * @type {number}
+   */
+  this.ownTime = 0;
+
+  /**
+   * Total time of all ended scopes, excluding system time.
+   * @type {number}
+   */
+  this.userTime = 0;
+
+  /**
+   * Histogram of user durations in 1ms buckets, if a scope type.
+   * @type {Uint32Array}
+   */
+  this.buckets = isScope ?
+      new Uint32Array(wtf.db.StatisticsIndex.BUCKET_COUNT) : null;
+
+  /**
+   * Non-empty histogram buckets as [index, count] pairs.
+   * Cached block records use this instead of {@see #buckets}, as most
+   * scopes fall into only a few buckets.
+   * @type {Uint32Array}
+   */
+  this.bucketPairs = null;
+};
+
+
+/**
+ * Replaces the histogram with its compact form.
+ */
+wtf.db.StatisticsIndex.Record.prototype.compact = function() {
+  var buckets = this.buckets;
+  if (!buckets) {
+    return;
+  }
+  var used = 0;
+  for (var n = 0; n < buckets.length; n++) {
+    if (buckets[n]) {
+      used++;
+    }
+  }
+  var pairs = new Uint32Array(used * 2);
+  for (var n = 0, m = 0; n < buckets.length; n++) {
+    if (buckets[n]) {
+      pairs[m++] = n;
+      pairs[m++] = buckets[n];
+    }
+  }
+  this.bucketPairs = pairs;
+  this.buckets = null;
+};
+
+
+/**
+ * Adds the statistics of another record of the same type to this one.
+ * @param {!wtf.db.StatisticsIndex.Record} other Other record.
+ */
+wtf.db.StatisticsIndex.Record.prototype.add = function(other) {
+  this.eventCount += other.eventCount;
+  this.count += other.count;
+  this.totalTime += other.totalTime;
+  this.ownTime += other.ownTime;
+  this.userTime += other.userTime;
+
+  var buckets = this.buckets;
+  if (!buckets) {
+    return;
+  }
+  var pairs = other.bucketPairs;
+  if (pairs) {
+    for (var n = 0; n < pairs.length; n += 2) {
+      buckets[pairs[n]] += pairs[n + 1];
+    }
+  } else if (other.buckets) {
+    var otherBuckets = other.buckets;
+    for (var n = 0; n < otherBuckets.length; n++) {
+      buckets[n] += otherBuckets[n];
+    }
+  }
+};
@@ -0,0 +1,95 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+goog.provide('wtf.db.StatisticsIndex_test');
+
+goog.require('wtf.db.EventList');
+goog.require('wtf.db.EventTypeTable');
+goog.require('wtf.db.StatisticsIndex');
+goog.require('wtf.testing');
+
+
+/**
+ * wtf.db.StatisticsIndex testing.
+ */
+wtf.db.StatisticsIndex_test = suite('wtf.db.StatisticsIndex', function() {
+  /**
+   * Accumulates the given range with the index and by walking all events.
+   * @param {!wtf.db.EventList} eventList Event list.
+   * @param {number} startIndex First event index.
+   * @param {number} endIndex Last event index, inclusive.
+   */
+  function assertRangeMatches(eventList, startIndex, endIndex) {
+    var scopeTypeId = eventList.getEventTypeId('outer');
+    var instanceTypeId = eventList.getEventTypeId('someInstanceEvent');
+    var records = [];
+    records[scopeTypeId] =
+        new wtf.db.StatisticsIndex.Record(scopeTypeId, true);
+    records[instanceTypeId] =
+        new wtf.db.StatisticsIndex.Record(instanceTypeId, false);
+    eventList.getStatisticsIndex().accumulate(startIndex, endIndex, records);
+
+    var scopeCount = 0;
+    var totalTime = 0;
+    var instanceCount = 0;
+    var it = eventList.beginEventRange(startIndex, endIndex);
+    for (; !it.done(); it.next()) {
+      if (it.getTypeId() == scopeTypeId && it.getEndTime()) {
+        scopeCount++;
+        totalTime += it.getTotalDuration() * 1000;
+      } else if (it.getTypeId() == instanceTypeId) {
+        instanceCount++;
+      }
+    }
+    assert.equal(records[scopeTypeId].count, scopeCount);
+    assert.equal(records[scopeTypeId].totalTime, totalTime);
+    assert.equal(records[instanceTypeId].count, instanceCount);
+
+    var bucketTotal = 0;
+    var buckets = records[scopeTypeId].buckets;
+    for (var n = 0; n < buckets.length; n++) {
+      bucketTotal += buckets[n];
+    }
+    assert.equal(bucketTotal, scopeCount);
+  };
+
+  test('accumulate', function() {
+    // Enough events to span several blocks.
+    var events = [];
+    for (var n = 0; n < 5000; n++) {
+      events.push([n * 10, 'outer']);
+      events.push([n * 10 + 1 + (n % 7), 'someInstanceEvent']);
+      events.push([n * 10 + 9, 'wtf.scope#leave']);
+    }
+    var eventList = new wtf.db.EventList(new wtf.db.EventTypeTable());
+    wtf.testing.insertEvents(eventList, {
+      instanceEventTypes: [
+        'wtf.scope#leave()',
+        'someInstanceEvent()'
+      ],
+      scopeEventTypes: [
+        'outer()'
+      ],
+      events: events
+    });
+
+    var blockSize = wtf.db.StatisticsIndex.BLOCK_SIZE;
+    assertRangeMatches(eventList, 0, eventList.count - 1);
+    assertRangeMatches(eventList, 5, 100);
+    assertRangeMatches(eventList, blockSize - 3, blockSize * 2 + 3);
+    assertRangeMatches(eventList, blockSize, blockSize * 3 - 1);
+
+    // Appending replaces the cached tail blocks.
+    wtf.testing.insertEvents(eventList, {
+      events: [
+        [60000, 'outer'],
+        [60005, 'wtf.scope#leave']
+      ]
+    });
+    assertRangeMatches(eventList, 0, eventList.count - 1);
+  });
+});
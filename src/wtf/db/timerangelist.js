@@ -202,6 +202,18 @@ wtf.db.TimeRangeList.prototype.beginRebuild = function(eventTypeTable) {
 };
 
 
+/**
+ * @override
+ */
+wtf.db.TimeRangeList.prototype.beginAppend = function(eventTypeTable) {
+  // Keep the level state so that open time ranges can be ended.
+  return [
+    eventTypeTable.getByName('wtf.timeRange#begin'),
+    eventTypeTable.getByName('wtf.timeRange#end')
+  ];
+};
+
+
 /**
  * @override
  */
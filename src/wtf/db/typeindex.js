@@ -0,0 +1,204 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/**
+ * @fileoverview Per-type event bitmap index.
+ * Each event type has a bitmap of the IDs of its events. Queries for sets of
+ * types and time windows are answered with bitmap operations instead of
+ * rescanning the event data.
+ *
+ * @author benvanik@google.com (Ben Vanik)
+ */
+
+goog.provide('wtf.db.TypeIndex');
+
+goog.require('wtf.db.EventBitmap');
+goog.require('wtf.db.EventStruct');
+
+
+
+/**
+ * Per-type event bitmap index of an event list.
+ * This is maintained by the event list as it rebuilds.
+ *
+ * @param {!wtf.db.EventList} eventList Event list.
+ * @constructor
+ */
+wtf.db.TypeIndex = function(eventList) {
+  /**
+   * Event list that is indexed.
+   * @type {!wtf.db.EventList}
+   * @private
+   */
+  this.eventList_ = eventList;
+
+  /**
+   * Bitmaps of event IDs, indexed by type ID.
+   * @type {!Array.<wtf.db.EventBitmap>}
+   * @private
+   */
+  this.bitmaps_ = [];
+
+  /**
+   * Number of events from the start of the list that have been indexed.
+   * @type {number}
+   * @private
+   */
+  this.indexedCount_ = 0;
+};
+
+
+/**
+ * Removes all indexed events.
+ * The next {@see #update} will index the whole list.
+ */
+wtf.db.TypeIndex.prototype.reset = function() {
+  this.bitmaps_.length = 0;
+  this.indexedCount_ = 0;
+};
+
+
+/**
+ * Gets the number of events from the start of the list that are indexed.
+ * @return {number} Event count.
+ */
+wtf.db.TypeIndex.prototype.getIndexedCount = function() {
+  return this.indexedCount_;
+};
+
+
+/**
+ * Indexes all events added to the list since the last update.
+ * Events must have been appended in time order since the last reset.
+ */
+wtf.db.TypeIndex.prototype.update = function() {
+  var eventData = this.eventList_.eventData;
+  var bitmaps = this.bitmaps_;
+  var count = this.eventList_.count;
+  for (var n = this.indexedCount_,
+      o = n * wtf.db.EventStruct.STRUCT_SIZE; n < count; n++) {
+    var typeId = eventData[o + wtf.db.EventStruct.TYPE] & 0xFFFF;
+    var bitmap = bitmaps[typeId];
+    if (!bitmap) {
+      bitmap = bitmaps[typeId] = new wtf.db.EventBitmap();
+    }
+    bitmap.add(n);
+    o += wtf.db.EventStruct.STRUCT_SIZE;
+  }
+  this.indexedCount_ = count;
+};
+
+
+/**
+ * Gets the number of events of the given type.
+ * @param {number} typeId Event type ID.
+ * @return {number} Event count.
+ */
+wtf.db.TypeIndex.prototype.getCount = function(typeId) {
+  var bitmap = this.bitmaps_[typeId];
+  return bitmap ? bitmap.getCount() : 0;
+};
+
+
+/**
+ * Gets the bitmap of the events of the given type.
+ * @param {number} typeId Event type ID.
+ * @return {wtf.db.EventBitmap} Bitmap, if any events of the type have been
+ *     indexed. Do not modify.
+ */
+wtf.db.TypeIndex.prototype.getBitmap = function(typeId) {
+  return this.bitmaps_[typeId] || null;
+};
+
+
+/**
+ * Gets the events of any of the given types, optionally within a time window.
+ * @param {!Array.<wtf.db.EventType|number>} eventTypes Event types or type
+ *     IDs. Null entries are ignored.
+ * @param {number=} opt_startTime Start of the time window, inclusive.
+ * @param {number=} opt_endTime End of the time window, exclusive.
+ * @return {!wtf.db.EventBitmap} New bitmap.
+ */
+wtf.db.TypeIndex.prototype.query = function(
+    eventTypes, opt_startTime, opt_endTime) {
+  return this.queryRange(eventTypes,
+      opt_startTime !== undefined ?
+          this.getFirstIndexAtTime(opt_startTime) : 0,
+      opt_endTime !== undefined ?
+          this.getFirstIndexAtTime(opt_endTime) : this.indexedCount_);
+};
+
+
+/**
+ * Gets the events of any of the given types within a range of event IDs.
+ * Each type bitmap is sliced to the range before they are combined, so the
+ * cost scales with the size of the range rather than the whole list.
+ * @param {!Array.<wtf.db.EventType|number>} eventTypes Event types or type
+ *     IDs. Null entries are ignored.
+ * @param {number} startIndex First event ID, inclusive.
+ * @param {number} endIndex Last event ID, exclusive.
+ * @return {!wtf.db.EventBitmap} New bitmap.
+ */
+wtf.db.TypeIndex.prototype.queryRange = function(
+    eventTypes, startIndex, endIndex) {
+  endIndex = Math.min(endIndex, this.indexedCount_);
+  var bitmaps = [];
+  for (var n = 0; n < eventTypes.length; n++) {
+    var eventType = eventTypes[n];
+    if (eventType === null || eventType === undefined) {
+      continue;
+    }
+    var bitmap = this.bitmaps_[goog.isNumber(eventType) ?
+        eventType : eventType.id];
+    if (bitmap) {
+      bitmaps.push(bitmap.slice(startIndex, endIndex));
+    }
+  }
+  return bitmaps.length == 1 ?
+      bitmaps[0] : wtf.db.EventBitmap.unionAll(bitmaps);
+};
+
+
+/**
+ * Gets the index of the first event at or after the given time.
+ * @param {number} time Time.
+ * @return {number} Event index, or the indexed count if all events are
+ *     before the time.
+ */
+wtf.db.TypeIndex.prototype.getFirstIndexAtTime = function(time) {
+  time *= 1000;
+  var eventData = this.eventList_.eventData;
+  var low = 0;
+  var high = this.indexedCount_;
+  while (low < high) {
+    var mid = ((low + high) / 2) | 0;
+    var o = mid * wtf.db.EventStruct.STRUCT_SIZE;
+    if (eventData[o + wtf.db.EventStruct.TIME] < time) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+};
+
+
+goog.exportProperty(
+    wtf.db.TypeIndex.prototype, 'getCount',
+    wtf.db.TypeIndex.prototype.getCount);
+goog.exportProperty(
+    wtf.db.TypeIndex.prototype, 'getBitmap',
+    wtf.db.TypeIndex.prototype.getBitmap);
+goog.exportProperty(
+    wtf.db.TypeIndex.prototype, 'query',
+    wtf.db.TypeIndex.prototype.query);
+goog.exportProperty(
+    wtf.db.TypeIndex.prototype, 'queryRange',
+    wtf.db.TypeIndex.prototype.queryRange);
+goog.exportProperty(
+    wtf.db.TypeIndex.prototype, 'getFirstIndexAtTime',
+    wtf.db.TypeIndex.prototype.getFirstIndexAtTime);
@@ -14,14 +14,15 @@
 goog.provide('wtf.db.Zone');
 
 goog.require('goog.Disposable');
-goog.require('goog.array');
 goog.require('wtf');
 goog.require('wtf.db.EventIndex');
 goog.require('wtf.db.EventList');
+goog.require('wtf.db.EventSummary');
 goog.require('wtf.db.Filter');
 goog.require('wtf.db.FilterResult');
 goog.require('wtf.db.FrameList');
 goog.require('wtf.db.MarkList');
+goog.require('wtf.db.QueryCursor');
 goog.require('wtf.db.QueryResult');
 goog.require('wtf.db.TimeRangeList');
 
@@ -101,6 +102,14 @@ wtf.db.Zone = function(db, name, type, location) {
   this.timeRangeList_ = new wtf.db.TimeRangeList(this.eventList_);
   this.registerDisposable(this.timeRangeList_);
 
+  /**
+   * Multi-resolution summary of the events in this zone.
+   * @type {!wtf.db.EventSummary}
+   * @private
+   */
+  this.eventSummary_ = new wtf.db.EventSummary(this.eventList_);
+  this.registerDisposable(this.eventSummary_);
+
   /**
    * A list of all shared indices that have been created for this zone.
    * Users need not share the indices if they plan on throwing them away
@@ -112,6 +121,13 @@ wtf.db.Zone = function(db, name, type, location) {
    * @private
    */
   this.indices_ = [];
+
+  /**
+   * Shared indices keyed by their event names joined with newlines.
+   * @type {!Object.<!wtf.db.EventIndex>}
+   * @private
+   */
+  this.indexMap_ = {};
 };
 goog.inherits(wtf.db.Zone, goog.Disposable);
 
@@ -218,6 +234,36 @@ wtf.db.Zone.prototype.getFrameList = function() {
 };
 
 
+/**
+ * Gets the interval index of the scopes in this zone.
+ * @return {!wtf.db.IntervalIndex} Interval index.
+ */
+wtf.db.Zone.prototype.getIntervalIndex = function() {
+  return this.eventList_.getIntervalIndex();
+};
+
+
+/**
+ * Begins iterating all scopes in this zone that overlap the given time range.
+ * @param {number} startTime Start time.
+ * @param {number} endTime End time.
+ * @return {!wtf.db.EventIterator} Iterator over the scopes, in event order.
+ */
+wtf.db.Zone.prototype.beginIntersecting = function(startTime, endTime) {
+  return this.eventList_.beginIntersecting(startTime, endTime);
+};
+
+
+/**
+ * Gets the event summary.
+ * The summary is built on first use and is rebuilt as events are added.
+ * @return {!wtf.db.EventSummary} Event summary.
+ */
+wtf.db.Zone.prototype.getEventSummary = function() {
+  return this.eventSummary_;
+};
+
+
 /**
  * Gets the mark list.
  * Note that it may be empty if this zone has no marks.
@@ -238,6 +284,15 @@ wtf.db.Zone.prototype.getTimeRangeList = function() {
 };
 
 
+/**
+ * Gets the per-type bitmap index of the events in this zone.
+ * @return {!wtf.db.TypeIndex} Type index.
+ */
+wtf.db.Zone.prototype.getTypeIndex = function() {
+  return this.eventList_.getTypeIndex();
+};
+
+
 /**
  * Gets an event index with the given event types.
  * If the index has already been created the existing one will be returned.
@@ -247,16 +302,13 @@ wtf.db.Zone.prototype.getTimeRangeList = function() {
  * @return {!wtf.db.EventIndex} Event index.
  */
 wtf.db.Zone.prototype.getSharedIndex = function(eventNames) {
-  // Search for an existing index.
-  for (var n = 0; n < this.indices_.length; n++) {
-    if (goog.array.equals(this.indices_[n].getEventNames(), eventNames)) {
-      return this.indices_[n];
-    }
+  var key = eventNames.join('\n');
+  var index = this.indexMap_[key];
+  if (!index) {
+    index = new wtf.db.EventIndex(this, eventNames);
+    this.indices_.push(index);
+    this.indexMap_[key] = index;
   }
-
-  // Create a new index.
-  var index = new wtf.db.EventIndex(this, eventNames);
-  this.indices_.push(index);
   return index;
 };
 
@@ -285,6 +337,26 @@ wtf.db.Zone.prototype.query = function(expr) {
 };
 
 
+/**
+ * Creates an incrementally evaluated query of the zone.
+ * Evaluation does not begin until {@see wtf.db.QueryCursor#start} or
+ * {@see wtf.db.QueryCursor#runToCompletion} is called. The cursor follows
+ * changes to the zone's events until it is disposed.
+ * Throws errors if the expression could not be parsed.
+ * @param {string} expr Query string.
+ * @return {!wtf.db.QueryCursor} Query cursor.
+ */
+wtf.db.Zone.prototype.createQueryCursor = function(expr) {
+  var filter = new wtf.db.Filter();
+  var parseResult = filter.setFromString(expr);
+  if (parseResult == wtf.db.FilterResult.FAILED) {
+    throw filter.getError();
+  }
+
+  return new wtf.db.QueryCursor(expr, filter, this.eventList_);
+};
+
+
 goog.exportSymbol(
     'wtf.db.Zone',
     wtf.db.Zone);
@@ -306,15 +378,30 @@ goog.exportProperty(
 goog.exportProperty(
     wtf.db.Zone.prototype, 'getFrameList',
     wtf.db.Zone.prototype.getFrameList);
+goog.exportProperty(
+    wtf.db.Zone.prototype, 'getIntervalIndex',
+    wtf.db.Zone.prototype.getIntervalIndex);
+goog.exportProperty(
+    wtf.db.Zone.prototype, 'beginIntersecting',
+    wtf.db.Zone.prototype.beginIntersecting);
+goog.exportProperty(
+    wtf.db.Zone.prototype, 'getEventSummary',
+    wtf.db.Zone.prototype.getEventSummary);
 goog.exportProperty(
     wtf.db.Zone.prototype, 'getMarkList',
     wtf.db.Zone.prototype.getMarkList);
 goog.exportProperty(
     wtf.db.Zone.prototype, 'getTimeRangeList',
     wtf.db.Zone.prototype.getTimeRangeList);
+goog.exportProperty(
+    wtf.db.Zone.prototype, 'getTypeIndex',
+    wtf.db.Zone.prototype.getTypeIndex);
 goog.exportProperty(
     wtf.db.Zone.prototype, 'getSharedIndex',
     wtf.db.Zone.prototype.getSharedIndex);
 goog.exportProperty(
     wtf.db.Zone.prototype, 'query',
     wtf.db.Zone.prototype.query);
+goog.exportProperty(
+    wtf.db.Zone.prototype, 'createQueryCursor',
+    wtf.db.Zone.prototype.createQueryCursor);
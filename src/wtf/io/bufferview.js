@@ -100,6 +100,38 @@ wtf.io.BufferView.createWithBuffer = function(arrayBuffer, opt_stringTable) {
 };
 
 
+/**
+ * Creates a new fixed size buffer view over a range of the given data.
+ * This allows several buffer views to share a single backing store, such as
+ * a SharedArrayBuffer.
+ * @param {!ArrayBuffer} arrayBuffer Array buffer data to use.
+ * @param {number} byteOffset Offset of the range in the buffer, in bytes. Must
+ *     be 4b aligned.
+ * @param {number} byteLength Length of the range, in bytes. This determines
+ *     the capacity of the buffer view.
+ * @param {wtf.io.StringTable=} opt_stringTable String table. One will be
+ *     created if none is provided.
+ * @return {!wtf.io.BufferView.Type} New buffer view wrapping the given range.
+ */
+wtf.io.BufferView.createWithRange = function(
+    arrayBuffer, byteOffset, byteLength, opt_stringTable) {
+  goog.asserts.assert(!(byteOffset % 4));
+  return /** @type {!wtf.io.BufferView.Type} */ ({
+    'capacity': byteLength,
+    'offset': 0,
+    'stringTable': opt_stringTable || new wtf.io.StringTable(),
+    'arrayBuffer': arrayBuffer,
+    'int8Array': new Int8Array(arrayBuffer, byteOffset, byteLength),
+    'uint8Array': new Uint8Array(arrayBuffer, byteOffset, byteLength),
+    'int16Array': new Int16Array(arrayBuffer, byteOffset, byteLength >> 1),
+    'uint16Array': new Uint16Array(arrayBuffer, byteOffset, byteLength >> 1),
+    'int32Array': new Int32Array(arrayBuffer, byteOffset, byteLength >> 2),
+    'uint32Array': new Uint32Array(arrayBuffer, byteOffset, byteLength >> 2),
+    'float32Array': new Float32Array(arrayBuffer, byteOffset, byteLength >> 2)
+  });
+};
+
+
 /**
  * Gets the bytes of the buffer that are currently in use.
  * @param {!wtf.io.BufferView.Type} bufferView Buffer view.
@@ -113,7 +145,8 @@ wtf.io.BufferView.getUsedBytes = function(bufferView, opt_allowReference) {
     if (bufferView['offset'] == bufferView['capacity']) {
       return bufferView['uint8Array'];
     } else {
-      return new Uint8Array(bufferView['arrayBuffer'], 0, bufferView['offset']);
+      // Subarray so that views created with a range are handled.
+      return bufferView['uint8Array'].subarray(0, bufferView['offset']);
     }
   } else {
     return wtf.io.sliceByteArray(
@@ -21,8 +21,10 @@ goog.require('wtf.data.formats.BinaryTrace');
 goog.require('wtf.data.formats.ChunkedFileFormat');
 goog.require('wtf.io');
 goog.require('wtf.io.Buffer');
+goog.require('wtf.io.BufferView');
 goog.require('wtf.io.DataFormat');
 goog.require('wtf.io.cff.ChunkType');
+goog.require('wtf.io.cff.EventBufferCodec');
 goog.require('wtf.io.cff.PartType');
 goog.require('wtf.io.cff.StreamSource');
 goog.require('wtf.io.cff.chunks.EventDataChunk');
@@ -346,7 +348,7 @@ wtf.io.cff.BinaryStreamSource.prototype.parseChunk_ = function(data, o) {
   // Skip unknown chunk types.
   if (chunkType == wtf.io.cff.ChunkType.UNKNOWN) {
     if (goog.global.console) {
-      goog.global.console.log('WARNING: chunk type ' + chunkType + ' ignored.');
+      goog.global.console.log('WARNING: chunk type ' + header[1] + ' ignored.');
     }
     return o + chunkLength;
   }
@@ -425,6 +427,12 @@ wtf.io.cff.BinaryStreamSource.prototype.parsePart_ = function(
     return null;
   }
 
+  // Compressed event buffers are expanded into normal binary parts so that
+  // nothing downstream needs to know about them.
+  if (partTypeEnum == wtf.io.cff.PartType.COMPRESSED_EVENT_BUFFER) {
+    return this.parseCompressedEventBuffer_(data, waiters);
+  }
+
   // Create part.
   var part = this.createPartType(partTypeEnum);
   goog.asserts.assert(part);
@@ -442,6 +450,33 @@ wtf.io.cff.BinaryStreamSource.prototype.parsePart_ = function(
 };
 
 
+/**
+ * Parses a compressed event buffer part into a binary event buffer part.
+ * @param {!Uint8Array} data Part binary data.
+ * @param {!Array.<!goog.async.Deferred>} waiters A list of deferreds to add any
+ *     new waiters to that may be required by this part.
+ * @return {!wtf.io.cff.Part} Binary event buffer part.
+ * @private
+ */
+wtf.io.cff.BinaryStreamSource.prototype.parseCompressedEventBuffer_ =
+    function(data, waiters) {
+  var part = /** @type {!wtf.io.cff.parts.BinaryEventBufferPart} */ (
+      this.createPartType(wtf.io.cff.PartType.BINARY_EVENT_BUFFER));
+
+  var result = wtf.io.cff.EventBufferCodec.decode(data);
+  if (result instanceof Uint8Array) {
+    part.setValue(wtf.io.BufferView.createWithBuffer(result.buffer));
+  } else {
+    result.addCallback(function(bytes) {
+      part.setValue(wtf.io.BufferView.createWithBuffer(bytes.buffer));
+    });
+    waiters.push(result);
+  }
+
+  return part;
+};
+
+
 /**
  * Pumps the pending chunk list, moving it ahead until the next blocker.
  * @private
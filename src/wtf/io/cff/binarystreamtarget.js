@@ -15,9 +15,13 @@ goog.provide('wtf.io.cff.BinaryStreamTarget');
 
 goog.require('wtf.data.formats.ChunkedFileFormat');
 goog.require('wtf.io.Blob');
+goog.require('wtf.io.BufferView');
+goog.require('wtf.io.cff.Chunk');
 goog.require('wtf.io.cff.ChunkType');
+goog.require('wtf.io.cff.EventBufferCodec');
 goog.require('wtf.io.cff.PartType');
 goog.require('wtf.io.cff.StreamTarget');
+goog.require('wtf.io.cff.chunks.ChunkIndexChunk');
 goog.require('wtf.version');
 
 
@@ -27,18 +31,53 @@ goog.require('wtf.version');
  * Writes chunks in an efficient binary format to the given write transport.
  *
  * @param {!wtf.io.WriteTransport} transport Write transport.
+ * @param {wtf.io.cff.EventBufferCodec.Mode=} opt_compression Event buffer
+ *     compression mode. Defaults to no compression.
+ * @param {boolean=} opt_writeIndex Whether to end the stream with a chunk
+ *     index so that readers can seek. Readers that predate the chunk index
+ *     fail to load these streams, so this defaults to false.
  * @constructor
  * @extends {wtf.io.cff.StreamTarget}
  */
-wtf.io.cff.BinaryStreamTarget = function(transport) {
+wtf.io.cff.BinaryStreamTarget = function(
+    transport, opt_compression, opt_writeIndex) {
   goog.base(this, transport);
 
+  var compression = opt_compression || wtf.io.cff.EventBufferCodec.Mode.NONE;
+
+  /**
+   * Event buffer encoder, if compression is enabled.
+   * The encoder tracks event definitions across chunks and so must see every
+   * event buffer written to the stream.
+   * @type {wtf.io.cff.EventBufferCodec}
+   * @private
+   */
+  this.eventBufferCodec_ =
+      compression != wtf.io.cff.EventBufferCodec.Mode.NONE ?
+      new wtf.io.cff.EventBufferCodec(compression) : null;
+
+  /**
+   * Total number of bytes written to the transport.
+   * @type {number}
+   * @private
+   */
+  this.byteOffset_ = 0;
+
+  /**
+   * Index entries for all chunks written, in order, if the index is enabled.
+   * These are written as a {@see wtf.io.cff.chunks.ChunkIndexChunk} on end.
+   * @type {Array.<!wtf.io.cff.chunks.ChunkIndexChunk.Entry>}
+   * @private
+   */
+  this.indexEntries_ = opt_writeIndex ? [] : null;
+
   // Write magic header.
   var header = new Uint32Array(3);
   header[0] = 0xDEADBEEF;
   header[1] = wtf.version.getValue();
   header[2] = wtf.data.formats.ChunkedFileFormat.VERSION;
   transport.write(header);
+  this.byteOffset_ += header.byteLength;
 };
 goog.inherits(wtf.io.cff.BinaryStreamTarget, wtf.io.cff.StreamTarget);
 
@@ -57,8 +96,25 @@ wtf.io.cff.BinaryStreamTarget.prototype.writeChunk = function(chunk) {
   var parts = chunk.getParts();
   var partOffsets = new Array(parts.length);
   var partLengths = new Array(parts.length);
+  var partTypes = new Array(parts.length);
   for (var n = 0; n < parts.length; n++) {
-    var blobData = parts[n].toBlobData();
+    var part = parts[n];
+    partTypes[n] = part.getType();
+    var blobData = null;
+    if (this.eventBufferCodec_ &&
+        partTypes[n] == wtf.io.cff.PartType.BINARY_EVENT_BUFFER) {
+      // Parts are reused by sessions, so the encoded data is written in place
+      // of the part data without changing the part itself.
+      var bufferView = /** @type {!wtf.io.cff.parts.BinaryEventBufferPart} */ (
+          part).getValue();
+      blobData = bufferView ? this.eventBufferCodec_.encode(bufferView) : null;
+      if (blobData) {
+        partTypes[n] = wtf.io.cff.PartType.COMPRESSED_EVENT_BUFFER;
+      }
+    }
+    if (!blobData) {
+      blobData = part.toBlobData();
+    }
     var partLength;
     if (blobData instanceof ArrayBuffer ||
         blobData.buffer instanceof ArrayBuffer) {
@@ -98,8 +154,7 @@ wtf.io.cff.BinaryStreamTarget.prototype.writeChunk = function(chunk) {
   header[o++] = chunk.getEndTime();
   header[o++] = parts.length;
   for (var n = 0; n < parts.length; n++) {
-    var part = parts[n];
-    header[o++] = wtf.io.cff.PartType.toInteger(part.getType());
+    header[o++] = wtf.io.cff.PartType.toInteger(partTypes[n]);
     header[o++] = partOffsets[n];
     header[o++] = partLengths[n];
   }
@@ -113,16 +168,60 @@ wtf.io.cff.BinaryStreamTarget.prototype.writeChunk = function(chunk) {
     totalLength += padLength;
   }
 
+  // Track the chunk so it can be found in the index.
+  if (this.indexEntries_ &&
+      chunk.getType() != wtf.io.cff.ChunkType.CHUNK_INDEX) {
+    this.indexEntries_.push({
+      chunkId: chunk.getId(),
+      chunkType: chunk.getType(),
+      offset: this.byteOffset_,
+      length: totalLength,
+      startTime: wtf.io.cff.BinaryStreamTarget.getFirstEventTime_(chunk)
+    });
+  }
+  this.byteOffset_ += totalLength;
+
   // Concat all the parts together.
   var blob = wtf.io.Blob.create(blobParts);
   transport.write(blob);
 };
 
 
+/**
+ * Gets the time of the first event in an event data chunk.
+ * @param {!wtf.io.cff.Chunk} chunk Chunk.
+ * @return {number} Time of the first event, in raw units, or
+ *     {@see wtf.io.cff.Chunk.INVALID_TIME} if unknown.
+ * @private
+ */
+wtf.io.cff.BinaryStreamTarget.getFirstEventTime_ = function(chunk) {
+  if (chunk.getType() != wtf.io.cff.ChunkType.EVENT_DATA) {
+    return chunk.getStartTime();
+  }
+  var eventDataChunk = /** @type {!wtf.io.cff.chunks.EventDataChunk} */ (
+      chunk);
+  var part = eventDataChunk.getEventData();
+  if (part.getType() != wtf.io.cff.PartType.BINARY_EVENT_BUFFER) {
+    return chunk.getStartTime();
+  }
+  var bufferView = /** @type {!wtf.io.cff.parts.BinaryEventBufferPart} */ (
+      part).getValue();
+  if (!bufferView || wtf.io.BufferView.getOffset(bufferView) < 8) {
+    return wtf.io.cff.Chunk.INVALID_TIME;
+  }
+  return bufferView['uint32Array'][1];
+};
+
+
 /**
  * @override
  */
 wtf.io.cff.BinaryStreamTarget.prototype.end = function() {
-  // TODO(benvanik): add a footer here? May be nice to have total chunk count
-  //     or a chunk table/etc to help loaders.
+  // Write the chunk index last so that its footer ends the file.
+  if (this.indexEntries_ && this.indexEntries_.length) {
+    var indexChunk = new wtf.io.cff.chunks.ChunkIndexChunk();
+    indexChunk.init(this.indexEntries_, this.byteOffset_);
+    this.writeChunk(indexChunk);
+    this.indexEntries_ = [];
+  }
 };
@@ -0,0 +1,220 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/**
+ * @fileoverview Chunk index chunk.
+ *
+ * @author benvanik@google.com (Ben Vanik)
+ */
+
+goog.provide('wtf.io.cff.chunks.ChunkIndexChunk');
+
+goog.require('goog.asserts');
+goog.require('wtf.io.cff.Chunk');
+goog.require('wtf.io.cff.ChunkType');
+goog.require('wtf.io.cff.PartType');
+goog.require('wtf.io.cff.parts.BinaryResourcePart');
+
+
+
+/**
+ * A chunk listing the location of all other chunks in the file.
+ * This is written as the last chunk in binary files so that readers can seek
+ * to chunks without parsing the whole file. The last two words of the file
+ * are the byte offset of this chunk followed by
+ * {@see wtf.io.cff.chunks.ChunkIndexChunk.FOOTER_MAGIC}.
+ *
+ * Index data layout (uint32 words):
+ *   entryCount
+ *   entries: chunkId, chunkType, byteOffset, byteLength, startTime
+ *   indexChunkOffset
+ *   FOOTER_MAGIC
+ *
+ * @param {number=} opt_chunkId File-unique chunk ID.
+ * @constructor
+ * @extends {wtf.io.cff.Chunk}
+ */
+wtf.io.cff.chunks.ChunkIndexChunk = function(opt_chunkId) {
+  goog.base(this, opt_chunkId, wtf.io.cff.ChunkType.CHUNK_INDEX);
+
+  /**
+   * Index entries, in file order.
+   * @type {!Array.<!wtf.io.cff.chunks.ChunkIndexChunk.Entry>}
+   * @private
+   */
+  this.entries_ = [];
+
+  /**
+   * Byte offset of this chunk in the file.
+   * @type {number}
+   * @private
+   */
+  this.offset_ = 0;
+};
+goog.inherits(wtf.io.cff.chunks.ChunkIndexChunk, wtf.io.cff.Chunk);
+
+
+/**
+ * Index entry.
+ * Times are in the raw units of the event data (microseconds) and are the
+ * time of the first event in the chunk, or {@see wtf.io.cff.Chunk.INVALID_TIME}
+ * if the chunk contains no events.
+ * @typedef {{
+ *   chunkId: number,
+ *   chunkType: wtf.io.cff.ChunkType,
+ *   offset: number,
+ *   length: number,
+ *   startTime: number
+ * }}
+ */
+wtf.io.cff.chunks.ChunkIndexChunk.Entry;
+
+
+/**
+ * Magic value marking the end of a file with a chunk index.
+ * @const
+ * @type {number}
+ */
+wtf.io.cff.chunks.ChunkIndexChunk.FOOTER_MAGIC = 0x1DEC5CFF;
+
+
+/**
+ * Size of the file footer, in bytes.
+ * @const
+ * @type {number}
+ */
+wtf.io.cff.chunks.ChunkIndexChunk.FOOTER_LENGTH = 8;
+
+
+/**
+ * Number of words in each entry.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.io.cff.chunks.ChunkIndexChunk.ENTRY_WORDS_ = 5;
+
+
+/**
+ * Reads the index chunk offset from the footer at the end of a file.
+ * @param {!Uint32Array} footer Last
+ *     {@see wtf.io.cff.chunks.ChunkIndexChunk.FOOTER_LENGTH} bytes of the file.
+ * @return {number} Byte offset of the index chunk or -1 if the file has no
+ *     index.
+ */
+wtf.io.cff.chunks.ChunkIndexChunk.readFooter = function(footer) {
+  if (footer.length != 2 ||
+      footer[1] != wtf.io.cff.chunks.ChunkIndexChunk.FOOTER_MAGIC) {
+    return -1;
+  }
+  return footer[0];
+};
+
+
+/**
+ * @override
+ */
+wtf.io.cff.chunks.ChunkIndexChunk.prototype.load = function(parts) {
+  goog.asserts.assert(!this.entries_.length);
+
+  var data = null;
+  for (var n = 0; n < parts.length; n++) {
+    var part = parts[n];
+    this.addPart(part);
+    switch (part.getType()) {
+      case wtf.io.cff.PartType.BINARY_RESOURCE:
+        data = /** @type {!wtf.io.cff.parts.BinaryResourcePart} */ (
+            part).getValue();
+        break;
+      default:
+        goog.asserts.fail('Unknown part type: ' + part.getType());
+        throw new Error('Unknown part type ' + part.getType() + ' in chunk.');
+    }
+  }
+
+  if (!data || !data.buffer) {
+    throw new Error('No index data found in chunk index chunk.');
+  }
+  // Resource data is cloned when loaded and so always 4b aligned.
+  var words = new Uint32Array(data.buffer, data.byteOffset,
+      data.byteLength >> 2);
+  this.entries_ = wtf.io.cff.chunks.ChunkIndexChunk.parseEntries(words);
+  this.offset_ = words[words.length - 2];
+};
+
+
+/**
+ * Parses index entries from index data.
+ * @param {!Uint32Array} words Index data.
+ * @return {!Array.<!wtf.io.cff.chunks.ChunkIndexChunk.Entry>} Entries.
+ */
+wtf.io.cff.chunks.ChunkIndexChunk.parseEntries = function(words) {
+  var entryWords = wtf.io.cff.chunks.ChunkIndexChunk.ENTRY_WORDS_;
+  var count = words.length ? words[0] : 0;
+  if (words.length < 1 + count * entryWords + 2) {
+    throw new Error('Chunk index truncated.');
+  }
+  var entries = new Array(count);
+  for (var n = 0, o = 1; n < count; n++, o += entryWords) {
+    entries[n] = {
+      chunkId: words[o + 0],
+      chunkType: wtf.io.cff.ChunkType.fromInteger(words[o + 1]),
+      offset: words[o + 2],
+      length: words[o + 3],
+      startTime: words[o + 4]
+    };
+  }
+  return entries;
+};
+
+
+/**
+ * Initializes the chunk with the given entries.
+ * @param {!Array.<!wtf.io.cff.chunks.ChunkIndexChunk.Entry>} entries Entries,
+ *     in file order.
+ * @param {number} offset Byte offset this chunk will be written at.
+ */
+wtf.io.cff.chunks.ChunkIndexChunk.prototype.init = function(entries, offset) {
+  this.entries_ = entries;
+  this.offset_ = offset;
+
+  var entryWords = wtf.io.cff.chunks.ChunkIndexChunk.ENTRY_WORDS_;
+  var words = new Uint32Array(1 + entries.length * entryWords + 2);
+  words[0] = entries.length;
+  for (var n = 0, o = 1; n < entries.length; n++, o += entryWords) {
+    var entry = entries[n];
+    words[o + 0] = entry.chunkId;
+    words[o + 1] = wtf.io.cff.ChunkType.toInteger(entry.chunkType);
+    words[o + 2] = entry.offset;
+    words[o + 3] = entry.length;
+    words[o + 4] = entry.startTime;
+  }
+  words[o++] = offset;
+  words[o++] = wtf.io.cff.chunks.ChunkIndexChunk.FOOTER_MAGIC;
+
+  this.removeAllParts();
+  this.addPart(new wtf.io.cff.parts.BinaryResourcePart(
+      new Uint8Array(words.buffer)));
+};
+
+
+/**
+ * Gets the index entries, in file order.
+ * @return {!Array.<!wtf.io.cff.chunks.ChunkIndexChunk.Entry>} Entries.
+ */
+wtf.io.cff.chunks.ChunkIndexChunk.prototype.getEntries = function() {
+  return this.entries_;
+};
+
+
+/**
+ * Gets the byte offset of this chunk in the file.
+ * @return {number} Byte offset.
+ */
+wtf.io.cff.chunks.ChunkIndexChunk.prototype.getOffset = function() {
+  return this.offset_;
+};
@@ -0,0 +1,54 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+goog.provide('wtf.io.cff.chunks.ChunkIndexChunk_test');
+
+goog.require('wtf.io.cff.ChunkType');
+goog.require('wtf.io.cff.chunks.ChunkIndexChunk');
+goog.require('wtf.io.cff.parts.BinaryResourcePart');
+
+
+/**
+ * wtf.io.cff.chunks.ChunkIndexChunk testing.
+ */
+wtf.io.cff.chunks.ChunkIndexChunk_test =
+    suite('wtf.io.cff.chunks.ChunkIndexChunk', function() {
+  test('roundtrip', function() {
+    var entries = [
+      {
+        chunkId: 1,
+        chunkType: wtf.io.cff.ChunkType.FILE_HEADER,
+        offset: 12,
+        length: 100,
+        startTime: 0xFFFFFFFF
+      },
+      {
+        chunkId: 2,
+        chunkType: wtf.io.cff.ChunkType.EVENT_DATA,
+        offset: 112,
+        length: 4096,
+        startTime: 5000
+      }
+    ];
+    var chunk = new wtf.io.cff.chunks.ChunkIndexChunk();
+    chunk.init(entries, 4208);
+
+    // The data must end with the footer.
+    var data = chunk.getParts()[0].toBlobData();
+    var footer = new Uint32Array(data.buffer, data.byteLength - 8, 2);
+    assert.equal(wtf.io.cff.chunks.ChunkIndexChunk.readFooter(footer), 4208);
+    assert.equal(wtf.io.cff.chunks.ChunkIndexChunk.readFooter(
+        new Uint32Array(2)), -1);
+
+    var part = new wtf.io.cff.parts.BinaryResourcePart();
+    part.initFromBlobData(data);
+    var loaded = new wtf.io.cff.chunks.ChunkIndexChunk();
+    loaded.load([part]);
+    assert.deepEqual(loaded.getEntries(), entries);
+    assert.equal(loaded.getOffset(), 4208);
+  });
+});
@@ -159,6 +159,25 @@ wtf.io.cff.chunks.EventDataChunk.prototype.init = function(bufferSize) {
 };
 
 
+/**
+ * Initializes an event data chunk to use the given buffer view.
+ * The chunk references the buffer view and its string table directly.
+ * @param {!wtf.io.BufferView.Type} bufferView Event data buffer.
+ */
+wtf.io.cff.chunks.EventDataChunk.prototype.initWithBuffer = function(
+    bufferView) {
+  this.eventBufferPart_ =
+      new wtf.io.cff.parts.BinaryEventBufferPart(bufferView);
+  this.stringTablePart_ = new wtf.io.cff.parts.StringTablePart(
+      wtf.io.BufferView.getStringTable(bufferView));
+  this.resourceParts_ = [];
+
+  this.removeAllParts();
+  this.addPart(this.stringTablePart_);
+  this.addPart(this.eventBufferPart_);
+};
+
+
 /**
  * Gets the event data buffer part.
  * The buffer must have been initialized prior to calling this function,
@@ -214,11 +233,21 @@ wtf.io.cff.chunks.EventDataChunk.prototype.addResource = function(data) {
  * @return {wtf.io.BlobData} Resource, if found.
  */
 wtf.io.cff.chunks.EventDataChunk.prototype.getResource = function(id) {
-  var part = this.resourceParts_[id];
+  var part = this.resourceParts_[id - 1];
   return part ? part.getValue() : null;
 };
 
 
+/**
+ * Gets the number of embedded resources in the chunk.
+ * Resource IDs run from 1 to this value, in the order they were added.
+ * @return {number} Resource count.
+ */
+wtf.io.cff.chunks.EventDataChunk.prototype.getResourceCount = function() {
+  return this.resourceParts_.length;
+};
+
+
 /**
  * Resets all data stored in the chunk.
  */
@@ -26,6 +26,8 @@ wtf.io.cff.ChunkType = {
   FILE_HEADER: 'file_header',
   /** {@see wtf.io.cff.chunks.EventDataChunk} */
   EVENT_DATA: 'event_data',
+  /** {@see wtf.io.cff.chunks.ChunkIndexChunk} */
+  CHUNK_INDEX: 'chunk_index',
 
   UNKNOWN: 'unknown_type'
 };
@@ -40,6 +42,7 @@ wtf.io.cff.ChunkType.isValid = function(value) {
   switch (value) {
     case wtf.io.cff.ChunkType.FILE_HEADER:
     case wtf.io.cff.ChunkType.EVENT_DATA:
+    case wtf.io.cff.ChunkType.CHUNK_INDEX:
       return true;
   }
   return false;
@@ -55,6 +58,7 @@ wtf.io.cff.ChunkType.isValid = function(value) {
 wtf.io.cff.IntegerChunkType_ = {
   FILE_HEADER: 0x1,
   EVENT_DATA: 0x2,
+  CHUNK_INDEX: 0x3,
 
   UNKNOWN: -1
 };
@@ -71,6 +75,8 @@ wtf.io.cff.ChunkType.toInteger = function(value) {
       return wtf.io.cff.IntegerChunkType_.FILE_HEADER;
     case wtf.io.cff.ChunkType.EVENT_DATA:
       return wtf.io.cff.IntegerChunkType_.EVENT_DATA;
+    case wtf.io.cff.ChunkType.CHUNK_INDEX:
+      return wtf.io.cff.IntegerChunkType_.CHUNK_INDEX;
     default:
       goog.asserts.fail('Unknown chunk type: ' + value);
       return wtf.io.cff.IntegerChunkType_.UNKNOWN;
@@ -80,6 +86,8 @@ wtf.io.cff.ChunkType.toInteger = function(value) {
 
 /**
  * Converts a chunk type integer to an enum value.
+ * Types added in later versions are returned as
+ * {@see wtf.io.cff.ChunkType#UNKNOWN} so that readers can skip them.
  * @param {number} value Chunk type integer value.
  * @return {wtf.io.cff.ChunkType} Enum value.
  */
@@ -89,8 +97,9 @@ wtf.io.cff.ChunkType.fromInteger = function(value) {
       return wtf.io.cff.ChunkType.FILE_HEADER;
     case wtf.io.cff.IntegerChunkType_.EVENT_DATA:
       return wtf.io.cff.ChunkType.EVENT_DATA;
+    case wtf.io.cff.IntegerChunkType_.CHUNK_INDEX:
+      return wtf.io.cff.ChunkType.CHUNK_INDEX;
     default:
-      goog.asserts.fail('Unknown chunk type: ' + value);
       return wtf.io.cff.ChunkType.UNKNOWN;
   }
 };
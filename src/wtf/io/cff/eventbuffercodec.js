@@ -0,0 +1,407 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/**
+ * @fileoverview Compressed event buffer encoding.
+ * Binary event buffers store each event as 32-bit words: the wire ID, the
+ * absolute time, and the argument words. The compressed encoding stores the
+ * wire ID and argument word count as varints, the time as a zigzag varint
+ * delta from the previous event, and each argument word as a zigzag varint.
+ * The result may optionally be deflated.
+ *
+ * Decoding reproduces the original words exactly and requires no knowledge of
+ * the event types. Encoding needs to know how many argument words each event
+ * has, so the encoder tracks event definitions as they pass through it. This
+ * means a single encoder must see all chunks of a stream in order.
+ *
+ * Format:
+ *   uint8 flags ({@see wtf.io.cff.EventBufferCodec.Flag_})
+ *   (optionally deflated from here on)
+ *   varint byteLength
+ *   events, until byteLength bytes of words have been decoded:
+ *     varint wireId
+ *     zigzag varint time delta
+ *     varint argument word count
+ *     zigzag varint words
+ *
+ * @author benvanik@google.com (Ben Vanik)
+ */
+
+goog.provide('wtf.io.cff.EventBufferCodec');
+
+goog.require('goog.async.Deferred');
+goog.require('wtf');
+goog.require('wtf.data.Variable');
+goog.require('wtf.io.BufferView');
+
+
+
+/**
+ * Event buffer encoder.
+ * @param {wtf.io.cff.EventBufferCodec.Mode} mode Compression mode.
+ * @constructor
+ */
+wtf.io.cff.EventBufferCodec = function(mode) {
+  /**
+   * Whether to deflate encoded data.
+   * This is ignored if no synchronous deflate implementation is available.
+   * @type {boolean}
+   * @private
+   */
+  this.deflate_ = mode == wtf.io.cff.EventBufferCodec.Mode.DEFLATE &&
+      !!wtf.io.cff.EventBufferCodec.getZlib_();
+
+  /**
+   * Argument layouts by wire ID, as defined by event definition events.
+   * Each layout is a list of {@see wtf.io.cff.EventBufferCodec.ArgKind_}.
+   * @type {!Array.<Array.<number>>}
+   * @private
+   */
+  this.layouts_ = [];
+  this.layouts_[wtf.io.cff.EventBufferCodec.DEFINE_WIRE_ID_] =
+      wtf.io.cff.EventBufferCodec.parseLayout(
+          wtf.io.cff.EventBufferCodec.DEFINE_ARGS_);
+
+  /**
+   * Scratch space for encoding, grown as needed.
+   * @type {!Uint8Array}
+   * @private
+   */
+  this.scratch_ = new Uint8Array(0);
+};
+
+
+/**
+ * Compression mode.
+ * @enum {string}
+ */
+wtf.io.cff.EventBufferCodec.Mode = {
+  /**
+   * No compression, event buffers are written as raw binary parts.
+   */
+  NONE: 'none',
+
+  /**
+   * Delta and varint encoding.
+   */
+  DELTA: 'delta',
+
+  /**
+   * Delta and varint encoding followed by deflate, where supported.
+   */
+  DEFLATE: 'deflate'
+};
+
+
+/**
+ * Flag bits in the first byte of encoded data.
+ * @enum {number}
+ * @private
+ */
+wtf.io.cff.EventBufferCodec.Flag_ = {
+  DEFLATED: 1 << 0
+};
+
+
+/**
+ * Argument word layout kinds.
+ * @enum {number}
+ * @private
+ */
+wtf.io.cff.EventBufferCodec.ArgKind_ = {
+  // A single word.
+  WORD: 0,
+  // A length word followed by packed 8-bit elements.
+  ARRAY8: 1,
+  // A length word followed by packed 16-bit elements.
+  ARRAY16: 2,
+  // A length word followed by 32-bit elements.
+  ARRAY32: 3
+};
+
+
+/**
+ * Wire ID of the event definition event.
+ * This is the only event implicitly defined by the format.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.io.cff.EventBufferCodec.DEFINE_WIRE_ID_ = 1;
+
+
+/**
+ * Argument signature of the event definition event.
+ * @const
+ * @type {string}
+ * @private
+ */
+wtf.io.cff.EventBufferCodec.DEFINE_ARGS_ =
+    'uint16 wireId, uint16 eventClass, uint32 flags, ascii name, ascii args';
+
+
+/**
+ * Gets the node zlib module, if running under node.
+ * @return {NodeZlibModule} Zlib module, if available.
+ * @private
+ */
+wtf.io.cff.EventBufferCodec.getZlib_ = function() {
+  if (!wtf.NODE) {
+    return null;
+  }
+  return /** @type {!NodeZlibModule} */ (require('zlib'));
+};
+
+
+/**
+ * Parses an argument signature into a word layout.
+ * @param {string?} argString Argument signature string.
+ * @return {Array.<number>} Layout, or null if an argument type is unknown.
+ */
+wtf.io.cff.EventBufferCodec.parseLayout = function(argString) {
+  var layout = [];
+  if (!argString) {
+    return layout;
+  }
+  var argMap = wtf.data.Variable.parseSignatureArguments(argString);
+  for (var n = 0; n < argMap.length; n++) {
+    switch (argMap[n].variable.typeName) {
+      case 'int8[]':
+      case 'uint8[]':
+      case 'char[]':
+        layout.push(wtf.io.cff.EventBufferCodec.ArgKind_.ARRAY8);
+        break;
+      case 'int16[]':
+      case 'uint16[]':
+      case 'wchar[]':
+        layout.push(wtf.io.cff.EventBufferCodec.ArgKind_.ARRAY16);
+        break;
+      case 'int32[]':
+      case 'uint32[]':
+      case 'float32[]':
+        layout.push(wtf.io.cff.EventBufferCodec.ArgKind_.ARRAY32);
+        break;
+      default:
+        if (argMap[n].variable.typeName.indexOf('[]') != -1) {
+          return null;
+        }
+        layout.push(wtf.io.cff.EventBufferCodec.ArgKind_.WORD);
+        break;
+    }
+  }
+  return layout;
+};
+
+
+/**
+ * Finds the end of an event in a binary event buffer.
+ * @param {!(Uint32Array|Int32Array)} words Event buffer words.
+ * @param {number} o Word offset of the event.
+ * @param {number} wordCount Number of used words in the buffer.
+ * @param {!Array.<number>} layout Argument layout of the event, as returned
+ *     from {@see #parseLayout}.
+ * @return {number} Word offset following the event, or -1 if the event is
+ *     truncated.
+ */
+wtf.io.cff.EventBufferCodec.findEventEnd = function(
+    words, o, wordCount, layout) {
+  var end = o + 2;
+  for (var n = 0; n < layout.length && end < wordCount; n++) {
+    var kind = layout[n];
+    var length = words[end++] | 0;
+    if (kind == wtf.io.cff.EventBufferCodec.ArgKind_.WORD || length <= 0) {
+      continue;
+    }
+    switch (kind) {
+      case wtf.io.cff.EventBufferCodec.ArgKind_.ARRAY8:
+        end += (length + 3) >> 2;
+        break;
+      case wtf.io.cff.EventBufferCodec.ArgKind_.ARRAY16:
+        end += (length + 1) >> 1;
+        break;
+      case wtf.io.cff.EventBufferCodec.ArgKind_.ARRAY32:
+        end += length;
+        break;
+    }
+  }
+  if (end > wordCount || n < layout.length) {
+    return -1;
+  }
+  return end;
+};
+
+
+/**
+ * Encodes the used portion of a binary event buffer.
+ * @param {!wtf.io.BufferView.Type} bufferView Event buffer.
+ * @return {Uint8Array} Encoded data, or null if the buffer could not be
+ *     encoded (such as if it references events this encoder has not seen
+ *     defined). Callers should write the raw buffer instead.
+ */
+wtf.io.cff.EventBufferCodec.prototype.encode = function(bufferView) {
+  var byteLength = wtf.io.BufferView.getOffset(bufferView);
+  var words = bufferView['uint32Array'];
+  var stringTable = wtf.io.BufferView.getStringTable(bufferView);
+  var wordCount = byteLength >> 2;
+
+  // Worst case is 5 bytes per word plus the per-event overhead.
+  var maxLength = 1 + 5 + wordCount * 5 + (wordCount >> 1) * 5;
+  if (this.scratch_.length < maxLength) {
+    this.scratch_ = new Uint8Array(maxLength);
+  }
+  var out = this.scratch_;
+  var p = 1;
+
+  function writeVarUint(value) {
+    value >>>= 0;
+    while (value >= 0x80) {
+      out[p++] = (value & 0x7F) | 0x80;
+      value >>>= 7;
+    }
+    out[p++] = value;
+  };
+  function writeVarInt(value) {
+    writeVarUint((value << 1) ^ (value >> 31));
+  };
+
+  writeVarUint(byteLength);
+
+  var layouts = this.layouts_;
+  var lastTime = 0;
+  var o = 0;
+  while (o < wordCount) {
+    var wireId = words[o];
+    var time = words[o + 1];
+    var layout = layouts[wireId];
+    if (!layout) {
+      return null;
+    }
+
+    // Walk the layout to find the end of the event.
+    var end = wtf.io.cff.EventBufferCodec.findEventEnd(
+        words, o, wordCount, layout);
+    if (end == -1) {
+      // Truncated or corrupt.
+      return null;
+    }
+
+    // Track new event definitions so that later events can be encoded.
+    if (wireId == wtf.io.cff.EventBufferCodec.DEFINE_WIRE_ID_) {
+      layouts[words[o + 2] & 0xFFFF] = wtf.io.cff.EventBufferCodec.parseLayout(
+          stringTable.getString(words[o + 6]));
+    }
+
+    writeVarUint(wireId);
+    writeVarInt((time - lastTime) | 0);
+    lastTime = time;
+    writeVarUint(end - o - 2);
+    for (var i = o + 2; i < end; i++) {
+      writeVarInt(words[i] | 0);
+    }
+    o = end;
+  }
+
+  var result = out.subarray(1, p);
+  var flags = 0;
+  if (this.deflate_) {
+    var zlib = wtf.io.cff.EventBufferCodec.getZlib_();
+    var deflated = zlib.deflateRawSync(result);
+    result = new Uint8Array(
+        deflated.buffer, deflated.byteOffset, deflated.length);
+    flags |= wtf.io.cff.EventBufferCodec.Flag_.DEFLATED;
+  }
+
+  var data = new Uint8Array(1 + result.length);
+  data[0] = flags;
+  data.set(result, 1);
+  return data;
+};
+
+
+/**
+ * Decodes data produced by {@see #encode}.
+ * @param {!Uint8Array} data Encoded data.
+ * @return {!Uint8Array|!goog.async.Deferred} Raw event buffer bytes, or a
+ *     deferred that will be called back with them if decoding is
+ *     asynchronous.
+ */
+wtf.io.cff.EventBufferCodec.decode = function(data) {
+  var payload = data.subarray(1);
+  if (!(data[0] & wtf.io.cff.EventBufferCodec.Flag_.DEFLATED)) {
+    return wtf.io.cff.EventBufferCodec.decodeEvents_(payload);
+  }
+
+  // Node can inflate synchronously.
+  var zlib = wtf.io.cff.EventBufferCodec.getZlib_();
+  if (zlib) {
+    var inflated = zlib.inflateRawSync(payload);
+    return wtf.io.cff.EventBufferCodec.decodeEvents_(new Uint8Array(
+        inflated.buffer, inflated.byteOffset, inflated.length));
+  }
+
+  // Browsers can only inflate asynchronously.
+  var DecompressionStream = goog.global['DecompressionStream'];
+  if (!DecompressionStream) {
+    throw new Error('Deflated event data is not supported by this browser.');
+  }
+  var deferred = new goog.async.Deferred();
+  var response = new goog.global['Response'](
+      new Blob([payload])['stream']()['pipeThrough'](
+          new DecompressionStream('deflate-raw')));
+  response['arrayBuffer']()['then'](function(arrayBuffer) {
+    deferred.callback(wtf.io.cff.EventBufferCodec.decodeEvents_(
+        new Uint8Array(arrayBuffer)));
+  }, function(e) {
+    deferred.errback(e);
+  });
+  return deferred;
+};
+
+
+/**
+ * Decodes delta and varint encoded events.
+ * @param {!Uint8Array} data Encoded data, after the flags byte.
+ * @return {!Uint8Array} Raw event buffer bytes.
+ * @private
+ */
+wtf.io.cff.EventBufferCodec.decodeEvents_ = function(data) {
+  var p = 0;
+  function readVarUint() {
+    var value = 0;
+    var shift = 0;
+    var b;
+    do {
+      b = data[p++];
+      value += (b & 0x7F) * Math.pow(2, shift);
+      shift += 7;
+    } while (b & 0x80);
+    return value;
+  };
+  function readVarInt() {
+    var value = readVarUint();
+    return (value % 2) ? -(value + 1) / 2 : value / 2;
+  };
+
+  var byteLength = readVarUint();
+  var words = new Uint32Array(byteLength >> 2);
+  var lastTime = 0;
+  var o = 0;
+  while (o < words.length) {
+    if (p >= data.length) {
+      throw new Error('Compressed event data truncated.');
+    }
+    words[o++] = readVarUint();
+    lastTime = (lastTime + readVarInt()) >>> 0;
+    words[o++] = lastTime;
+    var argWordCount = readVarUint();
+    for (var n = 0; n < argWordCount; n++) {
+      words[o++] = readVarInt();
+    }
+  }
+
+  return new Uint8Array(words.buffer);
+};
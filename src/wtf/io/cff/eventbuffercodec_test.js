@@ -0,0 +1,67 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+goog.provide('wtf.io.cff.EventBufferCodec_test');
+
+goog.require('wtf.io.BufferView');
+goog.require('wtf.io.cff.EventBufferCodec');
+
+
+/**
+ * wtf.io.cff.EventBufferCodec testing.
+ */
+wtf.io.cff.EventBufferCodec_test = suite('wtf.io.cff.EventBufferCodec',
+    function() {
+  function createBuffer() {
+    var bufferView = wtf.io.BufferView.createEmpty(1024);
+    var stringTable = wtf.io.BufferView.getStringTable(bufferView);
+    var words = [
+      // wtf.event#define(2, 0, 0, 'a', 'uint32 x, int8[] y')
+      1, 1000, 2, 0, 0,
+      stringTable.addString('a'), stringTable.addString('uint32 x, int8[] y'),
+      // a(7, [1, 2, 3, 4, 5])
+      2, 1005, 7, 5, 0x04030201, 0x05,
+      // a(0xFFFFFFFF, null), with time wrapping.
+      2, 0xFFFFFFF0, 0xFFFFFFFF, 0xFFFFFFFF,
+      2, 0x10, 1, 0
+    ];
+    var uint32Array = bufferView['uint32Array'];
+    for (var n = 0; n < words.length; n++) {
+      uint32Array[n] = words[n];
+    }
+    wtf.io.BufferView.setOffset(bufferView, words.length * 4);
+    return bufferView;
+  };
+
+  test('roundtrip', function() {
+    var bufferView = createBuffer();
+    var expected = wtf.io.BufferView.getUsedBytes(bufferView);
+
+    var modes = [
+      wtf.io.cff.EventBufferCodec.Mode.DELTA,
+      wtf.io.cff.EventBufferCodec.Mode.DEFLATE
+    ];
+    for (var n = 0; n < modes.length; n++) {
+      var codec = new wtf.io.cff.EventBufferCodec(modes[n]);
+      var data = codec.encode(bufferView);
+      assert.isNotNull(data);
+      var result = wtf.io.cff.EventBufferCodec.decode(data);
+      assert.instanceOf(result, Uint8Array);
+      assert.deepEqual(Array.prototype.slice.call(result),
+          Array.prototype.slice.call(expected));
+    }
+  });
+
+  test('undefinedEvent', function() {
+    var bufferView = wtf.io.BufferView.createEmpty(64);
+    bufferView['uint32Array'][0] = 5;
+    wtf.io.BufferView.setOffset(bufferView, 12);
+    var codec = new wtf.io.cff.EventBufferCodec(
+        wtf.io.cff.EventBufferCodec.Mode.DELTA);
+    assert.isNull(codec.encode(bufferView));
+  });
+});
@@ -7,6 +7,8 @@
 
 /**
  * @fileoverview JSON stream source.
+ * Data is parsed incrementally as it is received and each chunk is emitted as
+ * soon as it ends, so only a single chunk is ever held in memory.
  *
  * @author benvanik@google.com (Ben Vanik)
  */
@@ -16,6 +18,7 @@ goog.provide('wtf.io.cff.JsonStreamSource');
 goog.require('goog.asserts');
 goog.require('wtf.data.formats.ChunkedFileFormat');
 goog.require('wtf.io.DataFormat');
+goog.require('wtf.io.JsonParser');
 goog.require('wtf.io.ReadTransport');
 goog.require('wtf.io.cff.ChunkType');
 goog.require('wtf.io.cff.PartType');
@@ -40,6 +43,33 @@ wtf.io.cff.JsonStreamSource = function(transport) {
    */
   this.hasReadHeader_ = false;
 
+  /**
+   * Whether the header fields of the current JSON document have been checked.
+   * @type {boolean}
+   * @private
+   */
+  this.documentHeaderChecked_ = false;
+
+  /**
+   * Whether parsing has failed. The parser is left in an undefined state
+   * by errors, so any remaining data is ignored.
+   * @type {boolean}
+   * @private
+   */
+  this.hasFailed_ = false;
+
+  /**
+   * Incremental parser.
+   * Chunks are emitted on their own so that the document is never built.
+   * @type {!wtf.io.JsonParser}
+   * @private
+   */
+  this.parser_ = new wtf.io.JsonParser(
+      function(path) {
+        return path.length == 2 && path[0] == 'chunks' &&
+            goog.isNumber(path[1]);
+      }, this.valueParsed_, this);
+
   // We want strings.
   transport.setPreferredFormat(wtf.io.DataFormat.STRING);
 
@@ -56,19 +86,89 @@ goog.inherits(wtf.io.cff.JsonStreamSource, wtf.io.cff.StreamSource);
  */
 wtf.io.cff.JsonStreamSource.prototype.dataReceived = function(data) {
   goog.asserts.assert(typeof data == 'string');
+  if (this.hasFailed_) {
+    return;
+  }
+
+  // Data may end anywhere, including in the middle of a document. The parser
+  // calls back as chunks and documents end.
+  try {
+    this.parser_.write(data);
+  } catch (e) {
+    this.parseFailed_(e);
+  }
+};
+
+
+/**
+ * @override
+ */
+wtf.io.cff.JsonStreamSource.prototype.ended = function() {
+  if (this.hasFailed_) {
+    return;
+  }
 
-  var parsedData;
+  // The text may end inside of a document, such as a truncated trace.
   try {
-    parsedData = goog.global.JSON.parse(data);
-  } catch (parseError) {
-    var e = new Error('Unable to parse JSON stream data: ' + parseError);
-    e['innerException'] = parseError;
-    throw e;
+    this.parser_.end();
+  } catch (e) {
+    this.parseFailed_(e);
   }
-  if (!parsedData || typeof parsedData != 'object') {
+};
+
+
+/**
+ * Reports a parse failure as a stream error.
+ * The stream still ends when the transport does.
+ * @param {!Error} e Error.
+ * @private
+ */
+wtf.io.cff.JsonStreamSource.prototype.parseFailed_ = function(e) {
+  this.hasFailed_ = true;
+  this.emitErrorEvent(e);
+};
+
+
+/**
+ * Handles chunks and documents as they are parsed.
+ * Throws errors on failure.
+ * @param {!Array.<string|number>} path Value path.
+ * @param {*} value Parsed value.
+ * @private
+ */
+wtf.io.cff.JsonStreamSource.prototype.valueParsed_ = function(path, value) {
+  if (path.length) {
+    // A chunk. Header fields precede the chunks and have been parsed.
+    this.checkHeader_(this.parser_.getPartialRoot());
+    if (!value || typeof value != 'object') {
+      throw new Error('Expected chunk to be an object.');
+    }
+    this.parseChunk_(/** @type {!Object} */ (value));
+    return;
+  }
+
+  // End of a document.
+  if (!value || typeof value != 'object' || goog.isArray(value)) {
     throw new Error('Expected object at the root of the JSON object.');
   }
-  parsedData = /** @type {!Object} */ (parsedData);
+  this.checkHeader_(/** @type {!Object} */ (value));
+  this.documentHeaderChecked_ = false;
+};
+
+
+/**
+ * Parses the header in the current document, if there is one and it has not
+ * yet been parsed.
+ * Throws errors on failure.
+ * @param {Object|Array} parsedData Parsed document object, or as much of it as
+ *     has been parsed.
+ * @private
+ */
+wtf.io.cff.JsonStreamSource.prototype.checkHeader_ = function(parsedData) {
+  if (this.documentHeaderChecked_ || !parsedData) {
+    return;
+  }
+  this.documentHeaderChecked_ = true;
 
   // Check to see if this is a header block.
   if (parsedData['wtfVersion']) {
@@ -78,19 +178,7 @@ wtf.io.cff.JsonStreamSource.prototype.dataReceived = function(data) {
     }
 
     // Parse header.
-    this.parseHeader_(parsedData);
-  }
-
-  // Parse any chunks present in the object.
-  var chunks = parsedData['chunks'];
-  if (chunks && goog.isArray(chunks) && chunks.length) {
-    for (var n = 0; n < chunks.length; n++) {
-      var chunkData = chunks[n];
-      if (!chunkData || typeof chunkData != 'object') {
-        throw new Error('Expected chunk to be an object.');
-      }
-      this.parseChunk_(chunkData);
-    }
+    this.parseHeader_(/** @type {!Object} */ (parsedData));
   }
 };
 
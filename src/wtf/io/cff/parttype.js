@@ -30,6 +30,11 @@ wtf.io.cff.PartType = {
   LEGACY_EVENT_BUFFER: 'legacy_event_buffer',
   /** {@see wtf.io.cff.parts.BinaryEventBufferPart} */
   BINARY_EVENT_BUFFER: 'binary_event_buffer',
+  /**
+   * A {@see wtf.io.cff.parts.BinaryEventBufferPart} encoded with
+   * {@see wtf.io.cff.EventBufferCodec}. Only used in serialized data.
+   */
+  COMPRESSED_EVENT_BUFFER: 'compressed_event_buffer',
   /** {@see wtf.io.cff.parts.StringTablePart} */
   STRING_TABLE: 'string_table',
   /** {@see wtf.io.cff.parts.BinaryResourcePart} */
@@ -52,6 +57,7 @@ wtf.io.cff.PartType.isValid = function(value) {
     case wtf.io.cff.PartType.JSON_EVENT_BUFFER:
     case wtf.io.cff.PartType.LEGACY_EVENT_BUFFER:
     case wtf.io.cff.PartType.BINARY_EVENT_BUFFER:
+    case wtf.io.cff.PartType.COMPRESSED_EVENT_BUFFER:
     case wtf.io.cff.PartType.STRING_TABLE:
     case wtf.io.cff.PartType.BINARY_RESOURCE:
     case wtf.io.cff.PartType.STRING_RESOURCE:
@@ -72,6 +78,7 @@ wtf.io.cff.IntegerPartType_ = {
   JSON_EVENT_BUFFER: 0x20000,
   LEGACY_EVENT_BUFFER: 0x20001,
   BINARY_EVENT_BUFFER: 0x20002,
+  COMPRESSED_EVENT_BUFFER: 0x20003,
   STRING_TABLE: 0x30000,
   BINARY_RESOURCE: 0x40000,
   STRING_RESOURCE: 0x40001,
@@ -95,6 +102,8 @@ wtf.io.cff.PartType.toInteger = function(value) {
       return wtf.io.cff.IntegerPartType_.LEGACY_EVENT_BUFFER;
     case wtf.io.cff.PartType.BINARY_EVENT_BUFFER:
       return wtf.io.cff.IntegerPartType_.BINARY_EVENT_BUFFER;
+    case wtf.io.cff.PartType.COMPRESSED_EVENT_BUFFER:
+      return wtf.io.cff.IntegerPartType_.COMPRESSED_EVENT_BUFFER;
     case wtf.io.cff.PartType.STRING_TABLE:
       return wtf.io.cff.IntegerPartType_.STRING_TABLE;
     case wtf.io.cff.PartType.BINARY_RESOURCE:
@@ -123,6 +132,8 @@ wtf.io.cff.PartType.fromInteger = function(value) {
       return wtf.io.cff.PartType.LEGACY_EVENT_BUFFER;
     case wtf.io.cff.IntegerPartType_.BINARY_EVENT_BUFFER:
       return wtf.io.cff.PartType.BINARY_EVENT_BUFFER;
+    case wtf.io.cff.IntegerPartType_.COMPRESSED_EVENT_BUFFER:
+      return wtf.io.cff.PartType.COMPRESSED_EVENT_BUFFER;
     case wtf.io.cff.IntegerPartType_.STRING_TABLE:
       return wtf.io.cff.PartType.STRING_TABLE;
     case wtf.io.cff.IntegerPartType_.BINARY_RESOURCE:
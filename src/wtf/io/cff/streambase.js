@@ -17,6 +17,7 @@ goog.require('goog.asserts');
 goog.require('wtf.events.EventEmitter');
 goog.require('wtf.io.cff.ChunkType');
 goog.require('wtf.io.cff.PartType');
+goog.require('wtf.io.cff.chunks.ChunkIndexChunk');
 goog.require('wtf.io.cff.chunks.EventDataChunk');
 goog.require('wtf.io.cff.chunks.FileHeaderChunk');
 goog.require('wtf.io.cff.parts.BinaryEventBufferPart');
@@ -54,6 +55,8 @@ wtf.io.cff.StreamBase.prototype.createChunkType = function(chunkId, chunkType) {
       return new wtf.io.cff.chunks.FileHeaderChunk(chunkId);
     case wtf.io.cff.ChunkType.EVENT_DATA:
       return new wtf.io.cff.chunks.EventDataChunk(chunkId);
+    case wtf.io.cff.ChunkType.CHUNK_INDEX:
+      return new wtf.io.cff.chunks.ChunkIndexChunk(chunkId);
     default:
       goog.asserts.fail('Unhandled chunk type: ' + chunkType);
       return null;
@@ -0,0 +1,530 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/**
+ * @fileoverview Incremental JSON parser.
+ * Text can be written in pieces of any size, such as they arrive from a
+ * transport. Values at paths picked by a selector are handed out as soon as
+ * they end and are not kept, so a large document can be consumed one entry at
+ * a time without building its whole object graph.
+ *
+ * @author benvanik@google.com (Ben Vanik)
+ */
+
+goog.provide('wtf.io.JsonParser');
+
+
+
+/**
+ * Incremental JSON parser.
+ *
+ * Each value that ends at a path the selector returns true for is passed to
+ * the callback and left out of its parent. The path is a list of the object
+ * keys and array indices from the top-level value down, and is only valid
+ * during the callback. Each top-level value is passed to the callback with an
+ * empty path once it ends, less any selected descendants. Several top-level
+ * values may follow each other in the text.
+ *
+ * To support writers that cannot terminate their output, trailing commas are
+ * allowed and {@see #end} closes any arrays left open.
+ *
+ * @param {function(!Array.<string|number>):boolean} selector Returns true if
+ *     the value at the given path should be emitted on its own.
+ * @param {function(this:T, !Array.<string|number>, *)} callback Called with
+ *     the path and value of each emitted value.
+ * @param {T=} opt_scope Scope for the selector and callback.
+ * @constructor
+ * @template T
+ */
+wtf.io.JsonParser = function(selector, callback, opt_scope) {
+  /**
+   * Value selector.
+   * @type {function(!Array.<string|number>):boolean}
+   * @private
+   */
+  this.selector_ = selector;
+
+  /**
+   * Value callback.
+   * @type {function(this:T, !Array.<string|number>, *)}
+   * @private
+   */
+  this.callback_ = callback;
+
+  /**
+   * Scope for the selector and callback.
+   * @type {Object}
+   * @private
+   */
+  this.scope_ = opt_scope || null;
+
+  /**
+   * What is expected next.
+   * @type {wtf.io.JsonParser.State_}
+   * @private
+   */
+  this.state_ = wtf.io.JsonParser.State_.VALUE;
+
+  /**
+   * Open containers, outermost first.
+   * @type {!Array.<!wtf.io.JsonParser.Frame_>}
+   * @private
+   */
+  this.stack_ = [];
+
+  /**
+   * Path of the value being parsed.
+   * @type {!Array.<string|number>}
+   * @private
+   */
+  this.path_ = [];
+
+  /**
+   * Type of the token that was split by the end of the last write, if any.
+   * @type {wtf.io.JsonParser.Token_}
+   * @private
+   */
+  this.tokenType_ = wtf.io.JsonParser.Token_.NONE;
+
+  /**
+   * Text of the current token.
+   * For strings this is the raw text between the quotes.
+   * @type {string}
+   * @private
+   */
+  this.token_ = '';
+
+  /**
+   * Whether the current string token is an object key.
+   * @type {boolean}
+   * @private
+   */
+  this.tokenIsKey_ = false;
+
+  /**
+   * Whether the current string token contains escapes.
+   * @type {boolean}
+   * @private
+   */
+  this.tokenEscaped_ = false;
+
+  /**
+   * Whether the last character of the string token was a backslash.
+   * @type {boolean}
+   * @private
+   */
+  this.escapePending_ = false;
+
+  /**
+   * Number of characters written before the current write.
+   * Used for error messages.
+   * @type {number}
+   * @private
+   */
+  this.offset_ = 0;
+};
+
+
+/**
+ * Parser states.
+ * @enum {number}
+ * @private
+ */
+wtf.io.JsonParser.State_ = {
+  /** A value, or the end of an array. */
+  VALUE: 0,
+  /** An object key, or the end of an object. */
+  KEY: 1,
+  /** The colon after a key. */
+  COLON: 2,
+  /** A comma or the end of the current container. */
+  NEXT: 3
+};
+
+
+/**
+ * Token types.
+ * @enum {number}
+ * @private
+ */
+wtf.io.JsonParser.Token_ = {
+  NONE: 0,
+  STRING: 1,
+  NUMBER: 2,
+  LITERAL: 3
+};
+
+
+/**
+ * An open container.
+ * @typedef {{
+ *   value: (!Object|!Array),
+ *   isArray: boolean,
+ *   key: string,
+ *   count: number
+ * }}
+ * @private
+ */
+wtf.io.JsonParser.Frame_;
+
+
+/**
+ * Gets the top-level value being parsed, as far as it has been parsed.
+ * @return {Object|Array} Partial top-level value, if a container is open.
+ */
+wtf.io.JsonParser.prototype.getPartialRoot = function() {
+  return this.stack_.length ? this.stack_[0].value : null;
+};
+
+
+/**
+ * Parses the next piece of text.
+ * Throws errors on invalid JSON. Errors thrown by the selector or callback are
+ * passed through and leave the parser in an undefined state.
+ * @param {string} text Text.
+ */
+wtf.io.JsonParser.prototype.write = function(text) {
+  var State = wtf.io.JsonParser.State_;
+  var Token = wtf.io.JsonParser.Token_;
+  var length = text.length;
+  var i = 0;
+
+  // Continue a token split by the last write.
+  switch (this.tokenType_) {
+    case Token.STRING:
+      i = this.readString_(text, 0);
+      break;
+    case Token.NUMBER:
+      i = this.readNumber_(text, 0);
+      break;
+    case Token.LITERAL:
+      i = this.readLiteral_(text, 0);
+      break;
+  }
+
+  while (i < length) {
+    var c = text.charCodeAt(i);
+
+    // Whitespace.
+    if (c == 0x20 || c == 0x0A || c == 0x0D || c == 0x09) {
+      i++;
+      continue;
+    }
+
+    var frame = this.stack_.length ?
+        this.stack_[this.stack_.length - 1] : null;
+    switch (this.state_) {
+      case State.VALUE:
+        if (c == 0x5D /* ] */ && frame && frame.isArray) {
+          // Empty array or trailing comma.
+          this.closeContainer_();
+          i++;
+          break;
+        }
+        this.beginValue_();
+        if (c == 0x7B /* { */) {
+          this.openContainer_(false);
+          i++;
+        } else if (c == 0x5B /* [ */) {
+          this.openContainer_(true);
+          i++;
+        } else if (c == 0x22 /* " */) {
+          this.tokenType_ = Token.STRING;
+          this.tokenIsKey_ = false;
+          i = this.readString_(text, i + 1);
+        } else if (c == 0x2D /* - */ || (c >= 0x30 && c <= 0x39)) {
+          this.tokenType_ = Token.NUMBER;
+          i = this.readNumber_(text, i);
+        } else if (c >= 0x61 && c <= 0x7A) {
+          this.tokenType_ = Token.LITERAL;
+          i = this.readLiteral_(text, i);
+        } else {
+          this.fail_(text, i);
+        }
+        break;
+      case State.KEY:
+        if (c == 0x7D /* } */) {
+          // Empty object or trailing comma.
+          this.closeContainer_();
+          i++;
+        } else if (c == 0x22 /* " */) {
+          this.tokenType_ = Token.STRING;
+          this.tokenIsKey_ = true;
+          i = this.readString_(text, i + 1);
+        } else {
+          this.fail_(text, i);
+        }
+        break;
+      case State.COLON:
+        if (c != 0x3A /* : */) {
+          this.fail_(text, i);
+        }
+        this.state_ = State.VALUE;
+        i++;
+        break;
+      case State.NEXT:
+        if (c == 0x2C /* , */) {
+          this.state_ = frame.isArray ? State.VALUE : State.KEY;
+        } else if (c == (frame.isArray ? 0x5D /* ] */ : 0x7D /* } */)) {
+          this.closeContainer_();
+        } else {
+          this.fail_(text, i);
+        }
+        i++;
+        break;
+    }
+  }
+
+  this.offset_ += length;
+};
+
+
+/**
+ * Ends the text.
+ * Any token at the end of the text is completed and arrays left open are
+ * closed. Throws an error if the text ends inside of anything else.
+ */
+wtf.io.JsonParser.prototype.end = function() {
+  var State = wtf.io.JsonParser.State_;
+  var Token = wtf.io.JsonParser.Token_;
+  switch (this.tokenType_) {
+    case Token.STRING:
+      throw new Error('Unexpected end of JSON input inside of a string.');
+    case Token.NUMBER:
+    case Token.LITERAL:
+      this.completeToken_();
+      break;
+  }
+
+  while (this.stack_.length) {
+    var frame = this.stack_[this.stack_.length - 1];
+    if (!frame.isArray) {
+      throw new Error('Unexpected end of JSON input inside of an object.');
+    }
+    if (this.state_ != State.NEXT && this.state_ != State.VALUE) {
+      throw new Error('Unexpected end of JSON input.');
+    }
+    this.closeContainer_();
+  }
+};
+
+
+/**
+ * Prepares for a value starting in the current container.
+ * @private
+ */
+wtf.io.JsonParser.prototype.beginValue_ = function() {
+  var stack = this.stack_;
+  if (stack.length) {
+    var frame = stack[stack.length - 1];
+    if (frame.isArray) {
+      this.path_.push(frame.count);
+    }
+  }
+};
+
+
+/**
+ * Opens a new container.
+ * @param {boolean} isArray Whether the container is an array.
+ * @private
+ */
+wtf.io.JsonParser.prototype.openContainer_ = function(isArray) {
+  this.stack_.push({
+    value: isArray ? [] : {},
+    isArray: isArray,
+    key: '',
+    count: 0
+  });
+  this.state_ = isArray ?
+      wtf.io.JsonParser.State_.VALUE : wtf.io.JsonParser.State_.KEY;
+};
+
+
+/**
+ * Closes the current container and completes it as a value.
+ * @private
+ */
+wtf.io.JsonParser.prototype.closeContainer_ = function() {
+  var frame = this.stack_.pop();
+  this.completeValue_(frame.value);
+};
+
+
+/**
+ * Handles a value that has ended.
+ * @param {*} value Value.
+ * @private
+ */
+wtf.io.JsonParser.prototype.completeValue_ = function(value) {
+  var stack = this.stack_;
+  if (!stack.length) {
+    // Top-level value.
+    this.callback_.call(this.scope_, this.path_, value);
+    this.state_ = wtf.io.JsonParser.State_.VALUE;
+    return;
+  }
+
+  var frame = stack[stack.length - 1];
+  if (this.selector_.call(this.scope_, this.path_)) {
+    this.callback_.call(this.scope_, this.path_, value);
+  } else if (frame.isArray) {
+    frame.value.push(value);
+  } else {
+    frame.value[frame.key] = value;
+  }
+  this.path_.pop();
+  frame.count++;
+  this.state_ = wtf.io.JsonParser.State_.NEXT;
+};
+
+
+/**
+ * Completes the current token.
+ * @private
+ */
+wtf.io.JsonParser.prototype.completeToken_ = function() {
+  var Token = wtf.io.JsonParser.Token_;
+  var token = this.token_;
+  var value;
+  switch (this.tokenType_) {
+    case Token.STRING:
+      value = this.tokenEscaped_ ?
+          goog.global.JSON.parse('"' + token + '"') : token;
+      break;
+    case Token.NUMBER:
+      value = Number(token);
+      if (isNaN(value)) {
+        throw new Error('Invalid number in JSON input: ' + token);
+      }
+      break;
+    case Token.LITERAL:
+      if (token == 'true') {
+        value = true;
+      } else if (token == 'false') {
+        value = false;
+      } else if (token == 'null') {
+        value = null;
+      } else {
+        throw new Error('Invalid literal in JSON input: ' + token);
+      }
+      break;
+  }
+  this.tokenType_ = Token.NONE;
+  this.token_ = '';
+  this.tokenEscaped_ = false;
+
+  if (this.tokenIsKey_) {
+    this.tokenIsKey_ = false;
+    var frame = this.stack_[this.stack_.length - 1];
+    frame.key = /** @type {string} */ (value);
+    this.path_.push(frame.key);
+    this.state_ = wtf.io.JsonParser.State_.COLON;
+  } else {
+    this.completeValue_(value);
+  }
+};
+
+
+/**
+ * Reads string characters, completing the token at the closing quote.
+ * @param {string} text Text.
+ * @param {number} i Index of the first character to read.
+ * @return {number} Index of the first character after the string, or the
+ *     text length if the string continues past it.
+ * @private
+ */
+wtf.io.JsonParser.prototype.readString_ = function(text, i) {
+  var length = text.length;
+  var start = i;
+  while (i < length) {
+    if (this.escapePending_) {
+      this.escapePending_ = false;
+    } else {
+      var c = text.charCodeAt(i);
+      if (c == 0x5C /* \ */) {
+        this.tokenEscaped_ = true;
+        this.escapePending_ = true;
+      } else if (c == 0x22 /* " */) {
+        this.token_ += text.substring(start, i);
+        this.completeToken_();
+        return i + 1;
+      }
+    }
+    i++;
+  }
+  this.token_ += text.substring(start, length);
+  return length;
+};
+
+
+/**
+ * Reads number characters, completing the token at the first other
+ * character.
+ * @param {string} text Text.
+ * @param {number} i Index of the first character to read.
+ * @return {number} Index of the first character after the number, or the
+ *     text length if the number may continue past it.
+ * @private
+ */
+wtf.io.JsonParser.prototype.readNumber_ = function(text, i) {
+  var length = text.length;
+  var start = i;
+  while (i < length) {
+    var c = text.charCodeAt(i);
+    if ((c >= 0x30 && c <= 0x39) || c == 0x2D /* - */ || c == 0x2B /* + */ ||
+        c == 0x2E /* . */ || c == 0x65 /* e */ || c == 0x45 /* E */) {
+      i++;
+    } else {
+      this.token_ += text.substring(start, i);
+      this.completeToken_();
+      return i;
+    }
+  }
+  this.token_ += text.substring(start, length);
+  return length;
+};
+
+
+/**
+ * Reads literal characters, completing the token at the first other
+ * character.
+ * @param {string} text Text.
+ * @param {number} i Index of the first character to read.
+ * @return {number} Index of the first character after the literal, or the
+ *     text length if the literal may continue past it.
+ * @private
+ */
+wtf.io.JsonParser.prototype.readLiteral_ = function(text, i) {
+  var length = text.length;
+  var start = i;
+  while (i < length) {
+    var c = text.charCodeAt(i);
+    if (c >= 0x61 && c <= 0x7A) {
+      i++;
+    } else {
+      this.token_ += text.substring(start, i);
+      this.completeToken_();
+      return i;
+    }
+  }
+  this.token_ += text.substring(start, length);
+  return length;
+};
+
+
+/**
+ * Throws an error for an unexpected character.
+ * @param {string} text Text.
+ * @param {number} i Index of the character.
+ * @private
+ */
+wtf.io.JsonParser.prototype.fail_ = function(text, i) {
+  throw new Error(
+      'Unexpected "' + text.charAt(i) + '" at position ' +
+      (this.offset_ + i) + ' of JSON input.');
+};
@@ -0,0 +1,104 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+goog.provide('wtf.io.JsonParser_test');
+
+goog.require('wtf.io.JsonParser');
+
+
+/**
+ * wtf.io.JsonParser testing.
+ */
+wtf.io.JsonParser_test = suite('wtf.io.JsonParser', function() {
+  /**
+   * Parses text written in pieces of the given size.
+   * @param {string} text JSON text.
+   * @param {number} pieceSize Characters per write.
+   * @param {function(!Array):boolean=} opt_selector Selector.
+   * @return {!Array.<!Array>} [path, value] pairs, in emit order.
+   */
+  function parse(text, pieceSize, opt_selector) {
+    var results = [];
+    var parser = new wtf.io.JsonParser(
+        opt_selector || function() { return false; },
+        function(path, value) {
+          results.push([path.slice(), value]);
+        });
+    for (var n = 0; n < text.length; n += pieceSize) {
+      parser.write(text.substr(n, pieceSize));
+    }
+    parser.end();
+    return results;
+  };
+
+  test('values', function() {
+    var value = {
+      'a': [1, -2.5, 3e2, true, false, null],
+      'b': 'x\\"y\né',
+      'c': {},
+      'd': [[], [{}]]
+    };
+    var text = goog.global.JSON.stringify(value);
+    for (var pieceSize = 1; pieceSize <= text.length; pieceSize++) {
+      assert.deepEqual(parse(text, pieceSize), [[[], value]]);
+    }
+    assert.deepEqual(parse(' 42 ', 1), [[[], 42]]);
+  });
+
+  test('selected', function() {
+    var text = '{"v": 1, "chunks": [{"id": 0}, {"id": 1, "x": [2]}], "w": 2}';
+    var selector = function(path) {
+      return path.length == 2 && path[0] == 'chunks';
+    };
+    for (var pieceSize = 1; pieceSize <= 4; pieceSize++) {
+      assert.deepEqual(parse(text, pieceSize, selector), [
+        [['chunks', 0], {'id': 0}],
+        [['chunks', 1], {'id': 1, 'x': [2]}],
+        [[], {'v': 1, 'chunks': [], 'w': 2}]
+      ]);
+    }
+
+    // The partial root has the members that have ended.
+    var parser = new wtf.io.JsonParser(selector, function(path, value) {
+      if (path.length) {
+        assert.deepEqual(parser.getPartialRoot(), {'v': 1});
+      }
+    });
+    parser.write(text);
+    parser.end();
+    assert.isNull(parser.getPartialRoot());
+  });
+
+  test('sequences', function() {
+    // Several documents and unterminated arrays with trailing commas.
+    assert.deepEqual(parse('{"a": 1}\n{"b": 2}\n', 3), [
+      [[], {'a': 1}],
+      [[], {'b': 2}]
+    ]);
+    assert.deepEqual(parse('[{"a": 1}, {"b": [2,]},', 2), [
+      [[], [{'a': 1}, {'b': [2]}]]
+    ]);
+  });
+
+  test('errors', function() {
+    assert.throws(function() {
+      parse('{"a" 1}', 1);
+    });
+    assert.throws(function() {
+      parse('[1, 2}', 1);
+    });
+    assert.throws(function() {
+      parse('{"a": 1', 1);
+    }, /inside of an object/);
+    assert.throws(function() {
+      parse('["abc', 1);
+    });
+    assert.throws(function() {
+      parse('[nul]', 1);
+    });
+  });
+});
@@ -0,0 +1,627 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/**
+ * @fileoverview Shared memory ring of event buffers.
+ * A ring is a single SharedArrayBuffer holding a control block, a double
+ * buffered header region, and a fixed number of equally sized slots. One
+ * writer (usually a worker) fills slots and publishes them by advancing the
+ * head index while one reader (usually the page) reads published slots in
+ * place.
+ *
+ * The writer never blocks. If the ring is full it overwrites the oldest slot
+ * by advancing the tail index, unless the reader has locked the tail in which
+ * case the writer drops the slot and the session records a discontinuity.
+ *
+ * Each slot region holds the event data followed by the UTF-8 contents of its
+ * string table, which is written when the slot is published.
+ *
+ * @author benvanik@google.com (Ben Vanik)
+ */
+
+goog.provide('wtf.io.SharedRing');
+
+goog.require('goog.asserts');
+goog.require('goog.crypt');
+goog.require('wtf.io.BufferView');
+goog.require('wtf.io.StringTable');
+
+
+
+/**
+ * Shared memory ring.
+ * Use {@see #create} to allocate a new ring or pass an existing buffer (such as
+ * one received from another thread) to wrap it.
+ *
+ * @param {!ArrayBuffer} buffer SharedArrayBuffer previously created by
+ *     {@see #create}.
+ * @constructor
+ */
+wtf.io.SharedRing = function(buffer) {
+  /**
+   * Shared backing buffer.
+   * @type {!ArrayBuffer}
+   * @private
+   */
+  this.buffer_ = buffer;
+
+  /**
+   * Control block.
+   * @type {!Int32Array}
+   * @private
+   */
+  this.control_ = new Int32Array(buffer, 0,
+      wtf.io.SharedRing.Control_.SLOT_META + wtf.io.SharedRing.MAX_SLOTS_ *
+          wtf.io.SharedRing.SlotMeta_.STRIDE);
+  goog.asserts.assert(
+      this.control_[wtf.io.SharedRing.Control_.MAGIC] ==
+      wtf.io.SharedRing.MAGIC_);
+
+  /**
+   * Bytes view over the entire buffer, used for string data.
+   * @type {!Uint8Array}
+   * @private
+   */
+  this.bytes_ = new Uint8Array(buffer);
+
+  /**
+   * Number of slots.
+   * @type {number}
+   * @private
+   */
+  this.slotCount_ = this.control_[wtf.io.SharedRing.Control_.SLOT_COUNT];
+
+  /**
+   * Event data capacity of each slot, in bytes.
+   * @type {number}
+   * @private
+   */
+  this.slotSize_ = this.control_[wtf.io.SharedRing.Control_.SLOT_SIZE];
+
+  /**
+   * String data capacity of each slot, in bytes.
+   * @type {number}
+   * @private
+   */
+  this.stringSize_ = this.control_[wtf.io.SharedRing.Control_.STRING_SIZE];
+
+  /**
+   * Event data capacity of each header region, in bytes.
+   * Header regions have the same capacity for string data.
+   * @type {number}
+   * @private
+   */
+  this.headerSize_ = this.control_[wtf.io.SharedRing.Control_.HEADER_SIZE];
+
+  /**
+   * Buffer views over each slot, created on demand.
+   * @type {!Array.<wtf.io.BufferView.Type>}
+   * @private
+   */
+  this.slotViews_ = new Array(this.slotCount_);
+
+  /**
+   * Buffer views over each of the two header regions, created on demand.
+   * @type {!Array.<wtf.io.BufferView.Type>}
+   * @private
+   */
+  this.headerViews_ = [null, null];
+};
+
+
+/**
+ * Value stored in the control block to identify rings.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.io.SharedRing.MAGIC_ = 0x57544652;
+
+
+/**
+ * Maximum number of slots in a ring.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.io.SharedRing.MAX_SLOTS_ = 1024;
+
+
+/**
+ * Bit set on the tail index while the reader has the ring locked.
+ * Sequence numbers must stay below this value, which at 1MB slots is a
+ * petabyte of recorded data.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.io.SharedRing.LOCK_BIT_ = 0x40000000;
+
+
+/**
+ * Control block indices, in 32-bit words.
+ * @enum {number}
+ * @private
+ */
+wtf.io.SharedRing.Control_ = {
+  MAGIC: 0,
+  SLOT_COUNT: 1,
+  SLOT_SIZE: 2,
+  STRING_SIZE: 3,
+  HEADER_SIZE: 4,
+  // Sequence number of the next slot to be published.
+  HEAD: 5,
+  // Sequence number of the oldest valid slot, ORed with LOCK_BIT_ when locked.
+  TAIL: 6,
+  // Index of the valid header region, or -1 if none has been written.
+  HEADER_INDEX: 7,
+  // Number of slots dropped because the reader had the ring locked.
+  DROPPED: 8,
+  // Metadata for header regions 0 and 1.
+  HEADER_META: 12,
+  // Metadata for each slot.
+  SLOT_META: 20
+};
+
+
+/**
+ * Slot metadata word offsets, relative to the slot metadata base.
+ * @enum {number}
+ * @private
+ */
+wtf.io.SharedRing.SlotMeta_ = {
+  SEQUENCE: 0,
+  EVENT_BYTES: 1,
+  STRING_BYTES: 2,
+  FLAGS: 3,
+  STRIDE: 4
+};
+
+
+/**
+ * Slot flags.
+ * @enum {number}
+ */
+wtf.io.SharedRing.SlotFlag = {
+  /**
+   * The string table did not fit in the slot and was truncated.
+   */
+  TRUNCATED_STRINGS: 1 << 0
+};
+
+
+/**
+ * Whether shared rings are supported in the current environment.
+ * @return {boolean} True if shared memory and atomics are available.
+ */
+wtf.io.SharedRing.isSupported = function() {
+  return !!goog.global['SharedArrayBuffer'] && !!goog.global['Atomics'];
+};
+
+
+/**
+ * Allocates a new ring.
+ * @param {number} slotCount Number of slots.
+ * @param {number} slotSize Event data capacity of each slot, in bytes.
+ * @param {number} stringSize String data capacity of each slot, in bytes.
+ * @param {number} headerSize Capacity of the header region, in bytes.
+ * @return {!wtf.io.SharedRing} New empty ring.
+ */
+wtf.io.SharedRing.create = function(
+    slotCount, slotSize, stringSize, headerSize) {
+  goog.asserts.assert(wtf.io.SharedRing.isSupported());
+  goog.asserts.assert(slotCount <= wtf.io.SharedRing.MAX_SLOTS_);
+  slotCount = Math.min(slotCount, wtf.io.SharedRing.MAX_SLOTS_);
+
+  // Keep all regions 8b aligned so that typed array views can be created.
+  function align(value) {
+    return (value + 7) & ~7;
+  };
+  slotSize = align(slotSize);
+  stringSize = align(stringSize);
+  headerSize = align(headerSize);
+
+  var controlSize = align((wtf.io.SharedRing.Control_.SLOT_META +
+      wtf.io.SharedRing.MAX_SLOTS_ * wtf.io.SharedRing.SlotMeta_.STRIDE) * 4);
+  var byteLength = controlSize +
+      2 * headerSize * 2 +
+      slotCount * (slotSize + stringSize);
+  var buffer = new goog.global['SharedArrayBuffer'](byteLength);
+
+  var control = new Int32Array(buffer, 0, controlSize / 4);
+  control[wtf.io.SharedRing.Control_.SLOT_COUNT] = slotCount;
+  control[wtf.io.SharedRing.Control_.SLOT_SIZE] = slotSize;
+  control[wtf.io.SharedRing.Control_.STRING_SIZE] = stringSize;
+  control[wtf.io.SharedRing.Control_.HEADER_SIZE] = headerSize;
+  control[wtf.io.SharedRing.Control_.HEADER_INDEX] = -1;
+  wtf.io.SharedRing.store_(
+      control, wtf.io.SharedRing.Control_.MAGIC, wtf.io.SharedRing.MAGIC_);
+
+  return new wtf.io.SharedRing(buffer);
+};
+
+
+/**
+ * Atomically loads a value.
+ * @param {!Int32Array} array Target array.
+ * @param {number} index Element index.
+ * @return {number} Value.
+ * @private
+ */
+wtf.io.SharedRing.load_ = function(array, index) {
+  return goog.global['Atomics']['load'](array, index);
+};
+
+
+/**
+ * Atomically stores a value.
+ * @param {!Int32Array} array Target array.
+ * @param {number} index Element index.
+ * @param {number} value Value.
+ * @private
+ */
+wtf.io.SharedRing.store_ = function(array, index, value) {
+  goog.global['Atomics']['store'](array, index, value);
+};
+
+
+/**
+ * Atomically replaces a value if it matches the expected value.
+ * @param {!Int32Array} array Target array.
+ * @param {number} index Element index.
+ * @param {number} expectedValue Expected current value.
+ * @param {number} value Replacement value.
+ * @return {boolean} True if the value was replaced.
+ * @private
+ */
+wtf.io.SharedRing.compareExchange_ = function(
+    array, index, expectedValue, value) {
+  return goog.global['Atomics']['compareExchange'](
+      array, index, expectedValue, value) == expectedValue;
+};
+
+
+/**
+ * Gets the shared backing buffer.
+ * This can be posted to other threads and wrapped with a new ring there.
+ * @return {!ArrayBuffer} SharedArrayBuffer.
+ */
+wtf.io.SharedRing.prototype.getBuffer = function() {
+  return this.buffer_;
+};
+
+
+/**
+ * Gets the number of slots in the ring.
+ * @return {number} Slot count.
+ */
+wtf.io.SharedRing.prototype.getSlotCount = function() {
+  return this.slotCount_;
+};
+
+
+/**
+ * Gets the number of slots dropped because the ring was locked by the reader.
+ * @return {number} Dropped slot count.
+ */
+wtf.io.SharedRing.prototype.getDroppedCount = function() {
+  return wtf.io.SharedRing.load_(
+      this.control_, wtf.io.SharedRing.Control_.DROPPED);
+};
+
+
+/**
+ * Gets the byte offset of the given header region.
+ * @param {number} index Header region index, 0 or 1.
+ * @return {number} Byte offset.
+ * @private
+ */
+wtf.io.SharedRing.prototype.getHeaderOffset_ = function(index) {
+  return this.control_.byteLength + index * this.headerSize_ * 2;
+};
+
+
+/**
+ * Gets the byte offset of the given slot.
+ * @param {number} index Slot index.
+ * @return {number} Byte offset.
+ * @private
+ */
+wtf.io.SharedRing.prototype.getSlotOffset_ = function(index) {
+  return this.getHeaderOffset_(2) +
+      index * (this.slotSize_ + this.stringSize_);
+};
+
+
+/**
+ * Gets the buffer view over a slot, creating it if needed.
+ * The view is valid for the lifetime of the ring and has its own string table.
+ * @param {number} index Slot index.
+ * @return {!wtf.io.BufferView.Type} Buffer view.
+ */
+wtf.io.SharedRing.prototype.getSlotBuffer = function(index) {
+  var bufferView = this.slotViews_[index];
+  if (!bufferView) {
+    bufferView = this.slotViews_[index] = wtf.io.BufferView.createWithRange(
+        this.buffer_, this.getSlotOffset_(index), this.slotSize_);
+  }
+  return bufferView;
+};
+
+
+/**
+ * Gets the buffer view over a header region, creating it if needed.
+ * @param {number} index Header region index, 0 or 1.
+ * @return {!wtf.io.BufferView.Type} Buffer view.
+ * @private
+ */
+wtf.io.SharedRing.prototype.getHeaderBuffer_ = function(index) {
+  var bufferView = this.headerViews_[index];
+  if (!bufferView) {
+    bufferView = this.headerViews_[index] = wtf.io.BufferView.createWithRange(
+        this.buffer_, this.getHeaderOffset_(index), this.headerSize_);
+  }
+  return bufferView;
+};
+
+
+/**
+ * Writes the string table of a buffer view into shared memory.
+ * Strings that do not fit are dropped.
+ * @param {!wtf.io.StringTable} stringTable String table.
+ * @param {number} byteOffset Target byte offset.
+ * @param {number} capacity Target capacity, in bytes.
+ * @param {!Int32Array} meta Metadata to receive the byte count and flags.
+ * @param {number} metaOffset Offset of the slot metadata in the array.
+ * @private
+ */
+wtf.io.SharedRing.prototype.writeStrings_ = function(
+    stringTable, byteOffset, capacity, meta, metaOffset) {
+  var values = stringTable.toJsonObject();
+  var bytes = values.length ?
+      goog.crypt.stringToUtf8ByteArray(values.join('\0')) : [];
+  var flags = 0;
+  if (bytes.length > capacity) {
+    // Truncate at a string boundary so that no partial characters remain.
+    var length = capacity;
+    while (length > 0 && bytes[length] !== 0) {
+      length--;
+    }
+    bytes.length = length;
+    flags |= wtf.io.SharedRing.SlotFlag.TRUNCATED_STRINGS;
+  }
+  this.bytes_.set(bytes, byteOffset);
+  meta[metaOffset + wtf.io.SharedRing.SlotMeta_.STRING_BYTES] = bytes.length;
+  meta[metaOffset + wtf.io.SharedRing.SlotMeta_.FLAGS] = flags;
+};
+
+
+/**
+ * Reads a string table previously written by {@see #writeStrings_}.
+ * @param {number} byteOffset Source byte offset.
+ * @param {number} byteLength Source length, in bytes.
+ * @return {!wtf.io.StringTable} String table.
+ * @private
+ */
+wtf.io.SharedRing.prototype.readStrings_ = function(byteOffset, byteLength) {
+  var stringTable = new wtf.io.StringTable();
+  if (byteLength) {
+    stringTable.deserialize(goog.crypt.utf8ByteArrayToString(
+        this.bytes_.subarray(byteOffset, byteOffset + byteLength)));
+  }
+  return stringTable;
+};
+
+
+/**
+ * Acquires the next slot for writing.
+ * If the ring is full the oldest slot is overwritten. This never blocks;
+ * if the oldest slot is locked by the reader no slot is returned and the
+ * caller should treat the data as dropped.
+ * Only one writer may use a ring.
+ * @return {number} Slot index, or -1 if no slot is available.
+ */
+wtf.io.SharedRing.prototype.acquireSlot = function() {
+  var control = this.control_;
+  var head = wtf.io.SharedRing.load_(control, wtf.io.SharedRing.Control_.HEAD);
+  var tail = wtf.io.SharedRing.load_(control, wtf.io.SharedRing.Control_.TAIL);
+  if (head - (tail & ~wtf.io.SharedRing.LOCK_BIT_) >= this.slotCount_) {
+    // Full - evict the oldest slot. This fails if the reader has the tail
+    // locked; the reader may also have consumed slots, which is fine.
+    if (tail & wtf.io.SharedRing.LOCK_BIT_ ||
+        !wtf.io.SharedRing.compareExchange_(
+            control, wtf.io.SharedRing.Control_.TAIL, tail, tail + 1)) {
+      tail = wtf.io.SharedRing.load_(
+          control, wtf.io.SharedRing.Control_.TAIL);
+      if (head - (tail & ~wtf.io.SharedRing.LOCK_BIT_) >= this.slotCount_) {
+        goog.global['Atomics']['add'](
+            control, wtf.io.SharedRing.Control_.DROPPED, 1);
+        return -1;
+      }
+    }
+  }
+  return head % this.slotCount_;
+};
+
+
+/**
+ * Publishes a slot previously returned from {@see #acquireSlot}, making it
+ * visible to the reader.
+ * The event data length is taken from the offset of the slot buffer view.
+ * @param {number} index Slot index.
+ */
+wtf.io.SharedRing.prototype.publishSlot = function(index) {
+  var control = this.control_;
+  var head = control[wtf.io.SharedRing.Control_.HEAD];
+  goog.asserts.assert(head % this.slotCount_ == index);
+
+  var bufferView = this.getSlotBuffer(index);
+  var metaOffset = wtf.io.SharedRing.Control_.SLOT_META +
+      index * wtf.io.SharedRing.SlotMeta_.STRIDE;
+  control[metaOffset + wtf.io.SharedRing.SlotMeta_.SEQUENCE] = head;
+  control[metaOffset + wtf.io.SharedRing.SlotMeta_.EVENT_BYTES] =
+      wtf.io.BufferView.getOffset(bufferView);
+  this.writeStrings_(
+      wtf.io.BufferView.getStringTable(bufferView),
+      this.getSlotOffset_(index) + this.slotSize_, this.stringSize_,
+      control, metaOffset);
+
+  // The store acts as a release of all the writes above.
+  wtf.io.SharedRing.store_(control, wtf.io.SharedRing.Control_.HEAD, head + 1);
+};
+
+
+/**
+ * Rewrites the header region.
+ * The header is double buffered: the inactive region is written and then made
+ * active. The update is skipped while the reader has the ring locked, as the
+ * reader may be using either region.
+ * @param {function(this:T, !wtf.io.BufferView.Type)} callback Function that
+ *     writes the header data into the given buffer view.
+ * @param {T=} opt_scope Callback scope.
+ * @return {boolean} True if the header was updated.
+ * @template T
+ */
+wtf.io.SharedRing.prototype.updateHeader = function(callback, opt_scope) {
+  var control = this.control_;
+  if (wtf.io.SharedRing.load_(control, wtf.io.SharedRing.Control_.TAIL) &
+      wtf.io.SharedRing.LOCK_BIT_) {
+    return false;
+  }
+
+  var index = control[wtf.io.SharedRing.Control_.HEADER_INDEX] == 0 ? 1 : 0;
+  var bufferView = this.getHeaderBuffer_(index);
+  wtf.io.BufferView.reset(bufferView);
+  callback.call(opt_scope, bufferView);
+
+  var metaOffset = wtf.io.SharedRing.Control_.HEADER_META +
+      index * wtf.io.SharedRing.SlotMeta_.STRIDE;
+  control[metaOffset + wtf.io.SharedRing.SlotMeta_.EVENT_BYTES] =
+      wtf.io.BufferView.getOffset(bufferView);
+  this.writeStrings_(
+      wtf.io.BufferView.getStringTable(bufferView),
+      this.getHeaderOffset_(index) + this.headerSize_, this.headerSize_,
+      control, metaOffset);
+
+  wtf.io.SharedRing.store_(
+      control, wtf.io.SharedRing.Control_.HEADER_INDEX, index);
+  return true;
+};
+
+
+/**
+ * Creates a read-only buffer view over a written region.
+ * @param {number} byteOffset Region byte offset.
+ * @param {number} capacity Region event data capacity, in bytes.
+ * @param {number} metaOffset Offset of the region metadata in the control
+ *     block.
+ * @return {!wtf.io.BufferView.Type} Buffer view with its offset set to the
+ *     end of the event data.
+ * @private
+ */
+wtf.io.SharedRing.prototype.createReadView_ = function(
+    byteOffset, capacity, metaOffset) {
+  var control = this.control_;
+  var stringTable = this.readStrings_(
+      byteOffset + capacity,
+      control[metaOffset + wtf.io.SharedRing.SlotMeta_.STRING_BYTES]);
+  var bufferView = wtf.io.BufferView.createWithRange(
+      this.buffer_, byteOffset, capacity, stringTable);
+  wtf.io.BufferView.setOffset(bufferView,
+      control[metaOffset + wtf.io.SharedRing.SlotMeta_.EVENT_BYTES]);
+  return bufferView;
+};
+
+
+/**
+ * Reads the header and all published slots in order.
+ * The buffer views passed to the callback reference shared memory directly
+ * and are only valid for the duration of the callback. Callers that need to
+ * retain the data must copy it.
+ *
+ * While reading the writer continues to fill free slots but cannot evict any
+ * of the slots being read.
+ * Only one reader may use a ring at a time.
+ *
+ * @param {function(this:T, !wtf.io.BufferView.Type, number)} callback
+ *     Function called with each buffer view and its sequence number. The
+ *     header, if present, is passed first with a sequence number of -1.
+ * @param {T=} opt_scope Callback scope.
+ * @param {boolean=} opt_consume True to remove the slots read from the ring.
+ * @return {number} Number of slots read, or -1 if the ring was already
+ *     locked.
+ * @template T
+ */
+wtf.io.SharedRing.prototype.read = function(callback, opt_scope, opt_consume) {
+  var control = this.control_;
+
+  // Lock the tail so the writer cannot evict anything.
+  var tail = wtf.io.SharedRing.load_(control, wtf.io.SharedRing.Control_.TAIL);
+  while (true) {
+    if (tail & wtf.io.SharedRing.LOCK_BIT_) {
+      return -1;
+    }
+    if (wtf.io.SharedRing.compareExchange_(
+        control, wtf.io.SharedRing.Control_.TAIL,
+        tail, tail | wtf.io.SharedRing.LOCK_BIT_)) {
+      break;
+    }
+    tail = wtf.io.SharedRing.load_(control, wtf.io.SharedRing.Control_.TAIL);
+  }
+  var head = wtf.io.SharedRing.load_(control, wtf.io.SharedRing.Control_.HEAD);
+
+  try {
+    var headerIndex = wtf.io.SharedRing.load_(
+        control, wtf.io.SharedRing.Control_.HEADER_INDEX);
+    if (headerIndex >= 0) {
+      callback.call(opt_scope, this.createReadView_(
+          this.getHeaderOffset_(headerIndex), this.headerSize_,
+          wtf.io.SharedRing.Control_.HEADER_META +
+              headerIndex * wtf.io.SharedRing.SlotMeta_.STRIDE), -1);
+    }
+
+    for (var sequence = tail; sequence < head; sequence++) {
+      var index = sequence % this.slotCount_;
+      var metaOffset = wtf.io.SharedRing.Control_.SLOT_META +
+          index * wtf.io.SharedRing.SlotMeta_.STRIDE;
+      goog.asserts.assert(
+          control[metaOffset + wtf.io.SharedRing.SlotMeta_.SEQUENCE] ==
+          sequence);
+      callback.call(opt_scope, this.createReadView_(
+          this.getSlotOffset_(index), this.slotSize_, metaOffset), sequence);
+    }
+  } finally {
+    // Unlock, optionally dropping everything that was read.
+    wtf.io.SharedRing.store_(
+        control, wtf.io.SharedRing.Control_.TAIL, opt_consume ? head : tail);
+  }
+
+  return head - tail;
+};
+
+
+goog.exportSymbol(
+    'wtf.io.SharedRing',
+    wtf.io.SharedRing);
+goog.exportSymbol(
+    'wtf.io.SharedRing.isSupported',
+    wtf.io.SharedRing.isSupported);
+goog.exportSymbol(
+    'wtf.io.SharedRing.create',
+    wtf.io.SharedRing.create);
+goog.exportProperty(
+    wtf.io.SharedRing.prototype, 'getBuffer',
+    wtf.io.SharedRing.prototype.getBuffer);
+goog.exportProperty(
+    wtf.io.SharedRing.prototype, 'getSlotCount',
+    wtf.io.SharedRing.prototype.getSlotCount);
+goog.exportProperty(
+    wtf.io.SharedRing.prototype, 'getDroppedCount',
+    wtf.io.SharedRing.prototype.getDroppedCount);
+goog.exportProperty(
+    wtf.io.SharedRing.prototype, 'read',
+    wtf.io.SharedRing.prototype.read);
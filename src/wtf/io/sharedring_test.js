@@ -0,0 +1,116 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+goog.provide('wtf.io.SharedRing_test');
+
+goog.require('wtf.io.BufferView');
+goog.require('wtf.io.SharedRing');
+
+
+/**
+ * wtf.io.SharedRing testing.
+ */
+wtf.io.SharedRing_test = suite('wtf.io.SharedRing', function() {
+  if (!wtf.io.SharedRing.isSupported()) {
+    return;
+  }
+
+  function writeSlot(ring, value, opt_string) {
+    var slot = ring.acquireSlot();
+    if (slot == -1) {
+      return false;
+    }
+    var bufferView = ring.getSlotBuffer(slot);
+    wtf.io.BufferView.reset(bufferView);
+    bufferView['uint32Array'][0] = value;
+    if (opt_string) {
+      bufferView['uint32Array'][1] =
+          bufferView['stringTable'].addString(opt_string);
+    }
+    wtf.io.BufferView.setOffset(bufferView, 8);
+    ring.publishSlot(slot);
+    return true;
+  };
+
+  function readValues(ring, opt_consume) {
+    var values = [];
+    ring.read(function(bufferView, sequence) {
+      if (sequence >= 0) {
+        values.push(bufferView['uint32Array'][0]);
+      }
+    }, null, opt_consume);
+    return values;
+  };
+
+  test('#ctor', function() {
+    var ring = wtf.io.SharedRing.create(4, 64, 32, 64);
+    assert.equal(ring.getSlotCount(), 4);
+    assert.lengthOf(readValues(ring), 0);
+
+    // Other threads wrap the same buffer.
+    var other = new wtf.io.SharedRing(ring.getBuffer());
+    assert.equal(other.getSlotCount(), 4);
+  });
+
+  test('ring', function() {
+    var ring = wtf.io.SharedRing.create(3, 64, 32, 64);
+    var reader = new wtf.io.SharedRing(ring.getBuffer());
+
+    assert.isTrue(writeSlot(ring, 1, 'a'));
+    assert.isTrue(writeSlot(ring, 2, 'bé'));
+    assert.deepEqual(readValues(reader), [1, 2]);
+
+    // Strings travel with the slot.
+    var strings = [];
+    reader.read(function(bufferView) {
+      strings.push(bufferView['stringTable'].getString(
+          bufferView['uint32Array'][1]));
+    });
+    assert.deepEqual(strings, ['a', 'bé']);
+
+    // Wraps around by evicting the oldest.
+    assert.isTrue(writeSlot(ring, 3));
+    assert.isTrue(writeSlot(ring, 4));
+    assert.deepEqual(readValues(reader), [2, 3, 4]);
+
+    // Consuming empties the ring.
+    assert.deepEqual(readValues(reader, true), [2, 3, 4]);
+    assert.lengthOf(readValues(reader), 0);
+    assert.isTrue(writeSlot(ring, 5));
+    assert.deepEqual(readValues(reader), [5]);
+  });
+
+  test('locked', function() {
+    var ring = wtf.io.SharedRing.create(2, 64, 32, 64);
+    assert.isTrue(writeSlot(ring, 1));
+    assert.isTrue(writeSlot(ring, 2));
+
+    // While the reader is active the writer cannot evict slots or update the
+    // header, and a second reader is refused.
+    var written = [];
+    ring.read(function(bufferView, sequence) {
+      written.push(writeSlot(ring, 3));
+      written.push(ring.updateHeader(goog.nullFunction));
+      written.push(ring.read(goog.nullFunction));
+    });
+    assert.deepEqual(written, [false, false, -1, false, false, -1]);
+    assert.equal(ring.getDroppedCount(), 2);
+
+    // Header updates become visible to the reader.
+    assert.isTrue(ring.updateHeader(function(bufferView) {
+      bufferView['uint32Array'][0] = 7;
+      wtf.io.BufferView.setOffset(bufferView, 4);
+    }));
+    var header = null;
+    ring.read(function(bufferView, sequence) {
+      if (sequence == -1) {
+        header = bufferView['uint32Array'][0];
+      }
+    });
+    assert.equal(header, 7);
+  });
+});
@@ -20,12 +20,14 @@ goog.require('wtf.io.Blob');
 /**
  * Simple read-only or write-only string table.
  * Strings are stored by ordinal in the order they are added.
+ *
+ * When writing, repeated values are interned and share an ordinal. Ordinals are
+ * only valid within the table that produced them, so each buffer gets its own
+ * references and interning restarts whenever the table is reset (such as when
+ * a buffer is reused).
  * @constructor
  */
 wtf.io.StringTable = function() {
-  // TODO(benvanik): add de-duplication, if possible to do efficiently. Perhaps
-  //     only for large strings where the cost is worth it?
-
   /**
    * All currently added string values.
    * If the table is in write mode this also contains null terminators.
@@ -40,15 +42,35 @@ wtf.io.StringTable = function() {
    * @private
    */
   this.hasNullTerminators_ = true;
+
+  /**
+   * Ordinals of interned values, keyed by value.
+   * Only populated in write mode.
+   * @type {!Object.<number>}
+   * @private
+   */
+  this.ordinals_ = Object.create(null);
 };
 
 
+/**
+ * Maximum length of strings that will be interned.
+ * Longer strings are rarely repeated and are appended without a lookup to
+ * keep the cost of adding them (and the memory retained by the table) bounded.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.io.StringTable.MAX_INTERNED_LENGTH_ = 1024;
+
+
 /**
  * Resets all string table data.
  */
 wtf.io.StringTable.prototype.reset = function() {
   if (this.values_.length) {
     this.values_ = [];
+    this.ordinals_ = Object.create(null);
   }
 };
 
@@ -61,19 +83,33 @@ wtf.io.StringTable.prototype.clone = function() {
   var other = new wtf.io.StringTable();
   other.values_ = this.values_.slice();
   other.hasNullTerminators_ = this.hasNullTerminators_;
+  for (var key in this.ordinals_) {
+    other.ordinals_[key] = this.ordinals_[key];
+  }
   return other;
 };
 
 
 /**
  * Adds a string to the table.
+ * If the value has already been added the existing ordinal is returned.
  * @param {string} value String value.
  * @return {number} Ordinal value.
  */
 wtf.io.StringTable.prototype.addString = function(value) {
+  var intern = value.length <= wtf.io.StringTable.MAX_INTERNED_LENGTH_;
+  if (intern) {
+    var existing = this.ordinals_[value];
+    if (existing !== undefined) {
+      return existing;
+    }
+  }
   var ordinal = this.values_.length / 2;
   this.values_.push(value);
   this.values_.push('\0');
+  if (intern) {
+    this.ordinals_[value] = ordinal;
+  }
   return ordinal;
 };
 
@@ -102,6 +138,7 @@ wtf.io.StringTable.prototype.getString = function(ordinal) {
  */
 wtf.io.StringTable.prototype.initFromJsonObject = function(value) {
   this.values_ = value ? (/** @type {!Array.<string>} */ (value)) : [];
+  this.ordinals_ = Object.create(null);
   this.hasNullTerminators_ = false;
 };
 
@@ -132,6 +169,7 @@ wtf.io.StringTable.prototype.toJsonObject = function() {
  */
 wtf.io.StringTable.prototype.deserialize = function(value) {
   this.values_ = value.split('\0');
+  this.ordinals_ = Object.create(null);
   this.hasNullTerminators_ = false;
 };
 
@@ -146,9 +184,9 @@ wtf.io.StringTable.prototype.serialize = function() {
   if (!this.hasNullTerminators_) {
     // Slow path to add null terminators in.
     values = new Array(this.values_.length * 2);
-    for (var n = 0; n < this.values_.length; n += 2) {
-      values[n] = this.values_[n];
-      values[n + 1] = '\0';
+    for (var n = 0; n < this.values_.length; n++) {
+      values[n * 2] = this.values_[n];
+      values[n * 2 + 1] = '\0';
     }
   }
   var blob = wtf.io.Blob.create(values);
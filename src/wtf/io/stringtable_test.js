@@ -0,0 +1,37 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+goog.provide('wtf.io.StringTable_test');
+
+goog.require('wtf.io.StringTable');
+
+
+/**
+ * wtf.io.StringTable testing.
+ */
+wtf.io.StringTable_test = suite('wtf.io.StringTable', function() {
+  test('interning', function() {
+    var stringTable = new wtf.io.StringTable();
+    var a = stringTable.addString('a');
+    var b = stringTable.addString('b');
+    assert.notEqual(a, b);
+    assert.equal(stringTable.addString('a'), a);
+    assert.equal(stringTable.addString('__proto__'), 2);
+    assert.equal(stringTable.addString('__proto__'), 2);
+    assert.deepEqual(stringTable.toJsonObject(), ['a', 'b', '__proto__']);
+
+    // Clones keep interned ordinals.
+    var clone = stringTable.clone();
+    assert.equal(clone.addString('b'), b);
+
+    // Ordinals restart after a reset.
+    stringTable.reset();
+    assert.equal(stringTable.addString('b'), 0);
+    assert.equal(stringTable.getString(0), 'b');
+    assert.equal(clone.getString(1), 'b');
+  });
+});
@@ -191,7 +191,7 @@ wtf.io.transports.MemoryReadTransport.prototype.dispatch_ = function() {
   // If whoever is handling the data is also queuing up data, this will loop
   // forever...
   while (this.pendingData_.length) {
-    var data = this.pendingData_.pop();
+    var data = this.pendingData_.shift();
     this.emitReceiveData(data);
   }
 
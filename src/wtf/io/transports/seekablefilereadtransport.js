@@ -0,0 +1,396 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/**
+ * @fileoverview Seekable chunked file read transport.
+ *
+ * @author benvanik@google.com (Ben Vanik)
+ */
+
+goog.provide('wtf.io.transports.SeekableFileReadTransport');
+
+goog.require('goog.asserts');
+goog.require('wtf.io.DataFormat');
+goog.require('wtf.io.ReadTransport');
+goog.require('wtf.io.cff.ChunkType');
+goog.require('wtf.io.cff.PartType');
+goog.require('wtf.io.cff.chunks.ChunkIndexChunk');
+goog.require('wtf.timing');
+
+
+
+/**
+ * Read-only transport for binary chunked files on disk.
+ * Instead of reading the entire file into memory this reads one chunk at a
+ * time with positional reads, so memory use is bounded by the largest chunk
+ * and whatever the consumer retains. Chunks can be skipped without being read
+ * by providing a selector.
+ *
+ * Chunk locations come from the {@see wtf.io.cff.chunks.ChunkIndexChunk} at
+ * the end of the file. Files without an index (older files or streams that
+ * were not ended) are indexed by walking the chunk headers.
+ *
+ * @param {string} filename Filename.
+ * @param {wtf.io.transports.SeekableFileReadTransport.Selector=} opt_selector
+ *     Selects which chunks are emitted. All chunks are emitted if omitted.
+ * @constructor
+ * @extends {wtf.io.ReadTransport}
+ */
+wtf.io.transports.SeekableFileReadTransport = function(
+    filename, opt_selector) {
+  goog.base(this);
+
+  /**
+   * Node 'fs' module.
+   * @type {!NodeFsModule}
+   * @private
+   */
+  this.fs_ = /** @type {!NodeFsModule} */ (require('fs'));
+
+  /**
+   * File handle.
+   * @type {number}
+   * @private
+   */
+  this.fd_ = this.fs_.openSync(filename, 'r');
+
+  /**
+   * Total file size, in bytes.
+   * @type {number}
+   * @private
+   */
+  this.fileSize_ = this.fs_.fstatSync(this.fd_).size;
+
+  /**
+   * Chunk selector, if any.
+   * @type {?wtf.io.transports.SeekableFileReadTransport.Selector}
+   * @private
+   */
+  this.selector_ = opt_selector || null;
+
+  /**
+   * Chunk index entries, built on demand.
+   * @type {Array.<!wtf.io.cff.chunks.ChunkIndexChunk.Entry>}
+   * @private
+   */
+  this.entries_ = null;
+
+  /**
+   * Entries selected for emitting, set on first resume.
+   * @type {Array.<!wtf.io.cff.chunks.ChunkIndexChunk.Entry>}
+   * @private
+   */
+  this.pendingEntries_ = null;
+
+  /**
+   * Index of the next entry in {@see #pendingEntries_} to emit.
+   * @type {number}
+   * @private
+   */
+  this.nextEntry_ = 0;
+
+  /**
+   * Total size of the selected chunks, in bytes.
+   * @type {number}
+   * @private
+   */
+  this.selectedBytes_ = 0;
+
+  /**
+   * Bytes emitted so far.
+   * @type {number}
+   * @private
+   */
+  this.emittedBytes_ = 0;
+
+  /**
+   * Whether a dispatch is scheduled.
+   * @type {boolean}
+   * @private
+   */
+  this.dispatchPending_ = false;
+};
+goog.inherits(wtf.io.transports.SeekableFileReadTransport,
+    wtf.io.ReadTransport);
+
+
+/**
+ * Chooses whether a chunk should be emitted.
+ * Receives the chunk entry, its index, and all entries in file order.
+ * @typedef {function(
+ *     !wtf.io.cff.chunks.ChunkIndexChunk.Entry, number,
+ *     !Array.<!wtf.io.cff.chunks.ChunkIndexChunk.Entry>):boolean}
+ */
+wtf.io.transports.SeekableFileReadTransport.Selector;
+
+
+/**
+ * Magic value at the start of chunked files.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.io.transports.SeekableFileReadTransport.MAGIC_ = 0xDEADBEEF;
+
+
+/**
+ * Size of the magic file header, in bytes.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.io.transports.SeekableFileReadTransport.MAGIC_LENGTH_ = 3 * 4;
+
+
+/**
+ * Size of the fixed chunk header, in bytes.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.io.transports.SeekableFileReadTransport.CHUNK_HEADER_LENGTH_ = 6 * 4;
+
+
+/**
+ * Approximate number of bytes to emit before yielding.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.io.transports.SeekableFileReadTransport.BYTES_PER_DISPATCH_ =
+    4 * 1024 * 1024;
+
+
+/**
+ * @override
+ */
+wtf.io.transports.SeekableFileReadTransport.prototype.disposeInternal =
+    function() {
+  this.fs_.closeSync(this.fd_);
+  goog.base(this, 'disposeInternal');
+};
+
+
+/**
+ * Reads a range of the file into a new buffer.
+ * @param {number} offset Byte offset in the file.
+ * @param {number} length Number of bytes to read.
+ * @return {!ArrayBuffer} Data.
+ * @private
+ */
+wtf.io.transports.SeekableFileReadTransport.prototype.read_ = function(
+    offset, length) {
+  if (offset + length > this.fileSize_) {
+    throw new Error('Read past the end of the file.');
+  }
+  var nodeBuffer = new Buffer(length);
+  var bytesRead = 0;
+  while (bytesRead < length) {
+    var n = this.fs_.readSync(
+        this.fd_, nodeBuffer, bytesRead, length - bytesRead,
+        offset + bytesRead);
+    if (!n) {
+      throw new Error('Unexpected end of file.');
+    }
+    bytesRead += n;
+  }
+  var data = new Uint8Array(length);
+  data.set(nodeBuffer);
+  return data.buffer;
+};
+
+
+/**
+ * Gets the chunk index of the file, building it if required.
+ * @return {!Array.<!wtf.io.cff.chunks.ChunkIndexChunk.Entry>} Index entries, in
+ *     file order.
+ */
+wtf.io.transports.SeekableFileReadTransport.prototype.getEntries = function() {
+  if (!this.entries_) {
+    this.entries_ = this.readIndex_() || this.scanIndex_();
+  }
+  return this.entries_;
+};
+
+
+/**
+ * Reads the chunk index from the end of the file, if present.
+ * @return {Array.<!wtf.io.cff.chunks.ChunkIndexChunk.Entry>} Index entries or
+ *     null if the file has no index.
+ * @private
+ */
+wtf.io.transports.SeekableFileReadTransport.prototype.readIndex_ = function() {
+  var footerLength = wtf.io.cff.chunks.ChunkIndexChunk.FOOTER_LENGTH;
+  var headerLength =
+      wtf.io.transports.SeekableFileReadTransport.CHUNK_HEADER_LENGTH_;
+  if (this.fileSize_ <
+      wtf.io.transports.SeekableFileReadTransport.MAGIC_LENGTH_ +
+      headerLength + footerLength) {
+    return null;
+  }
+
+  var footer = new Uint32Array(
+      this.read_(this.fileSize_ - footerLength, footerLength));
+  var offset = wtf.io.cff.chunks.ChunkIndexChunk.readFooter(footer);
+  if (offset < 0 || offset + headerLength > this.fileSize_) {
+    return null;
+  }
+
+  // The index chunk has a single part containing the index data.
+  var chunkData = new Uint32Array(
+      this.read_(offset, this.fileSize_ - offset));
+  if (wtf.io.cff.ChunkType.fromInteger(chunkData[1]) !=
+      wtf.io.cff.ChunkType.CHUNK_INDEX ||
+      chunkData[5] != 1) {
+    return null;
+  }
+  var partOffset = (headerLength + 3 * 4 + chunkData[7]) >> 2;
+  var partLength = chunkData[8] >> 2;
+  return wtf.io.cff.chunks.ChunkIndexChunk.parseEntries(
+      chunkData.subarray(partOffset, partOffset + partLength));
+};
+
+
+/**
+ * Builds a chunk index by walking the chunk headers in the file.
+ * Only headers (and the first event time of each event buffer) are read.
+ * @return {!Array.<!wtf.io.cff.chunks.ChunkIndexChunk.Entry>} Index entries.
+ * @private
+ */
+wtf.io.transports.SeekableFileReadTransport.prototype.scanIndex_ = function() {
+  var headerLength =
+      wtf.io.transports.SeekableFileReadTransport.CHUNK_HEADER_LENGTH_;
+  var binaryPartType = wtf.io.cff.PartType.toInteger(
+      wtf.io.cff.PartType.BINARY_EVENT_BUFFER);
+
+  var entries = [];
+  var o = wtf.io.transports.SeekableFileReadTransport.MAGIC_LENGTH_;
+  while (o + headerLength <= this.fileSize_) {
+    var header = new Uint32Array(this.read_(o, headerLength));
+    var chunkType = wtf.io.cff.ChunkType.fromInteger(header[1]);
+    var chunkLength = header[2];
+    var partCount = header[5];
+    if (chunkLength < headerLength || o + chunkLength > this.fileSize_) {
+      throw new Error('Chunk extends past the end of the file.');
+    }
+
+    // Find the first event time in binary event buffers.
+    var startTime = header[3];
+    if (chunkType == wtf.io.cff.ChunkType.EVENT_DATA &&
+        headerLength + partCount * 3 * 4 <= chunkLength) {
+      var partTable = new Uint32Array(
+          this.read_(o + headerLength, partCount * 3 * 4));
+      for (var n = 0; n < partCount; n++) {
+        if (partTable[n * 3] == binaryPartType &&
+            partTable[n * 3 + 2] >= 8) {
+          var eventHeader = new Uint32Array(this.read_(
+              o + headerLength + partCount * 3 * 4 + partTable[n * 3 + 1], 8));
+          startTime = eventHeader[1];
+          break;
+        }
+      }
+    }
+
+    entries.push({
+      chunkId: header[0],
+      chunkType: chunkType,
+      offset: o,
+      length: chunkLength,
+      startTime: startTime
+    });
+    o += chunkLength;
+  }
+  return entries;
+};
+
+
+/**
+ * @override
+ */
+wtf.io.transports.SeekableFileReadTransport.prototype.resume = function() {
+  goog.base(this, 'resume');
+
+  // Only binary data is supported.
+  goog.asserts.assert(
+      this.getPreferredFormat() == wtf.io.DataFormat.ARRAY_BUFFER);
+
+  if (!this.pendingEntries_) {
+    // Files in older formats have no chunk framing and must be read whole.
+    var magic = new Uint32Array(this.read_(0, 4))[0];
+    if (magic != wtf.io.transports.SeekableFileReadTransport.MAGIC_) {
+      this.pendingEntries_ = [];
+      this.emitReceiveData(this.read_(0, this.fileSize_));
+      this.scheduleDispatch_();
+      return;
+    }
+
+    var entries = this.getEntries();
+    var selected = [];
+    for (var n = 0; n < entries.length; n++) {
+      var entry = entries[n];
+      if (entry.chunkType == wtf.io.cff.ChunkType.CHUNK_INDEX ||
+          entry.chunkType == wtf.io.cff.ChunkType.UNKNOWN) {
+        continue;
+      }
+      if (!this.selector_ || this.selector_(entry, n, entries)) {
+        selected.push(entry);
+        this.selectedBytes_ += entry.length;
+      }
+    }
+    this.pendingEntries_ = selected;
+
+    // The magic header always goes first.
+    this.emitReceiveData(this.read_(0,
+        wtf.io.transports.SeekableFileReadTransport.MAGIC_LENGTH_));
+  }
+
+  this.scheduleDispatch_();
+};
+
+
+/**
+ * Schedules an async data dispatch.
+ * @private
+ */
+wtf.io.transports.SeekableFileReadTransport.prototype.scheduleDispatch_ =
+    function() {
+  if (this.dispatchPending_) {
+    return;
+  }
+  this.dispatchPending_ = true;
+  wtf.timing.setImmediate(this.dispatch_, this);
+};
+
+
+/**
+ * Emits the next batch of chunks.
+ * @private
+ */
+wtf.io.transports.SeekableFileReadTransport.prototype.dispatch_ = function() {
+  this.dispatchPending_ = false;
+  if (this.paused || this.isDisposed()) {
+    return;
+  }
+
+  var entries = this.pendingEntries_;
+  goog.asserts.assert(entries);
+  var byteLimit = this.emittedBytes_ +
+      wtf.io.transports.SeekableFileReadTransport.BYTES_PER_DISPATCH_;
+  while (this.nextEntry_ < entries.length && this.emittedBytes_ < byteLimit) {
+    var entry = entries[this.nextEntry_++];
+    this.emitReceiveData(this.read_(entry.offset, entry.length));
+    this.emittedBytes_ += entry.length;
+  }
+  this.emitProgressEvent(this.emittedBytes_, this.selectedBytes_);
+
+  if (this.nextEntry_ < entries.length) {
+    this.scheduleDispatch_();
+  } else {
+    this.end();
+  }
+};
+
@@ -0,0 +1,279 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/**
+ * @fileoverview Streaming XMLHttpRequest write transport type.
+ *
+ * @author benvanik@google.com (Ben Vanik)
+ */
+
+goog.provide('wtf.io.transports.StreamingXhrWriteTransport');
+
+goog.require('goog.events');
+goog.require('wtf.io.Blob');
+goog.require('wtf.io.WriteTransport');
+goog.require('wtf.timing');
+
+
+
+/**
+ * Write-only streaming XHR transport.
+ * Appends data to a stream on a trace server as it is written. The stream is
+ * created with {@code POST <url>/session/<session>/stream/<stream>/create},
+ * data is sent with {@code .../append?offset=N}, and {@code .../close} ends
+ * the stream.
+ *
+ * Writes made while an append is in flight are batched into the next append,
+ * so only one request is outstanding at a time and appends arrive in order.
+ * Each append carries the stream offset it starts at. The server may commit
+ * an append even if its response is lost, so a retry of an append that was
+ * already committed is acknowledged without being written again. If the
+ * server reports a different size the offset is corrected before retrying.
+ * If a request still fails an
+ * {@see wtf.io.transports.StreamingXhrWriteTransport.EventType#ERROR} event
+ * is emitted and the data of a failed append is dropped.
+ *
+ * @param {string} url Trace server URL, such as {@code http://localhost:8090}.
+ * @constructor
+ * @extends {wtf.io.WriteTransport}
+ */
+wtf.io.transports.StreamingXhrWriteTransport = function(url) {
+  goog.base(this);
+
+  /**
+   * Base URL of the stream.
+   * @type {string}
+   * @private
+   */
+  this.baseUrl_ = [
+    url.replace(/\/+$/, ''),
+    'session',
+    wtf.io.transports.StreamingXhrWriteTransport.generateId_(),
+    'stream',
+    wtf.io.transports.StreamingXhrWriteTransport.generateId_()
+  ].join('/');
+
+  /**
+   * XHR object of the request in flight, if any.
+   * @type {XMLHttpRequest}
+   * @private
+   */
+  this.xhr_ = null;
+
+  /**
+   * Data written since the last append was sent.
+   * @type {!Array.<!wtf.io.BlobData>}
+   * @private
+   */
+  this.pendingData_ = [];
+
+  /**
+   * Number of bytes the server has acknowledged.
+   * @type {number}
+   * @private
+   */
+  this.offset_ = 0;
+
+  /**
+   * Whether a send has been scheduled.
+   * @type {boolean}
+   * @private
+   */
+  this.sendPending_ = false;
+
+  /**
+   * Whether the stream should be closed after the pending data is sent.
+   * @type {boolean}
+   * @private
+   */
+  this.closePending_ = false;
+
+  this.post_('create', null);
+};
+goog.inherits(wtf.io.transports.StreamingXhrWriteTransport,
+    wtf.io.WriteTransport);
+
+
+/**
+ * Timeout, in ms.
+ * @type {number}
+ * @const
+ * @private
+ */
+wtf.io.transports.StreamingXhrWriteTransport.TIMEOUT_MS_ = 120 * 1000;
+
+
+/**
+ * Number of times a failed request is retried.
+ * @type {number}
+ * @const
+ * @private
+ */
+wtf.io.transports.StreamingXhrWriteTransport.MAX_RETRIES_ = 3;
+
+
+/**
+ * Delay before the first retry of a failed request, in ms. Doubled for each
+ * following retry.
+ * @type {number}
+ * @const
+ * @private
+ */
+wtf.io.transports.StreamingXhrWriteTransport.RETRY_DELAY_MS_ = 500;
+
+
+/**
+ * Events fired by {@see wtf.io.transports.StreamingXhrWriteTransport}.
+ * @enum {string}
+ */
+wtf.io.transports.StreamingXhrWriteTransport.EventType = {
+  /**
+   * A request failed after all retries. Data in a failed append was lost.
+   * Args: [command name, HTTP status or 0 if the request did not complete].
+   */
+  ERROR: goog.events.getUniqueId('error')
+};
+
+
+/**
+ * Generates a random session or stream ID.
+ * @return {string} ID.
+ * @private
+ */
+wtf.io.transports.StreamingXhrWriteTransport.generateId_ = function() {
+  return '' + (0 | Math.random() * (1 << 30));
+};
+
+
+/**
+ * Gets the base URL of the stream on the server.
+ * @return {string} Stream URL.
+ */
+wtf.io.transports.StreamingXhrWriteTransport.prototype.getStreamUrl =
+    function() {
+  return this.baseUrl_;
+};
+
+
+/**
+ * @override
+ */
+wtf.io.transports.StreamingXhrWriteTransport.prototype.disposeInternal =
+    function() {
+  // Requests in flight are left to complete, as the page may still be around
+  // to send the remaining data.
+  this.closePending_ = true;
+  this.flush();
+  goog.base(this, 'disposeInternal');
+};
+
+
+/**
+ * @override
+ */
+wtf.io.transports.StreamingXhrWriteTransport.prototype.write = function(
+    data) {
+  this.pendingData_.push(data);
+
+  // Coalesce all writes made in this tick (such as all chunks from a session
+  // flush) into a single append.
+  if (!this.sendPending_) {
+    this.sendPending_ = true;
+    wtf.timing.setImmediate(function() {
+      this.sendPending_ = false;
+      this.flush();
+    }, this);
+  }
+};
+
+
+/**
+ * @override
+ */
+wtf.io.transports.StreamingXhrWriteTransport.prototype.flush = function() {
+  if (this.xhr_) {
+    // Sent when the request in flight completes.
+    return;
+  }
+  if (this.pendingData_.length) {
+    var parts = wtf.io.Blob.toNativeParts(this.pendingData_);
+    this.pendingData_ = [];
+    this.post_('append', new Blob(parts, {
+      'type': 'application/octet-stream'
+    }));
+  } else if (this.closePending_) {
+    this.closePending_ = false;
+    this.post_('close', null);
+  }
+};
+
+
+/**
+ * Sends a stream command to the server.
+ * @param {string} command Command name.
+ * @param {Blob} data Request body, if any.
+ * @param {number=} opt_attempt Number of previous failed attempts.
+ * @private
+ */
+wtf.io.transports.StreamingXhrWriteTransport.prototype.post_ = function(
+    command, data, opt_attempt) {
+  var attempt = opt_attempt || 0;
+  var maxRetries = wtf.io.transports.StreamingXhrWriteTransport.MAX_RETRIES_;
+  var retryDelay = wtf.io.transports.StreamingXhrWriteTransport.RETRY_DELAY_MS_;
+  var xhrObject = XMLHttpRequest['raw'] || XMLHttpRequest;
+  var xhr = new xhrObject();
+  this.xhr_ = xhr;
+
+  var self = this;
+  xhr.onload = xhr.onerror = xhr.ontimeout = function() {
+    xhr.onload = xhr.onerror = xhr.ontimeout = null;
+    var status = xhr.status;
+    if (status >= 200 && status < 300) {
+      if (command == 'append') {
+        self.offset_ += data.size;
+      }
+      self.xhr_ = null;
+      self.flush();
+    } else if (attempt < maxRetries) {
+      if (status == 409 && command == 'append') {
+        // The server has a different size, such as after an append that was
+        // committed but reported as failed. Continue from its size.
+        var committedSize = Number(xhr.responseText);
+        if (!isNaN(committedSize)) {
+          self.offset_ = committedSize;
+        }
+      }
+      // Keep xhr_ set while waiting so that writes keep batching.
+      wtf.timing.setTimeout(retryDelay << attempt, function() {
+        self.post_(command, data, attempt + 1);
+      });
+    } else {
+      self.xhr_ = null;
+      self.emitEvent(
+          wtf.io.transports.StreamingXhrWriteTransport.EventType.ERROR,
+          command, status);
+      self.flush();
+    }
+  };
+
+  var commandUrl = this.baseUrl_ + '/' + command;
+  if (command == 'append') {
+    commandUrl += '?offset=' + this.offset_;
+  }
+  xhr.open('POST', commandUrl, true);
+  xhr.timeout = wtf.io.transports.StreamingXhrWriteTransport.TIMEOUT_MS_;
+  if (command == 'create') {
+    xhr.setRequestHeader('X-Trace-Format',
+        'application/x-extension-wtf-trace');
+  }
+  if (data) {
+    xhr.setRequestHeader('Content-Type', 'application/octet-stream');
+    xhr.send(data);
+  } else {
+    xhr.send();
+  }
+};
@@ -17,6 +17,8 @@ goog.require('goog.Disposable');
 goog.require('goog.asserts');
 goog.require('wtf.data.ContextInfo');
 goog.require('wtf.io.Blob');
+goog.require('wtf.remote.LiveView');
+goog.require('wtf.timing');
 goog.require('wtf.trace');
 goog.require('wtf.trace.ISessionListener');
 
@@ -49,6 +51,43 @@ wtf.remote.Client = function(traceManager, options) {
    */
   this.providerButtons_ = [];
 
+  /**
+   * Trace manager.
+   * @type {!wtf.trace.TraceManager}
+   * @private
+   */
+  this.traceManager_ = traceManager;
+
+  /**
+   * Live view aggregates, if live view is running.
+   * @type {wtf.remote.LiveView}
+   * @private
+   */
+  this.liveView_ = null;
+
+  /**
+   * Interval between live view updates, in ms.
+   * @type {number}
+   * @private
+   */
+  this.liveViewInterval_ = Math.max(100, options.getNumber(
+      'wtf.remote.liveView.interval',
+      wtf.remote.Client.DEFAULT_LIVE_VIEW_INTERVAL_));
+
+  /**
+   * Whether to start live view as soon as the connection opens.
+   * @type {boolean}
+   * @private
+   */
+  this.liveViewOnConnect_ = options.getBoolean('wtf.remote.liveView', false);
+
+  /**
+   * Live view update interval handle, if live view is running.
+   * @type {wtf.timing.Handle}
+   * @private
+   */
+  this.liveViewIntervalHandle_ = null;
+
   // Run through providers and get any buttons/etc we need.
   // We send these over the wire and handle the RPCs.
   var providers = traceManager.getProviders();
@@ -73,6 +112,15 @@ wtf.remote.Client = function(traceManager, options) {
 goog.inherits(wtf.remote.Client, goog.Disposable);
 
 
+/**
+ * Default interval between live view updates, in ms.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.remote.Client.DEFAULT_LIVE_VIEW_INTERVAL_ = 1000;
+
+
 /**
  * @override
  */
@@ -117,6 +165,21 @@ wtf.remote.Client.prototype.connect_ = function(uri) {
         'name': 'save_snapshot',
         'title': 'Save Snapshot',
         'tooltip': 'Save snapshot data to a file.'
+      },
+      {
+        'name': 'save_window',
+        'title': 'Save Window',
+        'tooltip': 'Save snapshot data for a time window to a file.'
+      },
+      {
+        'name': 'start_live_view',
+        'title': 'Start Live View',
+        'tooltip': 'Start sending live aggregates.'
+      },
+      {
+        'name': 'stop_live_view',
+        'title': 'Stop Live View',
+        'tooltip': 'Stop sending live aggregates.'
       }
     ];
     // TODO(benvanik): add provider buttons.
@@ -128,9 +191,18 @@ wtf.remote.Client.prototype.connect_ = function(uri) {
       'command': 'hello',
       'client_type': 'tracer',
       'context_info': contextInfoJson,
-      'commands': commandsJson
+      'commands': commandsJson,
+      'live_view': {
+        'interval': self.liveViewInterval_,
+        'scope_buckets': wtf.remote.LiveView.SCOPE_BUCKETS,
+        'frame_buckets': wtf.remote.LiveView.FRAME_BUCKETS
+      }
     };
     socket.send(goog.global.JSON.stringify(packet));
+
+    if (self.liveViewOnConnect_) {
+      self.startLiveView_();
+    }
   });
 
   socket.onerror = wtf.trace.ignoreListener(function(error) {
@@ -166,6 +238,8 @@ wtf.remote.Client.prototype.disconnect_ = function() {
   var socket = this.socket_;
   this.socket_ = null;
 
+  this.stopLiveView_();
+
   socket.close();
 
   socket.onopen = null;
@@ -202,6 +276,27 @@ wtf.remote.Client.prototype.executeCommand_ = function(data) {
       response['filename'] = wtf.trace.getTraceFilename();
       response['mimeType'] = 'application/x-extension-wtf-trace';
       break;
+    case 'save_window':
+      // Times are those reported in live view updates.
+      // Only the buffers that overlap the window are sent.
+      var startTime = data['start_time'];
+      var endTime = data['end_time'];
+      wtf.trace.snapshot(
+          responseBuffers,
+          goog.isNumber(startTime) ? startTime : undefined,
+          goog.isNumber(endTime) ? endTime : undefined);
+      for (var n = 0; n < responseBuffers.length; n++) {
+        responseBuffers[n] = wtf.io.Blob.toNative(responseBuffers[n]);
+      }
+      response['filename'] = wtf.trace.getTraceFilename();
+      response['mimeType'] = 'application/x-extension-wtf-trace';
+      break;
+    case 'start_live_view':
+      this.startLiveView_();
+      break;
+    case 'stop_live_view':
+      this.stopLiveView_();
+      break;
     default:
       // Not a built-in - check provider buttons.
       // TODO(benvanik): provider buttons.
@@ -220,6 +315,47 @@ wtf.remote.Client.prototype.executeCommand_ = function(data) {
 };
 
 
+/**
+ * Starts sending live view updates, if not already started.
+ * @private
+ */
+wtf.remote.Client.prototype.startLiveView_ = function() {
+  if (this.liveView_) {
+    return;
+  }
+  this.liveView_ = new wtf.remote.LiveView(this.traceManager_);
+  this.liveViewIntervalHandle_ = wtf.timing.setInterval(
+      wtf.timing.RunMode.DEFAULT, this.liveViewInterval_,
+      this.sendLiveViewUpdate_, this);
+};
+
+
+/**
+ * Stops sending live view updates.
+ * @private
+ */
+wtf.remote.Client.prototype.stopLiveView_ = function() {
+  wtf.timing.clearInterval(this.liveViewIntervalHandle_);
+  this.liveViewIntervalHandle_ = null;
+  this.liveView_ = null;
+};
+
+
+/**
+ * Sends the live view aggregates since the last update.
+ * @private
+ */
+wtf.remote.Client.prototype.sendLiveViewUpdate_ = function() {
+  var socket = this.socket_;
+  if (!socket || !this.liveView_ || socket.readyState != 1) {
+    return;
+  }
+  var packet = this.liveView_.sample();
+  packet['command'] = 'live_view_update';
+  socket.send(goog.global.JSON.stringify(packet));
+};
+
+
 /**
  * @override
  */
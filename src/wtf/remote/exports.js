@@ -15,6 +15,7 @@
 goog.provide('wtf.remote.exports');
 
 goog.require('wtf.remote');
+goog.require('wtf.remote.StreamReadTransport');
 
 
 /**
@@ -39,4 +40,9 @@ if (wtf.remote.exports.ENABLE_EXPORTS) {
   goog.exportSymbol(
       'wtf.remote.isConnected',
       wtf.remote.isConnected);
+
+  // Trace server streams
+  goog.exportSymbol(
+      'wtf.remote.StreamReadTransport',
+      wtf.remote.StreamReadTransport);
 }
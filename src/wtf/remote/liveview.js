@@ -0,0 +1,629 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/**
+ * @fileoverview Live view aggregates.
+ *
+ * @author benvanik@google.com (Ben Vanik)
+ */
+
+goog.provide('wtf.remote.LiveView');
+
+goog.require('wtf');
+goog.require('wtf.data.EventClass');
+goog.require('wtf.data.EventFlag');
+goog.require('wtf.io.BufferView');
+goog.require('wtf.io.cff.EventBufferCodec');
+goog.require('wtf.trace.EventRegistry');
+
+
+
+/**
+ * Rolling aggregates of the events recorded by the current session.
+ * Each call to {@see #sample} returns the aggregates since the previous call
+ * as a small JSON object, so that a remote controller can monitor the page
+ * without fetching whole snapshots.
+ *
+ * Nothing is added to the event append path. Counts come from the per-type
+ * counters and scope and frame times are found by walking the data appended
+ * to the current session chunk since the previous sample. If more than one
+ * chunk fills between samples the times of the events in the skipped chunks
+ * are missed, though counts remain exact.
+ *
+ * @param {!wtf.trace.TraceManager} traceManager Trace manager.
+ * @constructor
+ */
+wtf.remote.LiveView = function(traceManager) {
+  /**
+   * Trace manager.
+   * @type {!wtf.trace.TraceManager}
+   * @private
+   */
+  this.traceManager_ = traceManager;
+
+  /**
+   * Event registry.
+   * @type {!wtf.trace.EventRegistry}
+   * @private
+   */
+  this.registry_ = wtf.trace.EventRegistry.getShared();
+
+  /**
+   * Walking information by event wire ID.
+   * Entries are added as new event types are seen.
+   * @type {!Array.<wtf.remote.LiveView.Entry_>}
+   * @private
+   */
+  this.entries_ = [];
+
+  /**
+   * Number of registered event types that have entries.
+   * @type {number}
+   * @private
+   */
+  this.entryTypeCount_ = 0;
+
+  /**
+   * Event type counts at the last sample, by event wire ID.
+   * @type {!Array.<number>}
+   * @private
+   */
+  this.lastCounts_ = [];
+
+  /**
+   * Time of the last sample, in ms.
+   * @type {number}
+   * @private
+   */
+  this.lastSampleTime_ = wtf.now();
+
+  /**
+   * Chunk that was last walked, if any.
+   * @type {wtf.io.cff.chunks.EventDataChunk}
+   * @private
+   */
+  this.chunk_ = null;
+
+  /**
+   * Byte offset in {@see #chunk_} that has been walked to.
+   * @type {number}
+   * @private
+   */
+  this.chunkOffset_ = 0;
+
+  /**
+   * Time of the first event in {@see #chunk_}, used to detect reuse.
+   * @type {number}
+   * @private
+   */
+  this.chunkTime_ = 0;
+
+  /**
+   * Number of non-builtin events walked since the last sample.
+   * This is compared against the counters to detect missed data.
+   * @type {number}
+   * @private
+   */
+  this.walkedCount_ = 0;
+
+  /**
+   * Number of non-builtin events counted in the last call to
+   * {@see #sampleCounts_}.
+   * @type {number}
+   * @private
+   */
+  this.expectedCount_ = 0;
+
+  /**
+   * Whether some data was missed since the last sample.
+   * @type {boolean}
+   * @private
+   */
+  this.partial_ = false;
+
+  /**
+   * Open scope stacks, by zone ID.
+   * Each stack is a list of [key, enter time] pairs.
+   * @type {!Object.<number, !Array.<string|number>>}
+   * @private
+   */
+  this.stacks_ = {};
+
+  /**
+   * Open scope stack of the current zone.
+   * @type {!Array.<string|number>}
+   * @private
+   */
+  this.stack_ = this.stacks_[0] = [];
+
+  /**
+   * Scope statistics since the last sample, by scope name.
+   * Each is [count, total ms, max ms] followed by a count for each bucket in
+   * {@see #SCOPE_BUCKETS}.
+   * @type {!Object.<!Array.<number>>}
+   * @private
+   */
+  this.scopes_ = {};
+
+  /**
+   * Whether a frame has started and not yet ended.
+   * @type {boolean}
+   * @private
+   */
+  this.inFrame_ = false;
+
+  /**
+   * Whether {@see #frameStartTime_} is valid.
+   * @type {boolean}
+   * @private
+   */
+  this.hasFrameStart_ = false;
+
+  /**
+   * Time of the last frame start, in event time units.
+   * @type {number}
+   * @private
+   */
+  this.frameStartTime_ = 0;
+
+  /**
+   * Frame statistics since the last sample.
+   * This is [count, total ms, max ms, interval count, total interval ms,
+   * max interval ms] followed by an interval count for each bucket in
+   * {@see #FRAME_BUCKETS}.
+   * @type {!Array.<number>}
+   * @private
+   */
+  this.frames_ = wtf.remote.LiveView.createStats_(
+      6, wtf.remote.LiveView.FRAME_BUCKETS.length);
+
+  // Prime the counts so that the first sample only has new events.
+  this.sampleCounts_();
+};
+
+
+/**
+ * Upper bounds of the scope time histogram buckets, in ms.
+ * Times past the last bound go into an extra final bucket.
+ * @const
+ * @type {!Array.<number>}
+ */
+wtf.remote.LiveView.SCOPE_BUCKETS =
+    [0.25, 0.5, 1, 2, 4, 8, 16, 32, 64, 128, 256];
+
+
+/**
+ * Upper bounds of the frame interval histogram buckets, in ms.
+ * Intervals past the last bound go into an extra final bucket.
+ * @const
+ * @type {!Array.<number>}
+ */
+wtf.remote.LiveView.FRAME_BUCKETS = [17, 34, 50, 100, 250];
+
+
+/**
+ * Maximum depth of an open scope stack.
+ * Stacks deeper than this are assumed to be unbalanced and are dropped.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.remote.LiveView.MAX_DEPTH_ = 1024;
+
+
+/**
+ * How an event is handled when walking.
+ * @enum {number}
+ * @private
+ */
+wtf.remote.LiveView.Kind_ = {
+  OTHER: 0,
+  SCOPE: 1,
+  NAMED_SCOPE: 2,
+  LEAVE: 3,
+  SET_ZONE: 4,
+  FRAME_START: 5,
+  FRAME_END: 6
+};
+
+
+/**
+ * Walking information for an event type.
+ * @typedef {{
+ *   name: string,
+ *   kind: wtf.remote.LiveView.Kind_,
+ *   counted: boolean,
+ *   layout: Array.<number>
+ * }}
+ * @private
+ */
+wtf.remote.LiveView.Entry_;
+
+
+/**
+ * Creates a zeroed statistics array.
+ * @param {number} fieldCount Number of leading fields.
+ * @param {number} boundCount Number of histogram bucket bounds.
+ * @return {!Array.<number>} Statistics array.
+ * @private
+ */
+wtf.remote.LiveView.createStats_ = function(fieldCount, boundCount) {
+  var stats = new Array(fieldCount + boundCount + 1);
+  for (var n = 0; n < stats.length; n++) {
+    stats[n] = 0;
+  }
+  return stats;
+};
+
+
+/**
+ * Adds a value to a histogram in a statistics array.
+ * @param {!Array.<number>} stats Statistics array.
+ * @param {number} o Index of the first bucket.
+ * @param {!Array.<number>} bounds Bucket upper bounds.
+ * @param {number} value Value, in ms.
+ * @private
+ */
+wtf.remote.LiveView.addToHistogram_ = function(stats, o, bounds, value) {
+  var n = 0;
+  while (n < bounds.length && value >= bounds[n]) {
+    n++;
+  }
+  stats[o + n]++;
+};
+
+
+/**
+ * Rounds a time in ms to microseconds, to keep the JSON small.
+ * @param {number} value Time, in ms.
+ * @return {number} Rounded time.
+ * @private
+ */
+wtf.remote.LiveView.round_ = function(value) {
+  return Math.round(value * 1000) / 1000;
+};
+
+
+/**
+ * Samples the aggregates since the last sample.
+ * The result contains:
+ * <ul>
+ * <li>{@code time}/{@code duration}: end time and length of the period, in
+ *     ms. Times match those used by {@see wtf.trace#snapshot}.
+ * <li>{@code counts}: new event counts by event type name.
+ * <li>{@code scopes}: scopes that ended by name, as [count, total ms, max ms]
+ *     followed by the {@see #SCOPE_BUCKETS} histogram with trailing empty
+ *     buckets removed.
+ * <li>{@code frames}: frame statistics, if any frames ended.
+ * <li>{@code partial}: whether some scope or frame times were missed.
+ * </ul>
+ * @return {!Object} Sample JSON object.
+ */
+wtf.remote.LiveView.prototype.sample = function() {
+  var now = wtf.now();
+  this.walk_();
+
+  // Builtin events are also written outside of the session chunks, but all
+  // other events should have been walked. If not, open scopes may have ended
+  // in the missed data.
+  var counts = this.sampleCounts_();
+  if (this.walkedCount_ < this.expectedCount_) {
+    this.dropState_();
+  }
+  this.walkedCount_ = 0;
+
+  var round = wtf.remote.LiveView.round_;
+  var result = {
+    'time': round(now),
+    'duration': round(now - this.lastSampleTime_),
+    'counts': counts,
+    'scopes': {},
+    'partial': this.partial_
+  };
+  this.lastSampleTime_ = now;
+  this.partial_ = false;
+
+  for (var key in this.scopes_) {
+    var stats = this.scopes_[key];
+    var length = stats.length;
+    while (length > 3 && !stats[length - 1]) {
+      length--;
+    }
+    stats.length = length;
+    stats[1] = round(stats[1]);
+    stats[2] = round(stats[2]);
+    result['scopes'][key] = stats;
+  }
+  this.scopes_ = {};
+
+  var frames = this.frames_;
+  if (frames[0] || frames[3]) {
+    result['frames'] = {
+      'count': frames[0],
+      'mean': frames[0] ? round(frames[1] / frames[0]) : 0,
+      'max': round(frames[2]),
+      'intervals': frames[3],
+      'interval_mean': frames[3] ? round(frames[4] / frames[3]) : 0,
+      'interval_max': round(frames[5]),
+      'histogram': frames.slice(6)
+    };
+    this.frames_ = wtf.remote.LiveView.createStats_(
+        6, wtf.remote.LiveView.FRAME_BUCKETS.length);
+  }
+
+  return result;
+};
+
+
+/**
+ * Gathers the change in event type counts since the last call.
+ * Internal event types are not included.
+ * @return {!Object.<number>} New event counts by event type name.
+ * @private
+ */
+wtf.remote.LiveView.prototype.sampleCounts_ = function() {
+  var counts = {};
+  var expectedCount = 0;
+  var lastCounts = this.lastCounts_;
+  var eventTypes = this.registry_.getEventTypes();
+  for (var n = 0; n < eventTypes.length; n++) {
+    var eventType = eventTypes[n];
+    var count = eventType.count;
+    var delta = count - (lastCounts[eventType.wireId] || 0);
+    if (delta) {
+      lastCounts[eventType.wireId] = count;
+      if (!(eventType.flags & wtf.data.EventFlag.INTERNAL)) {
+        counts[eventType.name] = delta;
+      }
+      if (!(eventType.flags & wtf.data.EventFlag.BUILTIN)) {
+        expectedCount += delta;
+      }
+    }
+  }
+  this.expectedCount_ = expectedCount;
+  return counts;
+};
+
+
+/**
+ * Walks any data appended to the session since the last walk.
+ * @private
+ */
+wtf.remote.LiveView.prototype.walk_ = function() {
+  var session = this.traceManager_.getCurrentSession();
+  var chunk = session ? session.currentChunk : null;
+
+  if (this.chunk_ && this.chunk_ != chunk) {
+    // The chunk has been retired - finish it off. Its data remains until the
+    // session reuses it.
+    this.walkChunk_(this.chunk_);
+    this.chunk_ = null;
+  }
+
+  if (chunk) {
+    if (chunk != this.chunk_) {
+      this.chunk_ = chunk;
+      this.chunkOffset_ = 0;
+      this.chunkTime_ = 0;
+    }
+    this.walkChunk_(chunk);
+  }
+};
+
+
+/**
+ * Walks the events in a chunk from {@see #chunkOffset_}.
+ * @param {!wtf.io.cff.chunks.EventDataChunk} chunk Chunk.
+ * @private
+ */
+wtf.remote.LiveView.prototype.walkChunk_ = function(chunk) {
+  var bufferView = chunk.getBinaryBuffer();
+  var words = bufferView['int32Array'];
+  var byteLength = wtf.io.BufferView.getOffset(bufferView);
+  var wordCount = byteLength >> 2;
+
+  // Sessions reset chunks when reusing them. Every chunk starts with an event
+  // so a different first event time means it has been reused and the data
+  // since the last walk has been lost.
+  var o = this.chunkOffset_ >> 2;
+  if (o && (o > wordCount || words[1] != this.chunkTime_)) {
+    this.dropState_();
+    o = 0;
+  }
+  this.chunkTime_ = wordCount >= 2 ? words[1] : 0;
+
+  var Kind = wtf.remote.LiveView.Kind_;
+  while (o < wordCount) {
+    var wireId = words[o];
+    var entry = this.entries_[wireId] || this.addEntries_(wireId);
+    var end = -1;
+    if (entry && entry.layout) {
+      end = wtf.io.cff.EventBufferCodec.findEventEnd(
+          words, o, wordCount, entry.layout);
+    }
+    if (end == -1) {
+      // Unknown or corrupt data - skip the rest of the chunk.
+      this.dropState_();
+      o = wordCount;
+      break;
+    }
+
+    if (entry.counted) {
+      this.walkedCount_++;
+    }
+    var time = words[o + 1];
+    switch (entry.kind) {
+      case Kind.SCOPE:
+        this.enterScope_(entry.name, time);
+        break;
+      case Kind.NAMED_SCOPE:
+        var name = wtf.io.BufferView.getStringTable(bufferView).getString(
+            words[o + 2]);
+        this.enterScope_(name || entry.name, time);
+        break;
+      case Kind.LEAVE:
+        this.leaveScope_(time);
+        break;
+      case Kind.SET_ZONE:
+        var zoneId = words[o + 2];
+        this.stack_ = this.stacks_[zoneId] || (this.stacks_[zoneId] = []);
+        break;
+      case Kind.FRAME_START:
+        this.startFrame_(time);
+        break;
+      case Kind.FRAME_END:
+        this.endFrame_(time);
+        break;
+    }
+    o = end;
+  }
+  this.chunkOffset_ = o << 2;
+};
+
+
+/**
+ * Adds walking entries for any newly registered event types.
+ * @param {number} wireId Wire ID being looked up.
+ * @return {wtf.remote.LiveView.Entry_} Entry for the wire ID, if found.
+ * @private
+ */
+wtf.remote.LiveView.prototype.addEntries_ = function(wireId) {
+  var Kind = wtf.remote.LiveView.Kind_;
+  var eventTypes = this.registry_.getEventTypes();
+  for (var n = this.entryTypeCount_; n < eventTypes.length; n++) {
+    var eventType = eventTypes[n];
+    var kind = Kind.OTHER;
+    switch (eventType.name) {
+      case 'wtf.scope#enter':
+        kind = Kind.NAMED_SCOPE;
+        break;
+      case 'wtf.scope#leave':
+        kind = Kind.LEAVE;
+        break;
+      case 'wtf.zone#set':
+        kind = Kind.SET_ZONE;
+        break;
+      case 'wtf.timing#frameStart':
+        kind = Kind.FRAME_START;
+        break;
+      case 'wtf.timing#frameEnd':
+        kind = Kind.FRAME_END;
+        break;
+      default:
+        if (eventType.eventClass == wtf.data.EventClass.SCOPE) {
+          kind = Kind.SCOPE;
+        }
+        break;
+    }
+    this.entries_[eventType.wireId] = {
+      name: eventType.name,
+      kind: kind,
+      counted: !(eventType.flags & wtf.data.EventFlag.BUILTIN),
+      layout: wtf.io.cff.EventBufferCodec.parseLayout(
+          eventType.getArgString())
+    };
+  }
+  this.entryTypeCount_ = eventTypes.length;
+  return this.entries_[wireId] || null;
+};
+
+
+/**
+ * Drops all open scopes and frames after data has been missed.
+ * @private
+ */
+wtf.remote.LiveView.prototype.dropState_ = function() {
+  this.partial_ = true;
+  for (var zoneId in this.stacks_) {
+    this.stacks_[zoneId].length = 0;
+  }
+  this.inFrame_ = false;
+  this.hasFrameStart_ = false;
+};
+
+
+/**
+ * Handles a scope enter.
+ * @param {string} name Scope name.
+ * @param {number} time Event time.
+ * @private
+ */
+wtf.remote.LiveView.prototype.enterScope_ = function(name, time) {
+  var stack = this.stack_;
+  if (stack.length >= 2 * wtf.remote.LiveView.MAX_DEPTH_) {
+    stack.length = 0;
+    this.partial_ = true;
+  }
+  stack.push(name, time);
+};
+
+
+/**
+ * Handles a scope leave.
+ * @param {number} time Event time.
+ * @private
+ */
+wtf.remote.LiveView.prototype.leaveScope_ = function(time) {
+  var stack = this.stack_;
+  if (!stack.length) {
+    // Entered before we started walking.
+    return;
+  }
+  var enterTime = /** @type {number} */ (stack.pop());
+  var name = /** @type {string} */ (stack.pop());
+  var duration = ((time - enterTime) | 0) / 1000;
+
+  var stats = this.scopes_[name];
+  if (!stats) {
+    stats = this.scopes_[name] = wtf.remote.LiveView.createStats_(
+        3, wtf.remote.LiveView.SCOPE_BUCKETS.length);
+  }
+  stats[0]++;
+  stats[1] += duration;
+  stats[2] = Math.max(stats[2], duration);
+  wtf.remote.LiveView.addToHistogram_(
+      stats, 3, wtf.remote.LiveView.SCOPE_BUCKETS, duration);
+};
+
+
+/**
+ * Handles a frame start.
+ * @param {number} time Event time.
+ * @private
+ */
+wtf.remote.LiveView.prototype.startFrame_ = function(time) {
+  var frames = this.frames_;
+  if (this.hasFrameStart_) {
+    var interval = ((time - this.frameStartTime_) | 0) / 1000;
+    frames[3]++;
+    frames[4] += interval;
+    frames[5] = Math.max(frames[5], interval);
+    wtf.remote.LiveView.addToHistogram_(
+        frames, 6, wtf.remote.LiveView.FRAME_BUCKETS, interval);
+  }
+  this.inFrame_ = true;
+  this.hasFrameStart_ = true;
+  this.frameStartTime_ = time;
+};
+
+
+/**
+ * Handles a frame end.
+ * @param {number} time Event time.
+ * @private
+ */
+wtf.remote.LiveView.prototype.endFrame_ = function(time) {
+  if (!this.inFrame_) {
+    return;
+  }
+  this.inFrame_ = false;
+  var duration = ((time - this.frameStartTime_) | 0) / 1000;
+  var frames = this.frames_;
+  frames[0]++;
+  frames[1] += duration;
+  frames[2] = Math.max(frames[2], duration);
+};
@@ -0,0 +1,221 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/**
+ * @fileoverview Trace server stream read transport.
+ *
+ * @author benvanik@google.com (Ben Vanik)
+ */
+
+goog.provide('wtf.remote.StreamReadTransport');
+
+goog.require('wtf.io.DataFormat');
+goog.require('wtf.io.ReadTransport');
+
+
+
+/**
+ * Read-only transport for a stream stored on a trace server.
+ * Subscribes to the stream over a WebSocket and receives its data from the
+ * given offset, following data as it is appended until the stream is closed.
+ *
+ * The stream data is passed on in whole chunks so that it can be read by a
+ * {@see wtf.io.cff.BinaryStreamSource} as it arrives:
+ * <code>
+ * var transport = new wtf.remote.StreamReadTransport(
+ *     'ws://localhost:8090', sessionId, streamId);
+ * var streamSource = new wtf.io.cff.BinaryStreamSource(transport);
+ * </code>
+ *
+ * @param {string} uri Trace server WebSocket URI, such as
+ *     {@code ws://localhost:8090}.
+ * @param {string} sessionId Session ID.
+ * @param {string} streamId Stream ID.
+ * @param {boolean=} opt_follow Whether to follow appended data. Defaults to
+ *     true.
+ * @constructor
+ * @extends {wtf.io.ReadTransport}
+ */
+wtf.remote.StreamReadTransport = function(
+    uri, sessionId, streamId, opt_follow) {
+  goog.base(this);
+
+  /**
+   * Trace server URI.
+   * @type {string}
+   * @private
+   */
+  this.uri_ = uri;
+
+  /**
+   * Session ID.
+   * @type {string}
+   * @private
+   */
+  this.sessionId_ = sessionId;
+
+  /**
+   * Stream ID.
+   * @type {string}
+   * @private
+   */
+  this.streamId_ = streamId;
+
+  /**
+   * Whether to follow appended data.
+   * @type {boolean}
+   * @private
+   */
+  this.follow_ = opt_follow !== false;
+
+  /**
+   * Web socket, if connected.
+   * @type {WebSocket}
+   * @private
+   */
+  this.socket_ = null;
+
+  /**
+   * Received data not yet passed on, as it ends mid-chunk.
+   * @type {!Uint8Array}
+   * @private
+   */
+  this.pendingData_ = new Uint8Array(0);
+
+  /**
+   * Whether the file header has been passed on.
+   * @type {boolean}
+   * @private
+   */
+  this.hasSentHeader_ = false;
+
+  this.format = wtf.io.DataFormat.ARRAY_BUFFER;
+};
+goog.inherits(wtf.remote.StreamReadTransport, wtf.io.ReadTransport);
+
+
+/**
+ * Length of the binary file header, in bytes.
+ * @type {number}
+ * @const
+ * @private
+ */
+wtf.remote.StreamReadTransport.FILE_HEADER_LENGTH_ = 3 * 4;
+
+
+/**
+ * Offset of the chunk length in a chunk header, in bytes.
+ * @type {number}
+ * @const
+ * @private
+ */
+wtf.remote.StreamReadTransport.CHUNK_LENGTH_OFFSET_ = 2 * 4;
+
+
+/**
+ * @override
+ */
+wtf.remote.StreamReadTransport.prototype.disposeInternal = function() {
+  if (this.socket_) {
+    this.socket_.onopen = null;
+    this.socket_.onmessage = null;
+    this.socket_.onerror = null;
+    this.socket_.onclose = null;
+    this.socket_.close();
+    this.socket_ = null;
+  }
+  goog.base(this, 'disposeInternal');
+};
+
+
+/**
+ * @override
+ */
+wtf.remote.StreamReadTransport.prototype.resume = function() {
+  goog.base(this, 'resume');
+  if (this.socket_) {
+    return;
+  }
+
+  var socket = new WebSocket(this.uri_);
+  this.socket_ = socket;
+  socket.binaryType = 'arraybuffer';
+  var self = this;
+  socket.onopen = function() {
+    socket.send(goog.global.JSON.stringify({
+      'command': 'subscribe',
+      'session_id': self.sessionId_,
+      'stream_id': self.streamId_,
+      'offset': 0,
+      'follow': self.follow_
+    }));
+  };
+  socket.onmessage = function(e) {
+    if (e.data instanceof ArrayBuffer) {
+      self.receiveData_(new Uint8Array(e.data));
+      return;
+    }
+    var data = goog.global.JSON.parse(e.data);
+    switch (data['command']) {
+      case 'error':
+        self.emitErrorEvent(new Error(
+            'Unable to read stream: ' + data['message']));
+        goog.dispose(self);
+        break;
+      case 'end':
+        self.end();
+        break;
+    }
+  };
+  socket.onerror = socket.onclose = function() {
+    self.emitErrorEvent(new Error('Trace server connection lost.'));
+    goog.dispose(self);
+  };
+};
+
+
+/**
+ * Handles stream data, passing on all whole chunks received so far.
+ * @param {!Uint8Array} data Stream data.
+ * @private
+ */
+wtf.remote.StreamReadTransport.prototype.receiveData_ = function(data) {
+  var buffer = data;
+  if (this.pendingData_.length) {
+    buffer = new Uint8Array(this.pendingData_.length + data.length);
+    buffer.set(this.pendingData_);
+    buffer.set(data, this.pendingData_.length);
+  }
+
+  // Find the end of the last whole chunk.
+  var end = 0;
+  if (!this.hasSentHeader_) {
+    if (buffer.length < wtf.remote.StreamReadTransport.FILE_HEADER_LENGTH_) {
+      this.pendingData_ = buffer;
+      return;
+    }
+    end = wtf.remote.StreamReadTransport.FILE_HEADER_LENGTH_;
+  }
+  var lengthOffset = wtf.remote.StreamReadTransport.CHUNK_LENGTH_OFFSET_;
+  while (end + lengthOffset + 4 <= buffer.length) {
+    var o = end + lengthOffset;
+    var chunkLength = (buffer[o] | (buffer[o + 1] << 8) |
+        (buffer[o + 2] << 16) | (buffer[o + 3] << 24)) >>> 0;
+    if (!chunkLength || end + chunkLength > buffer.length) {
+      break;
+    }
+    end += chunkLength;
+  }
+
+  this.pendingData_ = buffer.subarray(end);
+  if (end) {
+    this.hasSentHeader_ = true;
+    // Copied so that the data is a whole ArrayBuffer.
+    this.emitReceiveData(buffer.buffer.slice(
+        buffer.byteOffset, buffer.byteOffset + end));
+  }
+};
@@ -0,0 +1,1034 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/**
+ * @fileoverview Checkpoints for fast seeking within a playback.
+ * A checkpoint records, for the start of a step, the smallest set of earlier
+ * events that recreates the resource contents, bound state, and program
+ * uniforms in effect at that point. Seeking restores the nearest earlier
+ * checkpoint and then plays only the steps after it.
+ *
+ * @author benvanik@google.com (Ben Vanik)
+ */
+
+goog.provide('wtf.replay.graphics.CheckpointManager');
+
+goog.require('goog.asserts');
+goog.require('goog.webgl');
+
+
+
+/**
+ * Builds and keeps checkpoints for a list of steps.
+ *
+ * Checkpoints are built from the recorded events alone (nothing is read back
+ * from the GPU, which WebGL cannot do for most resources). Events are tracked
+ * as setters of state slots, such as a buffer binding, a capability, a
+ * uniform value, or the contents of a texture level. A setter that is
+ * replaced before anything kept depends on it is not needed and is dropped.
+ * Draws into the default framebuffer are dropped as each step redraws it,
+ * unless the context preserves its drawing buffer or the step copies from it.
+ *
+ * Checkpoints are built lazily as later steps are requested. They are made
+ * every few steps, and the spacing doubles whenever the memory budget is
+ * exceeded so the retained checkpoints stay evenly spread.
+ *
+ * @param {!wtf.db.EventList} eventList Event list.
+ * @param {!Array.<!wtf.replay.graphics.Step>} steps Steps of the playback.
+ * @param {number=} opt_memoryBudget Maximum memory used by checkpoints, in
+ *     bytes.
+ * @constructor
+ */
+wtf.replay.graphics.CheckpointManager = function(
+    eventList, steps, opt_memoryBudget) {
+  /**
+   * Event list.
+   * @type {!wtf.db.EventList}
+   * @private
+   */
+  this.eventList_ = eventList;
+
+  /**
+   * Steps of the playback.
+   * @type {!Array.<!wtf.replay.graphics.Step>}
+   * @private
+   */
+  this.steps_ = steps;
+
+  /**
+   * Maximum memory used by checkpoints, in bytes.
+   * @type {number}
+   * @private
+   */
+  this.memoryBudget_ = goog.isDef(opt_memoryBudget) ?
+      opt_memoryBudget :
+      wtf.replay.graphics.CheckpointManager.DEFAULT_MEMORY_BUDGET;
+
+  /**
+   * Number of steps between checkpoints.
+   * @type {number}
+   * @private
+   */
+  this.interval_ = wtf.replay.graphics.CheckpointManager.INITIAL_INTERVAL_;
+
+  /**
+   * Checkpoints, in step order.
+   * @type {!Array.<!wtf.replay.graphics.CheckpointManager.Checkpoint>}
+   * @private
+   */
+  this.checkpoints_ = [];
+
+  /**
+   * Memory used by all checkpoints, in bytes.
+   * @type {number}
+   * @private
+   */
+  this.memoryUsage_ = 0;
+
+  /**
+   * Index of the next step to scan.
+   * @type {number}
+   * @private
+   */
+  this.nextStepIndex_ = 0;
+
+  /**
+   * Index of the next event to scan.
+   * @type {number}
+   * @private
+   */
+  this.nextEventIndex_ = 0;
+
+  /**
+   * Handlers by event type ID.
+   * @type {!Array.<wtf.replay.graphics.CheckpointManager.Handler_|undefined>}
+   * @private
+   */
+  this.handlers_ = [];
+
+  /**
+   * Type IDs of events that copy from the current framebuffer.
+   * @type {!Object.<boolean>}
+   * @private
+   */
+  this.copyTypeIds_ = {};
+
+  var visibleEventsRegex =
+      /^((WebGLRenderingContext#)|(wtf.webgl#)|(ANGLEInstancedArrays#))/;
+  var handlers = wtf.replay.graphics.CheckpointManager.HANDLERS_;
+  var eventTypes = eventList.eventTypeTable.getAll();
+  for (var n = 0; n < eventTypes.length; n++) {
+    var name = eventTypes[n].name;
+    var handler = handlers[name];
+    if (!handler && visibleEventsRegex.test(name)) {
+      // Unknown calls may depend on or change anything.
+      handler = wtf.replay.graphics.CheckpointManager.barrier_;
+    }
+    this.handlers_[eventTypes[n].id] = handler;
+    if (name == 'WebGLRenderingContext#copyTexImage2D' ||
+        name == 'WebGLRenderingContext#copyTexSubImage2D') {
+      this.copyTypeIds_[eventTypes[n].id] = true;
+    }
+  }
+
+  /**
+   * Events kept so far, in order. Some may since have been dropped.
+   * @type {!Array.<number>}
+   * @private
+   */
+  this.keptEvents_ = [];
+
+  /**
+   * Marks dropped events, by event index.
+   * @type {!Uint8Array}
+   * @private
+   */
+  this.dropped_ = new Uint8Array(eventList.getCount());
+
+  /**
+   * State slots, by key.
+   * @type {!Object.<!wtf.replay.graphics.CheckpointManager.Slot_>}
+   * @private
+   */
+  this.slots_ = {};
+
+  /**
+   * Keys of the content slots of each object, by object handle.
+   * @type {!Object.<!Array.<string>>}
+   * @private
+   */
+  this.objectSlots_ = {};
+
+  /**
+   * Tracked contexts, by context handle.
+   * @type {!Object.<!wtf.replay.graphics.CheckpointManager.Context_>}
+   * @private
+   */
+  this.contexts_ = {};
+
+  /**
+   * Context that is current while scanning.
+   * @type {!wtf.replay.graphics.CheckpointManager.Context_}
+   * @private
+   */
+  this.context_ = this.getContext_('');
+
+  /**
+   * Whether the step being scanned copies from a framebuffer.
+   * @type {boolean}
+   * @private
+   */
+  this.stepCopiesPixels_ = false;
+};
+
+
+/**
+ * Default memory budget, in bytes.
+ * @const
+ * @type {number}
+ */
+wtf.replay.graphics.CheckpointManager.DEFAULT_MEMORY_BUDGET = 32 * 1024 * 1024;
+
+
+/**
+ * Initial number of steps between checkpoints.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.INITIAL_INTERVAL_ = 8;
+
+
+/**
+ * A checkpoint at the start of a step.
+ * {@code events} holds the indices of the events to play, in order, to
+ * recreate the state at the start of the step.
+ * @typedef {{
+ *   stepIndex: number,
+ *   eventIndex: number,
+ *   events: !Uint32Array
+ * }}
+ */
+wtf.replay.graphics.CheckpointManager.Checkpoint;
+
+
+/**
+ * A state slot.
+ * {@code events} are the events that set the current value of the slot.
+ * {@code firstIndex} is the index of the first of them, used to check whether
+ * a barrier came after the value was set.
+ * @typedef {{
+ *   events: !Array.<number>,
+ *   firstIndex: number,
+ *   read: boolean,
+ *   context: !wtf.replay.graphics.CheckpointManager.Context_
+ * }}
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.Slot_;
+
+
+/**
+ * Tracked state of a context.
+ * @typedef {{
+ *   handle: string,
+ *   preserveDrawingBuffer: boolean,
+ *   barrierIndex: number,
+ *   activeTexture: number,
+ *   framebuffer: *,
+ *   program: *,
+ *   bindings: !Object
+ * }}
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.Context_;
+
+
+/**
+ * Gets the memory budget.
+ * @return {number} Maximum memory used by checkpoints, in bytes.
+ */
+wtf.replay.graphics.CheckpointManager.prototype.getMemoryBudget = function() {
+  return this.memoryBudget_;
+};
+
+
+/**
+ * Sets the memory budget. Checkpoints are released if needed.
+ * @param {number} value Maximum memory used by checkpoints, in bytes.
+ */
+wtf.replay.graphics.CheckpointManager.prototype.setMemoryBudget = function(
+    value) {
+  this.memoryBudget_ = value;
+  this.enforceBudget_();
+};
+
+
+/**
+ * Gets the memory used by all checkpoints.
+ * @return {number} Memory usage, in bytes.
+ */
+wtf.replay.graphics.CheckpointManager.prototype.getMemoryUsage = function() {
+  return this.memoryUsage_;
+};
+
+
+/**
+ * Gets the number of steps between checkpoints.
+ * @return {number} Step interval.
+ */
+wtf.replay.graphics.CheckpointManager.prototype.getInterval = function() {
+  return this.interval_;
+};
+
+
+/**
+ * Gets the nearest checkpoint that can be used to seek to the start of the
+ * given step. The step before the target is always played in full so that
+ * its output is visible, so the checkpoint is at least one step back.
+ * Checkpoints up to the step are built if they have not been yet.
+ * @param {number} stepIndex Target step index.
+ * @return {wtf.replay.graphics.CheckpointManager.Checkpoint} Checkpoint, or
+ *     null if there is none before the step.
+ */
+wtf.replay.graphics.CheckpointManager.prototype.getCheckpoint = function(
+    stepIndex) {
+  var lastUsableStep = Math.min(stepIndex, this.steps_.length) - 1;
+  this.scanTo_(lastUsableStep);
+
+  var checkpoints = this.checkpoints_;
+  for (var n = checkpoints.length - 1; n >= 0; n--) {
+    if (checkpoints[n].stepIndex <= lastUsableStep) {
+      return checkpoints[n];
+    }
+  }
+  return null;
+};
+
+
+/**
+ * Scans events up to the start of a step, making checkpoints along the way.
+ * @param {number} stepIndex Step index.
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.prototype.scanTo_ = function(
+    stepIndex) {
+  var steps = this.steps_;
+  while (this.nextStepIndex_ <= stepIndex) {
+    var step = steps[this.nextStepIndex_];
+    var stepStartIndex = step.getStartEventId();
+    this.scanEvents_(this.nextEventIndex_, stepStartIndex);
+    if (this.nextStepIndex_ &&
+        this.nextStepIndex_ % this.interval_ == 0) {
+      this.addCheckpoint_(this.nextStepIndex_, stepStartIndex);
+    }
+
+    // Scan the step along with any events before the next step.
+    var endIndex = this.nextStepIndex_ + 1 < steps.length ?
+        steps[this.nextStepIndex_ + 1].getStartEventId() :
+        step.getEndEventId() + 1;
+    this.stepCopiesPixels_ = this.containsCopy_(stepStartIndex, endIndex);
+    this.scanEvents_(stepStartIndex, endIndex);
+    this.stepCopiesPixels_ = false;
+
+    this.nextEventIndex_ = endIndex;
+    this.nextStepIndex_++;
+  }
+};
+
+
+/**
+ * Checks whether any event in a range copies from a framebuffer.
+ * @param {number} startIndex First event index.
+ * @param {number} endIndex Index after the last event.
+ * @return {boolean} True if there are any copies.
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.prototype.containsCopy_ = function(
+    startIndex, endIndex) {
+  if (startIndex >= endIndex) {
+    return false;
+  }
+  var copyTypeIds = this.copyTypeIds_;
+  var it = this.eventList_.beginEventRange(startIndex, endIndex - 1);
+  for (; !it.done(); it.next()) {
+    if (copyTypeIds[it.getTypeId()]) {
+      return true;
+    }
+  }
+  return false;
+};
+
+
+/**
+ * Scans a range of events.
+ * @param {number} startIndex First event index.
+ * @param {number} endIndex Index after the last event.
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.prototype.scanEvents_ = function(
+    startIndex, endIndex) {
+  if (startIndex >= endIndex) {
+    return;
+  }
+  var handlers = this.handlers_;
+  var it = this.eventList_.beginEventRange(startIndex, endIndex - 1);
+  for (; !it.done(); it.next()) {
+    var handler = handlers[it.getTypeId()];
+    if (handler) {
+      handler(this, it.getIndex(), it.getArguments() || {});
+    }
+  }
+};
+
+
+/**
+ * Makes a checkpoint from the events kept so far.
+ * @param {number} stepIndex Step index.
+ * @param {number} eventIndex Index of the first event of the step.
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.prototype.addCheckpoint_ = function(
+    stepIndex, eventIndex) {
+  // Compact the kept list so dropped events are not revisited.
+  var dropped = this.dropped_;
+  var keptEvents = this.keptEvents_;
+  var count = 0;
+  for (var n = 0; n < keptEvents.length; n++) {
+    if (!dropped[keptEvents[n]]) {
+      keptEvents[count++] = keptEvents[n];
+    }
+  }
+  keptEvents.length = count;
+
+  var events = new Uint32Array(keptEvents);
+  this.checkpoints_.push({
+    stepIndex: stepIndex,
+    eventIndex: eventIndex,
+    events: events
+  });
+  this.memoryUsage_ += events.byteLength;
+  this.enforceBudget_();
+};
+
+
+/**
+ * Releases checkpoints until the memory budget is met, doubling the interval
+ * between checkpoints each time.
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.prototype.enforceBudget_ = function() {
+  while (this.memoryUsage_ > this.memoryBudget_ &&
+      this.checkpoints_.length) {
+    this.interval_ *= 2;
+    var kept = [];
+    var memoryUsage = 0;
+    for (var n = 0; n < this.checkpoints_.length; n++) {
+      var checkpoint = this.checkpoints_[n];
+      if (checkpoint.stepIndex % this.interval_ == 0) {
+        kept.push(checkpoint);
+        memoryUsage += checkpoint.events.byteLength;
+      }
+    }
+    this.checkpoints_ = kept;
+    this.memoryUsage_ = memoryUsage;
+  }
+};
+
+
+/**
+ * Gets a tracked context, creating it if needed.
+ * @param {string} handle Context handle.
+ * @return {!wtf.replay.graphics.CheckpointManager.Context_} Context.
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.prototype.getContext_ = function(
+    handle) {
+  var context = this.contexts_[handle];
+  if (!context) {
+    context = this.contexts_[handle] = {
+      handle: handle,
+      preserveDrawingBuffer: false,
+      barrierIndex: -1,
+      activeTexture: goog.webgl.TEXTURE0,
+      framebuffer: null,
+      program: null,
+      bindings: {}
+    };
+  }
+  return context;
+};
+
+
+/**
+ * Keeps an event in all following checkpoints.
+ * @param {number} index Event index.
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.prototype.keep_ = function(index) {
+  this.keptEvents_.push(index);
+};
+
+
+/**
+ * Gets the key of a slot in the current context.
+ * @param {string} name Slot name.
+ * @return {string} Slot key.
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.prototype.key_ = function(name) {
+  return this.context_.handle + '|' + name;
+};
+
+
+/**
+ * Replaces the value of a slot. The events that set the previous value are
+ * dropped if nothing kept depended on them.
+ * @param {string} key Slot key.
+ * @param {number} index Event index, or -1 if the value was set by an event
+ *     that is kept for other reasons.
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.prototype.set_ = function(key, index) {
+  var slot = this.slots_[key];
+  if (slot && !slot.read &&
+      slot.context.barrierIndex < slot.firstIndex) {
+    for (var n = 0; n < slot.events.length; n++) {
+      this.dropped_[slot.events[n]] = 1;
+    }
+  }
+  this.slots_[key] = {
+    events: index >= 0 ? [index] : [],
+    firstIndex: index,
+    read: false,
+    context: this.context_
+  };
+  if (index >= 0) {
+    this.keep_(index);
+  }
+};
+
+
+/**
+ * Changes part of the value of a slot. The event is dropped along with the
+ * rest of the value when the slot is replaced.
+ * @param {string} key Slot key.
+ * @param {number} index Event index.
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.prototype.modify_ = function(
+    key, index) {
+  var slot = this.slots_[key];
+  if (!slot) {
+    this.set_(key, index);
+    return;
+  }
+  slot.events.push(index);
+  if (slot.firstIndex < 0) {
+    slot.firstIndex = index;
+  }
+  this.keep_(index);
+};
+
+
+/**
+ * Marks the current value of a slot as needed.
+ * @param {string} key Slot key.
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.prototype.read_ = function(key) {
+  var slot = this.slots_[key];
+  if (slot) {
+    slot.read = true;
+  }
+};
+
+
+/**
+ * Marks the current values of all slots of the current context as needed.
+ * @param {number} index Event index.
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.prototype.readAll_ = function(index) {
+  this.context_.barrierIndex = index;
+};
+
+
+/**
+ * Replaces the value of a slot holding some of the contents of an object.
+ * @param {*} handle Object handle.
+ * @param {string} name Slot name.
+ * @param {number} index Event index.
+ * @param {boolean} partial Whether only part of the value changes.
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.prototype.setContent_ = function(
+    handle, name, index, partial) {
+  var key = 'object' + handle + '|' + name;
+  if (!this.slots_[key]) {
+    var objectSlots = this.objectSlots_[handle];
+    if (!objectSlots) {
+      objectSlots = this.objectSlots_[handle] = [];
+    }
+    objectSlots.push(key);
+  }
+  if (partial) {
+    this.modify_(key, index);
+  } else {
+    this.set_(key, index);
+  }
+};
+
+
+/**
+ * Handles an object being deleted. Its contents are no longer needed.
+ * @param {*} handle Object handle.
+ * @param {number} index Event index.
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.prototype.deleteObject_ = function(
+    handle, index) {
+  var objectSlots = this.objectSlots_[handle];
+  if (objectSlots) {
+    for (var n = 0; n < objectSlots.length; n++) {
+      this.set_(objectSlots[n], -1);
+      delete this.slots_[objectSlots[n]];
+    }
+    delete this.objectSlots_[handle];
+  }
+  this.keep_(index);
+};
+
+
+/**
+ * Gets the key of a texture binding of the current context.
+ * Cube map faces map to the cube map binding.
+ * @param {number} target Texture target.
+ * @return {string} Slot key.
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.prototype.textureBindingKey_ = function(
+    target) {
+  if (target >= goog.webgl.TEXTURE_CUBE_MAP_POSITIVE_X &&
+      target <= goog.webgl.TEXTURE_CUBE_MAP_NEGATIVE_Z) {
+    target = goog.webgl.TEXTURE_CUBE_MAP;
+  }
+  return this.key_('texture:' + this.context_.activeTexture + ':' + target);
+};
+
+
+/**
+ * Reads the texture bound to a target in the current context.
+ * @param {number} target Texture target.
+ * @return {*} Texture handle.
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.prototype.readBoundTexture_ = function(
+    target) {
+  var key = this.textureBindingKey_(target);
+  this.read_(this.key_('activeTexture'));
+  this.read_(key);
+  return this.context_.bindings[key];
+};
+
+
+/**
+ * Reads the buffer bound to a target in the current context.
+ * @param {number} target Buffer target.
+ * @return {*} Buffer handle.
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.prototype.readBoundBuffer_ = function(
+    target) {
+  var key = this.key_('buffer:' + target);
+  this.read_(key);
+  return this.context_.bindings[key];
+};
+
+
+/**
+ * Handles a call that may depend on or change any state.
+ * @param {!wtf.replay.graphics.CheckpointManager} manager Manager.
+ * @param {number} index Event index.
+ * @param {!Object} args Event arguments.
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.barrier_ = function(
+    manager, index, args) {
+  manager.readAll_(index);
+  manager.keep_(index);
+};
+
+
+/**
+ * Handles a call that is always kept.
+ * @param {!wtf.replay.graphics.CheckpointManager} manager Manager.
+ * @param {number} index Event index.
+ * @param {!Object} args Event arguments.
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.keep_ = function(manager, index, args) {
+  manager.keep_(index);
+};
+
+
+/**
+ * Handles a draw call. Draws into the default framebuffer are not needed by
+ * later steps unless its contents are preserved or copied.
+ * @param {!wtf.replay.graphics.CheckpointManager} manager Manager.
+ * @param {number} index Event index.
+ * @param {!Object} args Event arguments.
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.draw_ = function(manager, index, args) {
+  var context = manager.context_;
+  if (context.framebuffer || context.preserveDrawingBuffer ||
+      manager.stepCopiesPixels_) {
+    wtf.replay.graphics.CheckpointManager.barrier_(manager, index, args);
+  }
+};
+
+
+/**
+ * Handles a call that only queries state. These are never needed.
+ * @param {!wtf.replay.graphics.CheckpointManager} manager Manager.
+ * @param {number} index Event index.
+ * @param {!Object} args Event arguments.
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.query_ = function(manager, index, args) {
+};
+
+
+/**
+ * Creates a handler for a call that sets a single piece of context state.
+ * @param {string} name Slot name.
+ * @param {string=} opt_argName Name of an argument that selects the slot,
+ *     such as the capability of enable/disable.
+ * @return {wtf.replay.graphics.CheckpointManager.Handler_} Handler.
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.setter_ = function(name, opt_argName) {
+  return function(manager, index, args) {
+    var slotName = opt_argName ? name + ':' + args[opt_argName] : name;
+    manager.set_(manager.key_(slotName), index);
+  };
+};
+
+
+/**
+ * Creates a handler for a separate front/back stencil call. These only
+ * replace the state when setting both faces.
+ * @param {string} name Slot name.
+ * @return {wtf.replay.graphics.CheckpointManager.Handler_} Handler.
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.faceSetter_ = function(name) {
+  return function(manager, index, args) {
+    if (args['face'] == goog.webgl.FRONT_AND_BACK) {
+      manager.set_(manager.key_(name), index);
+    } else {
+      manager.modify_(manager.key_(name), index);
+    }
+  };
+};
+
+
+/**
+ * Handler for a uniform call.
+ * @param {!wtf.replay.graphics.CheckpointManager} manager Manager.
+ * @param {number} index Event index.
+ * @param {!Object} args Event arguments.
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.uniform_ = function(
+    manager, index, args) {
+  // Uniform values belong to the program in use.
+  manager.read_(manager.key_('program'));
+  manager.setContent_(
+      manager.context_.program, 'uniform:' + args['location'], index, false);
+};
+
+
+/**
+ * Creates a handler for a call that uploads texture contents.
+ * @param {boolean} partial Whether only part of the level changes.
+ * @return {wtf.replay.graphics.CheckpointManager.Handler_} Handler.
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.texImage_ = function(partial) {
+  return function(manager, index, args) {
+    var target = args['target'];
+    manager.read_(manager.key_('pixelStore:' + goog.webgl.UNPACK_ALIGNMENT));
+    manager.read_(manager.key_('pixelStore:' + goog.webgl.UNPACK_FLIP_Y_WEBGL));
+    manager.read_(manager.key_(
+        'pixelStore:' + goog.webgl.UNPACK_PREMULTIPLY_ALPHA_WEBGL));
+    manager.read_(manager.key_(
+        'pixelStore:' + goog.webgl.UNPACK_COLORSPACE_CONVERSION_WEBGL));
+    var texture = manager.readBoundTexture_(target);
+    manager.setContent_(
+        texture, 'image:' + target + ':' + args['level'], index, partial);
+  };
+};
+
+
+/**
+ * Creates a handler for a call that uploads buffer contents.
+ * @param {boolean} partial Whether only part of the buffer changes.
+ * @return {wtf.replay.graphics.CheckpointManager.Handler_} Handler.
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.bufferData_ = function(partial) {
+  return function(manager, index, args) {
+    var buffer = manager.readBoundBuffer_(args['target']);
+    manager.setContent_(buffer, 'data', index, partial);
+  };
+};
+
+
+/**
+ * @typedef {function(!wtf.replay.graphics.CheckpointManager, number,
+ *     !Object)}
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.Handler_;
+
+
+/**
+ * Handlers by event name.
+ * Calls not listed here are treated as barriers.
+ * @type {!Object.<wtf.replay.graphics.CheckpointManager.Handler_>}
+ * @private
+ */
+wtf.replay.graphics.CheckpointManager.HANDLERS_ = (function() {
+  var CheckpointManager = wtf.replay.graphics.CheckpointManager;
+  var setter = CheckpointManager.setter_;
+  var handlers = {
+    'wtf.webgl#createContext': function(manager, index, args) {
+      var attributes = args['attributes'];
+      var context = manager.getContext_(String(args['handle']));
+      context.preserveDrawingBuffer =
+          !!(attributes && attributes['preserveDrawingBuffer']);
+      manager.keep_(index);
+    },
+    'wtf.webgl#setContext': function(manager, index, args) {
+      manager.context_ = manager.getContext_(String(args['handle']));
+      manager.keep_(index);
+      // Setting the context resets the viewport.
+      manager.set_(manager.key_('viewport'), -1);
+    },
+
+    // Object and program definitions.
+    'attachShader': CheckpointManager.keep_,
+    'bindAttribLocation': CheckpointManager.keep_,
+    'compileShader': CheckpointManager.keep_,
+    'createBuffer': CheckpointManager.keep_,
+    'createFramebuffer': CheckpointManager.keep_,
+    'createProgram': CheckpointManager.keep_,
+    'createRenderbuffer': CheckpointManager.keep_,
+    'createShader': CheckpointManager.keep_,
+    'createTexture': CheckpointManager.keep_,
+    'deleteProgram': CheckpointManager.keep_,
+    'deleteShader': CheckpointManager.keep_,
+    'detachShader': CheckpointManager.keep_,
+    'getAttribLocation': CheckpointManager.keep_,
+    'getExtension': CheckpointManager.keep_,
+    'getUniformLocation': CheckpointManager.keep_,
+    'linkProgram': CheckpointManager.keep_,
+    'shaderSource': CheckpointManager.keep_,
+    'deleteBuffer': function(manager, index, args) {
+      manager.deleteObject_(args['buffer'], index);
+    },
+    'deleteFramebuffer': function(manager, index, args) {
+      manager.deleteObject_(args['framebuffer'], index);
+    },
+    'deleteRenderbuffer': function(manager, index, args) {
+      manager.deleteObject_(args['renderbuffer'], index);
+    },
+    'deleteTexture': function(manager, index, args) {
+      manager.deleteObject_(args['texture'], index);
+    },
+    'framebufferRenderbuffer': function(manager, index, args) {
+      manager.read_(manager.key_('framebuffer'));
+      manager.read_(manager.key_('renderbuffer'));
+      manager.keep_(index);
+    },
+    'framebufferTexture2D': function(manager, index, args) {
+      manager.read_(manager.key_('framebuffer'));
+      manager.keep_(index);
+    },
+    'renderbufferStorage': function(manager, index, args) {
+      manager.read_(manager.key_('renderbuffer'));
+      manager.keep_(index);
+    },
+
+    // Bindings.
+    'activeTexture': function(manager, index, args) {
+      manager.context_.activeTexture = args['texture'];
+      manager.set_(manager.key_('activeTexture'), index);
+    },
+    'bindBuffer': function(manager, index, args) {
+      var key = manager.key_('buffer:' + args['target']);
+      manager.context_.bindings[key] = args['buffer'];
+      manager.set_(key, index);
+    },
+    'bindFramebuffer': function(manager, index, args) {
+      manager.context_.framebuffer = args['framebuffer'];
+      manager.set_(manager.key_('framebuffer'), index);
+    },
+    'bindRenderbuffer': setter('renderbuffer'),
+    'bindTexture': function(manager, index, args) {
+      manager.read_(manager.key_('activeTexture'));
+      var key = manager.textureBindingKey_(args['target']);
+      manager.context_.bindings[key] = args['texture'];
+      manager.set_(key, index);
+    },
+    'useProgram': function(manager, index, args) {
+      manager.context_.program = args['program'];
+      manager.set_(manager.key_('program'), index);
+    },
+
+    // Fixed function state.
+    'blendColor': setter('blendColor'),
+    'blendEquation': setter('blendEquation'),
+    'blendEquationSeparate': setter('blendEquation'),
+    'blendFunc': setter('blendFunc'),
+    'blendFuncSeparate': setter('blendFunc'),
+    'clearColor': setter('clearColor'),
+    'clearDepth': setter('clearDepth'),
+    'clearStencil': setter('clearStencil'),
+    'colorMask': setter('colorMask'),
+    'cullFace': setter('cullFace'),
+    'depthFunc': setter('depthFunc'),
+    'depthMask': setter('depthMask'),
+    'depthRange': setter('depthRange'),
+    'disable': setter('cap', 'cap'),
+    'enable': setter('cap', 'cap'),
+    'frontFace': setter('frontFace'),
+    'hint': setter('hint', 'target'),
+    'lineWidth': setter('lineWidth'),
+    'pixelStorei': setter('pixelStore', 'pname'),
+    'polygonOffset': setter('polygonOffset'),
+    'sampleCoverage': setter('sampleCoverage'),
+    'scissor': setter('scissor'),
+    'stencilFunc': setter('stencilFunc'),
+    'stencilFuncSeparate': CheckpointManager.faceSetter_('stencilFunc'),
+    'stencilMask': setter('stencilMask'),
+    'stencilMaskSeparate': CheckpointManager.faceSetter_('stencilMask'),
+    'stencilOp': setter('stencilOp'),
+    'stencilOpSeparate': CheckpointManager.faceSetter_('stencilOp'),
+    'viewport': setter('viewport'),
+
+    // Vertex attributes.
+    'disableVertexAttribArray': setter('attribArray', 'index'),
+    'enableVertexAttribArray': setter('attribArray', 'index'),
+    'vertexAttrib1f': setter('attrib', 'indx'),
+    'vertexAttrib1fv': setter('attrib', 'indx'),
+    'vertexAttrib2f': setter('attrib', 'indx'),
+    'vertexAttrib2fv': setter('attrib', 'indx'),
+    'vertexAttrib3f': setter('attrib', 'indx'),
+    'vertexAttrib3fv': setter('attrib', 'indx'),
+    'vertexAttrib4f': setter('attrib', 'indx'),
+    'vertexAttrib4fv': setter('attrib', 'indx'),
+    'vertexAttribPointer': function(manager, index, args) {
+      manager.readBoundBuffer_(goog.webgl.ARRAY_BUFFER);
+      manager.set_(manager.key_('attribPointer:' + args['indx']), index);
+    },
+
+    // Resource contents.
+    'bufferData': CheckpointManager.bufferData_(false),
+    'bufferSubData': CheckpointManager.bufferData_(true),
+    'compressedTexImage2D': CheckpointManager.texImage_(false),
+    'compressedTexSubImage2D': CheckpointManager.texImage_(true),
+    'texImage2D': CheckpointManager.texImage_(false),
+    'texSubImage2D': CheckpointManager.texImage_(true),
+    'texParameterf': function(manager, index, args) {
+      var target = args['target'];
+      var texture = manager.readBoundTexture_(target);
+      manager.setContent_(
+          texture, 'param:' + target + ':' + args['pname'], index, false);
+    },
+    'texParameteri': function(manager, index, args) {
+      handlers['texParameterf'](manager, index, args);
+    },
+    'generateMipmap': function(manager, index, args) {
+      // Mipmaps are made from the current contents, so they are all needed.
+      var texture = manager.readBoundTexture_(args['target']);
+      var objectSlots = manager.objectSlots_[texture] || [];
+      for (var n = 0; n < objectSlots.length; n++) {
+        manager.read_(objectSlots[n]);
+      }
+      manager.keep_(index);
+    },
+
+    // Draws and copies.
+    'clear': CheckpointManager.draw_,
+    'drawArrays': CheckpointManager.draw_,
+    'drawElements': CheckpointManager.draw_,
+    'drawArraysInstancedANGLE': CheckpointManager.draw_,
+    'drawElementsInstancedANGLE': CheckpointManager.draw_,
+    'vertexAttribDivisorANGLE': setter('attribDivisor', 'index'),
+    'copyTexImage2D': CheckpointManager.barrier_,
+    'copyTexSubImage2D': CheckpointManager.barrier_,
+
+    // Queries.
+    'checkFramebufferStatus': CheckpointManager.query_,
+    'finish': CheckpointManager.query_,
+    'flush': CheckpointManager.query_,
+    'getActiveAttrib': CheckpointManager.query_,
+    'getActiveUniform': CheckpointManager.query_,
+    'getAttachedShaders': CheckpointManager.query_,
+    'getBufferParameter': CheckpointManager.query_,
+    'getError': CheckpointManager.query_,
+    'getFramebufferAttachmentParameter': CheckpointManager.query_,
+    'getParameter': CheckpointManager.query_,
+    'getProgramInfoLog': CheckpointManager.query_,
+    'getProgramParameter': CheckpointManager.query_,
+    'getRenderbufferParameter': CheckpointManager.query_,
+    'getShaderInfoLog': CheckpointManager.query_,
+    'getShaderParameter': CheckpointManager.query_,
+    'getShaderPrecisionFormat': CheckpointManager.query_,
+    'getShaderSource': CheckpointManager.query_,
+    'getTexParameter': CheckpointManager.query_,
+    'getUniform': CheckpointManager.query_,
+    'getVertexAttrib': CheckpointManager.query_,
+    'getVertexAttribOffset': CheckpointManager.query_,
+    'isBuffer': CheckpointManager.query_,
+    'isEnabled': CheckpointManager.query_,
+    'isFramebuffer': CheckpointManager.query_,
+    'isProgram': CheckpointManager.query_,
+    'isRenderbuffer': CheckpointManager.query_,
+    'isShader': CheckpointManager.query_,
+    'isTexture': CheckpointManager.query_,
+    'readPixels': CheckpointManager.query_,
+    'validateProgram': CheckpointManager.query_
+  };
+
+  var uniformNames = [
+    'uniform1f', 'uniform1fv', 'uniform1i', 'uniform1iv',
+    'uniform2f', 'uniform2fv', 'uniform2i', 'uniform2iv',
+    'uniform3f', 'uniform3fv', 'uniform3i', 'uniform3iv',
+    'uniform4f', 'uniform4fv', 'uniform4i', 'uniform4iv',
+    'uniformMatrix2fv', 'uniformMatrix3fv', 'uniformMatrix4fv'
+  ];
+  for (var n = 0; n < uniformNames.length; n++) {
+    handlers[uniformNames[n]] = CheckpointManager.uniform_;
+  }
+
+  // Add the interface prefixes.
+  var result = {};
+  for (var name in handlers) {
+    var fullName = name;
+    if (name.indexOf('#') == -1) {
+      fullName = (name.indexOf('ANGLE') != -1 ?
+          'ANGLEInstancedArrays#' : 'WebGLRenderingContext#') + name;
+    }
+    result[fullName] = handlers[name];
+  }
+  goog.asserts.assert(result['WebGLRenderingContext#drawArrays']);
+  return result;
+})();
@@ -0,0 +1,182 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+goog.provide('wtf.replay.graphics.CheckpointManager_test');
+
+goog.require('wtf.replay.graphics.CheckpointManager');
+goog.require('wtf.replay.graphics.Step');
+goog.require('wtf.testing');
+
+
+/**
+ * wtf.replay.graphics.CheckpointManager testing.
+ */
+wtf.replay.graphics.CheckpointManager_test =
+    suite('wtf.replay.graphics.CheckpointManager', function() {
+  var eventTypes = [
+    'wtf.timing#frameStart(uint32 number)',
+    'wtf.timing#frameEnd(uint32 number)',
+    'wtf.webgl#createContext(uint32 handle, any attributes)',
+    'wtf.webgl#setContext(uint32 handle, uint32 width, uint32 height)',
+    'WebGLRenderingContext#createBuffer(uint32 value)',
+    'WebGLRenderingContext#bindBuffer(uint32 target, uint32 buffer)',
+    'WebGLRenderingContext#bufferData(uint32 target, uint32 size, ' +
+        'uint32 usage)',
+    'WebGLRenderingContext#bindFramebuffer(uint32 target, ' +
+        'uint32 framebuffer)',
+    'WebGLRenderingContext#clearColor(float32 red, float32 green, ' +
+        'float32 blue, float32 alpha)',
+    'WebGLRenderingContext#drawArrays(uint32 mode, int32 first, ' +
+        'int32 count)',
+    'WebGLRenderingContext#getError()'
+  ];
+
+  /**
+   * Creates an event list with a setup step and the given frames.
+   * @param {number} frameCount Number of frames.
+   * @param {function(number, !Array)} addFrameEvents Adds the events of a
+   *     frame.
+   * @return {!Object} Event list and steps.
+   */
+  function createPlayback(frameCount, addFrameEvents) {
+    var events = [
+      [0, 'wtf.webgl#createContext', 1, {}],
+      [1, 'wtf.webgl#setContext', 1, 100, 100],
+      [2, 'WebGLRenderingContext#createBuffer', 5]
+    ];
+    var ranges = [[0, 2]];
+    var time = 10;
+    for (var n = 0; n < frameCount; n++) {
+      var startIndex = events.length;
+      events.push([time++, 'wtf.timing#frameStart', n]);
+      var frameEvents = [];
+      addFrameEvents(n, frameEvents);
+      for (var m = 0; m < frameEvents.length; m++) {
+        events.push([time++].concat(frameEvents[m]));
+      }
+      events.push([time++, 'wtf.timing#frameEnd', n]);
+      ranges.push([startIndex, events.length - 1]);
+    }
+    var eventList = wtf.testing.createEventList({
+      instanceEventTypes: eventTypes,
+      events: events
+    });
+    var steps = [];
+    for (var n = 0; n < ranges.length; n++) {
+      steps.push(new wtf.replay.graphics.Step(
+          eventList, ranges[n][0], ranges[n][1]));
+    }
+    return {
+      eventList: eventList,
+      steps: steps
+    };
+  };
+
+  /**
+   * Gets the names of the events in a checkpoint.
+   * @param {!wtf.db.EventList} eventList Event list.
+   * @param {!wtf.replay.graphics.CheckpointManager.Checkpoint} checkpoint
+   *     Checkpoint.
+   * @return {!Array.<string>} Event names, with the first argument value.
+   */
+  function getEventNames(eventList, checkpoint) {
+    var names = [];
+    var it = eventList.begin();
+    for (var n = 0; n < checkpoint.events.length; n++) {
+      it.seek(checkpoint.events[n]);
+      var args = it.getArguments();
+      var name = it.getName().replace(/^.*#/, '');
+      for (var key in args) {
+        name += ' ' + args[key];
+        break;
+      }
+      names.push(name);
+    }
+    return names;
+  };
+
+  test('#getCheckpoint', function() {
+    var playback = createPlayback(20, function(n, events) {
+      events.push(['WebGLRenderingContext#clearColor', n, 0, 0, 1]);
+      if (n == 0) {
+        events.push(['WebGLRenderingContext#bindBuffer', 34962, 5]);
+        events.push(['WebGLRenderingContext#bufferData', 34962, 16, 35044]);
+      }
+      events.push(['WebGLRenderingContext#getError']);
+      events.push(['WebGLRenderingContext#drawArrays', 4, 0, 3]);
+    });
+    var manager = new wtf.replay.graphics.CheckpointManager(
+        playback.eventList, playback.steps);
+
+    // Too early for any checkpoints.
+    assert.isNull(manager.getCheckpoint(0));
+    assert.isNull(manager.getCheckpoint(8));
+
+    // The last step before the target is played in full.
+    var checkpoint = manager.getCheckpoint(9);
+    assert.equal(checkpoint.stepIndex, 8);
+    assert.equal(checkpoint.eventIndex,
+        playback.steps[8].getStartEventId());
+
+    // Only the latest clear color is needed. Draws to the default framebuffer
+    // and queries are not.
+    assert.deepEqual(getEventNames(playback.eventList, checkpoint), [
+      'createContext 1',
+      'setContext 1',
+      'createBuffer 5',
+      'bindBuffer 34962',
+      'bufferData 34962',
+      'clearColor 6'
+    ]);
+
+    assert.equal(manager.getCheckpoint(20).stepIndex, 16);
+    assert.equal(manager.getCheckpoint(16).stepIndex, 8);
+  });
+
+  test('framebufferDraws', function() {
+    var playback = createPlayback(10, function(n, events) {
+      events.push(['WebGLRenderingContext#clearColor', n, 0, 0, 1]);
+      events.push(['WebGLRenderingContext#bindFramebuffer', 36160, 7]);
+      events.push(['WebGLRenderingContext#drawArrays', 4, 0, 3]);
+      events.push(['WebGLRenderingContext#bindFramebuffer', 36160, 0]);
+      events.push(['WebGLRenderingContext#drawArrays', 4, 0, 3]);
+    });
+    var manager = new wtf.replay.graphics.CheckpointManager(
+        playback.eventList, playback.steps);
+
+    // Draws into the framebuffer object are kept, along with the state they
+    // use. Draws into the default framebuffer are not, so the binding of the
+    // default framebuffer is only needed at the end.
+    var names = getEventNames(
+        playback.eventList, manager.getCheckpoint(9));
+    assert.lengthOf(names, 3 + 7 * 3 + 1);
+    assert.deepEqual(names.slice(3, 7), [
+      'clearColor 0',
+      'bindFramebuffer 36160',
+      'drawArrays 4',
+      'clearColor 1'
+    ]);
+  });
+
+  test('#setMemoryBudget', function() {
+    var playback = createPlayback(40, function(n, events) {
+      events.push(['WebGLRenderingContext#clearColor', n, 0, 0, 1]);
+    });
+    var manager = new wtf.replay.graphics.CheckpointManager(
+        playback.eventList, playback.steps);
+    assert.equal(manager.getCheckpoint(41).stepIndex, 40);
+    var usage = manager.getMemoryUsage();
+    assert.isAbove(usage, 0);
+
+    // Halving the budget thins out the checkpoints.
+    manager.setMemoryBudget(usage / 2);
+    assert.isBelow(manager.getMemoryUsage(), usage / 2 + 1);
+    assert.equal(manager.getInterval(), 16);
+    assert.equal(manager.getCheckpoint(41).stepIndex, 32);
+    assert.equal(manager.getCheckpoint(32).stepIndex, 16);
+  });
+});
@@ -24,6 +24,7 @@ goog.require('goog.fs');
 goog.require('goog.object');
 goog.require('goog.webgl');
 goog.require('wtf.events.EventEmitter');
+goog.require('wtf.replay.graphics.CheckpointManager');
 goog.require('wtf.replay.graphics.ExtensionManager');
 goog.require('wtf.replay.graphics.Step');
 goog.require('wtf.timing.util');
@@ -65,11 +66,19 @@ wtf.replay.graphics.Playback = function(eventList, frameList, contextPool) {
   this.steps_ = this.constructStepsList_(eventList, frameList);
 
   /**
-   * Set of event type IDs of draw calls.
-   * @type {!Object.<number, boolean>}
+   * IDs of draw call events.
+   * @type {!wtf.db.EventBitmap}
    * @private
    */
-  this.drawCallIds_ = this.getDrawCallIds_();
+  this.drawCallEvents_ = this.getDrawCallEvents_();
+
+  /**
+   * Checkpoints used to speed up seeking.
+   * @type {!wtf.replay.graphics.CheckpointManager}
+   * @private
+   */
+  this.checkpoints_ =
+      new wtf.replay.graphics.CheckpointManager(eventList, this.steps_);
 
   /**
    * The index of the step that is about to be executed.
@@ -302,6 +311,27 @@ wtf.replay.graphics.Playback.prototype.setContextAttributeOverrides = function(
 };
 
 
+/**
+ * Gets the memory budget for seek checkpoints.
+ * @return {number} Maximum memory used by checkpoints, in bytes.
+ */
+wtf.replay.graphics.Playback.prototype.getCheckpointMemoryBudget =
+    function() {
+  return this.checkpoints_.getMemoryBudget();
+};
+
+
+/**
+ * Sets the memory budget for seek checkpoints. A larger budget keeps more
+ * checkpoints and makes seeking faster.
+ * @param {number} value Maximum memory used by checkpoints, in bytes.
+ */
+wtf.replay.graphics.Playback.prototype.setCheckpointMemoryBudget = function(
+    value) {
+  this.checkpoints_.setMemoryBudget(value);
+};
+
+
 /**
  * Gets the event list this playback is using.
  * @return {!wtf.db.EventList} Event list.
@@ -332,11 +362,11 @@ wtf.replay.graphics.Playback.prototype.constructCallLookupTable_ = function() {
 
 
 /**
- * Gets the set of draw call event IDs.
- * @return {!Object.<number, boolean>} A set of draw call event IDs.
+ * Gets the draw call events.
+ * @return {!wtf.db.EventBitmap} IDs of all draw call events.
  * @private
  */
-wtf.replay.graphics.Playback.prototype.getDrawCallIds_ = function() {
+wtf.replay.graphics.Playback.prototype.getDrawCallEvents_ = function() {
   var namesOfDrawEvents = [
     'WebGLRenderingContext#clear',
     'WebGLRenderingContext#drawArrays',
@@ -346,20 +376,20 @@ wtf.replay.graphics.Playback.prototype.getDrawCallIds_ = function() {
     'ANGLEInstancedArrays#drawArraysInstancedANGLE',
     'ANGLEInstancedArrays#drawElementsInstancedANGLE'
   ];
-  var drawCallIds = {};
+  var drawCallIds = [];
   var eventList = this.eventList_;
   for (var i = 0; i < namesOfDrawEvents.length; ++i) {
-    var eventId = eventList.getEventTypeId(namesOfDrawEvents[i]);
-    if (eventId >= 0) {
-      drawCallIds[eventId] = true;
-    }
+    drawCallIds.push(eventList.getEventTypeId(namesOfDrawEvents[i]));
   }
-  return drawCallIds;
+  return eventList.getTypeIndex().query(drawCallIds);
 };
 
 
 /**
  * Constructs a list of steps.
+ * Only frame and context events are visited. The runs of events between them
+ * are checked for visible events with the type index of the event list, so
+ * the cost depends on the number of frames instead of the number of events.
  * @param {!wtf.db.EventList} eventList A list of events.
  * @param {!wtf.db.FrameList} frameList A list of frames.
  * @return {!Array.<!wtf.replay.graphics.Step>} A list of steps.
@@ -368,9 +398,12 @@ wtf.replay.graphics.Playback.prototype.getDrawCallIds_ = function() {
 wtf.replay.graphics.Playback.prototype.constructStepsList_ = function(
     eventList, frameList) {
   var steps = [];
-  if (!eventList.getCount()) {
+  var eventCount = eventList.getCount();
+  if (!eventCount) {
     return steps;
   }
+  var typeIndex = eventList.getTypeIndex();
+  goog.asserts.assert(typeIndex.getIndexedCount() == eventCount);
 
   // Get the set of IDs of events that should be displayed.
   // TODO(benvanik): make this list easier to add to.
@@ -378,6 +411,11 @@ wtf.replay.graphics.Playback.prototype.constructStepsList_ = function(
       /^((WebGLRenderingContext#)|(wtf.webgl#)|(ANGLEInstancedArrays#))/;
   var displayedEventsIds =
       this.eventList_.eventTypeTable.getSetMatching(visibleEventsRegex);
+  var displayedEventsIdList = [];
+  for (var typeId in displayedEventsIds) {
+    displayedEventsIdList.push(Number(typeId));
+  }
+  var visibleEvents = typeIndex.query(displayedEventsIdList);
 
   // Get the IDs for start/end frame events if those IDs exist.
   var frameStartEventId =
@@ -389,6 +427,16 @@ wtf.replay.graphics.Playback.prototype.constructStepsList_ = function(
   var contextSetEventId =
       eventList.getEventTypeId('wtf.webgl#setContext');
 
+  // Events that start or end steps or change contexts, in order.
+  // The event count is added to handle the events after the last one.
+  var boundaryIds = typeIndex.query([
+    frameStartEventId,
+    frameEndEventId,
+    contextCreatedEventId,
+    contextSetEventId
+  ]).toArray();
+  boundaryIds.push(eventCount);
+
   var it = eventList.begin();
   var currentStartId = it.getId();
   var currentEndId = currentStartId;
@@ -409,7 +457,26 @@ wtf.replay.graphics.Playback.prototype.constructStepsList_ = function(
   var contextAdded = false;
   var contexts = {};
   var contextsMadeSoFar = {};
-  while (!it.done()) {
+
+  // The first event after the last boundary event.
+  var nextEventId = currentStartId;
+  for (var n = 0; n < boundaryIds.length; n++) {
+    var boundaryId = boundaryIds[n];
+    if (boundaryId > nextEventId) {
+      // The step has at least 1 event before this boundary.
+      currentEndId = boundaryId - 1;
+      noEventsForPreviousStep = false;
+      var visibleEventId = visibleEvents.nextValue(nextEventId);
+      if (visibleEventId != -1 && visibleEventId < boundaryId) {
+        visibleEventExists = true;
+      }
+    }
+    nextEventId = boundaryId + 1;
+    if (boundaryId == eventCount) {
+      break;
+    }
+
+    it.seek(boundaryId);
     var currentEventTypeId = it.getTypeId();
     if (currentEventTypeId == frameStartEventId) {
       // Only store previous step if it has at least 1 event.
@@ -424,7 +491,7 @@ wtf.replay.graphics.Playback.prototype.constructStepsList_ = function(
 
           var newStep = new wtf.replay.graphics.Step(
               eventList, currentStartId, currentEndId, null, contexts,
-              displayedEventsIds, stepBeginContext);
+              displayedEventsIds, stepBeginContext, visibleEvents);
           steps.push(newStep);
           contextAdded = false;
         }
@@ -432,8 +499,7 @@ wtf.replay.graphics.Playback.prototype.constructStepsList_ = function(
         visibleEventExists = false;
         stepBeginContext = currentContext;
       }
-      currentStartId = it.getId();
-      it.next();
+      currentStartId = boundaryId;
     } else if (currentEventTypeId == frameEndEventId) {
       // Only include this step if it has visible events.
       if (visibleEventExists) {
@@ -443,8 +509,8 @@ wtf.replay.graphics.Playback.prototype.constructStepsList_ = function(
         }
 
         var newStep = new wtf.replay.graphics.Step(
-            eventList, currentStartId, it.getId(), currentFrame, contexts,
-            displayedEventsIds, stepBeginContext);
+            eventList, currentStartId, boundaryId, currentFrame, contexts,
+            displayedEventsIds, stepBeginContext, visibleEvents);
         steps.push(newStep);
         contextAdded = false;
       }
@@ -455,9 +521,8 @@ wtf.replay.graphics.Playback.prototype.constructStepsList_ = function(
       if (currentFrame) {
         currentFrame = frameList.getNextFrame(currentFrame);
       }
-      it.next();
-      if (!it.done()) {
-        currentStartId = it.getId();
+      if (nextEventId < eventCount) {
+        currentStartId = nextEventId;
       }
     } else if (currentEventTypeId == contextCreatedEventId) {
       // A new context was made. Include it in the current step.
@@ -466,21 +531,9 @@ wtf.replay.graphics.Playback.prototype.constructStepsList_ = function(
       currentContext = handleValue;
       visibleEventExists = true;
       contextAdded = true;
-      it.next();
     } else if (currentEventTypeId == contextSetEventId) {
       currentContext = /** @type {number} */ (it.getArgument('handle'));
       visibleEventExists = true;
-      it.next();
-    } else {
-      currentEndId = it.getId();
-
-      // This step has at least 1 event.
-      noEventsForPreviousStep = false;
-      if (displayedEventsIds[currentEventTypeId]) {
-        visibleEventExists = true;
-      }
-
-      it.next();
     }
   }
 
@@ -488,7 +541,7 @@ wtf.replay.graphics.Playback.prototype.constructStepsList_ = function(
   if (!noEventsForPreviousStep && visibleEventExists) {
     var newStep = new wtf.replay.graphics.Step(
         eventList, currentStartId, currentEndId, null, contexts,
-        displayedEventsIds, stepBeginContext);
+        displayedEventsIds, stepBeginContext, visibleEvents);
     steps.push(newStep);
   }
   return steps;
@@ -789,12 +842,33 @@ wtf.replay.graphics.Playback.prototype.fetchResources_ = function() {
       this.eventList_.getEventTypeId('WebGLRenderingContext#texSubImage2D');
 
   // Add deferreds for loading each resource.
+  // Events that upload the same data (the same trace resource or the same
+  // remote URL) share a single loaded resource, so each is decoded only once.
   var blobUrls = [];
+  var loadedEventIds = {};
   for (var it = this.eventList_.begin(); !it.done(); it.next()) {
     var typeId = it.getTypeId();
     if (typeId == texImage2DEventId || typeId == texSubImage2DEventId) {
       var args = it.getArguments();
       var dataType = args['dataType'];
+      var pixelsResource = args['pixelsResource'];
+      var loadKey = null;
+      if (pixelsResource) {
+        loadKey = dataType + ':' + pixelsResource;
+      } else if (dataType != 'canvas' && dataType != 'pixels' &&
+          dataType != 'null' && dataType.indexOf('image/') != 0) {
+        loadKey = dataType;
+      }
+      if (loadKey && loadKey in loadedEventIds) {
+        var loadedEventId = loadedEventIds[loadKey];
+        if (loadedEventId in this.resources_) {
+          this.resources_[it.getId()] = this.resources_[loadedEventId];
+        }
+        continue;
+      }
+      if (loadKey) {
+        loadedEventIds[loadKey] = it.getId();
+      }
       if (dataType == 'canvas') {
         // TODO(benvanik): use the canvas pool?
         var canvas = goog.dom.createElement(goog.dom.TagName.CANVAS);
@@ -993,16 +1067,23 @@ wtf.replay.graphics.Playback.prototype.pause = function() {
 
 
 /**
- * Seeks to an event. Does not realize the event yet. A backwards seek will
- * trigger a release of contexts and other WebGL objects. Does not update the
- * current Step. Pauses before seek if not paused already.
- * @param {number} targetEventIndex Index of the event to seek.
+ * Seeks to the start of a step for {@see #seekStep}. Does not realize the
+ * first event yet. A backwards seek will trigger a release of contexts and
+ * other WebGL objects. Does not update the current Step. Pauses before seek if
+ * not paused already.
+ *
+ * If there is a checkpoint between the current position and the target (or
+ * before the target when seeking backwards) the checkpoint is restored and
+ * only the events after it are played.
+ *
+ * @param {number} targetStepIndex Index of the step to seek to.
  * @private
  */
-wtf.replay.graphics.Playback.prototype.seekEvent_ = function(targetEventIndex) {
+wtf.replay.graphics.Playback.prototype.seekStep_ = function(targetStepIndex) {
   if (this.isPlaying()) {
     this.pause();
   }
+  var targetEventIndex = this.steps_[targetStepIndex].getStartEventId();
 
   var currentStep = this.getCurrentStep();
   if (!currentStep) {
@@ -1013,8 +1094,22 @@ wtf.replay.graphics.Playback.prototype.seekEvent_ = function(targetEventIndex) {
 
   // Compare event indices to determine which event came first.
   var currentIndex = currentStep.getStartEventId();
+  var isBackwardsSeek = currentIndex >= targetEventIndex;
+  var checkpoint = this.checkpoints_.getCheckpoint(targetStepIndex);
+  if (checkpoint && !isBackwardsSeek) {
+    // Only jump forwards if restoring is cheaper than playing up to it.
+    var eventsToPlay = checkpoint.eventIndex - currentIndex;
+    if (checkpoint.eventIndex <= currentIndex ||
+        checkpoint.events.length >= eventsToPlay) {
+      checkpoint = null;
+    }
+  }
+
   var startIndex;
-  if (currentIndex >= targetEventIndex) {
+  if (checkpoint) {
+    this.restoreCheckpoint_(checkpoint);
+    startIndex = checkpoint.eventIndex;
+  } else if (isBackwardsSeek) {
     // We are seeking to a previous step, so reset first.
     this.setToInitialState_();
     startIndex = this.getCurrentStep().getEventIterator().getIndex();
@@ -1043,6 +1138,25 @@ wtf.replay.graphics.Playback.prototype.seekEvent_ = function(targetEventIndex) {
 };
 
 
+/**
+ * Resets the playback and then plays the events of a checkpoint, recreating
+ * the state at the start of its step.
+ * @param {!wtf.replay.graphics.CheckpointManager.Checkpoint} checkpoint
+ *     Checkpoint to restore.
+ * @private
+ */
+wtf.replay.graphics.Playback.prototype.restoreCheckpoint_ = function(
+    checkpoint) {
+  this.setToInitialState_();
+  var events = checkpoint.events;
+  var it = this.eventList_.begin();
+  for (var n = 0; n < events.length; n++) {
+    it.seek(events[n]);
+    this.realizeEvent_(it);
+  }
+};
+
+
 /**
  * Seeks to the start of a step, but does not run the events in the step.
  * Pauses before seek if not paused already. Can only be called after
@@ -1061,7 +1175,7 @@ wtf.replay.graphics.Playback.prototype.seekStep = function(index) {
   var currentStepChanges = index != currentStepIndex;
   var isBackwardsSeek = index <= currentStepIndex;
 
-  this.seekEvent_(this.steps_[index].getStartEventId());
+  this.seekStep_(index);
   this.subStepId_ = -1;
   this.currentStepIndex_ = index;
 
@@ -1156,7 +1270,6 @@ wtf.replay.graphics.Playback.prototype.seekToPreviousDrawCall = function() {
         'Seek to previous draw call attempted with no current step.');
   }
 
-  var it = currentStep.getEventIterator(true);
   var eventJustFinishedIndex = this.subStepId_;
 
   if (eventJustFinishedIndex == -1) {
@@ -1164,15 +1277,15 @@ wtf.replay.graphics.Playback.prototype.seekToPreviousDrawCall = function() {
     return;
   }
 
-  --eventJustFinishedIndex;
-  while (eventJustFinishedIndex >= 0) {
-    it.seek(eventJustFinishedIndex);
-    if (this.drawCallIds_[it.getTypeId()]) {
+  if (eventJustFinishedIndex > 0) {
+    var it = currentStep.getEventIterator(true);
+    it.seek(eventJustFinishedIndex - 1);
+    var drawCallId = this.drawCallEvents_.previousValue(it.getId());
+    if (drawCallId >= currentStep.getStartEventId()) {
       // Found a previous draw call. Seek to it.
-      this.seekSubStepEvent(eventJustFinishedIndex);
+      this.seekSubStepEvent(currentStep.getVisibleEventIndex(drawCallId));
       return;
     }
-    --eventJustFinishedIndex;
   }
 
   // No previous draw call found. Seek to the start of the step.
@@ -1195,13 +1308,22 @@ wtf.replay.graphics.Playback.prototype.seekToNextDrawCall = function() {
   var it = currentStep.getEventIterator(true);
   var eventJustFinished = this.subStepId_;
 
-  // Keep calling events in the step until either the step is done or we
-  // encounter a draw call.
+  // Find the next draw call in the step, if any.
   it.seek(eventJustFinished + 1);
+  var drawCallIndex = -1;
+  if (!it.done()) {
+    var drawCallId = this.drawCallEvents_.nextValue(it.getId());
+    if (drawCallId != -1 && drawCallId <= currentStep.getEndEventId()) {
+      drawCallIndex = currentStep.getVisibleEventIndex(drawCallId);
+    }
+  }
+
+  // Keep calling events in the step until either the step is done or we
+  // reach the draw call.
   while (!it.done()) {
     this.realizeEvent_(it);
-    if (this.drawCallIds_[it.getTypeId()]) {
-      this.subStepId_ = it.getIndex();
+    if (it.getIndex() == drawCallIndex) {
+      this.subStepId_ = drawCallIndex;
       this.emitEvent(
           wtf.replay.graphics.Playback.EventType.SUB_STEP_EVENT_CHANGED);
       return;
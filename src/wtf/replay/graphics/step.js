@@ -14,6 +14,7 @@
 
 goog.provide('wtf.replay.graphics.Step');
 
+goog.require('goog.array');
 goog.require('wtf.db.EventIterator');
 
 
@@ -32,11 +33,14 @@ goog.require('wtf.db.EventIterator');
  *     types that should be visible.
  * @param {number=} opt_stepBeginContext The handle of the current context at
  *     the beginning of the step. If no current context exists, -1.
+ * @param {wtf.db.EventBitmap=} opt_visibleEvents IDs of all visible events in
+ *     the event list. If given, this is used instead of scanning the step for
+ *     events of the visible types.
  * @constructor
  */
 wtf.replay.graphics.Step = function(
     eventList, startEventId, endEventId, opt_frame, opt_contexts,
-    opt_visibleEventTypeIds, opt_stepBeginContext) {
+    opt_visibleEventTypeIds, opt_stepBeginContext, opt_visibleEvents) {
 
   /**
    * List of events for entire animation.
@@ -66,6 +70,21 @@ wtf.replay.graphics.Step = function(
    */
   this.visibleEventTypeIds_ = opt_visibleEventTypeIds || {};
 
+  /**
+   * IDs of all visible events in the event list, if known.
+   * @type {wtf.db.EventBitmap}
+   * @private
+   */
+  this.allVisibleEvents_ = opt_visibleEvents || null;
+
+  /**
+   * Sorted IDs of the visible events in the step.
+   * Built the first time visible events are requested.
+   * @type {Array.<number>}
+   * @private
+   */
+  this.visibleEvents_ = null;
+
   /**
    * Either the frame this step draws or null if this step is not responsible
    *     for drawing a frame.
@@ -99,7 +118,7 @@ wtf.replay.graphics.Step = function(
  */
 wtf.replay.graphics.Step.prototype.getEventIterator = function(opt_visible) {
   if (opt_visible) {
-    var indirectionTable = this.createVisibleEventsList_();
+    var indirectionTable = this.getVisibleEvents_();
     return new wtf.db.EventIterator(
         this.eventList_, 0, indirectionTable.length - 1, 0, indirectionTable);
   }
@@ -168,20 +187,43 @@ wtf.replay.graphics.Step.prototype.getEndEventId = function() {
 };
 
 
+/**
+ * Gets the index of an event within the visible events of the step.
+ * This is the index used by visible event iterators.
+ * @param {number} eventId Event ID.
+ * @return {number} The 0-based index of the event or -1 if the event is not a
+ *     visible event of the step.
+ */
+wtf.replay.graphics.Step.prototype.getVisibleEventIndex = function(eventId) {
+  var index = goog.array.binarySearch(this.getVisibleEvents_(), eventId);
+  return index >= 0 ? index : -1;
+};
+
+
 /**
  * Gets a list of indices of visible events.
  * @return {!Array.<number>} A list of indices of visible events.
  * @private
  */
-wtf.replay.graphics.Step.prototype.createVisibleEventsList_ = function() {
-  // Filter for only visible events.
+wtf.replay.graphics.Step.prototype.getVisibleEvents_ = function() {
+  if (this.visibleEvents_) {
+    return this.visibleEvents_;
+  }
+
   var visibleEvents = [];
-  for (var it = this.getEventIterator(); !it.done(); it.next()) {
-    if (this.visibleEventTypeIds_[it.getTypeId()]) {
-      visibleEvents.push(it.getIndex());
+  if (this.allVisibleEvents_) {
+    this.allVisibleEvents_.slice(
+        this.startEventId_, this.endEventId_ + 1).toArray(visibleEvents);
+  } else {
+    // Filter for only visible events.
+    for (var it = this.getEventIterator(); !it.done(); it.next()) {
+      if (this.visibleEventTypeIds_[it.getTypeId()]) {
+        visibleEvents.push(it.getIndex());
+      }
     }
   }
 
+  this.visibleEvents_ = visibleEvents;
   return visibleEvents;
 };
 
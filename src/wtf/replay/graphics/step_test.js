@@ -7,6 +7,7 @@
 
 goog.provide('wtf.replay.graphics.Step_test');
 
+goog.require('wtf.db.EventBitmap');
 goog.require('wtf.db.Frame');
 goog.require('wtf.replay.graphics.Step');
 goog.require('wtf.testing');
@@ -55,4 +56,38 @@ wtf.replay.graphics.Step_test = suite('wtf.replay.graphics.Step', function() {
     assert.equal(frame.getNumber(), 1);
     assert.isNull(stepWithNoFrame.getFrame());
   });
+
+  test('#getVisibleEventIndex', function() {
+    var eventList = wtf.testing.createEventList({
+      instanceEventTypes: [
+        'visibleEvent()',
+        'someInstanceEvent()'
+      ],
+      events: [
+        [0, 'visibleEvent'],
+        [10, 'someInstanceEvent'],
+        [20, 'visibleEvent'],
+        [30, 'visibleEvent'],
+        [40, 'someInstanceEvent']
+      ]});
+    var visibleTypeId = eventList.getEventTypeId('visibleEvent');
+    var visibleTypeIds = {};
+    visibleTypeIds[visibleTypeId] = true;
+
+    // Visible events are found either by scanning or from a bitmap.
+    var scannedStep = new wtf.replay.graphics.Step(
+        eventList, 1, 4, undefined, undefined, visibleTypeIds);
+    var indexedStep = new wtf.replay.graphics.Step(
+        eventList, 1, 4, undefined, undefined, undefined, -1,
+        eventList.getTypeIndex().getBitmap(visibleTypeId));
+    [scannedStep, indexedStep].forEach(function(step) {
+      var it = step.getEventIterator(true);
+      assert.equal(it.getCount(), 2);
+      assert.equal(it.getId(), 2);
+      assert.equal(step.getVisibleEventIndex(2), 0);
+      assert.equal(step.getVisibleEventIndex(3), 1);
+      assert.equal(step.getVisibleEventIndex(0), -1);
+      assert.equal(step.getVisibleEventIndex(4), -1);
+    });
+  });
 });
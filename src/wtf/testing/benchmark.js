@@ -12,10 +12,13 @@
  *
  * The only safe functions to use:
  * reportBenchmarkResult(benchmarkName, {
+ *   mode: string,
+ *   providers: boolean,
  *   runCount: number,
  *   totalTime: number,
  *   userTime: number,
- *   meanTime: number
+ *   meanTime: number,
+ *   relativeMarginOfError: number
  * });
  * reportBenchmarkError(msg, opt_benchmarkName);
  *
@@ -75,20 +78,51 @@
   };
 
 
+  /**
+   * Session modes benchmarks can be run under.
+   * Each maps to the options used to start the session.
+   * @type {!Object.<!Object>}
+   */
+  var MODES = {
+    'null': {
+      'wtf.trace.mode': 'null'
+    },
+    'snapshotting': {
+      'wtf.trace.mode': 'snapshotting',
+      'wtf.trace.target': 'file://'
+    },
+    'streaming': {
+      'wtf.trace.mode': 'streaming',
+      'wtf.trace.target': 'null'
+    }
+  };
+
+
+  /**
+   * Names of all session modes, in the order they are run.
+   * @type {!Array.<string>}
+   */
+  exports.MODES = ['null', 'snapshotting', 'streaming'];
+
+
   /**
    * Runs a list of benchmarks.
+   * Each benchmark is run once per session mode. Results are reported with
+   * {@code reportBenchmarkResult} as they complete and are also passed to
+   * {@code opt_options.onComplete} once all modes have run.
+   *
    * @param {Array.<string>=} opt_names Benchmarks to run. Can include regex
    *     strings if formated as '/foo/i'. Omit to run all benchmarks.
+   * @param {{
+   *   modes: (Array.<string>|undefined),
+   *   providers: (boolean|undefined),
+   *   onComplete: (function(!Array.<!Object>)|undefined)
+   * }=} opt_options Run options. {@code modes} defaults to all modes and
+   *     {@code providers} enables the instrumentation providers.
    */
-  exports.run = function(opt_names) {
-    var suite = new Benchmark.Suite('WTF', {
-      'onCycle': function(e) {
-        //console.log(e);
-      },
-      'onError': function(e) {
-        console.log(e);
-      }
-    });
+  exports.run = function(opt_names, opt_options) {
+    var options = opt_options || {};
+    var modes = options.modes || exports.MODES;
 
     // TODO(benvanik): support regex names
     var names = opt_names || [];
@@ -109,6 +143,61 @@
     // TODO(benvanik): sort by namespaces?
     names.sort();
 
+    for (var n = 0; n < modes.length; n++) {
+      if (!MODES[modes[n]]) {
+        reportBenchmarkError('Unknown session mode "' + modes[n] + '".');
+        return;
+      }
+    }
+
+    // Providers can only be setup once, so they apply to all modes.
+    wtf.trace.prepare({
+      'wtf.trace.disableProviders': !options.providers
+    });
+
+    var results = [];
+    var modeIndex = 0;
+    function runNextMode() {
+      if (modeIndex >= modes.length) {
+        wtf.trace.stop();
+        if (options.onComplete) {
+          options.onComplete(results);
+        }
+        return;
+      }
+      var mode = modes[modeIndex++];
+      wtf.trace.start(MODES[mode]);
+
+      var suite = createSuite(mode, names, !!options.providers, results);
+      suite.on('complete', runNextMode);
+      suite.run({
+        'async': true,
+        'delay': 1,
+        'initCount': 10000
+      });
+    };
+    runNextMode();
+  };
+
+
+  /**
+   * Creates a suite that runs the given benchmarks in the current session.
+   * @param {string} mode Session mode name.
+   * @param {!Array.<string>} names Benchmark names.
+   * @param {boolean} providers Whether providers are enabled.
+   * @param {!Array.<!Object>} results Array to add results to.
+   * @return {!Object} Benchmark.js suite.
+   */
+  function createSuite(mode, names, providers, results) {
+    var suite = new Benchmark.Suite('WTF', {
+      'onCycle': function(e) {
+        //console.log(e);
+      },
+      'onError': function(e) {
+        console.log(e);
+      }
+    });
+
     for (var n = 0; n < names.length; n++) {
       var entry = registeredBenchmarks[names[n]];
       if (!entry) {
@@ -126,30 +215,25 @@
             wtf.trace.reset();
           },
           'onComplete': function() {
-            reportBenchmarkResult(this.name, {
+            var data = {
+              mode: mode,
+              providers: providers,
               runCount: this.count,
               totalTime: this.times.elapsed,
               userTime: this.times.elapsed,
-              meanTime: this.stats.mean
+              meanTime: this.stats.mean,
+              relativeMarginOfError: this.stats.rme
+            };
+            results.push({
+              name: this.name,
+              data: data
             });
+            reportBenchmarkResult(this.name, data);
           }
         });
       })(entry);
     }
-
-    var options = {
-      'wtf.trace.mode': 'snapshotting',
-      'wtf.trace.target': 'file://',
-      'wtf.trace.disableProviders': true
-    };
-    wtf.trace.prepare(options);
-    wtf.trace.start();
-
-    suite.run({
-      'async': true,
-      'delay': 1,
-      'initCount': 10000
-    });
+    return suite;
   };
 
 }(this, typeof exports === 'undefined' ? this.benchmark = {} : exports));
@@ -41,6 +41,14 @@ wtf.trace.BuiltinEvents = {
       'wtf.trace#discontinuity()',
       wtf.data.EventFlag.BUILTIN),
 
+  /**
+   * Records how many events were lost during a discontinuity.
+   * This immediately follows the discontinuity event it describes.
+   */
+  dropped: wtf.trace.events.createInstance(
+      'wtf.trace#dropped(uint32 count, uint32 bytes)',
+      wtf.data.EventFlag.BUILTIN),
+
   /**
    * Creates an execution zone.
    */
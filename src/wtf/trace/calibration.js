@@ -0,0 +1,185 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/**
+ * @fileoverview Tracing overhead calibration.
+ * Measures the cost of recording events on the current machine so that
+ * analysis tools can estimate how much of a trace is tracing overhead.
+ *
+ * @author benvanik@google.com (Ben Vanik)
+ */
+
+goog.provide('wtf.trace.calibration');
+
+goog.require('wtf');
+goog.require('wtf.data.EventClass');
+goog.require('wtf.data.Variable');
+goog.require('wtf.io.BufferView');
+goog.require('wtf.trace.EventSessionContext');
+goog.require('wtf.trace.EventType');
+goog.require('wtf.trace.EventTypeBuilder');
+
+
+/**
+ * Measured event costs.
+ * All values are in nanoseconds.
+ * {@code arguments} maps argument type names to the cost each argument of
+ * that type adds to an event. The cost of reading the time is not included,
+ * as file headers already record it as {@code nowTimeNs}.
+ * @typedef {{
+ *   instance: number,
+ *   scope: number,
+ *   arguments: !Object.<number>
+ * }}
+ */
+wtf.trace.calibration.Costs;
+
+
+/**
+ * Sample values used when measuring argument types.
+ * Strings and arrays are short, as they are in most traces.
+ * @type {!Object.<*>}
+ * @private
+ */
+wtf.trace.calibration.ARGUMENT_SAMPLES_ = {
+  'bool': true,
+  'int8': -12,
+  'uint8': 12,
+  'int16': -1234,
+  'uint16': 1234,
+  'int32': -123456,
+  'uint32': 123456,
+  'float32': 1.5,
+  'ascii': 'calibration',
+  'utf8': 'calibration',
+  'uint8[]': new Uint8Array(16),
+  'uint32[]': new Uint32Array(16),
+  'float32[]': new Float32Array(16),
+  'any': {'value': 1}
+};
+
+
+/**
+ * Number of events recorded per measurement round.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.trace.calibration.ITERATIONS_ = 10000;
+
+
+/**
+ * Number of measurement rounds. The fastest round is used, as the others
+ * include JIT time and interruptions.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.trace.calibration.ROUNDS_ = 5;
+
+
+/**
+ * Cached costs, once measured.
+ * @type {wtf.trace.calibration.Costs?}
+ * @private
+ */
+wtf.trace.calibration.costs_ = null;
+
+
+/**
+ * Gets the event costs on this machine, measuring them on first use.
+ * Measuring takes a few tens of milliseconds.
+ * @return {!wtf.trace.calibration.Costs} Event costs.
+ */
+wtf.trace.calibration.getCosts = function() {
+  if (!wtf.trace.calibration.costs_) {
+    wtf.trace.calibration.costs_ = wtf.trace.calibration.measure();
+  }
+  return wtf.trace.calibration.costs_;
+};
+
+
+/**
+ * Measures the event costs on this machine.
+ *
+ * Events are generated exactly as they are for real sessions but are bound to
+ * a private context that writes to a scratch buffer, so nothing is recorded
+ * in the active session. Scope costs are the cost of the enter and leave
+ * events and do not include the scope stack bookkeeping.
+ *
+ * @return {!wtf.trace.calibration.Costs} Event costs.
+ */
+wtf.trace.calibration.measure = function() {
+  var scratchBuffer = wtf.io.BufferView.createEmpty(64 * 1024);
+  var scratchSession = {
+    'acquireBuffer': function(time, size) {
+      wtf.io.BufferView.reset(scratchBuffer);
+      return scratchBuffer;
+    },
+    'enterTypedScope': function(time) {
+      return null;
+    }
+  };
+  var context = wtf.trace.EventSessionContext.create();
+  wtf.trace.EventSessionContext.init(context,
+      /** @type {wtf.trace.Session} */ (/** @type {Object} */ (
+          scratchSession)));
+  wtf.trace.EventSessionContext.setBuffer(context, scratchBuffer);
+
+  var builder = new wtf.trace.EventTypeBuilder();
+  function generate(eventClass, opt_typeName) {
+    var args = opt_typeName ?
+        [new wtf.data.Variable('value', opt_typeName)] : [];
+    var eventType = new wtf.trace.EventType(
+        'wtf.calibration#event', eventClass, 0, args);
+    return builder.generate(context, eventType);
+  };
+
+  // The first measurement also pays for warming up the shared code (like the
+  // time source), so the base cost is measured twice.
+  var instanceFn = generate(wtf.data.EventClass.INSTANCE);
+  wtf.trace.calibration.time_(instanceFn);
+  var instanceNs = wtf.trace.calibration.time_(instanceFn);
+  var enterNs = wtf.trace.calibration.time_(
+      generate(wtf.data.EventClass.SCOPE));
+
+  var argumentCosts = {};
+  var samples = wtf.trace.calibration.ARGUMENT_SAMPLES_;
+  for (var typeName in samples) {
+    var ns = wtf.trace.calibration.time_(
+        generate(wtf.data.EventClass.INSTANCE, typeName), samples[typeName]);
+    argumentCosts[typeName] = Math.max(0, ns - instanceNs);
+  }
+
+  return {
+    'instance': instanceNs,
+    // Leave events are argument-less instance events.
+    'scope': enterNs + instanceNs,
+    'arguments': argumentCosts
+  };
+};
+
+
+/**
+ * Times calls to an event function.
+ * @param {Function} fn Generated event function.
+ * @param {*=} opt_value Argument value, if the event takes one.
+ * @return {number} Cost per call, in nanoseconds.
+ * @private
+ */
+wtf.trace.calibration.time_ = function(fn, opt_value) {
+  var iterations = wtf.trace.calibration.ITERATIONS_;
+  var bestDuration = Number.MAX_VALUE;
+  for (var n = 0; n < wtf.trace.calibration.ROUNDS_; n++) {
+    var startTime = wtf.now();
+    for (var m = 0; m < iterations; m++) {
+      fn(opt_value);
+    }
+    bestDuration = Math.min(bestDuration, wtf.now() - startTime);
+  }
+  return Math.round(bestDuration * 1000 * 1000 / iterations); // ms -> ns
+};
@@ -18,7 +18,7 @@ goog.provide('wtf.trace.eventtarget.EventRegistration');
 
 goog.require('goog.userAgent');
 goog.require('wtf.data.webidl');
-goog.require('wtf.trace.Scope');
+goog.require('wtf.trace.Sampler');
 goog.require('wtf.trace.events');
 
 
@@ -135,7 +135,7 @@ wtf.trace.eventtarget.getEventNames = function(target) {
  *   prefix: string,
  *   eventTypes: !Object.<!Object>,
  *   eventNames: !Array.<string>,
- *   eventMap: !Object.<Function>,
+ *   eventMap: !Object.<!wtf.trace.Sampler.Site>,
  *   eventInfos: !Array.<!{
  *     name: string,
  *     scopeEvent: Function,
@@ -154,9 +154,12 @@ wtf.trace.eventtarget.Descriptor;
  * @param {string} prefix Event name prefix.
  * @param {!Object.<Object>} eventTypes All event types, such as 'load', mapped
  *     to their event type descriptor from {@see wtf.data.webidl}.
+ * @param {wtf.trace.Sampler=} opt_sampler Sampler for event dispatches. If
+ *     omitted every dispatch is recorded.
  * @return {!wtf.trace.eventtarget.Descriptor} Event target descriptor.
  */
-wtf.trace.eventtarget.createDescriptor = function(prefix, eventTypes) {
+wtf.trace.eventtarget.createDescriptor = function(
+    prefix, eventTypes, opt_sampler) {
   var eventMap = {};
 
   var eventNames = [];
@@ -169,7 +172,10 @@ wtf.trace.eventtarget.createDescriptor = function(prefix, eventTypes) {
         prefix, eventName, eventType);
     var scopeEvent = wtf.trace.events.createScope(
         signature);
-    eventMap[eventName] = scopeEvent;
+    var siteName = prefix + '#on' + eventName;
+    eventMap[eventName] = opt_sampler ?
+        opt_sampler.createSite(siteName, scopeEvent) :
+        wtf.trace.Sampler.createDefaultSite(siteName, scopeEvent);
 
     var hiddenName = '__wtf_event_value_' + eventName;
     eventInfos.push({
@@ -242,30 +248,15 @@ wtf.trace.eventtarget.mixin = function(descriptor, target) {
        */
       function(type, listener, opt_capture) {
     var self = this || goog.global;
-    var eventType = descriptor.eventMap[type];
-    if (!eventType || self['__wtf_ignore__'] || listener['__wtf_ignore__']) {
+    var site = descriptor.eventMap[type];
+    if (!site || self['__wtf_ignore__'] || listener['__wtf_ignore__']) {
       // Ignored - do a normal add.
       originalAddEventListener.call(self, type, listener, opt_capture);
       return;
     }
 
-    var wrappedEventListener = function wrappedEventListener(e) {
-      if (e['__wtf_ignore__']) {
-        return;
-      }
-      var scope = self['__wtf_ignore__'] ? null : eventType();
-      try {
-        if (listener['handleEvent']) {
-          // Listener is an EventListener.
-          listener.handleEvent(e);
-        } else {
-          // Listener is a function.
-          return listener.apply(self, arguments);
-        }
-      } finally {
-        wtf.trace.Scope.leave(scope);
-      }
-    };
+    var wrappedEventListener = new wtf.trace.eventtarget.WrappedListener_(
+        self, listener, site);
     listener['__wrapped__'] = wrappedEventListener;
     originalAddEventListener.call(
         self, type, wrappedEventListener, opt_capture);
@@ -284,6 +275,69 @@ wtf.trace.eventtarget.mixin = function(descriptor, target) {
 };
 
 
+
+/**
+ * Listener added in place of a user listener to trace its dispatches.
+ * The dispatch logic is shared on the prototype so that adding a listener does
+ * not create any closures.
+ * @param {!Object} target Object the listener was added to.
+ * @param {!EventListener|Function} listener User listener.
+ * @param {!wtf.trace.Sampler.Site} site Dispatch site of the event type.
+ * @constructor
+ * @private
+ */
+wtf.trace.eventtarget.WrappedListener_ = function(target, listener, site) {
+  /**
+   * Object the listener was added to.
+   * @type {!Object}
+   * @private
+   */
+  this.target_ = target;
+
+  /**
+   * User listener.
+   * @type {!EventListener|Function}
+   * @private
+   */
+  this.listener_ = listener;
+
+  /**
+   * Dispatch site of the event type.
+   * @type {!wtf.trace.Sampler.Site}
+   * @private
+   */
+  this.site_ = site;
+};
+
+
+/**
+ * Handles an event by calling the user listener in a scope.
+ * @param {!Event} e Event.
+ */
+wtf.trace.eventtarget.WrappedListener_.prototype['handleEvent'] = function(e) {
+  if (e['__wtf_ignore__']) {
+    return;
+  }
+  var self = this.target_;
+  var listener = this.listener_;
+  var site = self['__wtf_ignore__'] ? null : this.site_;
+  var scope = site ? site.enter() : null;
+  try {
+    if (listener['handleEvent']) {
+      // Listener is an EventListener.
+      listener.handleEvent(e);
+    } else {
+      // Listener is a function.
+      listener.call(self, e);
+    }
+  } finally {
+    if (site) {
+      site.leave(scope);
+    }
+  }
+};
+
+
 /**
  * Sets the on* event properties on the given target prototype.
  * The {@see #initializeEventProperties} method must be called on instances of
@@ -530,6 +584,18 @@ wtf.trace.eventtarget.BaseEventTarget.prototype.setEventHook = function(
 };
 
 
+/**
+ * Handles events from the underlying native object.
+ * Subclasses can add themselves as the listener for tracked event types to
+ * forward them through {@see #dispatchEvent} without a closure per type.
+ * @param {Event} e Event.
+ * @this {wtf.trace.eventtarget.BaseEventTarget}
+ */
+wtf.trace.eventtarget.BaseEventTarget.prototype['handleEvent'] = function(e) {
+  this['dispatchEvent'](e);
+};
+
+
 /**
  * Dispatches an event.
  * @param {Event} e Event.
@@ -577,12 +643,13 @@ wtf.trace.eventtarget.BaseEventTarget.prototype.dispatchToListener = function(
   }
 
   // Begin tracing scope.
-  var eventKey = e.type;
-  var eventType = this.descriptor_.eventMap[eventKey];
-  var scope = this['__wtf_ignore__'] ? null : (eventType ? eventType() : null);
+  var site = this['__wtf_ignore__'] ?
+      null : (this.descriptor_.eventMap[e.type] || null);
+  var scope = site ? site.enter() : null;
 
   // Callback registered hooks.
-  if (hooks && hooks.length) {
+  // Hooks append scope data, so they are skipped for unrecorded dispatches.
+  if (scope && hooks && hooks.length) {
     for (var n = 0; n < hooks.length; n++) {
       hooks[n].callback.call(hooks[n].scope, e);
     }
@@ -598,7 +665,9 @@ wtf.trace.eventtarget.BaseEventTarget.prototype.dispatchToListener = function(
       listener.call(this, e);
     }
   } finally {
-    wtf.trace.Scope.leave(scope);
+    if (site) {
+      site.leave(scope);
+    }
   }
 };
 
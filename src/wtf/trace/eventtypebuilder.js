@@ -56,34 +56,49 @@ wtf.trace.EventTypeBuilder.prototype.generate = function(context, eventType) {
   // [0] = wtf.trace.Session?
   // [1] = wtf.io.BufferView.Type?
 
+  // Fixed-size events get a specialized fast path, as they are the most
+  // common (scopes/instance events with only scalar and string arguments).
+  // Types that allocate (like 'any') always take the general path.
+  var fixedSize = true;
+  var args = eventType.args;
+  for (var n = 0; n < args.length; n++) {
+    var writer = writers[args[n].typeName];
+    if (!writer || !writer.size || writer.computeSize ||
+        writer == wtf.trace.EventTypeBuilder.WRITE_ANY_) {
+      fixedSize = false;
+      break;
+    }
+  }
+
   // Begin building the function with default args.
   this.begin();
   this.addScopeVariable('context', context);
   this.addScopeVariable('eventType', eventType);
-  this.addScopeVariable('now', wtf.now);
-  this.addScopeVariable('stringify', function(value) {
-    // TODO(benvanik): make this even faster.
-    var json = null;
-    if (typeof value == 'number') {
-      json = '' + value;
-    } else if (typeof value == 'boolean') {
-      json = '' + value;
-    } else if (!value) {
-      json = null;
-    } else {
-      // JSON is faster and generates less garbage.
-      if (goog.global.JSON) {
-        json = goog.global.JSON.stringify(value);
+  if (!fixedSize) {
+    this.addScopeVariable('stringify', function(value) {
+      // TODO(benvanik): make this even faster.
+      var json = null;
+      if (typeof value == 'number') {
+        json = '' + value;
+      } else if (typeof value == 'boolean') {
+        json = '' + value;
+      } else if (!value) {
+        json = null;
       } else {
-        json = goog.json.serialize(value);
+        // JSON is faster and generates less garbage.
+        if (goog.global.JSON) {
+          json = goog.global.JSON.stringify(value);
+        } else {
+          json = goog.json.serialize(value);
+        }
       }
-    }
-    return json;
-  });
+      return json;
+    });
+  }
 
   // Fetch the time as early as possible.
-  // TODO(benvanik): inline now code (instead of using wtf.now)
-  this.append('var time = (opt_time === undefined) ? now() : opt_time;');
+  this.append('var time = (opt_time === undefined) ? ' +
+      this.addTimeSource_(fixedSize) + ' : opt_time;');
 
   // Count.
   this.append('eventType.' + this.eventTypeNames_.count + '++;');
@@ -98,7 +113,6 @@ wtf.trace.EventTypeBuilder.prototype.generate = function(context, eventType) {
   };
   var minSize = 4 + 4;
   var sizeExpressions = [];
-  var args = eventType.args;
   for (var n = 0; n < args.length; n++) {
     var arg = args[n];
 
@@ -130,31 +144,50 @@ wtf.trace.EventTypeBuilder.prototype.generate = function(context, eventType) {
       this.append.apply(this, writer.setup(arg.name + '_'));
     }
   }
+  var size;
   if (sizeExpressions.length) {
     this.append(
         'var size = ' + minSize + ' + ' + sizeExpressions.join(' + ') + ';');
+    size = 'size';
   } else {
-    this.append(
-        'var size = ' + minSize + ';');
+    size = String(minSize);
   }
 
   // Additional optional arguments.
   this.addArgument('opt_time');
   this.addArgument('opt_buffer');
 
-  // TODO(benvanik): optimize this.
   this.append(
       'var buffer = opt_buffer || context[1];',
       'var session = context[0];',
-      'if (!buffer || buffer.capacity - buffer.offset < size) {',
-      '  buffer = session ? session.acquireBuffer(time, size) : null;',
+      'if (!buffer || buffer.capacity - buffer.offset < ' + size + ') {',
+      '  buffer = session ? session.acquireBuffer(time, ' + size + ') : null;',
       '  context[1] = buffer;',
       '}',
       'if (!buffer || !session) return undefined;');
 
   // Add all buffer getters.
-  for (var name in requiredBuffers) {
-    this.append('var ' + name + ' = buffer.' + name + ';');
+  if (fixedSize) {
+    // Views are cached across calls and only refetched when the buffer
+    // changes, which is rare.
+    var viewNames = [];
+    for (var name in requiredBuffers) {
+      viewNames.push(name);
+    }
+    this.addScopeVariable('views', new Array(1 + viewNames.length));
+    var refetch = ['if (views[0] !== buffer) {', '  views[0] = buffer;'];
+    for (var n = 0; n < viewNames.length; n++) {
+      refetch.push('  views[' + (n + 1) + '] = buffer.' + viewNames[n] + ';');
+    }
+    refetch.push('}');
+    this.append.apply(this, refetch);
+    for (var n = 0; n < viewNames.length; n++) {
+      this.append('var ' + viewNames[n] + ' = views[' + (n + 1) + '];');
+    }
+  } else {
+    for (var name in requiredBuffers) {
+      this.append('var ' + name + ' = buffer.' + name + ';');
+    }
   }
 
   // Write event header.
@@ -212,6 +245,25 @@ wtf.trace.EventTypeBuilder.prototype.generate = function(context, eventType) {
 };
 
 
+/**
+ * Adds the scope variables needed to read the current time.
+ * @param {boolean} inline Whether to inline the time source, if possible.
+ * @return {string} Expression that evaluates to the current time.
+ * @private
+ */
+wtf.trace.EventTypeBuilder.prototype.addTimeSource_ = function(inline) {
+  // wtf.now is performance.now when it's available, so call it directly and
+  // save a closure call. Other time sources (such as on node) need wtf.now.
+  var performance = goog.global['performance'];
+  if (inline && !wtf.NODE && performance && performance['now']) {
+    this.addScopeVariable('performance', performance);
+    return 'performance.now()';
+  }
+  this.addScopeVariable('now', wtf.now);
+  return 'now()';
+};
+
+
 /**
  * @typedef {{
  *   uses: !Array.<string>,
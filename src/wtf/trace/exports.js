@@ -30,6 +30,7 @@ goog.require('wtf.trace');
 goog.require('wtf.trace.Flow');
 /** @suppress {extraRequire} */
 goog.require('wtf.trace.Scope');
+goog.require('wtf.trace.calibration');
 goog.require('wtf.trace.events');
 goog.require('wtf.trace.instrument');
 goog.require('wtf.trace.instrumentType');
@@ -170,4 +171,9 @@ if (wtf.trace.exports.ENABLE_EXPORTS) {
   goog.exportSymbol(
       'wtf.trace.instrumentTypeSimple',
       wtf.trace.instrumentTypeSimple);
+
+  // Overhead calibration
+  goog.exportSymbol(
+      'wtf.trace.calibration.getCosts',
+      wtf.trace.calibration.getCosts);
 }
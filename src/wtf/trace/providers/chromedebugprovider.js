@@ -13,6 +13,7 @@
 
 goog.provide('wtf.trace.providers.ChromeDebugProvider');
 
+goog.require('goog.asserts');
 goog.require('goog.async.Deferred');
 goog.require('goog.dom');
 goog.require('goog.dom.TagName');
@@ -21,11 +22,24 @@ goog.require('wtf');
 goog.require('wtf.data.EventFlag');
 goog.require('wtf.data.Variable');
 goog.require('wtf.data.ZoneType');
+goog.require('wtf.io');
+goog.require('wtf.io.BufferView');
+goog.require('wtf.io.StringTable');
+goog.require('wtf.io.cff.BinaryStreamTarget');
+goog.require('wtf.io.cff.chunks.EventDataChunk');
+goog.require('wtf.io.cff.chunks.FileHeaderChunk');
+goog.require('wtf.io.transports.MemoryWriteTransport');
 goog.require('wtf.ipc');
 goog.require('wtf.ipc.Channel');
+goog.require('wtf.timing');
+goog.require('wtf.timing.RunMode');
 goog.require('wtf.trace');
+goog.require('wtf.trace.BuiltinEvents');
+goog.require('wtf.trace.EventRegistry');
+goog.require('wtf.trace.ISessionListener');
 goog.require('wtf.trace.Provider');
 goog.require('wtf.trace.events');
+goog.require('wtf.trace.sessions.StreamingSession');
 
 
 
@@ -35,6 +49,7 @@ goog.require('wtf.trace.events');
  * @param {!wtf.trace.TraceManager} traceManager Trace manager.
  * @param {!wtf.util.Options} options Options.
  * @constructor
+ * @implements {wtf.trace.ISessionListener}
  * @extends {wtf.trace.Provider}
  */
 wtf.trace.providers.ChromeDebugProvider = function(traceManager, options) {
@@ -60,15 +75,61 @@ wtf.trace.providers.ChromeDebugProvider = function(traceManager, options) {
   }
 
   /**
-   * Dispatch table for each event type that comes from the extension.
-   * @type {!Object.<function(!Array)>}
+   * Event types for each timeline record type that comes from the extension.
+   * @type {!Array.<!wtf.trace.EventType>}
    * @private
    */
-  this.timelineDispatch_ = {};
-  this.setupTimelineDispatch_(
+  this.timelineEventTypes_ = [];
+
+  /**
+   * Encoding information sent to the extension so that it can write timeline
+   * records directly as event data.
+   * @type {!Object}
+   * @private
+   */
+  this.timelineEncoding_ = this.setupTimelineEncoding_(
       options.getBoolean(
           'wtf.trace.provider.chromeDebug.adjustTimebase', true));
 
+  /**
+   * Encoded timeline event data received from the extension.
+   * These are never decoded here and are written into snapshots as-is.
+   * Data received while streaming is written to the stream instead.
+   * @type {!Array.<!wtf.io.BufferView.Type>}
+   * @private
+   */
+  this.timelineBuffers_ = [];
+
+  /**
+   * The active streaming session, if any.
+   * Timeline data is pulled from the extension periodically and written to
+   * it as it arrives.
+   * @type {wtf.trace.sessions.StreamingSession}
+   * @private
+   */
+  this.streamingSession_ = null;
+
+  /**
+   * Interval handle for pulling timeline data while streaming.
+   * @type {wtf.timing.Handle}
+   * @private
+   */
+  this.streamIntervalId_ = null;
+
+  /**
+   * Zone that streamed timeline data is recorded in, created on first use.
+   * @type {wtf.trace.Zone}
+   * @private
+   */
+  this.timelineZone_ = null;
+
+  /**
+   * Total size of all timeline buffers, in bytes.
+   * @type {number}
+   * @private
+   */
+  this.timelineByteLength_ = 0;
+
   /**
    * The next ID used when making an async data request to the extension.
    * @type {number}
@@ -139,6 +200,11 @@ wtf.trace.providers.ChromeDebugProvider = function(traceManager, options) {
 
   this.available_ = !!this.extensionChannel_;
 
+  // Listen for snapshots to attach the timeline data.
+  if (this.available_) {
+    traceManager.addListener(this);
+  }
+
   if (this.available_ &&
       options.getBoolean('wtf.trace.provider.chromeDebug.tracing', false)) {
     this.hudButtons_.push({
@@ -252,7 +318,8 @@ wtf.trace.providers.ChromeDebugProvider.prototype.extensionMessage_ =
   var data = goog.global.JSON.parse(rawData);
   switch (data['command']) {
     case 'debugger_data':
-      this.processDebuggerRecords_(data['records']);
+      this.addTimelineData_(
+          data['buffer'], data['byte_length'], data['strings']);
       var deferred = this.pendingRequests_[data['request_id']];
       if (deferred) {
         delete this.pendingRequests_[data['request_id']];
@@ -276,28 +343,117 @@ wtf.trace.providers.ChromeDebugProvider.prototype.extensionMessage_ =
 
 
 /**
- * Processes a list of debugger timeline records.
- * @param {!Array.<!Array>} records Records.
+ * Maximum amount of timeline data retained for snapshots, in bytes.
+ * The oldest data is dropped when this is exceeded.
+ * @type {number}
+ * @const
  * @private
  */
-wtf.trace.providers.ChromeDebugProvider.prototype.processDebuggerRecords_ =
-    function(records) {
-  for (var n = 0; n < records.length; n++) {
-    var record = records[n];
-    var dispatch = this.timelineDispatch_[record[0]];
-    if (dispatch) {
-      dispatch(record);
-    }
+wtf.trace.providers.ChromeDebugProvider.MAX_TIMELINE_BYTES_ =
+    16 * 1024 * 1024;
+
+
+/**
+ * Zone ID of the timeline zone in timeline snapshots.
+ * Snapshots are standalone streams, so this need not match any page zone.
+ * @type {number}
+ * @const
+ * @private
+ */
+wtf.trace.providers.ChromeDebugProvider.TIMELINE_ZONE_ID_ = 1;
+
+
+/**
+ * Interval between timeline data requests while streaming, in ms.
+ * @type {number}
+ * @const
+ * @private
+ */
+wtf.trace.providers.ChromeDebugProvider.STREAM_INTERVAL_ = 1000;
+
+
+/**
+ * Maximum time to wait for the extension when snapshotting, in ms.
+ * @type {number}
+ * @const
+ * @private
+ */
+wtf.trace.providers.ChromeDebugProvider.SNAPSHOT_TIMEOUT_ = 2000;
+
+
+/**
+ * Adds encoded timeline event data received from the extension.
+ * @param {?string} data Base64 event data, if there were any records.
+ * @param {number} byteLength Event data length, in bytes.
+ * @param {Array.<string>} strings String table used by the event data.
+ * @private
+ */
+wtf.trace.providers.ChromeDebugProvider.prototype.addTimelineData_ =
+    function(data, byteLength, strings) {
+  if (!data || !byteLength) {
+    return;
+  }
+
+  var bytes = wtf.io.createByteArray(byteLength);
+  if (wtf.io.stringToByteArray(data, bytes) != byteLength) {
+    return;
+  }
+  var stringTable = new wtf.io.StringTable();
+  stringTable.initFromJsonObject(strings || []);
+  var bufferView = wtf.io.BufferView.createWithBuffer(
+      bytes.buffer, stringTable);
+  wtf.io.BufferView.setOffset(bufferView, byteLength);
+
+  if (this.streamingSession_) {
+    this.streamTimelineData_(this.streamingSession_, bufferView);
+    return;
+  }
+
+  this.timelineBuffers_.push(bufferView);
+  this.timelineByteLength_ += byteLength;
+  while (this.timelineBuffers_.length > 1 &&
+      this.timelineByteLength_ >
+          wtf.trace.providers.ChromeDebugProvider.MAX_TIMELINE_BYTES_) {
+    var dropped = this.timelineBuffers_.shift();
+    this.timelineByteLength_ -= wtf.io.BufferView.getOffset(dropped);
+  }
+};
+
+
+/**
+ * Writes encoded timeline event data to a streaming session.
+ * The data is preceded by a chunk that switches to the timeline zone, as the
+ * data itself has no zone. The session writes out its current chunk, which
+ * holds the creation of the zone, ahead of them.
+ * @param {!wtf.trace.sessions.StreamingSession} session Streaming session.
+ * @param {!wtf.io.BufferView.Type} bufferView Timeline event data.
+ * @private
+ */
+wtf.trace.providers.ChromeDebugProvider.prototype.streamTimelineData_ =
+    function(session, bufferView) {
+  if (!this.timelineZone_) {
+    this.timelineZone_ = session.getTraceManager().createZone(
+        'Timeline', wtf.data.ZoneType.NATIVE_BROWSER, '');
   }
+
+  var zoneChunk = new wtf.io.cff.chunks.EventDataChunk();
+  zoneChunk.init(64);
+  wtf.trace.BuiltinEvents.setZone(
+      this.timelineZone_.id, 0, zoneChunk.getBinaryBuffer());
+  var dataChunk = new wtf.io.cff.chunks.EventDataChunk();
+  dataChunk.initWithBuffer(bufferView);
+  session.writeChunks([zoneChunk, dataChunk]);
 };
 
 
 /**
- * Sets up the record dispatch table.
+ * Sets up the timeline event types and the encoding used by the extension.
  * @param {boolean} adjustTimebase Whether to adjust timebase by the walltime.
+ * @return {!Object} Encoding information for
+ *     {@code Debugger#encodeRecords} in the extension.
  * @private
  */
-wtf.trace.providers.ChromeDebugProvider.prototype.setupTimelineDispatch_ =
+wtf.trace.providers.ChromeDebugProvider.prototype.setupTimelineEncoding_ =
     function(adjustTimebase) {
   // This table should match the one in
   // extensions/wtf-injector-chrome/debugger.js
@@ -309,155 +465,226 @@ wtf.trace.providers.ChromeDebugProvider.prototype.setupTimelineDispatch_ =
     timebase = wtf.timebase();
   }
 
-  // GCEvent: garbage collections.
-  var gcEvent = wtf.trace.events.createScope(
-      'javascript#gc(uint32 usedHeapSize, uint32 usedHeapSizeDelta)',
-      wtf.data.EventFlag.SYSTEM_TIME);
-  this.timelineDispatch_['GCEvent'] = function(record) {
-    var startTime = record[1] - timebase;
-    var endTime = record[2] - timebase;
-    var scope = gcEvent(record[3], record[4], startTime);
-    wtf.trace.leaveScope(scope, undefined, endTime);
-  };
+  // Record type, event signature, whether the event is a scope, and flags.
+  var table = [
+    // GCEvent: garbage collections.
+    'GCEvent',
+    'javascript#gc(uint32 usedHeapSize, uint32 usedHeapSizeDelta)', true,
+    wtf.data.EventFlag.SYSTEM_TIME,
+    // EvaluateScript: script runtime/parsing/etc.
+    'EvaluateScript',
+    'javascript#evalscript(uint32 usedHeapSize, uint32 usedHeapSizeDelta, ' +
+        'ascii url, uint32 lineNumber)', true,
+    wtf.data.EventFlag.SYSTEM_TIME,
+    // ParseHTML: parsing of HTML in a page.
+    'ParseHTML',
+    'browser#parseHtml()', true,
+    wtf.data.EventFlag.SYSTEM_TIME,
+    // MarkDOMContent: main resource DOM finished loading.
+    'MarkDOMContent',
+    'browser#domContentReady(bool isMainFrame)', false,
+    wtf.data.EventFlag.SYSTEM_TIME,
+    // ScheduleStyleRecalculation: a style has been invalidated - expect a
+    // RecalculateStyles.
+    'ScheduleStyleRecalculation',
+    'browser#invalidateStyles()', false, 0,
+    // RecalculateStyles: style recalculation is occurring.
+    'RecalculateStyles',
+    'browser#recalculateStyles(uint32 elementCount)', true,
+    wtf.data.EventFlag.SYSTEM_TIME,
+    // InvalidateLayout: DOM layout was invalidated - expect a Layout.
+    'InvalidateLayout',
+    'browser#invalidateLayout()', false, 0,
+    // Layout: DOM layout.
+    'Layout',
+    'browser#layout(uint32 totalObjects, uint32 dirtyObjects, ' +
+        'bool partialLayout, int32 x, int32 y, int32 width, int32 height)',
+    true, wtf.data.EventFlag.SYSTEM_TIME,
+    // PaintSetup: DOM element painting.
+    'PaintSetup',
+    'browser#paintSetup()', true,
+    wtf.data.EventFlag.SYSTEM_TIME,
+    // Paint: DOM element painting.
+    'Paint',
+    'browser#paint(int32 x, int32 y, int32 width, int32 height)', true,
+    wtf.data.EventFlag.SYSTEM_TIME,
+    // CompositeLayers: the compositor ran and composited the page.
+    'CompositeLayers',
+    'browser#compositeLayers()', true,
+    wtf.data.EventFlag.SYSTEM_TIME,
+    // DecodeImage: a compressed image was decoded.
+    'DecodeImage',
+    'browser#decodeImage(ascii imageType)', true,
+    wtf.data.EventFlag.SYSTEM_TIME,
+    // ResizeImage: a resized version of a decoded image was required.
+    'ResizeImage',
+    'browser#resizeImage(bool cached)', true,
+    wtf.data.EventFlag.SYSTEM_TIME
+  ];
 
-  // EvaluateScript: script runtime/parsing/etc.
-  var evalScriptEvent = wtf.trace.events.createScope(
-      'javascript#evalscript(uint32 usedHeapSize, uint32 usedHeapSizeDelta, ' +
-          'ascii url, uint32 lineNumber)',
-      wtf.data.EventFlag.SYSTEM_TIME);
-  this.timelineDispatch_['EvaluateScript'] = function(record) {
-    var startTime = record[1] - timebase;
-    var endTime = record[2] - timebase;
-    var scope = evalScriptEvent(record[3], record[4], record[5], record[6],
-        startTime);
-    wtf.trace.leaveScope(scope, undefined, endTime);
-  };
+  // Register the event types so that they get stable wire IDs.
+  var registry = wtf.trace.EventRegistry.getShared();
+  var types = {};
+  for (var n = 0; n < table.length; n += 4) {
+    var signature = table[n + 1];
+    var isScope = table[n + 2];
+    var flags = table[n + 3];
+    if (isScope) {
+      wtf.trace.events.createScope(signature, flags);
+    } else {
+      wtf.trace.events.createInstance(signature, flags);
+    }
+    var eventType = registry.getEventType(
+        wtf.data.Variable.parseSignature(signature).name);
+    goog.asserts.assert(eventType);
+    this.timelineEventTypes_.push(eventType);
+    types[table[n]] = [eventType.wireId, isScope, eventType.args.length];
+  }
 
-  // ParseHTML: parsing of HTML in a page.
-  var parseHtmlEvent = wtf.trace.events.createScope(
-      'browser#parseHtml()',
-      wtf.data.EventFlag.SYSTEM_TIME);
-  this.timelineDispatch_['ParseHTML'] = function(record) {
-    var startTime = record[1] - timebase;
-    var endTime = record[2] - timebase;
-    var scope = parseHtmlEvent(startTime);
-    wtf.trace.leaveScope(scope, undefined, endTime);
+  return {
+    'timebase': timebase,
+    'leave': registry.getEventType('wtf.scope#leave').wireId,
+    'types': types
   };
+};
 
-  // MarkDOMContent: main resource DOM finished loading.
-  var domContentReadyEvent = wtf.trace.events.createInstance(
-      'browser#domContentReady(bool isMainFrame)',
-      wtf.data.EventFlag.SYSTEM_TIME);
-  this.timelineDispatch_['MarkDOMContent'] = function(record) {
-    var startTime = record[1] - timebase;
-    domContentReadyEvent(record[2], startTime);
-  };
 
-  // ScheduleStyleRecalculation: a style has been invalidated - expect a
-  // RecalculateStyles.
-  var invalidateStylesEvent = wtf.trace.events.createInstance(
-      'browser#invalidateStyles()');
-  this.timelineDispatch_['ScheduleStyleRecalculation'] = function(record) {
-    var startTime = record[1] - timebase;
-    invalidateStylesEvent(startTime);
-  };
+/**
+ * Writes all timeline data as a standalone snapshot stream.
+ * The timeline is placed in its own zone.
+ * @return {wtf.io.Blob} Snapshot data, or null if there is no timeline data.
+ * @private
+ */
+wtf.trace.providers.ChromeDebugProvider.prototype.writeTimelineSnapshot_ =
+    function() {
+  if (!this.timelineBuffers_.length) {
+    return null;
+  }
 
-  // RecalculateStyles: style recalculation is occurring.
-  var recalculateStylesEvent = wtf.trace.events.createScope(
-      'browser#recalculateStyles(uint32 elementCount)',
-      wtf.data.EventFlag.SYSTEM_TIME);
-  this.timelineDispatch_['RecalculateStyles'] = function(record) {
-    var startTime = record[1] - timebase;
-    var endTime = record[2] - timebase;
-    var scope = recalculateStylesEvent(record[3], startTime);
-    wtf.trace.leaveScope(scope, undefined, endTime);
-  };
+  var transport = new wtf.io.transports.MemoryWriteTransport();
+  var streamTarget = new wtf.io.cff.BinaryStreamTarget(transport);
+
+  var fileHeaderChunk = new wtf.io.cff.chunks.FileHeaderChunk();
+  fileHeaderChunk.init();
+  streamTarget.writeChunk(fileHeaderChunk);
+
+  // Define the events used by the timeline data and create its zone.
+  var headerChunk = new wtf.io.cff.chunks.EventDataChunk();
+  headerChunk.init(16 * 1024);
+  var bufferView = headerChunk.getBinaryBuffer();
+  var registry = wtf.trace.EventRegistry.getShared();
+  var eventTypes = [
+    registry.getEventType('wtf.event#define'),
+    registry.getEventType('wtf.zone#create'),
+    registry.getEventType('wtf.zone#set'),
+    registry.getEventType('wtf.scope#leave')
+  ].concat(this.timelineEventTypes_);
+  for (var n = 0; n < eventTypes.length; n++) {
+    var eventType = eventTypes[n];
+    wtf.trace.BuiltinEvents.defineEvent(
+        eventType.wireId,
+        eventType.eventClass,
+        eventType.flags,
+        eventType.name,
+        eventType.getArgString(),
+        undefined,
+        bufferView);
+  }
+  var zoneId = wtf.trace.providers.ChromeDebugProvider.TIMELINE_ZONE_ID_;
+  wtf.trace.BuiltinEvents.createZone(
+      zoneId, 'Timeline', wtf.data.ZoneType.NATIVE_BROWSER, '', 0,
+      bufferView);
+  wtf.trace.BuiltinEvents.setZone(zoneId, 0, bufferView);
+  streamTarget.writeChunk(headerChunk);
+
+  // Timeline data is written without being decoded.
+  for (var n = 0; n < this.timelineBuffers_.length; n++) {
+    var chunk = new wtf.io.cff.chunks.EventDataChunk();
+    chunk.initWithBuffer(this.timelineBuffers_[n]);
+    streamTarget.writeChunk(chunk);
+  }
 
-  // InvalidateLayout: DOM layout was invalidated - expect a Layout.
-  var invalidateLayoutEvent = wtf.trace.events.createInstance(
-      'browser#invalidateLayout()');
-  this.timelineDispatch_['InvalidateLayout'] = function(record) {
-    var startTime = record[1] - timebase;
-    invalidateLayoutEvent(startTime);
-  };
+  streamTarget.end();
+  var blob = transport.getBlob();
+  goog.dispose(streamTarget);
+  goog.dispose(transport);
+  return blob;
+};
 
-  // Layout: DOM layout.
-  var layoutEvent = wtf.trace.events.createScope(
-      'browser#layout(uint32 totalObjects, uint32 dirtyObjects, ' +
-          'bool partialLayout, int32 x, int32 y, int32 width, int32 height)',
-      wtf.data.EventFlag.SYSTEM_TIME);
-  this.timelineDispatch_['Layout'] = function(record) {
-    var startTime = record[1] - timebase;
-    var endTime = record[2] - timebase;
-    var scope = layoutEvent(
-        record[3], record[4], record[5],
-        record[6], record[7], record[8], record[9],
-        startTime);
-    wtf.trace.leaveScope(scope, undefined, endTime);
-  };
 
-  // PaintSetup: DOM element painting.
-  var paintSetupEvent = wtf.trace.events.createScope(
-      'browser#paintSetup()',
-      wtf.data.EventFlag.SYSTEM_TIME);
-  this.timelineDispatch_['PaintSetup'] = function(record) {
-    var startTime = record[1] - timebase;
-    var endTime = record[2] - timebase;
-    var scope = paintSetupEvent(startTime);
-    wtf.trace.leaveScope(scope, undefined, endTime);
-  };
+/**
+ * @override
+ */
+wtf.trace.providers.ChromeDebugProvider.prototype.sessionStarted =
+    function(session) {
+  // Streaming sessions never snapshot, so pull timeline data into them as
+  // they run.
+  if (!(session instanceof wtf.trace.sessions.StreamingSession)) {
+    return;
+  }
+  this.streamingSession_ = session;
+  this.streamIntervalId_ = wtf.timing.setInterval(
+      wtf.timing.RunMode.DEFAULT,
+      wtf.trace.providers.ChromeDebugProvider.STREAM_INTERVAL_,
+      this.pollTimelineData_, this);
+};
 
-  // Paint: DOM element painting.
-  var paintEvent = wtf.trace.events.createScope(
-      'browser#paint(int32 x, int32 y, int32 width, int32 height)',
-      wtf.data.EventFlag.SYSTEM_TIME);
-  this.timelineDispatch_['Paint'] = function(record) {
-    var startTime = record[1] - timebase;
-    var endTime = record[2] - timebase;
-    var scope = paintEvent(
-        record[3], record[4], record[5], record[6], startTime);
-    wtf.trace.leaveScope(scope, undefined, endTime);
-  };
 
-  // CompositeLayers: the compositor ran and composited the page.
-  var compositeLayersEvent = wtf.trace.events.createScope(
-      'browser#compositeLayers()',
-      wtf.data.EventFlag.SYSTEM_TIME);
-  this.timelineDispatch_['CompositeLayers'] = function(record) {
-    var startTime = record[1] - timebase;
-    var endTime = record[2] - timebase;
-    var scope = compositeLayersEvent(startTime);
-    wtf.trace.leaveScope(scope, undefined, endTime);
-  };
+/**
+ * @override
+ */
+wtf.trace.providers.ChromeDebugProvider.prototype.sessionStopped =
+    function(session) {
+  if (session != this.streamingSession_) {
+    return;
+  }
+  this.streamingSession_ = null;
+  wtf.timing.clearInterval(this.streamIntervalId_);
+  this.streamIntervalId_ = null;
+};
 
-  // DecodeImage: a compressed image was decoded.
-  var decodeImageEvent = wtf.trace.events.createScope(
-      'browser#decodeImage(ascii imageType)',
-      wtf.data.EventFlag.SYSTEM_TIME);
-  this.timelineDispatch_['DecodeImage'] = function(record) {
-    var startTime = record[1] - timebase;
-    var endTime = record[2] - timebase;
-    var scope = decodeImageEvent(record[3], startTime);
-    wtf.trace.leaveScope(scope, undefined, endTime);
-  };
 
-  // ResizeImage: a resized version of a decoded image was required.
-  var resizeImageEvent = wtf.trace.events.createScope(
-      'browser#resizeImage(bool cached)',
-      wtf.data.EventFlag.SYSTEM_TIME);
-  this.timelineDispatch_['ResizeImage'] = function(record) {
-    var startTime = record[1] - timebase;
-    var endTime = record[2] - timebase;
-    var scope = resizeImageEvent(record[3], startTime);
-    wtf.trace.leaveScope(scope, undefined, endTime);
+/**
+ * @override
+ */
+wtf.trace.providers.ChromeDebugProvider.prototype.requestSnapshots = function(
+    session, callback, opt_scope) {
+  // Fetch any data pending in the extension and snapshot it all. The
+  // extension may not respond (if the debugger failed to attach), so don't
+  // wait on it forever.
+  var completed = false;
+  function complete() {
+    if (completed) {
+      return;
+    }
+    completed = true;
+    callback.call(opt_scope, this.writeTimelineSnapshot_());
   };
+  this.gatherData().addCallback(complete, this);
+  wtf.timing.setTimeout(
+      wtf.trace.providers.ChromeDebugProvider.SNAPSHOT_TIMEOUT_,
+      complete, this);
+  return 1;
+};
+
+
+/**
+ * Requests timeline data while streaming, unless a request is outstanding.
+ * @private
+ */
+wtf.trace.providers.ChromeDebugProvider.prototype.pollTimelineData_ =
+    function() {
+  for (var requestId in this.pendingRequests_) {
+    return;
+  }
+  this.gatherData();
 };
 
 
 /**
- * Forces a gather of all pending debugger data.
- * This is not required as the debugger will send down data periodically, but
- * can be used to ensure all data is received upon a snapshot.
+ * Gathers all pending debugger data.
+ * The extension holds timeline records until they are requested and sends
+ * them down already encoded. This is done automatically on snapshot.
  * @return {!goog.async.Deferred} A deferred that completes when all data is
  *     available.
  */
@@ -467,7 +694,8 @@ wtf.trace.providers.ChromeDebugProvider.prototype.gatherData = function() {
   this.pendingRequests_[requestId] = deferred;
   this.sendMessage_({
     'command': 'get_debugger_data',
-    'request_id': requestId
+    'request_id': requestId,
+    'encoding': this.timelineEncoding_
   });
   return deferred;
 };
@@ -477,6 +705,11 @@ wtf.trace.providers.ChromeDebugProvider.prototype.gatherData = function() {
  * Resets any pending debugger data.
  */
 wtf.trace.providers.ChromeDebugProvider.prototype.resetData = function() {
+  if (!this.available_) {
+    return;
+  }
+  this.timelineBuffers_.length = 0;
+  this.timelineByteLength_ = 0;
   this.sendMessage_({
     'command': 'clear_debugger_data'
   });
@@ -15,6 +15,7 @@ goog.provide('wtf.trace.providers.DomProvider');
 
 goog.require('wtf.data.webidl');
 goog.require('wtf.trace.Provider');
+goog.require('wtf.trace.Sampler');
 goog.require('wtf.trace.eventtarget');
 
 
@@ -46,6 +47,13 @@ wtf.trace.providers.DomProvider = function(options) {
   this.includeEventArgs_ =
       options.getBoolean('wtf.trace.provider.dom.eventArgs', false);
 
+  /**
+   * Sampler shared by all DOM event types.
+   * @type {!wtf.trace.Sampler}
+   * @private
+   */
+  this.sampler_ = new wtf.trace.Sampler(options, 'wtf.trace.provider.dom');
+
   // Note that this code is extra exception-handly - this is because it's very
   // prone to exceptions in various browsers. Being defensive here means that
   // we don't randomly break and instead just lose event types.
@@ -245,7 +253,7 @@ wtf.trace.providers.DomProvider.prototype.injectElement_ = function(
 
   // Create a descriptor object.
   var descriptor = wtf.trace.eventtarget.createDescriptor(
-      typeName, eventTypes);
+      typeName, eventTypes, this.sampler_);
 
   // Stash the descriptor. It may be used by the hookDomEvents util.
   wtf.trace.eventtarget.setDescriptor(proto, descriptor);
@@ -18,6 +18,7 @@ goog.require('wtf');
 goog.require('wtf.data.EventFlag');
 goog.require('wtf.trace');
 goog.require('wtf.trace.Provider');
+goog.require('wtf.trace.Sampler');
 goog.require('wtf.trace.events');
 
 
@@ -33,6 +34,14 @@ goog.require('wtf.trace.events');
 wtf.trace.providers.TimingProvider = function(options) {
   goog.base(this, options);
 
+  /**
+   * Sampler shared by all timer callbacks.
+   * @type {!wtf.trace.Sampler}
+   * @private
+   */
+  this.sampler_ = new wtf.trace.Sampler(
+      options, 'wtf.trace.provider.timing');
+
   this.injectTimeouts_();
   this.injectSetImmediate_();
   this.injectRequestAnimationFrame_();
@@ -52,8 +61,10 @@ wtf.trace.providers.TimingProvider.prototype.injectTimeouts_ = function() {
   // window.setTimeout
   var setTimeoutEvent = wtf.trace.events.createInstance(
       'window#setTimeout(uint32 delay, uint32 timeoutId)');
-  var setTimeoutCallbackEvent = wtf.trace.events.createScope(
-      'window#setTimeout:callback(uint32 timeoutId)');
+  var setTimeoutCallbackSite = this.sampler_.createSite(
+      'window#setTimeout:callback',
+      wtf.trace.events.createScope(
+          'window#setTimeout:callback(uint32 timeoutId)'));
   var originalSetTimeout = goog.global['setTimeout'];
   // Flows, by timeout ID.
   var timeoutFlows = {};
@@ -69,7 +80,7 @@ wtf.trace.providers.TimingProvider.prototype.injectTimeouts_ = function() {
         // Flow-spanning logic.
         var flow; // NOTE: flow is branched below so event order is correct
         var timeoutId = originalSetTimeout.call(goog.global, function() {
-          var scope = setTimeoutCallbackEvent(timeoutIdRef[0]);
+          var scope = setTimeoutCallbackSite.enter(timeoutIdRef[0]);
           wtf.trace.extendFlow(flow, 'callback');
           try {
             // Support both functions and strings as callbacks.
@@ -83,7 +94,7 @@ wtf.trace.providers.TimingProvider.prototype.injectTimeouts_ = function() {
           } finally {
             delete timeoutFlows[timeoutIdRef[0]];
             wtf.trace.terminateFlow(flow);
-            wtf.trace.leaveScope(scope);
+            setTimeoutCallbackSite.leave(scope);
           }
         }, delay);
         timeoutIdRef[0] = timeoutId;
@@ -121,8 +132,10 @@ wtf.trace.providers.TimingProvider.prototype.injectTimeouts_ = function() {
   // window.setInterval
   var setIntervalEvent = wtf.trace.events.createInstance(
       'window#setInterval(uint32 delay, uint32 intervalId)');
-  var setIntervalCallbackEvent = wtf.trace.events.createScope(
-      'window#setInterval:callback(uint32 intervalId)');
+  var setIntervalCallbackSite = this.sampler_.createSite(
+      'window#setInterval:callback',
+      wtf.trace.events.createScope(
+          'window#setInterval:callback(uint32 intervalId)'));
   var originalSetInterval = goog.global['setInterval'];
   // Flows, by interval ID.
   var intervalFlows = {};
@@ -138,7 +151,7 @@ wtf.trace.providers.TimingProvider.prototype.injectTimeouts_ = function() {
         // Flow-spanning logic.
         var flow; // NOTE: flow is branched below so event order is correct
         var intervalId = originalSetInterval.call(goog.global, function() {
-          var scope = setIntervalCallbackEvent(intervalIdRef[0]);
+          var scope = setIntervalCallbackSite.enter(intervalIdRef[0]);
           wtf.trace.extendFlow(flow, 'callback');
           try {
             // Support both functions and strings as callbacks.
@@ -152,7 +165,7 @@ wtf.trace.providers.TimingProvider.prototype.injectTimeouts_ = function() {
           } finally {
             // Reset flow so that it shows as bouncing from this function.
             // This builds a nice chain with parenting.
-            wtf.trace.leaveScope(scope);
+            setIntervalCallbackSite.leave(scope);
           }
         }, delay);
         intervalIdRef[0] = intervalId;
@@ -204,8 +217,10 @@ wtf.trace.providers.TimingProvider.prototype.injectSetImmediate_ = function() {
   }
   var setImmediateEvent = wtf.trace.events.createInstance(
       'window#setImmediate(uint32 immediateId)');
-  var setImmediateCallbackEvent = wtf.trace.events.createScope(
-      'window#setImmediate:callback(uint32 immediateId)');
+  var setImmediateCallbackSite = this.sampler_.createSite(
+      'window#setImmediate:callback',
+      wtf.trace.events.createScope(
+          'window#setImmediate:callback(uint32 immediateId)'));
   // Flows, by immediate ID.
   var immediateFlows = {};
   this.injectFunction(goog.global, 'msSetImmediate',
@@ -220,7 +235,7 @@ wtf.trace.providers.TimingProvider.prototype.injectSetImmediate_ = function() {
         // Flow-spanning logic.
         var flow; // NOTE: flow is branched below so event order is correct
         var immediateId = originalSetImmediate.call(goog.global, function() {
-          var scope = setImmediateCallbackEvent(immediateIdRef[0]);
+          var scope = setImmediateCallbackSite.enter(immediateIdRef[0]);
           wtf.trace.extendFlow(flow, 'callback');
           try {
             // Support both functions and strings as callbacks.
@@ -234,7 +249,7 @@ wtf.trace.providers.TimingProvider.prototype.injectSetImmediate_ = function() {
           } finally {
             delete immediateFlows[immediateIdRef[0]];
             wtf.trace.terminateFlow(flow);
-            wtf.trace.leaveScope(scope);
+            setImmediateCallbackSite.leave(scope);
           }
         });
         immediateIdRef[0] = immediateId;
@@ -305,8 +320,10 @@ wtf.trace.providers.TimingProvider.prototype.injectRequestAnimationFrame_ =
         wtf.data.EventFlag.INTERNAL),
     requestAnimationFrame: wtf.trace.events.createInstance(
         'window#requestAnimationFrame(uint32 handle)'),
-    requestAnimationFrameCallback: wtf.trace.events.createScope(
-        'window#requestAnimationFrame:callback(uint32 handle)'),
+    requestAnimationFrameCallback: this.sampler_.createSite(
+        'window#requestAnimationFrame:callback',
+        wtf.trace.events.createScope(
+            'window#requestAnimationFrame:callback(uint32 handle)')),
     cancelAnimationFrame: wtf.trace.events.createInstance(
         'window#cancelAnimationFrame(uint32 handle)')
   };
@@ -328,7 +345,7 @@ wtf.trace.providers.TimingProvider.prototype.injectRequestAnimationFrame_ =
  * Injects requestAnimationFrame.
  * @param {string} requestName Name of the requestAnimationFrame method.
  * @param {string} cancelName Name of the cancelAnimationFrame method.
- * @param {!Object.<!wtf.trace.EventType>} events rAF events.
+ * @param {!Object} events rAF events and the callback dispatch site.
  * @private
  */
 wtf.trace.providers.TimingProvider.prototype.injectRequestAnimationFrameFn_ =
@@ -359,14 +376,15 @@ wtf.trace.providers.TimingProvider.prototype.injectRequestAnimationFrameFn_ =
         events.frameStart(frameNumber, now);
       }
 
-      var scope = events.requestAnimationFrameCallback(handleRef[0], now);
+      var scope = events.requestAnimationFrameCallback.enter(
+          handleRef[0], now);
       wtf.trace.extendFlow(flow, 'callback');
       try {
         cb.apply(this, arguments);
       } finally {
         delete rafFlows[handleRef[0]];
         wtf.trace.terminateFlow(flow);
-        wtf.trace.leaveScope(scope);
+        events.requestAnimationFrameCallback.leave(scope);
 
         // If this is the last rAF of the frame, handle frame-end and list
         // resetting.
@@ -298,6 +298,17 @@ wtf.trace.providers.WebGLProvider.prototype.toggleCapture_ = function() {
 };
 
 
+/**
+ * Minimum size, in bytes or characters, of payloads that are recorded as
+ * session resources. Smaller payloads are cheaper to record inline than to
+ * hash.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.trace.providers.WebGLProvider.MIN_RESOURCE_SIZE_ = 1024;
+
+
 /**
  * Injects the WebGLRenderingContext proto instrumentation.
  * @private
@@ -435,6 +446,29 @@ wtf.trace.providers.WebGLProvider.prototype.injectContextType_ = function() {
     }
   };
 
+  /**
+   * Adds a payload as a session resource, if it's large enough.
+   * Apps often upload the same data many times (the same texture to several
+   * contexts, shaders shared by programs, etc), and resources let the trace
+   * contain each payload only once.
+   * @param {string|Uint8Array} data Payload.
+   * @return {number} Resource ID, or 0 if the data should be recorded inline.
+   */
+  function addResource(data) {
+    if (!data ||
+        data.length < wtf.trace.providers.WebGLProvider.MIN_RESOURCE_SIZE_) {
+      return 0;
+    }
+    var session = wtf.trace.getTraceManager().getCurrentSession();
+    if (!session) {
+      return 0;
+    }
+    var traceScope = wtf.trace.enterTracingScope();
+    var resourceId = session.addResource(data);
+    leaveScope(traceScope);
+    return resourceId;
+  };
+
   /**
    * Wraps the ANGLEInstancedArrays extension object.
    * @param {!WebGLRenderingContext} ctx Target context.
@@ -618,25 +652,32 @@ wtf.trace.providers.WebGLProvider.prototype.injectContextType_ = function() {
       'blendFuncSeparate(uint32 srcRGB, uint32 dstRGB, uint32 srcAlpha, ' +
           'uint32 dstAlpha)');
   wrapContextMethod(
-      'bufferData(uint32 target, uint32 size, uint32 usage, uint8[] data)',
+      'bufferData(uint32 target, uint32 size, uint32 usage, uint8[] data, ' +
+          'uint32 dataResource)',
       function(fn, eventType) {
         return function bufferData(target, data, usage) {
           setCurrentContext(this);
           if (typeof data == 'number') {
-            var scope = eventType(target, data, usage, []);
+            var scope = eventType(target, data, usage, [], 0);
             return leaveScope(scope, fn.apply(this, arguments));
           } else {
             var dataLength = data.byteLength;
+            var dataResource = 0;
             if (replayable) {
               if (data instanceof ArrayBuffer) {
                 data = new Uint8Array(data);
               } else if (!(data instanceof Uint8Array)) {
                 data = new Uint8Array(data.buffer);
               }
+              dataResource = addResource(data);
+              if (dataResource) {
+                data = [];
+              }
             } else {
               data = [];
             }
-            var scope = eventType(target, dataLength, usage, data);
+            var scope = eventType(
+                target, dataLength, usage, data, dataResource);
             return leaveScope(scope, fn.apply(this, arguments));
           }
         };
@@ -1043,11 +1084,14 @@ wtf.trace.providers.WebGLProvider.prototype.injectContextType_ = function() {
   wrapContextMethod(
       'scissor(int32 x, int32 y, int32 width, int32 height)');
   wrapContextMethod(
-      'shaderSource(uint32 shader, utf8 source)',
+      'shaderSource(uint32 shader, utf8 source, uint32 sourceResource)',
       function(fn, eventType) {
         return function shaderSource(shader, source) {
           setCurrentContext(this);
-          var scope = eventType(getHandle(shader), source);
+          var sourceResource = addResource(source);
+          var scope = eventType(
+              getHandle(shader), sourceResource ? '' : source,
+              sourceResource);
           return leaveScope(scope, fn.apply(this, arguments));
         };
       });
@@ -1067,24 +1111,32 @@ wtf.trace.providers.WebGLProvider.prototype.injectContextType_ = function() {
   wrapContextMethod(
       'texImage2D(uint32 target, int32 level, uint32 internalformat, ' +
           'int32 width, int32 height, int32 border, uint32 format, ' +
-          'uint32 type, uint8[] pixels, ascii dataType)',
+          'uint32 type, uint8[] pixels, ascii dataType, ' +
+          'uint32 pixelsResource)',
       function(fn, eventType) {
         return function texImage2D(target, level, internalformat) {
           setCurrentContext(this);
           var scope;
+          var pixels = null;
+          var pixelsResource = 0;
           if (arguments.length == 9) {
             // Pixels variant.
             if (arguments[8]) {
+              if (replayable) {
+                pixels = coercePixelTypeToUint8(arguments[8]);
+                pixelsResource = addResource(pixels);
+              }
               scope = eventType(
                   target, level, internalformat, arguments[3], arguments[4],
                   arguments[5], arguments[6], arguments[7],
-                  replayable ? coercePixelTypeToUint8(arguments[8]) : null,
-                  replayable ? 'pixels' : 'ignored');
+                  pixelsResource ? null : pixels,
+                  replayable ? 'pixels' : 'ignored',
+                  pixelsResource);
             } else {
               scope = eventType(
                   target, level, internalformat, arguments[3], arguments[4],
                   arguments[5], arguments[6], arguments[7], null,
-                  'null');
+                  'null', 0);
             }
           } else {
             // DOM element variant.
@@ -1094,6 +1146,10 @@ wtf.trace.providers.WebGLProvider.prototype.injectContextType_ = function() {
               imageData = wtf.trace.providers.WebGLProvider.extractImageData(
                   arguments[5], internalformat, embedRemoteImages);
               leaveScope(traceScope);
+              if (imageData && imageData.pixels) {
+                pixels = imageData.pixels;
+                pixelsResource = addResource(pixels);
+              }
             }
             scope = eventType(
                 target,
@@ -1103,8 +1159,9 @@ wtf.trace.providers.WebGLProvider.prototype.injectContextType_ = function() {
                 0,
                 arguments[3],
                 arguments[4],
-                imageData ? imageData.pixels : null,
-                imageData ? imageData.dataType : 'ignored');
+                pixelsResource ? null : pixels,
+                imageData ? imageData.dataType : 'ignored',
+                pixelsResource);
           }
           try {
             fn.apply(this, arguments);
@@ -14,6 +14,7 @@
 goog.provide('wtf.trace.providers.WebSocketProvider');
 
 goog.require('wtf.trace.Provider');
+goog.require('wtf.trace.Sampler');
 goog.require('wtf.trace.Scope');
 goog.require('wtf.trace.events');
 goog.require('wtf.trace.eventtarget');
@@ -84,8 +85,10 @@ wtf.trace.providers.WebSocketProvider.prototype.injectWs_ = function() {
     'message': null
   };
 
+  var sampler = new wtf.trace.Sampler(
+      this.options, 'wtf.trace.provider.websocket');
   var descriptor = wtf.trace.eventtarget.createDescriptor(
-      'WebSocket', eventTypes);
+      'WebSocket', eventTypes, sampler);
 
   var ctorEvent = wtf.trace.events.createScope('WebSocket()');
 
@@ -109,13 +112,6 @@ wtf.trace.providers.WebSocketProvider.prototype.injectWs_ = function() {
         new originalWs(url) :
         new originalWs(url, opt_protocols);
 
-    /**
-     * Event type trackers, by name.
-     * @type {!Object.<Function>}
-     * @private
-     */
-    this.trackers_ = {};
-
     /**
      * Properties, accumulated during setup before send().
      * @type {!Object}
@@ -141,17 +137,12 @@ wtf.trace.providers.WebSocketProvider.prototype.injectWs_ = function() {
   ProxyWebSocket.prototype['CLOSED'] = 3;
 
   // Event tracking.
+  // The proxy is itself the listener and forwards events via handleEvent.
   ProxyWebSocket.prototype.beginTrackingEvent = function(type) {
-    var self = this;
-    var tracker = function(e) {
-      self['dispatchEvent'](e);
-    };
-    this.trackers_[type] = tracker;
-    this.handle_.addEventListener(type, tracker, false);
+    this.handle_.addEventListener(type, this, false);
   };
   ProxyWebSocket.prototype.endTrackingEvent = function(type) {
-    this.handle_.removeEventListener(type, this.trackers_[type], false);
-    delete this.trackers_[type];
+    this.handle_.removeEventListener(type, this, false);
   };
 
   // Setup on* events.
@@ -22,12 +22,15 @@ goog.require('goog.result.Result');
 goog.require('goog.result.SimpleResult');
 goog.require('goog.string');
 goog.require('wtf.data.webidl');
+goog.require('wtf.io.SharedRing');
+goog.require('wtf.timing');
 goog.require('wtf.trace');
 goog.require('wtf.trace.ISessionListener');
 goog.require('wtf.trace.Provider');
 goog.require('wtf.trace.events');
 goog.require('wtf.trace.eventtarget');
 goog.require('wtf.trace.eventtarget.BaseEventTarget');
+goog.require('wtf.trace.sessions.SharedRingSession');
 goog.require('wtf.trace.util');
 
 
@@ -57,6 +60,22 @@ wtf.trace.providers.WebWorkerProvider = function(traceManager, options) {
   this.injecting_ = options.getBoolean(
       'wtf.trace.provider.webworker.inject', false);
 
+  /**
+   * Whether injected workers record into shared memory rings.
+   * @type {boolean}
+   * @private
+   */
+  this.sharedRing_ = this.injecting_ &&
+      options.getBoolean('wtf.trace.provider.webworker.sharedRing', false) &&
+      wtf.io.SharedRing.isSupported();
+
+  /**
+   * Sends an internal message to the parent, when running in a worker.
+   * @type {?function(string, *=, Array=)}
+   * @private
+   */
+  this.sendParentMessage_ = null;
+
   // TODO(benvanik): use weak references (WeakMap) when supported.
   /**
    * All active child workers.
@@ -106,6 +125,12 @@ wtf.trace.providers.WebWorkerProvider.prototype.getSettingsSectionConfigs =
           'key': 'wtf.trace.provider.webworker.inject',
           'title': 'Inject WTF into Workers',
           'default': false
+        },
+        {
+          'type': 'checkbox',
+          'key': 'wtf.trace.provider.webworker.sharedRing',
+          'title': 'Record Workers into shared memory',
+          'default': false
         }
       ]
     }
@@ -116,8 +141,16 @@ wtf.trace.providers.WebWorkerProvider.prototype.getSettingsSectionConfigs =
 /**
  * @override
  */
-wtf.trace.providers.WebWorkerProvider.prototype.sessionStarted =
-    goog.nullFunction;
+wtf.trace.providers.WebWorkerProvider.prototype.sessionStarted = function(
+    session) {
+  // Hand shared rings to the parent so it can snapshot them directly.
+  if (this.sendParentMessage_ &&
+      session instanceof wtf.trace.sessions.SharedRingSession) {
+    this.sendParentMessage_('ring', {
+      'buffer': session.getRing().getBuffer()
+    });
+  }
+};
 
 
 /**
@@ -138,6 +171,17 @@ wtf.trace.providers.WebWorkerProvider.prototype.requestSnapshots = function(
   }
 
   this.childWorkers_.forEach(function(worker) {
+    // Workers recording into shared rings can be read without messaging them.
+    // The callback must be async as callers count the pending requests.
+    var ring = worker.getSharedRing();
+    if (ring) {
+      wtf.timing.setImmediate(function() {
+        callback.call(opt_scope,
+            wtf.trace.sessions.SharedRingSession.snapshotRing(ring));
+      });
+      return;
+    }
+
     goog.result.wait(worker.requestSnapshot(), function(result) {
       var buffers = /** @type {Array.<!wtf.io.Blob>} */ (result.getValue());
       if (!buffers || !buffers.length ||
@@ -229,6 +273,7 @@ wtf.trace.providers.WebWorkerProvider.prototype.injectBrowserShim_ =
     function() {
   var provider = this;
   var injecting = this.injecting_;
+  var sharedRing = this.sharedRing_;
 
   // TODO(benvanik): add flow ID tracking code
 
@@ -278,7 +323,9 @@ wtf.trace.providers.WebWorkerProvider.prototype.injectBrowserShim_ =
       'importScripts("' + wtfUrl + '");',
       'wtf.trace.prepare({',
       '});',
-      'wtf.trace.start();'
+      sharedRing ?
+          'wtf.trace.start({"wtf.trace.mode": "shared"});' :
+          'wtf.trace.start();'
     ];
 
     // Add the script import or directly embed the contents.
@@ -344,6 +391,13 @@ wtf.trace.providers.WebWorkerProvider.prototype.injectBrowserShim_ =
      */
     this.trackers_ = {};
 
+    /**
+     * Shared ring the worker records into, if it uses one.
+     * @type {wtf.io.SharedRing}
+     * @private
+     */
+    this.sharedRing_ = null;
+
     this.setEventHook('error', function(e) {
       wtf.trace.appendScopeData('id', this.workerId_);
     }, this);
@@ -370,6 +424,9 @@ wtf.trace.providers.WebWorkerProvider.prototype.injectBrowserShim_ =
             result.setValue(value['data']);
           }
           break;
+        case 'ring':
+          self.sharedRing_ = new wtf.io.SharedRing(value['buffer']);
+          break;
         case 'close':
           goog.array.remove(provider.childWorkers_, self);
           break;
@@ -407,6 +464,14 @@ wtf.trace.providers.WebWorkerProvider.prototype.injectBrowserShim_ =
         });
   }
 
+  /**
+   * Gets the shared ring the worker records into.
+   * @return {wtf.io.SharedRing} Shared ring, if the worker uses one.
+   */
+  ProxyWorker.prototype.getSharedRing = function() {
+    return this.sharedRing_;
+  };
+
   /**
    * Sends an internal message to the worker.
    * @param {string} command Command name.
@@ -619,4 +684,7 @@ wtf.trace.providers.WebWorkerProvider.prototype.injectProxyWorker_ =
       'value': opt_value || null
     }, []);
   };
+  if (originalPostMessage) {
+    this.sendParentMessage_ = sendMessage;
+  }
 };
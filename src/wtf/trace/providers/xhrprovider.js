@@ -16,6 +16,7 @@ goog.provide('wtf.trace.providers.XhrProvider');
 goog.require('wtf.trace');
 goog.require('wtf.trace.Flow');
 goog.require('wtf.trace.Provider');
+goog.require('wtf.trace.Sampler');
 goog.require('wtf.trace.Scope');
 goog.require('wtf.trace.events');
 goog.require('wtf.trace.eventtarget');
@@ -90,8 +91,10 @@ wtf.trace.providers.XhrProvider.prototype.injectXhr_ = function() {
     'readystatechange': null
   };
 
+  var sampler = new wtf.trace.Sampler(
+      this.options, 'wtf.trace.provider.xhr');
   var descriptor = wtf.trace.eventtarget.createDescriptor(
-      'XMLHttpRequest', eventTypes);
+      'XMLHttpRequest', eventTypes, sampler);
 
   var ctorEvent = wtf.trace.events.createScope('XMLHttpRequest()');
 
@@ -111,13 +114,6 @@ wtf.trace.providers.XhrProvider.prototype.injectXhr_ = function() {
      */
     this.handle_ = new originalXhr();
 
-    /**
-     * Event type trackers, by name.
-     * @type {!Object.<Function>}
-     * @private
-     */
-    this.trackers_ = {};
-
     /**
      * Properties, accumulated during setup before send().
      * @type {!Object}
@@ -206,17 +202,12 @@ wtf.trace.providers.XhrProvider.prototype.injectXhr_ = function() {
   ProxyXMLHttpRequest.prototype['DONE'] = 4;
 
   // Event tracking.
+  // The proxy is itself the listener and forwards events via handleEvent.
   ProxyXMLHttpRequest.prototype.beginTrackingEvent = function(type) {
-    var self = this;
-    var tracker = function(e) {
-      self['dispatchEvent'](e);
-    };
-    this.trackers_[type] = tracker;
-    this.handle_.addEventListener(type, tracker, false);
+    this.handle_.addEventListener(type, this, false);
   };
   ProxyXMLHttpRequest.prototype.endTrackingEvent = function(type) {
-    this.handle_.removeEventListener(type, this.trackers_[type], false);
-    delete this.trackers_[type];
+    this.handle_.removeEventListener(type, this, false);
   };
 
   // Setup on* events.
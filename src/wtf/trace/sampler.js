@@ -0,0 +1,250 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/**
+ * @fileoverview Callback dispatch sampling.
+ *
+ * @author benvanik@google.com (Ben Vanik)
+ */
+
+goog.provide('wtf.trace.Sampler');
+goog.provide('wtf.trace.Sampler.Site');
+
+goog.require('wtf');
+goog.require('wtf.trace.Scope');
+goog.require('wtf.trace.events');
+
+
+
+/**
+ * Decides how the callback dispatches of a provider are recorded.
+ * Providers that wrap frequently dispatched callbacks (DOM events, timers,
+ * etc) create one sampler and a {@see wtf.trace.Sampler.Site} for each of
+ * their callback scope events.
+ *
+ * Sampling is configured with options under the given prefix:
+ * <ul>
+ * <li>{@code prefix.sampleRate}: record a scope for every Nth dispatch of each
+ *     event type. 1 records all dispatches and 0 records none.
+ * <li>{@code prefix.aggregate}: record the count and total duration of all
+ *     dispatches of each event type every
+ *     {@code wtf.trace.sampling.interval} ms.
+ * </ul>
+ *
+ * @param {!wtf.util.Options} options Options.
+ * @param {string} prefix Option prefix, such as 'wtf.trace.provider.dom'.
+ * @constructor
+ */
+wtf.trace.Sampler = function(options, prefix) {
+  /**
+   * Every Nth dispatch records a scope. 0 to record no scopes.
+   * @type {number}
+   * @private
+   */
+  this.rate_ = Math.max(0,
+      Math.floor(options.getNumber(prefix + '.sampleRate', 1)));
+
+  /**
+   * Whether to record aggregate dispatch counts and durations.
+   * @type {boolean}
+   * @private
+   */
+  this.aggregate_ = options.getBoolean(prefix + '.aggregate', false);
+
+  /**
+   * Interval between aggregate records, in ms.
+   * @type {number}
+   * @private
+   */
+  this.interval_ = options.getNumber(
+      'wtf.trace.sampling.interval',
+      wtf.trace.Sampler.DEFAULT_INTERVAL_);
+};
+
+
+/**
+ * Default interval between aggregate records, in ms.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.trace.Sampler.DEFAULT_INTERVAL_ = 1000;
+
+
+/**
+ * Event used for aggregate records, created on first use.
+ * @type {Function}
+ * @private
+ */
+wtf.trace.Sampler.aggregateEvent_ = null;
+
+
+/**
+ * Gets the event used for aggregate records.
+ * @return {!Function} Event function.
+ * @private
+ */
+wtf.trace.Sampler.getAggregateEvent_ = function() {
+  if (!wtf.trace.Sampler.aggregateEvent_) {
+    wtf.trace.Sampler.aggregateEvent_ = wtf.trace.events.createInstance(
+        'wtf.trace#aggregate(ascii name, uint32 count, float32 totalTime)');
+  }
+  return wtf.trace.Sampler.aggregateEvent_;
+};
+
+
+/**
+ * Creates a dispatch site for a callback scope event.
+ * @param {string} name Event name, used in aggregate records.
+ * @param {!Function} scopeEvent Scope event function.
+ * @return {!wtf.trace.Sampler.Site} Dispatch site.
+ */
+wtf.trace.Sampler.prototype.createSite = function(name, scopeEvent) {
+  return new wtf.trace.Sampler.Site(
+      name, scopeEvent, this.rate_, this.aggregate_, this.interval_);
+};
+
+
+/**
+ * Creates a dispatch site that records a scope for every dispatch.
+ * @param {string} name Event name.
+ * @param {!Function} scopeEvent Scope event function.
+ * @return {!wtf.trace.Sampler.Site} Dispatch site.
+ */
+wtf.trace.Sampler.createDefaultSite = function(name, scopeEvent) {
+  return new wtf.trace.Sampler.Site(name, scopeEvent, 1, false, 0);
+};
+
+
+
+/**
+ * A sampled callback scope event.
+ * Use {@see #enter} and {@see #leave} in place of the scope event function and
+ * {@see wtf.trace.Scope#leave}.
+ *
+ * Aggregate records are appended by the first dispatch to end after the
+ * interval elapses, so a burst of dispatches is not recorded until the next
+ * dispatch of the same type.
+ *
+ * @param {string} name Event name, used in aggregate records.
+ * @param {!Function} scopeEvent Scope event function.
+ * @param {number} rate Every Nth dispatch records a scope. 0 for none.
+ * @param {boolean} aggregate Whether to record aggregate records.
+ * @param {number} interval Interval between aggregate records, in ms.
+ * @constructor
+ */
+wtf.trace.Sampler.Site = function(
+    name, scopeEvent, rate, aggregate, interval) {
+  /**
+   * Event name.
+   * @type {string}
+   * @private
+   */
+  this.name_ = name;
+
+  /**
+   * Scope event function.
+   * @type {!Function}
+   * @private
+   */
+  this.scopeEvent_ = scopeEvent;
+
+  /**
+   * Every Nth dispatch records a scope. 0 for none.
+   * @type {number}
+   * @private
+   */
+  this.rate_ = rate;
+
+  /**
+   * Dispatches to skip before recording the next scope.
+   * @type {number}
+   * @private
+   */
+  this.skipCount_ = 0;
+
+  /**
+   * Whether to record aggregate records.
+   * @type {boolean}
+   * @private
+   */
+  this.aggregate_ = aggregate;
+
+  /**
+   * Interval between aggregate records, in ms.
+   * @type {number}
+   * @private
+   */
+  this.interval_ = interval;
+
+  /**
+   * Start time of the current aggregate interval.
+   * @type {number}
+   * @private
+   */
+  this.intervalStartTime_ = aggregate ? wtf.now() : 0;
+
+  /**
+   * Dispatches ended in the current aggregate interval.
+   * @type {number}
+   * @private
+   */
+  this.count_ = 0;
+
+  /**
+   * Total duration of the dispatches in the current aggregate interval.
+   * @type {number}
+   * @private
+   */
+  this.totalTime_ = 0;
+
+  /**
+   * Start times of the dispatches in progress, for nested dispatches.
+   * @type {!Array.<number>}
+   * @private
+   */
+  this.startTimes_ = [];
+};
+
+
+/**
+ * Begins a dispatch.
+ * @param {...*} var_args Scope event arguments.
+ * @return {wtf.trace.Scope} Scope, if this dispatch is recorded as one.
+ */
+wtf.trace.Sampler.Site.prototype.enter = function(var_args) {
+  var scope = null;
+  if (this.rate_ && !this.skipCount_--) {
+    this.skipCount_ = this.rate_ - 1;
+    scope = this.scopeEvent_.apply(null, arguments);
+  }
+  if (this.aggregate_) {
+    this.startTimes_.push(wtf.now());
+  }
+  return scope;
+};
+
+
+/**
+ * Ends a dispatch begun with {@see #enter}.
+ * @param {wtf.trace.Scope} scope Scope returned from {@see #enter}.
+ */
+wtf.trace.Sampler.Site.prototype.leave = function(scope) {
+  wtf.trace.Scope.leave(scope);
+  if (this.aggregate_) {
+    var time = wtf.now();
+    this.count_++;
+    this.totalTime_ += time - this.startTimes_.pop();
+    if (time - this.intervalStartTime_ >= this.interval_) {
+      wtf.trace.Sampler.getAggregateEvent_()(
+          this.name_, this.count_, this.totalTime_, time);
+      this.intervalStartTime_ = time;
+      this.count_ = 0;
+      this.totalTime_ = 0;
+    }
+  }
+};
@@ -78,6 +78,28 @@ wtf.trace.Scope.pool_ = {
 };
 
 
+/**
+ * Number of scopes allocated when the pool is created.
+ * Scopes are only allocated when the pool runs dry, so preallocating a typical
+ * maximum depth keeps the enter/leave path free of allocations.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.trace.Scope.PREALLOCATED_COUNT_ = 64;
+
+
+(function() {
+  var pool = wtf.trace.Scope.pool_;
+  var count = wtf.trace.Scope.PREALLOCATED_COUNT_;
+  for (var n = 0; n < count; n++) {
+    pool.unusedScopes.push(new wtf.trace.Scope());
+    pool.stack.push(null);
+  }
+  pool.unusedIndex = count;
+})();
+
+
 /**
  * Enters a typed scope.
  * This method should only be used by internally generated code. It assumes that
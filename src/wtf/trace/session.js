@@ -16,8 +16,12 @@ goog.provide('wtf.trace.Session');
 goog.require('goog.Disposable');
 goog.require('goog.asserts');
 goog.require('goog.userAgent');
+goog.require('wtf.io.cff.chunks.EventDataChunk');
 goog.require('wtf.trace.BuiltinEvents');
+goog.require('wtf.trace.EventRegistry');
+goog.require('wtf.trace.EventSessionContext');
 goog.require('wtf.trace.Scope');
+goog.require('wtf.trace.calibration');
 
 
 
@@ -105,6 +109,55 @@ wtf.trace.Session = function(traceManager, options, defaultBufferSize) {
    * @private
    */
   this.hasDiscontinuity_ = false;
+
+  /**
+   * Number of events dropped during the current discontinuity.
+   * @type {number}
+   * @private
+   */
+  this.droppedEventCount_ = 0;
+
+  /**
+   * Number of bytes of event data dropped during the current discontinuity.
+   * @type {number}
+   * @private
+   */
+  this.droppedByteCount_ = 0;
+
+  /**
+   * Maximum number of bytes of resource data held, in bytes.
+   * Resources that would exceed this are not added and callers must record
+   * their data inline.
+   * @type {number}
+   * @private
+   */
+  this.maximumResourceMemoryUsage_ = this.options_.getNumber(
+      'wtf.trace.session.maximumResourceMemoryUsage',
+      wtf.trace.Session.DEFAULT_MAX_RESOURCE_MEMORY_USAGE_);
+
+  /**
+   * Resource data, indexed by resource ID - 1.
+   * Entries are null once released.
+   * @type {!Array.<wtf.io.BlobData>}
+   * @private
+   */
+  this.resources_ = [];
+
+  /**
+   * Resource IDs keyed by content hash.
+   * Released resources retain their IDs so that later uses of the same data
+   * reference what has already been written.
+   * @type {!Object.<number>}
+   * @private
+   */
+  this.resourceIds_ = {};
+
+  /**
+   * Number of bytes of resource data currently held.
+   * @type {number}
+   * @private
+   */
+  this.resourceMemoryUsage_ = 0;
 };
 goog.inherits(wtf.trace.Session, goog.Disposable);
 
@@ -119,6 +172,26 @@ wtf.trace.Session.DEFAULT_MAX_MEMORY_USAGE_ =
     goog.userAgent.MOBILE ? 16 * 1024 * 1024 : 512 * 1024 * 1024;
 
 
+/**
+ * Default maximum resource memory usage.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.trace.Session.DEFAULT_MAX_RESOURCE_MEMORY_USAGE_ =
+    goog.userAgent.MOBILE ? 8 * 1024 * 1024 : 128 * 1024 * 1024;
+
+
+/**
+ * Size of the event buffer in resource chunks.
+ * Resource chunks carry no events, but chunks must have an event buffer.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.trace.Session.RESOURCE_CHUNK_BUFFER_SIZE_ = 16;
+
+
 /**
  * @override
  */
@@ -164,6 +237,25 @@ wtf.trace.Session.prototype.getMetadata = function() {
 };
 
 
+/**
+ * Gets the metadata to write in a file header.
+ * This adds the measured event costs so that tools can estimate the tracing
+ * overhead in the recorded data. They are measured the first time a header is
+ * written in the process, so sessions that never write one do not pay for it.
+ * @return {!Object} Metadata.
+ * @protected
+ */
+wtf.trace.Session.prototype.getHeaderMetadata = function() {
+  var metadata = {
+    'overheadNs': wtf.trace.calibration.getCosts()
+  };
+  for (var key in this.metadata_) {
+    metadata[key] = this.metadata_[key];
+  }
+  return metadata;
+};
+
+
 /**
  * Starts a recording session.
  * Events will start recording and be directed through to the targets (depending
@@ -172,9 +264,11 @@ wtf.trace.Session.prototype.getMetadata = function() {
  */
 wtf.trace.Session.prototype.startInternal = function() {
   // Allocate a new buffer.
+  // If none is available one will be allocated on the next acquire.
   goog.asserts.assert(!this.currentChunk);
   this.currentChunk = this.nextChunk();
-  this.currentBufferView_ = this.currentChunk.getBinaryBuffer();
+  this.currentBufferView_ =
+      this.currentChunk ? this.currentChunk.getBinaryBuffer() : null;
 };
 
 
@@ -199,6 +293,25 @@ wtf.trace.Session.prototype.nextChunk = goog.abstractMethod;
 wtf.trace.Session.prototype.retireChunk = goog.abstractMethod;
 
 
+/**
+ * Retires the current chunk immediately, even if it has space remaining.
+ * The next event written will acquire a new chunk.
+ * @protected
+ */
+wtf.trace.Session.prototype.retireCurrentChunk = function() {
+  if (this.currentChunk) {
+    this.retireChunk(this.currentChunk);
+    this.currentChunk = null;
+    this.currentBufferView_ = null;
+  }
+
+  // Generated event functions hold on to the last buffer they wrote to.
+  var registry = wtf.trace.EventRegistry.getShared();
+  wtf.trace.EventSessionContext.setBuffer(
+      registry.getEventSessionContext(), null);
+};
+
+
 /**
  * Acquires the next buffer with the requested amount of space available.
  * If it's impossible to meet the request no buffer will be returned. Callers
@@ -241,14 +354,21 @@ wtf.trace.Session.prototype.acquireBuffer = function(time, size) {
   bufferView = this.currentBufferView_;
 
   // If no buffer could be allocated, flag a discontinuity.
+  // The event requesting the buffer is dropped by the caller.
   if (!bufferView) {
     this.hasDiscontinuity_ = true;
+    this.droppedEventCount_++;
+    this.droppedByteCount_ += size;
   } else if (this.hasDiscontinuity_) {
     // Handle resuming from discontinuities.
     // Note: this must occur after currentBuffer has been set, as append is
     // re-entrant to this function.
     this.hasDiscontinuity_ = false;
     wtf.trace.BuiltinEvents.discontinuity(time, bufferView);
+    wtf.trace.BuiltinEvents.dropped(
+        this.droppedEventCount_, this.droppedByteCount_, time, bufferView);
+    this.droppedEventCount_ = 0;
+    this.droppedByteCount_ = 0;
   }
 
   if (bufferView) {
@@ -270,6 +390,146 @@ wtf.trace.Session.prototype.acquireBuffer = function(time, size) {
 };
 
 
+/**
+ * Adds a resource to the session, reusing the existing resource if the same
+ * data has been added before.
+ * Resources are written to the stream once and events reference them by the
+ * returned ID. Data is matched by length and content hash, so callers should
+ * only add payloads large enough for the hashing to be worth it.
+ * Binary data is copied and may be modified after this returns.
+ * @param {!(string|Uint8Array)} data Resource data.
+ * @return {number} Resource ID, or 0 if the resource could not be added and
+ *     its data should be recorded inline.
+ */
+wtf.trace.Session.prototype.addResource = function(data) {
+  var key = wtf.trace.Session.hashResource_(data);
+  var id = this.resourceIds_[key];
+  if (id) {
+    return id;
+  }
+
+  var size = data.length;
+  if (this.resourceMemoryUsage_ + size > this.maximumResourceMemoryUsage_) {
+    return 0;
+  }
+  this.resourceMemoryUsage_ += size;
+  this.resources_.push(
+      typeof data == 'string' ? data : new Uint8Array(data));
+  id = this.resources_.length;
+  this.resourceIds_[key] = id;
+  return id;
+};
+
+
+/**
+ * Gets the number of resources added to the session.
+ * Resource IDs run from 1 to this value.
+ * @return {number} Resource count.
+ * @protected
+ */
+wtf.trace.Session.prototype.getResourceCount = function() {
+  return this.resources_.length;
+};
+
+
+/**
+ * Writes resources to a stream target in a chunk of their own.
+ * Readers assign IDs to resources in the order they appear in the stream, so
+ * all resources from ID 1 to the last written must appear exactly once and in
+ * order. Chunks referencing a resource must be written after it.
+ * @param {!wtf.io.cff.StreamTarget} streamTarget Stream target.
+ * @param {number} firstId ID of the first resource to write.
+ * @param {boolean} release Whether to release the resource data once written.
+ *     The IDs remain valid, but the resources cannot be written again.
+ * @protected
+ */
+wtf.trace.Session.prototype.writeResources = function(
+    streamTarget, firstId, release) {
+  var resources = this.resources_;
+  if (firstId > resources.length) {
+    return;
+  }
+
+  var chunk = new wtf.io.cff.chunks.EventDataChunk();
+  chunk.init(wtf.trace.Session.RESOURCE_CHUNK_BUFFER_SIZE_);
+  for (var n = firstId - 1; n < resources.length; n++) {
+    var data = resources[n];
+    goog.asserts.assert(data !== null);
+    chunk.addResource(data);
+  }
+  streamTarget.writeChunk(chunk);
+
+  if (release) {
+    // Stream targets copy the data, so it can be dropped immediately.
+    for (var n = firstId - 1; n < resources.length; n++) {
+      this.resourceMemoryUsage_ -= resources[n].length;
+      resources[n] = null;
+    }
+  }
+};
+
+
+/**
+ * Removes all resources and forgets their IDs.
+ * This must only be done when no retained events reference them.
+ * @protected
+ */
+wtf.trace.Session.prototype.resetResources = function() {
+  this.resources_ = [];
+  this.resourceIds_ = {};
+  this.resourceMemoryUsage_ = 0;
+};
+
+
+/**
+ * Computes a key for resource data from its length and content.
+ * Two independent 32-bit hashes keep accidental collisions of different data
+ * with the same length negligible.
+ * @param {!(string|Uint8Array)} data Resource data.
+ * @return {string} Key.
+ * @private
+ */
+wtf.trace.Session.hashResource_ = function(data) {
+  // FNV-1a and djb2.
+  var h1 = 0x811c9dc5 | 0;
+  var h2 = 5381;
+  var value;
+  if (typeof data == 'string') {
+    for (var n = 0; n < data.length; n++) {
+      value = data.charCodeAt(n);
+      h1 ^= value;
+      h1 = (h1 + (h1 << 1) + (h1 << 4) + (h1 << 7) + (h1 << 8) +
+          (h1 << 24)) | 0;
+      h2 = ((h2 << 5) + h2 + value) | 0;
+    }
+    return 's' + data.length + ':' + h1 + ':' + h2;
+  }
+
+  // Hash whole words and then the trailing bytes. Most large payloads are
+  // aligned; the rest are copied so that the same data always gets the same
+  // key.
+  if (data.byteOffset & 3) {
+    data = new Uint8Array(data);
+  }
+  var words = new Int32Array(data.buffer, data.byteOffset, data.length >> 2);
+  for (var m = 0; m < words.length; m++) {
+    value = words[m];
+    h1 ^= value;
+    h1 = (h1 + (h1 << 1) + (h1 << 4) + (h1 << 7) + (h1 << 8) +
+        (h1 << 24)) | 0;
+    h2 = ((h2 << 5) + h2 + value) | 0;
+  }
+  for (var k = words.length << 2; k < data.length; k++) {
+    value = data[k];
+    h1 ^= value;
+    h1 = (h1 + (h1 << 1) + (h1 << 4) + (h1 << 7) + (h1 << 8) +
+        (h1 << 24)) | 0;
+    h2 = ((h2 << 5) + h2 + value) | 0;
+  }
+  return 'b' + data.length + ':' + h1 + ':' + h2;
+};
+
+
 /**
  * An alias to the {@see wtf.trace.Scope#enterTyped} static method.
  * This is here to enable easy access from generated code.
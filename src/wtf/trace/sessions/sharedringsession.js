@@ -0,0 +1,321 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/**
+ * @fileoverview Shared memory ring recording session instance.
+ *
+ * @author benvanik@google.com (Ben Vanik)
+ */
+
+goog.provide('wtf.trace.sessions.SharedRingSession');
+
+goog.require('goog.asserts');
+goog.require('wtf.io.BufferView');
+goog.require('wtf.io.SharedRing');
+goog.require('wtf.io.cff.BinaryStreamTarget');
+goog.require('wtf.io.cff.chunks.EventDataChunk');
+goog.require('wtf.io.cff.chunks.FileHeaderChunk');
+goog.require('wtf.io.transports.MemoryWriteTransport');
+goog.require('wtf.timing');
+goog.require('wtf.timing.RunMode');
+goog.require('wtf.trace.Session');
+
+
+
+/**
+ * Shared ring session implementation.
+ * Like {@see wtf.trace.sessions.SnapshottingSession} this keeps a ring of
+ * buffers that are overwritten until a snapshot is requested, but the buffers
+ * live in a {@see wtf.io.SharedRing} backed by a SharedArrayBuffer. Another
+ * thread holding the ring (such as the page that created a worker) can
+ * snapshot it at any time without messaging or stalling the recording thread.
+ *
+ * The event header (event definitions and zones) is rewritten into the ring
+ * each time a buffer is retired so that readers always see the definitions
+ * for all buffers in the ring.
+ *
+ * Readers only see buffers that have been published, so the current buffer is
+ * published on a timer even if it is not full. Otherwise a snapshot taken from
+ * another thread would miss everything recorded since the last full buffer.
+ *
+ * @param {!wtf.trace.TraceManager} traceManager Trace manager.
+ * @param {!wtf.util.Options} options Options.
+ * @param {wtf.io.SharedRing=} opt_ring Ring to record into. A new one sized
+ *     from the options will be created if omitted.
+ * @constructor
+ * @extends {wtf.trace.Session}
+ */
+wtf.trace.sessions.SharedRingSession = function(
+    traceManager, options, opt_ring) {
+  goog.base(this, traceManager, options,
+      wtf.trace.sessions.SharedRingSession.DEFAULT_BUFFER_SIZE_);
+
+  var ring = opt_ring || null;
+  if (!ring) {
+    // Rings are allocated up front, so use a smaller default than the
+    // session maximum memory usage.
+    var ringSize = options.getNumber(
+        'wtf.trace.sharedRing.size',
+        wtf.trace.sessions.SharedRingSession.DEFAULT_RING_SIZE_);
+    var slotCount = Math.max(2, Math.floor(ringSize / this.bufferSize));
+    ring = wtf.io.SharedRing.create(
+        slotCount,
+        this.bufferSize,
+        Math.floor(this.bufferSize /
+            wtf.trace.sessions.SharedRingSession.STRING_SIZE_DIVISOR_),
+        wtf.trace.sessions.SharedRingSession.HEADER_SIZE_);
+  }
+
+  /**
+   * Ring the session records into.
+   * @type {!wtf.io.SharedRing}
+   * @private
+   */
+  this.ring_ = ring;
+
+  /**
+   * Chunks wrapping each slot of the ring, created on demand.
+   * @type {!Array.<wtf.io.cff.chunks.EventDataChunk>}
+   * @private
+   */
+  this.chunks_ = new Array(ring.getSlotCount());
+
+  /**
+   * Slot index of the current chunk, or -1 if none is acquired.
+   * @type {number}
+   * @private
+   */
+  this.currentSlot_ = -1;
+
+  /**
+   * Interval between publishes of the current buffer, in ms, or 0 to only
+   * publish full buffers.
+   * @type {number}
+   * @private
+   */
+  this.publishIntervalMs_ = options.getNumber(
+      'wtf.trace.sharedRing.publishIntervalMs',
+      wtf.trace.sessions.SharedRingSession.DEFAULT_PUBLISH_INTERVAL_MS_);
+
+  /**
+   * setInterval handle for the publish timer.
+   * @type {wtf.timing.Handle}
+   * @private
+   */
+  this.publishIntervalId_ = null;
+
+  // Start session.
+  this.startInternal();
+
+  if (this.publishIntervalMs_) {
+    this.publishIntervalId_ = wtf.timing.setInterval(
+        wtf.timing.RunMode.DEFAULT,
+        this.publishIntervalMs_,
+        this.publish, this);
+  }
+};
+goog.inherits(wtf.trace.sessions.SharedRingSession, wtf.trace.Session);
+
+
+/**
+ * @override
+ */
+wtf.trace.sessions.SharedRingSession.prototype.disposeInternal = function() {
+  if (this.publishIntervalId_) {
+    wtf.timing.clearInterval(this.publishIntervalId_);
+    this.publishIntervalId_ = null;
+  }
+  goog.base(this, 'disposeInternal');
+};
+
+
+/**
+ * Default size for individual buffers.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.trace.sessions.SharedRingSession.DEFAULT_BUFFER_SIZE_ = 512 * 1024;
+
+
+/**
+ * Default total size of the event data in the ring.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.trace.sessions.SharedRingSession.DEFAULT_RING_SIZE_ = 16 * 1024 * 1024;
+
+
+/**
+ * Ratio of the buffer size reserved for each buffer's string table.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.trace.sessions.SharedRingSession.STRING_SIZE_DIVISOR_ = 4;
+
+
+/**
+ * Size of the event header region.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.trace.sessions.SharedRingSession.HEADER_SIZE_ = 256 * 1024;
+
+
+/**
+ * Default interval between publishes of the current buffer, in ms.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.trace.sessions.SharedRingSession.DEFAULT_PUBLISH_INTERVAL_MS_ = 1000;
+
+
+/**
+ * Gets the ring the session records into.
+ * @return {!wtf.io.SharedRing} Shared ring.
+ */
+wtf.trace.sessions.SharedRingSession.prototype.getRing = function() {
+  return this.ring_;
+};
+
+
+/**
+ * Resets the session buffers to clear them.
+ */
+wtf.trace.sessions.SharedRingSession.prototype.reset = function() {
+  this.ring_.read(goog.nullFunction, null, true);
+};
+
+
+/**
+ * Publishes the current buffer so that readers of the ring can see it, if
+ * anything has been written to it.
+ * The next event written acquires a new buffer.
+ */
+wtf.trace.sessions.SharedRingSession.prototype.publish = function() {
+  if (this.currentChunk &&
+      wtf.io.BufferView.getOffset(this.currentChunk.getBinaryBuffer())) {
+    this.retireCurrentChunk();
+  }
+};
+
+
+/**
+ * Writes a snapshot of the current state.
+ * Ring buffers do not track times so the whole ring is always written.
+ * @param {!wtf.io.cff.StreamTarget} streamTarget Stream target.
+ * @param {number=} opt_startTime Ignored.
+ * @param {number=} opt_endTime Ignored.
+ * @return {boolean} True if a snapshot was written.
+ */
+wtf.trace.sessions.SharedRingSession.prototype.snapshot = function(
+    streamTarget, opt_startTime, opt_endTime) {
+  // Publish the current buffer so that it is included. Unlike snapshotting
+  // sessions we cannot keep appending to the published one, as the reader may
+  // be reading it, so event functions are moved off of it too.
+  this.publish();
+
+  return wtf.trace.sessions.SharedRingSession.writeRing(
+      this.ring_, streamTarget);
+};
+
+
+/**
+ * Writes the header and all buffers in a ring to the given stream target.
+ * This can be used from any thread holding the ring.
+ * @param {!wtf.io.SharedRing} ring Shared ring.
+ * @param {!wtf.io.cff.StreamTarget} streamTarget Stream target.
+ * @return {boolean} True if a snapshot was written.
+ */
+wtf.trace.sessions.SharedRingSession.writeRing = function(
+    ring, streamTarget) {
+  var fileHeaderChunk = new wtf.io.cff.chunks.FileHeaderChunk();
+  fileHeaderChunk.init();
+  streamTarget.writeChunk(fileHeaderChunk);
+
+  // Blobs cannot reference shared memory, so each buffer is copied once here.
+  // The string table is freshly decoded and can be used as-is.
+  var readCount = ring.read(function(bufferView, sequence) {
+    if (!wtf.io.BufferView.getOffset(bufferView)) {
+      return;
+    }
+    var copy = wtf.io.BufferView.createCopy(
+        wtf.io.BufferView.getUsedBytes(bufferView, true));
+    wtf.io.BufferView.setStringTable(
+        copy, wtf.io.BufferView.getStringTable(bufferView));
+    var chunk = new wtf.io.cff.chunks.EventDataChunk();
+    chunk.initWithBuffer(copy);
+    streamTarget.writeChunk(chunk);
+  });
+
+  streamTarget.end();
+  return readCount >= 0;
+};
+
+
+/**
+ * Snapshots a ring into a binary trace blob.
+ * @param {!wtf.io.SharedRing} ring Shared ring.
+ * @return {wtf.io.Blob} Trace data, or null if the ring could not be read.
+ */
+wtf.trace.sessions.SharedRingSession.snapshotRing = function(ring) {
+  var transport = new wtf.io.transports.MemoryWriteTransport();
+  var streamTarget = new wtf.io.cff.BinaryStreamTarget(transport);
+  var result = wtf.trace.sessions.SharedRingSession.writeRing(
+      ring, streamTarget);
+  var blob = result ? transport.getBlob() : null;
+  goog.dispose(streamTarget);
+  goog.dispose(transport);
+  return blob;
+};
+
+
+/**
+ * @override
+ */
+wtf.trace.sessions.SharedRingSession.prototype.nextChunk = function() {
+  goog.asserts.assert(this.currentSlot_ == -1);
+
+  // Refresh the header so that it covers events defined since the last
+  // buffer. This is skipped while a reader is active and retried next time.
+  var traceManager = this.getTraceManager();
+  this.ring_.updateHeader(function(bufferView) {
+    traceManager.writeEventHeader(bufferView, false);
+    traceManager.appendAllZones(bufferView);
+  });
+
+  var slot = this.ring_.acquireSlot();
+  if (slot == -1) {
+    return null;
+  }
+
+  var chunk = this.chunks_[slot];
+  if (!chunk) {
+    chunk = new wtf.io.cff.chunks.EventDataChunk();
+    chunk.initWithBuffer(this.ring_.getSlotBuffer(slot));
+    this.chunks_[slot] = chunk;
+  }
+  wtf.io.BufferView.reset(chunk.getBinaryBuffer());
+
+  this.currentSlot_ = slot;
+  return chunk;
+};
+
+
+/**
+ * @override
+ */
+wtf.trace.sessions.SharedRingSession.prototype.retireChunk = function(chunk) {
+  goog.asserts.assert(this.currentSlot_ != -1);
+  goog.asserts.assert(chunk == this.chunks_[this.currentSlot_]);
+  this.ring_.publishSlot(this.currentSlot_);
+  this.currentSlot_ = -1;
+};
@@ -13,6 +13,7 @@
 
 goog.provide('wtf.trace.sessions.SnapshottingSession');
 
+goog.require('wtf');
 goog.require('wtf.io.BufferView');
 goog.require('wtf.io.cff.chunks.EventDataChunk');
 goog.require('wtf.io.cff.chunks.FileHeaderChunk');
@@ -73,11 +74,30 @@ wtf.trace.sessions.SnapshottingSession = function(traceManager, options) {
    */
   this.dirtyChunks_ = new Array(bufferCount);
 
+  /**
+   * A 1:1 mapping to the {@see #chunks_} array with the time each chunk was
+   * last started, in ms.
+   * @type {!Array.<number>}
+   * @private
+   */
+  this.chunkStartTimes_ = new Array(bufferCount);
+
+  /**
+   * A 1:1 mapping to the {@see #chunks_} array with the time each chunk was
+   * last retired, in ms. The current chunk may still be receiving events past
+   * this time.
+   * @type {!Array.<number>}
+   * @private
+   */
+  this.chunkEndTimes_ = new Array(bufferCount);
+
   // Prep the storage arrays.
   // Note that we allocate on demand, so this doesn't create actual chunks.
   for (var n = 0; n < bufferCount; n++) {
     this.chunks_[n] = null;
     this.dirtyChunks_[n] = false;
+    this.chunkStartTimes_[n] = 0;
+    this.chunkEndTimes_[n] = 0;
   }
 
   /**
@@ -133,17 +153,23 @@ wtf.trace.sessions.SnapshottingSession.prototype.reset = function() {
     }
     this.dirtyChunks_[n] = false;
   }
+  this.resetResources();
 };
 
 
 /**
  * Writes a snapshot of the current state.
+ * If a time range is given only the buffers that overlap it are written. As
+ * buffers are written whole the snapshot may contain events outside of the
+ * range.
  * @param {!wtf.io.cff.StreamTarget} streamTarget Stream target.
+ * @param {number=} opt_startTime Start of the time range, in ms.
+ * @param {number=} opt_endTime End of the time range, in ms.
  * @return {boolean} True if a snapshot was written.
  * @template T
  */
 wtf.trace.sessions.SnapshottingSession.prototype.snapshot =
-    function(streamTarget) {
+    function(streamTarget, opt_startTime, opt_endTime) {
   // TODO(benvanik): write a snapshot event?
 
   // Retire the current buffer to ensure all data is ready for writing.
@@ -157,7 +183,10 @@ wtf.trace.sessions.SnapshottingSession.prototype.snapshot =
   this.beginWriteSnapshot_(streamTarget);
 
   // Write all dirtied buffers.
-  this.writeEventData_(streamTarget);
+  this.writeEventData_(
+      streamTarget,
+      goog.isDef(opt_startTime) ? opt_startTime : Number.NEGATIVE_INFINITY,
+      goog.isDef(opt_endTime) ? opt_endTime : Number.POSITIVE_INFINITY);
 
   // End the stream.
   this.endWriteSnapshot_(streamTarget);
@@ -180,7 +209,7 @@ wtf.trace.sessions.SnapshottingSession.prototype.beginWriteSnapshot_ =
     function(streamTarget) {
   // Write out the file header (context info/metadata/etc).
   var fileHeaderChunk = new wtf.io.cff.chunks.FileHeaderChunk();
-  fileHeaderChunk.init();
+  fileHeaderChunk.init(undefined, this.getHeaderMetadata());
   streamTarget.writeChunk(fileHeaderChunk);
 
   // Create a temporary chunk for the zones/event definitions/etc.
@@ -202,16 +231,21 @@ wtf.trace.sessions.SnapshottingSession.prototype.beginWriteSnapshot_ =
   //wtf.trace.BuiltinEvents.discontinuity(wtf.timebase(), buffer);
 
   streamTarget.writeChunk(snapshotDataChunk);
+
+  // Write all resources, as events in any of the buffers may reference them.
+  this.writeResources(streamTarget, 1, false);
 };
 
 
 /**
  * Writes all diritied buffers to the stream target and resets their state.
  * @param {!wtf.io.cff.StreamTarget} streamTarget Stream target.
+ * @param {number} startTime Start of the time range to write, in ms.
+ * @param {number} endTime End of the time range to write, in ms.
  * @private
  */
 wtf.trace.sessions.SnapshottingSession.prototype.writeEventData_ =
-    function(streamTarget) {
+    function(streamTarget, startTime, endTime) {
   // Write each dirtied buffer in order and reset them.
   // Start at the buffer immediately after the last one returned for writing and
   // walk until all the way around only writing buffers marked dirty.
@@ -224,15 +258,22 @@ wtf.trace.sessions.SnapshottingSession.prototype.writeEventData_ =
     var bufferView = chunk.getBinaryBuffer();
 
     // Ignore buffer if it is not dirty or empty.
-    var dirty = this.dirtyChunks_[index];
-    if (this.resetOnSnapshot_) {
-      this.dirtyChunks_[index] = false;
+    if (!this.dirtyChunks_[index] || !bufferView.offset) {
+      continue;
     }
-    if (!dirty || !bufferView.offset) {
+
+    // Ignore buffer if it is outside of the requested time range.
+    // The current buffer has just been retired so its end time is now.
+    // Its data is kept for later snapshots of other ranges.
+    if (this.chunkStartTimes_[index] > endTime ||
+        this.chunkEndTimes_[index] < startTime) {
       continue;
     }
 
     streamTarget.writeChunk(chunk);
+    if (this.resetOnSnapshot_) {
+      this.dirtyChunks_[index] = false;
+    }
   }
 };
 
@@ -264,6 +305,7 @@ wtf.trace.sessions.SnapshottingSession.prototype.nextChunk = function() {
 
   // Mark it as undirty and reset, as it's being reused.
   this.dirtyChunks_[this.nextChunkIndex_] = false;
+  this.chunkStartTimes_[this.nextChunkIndex_] = wtf.now();
   wtf.io.BufferView.reset(bufferView);
 
   this.nextChunkIndex_ = (this.nextChunkIndex_ + 1) % this.chunks_.length;
@@ -281,4 +323,5 @@ wtf.trace.sessions.SnapshottingSession.prototype.retireChunk = function(chunk) {
     chunkIndex = this.chunks_.length + chunkIndex;
   }
   this.dirtyChunks_[chunkIndex] = true;
+  this.chunkEndTimes_[chunkIndex] = wtf.now();
 };
@@ -13,10 +13,9 @@
 
 goog.provide('wtf.trace.sessions.StreamingSession');
 
-goog.require('goog.asserts');
-goog.require('wtf');
-goog.require('wtf.io.Buffer');
-goog.require('wtf.io.StringTable');
+goog.require('wtf.io.BufferView');
+goog.require('wtf.io.cff.chunks.EventDataChunk');
+goog.require('wtf.io.cff.chunks.FileHeaderChunk');
 goog.require('wtf.timing');
 goog.require('wtf.timing.RunMode');
 goog.require('wtf.trace.Session');
@@ -25,40 +24,104 @@ goog.require('wtf.trace.Session');
 
 /**
  * Streaming session implementation.
- * Pools buffers and writes them to streams.
+ * Pools chunks and writes them to a stream target.
+ *
+ * The pool starts small and grows on demand up to the session maximum memory
+ * usage. Retired chunks are queued until the next flush. Flushes happen
+ * periodically, and also as soon as possible when the pool runs low, so the
+ * pool only grows when data is produced faster than it can be written (such as
+ * during a long task). Chunks beyond the initial count are released after the
+ * pool has been larger than needed for a while.
+ *
+ * If the pool is exhausted events are dropped. When recording resumes the
+ * session writes a discontinuity and a count of the dropped events.
  *
  * @param {!wtf.trace.TraceManager} traceManager Trace manager.
- * @param {!wtf.io.WriteStream} stream Target stream.
+ * @param {!wtf.io.cff.StreamTarget} streamTarget Stream target. The session
+ *     takes ownership of it and disposes it when the session ends.
  * @param {!wtf.util.Options} options Options.
  * @constructor
  * @extends {wtf.trace.Session}
  */
-wtf.trace.sessions.StreamingSession = function(traceManager, stream, options) {
+wtf.trace.sessions.StreamingSession = function(
+    traceManager, streamTarget, options) {
   goog.base(this, traceManager, options,
       wtf.trace.sessions.StreamingSession.DEFAULT_BUFFER_SIZE_);
 
   /**
-   * Current stream target.
-   * This is only valid when actively recording.
-   * @type {!wtf.io.WriteStream}
+   * Target stream.
+   * @type {!wtf.io.cff.StreamTarget}
+   * @private
+   */
+  this.streamTarget_ = streamTarget;
+
+  /**
+   * Number of chunks to allocate up front.
+   * The pool never shrinks below this.
+   * @type {number}
    * @private
    */
-  this.stream_ = stream;
+  this.initialChunkCount_ = Math.max(1, options.getNumber(
+      'wtf.trace.streaming.initialBufferCount',
+      wtf.trace.sessions.StreamingSession.DEFAULT_INITIAL_BUFFER_COUNT_));
 
   /**
-   * A list of unused buffers.
-   * @type {!Array.<!wtf.io.Buffer>}
+   * Maximum number of chunks the pool can grow to.
+   * @type {number}
    * @private
    */
-  this.unusedBuffers_ = [];
+  this.maximumChunkCount_ = Math.max(this.initialChunkCount_, Math.floor(
+      this.maximumMemoryUsage / this.bufferSize));
 
   /**
-   * Total size of the unused buffer pool.
-   * This helps prevent the pool from growing over the max memory size.
+   * Total number of chunks allocated, including those in use.
    * @type {number}
    * @private
    */
-  this.totalUnusedSize_ = 0;
+  this.chunkCount_ = 0;
+
+  /**
+   * Chunks available for writing.
+   * @type {!Array.<!wtf.io.cff.chunks.EventDataChunk>}
+   * @private
+   */
+  this.unusedChunks_ = [];
+
+  /**
+   * Retired chunks waiting to be written on the next flush, in order.
+   * @type {!Array.<!wtf.io.cff.chunks.EventDataChunk>}
+   * @private
+   */
+  this.pendingChunks_ = [];
+
+  /**
+   * Number of session resources written to the stream so far.
+   * @type {number}
+   * @private
+   */
+  this.writtenResourceCount_ = 0;
+
+  /**
+   * Largest number of chunks in use at once since the last flush.
+   * @type {number}
+   * @private
+   */
+  this.peakChunkCount_ = 0;
+
+  /**
+   * Number of consecutive flushes where the pool was larger than needed.
+   * @type {number}
+   * @private
+   */
+  this.idleFlushCount_ = 0;
+
+  /**
+   * Largest number of chunks in use at once during the current run of idle
+   * flushes. The pool shrinks to this size.
+   * @type {number}
+   * @private
+   */
+  this.idlePeakChunkCount_ = 0;
 
   /**
    * Period, in ms, that the data is flushed.
@@ -77,27 +140,23 @@ wtf.trace.sessions.StreamingSession = function(traceManager, stream, options) {
    */
   this.flushIntervalId_ = null;
 
-  // Determine the number of buffers to use.
-  var bufferCount = Math.max(1, Math.floor(
-      this.maximumMemoryUsage / this.bufferSize));
+  /**
+   * Whether an early flush has been scheduled.
+   * @type {boolean}
+   * @private
+   */
+  this.earlyFlushPending_ = false;
 
-  // Allocate the buffers now.
-  for (var n = 0; n < bufferCount; n++) {
-    var stringTable = new wtf.io.StringTable();
-    this.unusedBuffers_.push(new wtf.io.Buffer(this.bufferSize, stringTable));
-    this.totalUnusedSize_ += this.bufferSize;
+  // Allocate the initial pool.
+  for (var n = 0; n < this.initialChunkCount_; n++) {
+    this.unusedChunks_.push(this.allocateChunk_());
   }
 
-  // Start the session.
-  this.startInternal();
-
   // Write trace header at the start of the stream.
-  var buffer = this.acquireBuffer(wtf.now(), this.bufferSize);
-  goog.asserts.assert(buffer);
-  this.writeTraceHeader(buffer, true);
+  this.writeHeader_();
 
-  // Flush immediately to ensure the target knows we are here.
-  this.flush();
+  // Start the session.
+  this.startInternal();
 
   // Setup a periodic flush - this ensures data streams nicely.
   if (this.flushIntervalMs_) {
@@ -120,6 +179,15 @@ goog.inherits(wtf.trace.sessions.StreamingSession, wtf.trace.Session);
 wtf.trace.sessions.StreamingSession.DEFAULT_BUFFER_SIZE_ = 256 * 1024;
 
 
+/**
+ * Default number of buffers allocated when the session starts.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.trace.sessions.StreamingSession.DEFAULT_INITIAL_BUFFER_COUNT_ = 4;
+
+
 /**
  * Default interval between automatic flushes.
  * @const
@@ -129,6 +197,24 @@ wtf.trace.sessions.StreamingSession.DEFAULT_BUFFER_SIZE_ = 256 * 1024;
 wtf.trace.sessions.StreamingSession.DEFAULT_FLUSH_INTERVAL_MS_ = 1000;
 
 
+/**
+ * Number of unused chunks below which an early flush is scheduled.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.trace.sessions.StreamingSession.LOW_WATER_COUNT_ = 1;
+
+
+/**
+ * Number of consecutive flushes with spare chunks before the pool shrinks.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.trace.sessions.StreamingSession.IDLE_FLUSHES_BEFORE_SHRINK_ = 10;
+
+
 /**
  * @override
  */
@@ -139,14 +225,53 @@ wtf.trace.sessions.StreamingSession.prototype.disposeInternal = function() {
     this.flushIntervalId_ = null;
   }
 
-  // Stop the stream.
-  this.stream_.flush();
-  goog.dispose(this.stream_);
+  // Write everything out and end the stream.
+  this.retireCurrentChunk();
+  this.writePendingChunks_();
+  this.streamTarget_.end();
+  goog.dispose(this.streamTarget_);
+
+  this.unusedChunks_ = [];
+  this.pendingChunks_ = [];
 
   goog.base(this, 'disposeInternal');
 };
 
 
+/**
+ * Allocates a new chunk for the pool.
+ * @return {!wtf.io.cff.chunks.EventDataChunk} New chunk.
+ * @private
+ */
+wtf.trace.sessions.StreamingSession.prototype.allocateChunk_ = function() {
+  var chunk = new wtf.io.cff.chunks.EventDataChunk();
+  chunk.init(this.bufferSize);
+  this.chunkCount_++;
+  return chunk;
+};
+
+
+/**
+ * Writes the file header and all event definitions and zones to the stream.
+ * All event types are defined, not just those used so far, as the stream
+ * cannot be revisited later.
+ * @private
+ */
+wtf.trace.sessions.StreamingSession.prototype.writeHeader_ = function() {
+  var fileHeaderChunk = new wtf.io.cff.chunks.FileHeaderChunk();
+  fileHeaderChunk.init(undefined, this.getHeaderMetadata());
+  this.streamTarget_.writeChunk(fileHeaderChunk);
+
+  // Use a pool chunk for the header data. It's reset when next used.
+  var chunk = this.unusedChunks_[this.unusedChunks_.length - 1];
+  var bufferView = chunk.getBinaryBuffer();
+  var traceManager = this.getTraceManager();
+  traceManager.writeEventHeader(bufferView, true);
+  traceManager.appendAllZones(bufferView);
+  this.streamTarget_.writeChunk(chunk);
+};
+
+
 /**
  * Flushes any pending buffers immediately.
  * This should be called only before long periods of activity during a recording
@@ -154,68 +279,153 @@ wtf.trace.sessions.StreamingSession.prototype.disposeInternal = function() {
  * call flush when stopping, so avoid calling it to prevent double-flushes.
  */
 wtf.trace.sessions.StreamingSession.prototype.flush = function() {
-  // Retire the current buffer, if any.
-  if (this.currentBuffer) {
-    this.retireBuffer(this.currentBuffer);
-    this.currentBuffer = null;
+  if (this.isDisposed()) {
+    return;
   }
 
-  // Flush to network.
-  this.stream_.flush();
+  // Retire the current chunk so that its data goes out now. A new chunk will
+  // be acquired by the next event.
+  this.retireCurrentChunk();
+  this.writePendingChunks_();
+  this.shrinkIfIdle_();
+};
+
 
-  // Allocate a new buffer. This assumes that the flush is occurring with the
-  // intent of writing more. Applications that will be stopping should use
-  // {@see #stop} instead.
-  this.currentBuffer = this.nextBuffer();
+/**
+ * Writes chunks recorded outside of the session, such as by a provider, to the
+ * stream. Everything recorded by the session so far, including the current
+ * chunk, is written first so that the chunks can rely on it (such as the
+ * creation of a zone they switch to).
+ * @param {!Array.<!wtf.io.cff.Chunk>} chunks Chunks. They are copied and can
+ *     be reused immediately.
+ */
+wtf.trace.sessions.StreamingSession.prototype.writeChunks = function(chunks) {
+  if (this.isDisposed()) {
+    return;
+  }
+  this.retireCurrentChunk();
+  this.writePendingChunks_();
+  for (var n = 0; n < chunks.length; n++) {
+    this.streamTarget_.writeChunk(chunks[n]);
+  }
 };
 
 
 /**
- * @override
+ * Writes all pending chunks to the stream target and returns them to the pool.
+ * @private
+ */
+wtf.trace.sessions.StreamingSession.prototype.writePendingChunks_ =
+    function() {
+  // Resources go out ahead of the chunks that reference them. They are never
+  // written again, so they can be released.
+  var resourceCount = this.getResourceCount();
+  if (resourceCount > this.writtenResourceCount_) {
+    this.writeResources(
+        this.streamTarget_, this.writtenResourceCount_ + 1, true);
+    this.writtenResourceCount_ = resourceCount;
+  }
+
+  var pendingChunks = this.pendingChunks_;
+  this.pendingChunks_ = [];
+  for (var n = 0; n < pendingChunks.length; n++) {
+    // Stream targets copy the data, so the chunk can be reused immediately.
+    var chunk = pendingChunks[n];
+    this.streamTarget_.writeChunk(chunk);
+    this.unusedChunks_.push(chunk);
+  }
+};
+
+
+/**
+ * Releases unused chunks beyond what has recently been needed, if the pool
+ * has been larger than needed for a while.
+ * @private
  */
-wtf.trace.sessions.StreamingSession.prototype.nextBuffer = function() {
-  // Attempt to get a buffer from the pool.
-  if (this.unusedBuffers_.length) {
-    var buffer = this.unusedBuffers_.pop();
-    this.totalUnusedSize_ -= buffer.capacity;
-    return buffer;
+wtf.trace.sessions.StreamingSession.prototype.shrinkIfIdle_ = function() {
+  // Start the next interval from what is in use now.
+  var peakCount = this.peakChunkCount_;
+  this.peakChunkCount_ = this.chunkCount_ - this.unusedChunks_.length;
+
+  if (peakCount >= this.chunkCount_ ||
+      this.chunkCount_ <= this.initialChunkCount_) {
+    // The whole pool was needed.
+    this.idleFlushCount_ = 0;
+    this.idlePeakChunkCount_ = 0;
+    return;
+  }
+  this.idlePeakChunkCount_ = Math.max(this.idlePeakChunkCount_, peakCount);
+  if (++this.idleFlushCount_ <
+      wtf.trace.sessions.StreamingSession.IDLE_FLUSHES_BEFORE_SHRINK_) {
+    return;
   }
 
-  // No buffer found.
-  // TODO(benvanik): allow growth over maximum?
-  return null;
+  var targetCount = Math.max(
+      this.initialChunkCount_, this.idlePeakChunkCount_);
+  while (this.chunkCount_ > targetCount && this.unusedChunks_.length) {
+    this.unusedChunks_.pop();
+    this.chunkCount_--;
+  }
+  this.idleFlushCount_ = 0;
+  this.idlePeakChunkCount_ = 0;
+};
+
+
+/**
+ * Schedules a flush as soon as possible, if one is not already pending.
+ * @private
+ */
+wtf.trace.sessions.StreamingSession.prototype.scheduleEarlyFlush_ =
+    function() {
+  if (this.earlyFlushPending_) {
+    return;
+  }
+  this.earlyFlushPending_ = true;
+  wtf.timing.setImmediate(function() {
+    this.earlyFlushPending_ = false;
+    this.flush();
+  }, this);
 };
 
 
 /**
  * @override
  */
-wtf.trace.sessions.StreamingSession.prototype.retireBuffer = function(buffer) {
-  // Buffer is now full of useful data - write it out.
+wtf.trace.sessions.StreamingSession.prototype.nextChunk = function() {
+  var chunk = null;
+  if (this.unusedChunks_.length) {
+    chunk = this.unusedChunks_.pop();
+    wtf.io.BufferView.reset(chunk.getBinaryBuffer());
+  } else if (this.chunkCount_ < this.maximumChunkCount_) {
+    // Grow the pool.
+    chunk = this.allocateChunk_();
+  }
 
-  // Check to see if the buffer is actually empty.
-  if (!buffer.offset) {
-    // No data - return to pool.
-    this.unusedBuffers_.push(buffer);
-    this.totalUnusedSize_ += buffer.capacity;
-    return;
+  // Write out data early if the pool is running low so that chunks return to
+  // the pool before it must grow (or drop events).
+  if (this.unusedChunks_.length <=
+      wtf.trace.sessions.StreamingSession.LOW_WATER_COUNT_) {
+    this.scheduleEarlyFlush_();
   }
 
-  // Write the buffer to the stream.
-  // This may be async and not allow the buffer to be reused - in that case,
-  // we clean up in {@see #returnBufferCallback_}.
-  this.stream_.write(buffer, this.returnBufferCallback_, this);
+  if (chunk) {
+    var inUseCount = this.chunkCount_ - this.unusedChunks_.length;
+    this.peakChunkCount_ = Math.max(this.peakChunkCount_, inUseCount);
+  }
+  return chunk;
 };
 
 
 /**
- * Handles buffer returns from stream writers.
- * @param {!wtf.io.Buffer} buffer Buffer to return.
- * @private
+ * @override
  */
-wtf.trace.sessions.StreamingSession.prototype.returnBufferCallback_ =
-    function(buffer) {
-  this.unusedBuffers_.push(buffer);
-  this.totalUnusedSize_ += buffer.capacity;
-  buffer.reset();
+wtf.trace.sessions.StreamingSession.prototype.retireChunk = function(chunk) {
+  if (!wtf.io.BufferView.getOffset(chunk.getBinaryBuffer())) {
+    // No data - return to pool.
+    this.unusedChunks_.push(chunk);
+    return;
+  }
+
+  // Queue for writing on the next flush.
+  this.pendingChunks_.push(chunk);
 };
@@ -21,13 +21,16 @@ goog.require('goog.string');
 goog.require('wtf');
 goog.require('wtf.data.EventFlag');
 goog.require('wtf.io');
+goog.require('wtf.io.SharedRing');
 goog.require('wtf.io.WriteTransport');
 goog.require('wtf.io.cff.BinaryStreamTarget');
+goog.require('wtf.io.cff.EventBufferCodec');
 goog.require('wtf.io.cff.JsonStreamTarget');
 goog.require('wtf.io.transports.BlobWriteTransport');
 goog.require('wtf.io.transports.FileWriteTransport');
 goog.require('wtf.io.transports.MemoryWriteTransport');
 goog.require('wtf.io.transports.NullWriteTransport');
+goog.require('wtf.io.transports.StreamingXhrWriteTransport');
 goog.require('wtf.io.transports.XhrWriteTransport');
 goog.require('wtf.trace.BuiltinEvents');
 goog.require('wtf.trace.Flow');
@@ -36,7 +39,9 @@ goog.require('wtf.trace.TraceManager');
 goog.require('wtf.trace.events');
 goog.require('wtf.trace.eventtarget');
 goog.require('wtf.trace.sessions.NullSession');
+goog.require('wtf.trace.sessions.SharedRingSession');
 goog.require('wtf.trace.sessions.SnapshottingSession');
+goog.require('wtf.trace.sessions.StreamingSession');
 goog.require('wtf.trace.util');
 
 
@@ -191,8 +196,10 @@ wtf.trace.createTransport_ = function(options, streaming, opt_targetValue) {
       targetUrl = targetUrl.substring('http-rel:'.length);
     }
     if (streaming) {
-      throw 'Streaming XHR transport not yet supported.';
-      // return new wtf.io.transports.StreamingXhrWriteTransport(targetUrl);
+      var transport = new wtf.io.transports.StreamingXhrWriteTransport(
+          targetUrl);
+      transport.needsLibraryDispose = true;
+      return transport;
     } else {
       var transport = new wtf.io.transports.XhrWriteTransport(
           targetUrl, undefined, wtf.trace.getTraceFilename());
@@ -231,7 +238,12 @@ wtf.trace.createStreamTarget_ = function(options, transport) {
   switch (formatValue) {
     default:
     case 'binary':
-      return new wtf.io.cff.BinaryStreamTarget(transport);
+      var compression = /** @type {wtf.io.cff.EventBufferCodec.Mode} */ (
+          options.getString('wtf.trace.compression',
+              wtf.io.cff.EventBufferCodec.Mode.NONE));
+      return new wtf.io.cff.BinaryStreamTarget(
+          transport, compression,
+          options.getBoolean('wtf.trace.chunkIndex', false));
     case 'json':
       return new wtf.io.cff.JsonStreamTarget(
           transport, wtf.io.cff.JsonStreamTarget.Mode.COMPLETE);
@@ -276,13 +288,22 @@ wtf.trace.start = function(opt_options) {
       session = new wtf.trace.sessions.SnapshottingSession(
           traceManager, options);
       break;
+    case 'shared':
+      // Falls back to snapshotting when shared memory is unavailable.
+      if (wtf.io.SharedRing.isSupported()) {
+        session = new wtf.trace.sessions.SharedRingSession(
+            traceManager, options);
+      } else {
+        session = new wtf.trace.sessions.SnapshottingSession(
+            traceManager, options);
+      }
+      break;
     case 'stream':
     case 'streaming':
-      // var transport = wtf.trace.createTransport_(options, true);
-      // var streamTarget = wtf.trace.createStreamTarget_(options, transport);
-      // session = new wtf.trace.sessions.StreamingSession(
-      //     traceManager, streamTarget, options);
-      throw new Error('Streaming not yet implemented');
+      var transport = wtf.trace.createTransport_(options, true);
+      var streamTarget = wtf.trace.createStreamTarget_(options, transport);
+      session = new wtf.trace.sessions.StreamingSession(
+          traceManager, streamTarget, options);
       break;
   }
   goog.asserts.assert(session);
@@ -296,13 +317,18 @@ wtf.trace.start = function(opt_options) {
  * Takes a snapshot of the current state.
  * A session must be actively recording. This call is ignored if the session
  * does not support snapshotting.
+ * A time range can be given to only snapshot the buffers that overlap it.
+ * Sessions that do not track buffer times ignore the range.
  * @param {wtf.io.WriteTransport|*=} opt_targetValue Stream target value.
+ * @param {number=} opt_startTime Start of the time range, in ms.
+ * @param {number=} opt_endTime End of the time range, in ms.
  */
-wtf.trace.snapshot = function(opt_targetValue) {
+wtf.trace.snapshot = function(opt_targetValue, opt_startTime, opt_endTime) {
   var traceManager = wtf.trace.getTraceManager();
   var session = traceManager.getCurrentSession();
   if (!session ||
-      !(session instanceof wtf.trace.sessions.SnapshottingSession)) {
+      !(session instanceof wtf.trace.sessions.SnapshottingSession ||
+        session instanceof wtf.trace.sessions.SharedRingSession)) {
     return;
   }
 
@@ -324,7 +350,7 @@ wtf.trace.snapshot = function(opt_targetValue) {
   goog.asserts.assert(streamTarget);
 
   // Write the snapshot data into the target.
-  session.snapshot(streamTarget);
+  session.snapshot(streamTarget, opt_startTime, opt_endTime);
 
   // Finish CFF.
   goog.dispose(streamTarget);
@@ -363,7 +389,8 @@ wtf.trace.snapshotAll = function(callback, opt_scope) {
 wtf.trace.reset = function() {
   var traceManager = wtf.trace.getTraceManager();
   var session = traceManager.getCurrentSession();
-  if (session instanceof wtf.trace.sessions.SnapshottingSession) {
+  if (session instanceof wtf.trace.sessions.SnapshottingSession ||
+      session instanceof wtf.trace.sessions.SharedRingSession) {
     session.reset();
   }
 };
@@ -28,6 +28,7 @@ goog.require('wtf.trace.BuiltinEvents');
 goog.require('wtf.trace.EventRegistry');
 goog.require('wtf.trace.EventSessionContext');
 goog.require('wtf.trace.Zone');
+goog.require('wtf.trace.sessions.SharedRingSession');
 goog.require('wtf.trace.sessions.SnapshottingSession');
 goog.require('wtf.util.Options');
 
@@ -438,7 +439,8 @@ wtf.trace.TraceManager.prototype.requestSnapshots = function(
     callback, opt_scope) {
   var session = this.currentSession_;
   if (!session ||
-      !(session instanceof wtf.trace.sessions.SnapshottingSession)) {
+      !(session instanceof wtf.trace.sessions.SnapshottingSession ||
+        session instanceof wtf.trace.sessions.SharedRingSession)) {
     wtf.timing.setImmediate(function() {
       callback.call(opt_scope, null);
     });
@@ -20,9 +20,11 @@ goog.require('goog.array');
 goog.require('goog.asserts');
 goog.require('goog.debug');
 goog.require('goog.dom');
+goog.require('goog.dom.TagName');
 goog.require('goog.math.Rect');
 goog.require('goog.math.Size');
 goog.require('wtf.timing');
+goog.require('wtf.ui.TileCache');
 goog.require('wtf.util.canvas');
 
 
@@ -169,6 +171,38 @@ wtf.ui.Painter = function(canvas) {
    */
   this.repaintPending_ = false;
 
+  /**
+   * Whether an overlay-only repaint has been requested and is pending the next
+   * frame.
+   * @type {boolean}
+   * @private
+   */
+  this.overlayRepaintPending_ = false;
+
+  /**
+   * Copy of the canvas after the last full repaint, without overlays.
+   * Only the root keeps this, and only once an overlay repaint has been
+   * requested.
+   * @type {HTMLCanvasElement}
+   * @private
+   */
+  this.contentSnapshot_ = null;
+
+  /**
+   * Whether {@see #contentSnapshot_} matches the current contents.
+   * @type {boolean}
+   * @private
+   */
+  this.contentSnapshotValid_ = false;
+
+  /**
+   * Offscreen tile cache shared by all painters under the root.
+   * Created on demand.
+   * @type {wtf.ui.TileCache}
+   * @private
+   */
+  this.tileCache_ = null;
+
   /**
    * A click handler used if {@see #onClickInternal} is not overridden.
    * @type {(function(number, number, number, !goog.math.Rect):
@@ -193,6 +227,7 @@ goog.inherits(wtf.ui.Painter, goog.Disposable);
  */
 wtf.ui.Painter.prototype.disposeInternal = function() {
   goog.disposeAll(this.childPainters_);
+  goog.dispose(this.tileCache_);
   goog.base(this, 'disposeInternal');
 };
 
@@ -234,6 +269,37 @@ wtf.ui.Painter.prototype.getCanvasContext2d = function() {
 };
 
 
+/**
+ * Sets the canvas rendering context the painter draws with.
+ * This is used to redirect drawing into offscreen canvases, such as cached
+ * tiles. Helpers like {@see #clear} draw into the new context until it is
+ * swapped back.
+ * @param {!CanvasRenderingContext2D} ctx New canvas rendering context.
+ * @return {!CanvasRenderingContext2D} Previous canvas rendering context.
+ * @protected
+ */
+wtf.ui.Painter.prototype.swapCanvasContext2d = function(ctx) {
+  var previous = this.canvasContext2d_;
+  this.canvasContext2d_ = ctx;
+  return previous;
+};
+
+
+/**
+ * Gets the tile cache shared by all painters under the root painter.
+ * @return {!wtf.ui.TileCache} Tile cache.
+ */
+wtf.ui.Painter.prototype.getTileCache = function() {
+  if (this.parentPainter_) {
+    return this.parentPainter_.getTileCache();
+  }
+  if (!this.tileCache_) {
+    this.tileCache_ = new wtf.ui.TileCache(this.dom_);
+  }
+  return this.tileCache_;
+};
+
+
 /**
  * Gets the pixel scaling ratio used to transform logical pixels to
  * canvas pixels.
@@ -507,7 +573,32 @@ wtf.ui.Painter.prototype.requestRepaint = function() {
     this.parentPainter_.requestRepaint();
   } else if (!this.repaintPending_) {
     this.repaintPending_ = true;
-    wtf.timing.deferToNextFrame(this.repaintRequested_, this);
+    if (!this.overlayRepaintPending_) {
+      wtf.timing.deferToNextFrame(this.repaintRequested_, this);
+    }
+  }
+};
+
+
+/**
+ * Requests a repaint of only the overlays on the next rAF.
+ * Use this when only state drawn by {@see #repaintOverlayInternal} has
+ * changed, such as the hover position. The rest of the canvas is restored
+ * from a copy made after the last full repaint.
+ */
+wtf.ui.Painter.prototype.requestOverlayRepaint = function() {
+  if (this.parentPainter_) {
+    this.parentPainter_.requestOverlayRepaint();
+  } else if (!this.overlayRepaintPending_) {
+    this.overlayRepaintPending_ = true;
+    if (!this.contentSnapshot_) {
+      // Start keeping snapshots. The first overlay repaint is a full one.
+      this.contentSnapshot_ = /** @type {!HTMLCanvasElement} */ (
+          this.dom_.createElement(goog.dom.TagName.CANVAS));
+    }
+    if (!this.repaintPending_) {
+      wtf.timing.deferToNextFrame(this.repaintRequested_, this);
+    }
   }
 };
 
@@ -518,11 +609,18 @@ wtf.ui.Painter.prototype.requestRepaint = function() {
  * @private
  */
 wtf.ui.Painter.prototype.repaintRequested_ = function() {
-  if (this.parentPainter_ || !this.repaintPending_) {
+  if (this.parentPainter_) {
     return;
   }
+  var fullRepaint = this.repaintPending_;
+  var overlayRepaint = this.overlayRepaintPending_;
   this.repaintPending_ = false;
-  this.repaint();
+  this.overlayRepaintPending_ = false;
+  if (fullRepaint) {
+    this.repaint();
+  } else if (overlayRepaint) {
+    this.repaintOverlays_();
+  }
 };
 
 
@@ -571,6 +669,47 @@ wtf.ui.Painter.prototype.repaint = function() {
 
   // Recursively repaint.
   this.recursiveRepaint_();
+
+  // Keep the contents so overlay-only changes don't need to repaint them.
+  if (this.contentSnapshot_) {
+    var snapshot = this.contentSnapshot_;
+    if (snapshot.width != this.canvas_.width ||
+        snapshot.height != this.canvas_.height) {
+      snapshot.width = this.canvas_.width;
+      snapshot.height = this.canvas_.height;
+    }
+    var snapshotCtx = wtf.util.canvas.getContext2d(snapshot);
+    snapshotCtx.globalCompositeOperation = 'copy';
+    snapshotCtx.drawImage(this.canvas_, 0, 0);
+    this.contentSnapshotValid_ = true;
+  }
+
+  this.recursiveRepaintOverlay_();
+};
+
+
+/**
+ * Restores the contents from the last full repaint and repaints overlays.
+ * @private
+ */
+wtf.ui.Painter.prototype.repaintOverlays_ = function() {
+  var snapshot = this.contentSnapshot_;
+  if (!this.ready_ || !this.contentSnapshotValid_ || !snapshot ||
+      snapshot.width != this.canvas_.width ||
+      snapshot.height != this.canvas_.height) {
+    this.repaint();
+    return;
+  }
+
+  var ctx = this.canvasContext2d_;
+  ctx.save();
+  ctx.setTransform(1, 0, 0, 1, 0, 0);
+  ctx.globalCompositeOperation = 'copy';
+  ctx.drawImage(snapshot, 0, 0);
+  ctx.restore();
+
+  wtf.util.canvas.reset(ctx, this.pixelRatio_);
+  this.recursiveRepaintOverlay_();
 };
 
 
@@ -589,7 +728,7 @@ wtf.ui.Painter.prototype.recursiveRepaint_ = function() {
 
   // Paint self.
   ctx.save();
-  var preventChildren = this.repaintInternal(ctx, this.drawBounds_);
+  var preventChildren = this.repaintContents(ctx, this.drawBounds_);
   if (wtf.ui.Painter.DEBUG_) {
     ctx.strokeStyle = '#ff0000';
     ctx.strokeRect(
@@ -613,6 +752,44 @@ wtf.ui.Painter.prototype.recursiveRepaint_ = function() {
 };
 
 
+/**
+ * Repaints the overlays of the painter and its children.
+ * Children are always visited so that their overlays draw on top.
+ * @private
+ */
+wtf.ui.Painter.prototype.recursiveRepaintOverlay_ = function() {
+  var ctx = this.canvasContext2d_;
+
+  // Skip if too small.
+  if (this.drawBounds_.width <= 0 ||
+      this.drawBounds_.height <= 0) {
+    return;
+  }
+
+  ctx.save();
+  this.repaintOverlayInternal(ctx, this.drawBounds_);
+  ctx.restore();
+
+  for (var n = 0; n < this.childPainters_.length; n++) {
+    this.childPainters_[n].recursiveRepaintOverlay_();
+  }
+};
+
+
+/**
+ * Repaints the contents of the painter during a full repaint.
+ * By default this calls {@see #repaintInternal} directly. Subclasses can
+ * override it to draw from a cache instead.
+ * @param {!CanvasRenderingContext2D} ctx Canvas render context.
+ * @param {!goog.math.Rect} bounds Draw bounds.
+ * @return {boolean|undefined} True to prevent painting of children.
+ * @protected
+ */
+wtf.ui.Painter.prototype.repaintContents = function(ctx, bounds) {
+  return this.repaintInternal(ctx, bounds);
+};
+
+
 /**
  * Repaints the context contents.
  * @param {!CanvasRenderingContext2D} ctx Canvas render context.
@@ -623,6 +800,17 @@ wtf.ui.Painter.prototype.recursiveRepaint_ = function() {
 wtf.ui.Painter.prototype.repaintInternal = goog.nullFunction;
 
 
+/**
+ * Repaints transient state drawn over the contents of all painters, such as
+ * hover markers. Overlays can be repainted alone with
+ * {@see #requestOverlayRepaint}.
+ * @param {!CanvasRenderingContext2D} ctx Canvas render context.
+ * @param {!goog.math.Rect} bounds Draw bounds.
+ * @protected
+ */
+wtf.ui.Painter.prototype.repaintOverlayInternal = goog.nullFunction;
+
+
 /**
  * Clips rendering to the given rectangular region, in pixels.
  * @param {number} x X.
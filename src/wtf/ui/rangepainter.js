@@ -102,6 +102,17 @@ wtf.ui.RangePainter.DrawStyle = {
 };
 
 
+/**
+ * Minimum on-screen width of a range for its label to be drawn, in pixels.
+ * This is the full width of the range, not the part left after clipping to
+ * the screen or to a tile.
+ * @type {number}
+ * @const
+ * @protected
+ */
+wtf.ui.RangePainter.MIN_LABEL_WIDTH = 15;
+
+
 /**
  * Resets range renderer caches and prepares for drawing.
  * @param {!goog.math.Rect} bounds Draw bounds.
@@ -150,6 +161,8 @@ wtf.ui.RangePainter.prototype.drawRange = function(
 
 /**
  * Queues a label for drawing.
+ * When rendering a tile the label is kept with the tile and drawn over it on
+ * each repaint, as labels are positioned relative to the screen.
  * @param {!goog.math.Rect} bounds Draw bounds.
  * @param {number} left Unclamped X offset on the canvas.
  * @param {number} right Unclamped X+W offset on the canvas.
@@ -161,6 +174,25 @@ wtf.ui.RangePainter.prototype.drawRange = function(
  */
 wtf.ui.RangePainter.prototype.drawRangeLabel = function(
     bounds, left, right, screenLeft, screenRight, y, label) {
+  if (this.currentTile) {
+    // Tiles are drawn at the screen scale, so this is the final width of the
+    // range and labels of ranges cut by the tile edges are kept.
+    var boundsRight = bounds.left + bounds.width;
+    this.labelsToDraw_.push({
+      text: label,
+      y: y,
+      timeLeft: wtf.math.remap(left,
+          bounds.left, boundsRight, this.timeLeft, this.timeRight),
+      timeRight: wtf.math.remap(right,
+          bounds.left, boundsRight, this.timeLeft, this.timeRight)
+    });
+    return;
+  }
+
+  if (right - left <= wtf.ui.RangePainter.MIN_LABEL_WIDTH) {
+    return;
+  }
+
   var ctx = this.getCanvasContext2d();
 
   // Calculate label width to determine fade.
@@ -197,19 +229,14 @@ wtf.ui.RangePainter.prototype.endRenderingRanges = function(
   var ctx = this.getCanvasContext2d();
   top += bounds.top;
 
-  var currentAlpha = 1;
   ctx.globalAlpha = 1;
 
   // Setup style information.
   var insetY = 0;
   var insetH = 0;
-  var labelBackground = null;
-  var labelForeground = '#FFFFFF';
   switch (this.drawStyle_) {
     case wtf.ui.RangePainter.DrawStyle.TIME_SPAN:
       insetY = insetH = rowHeight / 4;
-      labelBackground = '#FFFFFF';
-      labelForeground = '#000000';
       break;
   }
 
@@ -227,6 +254,44 @@ wtf.ui.RangePainter.prototype.endRenderingRanges = function(
     y += rowHeight;
   }
 
+  if (this.currentTile) {
+    // Labels are drawn by repaintFixedInternal.
+    this.currentTile.data = {
+      top: top,
+      rowHeight: rowHeight,
+      drawStyle: this.drawStyle_,
+      labels: this.labelsToDraw_.slice()
+    };
+  } else {
+    this.drawLabels_(ctx, top, rowHeight, this.drawStyle_);
+  }
+  this.labelsToDraw_.length = 0;
+  ctx.globalAlpha = 1;
+};
+
+
+/**
+ * Draws the queued labels.
+ * @param {!CanvasRenderingContext2D} ctx Canvas render context.
+ * @param {number} top Y offset of the first row.
+ * @param {number} rowHeight Height of each row.
+ * @param {wtf.ui.RangePainter.DrawStyle} drawStyle Draw style.
+ * @private
+ */
+wtf.ui.RangePainter.prototype.drawLabels_ = function(
+    ctx, top, rowHeight, drawStyle) {
+  var currentAlpha = 1;
+  ctx.globalAlpha = 1;
+
+  var labelBackground = null;
+  var labelForeground = '#FFFFFF';
+  switch (drawStyle) {
+    case wtf.ui.RangePainter.DrawStyle.TIME_SPAN:
+      labelBackground = '#FFFFFF';
+      labelForeground = '#000000';
+      break;
+  }
+
   // Draw the designated labels on top.
   ctx.fillStyle = labelForeground;
   for (var n = 0; n < this.labelsToDraw_.length; n++) {
@@ -247,6 +312,57 @@ wtf.ui.RangePainter.prototype.endRenderingRanges = function(
 
     ctx.fillText(label.text, label.x, top + label.y + labelHeight);
   }
-  this.labelsToDraw_.length = 0;
   ctx.globalAlpha = 1;
 };
+
+
+/**
+ * @override
+ */
+wtf.ui.RangePainter.prototype.repaintFixedInternal = function(
+    ctx, bounds, tiles) {
+  if (!tiles) {
+    return;
+  }
+
+  // Ranges that span several tiles have their label kept in each of them.
+  var timeLeft = this.timeLeft;
+  var timeRight = this.timeRight;
+  var boundsRight = bounds.left + bounds.width;
+  var style = null;
+  var seen = {};
+  for (var n = 0; n < tiles.length; n++) {
+    var data = tiles[n].data;
+    if (!data) {
+      continue;
+    }
+    style = data;
+    for (var m = 0; m < data.labels.length; m++) {
+      var label = data.labels[m];
+      var key = label.text + ':' + label.y + ':' +
+          Math.round(label.timeLeft * 1000) + ':' +
+          Math.round(label.timeRight * 1000);
+      if (seen[key]) {
+        continue;
+      }
+      seen[key] = true;
+
+      var left = wtf.math.remap(label.timeLeft,
+          timeLeft, timeRight, bounds.left, boundsRight);
+      var right = wtf.math.remap(label.timeRight,
+          timeLeft, timeRight, bounds.left, boundsRight);
+      var screenLeft = Math.max(bounds.left, left);
+      var screenRight = Math.min(boundsRight - 0.999, right);
+      if (screenLeft >= screenRight) {
+        continue;
+      }
+      this.drawRangeLabel(
+          bounds, left, right, screenLeft, screenRight, label.y, label.text);
+    }
+  }
+
+  if (style) {
+    this.drawLabels_(ctx, style.top, style.rowHeight, style.drawStyle);
+  }
+  this.labelsToDraw_.length = 0;
+};
@@ -95,16 +95,6 @@ wtf.ui.RulerPainter.prototype.layoutInternal = function(availableBounds) {
 wtf.ui.RulerPainter.prototype.repaintInternal = function(ctx, bounds) {
   var width = bounds.width;
 
-  // Hover UI.
-  // TODO(benvanik): this displays under other painters - it should be moved to
-  //     its own painter.
-  if (this.showHoverTip_ && this.hoverX_) {
-    ctx.fillStyle = '#000000';
-    ctx.fillRect(
-        bounds.left + this.hoverX_, bounds.top,
-        1, this.getScaledCanvasHeight() - bounds.top);
-  }
-
   // Clip to extents.
   this.clip(bounds.left, bounds.top, bounds.width, bounds.height);
 
@@ -144,22 +134,40 @@ wtf.ui.RulerPainter.prototype.repaintInternal = function(ctx, bounds) {
     granularity /= 10;
     n++;
   }
+};
 
-  // Draw the hover time.
-  if (this.showHoverTip_ && this.hoverX_) {
-    var time = wtf.math.remap(this.hoverX_, 0, width, timeLeft, timeRight);
-    var timeString = wtf.db.Unit.format(time, this.units);
-    var timeWidth = ctx.measureText(timeString).width;
-    ctx.globalAlpha = 1;
-    ctx.fillStyle = '#FFFFFF';
-    ctx.fillRect(
-        bounds.left + this.hoverX_ - timeWidth / 2 - 3, bounds.top,
-        timeWidth + 6, bounds.height - 1);
-    ctx.fillStyle = '#000000';
-    ctx.fillText(
-        timeString,
-        bounds.left + this.hoverX_ - timeWidth / 2, bounds.top + 11);
+
+/**
+ * @override
+ */
+wtf.ui.RulerPainter.prototype.repaintOverlayInternal = function(
+    ctx, bounds) {
+  if (!this.showHoverTip_ || !this.hoverX_) {
+    return;
   }
+  var width = bounds.width;
+  var timeLeft = this.timeLeft;
+  var timeRight = this.timeRight;
+
+  // Hover bar, drawn over all of the painters below the ruler.
+  ctx.fillStyle = '#000000';
+  ctx.fillRect(
+      bounds.left + this.hoverX_, bounds.top,
+      1, this.getScaledCanvasHeight() - bounds.top);
+
+  // Draw the hover time.
+  var time = wtf.math.remap(this.hoverX_, 0, width, timeLeft, timeRight);
+  var timeString = wtf.db.Unit.format(time, this.units);
+  var timeWidth = ctx.measureText(timeString).width;
+  ctx.globalAlpha = 1;
+  ctx.fillStyle = '#FFFFFF';
+  ctx.fillRect(
+      bounds.left + this.hoverX_ - timeWidth / 2 - 3, bounds.top,
+      timeWidth + 6, bounds.height - 1);
+  ctx.fillStyle = '#000000';
+  ctx.fillText(
+      timeString,
+      bounds.left + this.hoverX_ - timeWidth / 2, bounds.top + 11);
 };
 
 
@@ -172,7 +180,7 @@ wtf.ui.RulerPainter.prototype.onMouseMoveInternal =
     return;
   }
   this.hoverX_ = x;
-  this.requestRepaint();
+  this.requestOverlayRepaint();
 };
 
 
@@ -184,5 +192,5 @@ wtf.ui.RulerPainter.prototype.onMouseOutInternal = function() {
     return;
   }
   this.hoverX_ = 0;
-  this.requestRepaint();
+  this.requestOverlayRepaint();
 };
@@ -0,0 +1,207 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/**
+ * @fileoverview Offscreen tile cache used by painters.
+ *
+ * @author benvanik@google.com (Ben Vanik)
+ */
+
+goog.provide('wtf.ui.TileCache');
+goog.provide('wtf.ui.TileCache.Tile');
+
+goog.require('goog.Disposable');
+goog.require('goog.array');
+goog.require('goog.dom.TagName');
+goog.require('wtf.util.canvas');
+
+
+
+/**
+ * A least-recently-used cache of offscreen canvases.
+ * Painters key tiles by whatever determines their contents, such as the time
+ * range and zoom level of a track. Tiles of evicted keys have their canvases
+ * reused for new tiles.
+ *
+ * @param {!goog.dom.DomHelper} dom DOM helper.
+ * @param {number=} opt_maxPixels Maximum number of canvas pixels to keep.
+ * @constructor
+ * @extends {goog.Disposable}
+ */
+wtf.ui.TileCache = function(dom, opt_maxPixels) {
+  goog.base(this);
+
+  /**
+   * DOM helper.
+   * @type {!goog.dom.DomHelper}
+   * @private
+   */
+  this.dom_ = dom;
+
+  /**
+   * Maximum number of canvas pixels to keep across all tiles.
+   * @type {number}
+   * @private
+   */
+  this.maxPixels_ = opt_maxPixels || wtf.ui.TileCache.DEFAULT_MAX_PIXELS_;
+
+  /**
+   * Number of canvas pixels in all tiles.
+   * @type {number}
+   * @private
+   */
+  this.pixelCount_ = 0;
+
+  /**
+   * Tiles by key.
+   * @type {!Object.<!wtf.ui.TileCache.Tile>}
+   * @private
+   */
+  this.tiles_ = {};
+
+  /**
+   * Tiles in least-recently-used order.
+   * @type {!Array.<!wtf.ui.TileCache.Tile>}
+   * @private
+   */
+  this.usage_ = [];
+};
+goog.inherits(wtf.ui.TileCache, goog.Disposable);
+
+
+/**
+ * @override
+ */
+wtf.ui.TileCache.prototype.disposeInternal = function() {
+  this.clear();
+  goog.base(this, 'disposeInternal');
+};
+
+
+/**
+ * Default maximum number of canvas pixels, about 32MB of RGBA.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.ui.TileCache.DEFAULT_MAX_PIXELS_ = 8 * 1024 * 1024;
+
+
+/**
+ * Removes all tiles.
+ */
+wtf.ui.TileCache.prototype.clear = function() {
+  this.tiles_ = {};
+  this.usage_.length = 0;
+  this.pixelCount_ = 0;
+};
+
+
+/**
+ * Gets the tile with the given key, if it is cached.
+ * @param {string} key Tile key.
+ * @return {wtf.ui.TileCache.Tile} Tile, if found.
+ */
+wtf.ui.TileCache.prototype.get = function(key) {
+  var tile = this.tiles_[key];
+  if (!tile) {
+    return null;
+  }
+  if (this.usage_[this.usage_.length - 1] != tile) {
+    goog.array.remove(this.usage_, tile);
+    this.usage_.push(tile);
+  }
+  return tile;
+};
+
+
+/**
+ * Creates a new tile, evicting the least recently used tiles if over budget.
+ * The contents of the tile canvas are undefined.
+ * @param {string} key Tile key.
+ * @param {number} width Canvas width, in device pixels.
+ * @param {number} height Canvas height, in device pixels.
+ * @return {!wtf.ui.TileCache.Tile} Tile.
+ */
+wtf.ui.TileCache.prototype.create = function(key, width, height) {
+  width = Math.ceil(width);
+  height = Math.ceil(height);
+  var existing = this.tiles_[key];
+  if (existing) {
+    this.remove_(existing);
+  }
+
+  // Evict until the new tile fits, keeping the canvas of a tile with the
+  // same size if one comes up.
+  var canvas = null;
+  while (this.usage_.length &&
+      this.pixelCount_ + width * height > this.maxPixels_) {
+    var evicted = this.usage_[0];
+    this.remove_(evicted);
+    if (evicted.canvas.width == width && evicted.canvas.height == height) {
+      canvas = evicted.canvas;
+    }
+  }
+  if (!canvas) {
+    canvas = /** @type {!HTMLCanvasElement} */ (
+        this.dom_.createElement(goog.dom.TagName.CANVAS));
+    canvas.width = width;
+    canvas.height = height;
+  }
+
+  var tile = new wtf.ui.TileCache.Tile(key, canvas);
+  this.tiles_[key] = tile;
+  this.usage_.push(tile);
+  this.pixelCount_ += width * height;
+  return tile;
+};
+
+
+/**
+ * Removes a tile from the cache.
+ * @param {!wtf.ui.TileCache.Tile} tile Tile.
+ * @private
+ */
+wtf.ui.TileCache.prototype.remove_ = function(tile) {
+  delete this.tiles_[tile.key];
+  goog.array.remove(this.usage_, tile);
+  this.pixelCount_ -= tile.canvas.width * tile.canvas.height;
+};
+
+
+
+/**
+ * A cached tile.
+ * @param {string} key Tile key.
+ * @param {!HTMLCanvasElement} canvas Tile canvas.
+ * @constructor
+ */
+wtf.ui.TileCache.Tile = function(key, canvas) {
+  /**
+   * Tile key.
+   * @type {string}
+   */
+  this.key = key;
+
+  /**
+   * Tile canvas.
+   * @type {!HTMLCanvasElement}
+   */
+  this.canvas = canvas;
+
+  /**
+   * Canvas rendering context of the tile.
+   * @type {!CanvasRenderingContext2D}
+   */
+  this.context = wtf.util.canvas.getContext2d(canvas);
+
+  /**
+   * Painter-specific data kept with the tile contents.
+   * @type {*}
+   */
+  this.data = null;
+};
@@ -7,14 +7,20 @@
 
 /**
  * @fileoverview Time range painting context.
+ * Painters whose contents depend only on the time range can cache them in
+ * offscreen tiles. Tiles cover a fixed span of time at a given zoom level, so
+ * panning only renders the newly exposed tiles.
  *
  * @author benvanik@google.com (Ben Vanik)
  */
 
 goog.provide('wtf.ui.TimePainter');
 
+goog.require('goog.math.Rect');
 goog.require('wtf.db.Unit');
+goog.require('wtf.math');
 goog.require('wtf.ui.Painter');
+goog.require('wtf.util.canvas');
 
 
 
@@ -47,10 +53,49 @@ wtf.ui.TimePainter = function(canvas) {
    * @protected
    */
   this.units = wtf.db.Unit.TIME_MILLISECONDS;
+
+  /**
+   * Whether contents are cached in tiles.
+   * @type {boolean}
+   * @private
+   */
+  this.tileCaching_ = false;
+
+  /**
+   * Version of the contents, part of the tile keys.
+   * Incremented to cause all existing tiles to be ignored.
+   * @type {number}
+   * @private
+   */
+  this.tileVersion_ = 0;
+
+  /**
+   * Zoom level of the previous repaint, in pixels per unit time.
+   * @type {number}
+   * @private
+   */
+  this.lastTileScale_ = 0;
+
+  /**
+   * The tile being rendered, if any.
+   * Subclasses can keep data with the tile in its data field.
+   * @type {wtf.ui.TileCache.Tile}
+   * @protected
+   */
+  this.currentTile = null;
 };
 goog.inherits(wtf.ui.TimePainter, wtf.ui.Painter);
 
 
+/**
+ * Width of each tile, in pixels.
+ * @const
+ * @type {number}
+ * @private
+ */
+wtf.ui.TimePainter.TILE_WIDTH_ = 512;
+
+
 /**
  * Sets the visible time range.
  * @param {number} timeLeft Left-most visible time.
@@ -67,5 +112,158 @@ wtf.ui.TimePainter.prototype.setTimeRange = function(timeLeft, timeRight) {
  * @param {wtf.db.Unit} value Units.
  */
 wtf.ui.TimePainter.prototype.setUnits = function(value) {
-  this.units = value;
+  if (this.units != value) {
+    this.units = value;
+    this.invalidateTiles();
+  }
+};
+
+
+/**
+ * Enables caching of the painter contents in tiles.
+ * Only enable this if {@see #repaintInternal} depends on nothing but the time
+ * range, the bounds size and state that calls {@see #invalidateTiles} when it
+ * changes. Anything fixed to the screen, such as track labels, must be drawn
+ * in {@see #repaintFixedInternal} instead.
+ * @param {boolean} value Whether to cache contents.
+ * @protected
+ */
+wtf.ui.TimePainter.prototype.setTileCaching = function(value) {
+  this.tileCaching_ = value;
+};
+
+
+/**
+ * Discards the cached tiles of this painter and requests a repaint.
+ */
+wtf.ui.TimePainter.prototype.invalidateTiles = function() {
+  this.tileVersion_++;
+  this.requestRepaint();
 };
+
+
+/**
+ * @override
+ */
+wtf.ui.TimePainter.prototype.repaintContents = function(ctx, bounds) {
+  var duration = this.timeRight - this.timeLeft;
+  if (!this.tileCaching_ || duration <= 0) {
+    var preventChildren = this.repaintInternal(ctx, bounds);
+    this.repaintFixedInternal(ctx, bounds, null);
+    return preventChildren;
+  }
+
+  // The scale is rounded so that panning keeps the same tiles. Zooming changes
+  // it each frame and any tiles made would never be reused, so contents are
+  // drawn directly until the scale settles.
+  var scale = Number((bounds.width / duration).toPrecision(6));
+  if (scale != this.lastTileScale_) {
+    this.lastTileScale_ = scale;
+    var preventChildren = this.repaintInternal(ctx, bounds);
+    this.repaintFixedInternal(ctx, bounds, null);
+    return preventChildren;
+  }
+
+  var tiles = this.repaintTiles_(ctx, bounds, scale);
+  this.repaintFixedInternal(ctx, bounds, tiles);
+  return undefined;
+};
+
+
+/**
+ * Draws the visible tiles, rendering any that are not cached.
+ * @param {!CanvasRenderingContext2D} ctx Canvas render context.
+ * @param {!goog.math.Rect} bounds Draw bounds.
+ * @param {number} scale Tile zoom level, in pixels per unit time.
+ * @return {!Array.<!wtf.ui.TileCache.Tile>} Visible tiles.
+ * @private
+ */
+wtf.ui.TimePainter.prototype.repaintTiles_ = function(ctx, bounds, scale) {
+  var tileCache = this.getTileCache();
+  var ratio = this.getScaleRatio();
+  var timeLeft = this.timeLeft;
+  var timeRight = this.timeRight;
+  var tileWidth = wtf.ui.TimePainter.TILE_WIDTH_;
+  var tileDuration = tileWidth / scale;
+  var firstTile = Math.floor(timeLeft / tileDuration);
+  var lastTile = Math.floor(timeRight / tileDuration);
+  var keyPrefix = goog.getUid(this) + ':' + this.tileVersion_ + ':' +
+      scale + ':' + bounds.height + ':';
+
+  this.clip(bounds.left, bounds.top, bounds.width, bounds.height);
+
+  var tiles = [];
+  for (var n = firstTile; n <= lastTile; n++) {
+    var tileTimeLeft = n * tileDuration;
+    var key = keyPrefix + n;
+    var tile = tileCache.get(key);
+    if (!tile) {
+      // Tiles are rendered a pixel wider than they are drawn so that ranges
+      // clipped at their right edges are still drawn in full.
+      tile = tileCache.create(
+          key, (tileWidth + 1) * ratio, bounds.height * ratio);
+      this.repaintTile_(
+          tile, bounds, tileTimeLeft, tileTimeLeft + (tileWidth + 1) / scale);
+    }
+    var x = wtf.math.remap(tileTimeLeft,
+        timeLeft, timeRight,
+        bounds.left, bounds.left + bounds.width);
+    var w = tileDuration / (timeRight - timeLeft) * bounds.width;
+    ctx.drawImage(tile.canvas,
+        0, 0, tileWidth * ratio, tile.canvas.height,
+        x, bounds.top, w, bounds.height);
+    tiles.push(tile);
+  }
+  return tiles;
+};
+
+
+/**
+ * Renders the contents of a tile.
+ * @param {!wtf.ui.TileCache.Tile} tile Tile.
+ * @param {!goog.math.Rect} bounds Draw bounds of the painter.
+ * @param {number} tileTimeLeft Left-most time in the tile.
+ * @param {number} tileTimeRight Right-most time in the tile.
+ * @private
+ */
+wtf.ui.TimePainter.prototype.repaintTile_ = function(
+    tile, bounds, tileTimeLeft, tileTimeRight) {
+  var tileCtx = tile.context;
+  tileCtx.setTransform(1, 0, 0, 1, 0, 0);
+  tileCtx.clearRect(0, 0, tile.canvas.width, tile.canvas.height);
+  wtf.util.canvas.reset(tileCtx, this.getScaleRatio());
+
+  // Draw with the same coordinates as on screen, translated into the tile.
+  tileCtx.translate(-bounds.left, -bounds.top);
+  var tileBounds = new goog.math.Rect(
+      bounds.left, bounds.top,
+      wtf.ui.TimePainter.TILE_WIDTH_ + 1, bounds.height);
+
+  var timeLeft = this.timeLeft;
+  var timeRight = this.timeRight;
+  this.timeLeft = tileTimeLeft;
+  this.timeRight = tileTimeRight;
+  this.currentTile = tile;
+  var previousCtx = this.swapCanvasContext2d(tileCtx);
+
+  tileCtx.save();
+  this.repaintInternal(tileCtx, tileBounds);
+  tileCtx.restore();
+
+  this.swapCanvasContext2d(previousCtx);
+  this.currentTile = null;
+  this.timeLeft = timeLeft;
+  this.timeRight = timeRight;
+};
+
+
+/**
+ * Repaints contents that are fixed to the screen instead of to time, such as
+ * track labels. This is called after every repaint, over any cached tiles.
+ * @param {!CanvasRenderingContext2D} ctx Canvas render context.
+ * @param {!goog.math.Rect} bounds Draw bounds.
+ * @param {Array.<!wtf.ui.TileCache.Tile>} tiles Tiles that were drawn, or null
+ *     if the contents were drawn directly.
+ * @protected
+ */
+wtf.ui.TimePainter.prototype.repaintFixedInternal = goog.nullFunction;
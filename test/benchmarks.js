@@ -4,5 +4,6 @@ var benchmarkList = [
   'simple.js',
   'tracetypes.js',
   'dom.js',
+  'eventsort.js',
 ];
 if (typeof exports !== 'undefined') { exports.value = benchmarkList; }
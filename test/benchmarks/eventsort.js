@@ -0,0 +1,111 @@
+/**
+ * Copyright 2013 Google, Inc. All Rights Reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/**
+ * @fileoverview Event sorting benchmark file.
+ * Compares the typed array event sort against the comparator sort it
+ * replaced. Requires wtf.db, so it only runs under node.
+ *
+ * @author benvanik@google.com (Ben Vanik)
+ */
+
+
+var SORT_STRUCT_SIZE = 11;
+var SORT_ID = 0;
+var SORT_TIME = 4;
+var SORT_EVENT_COUNT = 100000;
+
+
+/**
+ * Builds event data with the given time generator.
+ * @param {function(number):number} timeFn Returns the time of an event.
+ * @return {!Uint32Array} Event data.
+ */
+function buildSortEventData(timeFn) {
+  var eventData = new Uint32Array(SORT_EVENT_COUNT * SORT_STRUCT_SIZE);
+  for (var n = 0, o = 0; n < SORT_EVENT_COUNT; n++, o += SORT_STRUCT_SIZE) {
+    eventData[o + SORT_ID] = n;
+    eventData[o + SORT_TIME] = timeFn(n);
+  }
+  return eventData;
+};
+
+
+// Eight sources/chunks appended one after the other.
+var sortRunsTemplate = buildSortEventData(function(n) {
+  var runLength = SORT_EVENT_COUNT / 8;
+  return (n % runLength) * 8 + ((n / runLength) | 0);
+});
+
+// Fully shuffled.
+var sortRandomTemplate = buildSortEventData(function(n) {
+  return (Math.random() * 0xFFFFFFFF) >>> 0;
+});
+
+var sortScratch = new Uint32Array(SORT_EVENT_COUNT * SORT_STRUCT_SIZE);
+
+
+/**
+ * The original boxed comparator sort and copy.
+ * @param {!Uint32Array} eventData Event data.
+ * @param {number} count Event count.
+ * @return {!Uint32Array} Sorted event data.
+ */
+function comparatorSortEvents(eventData, count) {
+  var sortIndex = new Array(count);
+  for (var n = 0; n < sortIndex.length; n++) {
+    sortIndex[n] = n;
+  }
+  sortIndex.sort(function(ai, bi) {
+    var ao = ai * SORT_STRUCT_SIZE;
+    var bo = bi * SORT_STRUCT_SIZE;
+    var atime = eventData[ao + SORT_TIME];
+    var btime = eventData[bo + SORT_TIME];
+    if (atime == btime) {
+      return eventData[ao + SORT_ID] - eventData[bo + SORT_ID];
+    }
+    return atime - btime;
+  });
+  var newData = new Uint32Array(eventData.length);
+  for (var n = 0; n < sortIndex.length; n++) {
+    var oldOffset = sortIndex[n] * SORT_STRUCT_SIZE;
+    var newOffset = n * SORT_STRUCT_SIZE;
+    for (var si = oldOffset, di = newOffset;
+        si < oldOffset + SORT_STRUCT_SIZE; si++, di++) {
+      newData[di] = eventData[si];
+    }
+  }
+  for (var n = 0, o = 0; n < count; n++) {
+    newData[o + SORT_ID] = n;
+    o += SORT_STRUCT_SIZE;
+  }
+  return newData;
+};
+
+
+benchmark.register('eventSortRunsComparator', function() {
+  sortScratch.set(sortRunsTemplate);
+  comparatorSortEvents(sortScratch, SORT_EVENT_COUNT);
+}, ['node']);
+
+
+benchmark.register('eventSortRunsTyped', function() {
+  sortScratch.set(sortRunsTemplate);
+  wtf.db.eventsort.sort(sortScratch, SORT_EVENT_COUNT);
+}, ['node']);
+
+
+benchmark.register('eventSortRandomComparator', function() {
+  sortScratch.set(sortRandomTemplate);
+  comparatorSortEvents(sortScratch, SORT_EVENT_COUNT);
+}, ['node']);
+
+
+benchmark.register('eventSortRandomTyped', function() {
+  sortScratch.set(sortRandomTemplate);
+  wtf.db.eventsort.sort(sortScratch, SORT_EVENT_COUNT);
+}, ['node']);
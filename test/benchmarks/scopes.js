@@ -32,3 +32,29 @@ benchmark.register('customScope', function() {
   //
   wtf.trace.leaveScope(scope);
 });
+
+
+var fixedScopeEvent = wtf.trace.events.createScope(
+    'fixedScope(uint32 a, float32 b)');
+benchmark.register('fixedScope', function() {
+  var scope = fixedScopeEvent(1, 2);
+  //
+  wtf.trace.leaveScope(scope);
+});
+
+
+var variableScopeEvent = wtf.trace.events.createScope(
+    'variableScope(uint32 a, uint32[] b)');
+var variableScopeArray = [1, 2, 3, 4];
+benchmark.register('variableScope', function() {
+  var scope = variableScopeEvent(1, variableScopeArray);
+  //
+  wtf.trace.leaveScope(scope);
+});
+
+
+var fixedInstanceEvent = wtf.trace.events.createInstance(
+    'fixedInstance(uint32 a)');
+benchmark.register('fixedInstance', function() {
+  fixedInstanceEvent(1);
+});
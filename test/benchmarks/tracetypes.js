@@ -171,3 +171,19 @@ benchmark.register('traceUtf810', function() {
 benchmark.register('traceUtf840', function() {
   traceUtf8Event('0123456789012345678901234567890123456789');
 });
+
+
+var traceBoolEvent = wtf.trace.events.createInstance('traceBool(bool v)');
+benchmark.register('traceBool', function() {
+  traceBoolEvent(true);
+});
+
+
+var traceAnyEvent = wtf.trace.events.createInstance('traceAny(any v)');
+var traceAnyValue = {'a': 1, 'b': 'hello'};
+benchmark.register('traceAnyNumber', function() {
+  traceAnyEvent(123);
+});
+benchmark.register('traceAnyObject', function() {
+  traceAnyEvent(traceAnyValue);
+});